@@ -11,34 +11,94 @@
 
 #include "PopulationSorter.h"
 
+#include <string.h>
+
+
+
+// true if score A should come before score B
+static inline char comesBefore( double inScoreA, double inScoreB, 
+	char inDecreasingOrder ) {
+	
+	if( inDecreasingOrder ) {
+		return inScoreA > inScoreB;
+		}
+	return inScoreA < inScoreB;
+	}
+
+
+
 void PopulationSorter::sortPopulation( PopulationMember** inPopulation, 
 	double* inScores, int inPopulationSize, char inDecreasingOrder ) {
 
-	// for now, this uses selection sort, which has
-	// an n^2 running time, but it shouldn't matter much...
+	// bottom-up merge sort, n log n
+	// stable, so members with equal scores keep their order
 	
-	for( int t=0; t<inPopulationSize; t++ ) {
-		// best is max in case of decreasing order and
-		// min in case of increasing order.
-		
-		double best = inScores[t];
-		int bestInd = t;
+	if( inPopulationSize < 2 ) {
+		return;
+		}
+	
+	PopulationMember **populationA = inPopulation;
+	double *scoresA = inScores;
+	
+	PopulationMember **populationB = new PopulationMember*[ inPopulationSize ];
+	double *scoresB = new double[ inPopulationSize ];
+	
+	// runs of length 1 are already sorted, merge pairs of runs
+	// from A into B, then swap roles
+	for( int runLength=1; runLength<inPopulationSize; runLength *= 2 ) {
 		
-		for( int u=t+1; u<inPopulationSize; u++ ) {
-			if( !inDecreasingOrder && inScores[u] < best
-				|| inDecreasingOrder && inScores[u] > best ) {
-				best = inScores[u];
-				bestInd = u;
+		for( int start=0; start<inPopulationSize; start += 2 * runLength ) {
+			int middle = start + runLength;
+			if( middle > inPopulationSize ) {
+				middle = inPopulationSize;
+				}
+			int end = middle + runLength;
+			if( end > inPopulationSize ) {
+				end = inPopulationSize;
+				}
+			
+			int left = start;
+			int right = middle;
+			
+			for( int out=start; out<end; out++ ) {
+				// take from right only if strictly better, for stability
+				if( right < end && 
+					( left >= middle || 
+					  comesBefore( scoresA[right], scoresA[left], 
+								   inDecreasingOrder ) ) ) {
+					
+					populationB[out] = populationA[right];
+					scoresB[out] = scoresA[right];
+					right++;
+					}
+				else {
+					populationB[out] = populationA[left];
+					scoresB[out] = scoresA[left];
+					left++;
+					}
 				}
 			}
 		
-		if( bestInd != t ) {
-			// swap t with min
-			PopulationMember *temp = inPopulation[bestInd];
-			inPopulation[bestInd] = inPopulation[t];
-			inScores[bestInd] = inScores[t];
-			inPopulation[t] = temp;
-			inScores[t] = best;
-			}
+		PopulationMember **tempPopulation = populationA;
+		populationA = populationB;
+		populationB = tempPopulation;
+		
+		double *tempScores = scoresA;
+		scoresA = scoresB;
+		scoresB = tempScores;
+		}
+	
+	if( populationA != inPopulation ) {
+		// result ended up in our buffers
+		memcpy( inPopulation, populationA, 
+			inPopulationSize * sizeof( PopulationMember* ) );
+		memcpy( inScores, scoresA, inPopulationSize * sizeof( double ) );
+		
+		delete [] populationA;
+		delete [] scoresA;
+		}
+	else {
+		delete [] populationB;
+		delete [] scoresB;
 		}
 	}
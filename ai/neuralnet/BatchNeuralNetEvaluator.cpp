@@ -0,0 +1,479 @@
+#include "BatchNeuralNetEvaluator.h"
+
+#include "StepThreshold.h"
+#include "IdentityThreshold.h"
+
+#include <string.h>
+
+
+
+#include "minorGems/system/cpuFeatures.h"
+
+
+
+// 0 portable, 1 SSE2, 2 AVX
+static int implementationLimit = 2;
+
+
+
+int getForwardPassImplementation() {
+    const CPUFeatures *features = getCPUFeatures();
+
+    int level = 0;
+    if( features->sse2 ) {
+        level = 1;
+        }
+    if( features->avx ) {
+        level = 2;
+        }
+
+    return limitImplementation( level, implementationLimit );
+    }
+
+
+
+void setForwardPassImplementationLimit( int inMaxImplementation ) {
+    implementationLimit = inMaxImplementation;
+    }
+
+
+
+// Layer kernels.
+//
+// Activations are stored one row per neuron, inStride values per row, one
+// value per example.  Each output row is
+//
+//   sum over a of inWeights[ a * inNumOut + b ] * inValues[ a * inStride ]
+//
+// added up in increasing order of a, starting from 0, the same order
+// FeedForwardNeuralNet::run uses, so results are identical.  No fused
+// multiply-add, which would round differently.
+//
+// If inStepThresholds is not NULL, each sum is replaced with 0 if below
+// the neuron's threshold and 1 otherwise, as in StepThreshold.
+//
+// inStride is a multiple of 4.
+
+
+static void layerPortable( const double *inValues, int inNumIn,
+                           const double *inWeights, int inNumOut,
+                           int inStride, const double *inStepThresholds,
+                           double *outValues ) {
+
+    for( int b=0; b<inNumOut; b++ ) {
+        double *out = &( outValues[ b * inStride ] );
+
+        for( int e=0; e<inStride; e++ ) {
+            out[e] = 0.0;
+            }
+
+        for( int a=0; a<inNumIn; a++ ) {
+            double weight = inWeights[ a * inNumOut + b ];
+            const double *in = &( inValues[ a * inStride ] );
+
+            for( int e=0; e<inStride; e++ ) {
+                out[e] += weight * in[e];
+                }
+            }
+
+        if( inStepThresholds != NULL ) {
+            double threshold = inStepThresholds[b];
+
+            for( int e=0; e<inStride; e++ ) {
+                if( out[e] < threshold ) {
+                    out[e] = 0.0;
+                    }
+                else {
+                    out[e] = 1.0;
+                    }
+                }
+            }
+        }
+    }
+
+
+
+#ifdef CPU_FEATURES_X86
+
+
+__attribute__(( target( "sse2" ) ))
+static void layerSSE2( const double *inValues, int inNumIn,
+                       const double *inWeights, int inNumOut,
+                       int inStride, const double *inStepThresholds,
+                       double *outValues ) {
+
+    __m128d one = _mm_set1_pd( 1.0 );
+
+    for( int b=0; b<inNumOut; b++ ) {
+        double *out = &( outValues[ b * inStride ] );
+
+        __m128d threshold = _mm_setzero_pd();
+        if( inStepThresholds != NULL ) {
+            threshold = _mm_set1_pd( inStepThresholds[b] );
+            }
+
+        int e = 0;
+
+        // 8 examples at a time, in registers for the whole sum
+        for( ; e + 8 <= inStride; e += 8 ) {
+            __m128d sum0 = _mm_setzero_pd();
+            __m128d sum1 = _mm_setzero_pd();
+            __m128d sum2 = _mm_setzero_pd();
+            __m128d sum3 = _mm_setzero_pd();
+
+            for( int a=0; a<inNumIn; a++ ) {
+                __m128d weight = _mm_set1_pd( inWeights[ a * inNumOut + b ] );
+                const double *in = &( inValues[ a * inStride + e ] );
+
+                sum0 = _mm_add_pd( sum0, _mm_mul_pd( weight,
+                                                     _mm_loadu_pd( in ) ) );
+                sum1 = _mm_add_pd( sum1, _mm_mul_pd( weight,
+                                                     _mm_loadu_pd( in + 2 ) ) );
+                sum2 = _mm_add_pd( sum2, _mm_mul_pd( weight,
+                                                     _mm_loadu_pd( in + 4 ) ) );
+                sum3 = _mm_add_pd( sum3, _mm_mul_pd( weight,
+                                                     _mm_loadu_pd( in + 6 ) ) );
+                }
+
+            if( inStepThresholds != NULL ) {
+                sum0 = _mm_andnot_pd( _mm_cmplt_pd( sum0, threshold ), one );
+                sum1 = _mm_andnot_pd( _mm_cmplt_pd( sum1, threshold ), one );
+                sum2 = _mm_andnot_pd( _mm_cmplt_pd( sum2, threshold ), one );
+                sum3 = _mm_andnot_pd( _mm_cmplt_pd( sum3, threshold ), one );
+                }
+
+            _mm_storeu_pd( out + e, sum0 );
+            _mm_storeu_pd( out + e + 2, sum1 );
+            _mm_storeu_pd( out + e + 4, sum2 );
+            _mm_storeu_pd( out + e + 6, sum3 );
+            }
+
+        for( ; e < inStride; e += 2 ) {
+            __m128d sum = _mm_setzero_pd();
+
+            for( int a=0; a<inNumIn; a++ ) {
+                __m128d weight = _mm_set1_pd( inWeights[ a * inNumOut + b ] );
+                sum = _mm_add_pd(
+                    sum, _mm_mul_pd( weight,
+                                     _mm_loadu_pd(
+                                         &( inValues[ a * inStride + e ] ) ) ) );
+                }
+
+            if( inStepThresholds != NULL ) {
+                sum = _mm_andnot_pd( _mm_cmplt_pd( sum, threshold ), one );
+                }
+
+            _mm_storeu_pd( out + e, sum );
+            }
+        }
+    }
+
+
+
+__attribute__(( target( "avx" ) ))
+static void layerAVX( const double *inValues, int inNumIn,
+                      const double *inWeights, int inNumOut,
+                      int inStride, const double *inStepThresholds,
+                      double *outValues ) {
+
+    __m256d one = _mm256_set1_pd( 1.0 );
+
+    for( int b=0; b<inNumOut; b++ ) {
+        double *out = &( outValues[ b * inStride ] );
+
+        __m256d threshold = _mm256_setzero_pd();
+        if( inStepThresholds != NULL ) {
+            threshold = _mm256_set1_pd( inStepThresholds[b] );
+            }
+
+        int e = 0;
+
+        // 16 examples at a time, in registers for the whole sum
+        for( ; e + 16 <= inStride; e += 16 ) {
+            __m256d sum0 = _mm256_setzero_pd();
+            __m256d sum1 = _mm256_setzero_pd();
+            __m256d sum2 = _mm256_setzero_pd();
+            __m256d sum3 = _mm256_setzero_pd();
+
+            for( int a=0; a<inNumIn; a++ ) {
+                __m256d weight =
+                    _mm256_set1_pd( inWeights[ a * inNumOut + b ] );
+                const double *in = &( inValues[ a * inStride + e ] );
+
+                sum0 = _mm256_add_pd(
+                    sum0, _mm256_mul_pd( weight, _mm256_loadu_pd( in ) ) );
+                sum1 = _mm256_add_pd(
+                    sum1, _mm256_mul_pd( weight, _mm256_loadu_pd( in + 4 ) ) );
+                sum2 = _mm256_add_pd(
+                    sum2, _mm256_mul_pd( weight, _mm256_loadu_pd( in + 8 ) ) );
+                sum3 = _mm256_add_pd(
+                    sum3, _mm256_mul_pd( weight, _mm256_loadu_pd( in + 12 ) ) );
+                }
+
+            if( inStepThresholds != NULL ) {
+                sum0 = _mm256_andnot_pd(
+                    _mm256_cmp_pd( sum0, threshold, _CMP_LT_OQ ), one );
+                sum1 = _mm256_andnot_pd(
+                    _mm256_cmp_pd( sum1, threshold, _CMP_LT_OQ ), one );
+                sum2 = _mm256_andnot_pd(
+                    _mm256_cmp_pd( sum2, threshold, _CMP_LT_OQ ), one );
+                sum3 = _mm256_andnot_pd(
+                    _mm256_cmp_pd( sum3, threshold, _CMP_LT_OQ ), one );
+                }
+
+            _mm256_storeu_pd( out + e, sum0 );
+            _mm256_storeu_pd( out + e + 4, sum1 );
+            _mm256_storeu_pd( out + e + 8, sum2 );
+            _mm256_storeu_pd( out + e + 12, sum3 );
+            }
+
+        for( ; e < inStride; e += 4 ) {
+            __m256d sum = _mm256_setzero_pd();
+
+            for( int a=0; a<inNumIn; a++ ) {
+                __m256d weight =
+                    _mm256_set1_pd( inWeights[ a * inNumOut + b ] );
+                sum = _mm256_add_pd(
+                    sum, _mm256_mul_pd(
+                        weight,
+                        _mm256_loadu_pd( &( inValues[ a * inStride + e ] ) ) ) );
+                }
+
+            if( inStepThresholds != NULL ) {
+                sum = _mm256_andnot_pd(
+                    _mm256_cmp_pd( sum, threshold, _CMP_LT_OQ ), one );
+                }
+
+            _mm256_storeu_pd( out + e, sum );
+            }
+        }
+    }
+
+
+#endif
+
+
+
+static void runLayer( const double *inValues, int inNumIn,
+                      const double *inWeights, int inNumOut,
+                      int inStride, const double *inStepThresholds,
+                      double *outValues ) {
+
+#ifdef CPU_FEATURES_X86
+    int level = getForwardPassImplementation();
+
+    if( level == 2 ) {
+        layerAVX( inValues, inNumIn, inWeights, inNumOut, inStride,
+                  inStepThresholds, outValues );
+        return;
+        }
+    if( level == 1 ) {
+        layerSSE2( inValues, inNumIn, inWeights, inNumOut, inStride,
+                   inStepThresholds, outValues );
+        return;
+        }
+#endif
+
+    layerPortable( inValues, inNumIn, inWeights, inNumOut, inStride,
+                   inStepThresholds, outValues );
+    }
+
+
+
+BatchNeuralNetEvaluator::BatchNeuralNetEvaluator( int inNumThreads )
+        : mNumExamples( 0 ), mNumInputs( 0 ), mStride( 0 ),
+          mInputs( NULL ),
+          mPool( inNumThreads ),
+          mJobNets( NULL ), mJobOutputs( NULL ) {
+
+    int numWorkers = mPool.getNumThreads() + 1;
+
+    mScratch = new ForwardPassScratch[ numWorkers ];
+
+    for( int i=0; i<numWorkers; i++ ) {
+        mScratch[i].values = NULL;
+        mScratch[i].nextValues = NULL;
+        mScratch[i].size = 0;
+        }
+    }
+
+
+
+BatchNeuralNetEvaluator::~BatchNeuralNetEvaluator() {
+    if( mInputs != NULL ) {
+        delete [] mInputs;
+        }
+
+    for( int i=0; i<mPool.getNumThreads() + 1; i++ ) {
+        if( mScratch[i].values != NULL ) {
+            delete [] mScratch[i].values;
+            delete [] mScratch[i].nextValues;
+            }
+        }
+    delete [] mScratch;
+    }
+
+
+
+void BatchNeuralNetEvaluator::setExamples( double **inInputs,
+                                           int inNumExamples,
+                                           int inNumInputs ) {
+    if( mInputs != NULL ) {
+        delete [] mInputs;
+        }
+
+    mNumExamples = inNumExamples;
+    mNumInputs = inNumInputs;
+    mStride = ( inNumExamples + 3 ) & ~3;
+
+    mInputs = new double[ mNumInputs * mStride ];
+
+    // padding examples are zero
+    memset( mInputs, 0, mNumInputs * mStride * sizeof( double ) );
+
+    for( int e=0; e<mNumExamples; e++ ) {
+        for( int i=0; i<mNumInputs; i++ ) {
+            mInputs[ i * mStride + e ] = inInputs[e][i];
+            }
+        }
+    }
+
+
+
+// how a whole layer is thresholded
+enum LayerThresholdType {
+    allStep,
+    allIdentity,
+    mixedThresholds
+    };
+
+
+
+static LayerThresholdType getThresholdType( FeedForwardNeuralNet *inNet,
+                                            int inLayer ) {
+    int numNeurons = inNet->getNumInLayer( inLayer );
+
+    // StepThreshold's singleton is per source file, so check the class
+    // rather than comparing against getInstance
+    char allStepSoFar = true;
+    char allIdentitySoFar = true;
+
+    for( int j=0; j<numNeurons; j++ ) {
+        Threshold *threshold = inNet->getThreshold( inLayer, j );
+
+        if( dynamic_cast<StepThreshold*>( threshold ) == NULL ) {
+            allStepSoFar = false;
+            }
+        if( dynamic_cast<IdentityThreshold*>( threshold ) == NULL ) {
+            allIdentitySoFar = false;
+            }
+        }
+
+    if( allStepSoFar ) {
+        return allStep;
+        }
+    if( allIdentitySoFar ) {
+        return allIdentity;
+        }
+    return mixedThresholds;
+    }
+
+
+
+void BatchNeuralNetEvaluator::runNet( FeedForwardNeuralNet *inNet,
+                                      ForwardPassScratch *inScratch,
+                                      double *outOutputs ) {
+
+    int totalNumLayers = inNet->getNumHiddenLayers() + 2;
+
+    int maxNeurons = 0;
+    for( int i=1; i<totalNumLayers; i++ ) {
+        if( inNet->getNumInLayer( i ) > maxNeurons ) {
+            maxNeurons = inNet->getNumInLayer( i );
+            }
+        }
+
+    int neededSize = maxNeurons * mStride;
+
+    if( inScratch->size < neededSize ) {
+        if( inScratch->values != NULL ) {
+            delete [] inScratch->values;
+            delete [] inScratch->nextValues;
+            }
+        inScratch->values = new double[ neededSize ];
+        inScratch->nextValues = new double[ neededSize ];
+        inScratch->size = neededSize;
+        }
+
+
+    const double *values = mInputs;
+
+    for( int i=1; i<totalNumLayers; i++ ) {
+        int numIn = inNet->getNumInLayer( i - 1 );
+        int numOut = inNet->getNumInLayer( i );
+
+        double *thresholdValues = inNet->getLayerThresholdValues( i );
+
+        LayerThresholdType type = getThresholdType( inNet, i );
+
+        double *nextValues = inScratch->nextValues;
+
+        runLayer( values, numIn, inNet->getLayerWeights( i - 1 ), numOut,
+                  mStride,
+                  ( type == allStep ) ? thresholdValues : NULL,
+                  nextValues );
+
+        if( type == mixedThresholds ) {
+            for( int b=0; b<numOut; b++ ) {
+                Threshold *threshold = inNet->getThreshold( i, b );
+                double *row = &( nextValues[ b * mStride ] );
+
+                for( int e=0; e<mNumExamples; e++ ) {
+                    row[e] = threshold->apply( row[e], thresholdValues[b] );
+                    }
+                }
+            }
+
+        // swap
+        inScratch->nextValues = inScratch->values;
+        inScratch->values = nextValues;
+        values = nextValues;
+        }
+
+
+    int numOutputs = inNet->getNumInLayer( totalNumLayers - 1 );
+
+    for( int o=0; o<numOutputs; o++ ) {
+        memcpy( &( outOutputs[ o * mNumExamples ] ),
+                &( values[ o * mStride ] ),
+                mNumExamples * sizeof( double ) );
+        }
+    }
+
+
+
+void BatchNeuralNetEvaluator::evaluate( FeedForwardNeuralNet *inNet,
+                                        double *outOutputs ) {
+    runNet( inNet, &( mScratch[0] ), outOutputs );
+    }
+
+
+
+void BatchNeuralNetEvaluator::evaluatePopulation(
+    FeedForwardNeuralNet **inNets, int inNumNets, double **outOutputs ) {
+
+    mJobNets = inNets;
+    mJobOutputs = outOutputs;
+
+    mPool.runJobs( this, inNumNets );
+
+    mJobNets = NULL;
+    mJobOutputs = NULL;
+    }
+
+
+
+void BatchNeuralNetEvaluator::runJob( int inJobIndex, int inWorkerIndex ) {
+    runNet( mJobNets[ inJobIndex ], &( mScratch[ inWorkerIndex ] ),
+            mJobOutputs[ inJobIndex ] );
+    }
@@ -0,0 +1,164 @@
+#ifndef BATCH_NEURAL_NET_EVALUATOR_INCLUDED
+#define BATCH_NEURAL_NET_EVALUATOR_INCLUDED
+
+
+#include "FeedForwardNeuralNet.h"
+
+#include "minorGems/system/WorkerPool.h"
+
+
+
+/**
+ * Gets the forward pass implementation in use.
+ *
+ * @return 0 for portable code, 1 for SSE2, or 2 for AVX.
+ */
+int getForwardPassImplementation();
+
+
+/**
+ * Limits which forward pass implementation can be used, mostly for
+ * testing and benchmarking.
+ *
+ * @param inMaxImplementation the highest implementation to use, if
+ *   supported by this CPU, as numbered by getForwardPassImplementation.
+ */
+void setForwardPassImplementationLimit( int inMaxImplementation );
+
+
+
+// scratch space for one thread's forward passes
+typedef struct ForwardPassScratch {
+        // activations for the current and next layer
+        double *values;
+        double *nextValues;
+        int size;
+    } ForwardPassScratch;
+
+
+
+/**
+ * Runs FeedForwardNeuralNets over a whole set of examples at once.
+ *
+ * Each layer is computed as one matrix product between the layer's
+ * weight matrix and the activations for every example, stored one row
+ * per neuron so that examples lie along SIMD vectors.  Step and identity
+ * thresholds are applied in bulk, other thresholds with a call per value.
+ *
+ * Outputs match FeedForwardNeuralNet::run exactly.
+ *
+ * Populations of networks are split across a pool of worker threads.
+ *
+ * @author Jason Rohrer
+ */
+class BatchNeuralNetEvaluator : public WorkerPoolTask {
+
+    public:
+
+        /**
+         * Constructs an evaluator.
+         *
+         * @param inNumThreads the number of worker threads to start.  The
+         *   calling thread works too, so 0 evaluates everything on the
+         *   calling thread.  -1 picks one fewer than the number of
+         *   processors.  Defaults to -1.
+         */
+        BatchNeuralNetEvaluator( int inNumThreads = -1 );
+
+        ~BatchNeuralNetEvaluator();
+
+
+
+        /**
+         * Sets the examples to run networks on.
+         *
+         * @param inInputs an array of inNumExamples input vectors, each
+         *   of length inNumInputs.  Copied by this call.
+         *   Destroyed by caller.
+         * @param inNumExamples the number of examples.
+         * @param inNumInputs the number of inputs in each example.
+         */
+        void setExamples( double **inInputs, int inNumExamples,
+                          int inNumInputs );
+
+
+
+        int getNumExamples() {
+            return mNumExamples;
+            }
+
+
+
+        /**
+         * Runs a network on all examples.
+         *
+         * Not safe to call while evaluatePopulation is running on
+         * another thread.
+         *
+         * @param inNet the network.  Must have as many inputs as the
+         *   examples.
+         *   Destroyed by caller.
+         * @param outOutputs array where all outputs will be returned,
+         *   output o for example e at [ o * getNumExamples() + e ].
+         *   Destroyed by caller.
+         */
+        void evaluate( FeedForwardNeuralNet *inNet, double *outOutputs );
+
+
+
+        /**
+         * Runs many networks on all examples, split across the worker
+         * threads.
+         *
+         * @param inNets the networks.  None may be changed until this
+         *   call returns.
+         *   Destroyed by caller.
+         * @param inNumNets the number of networks.
+         * @param outOutputs array of one output array for each network,
+         *   each laid out as for evaluate.
+         *   Destroyed by caller.
+         */
+        void evaluatePopulation( FeedForwardNeuralNet **inNets,
+                                 int inNumNets, double **outOutputs );
+
+
+
+        // implements the WorkerPoolTask interface
+        // runs one network of the population being evaluated
+        void runJob( int inJobIndex, int inWorkerIndex );
+
+
+
+    protected:
+
+        int mNumExamples;
+        int mNumInputs;
+
+        // example count rounded up to a multiple of 4 for vector access,
+        // the length of each row of activations
+        int mStride;
+
+        // one row per input, mNumInputs x mStride
+        double *mInputs;
+
+
+        WorkerPool mPool;
+
+        // one for each worker, indexed as by WorkerPoolTask::runJob, so
+        // the calling thread uses the first
+        ForwardPassScratch *mScratch;
+
+        // the population being evaluated
+        FeedForwardNeuralNet **mJobNets;
+        double **mJobOutputs;
+
+
+
+        void runNet( FeedForwardNeuralNet *inNet,
+                     ForwardPassScratch *inScratch, double *outOutputs );
+
+    };
+
+
+
+#endif
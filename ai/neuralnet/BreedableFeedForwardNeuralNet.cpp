@@ -910,7 +910,11 @@ void BreedableFeedForwardNeuralNet::mutate( float inMutationProb,
 		int totalNumLayers = mNumHiddenLayers + 2;
 
 		for( int i=0; i<totalNumLayers; i++ ){
-			int numInNextLayer = mNeuronsPerLayer[i+1];
+			// output layer has no next layer
+			int numInNextLayer = 0;
+			if( i<totalNumLayers-1 ) {
+				numInNextLayer = mNeuronsPerLayer[i+1];
+				}
 
 			for( int j=0; j<mNeuronsPerLayer[i]; j++ ) {
 
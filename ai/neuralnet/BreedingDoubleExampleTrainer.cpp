@@ -35,14 +35,16 @@
  
  
 BreedingDoubleExampleTrainer::BreedingDoubleExampleTrainer()
-	: mErrorEvaluator( new L1ErrorEvaluator() ), mEvaluatorPassedIn( false ) {
+	: mErrorEvaluator( new L1ErrorEvaluator() ), mEvaluatorPassedIn( false ),
+	  mEvaluator( NULL ), mNumThreads( -1 ) {
 	
 	mBestFileName = "test.net";
 	}
 	
 BreedingDoubleExampleTrainer::BreedingDoubleExampleTrainer( 
 	ErrorEvaluator *inErrorEvaluator )
-	: mErrorEvaluator( inErrorEvaluator ), mEvaluatorPassedIn( true ) {
+	: mErrorEvaluator( inErrorEvaluator ), mEvaluatorPassedIn( true ),
+	  mEvaluator( NULL ), mNumThreads( -1 ) {
 	
 	mBestFileName = "test.net";
 	}
@@ -51,6 +53,9 @@ BreedingDoubleExampleTrainer::~BreedingDoubleExampleTrainer() {
 	if( !mEvaluatorPassedIn ) {
 		delete mErrorEvaluator;
 		}
+	if( mEvaluator != NULL ) {
+		delete mEvaluator;
+		}
 	}
  
 int BreedingDoubleExampleTrainer::train( int inMaxNumRounds, 
@@ -59,41 +64,86 @@ int BreedingDoubleExampleTrainer::train( int inMaxNumRounds,
  	
 	int errorReturn = -1;
 	
-	int r;
 	int n;
 	int e;
 	
+	// examples don't change during training, so cast them and hand them
+	// to the evaluator once
+	
+	// correct output values from each training example
+	mCorrectOutputs = new double[ mExampleSetSize ];
+	double **exampleInputs = new double*[ mExampleSetSize ];
+	int numInputs = 0;
+	
+	// for each training example
+	for( e=0; e<mExampleSetSize; e++ ) { 
+		DoubleTrainingExample *example =
+			dynamic_cast < DoubleTrainingExample* >( mExamples[e] );
+		if( example == 0 ) {
+			printf( "Casting a training example to a ");
+			printf( "DoubleTrainingExample failed.\n" );
+			delete [] mCorrectOutputs;
+			delete [] exampleInputs;
+			return errorReturn;
+			}
+		
+		mCorrectOutputs[e] = example->getOutput(0);
+		exampleInputs[e] = example->getInputs();
+		numInputs = example->getNumInputs();
+		}
+	
+	if( mEvaluator == NULL ) {
+		mEvaluator = new BatchNeuralNetEvaluator( mNumThreads );
+		}
+	mEvaluator->setExamples( exampleInputs, mExampleSetSize, numInputs );
+	delete [] exampleInputs;
+	
+	
+	mPopulationError = new double[ mPopulationSize ];
+	mPopulationNets = new FeedForwardNeuralNet*[ mPopulationSize ];
+	mPopulationOutputs = new double*[ mPopulationSize ];
+	for( n=0; n<mPopulationSize; n++ ) {
+		mPopulationOutputs[n] = NULL;
+		}
+	mOutputsSize = 0;
+	
+	
+	int result = runRounds( inMaxNumRounds, inMutationProb, 
+							inMaxMutationMagnitude, inOutErrors );
+	
+	
+	for( n=0; n<mPopulationSize; n++ ) {
+		if( mPopulationOutputs[n] != NULL ) {
+			delete [] mPopulationOutputs[n];
+			}
+		}
+	delete [] mPopulationOutputs;
+	delete [] mPopulationNets;
+	delete [] mPopulationError;
+	delete [] mCorrectOutputs;
+	
+	return result;
+	}
+
+
+
+int BreedingDoubleExampleTrainer::runRounds( int inMaxNumRounds, 
+ 	float inMutationProb, float inMaxMutationMagnitude, 
+	float *inOutErrors ) {
+	
+	int errorReturn = -1;
+	
+	int r;
+	int n;
+	
 	// for each round
 	for( r=0; r<inMaxNumRounds; r++ ) {
 		
-		// total error over all examples for each network in the population
-		double *populationError = new double[ mPopulationSize ];
-		
-		// correct output values from each training example
-		double *correctOutputs = new double[ mExampleSetSize ];
-		
-		// for each training example
-		for( e=0; e<mExampleSetSize; e++ ) { 
-			DoubleTrainingExample *example =
-				dynamic_cast < DoubleTrainingExample* >( mExamples[e] );
-			if( example == 0 ) {
-				printf( "Casting a training example to a ");
-				printf( "DoubleTrainingExample failed.\n" );
-				return errorReturn;
-				}
-			
-			correctOutputs[e] = example->getOutput(0);
-			}
+		int maxNumOutputs = 1;
 		
 		// for each network in the population
 		for( n=0; n<mPopulationSize; n++ ) {
 			
-			populationError[n] = 0.0;
-			
-			// note that this repeated casting is inefficient,
-			// but it preserves the abstraction, since we want to always
-			// be working with the array provided by PopulationTrainer
-			
 			// cast the network to a BreedableFeedForwardNeuralNet
 			BreedableFeedForwardNeuralNet *network = 
 				dynamic_cast
@@ -105,88 +155,41 @@ int BreedingDoubleExampleTrainer::train( int inMaxNumRounds,
 				return errorReturn;
 				}
 			
-			// output from this network on each example
-			// note that this only works for single output networks
-			double *individualOutput = new double[ mExampleSetSize ];
+			mPopulationNets[n] = network;
 			
-			// for each training example
-			for( e=0; e<mExampleSetSize; e++ ) {
-				DoubleTrainingExample *example =
-					dynamic_cast < DoubleTrainingExample* >( mExamples[e] );
-				if( example == 0 ) {
-					printf( "Casting a training example to a ");
-					printf( "DoubleTrainingExample failed.\n" );
-					return errorReturn;
-					}
-				
-				int numOutputs = example->getNumOutputs();
-				
-				double *networkOutputs = new double[numOutputs];
-				
-				network->run( example->getInputs(), networkOutputs );
-				
-				// only take first output, since we're only supposed
-				// to work with single-output networks anyway
-				individualOutput[e] = networkOutputs[0];
-				
-			/*	double sumCorrectOutputs = 0;
-				double error = 0;
-				for( int o=0; o<numOutputs; o++ ) {
-					double thisOutput = example->getOutput(o);
-					double thisError = thisOutput - networkOutputs[o];
-					/*if( n== mPopulationSize -1 ) {
-						printf( "Correct output = %f, good network output ",
-							thisOutput );
-						printf( "= %f\n", networkOutputs[o] );
-						}
-					*/
-			/*		if( thisOutput < 0 ) {
-						thisOutput = -thisOutput;
-						}
-					sumCorrectOutputs += thisOutput;
-					
-					if( thisError < 0 ) {
-						thisError = -thisError;
-						}
-					error += thisError;
+			if( network->getNumOutputs() > maxNumOutputs ) {
+				maxNumOutputs = network->getNumOutputs();
+				}
+			}
+		
+		if( maxNumOutputs * mExampleSetSize > mOutputsSize ) {
+			mOutputsSize = maxNumOutputs * mExampleSetSize;
 			
+			for( n=0; n<mPopulationSize; n++ ) {
+				if( mPopulationOutputs[n] != NULL ) {
+					delete [] mPopulationOutputs[n];
 					}
-			*/
-				//printf( "error=%f   ", error );
-				//populationError[n] += error;// / sumCorrectOutputs);
-				
-				delete [] networkOutputs;
+				mPopulationOutputs[n] = new double[ mOutputsSize ];
 				}
-			
+			}
+		
+		// run every network on every example, spread across threads
+		mEvaluator->evaluatePopulation( mPopulationNets, mPopulationSize,
+										mPopulationOutputs );
+		
+		for( n=0; n<mPopulationSize; n++ ) {
 			// now use ErrorEvaluator function to compute the error value
 			// over all training examples for this network in the population
-			populationError[n] = mErrorEvaluator->evaluate( 
-									correctOutputs, individualOutput, mExampleSetSize );
-			/*
-			if( n == mPopulationSize-1 ) {
-				printf( "best network score output:\n" );
-				for( e=0; e<mExampleSetSize; e++ ) {
-					printf( "%f  ", individualOutput[e] );
-					}
-				printf( "\n" );
-				
-				printf( "correct score output:\n" );
-				for( e=0; e<mExampleSetSize; e++ ) {
-					printf( "%f  ", correctOutputs[e] );
-					}
-				printf( "\n" );
-				}
-			*/		
-			delete [] individualOutput;
-				
-			// take average error;
-			// skip for now... total error may be more useful
-			//populationError[n] = populationError[n] / mExampleSetSize;
+			
+			// only take first output, since we're only supposed
+			// to work with single-output networks anyway
+			mPopulationError[n] = mErrorEvaluator->evaluate( 
+				mCorrectOutputs, mPopulationOutputs[n], mExampleSetSize );
 			}
 		
 		// now have total error computed for each member of the population
 		
-		sortPopulation( populationError ); 
+		sortPopulation( mPopulationError ); 
 		
 		Crossbreedable *crossbreedableTopNetwork =
 			dynamic_cast<Crossbreedable *>( mPopulation[0] );
@@ -201,15 +204,15 @@ int BreedingDoubleExampleTrainer::train( int inMaxNumRounds,
 		
 		if( r%10 == 0 ) {
 			printf( "Round %d, top member (generation %d) error = %f\n", 
-				r, generationTop, populationError[0] );
+				r, generationTop, mPopulationError[0] );
 			}
 		
 		// store error for this round into passed-in array
-		inOutErrors[r] = populationError[0];
+		inOutErrors[r] = mPopulationError[0];
 
 		/*printf( "Other errors: " );
 		for( int p=1; p<mPopulationSize; p++ ) {
-			printf( "%f, ", populationError[p] );
+			printf( "%f, ", mPopulationError[p] );
 			}
 		*/	
 		BreedableFeedForwardNeuralNet *toFileTopNetwork =
@@ -229,12 +232,12 @@ int BreedingDoubleExampleTrainer::train( int inMaxNumRounds,
 		*/
 		/*printf( "Round %d, member errors =\n", r );
 		for( n=0; n<mPopulationSize; n++ ) {
-			printf( "%f  ", populationError[n] );
+			printf( "%f  ", mPopulationError[n] );
 			}
 		printf( "\n" );
 		*/
 		//check if requirement has been reached
-		if( populationError[0] <= mTrainingRigor ) {
+		if( mPopulationError[0] <= mTrainingRigor ) {
 			return r;
 			}
 		
@@ -322,9 +325,6 @@ int BreedingDoubleExampleTrainer::train( int inMaxNumRounds,
 			}
 		
 		
-		delete [] populationError;
-		delete [] correctOutputs;
-		
 		}
  	return 0;
  	}
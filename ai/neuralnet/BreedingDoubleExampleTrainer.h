@@ -33,6 +33,7 @@
 #include "ExampleTrainer.h"
 
 #include "DoubleTrainingExample.h"
+#include "BatchNeuralNetEvaluator.h"
 
 #include "minorGems/math/stats/ErrorEvaluator.h"
 
@@ -99,6 +100,18 @@ class BreedingDoubleExampleTrainer
 		 * @param inBestFileName the name or path of the file
 		 */
 		void setBestFileName( char *inBestFileName );
+		
+		
+		/**
+		 * Sets how many worker threads evaluate the population.
+		 *
+		 * Default is one fewer than the number of processors, since the
+		 * calling thread works too.
+		 *
+		 * @param inNumThreads the number of worker threads, or 0 to
+		 *   evaluate on the calling thread only.
+		 */
+		void setNumThreads( int inNumThreads );
 	
 	protected:
 		ErrorEvaluator *mErrorEvaluator;	
@@ -106,6 +119,26 @@ class BreedingDoubleExampleTrainer
 		// name of file in which to save best network in population 
 		// during each round
 		char *mBestFileName;
+		
+		// runs each network over all examples at once
+		// created by the first call to train, so trainers that are never
+		// trained start no threads
+		BatchNeuralNetEvaluator *mEvaluator;
+		// -1 for the evaluator's default
+		int mNumThreads;
+		
+		// working space for train, valid while it runs
+		double *mCorrectOutputs;
+		double *mPopulationError;
+		FeedForwardNeuralNet **mPopulationNets;
+		// one array of outputs for each network, mOutputsSize long
+		double **mPopulationOutputs;
+		int mOutputsSize;
+		
+		// the body of train, run after working space is set up
+		int runRounds( int inMaxNumRounds,
+			float inMutationProb, float inMaxMutationMagnitude,
+			float *inOutErrors );
 	};
 
 inline void BreedingDoubleExampleTrainer::setBestFileName( 
@@ -113,5 +146,16 @@ inline void BreedingDoubleExampleTrainer::setBestFileName(
 	
 	mBestFileName = inBestFileName;
 	}
+
+
+inline void BreedingDoubleExampleTrainer::setNumThreads( int inNumThreads ) {
+	mNumThreads = inNumThreads;
+	
+	// started again at the next train
+	if( mEvaluator != NULL ) {
+		delete mEvaluator;
+		mEvaluator = NULL;
+		}
+	}
 	
 #endif
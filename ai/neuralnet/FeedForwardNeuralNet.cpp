@@ -41,52 +41,63 @@ FeedForwardNeuralNet::FeedForwardNeuralNet( int inNumInputs,
 		}
 	//printf( " neurons per layer.\n" );
 	
+	allocateLayers();
+	
+	// fill in all arrays
+	for( i=0; i<totalNumLayers; i++ ) {
+		for( int j=0; j<mNeuronsPerLayer[i]; j++ ) {
+			mNeuronThresholds[i][j] = StepThreshold::getInstance();
+			mNeuronThresholdValues[i][j] = 0.0;
+			}
+		
+		if( i<totalNumLayers - 1 ) {
+			memset( mLayerWeights[i], 0, 
+				mNeuronsPerLayer[i] * mNeuronsPerLayer[i+1] * sizeof( double ) );
+			}
+		}
+	}
+
+
+
+void FeedForwardNeuralNet::allocateLayers() {
+	int totalNumLayers = mNumHiddenLayers + 2;
+	
 	mNeuronThresholds = new Threshold**[totalNumLayers];
 	mNeuronThresholdValues = new double*[totalNumLayers];
+	mLayerWeights = new double*[totalNumLayers];
 	mWeights = new double**[totalNumLayers];
 	
-	// fill in all arrays
-	for( i=0; i<totalNumLayers; i++ ) {
+	for( int i=0; i<totalNumLayers; i++ ) {
 		mNeuronThresholds[i] = new Threshold*[ mNeuronsPerLayer[i] ];
 		mNeuronThresholdValues[i] = new double[ mNeuronsPerLayer[i] ];
 		mWeights[i] = new double*[ mNeuronsPerLayer[i] ];
 		
-		//  Note that a hot spot in the weight initialization
-		//  was located (setting every weight to 0 in the
-		//  inner-most loop).
-		//  The following code attempts to allocate these
-		//  weights in an efficient manner.
-		
-		// This optimization reduced the execution time of this
-		// constructor from 200ms per call down to 1.43ms per call.
-		// Definitely worth it!
+		// all weights leaving a layer are in one block, so the whole
+		// layer can be run as a matrix product
 		
-		int neuronsNextLayer = 0;
+		// don't create weight arrays that leave the output neurons
 		if( i<totalNumLayers - 1 ) {
-			neuronsNextLayer = mNeuronsPerLayer[i+1];
-			}
-		// these init values should be copied into the
-		// weight arrays for every neuron in this layer
-		double *tempWeights = new double[ neuronsNextLayer ];
-		for( int k=0; k<neuronsNextLayer; k++ ) {
-			tempWeights[k] = 0.0;
+			int neuronsNextLayer = mNeuronsPerLayer[i+1];
+			
+			mLayerWeights[i] = 
+				new double[ mNeuronsPerLayer[i] * neuronsNextLayer ];
+			
+			for( int j=0; j<mNeuronsPerLayer[i]; j++ ) {
+				mWeights[i][j] = &( mLayerWeights[i][ j * neuronsNextLayer ] );
+				}
 			}
+		else {
+			mLayerWeights[i] = NULL;
 			
-		for( int j=0; j<mNeuronsPerLayer[i]; j++ ) {
-			mNeuronThresholds[i][j] = StepThreshold::getInstance();
-			mNeuronThresholdValues[i][j] = 0.0;
-			// don't create weight arrays that leave the output neurons
-			if( i<totalNumLayers - 1 ) {
-				mWeights[i][j] = new double[ neuronsNextLayer ];
-				memcpy( mWeights[i][j], tempWeights, 
-					neuronsNextLayer * sizeof( double ) );
+			for( int j=0; j<mNeuronsPerLayer[i]; j++ ) {
+				mWeights[i][j] = NULL;
 				}
 			}
-		delete [] tempWeights;
 		}
 	}
 
 
+
 FeedForwardNeuralNet::FeedForwardNeuralNet( FILE *inInputFile ) {
 	
 	FILE *inFile = inInputFile;
@@ -97,26 +108,25 @@ FeedForwardNeuralNet::FeedForwardNeuralNet( FILE *inInputFile ) {
 	
 	mNeuronsPerLayer = new int[ totalNumLayers ];
 	
-	mNeuronThresholdValues = new double*[totalNumLayers];
-	mNeuronThresholds = new Threshold**[totalNumLayers];
-	mWeights = new double**[totalNumLayers];
-	
 	int i;
 	int j;
 	int k;
 	// read number of neurons per layer in from file
 	for( i=0; i<totalNumLayers; i++ ) {
 		fscanf( inFile, "%d", &( mNeuronsPerLayer[i] ) );	
-		// setup arrays of thresholds and threshold values
-		mNeuronThresholds[i] = new Threshold*[mNeuronsPerLayer[i]];
-		mNeuronThresholdValues[i] = new double[mNeuronsPerLayer[i]];
-		// setup arrays of weights
-		mWeights[i] = new double*[mNeuronsPerLayer[i]];
 		}
+	
+	allocateLayers();
 
 	mNumInputs = mNeuronsPerLayer[0];
 	mNumOutputs = mNeuronsPerLayer[totalNumLayers-1];
 	
+	// input layer has no thresholds in the file
+	for( j=0; j<mNeuronsPerLayer[0]; j++ ) {
+		mNeuronThresholdValues[0][j] = 0.0;
+		mNeuronThresholds[0][j] = StepThreshold::getInstance();
+		}
+	
 	// read threshold values at each neuron in from file
 	for( i=1; i<totalNumLayers; i++ ) {
 		for( j=0; j<mNeuronsPerLayer[i]; j++ ) {
@@ -129,8 +139,6 @@ FeedForwardNeuralNet::FeedForwardNeuralNet( FILE *inInputFile ) {
 	// read weights in from file
 	for( i=0; i<totalNumLayers-1; i++ ) {
 		for( j=0; j<mNeuronsPerLayer[i]; j++ ) {
-			// setup last tier of weights array
-			mWeights[i][j] = new double[mNeuronsPerLayer[i+1]];
 			for( k=0; k<mNeuronsPerLayer[i+1]; k++ ) {
 				fscanf( inFile, "%lf", &( mWeights[i][j][k] ) );
 				}
@@ -145,10 +153,8 @@ FeedForwardNeuralNet::~FeedForwardNeuralNet() {
 	int totalNumLayers = mNumHiddenLayers + 2;
 	for( int i=0; i<totalNumLayers; i++ ) {
 		// singleton, no need to delete Thresholds		
-		if( i<totalNumLayers - 1 ) {
-			for( int j=0; j<mNeuronsPerLayer[i]; j++ ) {			
-				delete [] mWeights[i][j];
-				}
+		if( mLayerWeights[i] != NULL ) {
+			delete [] mLayerWeights[i];
 			}
 		delete [] mNeuronThresholds[i];
 		delete [] mNeuronThresholdValues[i];
@@ -157,6 +163,7 @@ FeedForwardNeuralNet::~FeedForwardNeuralNet() {
 	
 	delete [] mNeuronThresholds;
 	delete [] mNeuronThresholdValues;
+	delete [] mLayerWeights;
 	delete [] mWeights;
 		
 	delete [] mNeuronsPerLayer;	
@@ -165,94 +172,72 @@ FeedForwardNeuralNet::~FeedForwardNeuralNet() {
 	
 		
 void FeedForwardNeuralNet::run( double *inInputs, double *outOutputs ) {
-	// values at our current layer in the network
-	double *currentValues = new double[ mNeuronsPerLayer[0] ];
-	register int i;
+	int totalNumLayers = mNumHiddenLayers + 2;
+	
+	int maxNeurons = 0;
+	int i;
+	for( i=0; i<totalNumLayers; i++ ) {
+		if( mNeuronsPerLayer[i] > maxNeurons ) {
+			maxNeurons = mNeuronsPerLayer[i];
+			}
+		}
+	
+	// values at our current layer in the network, and at the next layer,
+	// swapped after each layer
+	double *currentValues = new double[ maxNeurons ];
+	double *newValues = new double[ maxNeurons ];
+	
 	memcpy( (void *)currentValues, 
 		(void *)inInputs, mNeuronsPerLayer[0] * sizeof( double ) );
 	
-	for( i=1; i<mNumHiddenLayers + 2; i++ ) {
-		// values at neurons in next layer
-		double *newValues = new double[ mNeuronsPerLayer[i] ];
-		
-		register int numNeuronsThisLayer = mNeuronsPerLayer[i];
+	for( i=1; i<totalNumLayers; i++ ) {
+		int numNeuronsThisLayer = mNeuronsPerLayer[i];
+		int numNeuronsPrevious = mNeuronsPerLayer[i-1];
 		
-		register int j;
+		int j;
 		// first, zero values at all neurons in next layer for base of sum
 		for( j=0; j<numNeuronsThisLayer; j++ ) {
 			newValues[j] = 0.0;
 			}
 		
+		const double *weights = mLayerWeights[i-1];
+		
 		// for each neuron in the previous layer
-		for( int k=0; k<mNeuronsPerLayer[i-1]; k++ ) {
-			
-			register double currentValuePrevious = currentValues[k];
-			double *weightsLeavingPrevious = mWeights[i-1][k];
+		// (BatchNeuralNetEvaluator sums in this same order, so results
+		// match exactly)
+		for( int k=0; k<numNeuronsPrevious; k++ ) {
 			
-			//
-			
-			// OPTIMIZE:
-			// Rolling the loop reduced total running time of this
-			// function from 288ms per call to 174ms per call
+			double currentValuePrevious = currentValues[k];
+			const double *weightsLeavingPrevious = 
+				&( weights[ k * numNeuronsThisLayer ] );
 			
 			// for each neuron in next layer
-			
-			/*
-			for( j=0; j!=numNeuronsThisLayer; j++ ) {
+			for( j=0; j<numNeuronsThisLayer; j++ ) {
 				newValues[j] += weightsLeavingPrevious[j] *
 					currentValuePrevious;
 				}
-			*/
-			
-			// roll loop
-			for( j=5; j<numNeuronsThisLayer; j+=6 ) {
-				register int backj = j-5;
-				newValues[backj] += weightsLeavingPrevious[backj] *
-					currentValuePrevious;
-				backj++;
-				newValues[backj] += weightsLeavingPrevious[backj] *
-					currentValuePrevious;
-				backj++;
-				newValues[backj] += weightsLeavingPrevious[backj] *
-					currentValuePrevious;
-				backj++;
-				newValues[backj] += weightsLeavingPrevious[backj] *
-					currentValuePrevious;
-				backj++;
-				newValues[backj] += weightsLeavingPrevious[backj] *
-					currentValuePrevious;
-				newValues[j] += weightsLeavingPrevious[j] *
-					currentValuePrevious;
-				}
-			// finish remainder
-			int startRemainder = j-6;
-			if( startRemainder < 0 ) {
-				startRemainder = 0;
-				}
-			for( j=startRemainder; j<numNeuronsThisLayer; j++ ) {
-				newValues[j] += weightsLeavingPrevious[j] *
-					currentValuePrevious;
-				}
-			// end rolled loop
-				
 			}
 		
 		// now we have weighted sum at each neuron in this layer...
 		// need to threshold the sum
-		for( j=0; j<mNeuronsPerLayer[i]; j++ ) {
-			newValues[j] = mNeuronThresholds[i][j]->
-				apply( newValues[j], mNeuronThresholdValues[i][j] ); 
-			}
+		Threshold **thresholds = mNeuronThresholds[i];
+		double *thresholdValues = mNeuronThresholdValues[i];
 		
-		delete [] currentValues;
+		for( j=0; j<numNeuronsThisLayer; j++ ) {
+			newValues[j] = thresholds[j]->
+				apply( newValues[j], thresholdValues[j] ); 
+			}
 		
-		currentValues = newValues;	
+		double *temp = currentValues;
+		currentValues = newValues;
+		newValues = temp;
 		}
 		
 	// now copy last set of current values int output array	
 	memcpy( (void *)outOutputs, (void *)currentValues,
 		mNumOutputs * sizeof( double ) );
 	delete [] currentValues;
+	delete [] newValues;
 	}
 
 
@@ -136,6 +136,30 @@ class FeedForwardNeuralNet : public DoubleNeuralNet {
 		 * @return the weight between neurons A and B.
 		 */
 		double getWeight( int inLayerA, int inNeuronA, int inNeuronB );
+		
+		
+		/**
+		 * Gets all weights leaving a layer.
+		 *
+		 * @param inLayerA the layer, where 0 is the input layer.
+		 *
+		 * @return a matrix with one row for each neuron in inLayerA and
+		 *   one column for each neuron in inLayerA+1, stored row by row,
+		 *   so the weight between neurons A and B is at
+		 *   [ A * getNumInLayer( inLayerA + 1 ) + B ].
+		 *   Destroyed by this class.
+		 */
+		double *getLayerWeights( int inLayerA );
+		
+		
+		/**
+		 * Gets the threshold values for all neurons in a layer.
+		 *
+		 * @param inLayer the layer.
+		 *
+		 * @return the threshold values.  Destroyed by this class.
+		 */
+		double *getLayerThresholdValues( int inLayer );
 						
 		
 		/**
@@ -176,9 +200,18 @@ class FeedForwardNeuralNet : public DoubleNeuralNet {
 		Threshold ***mNeuronThresholds;
 		double **mNeuronThresholdValues;
 		
+		// one contiguous matrix per layer, indexed by 
+		// [layerA][ neuronA * neuronsInLayerB + neuronB ]
+		double **mLayerWeights;
+		
 		// indexed by [layerA][neuronA][neuronB]
+		// rows point into mLayerWeights
 		double ***mWeights;
 		
+		
+		// allocates all per-layer arrays once mNeuronsPerLayer is set
+		void allocateLayers();
+		
 	}; 
 
 
@@ -234,4 +267,14 @@ inline double FeedForwardNeuralNet::getWeight( int inLayerA,
 	}
 
 
+inline double *FeedForwardNeuralNet::getLayerWeights( int inLayerA ) {
+	return mLayerWeights[inLayerA];
+	}
+
+
+inline double *FeedForwardNeuralNet::getLayerThresholdValues( int inLayer ) {
+	return mNeuronThresholdValues[inLayer];
+	}
+
+
 #endif
@@ -15,6 +15,8 @@
 
 #include "minorGems/ai/genetic/PopulationSorter.h"
 
+#include <string.h>
+
 /**
  * Abstract superclass for classes that train a population of NeuralNets.
  *
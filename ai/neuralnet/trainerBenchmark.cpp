@@ -0,0 +1,536 @@
+// Checks that BatchNeuralNetEvaluator matches FeedForwardNeuralNet::run
+// exactly and that PopulationSorter orders scores like the old selection
+// sort, then measures generations per second for BreedingDoubleExampleTrainer
+// on the convergenceFinder workload (100 examples, 10 inputs, one hidden
+// layer of 10, population of 100) against a copy of the original
+// generation loop.
+//
+// Usage:  trainerBenchmark [numRounds]
+
+
+#include "BreedingDoubleExampleTrainer.h"
+#include "BreedableFeedForwardNeuralNet.h"
+#include "BatchNeuralNetEvaluator.h"
+#include "DoubleTrainingExample.h"
+#include "IdentityThreshold.h"
+
+#include "minorGems/math/stats/L1ErrorEvaluator.h"
+#include "minorGems/util/random/StdRandomSource.h"
+#include "minorGems/system/Time.h"
+#include "minorGems/system/WorkerPool.h"
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+static int numExamples = 100;
+static int numInputs = 10;
+static int populationSize = 100;
+static int numHiddenLayers = 1;
+
+static float mutationProb = 0.1f;
+static float mutationMagnitude = 0.1f;
+
+
+static int numFailures = 0;
+
+
+static void check( char inCondition, const char *inDescription ) {
+    if( ! inCondition ) {
+        printf( "FAILED:  %s\n", inDescription );
+        numFailures++;
+        }
+    }
+
+
+
+// copy of the original FeedForwardNeuralNet::run, with rows taken from
+// the layer matrices
+// Its unrolled loop added one weight twice when the remainder loop
+// restarted at j-6, kept here so timing is of the original work.
+static void originalRun( FeedForwardNeuralNet *inNet,
+                         double *inInputs, double *outOutputs ) {
+    int numLayers = inNet->getNumHiddenLayers() + 2;
+
+    double *currentValues = new double[ inNet->getNumInLayer( 0 ) ];
+    memcpy( currentValues, inInputs,
+            inNet->getNumInLayer( 0 ) * sizeof( double ) );
+
+    for( int i=1; i<numLayers; i++ ) {
+        int numNeuronsThisLayer = inNet->getNumInLayer( i );
+        double *newValues = new double[ numNeuronsThisLayer ];
+
+        int j;
+        for( j=0; j<numNeuronsThisLayer; j++ ) {
+            newValues[j] = 0.0;
+            }
+
+        for( int k=0; k<inNet->getNumInLayer( i - 1 ); k++ ) {
+            double currentValuePrevious = currentValues[k];
+            double *weightsLeavingPrevious =
+                &( inNet->getLayerWeights( i - 1 )[
+                       k * numNeuronsThisLayer ] );
+
+            for( j=5; j<numNeuronsThisLayer; j+=6 ) {
+                int backj = j-5;
+                newValues[backj] += weightsLeavingPrevious[backj] *
+                    currentValuePrevious;
+                backj++;
+                newValues[backj] += weightsLeavingPrevious[backj] *
+                    currentValuePrevious;
+                backj++;
+                newValues[backj] += weightsLeavingPrevious[backj] *
+                    currentValuePrevious;
+                backj++;
+                newValues[backj] += weightsLeavingPrevious[backj] *
+                    currentValuePrevious;
+                backj++;
+                newValues[backj] += weightsLeavingPrevious[backj] *
+                    currentValuePrevious;
+                newValues[j] += weightsLeavingPrevious[j] *
+                    currentValuePrevious;
+                }
+            int startRemainder = j-6;
+            if( startRemainder < 0 ) {
+                startRemainder = 0;
+                }
+            for( j=startRemainder; j<numNeuronsThisLayer; j++ ) {
+                newValues[j] += weightsLeavingPrevious[j] *
+                    currentValuePrevious;
+                }
+            }
+
+        for( j=0; j<numNeuronsThisLayer; j++ ) {
+            newValues[j] = inNet->getThreshold( i, j )->
+                apply( newValues[j], inNet->getThresholdValue( i, j ) );
+            }
+
+        delete [] currentValues;
+        currentValues = newValues;
+        }
+
+    memcpy( outOutputs, currentValues,
+            inNet->getNumOutputs() * sizeof( double ) );
+    delete [] currentValues;
+    }
+
+
+
+// copy of the original selection sort
+static void originalSort( NeuralNet **inPopulation, double *inScores,
+                          int inPopulationSize ) {
+    for( int t=0; t<inPopulationSize; t++ ) {
+        double best = inScores[t];
+        int bestInd = t;
+
+        for( int u=t+1; u<inPopulationSize; u++ ) {
+            if( inScores[u] < best ) {
+                best = inScores[u];
+                bestInd = u;
+                }
+            }
+
+        if( bestInd != t ) {
+            NeuralNet *temp = inPopulation[bestInd];
+            inPopulation[bestInd] = inPopulation[t];
+            inScores[bestInd] = inScores[t];
+            inPopulation[t] = temp;
+            inScores[t] = best;
+            }
+        }
+    }
+
+
+
+// copy of one round of the original BreedingDoubleExampleTrainer::train
+// returns the top error
+static double originalGeneration( NeuralNet **inPopulation,
+                                  TrainingExample **inExamples,
+                                  ErrorEvaluator *inErrorEvaluator ) {
+
+    double *populationError = new double[ populationSize ];
+    double *correctOutputs = new double[ numExamples ];
+
+    int e;
+    for( e=0; e<numExamples; e++ ) {
+        DoubleTrainingExample *example =
+            dynamic_cast<DoubleTrainingExample*>( inExamples[e] );
+        correctOutputs[e] = example->getOutput( 0 );
+        }
+
+    for( int n=0; n<populationSize; n++ ) {
+        BreedableFeedForwardNeuralNet *network =
+            dynamic_cast<BreedableFeedForwardNeuralNet*>( inPopulation[n] );
+
+        double *individualOutput = new double[ numExamples ];
+
+        for( e=0; e<numExamples; e++ ) {
+            DoubleTrainingExample *example =
+                dynamic_cast<DoubleTrainingExample*>( inExamples[e] );
+
+            double *networkOutputs = new double[ example->getNumOutputs() ];
+
+            originalRun( network, example->getInputs(), networkOutputs );
+
+            individualOutput[e] = networkOutputs[0];
+
+            delete [] networkOutputs;
+            }
+
+        populationError[n] = inErrorEvaluator->evaluate(
+            correctOutputs, individualOutput, numExamples );
+
+        delete [] individualOutput;
+        }
+
+    originalSort( inPopulation, populationError, populationSize );
+
+    double topError = populationError[0];
+
+    int numToBreed =
+        (int)( ( -1 + sqrt( 1 + 8 * populationSize ) ) * 0.5 );
+    int remainder = populationSize -
+        ( numToBreed + ( numToBreed * ( numToBreed + 1 ) ) / 2 );
+    int indNextReplace = numToBreed + remainder;
+
+    for( int a=0; a<numToBreed; a++ ) {
+        for( int b=a+1; b<numToBreed; b++ ) {
+            delete dynamic_cast<BreedableFeedForwardNeuralNet*>(
+                inPopulation[ indNextReplace ] );
+
+            BreedableFeedForwardNeuralNet *network =
+                dynamic_cast<BreedableFeedForwardNeuralNet*>(
+                    inPopulation[a] );
+            BreedableFeedForwardNeuralNet *otherNetwork =
+                dynamic_cast<BreedableFeedForwardNeuralNet*>(
+                    inPopulation[b] );
+
+            inPopulation[ indNextReplace ] = (NeuralNet *)
+                network->crossbreed( otherNetwork, 0.5f, mutationProb,
+                                     mutationMagnitude );
+            indNextReplace++;
+            }
+        }
+
+    delete [] populationError;
+    delete [] correctOutputs;
+
+    return topError;
+    }
+
+
+
+static BreedableFeedForwardNeuralNet **makePopulation(
+    RandomSource *inRandSource, int inHiddenSize ) {
+
+    int *neuronsPerLayer = new int[ numHiddenLayers ];
+    for( int i=0; i<numHiddenLayers; i++ ) {
+        neuronsPerLayer[i] = inHiddenSize;
+        }
+
+    BreedableFeedForwardNeuralNet **population =
+        new BreedableFeedForwardNeuralNet*[ populationSize ];
+
+    for( int i=0; i<populationSize; i++ ) {
+        population[i] = new BreedableFeedForwardNeuralNet(
+            numInputs, numHiddenLayers, neuronsPerLayer, 1, inRandSource );
+        population[i]->mutate( 1.0, 1.0 );
+        population[i]->setCrossbreedingMethod( "forward" );
+        }
+
+    delete [] neuronsPerLayer;
+    return population;
+    }
+
+
+
+static void deletePopulation( BreedableFeedForwardNeuralNet **inPopulation ) {
+    for( int i=0; i<populationSize; i++ ) {
+        delete inPopulation[i];
+        }
+    delete [] inPopulation;
+    }
+
+
+
+static void checkEvaluator( double **inInputs ) {
+    StdRandomSource randSource( 4 );
+
+    // odd hidden size exercises vector remainders
+    BreedableFeedForwardNeuralNet **population =
+        makePopulation( &randSource, 13 );
+
+    // some networks with identity and mixed thresholds
+    for( int j=0; j<13; j++ ) {
+        population[1]->setThreshold( 1, j, IdentityThreshold::getInstance() );
+        }
+    population[2]->setThreshold( 2, 0, IdentityThreshold::getInstance() );
+    population[3]->setThreshold( 1, 5, IdentityThreshold::getInstance() );
+
+    double **expected = new double*[ populationSize ];
+    double **outputs = new double*[ populationSize ];
+
+    for( int n=0; n<populationSize; n++ ) {
+        expected[n] = new double[ numExamples ];
+        outputs[n] = new double[ numExamples ];
+
+        for( int e=0; e<numExamples; e++ ) {
+            population[n]->run( inInputs[e], &( expected[n][e] ) );
+            }
+        }
+
+    int numThreadCounts = 2;
+    int threadCounts[2] = { 0, 3 };
+
+    for( int level=0; level<=2; level++ ) {
+        setForwardPassImplementationLimit( level );
+
+        for( int t=0; t<numThreadCounts; t++ ) {
+            BatchNeuralNetEvaluator evaluator( threadCounts[t] );
+
+            // example counts that aren't a multiple of the vector size
+            for( int numUsed = numExamples - 3; numUsed <= numExamples;
+                 numUsed += 3 ) {
+
+                evaluator.setExamples( inInputs, numUsed, numInputs );
+
+                evaluator.evaluatePopulation(
+                    (FeedForwardNeuralNet **)population, populationSize,
+                    outputs );
+
+                char match = true;
+                for( int n=0; n<populationSize; n++ ) {
+                    for( int e=0; e<numUsed; e++ ) {
+                        if( outputs[n][e] != expected[n][e] ) {
+                            match = false;
+                            }
+                        }
+                    }
+
+                char description[200];
+                sprintf( description,
+                         "batch outputs match run, implementation %d, "
+                         "%d threads, %d examples",
+                         getForwardPassImplementation(), threadCounts[t],
+                         numUsed );
+                check( match, description );
+                }
+            }
+        }
+
+    setForwardPassImplementationLimit( 2 );
+
+    for( int n=0; n<populationSize; n++ ) {
+        delete [] expected[n];
+        delete [] outputs[n];
+        }
+    delete [] expected;
+    delete [] outputs;
+
+    deletePopulation( population );
+    }
+
+
+
+static void checkSorter() {
+    StdRandomSource randSource( 9 );
+
+    int size = 500;
+
+    double *scoresA = new double[ size ];
+    double *scoresB = new double[ size ];
+    NeuralNet **membersA = new NeuralNet*[ size ];
+    NeuralNet **membersB = new NeuralNet*[ size ];
+
+    // only the pairing of members and scores is checked
+    NeuralNet *base = new NeuralNet[ size ];
+
+    for( int i=0; i<size; i++ ) {
+        // many ties
+        scoresA[i] = randSource.getRandomBoundedInt( 0, 50 );
+        scoresB[i] = scoresA[i];
+        membersA[i] = base + i;
+        membersB[i] = base + i;
+        }
+
+    originalSort( membersA, scoresA, size );
+
+    PopulationSorter sorter;
+    sorter.sortPopulation( (PopulationMember **)membersB, scoresB, size );
+
+    char sorted = true;
+    char paired = true;
+    for( int i=0; i<size; i++ ) {
+        if( scoresA[i] != scoresB[i] ) {
+            sorted = false;
+            }
+        if( i > 0 && scoresB[i] == scoresB[i-1] &&
+            membersB[i] < membersB[i-1] ) {
+            // stable
+            sorted = false;
+            }
+        }
+
+    // each member still has its own score
+    StdRandomSource replay( 9 );
+    double *originalScores = new double[ size ];
+    for( int i=0; i<size; i++ ) {
+        originalScores[i] = replay.getRandomBoundedInt( 0, 50 );
+        }
+    for( int i=0; i<size; i++ ) {
+        if( originalScores[ membersB[i] - base ] != scoresB[i] ) {
+            paired = false;
+            }
+        }
+
+    check( sorted, "PopulationSorter order" );
+    check( paired, "PopulationSorter keeps members with scores" );
+
+    // decreasing order
+    sorter.sortPopulation( (PopulationMember **)membersB, scoresB, size,
+                           true );
+    char decreasing = true;
+    for( int i=1; i<size; i++ ) {
+        if( scoresB[i] > scoresB[i-1] ) {
+            decreasing = false;
+            }
+        }
+    check( decreasing, "PopulationSorter decreasing order" );
+
+    delete [] originalScores;
+    delete [] base;
+    delete [] scoresA;
+    delete [] scoresB;
+    delete [] membersA;
+    delete [] membersB;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    int numRounds = 200;
+
+    if( inNumArgs == 2 ) {
+        numRounds = atoi( inArgs[1] );
+        }
+
+
+    // synthetic set in the shape convergenceFinder loads
+    StdRandomSource exampleRandSource( 1 );
+
+    double **inputs = new double*[ numExamples ];
+    double *outputs = new double[ numExamples ];
+    DoubleTrainingExample **examples =
+        new DoubleTrainingExample*[ numExamples ];
+
+    for( int e=0; e<numExamples; e++ ) {
+        inputs[e] = new double[ numInputs ];
+
+        double sum = 0;
+        for( int i=0; i<numInputs; i++ ) {
+            inputs[e][i] = exampleRandSource.getRandomDouble();
+            sum += inputs[e][i] * ( i % 3 );
+            }
+        outputs[e] = ( sum > 5 ) ? 1 : 0;
+
+        examples[e] = new DoubleTrainingExample( inputs[e], &( outputs[e] ),
+                                                 numInputs, 1 );
+        }
+
+
+    checkEvaluator( inputs );
+    checkSorter();
+
+    if( numFailures > 0 ) {
+        printf( "%d checks FAILED\n", numFailures );
+        return 1;
+        }
+    printf( "All evaluator and sorter checks passed\n\n" );
+
+
+    printf( "%d generations, population %d, %d examples, %d-%d-1 nets\n",
+            numRounds, populationSize, numExamples, numInputs, numInputs );
+
+
+    L1ErrorEvaluator errorEvaluator;
+
+    StdRandomSource randSource( 0 );
+    BreedableFeedForwardNeuralNet **population =
+        makePopulation( &randSource, numInputs );
+
+    double startTime = Time::getCurrentTime();
+    double originalTopError = 0;
+    for( int r=0; r<numRounds; r++ ) {
+        originalTopError =
+            originalGeneration( (NeuralNet **)population,
+                                (TrainingExample **)examples,
+                                &errorEvaluator );
+        }
+    double originalTime = Time::getCurrentTime() - startTime;
+
+    printf( "  %-40s %8.1f generations/s  (top error %.0f)\n",
+            "original loop", numRounds / originalTime, originalTopError );
+
+    deletePopulation( population );
+
+
+    int numThreadChoices = 2;
+    int threadChoices[2] = { 0, WorkerPool::getNumProcessors() };
+
+    for( int level=0; level<=2; level++ ) {
+        setForwardPassImplementationLimit( level );
+
+        for( int t=0; t<numThreadChoices; t++ ) {
+            if( t > 0 && threadChoices[t] <= 1 ) {
+                // no extra processors
+                continue;
+                }
+
+            StdRandomSource trainRandSource( 0 );
+            population = makePopulation( &trainRandSource, numInputs );
+
+            BreedingDoubleExampleTrainer trainer;
+            trainer.setNumThreads( threadChoices[t] - 1 > 0 ?
+                                   threadChoices[t] - 1 : 0 );
+            trainer.setPopulation( (NeuralNet **)population, populationSize );
+            trainer.setExamples( (TrainingExample **)examples, numExamples );
+            // never reached, so every round runs
+            trainer.setTrainingRigor( -1 );
+
+            float *roundErrors = new float[ numRounds ];
+
+            startTime = Time::getCurrentTime();
+            trainer.train( numRounds, mutationProb, mutationMagnitude,
+                           roundErrors );
+            double time = Time::getCurrentTime() - startTime;
+
+            char name[100];
+            const char *levelNames[3] = { "portable", "SSE2", "AVX" };
+            sprintf( name, "trainer, %s, %d threads",
+                     levelNames[ getForwardPassImplementation() ],
+                     threadChoices[t] > 0 ? threadChoices[t] : 1 );
+
+            printf( "  %-40s %8.1f generations/s  (top error %.0f)\n",
+                    name, numRounds / time, roundErrors[ numRounds - 1 ] );
+
+            delete [] roundErrors;
+            deletePopulation( population );
+            }
+        }
+
+
+    for( int e=0; e<numExamples; e++ ) {
+        delete examples[e];
+        delete [] inputs[e];
+        }
+    delete [] examples;
+    delete [] inputs;
+    delete [] outputs;
+
+    return 0;
+    }
@@ -39,6 +39,9 @@
 /**
  * Container class for static image statistics functions.
  *
+ * Each region function scans the region's pixels.  For many region
+ * queries on the same image, build an IntegralImage instead.
+ *
  * @author Jason Rohrer
  */ 
 class ImageStatistics {
@@ -279,7 +282,7 @@ class ImageStatistics {
    * @return a new image that is the HSB conversion of the
    *   RGB image.  Must be destroyed by caller.
    */
-  static Image *ImageStatistics::RGBtoHSB( Image *inRGBImage );
+  static Image *RGBtoHSB( Image *inRGBImage );
 								
 };
 				
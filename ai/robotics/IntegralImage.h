@@ -0,0 +1,606 @@
+#ifndef INTEGRAL_IMAGE_INCLUDED
+#define INTEGRAL_IMAGE_INCLUDED
+
+
+#include "ImageRectangle.h"
+
+#include "minorGems/graphics/Image.h"
+#include "minorGems/system/Thread.h"
+
+#include <string.h>
+
+
+
+/**
+ * Summed-area tables for one channel of an image, so that the sum,
+ * mean, and variance of any rectangle can be found with four lookups
+ * instead of a scan.
+ *
+ * Build once per image, then query as many overlapping rectangles as
+ * needed.  Rectangles map to pixels the same way as in ImageStatistics.
+ *
+ * @author Jason Rohrer
+ */
+class IntegralImage {
+
+    public:
+
+
+        /**
+         * Builds tables for an image channel.
+         *
+         * @param inImage the image to analyze.
+         *   Must be destroyed by caller.
+         * @param inChannel the channel of inImage to analyze.
+         * @param inIncludeMask a 1-channel mask, where pixels over 0.5
+         *   are included, as the ignoreMask in
+         *   ImageStatistics::averageValue.  NULL to include all pixels.
+         *   Must be destroyed by caller if not NULL.
+         * @param inNumThreads the number of threads to build with.
+         */
+        IntegralImage( Image *inImage, int inChannel,
+                       Image *inIncludeMask = NULL, int inNumThreads = 1 );
+
+        ~IntegralImage();
+
+
+        /**
+         * Rebuilds the tables for a new image, such as the next frame
+         * from a camera, reusing table memory if the size is unchanged.
+         *
+         * Parameters are as in the constructor.
+         */
+        void setImage( Image *inImage, int inChannel,
+                       Image *inIncludeMask = NULL, int inNumThreads = 1 );
+
+
+        int getWidth();
+
+        int getHeight();
+
+
+        /**
+         * Gets the sum of included pixel values in a region.
+         *
+         * @param inRectangle the region to analyze.
+         *   Must be destroyed by caller.
+         */
+        double getSum( ImageRectangle *inRectangle );
+
+
+        /**
+         * Gets the sum of squared included pixel values in a region.
+         *
+         * @param inRectangle the region to analyze.
+         *   Must be destroyed by caller.
+         */
+        double getSumOfSquares( ImageRectangle *inRectangle );
+
+
+        /**
+         * Gets the number of included pixels in a region.
+         *
+         * @param inRectangle the region to analyze.
+         *   Must be destroyed by caller.
+         */
+        long getCount( ImageRectangle *inRectangle );
+
+
+        /**
+         * Gets the mean of included pixel values in a region.
+         *
+         * @param inRectangle the region to analyze.
+         *   Must be destroyed by caller.
+         *
+         * @return the mean, which matches ImageStatistics::averageValue
+         *   up to rounding.
+         */
+        double getMean( ImageRectangle *inRectangle );
+
+
+        /**
+         * Gets the population variance of included pixel values in
+         * a region.
+         *
+         * @param inRectangle the region to analyze.
+         *   Must be destroyed by caller.
+         *
+         * @return the variance.
+         */
+        double getVariance( ImageRectangle *inRectangle );
+
+
+        /**
+         * Gets statistics for many regions at once.
+         *
+         * @param inRectangles the regions to analyze.
+         *   Array and rectangles must be destroyed by caller.
+         * @param inNumRectangles the number of regions.
+         * @param outMeans array where the mean of each region will be
+         *   returned, or NULL to skip means.
+         *   Must be destroyed by caller if not NULL.
+         * @param outVariances array where the variance of each region
+         *   will be returned, or NULL to skip variances.
+         *   Must be destroyed by caller if not NULL.
+         */
+        void getStatistics( ImageRectangle **inRectangles,
+                            int inNumRectangles,
+                            double *outMeans, double *outVariances );
+
+
+        // tables are ( width + 1 ) x ( height + 1 ), with a zero first
+        // row and column, so that entry ( x, y ) sums all pixels above
+        // and left of pixel ( x, y )
+        static const int SUM = 0;
+        static const int SUM_OF_SQUARES = 1;
+        static const int COUNT = 2;
+
+
+        /**
+         * Gets one of the tables, mostly for testing.
+         *
+         * @param inTable SUM, SUM_OF_SQUARES, or COUNT.
+         *
+         * @return the table, or NULL for COUNT if there is no include
+         *   mask.  Destroyed when this class is destroyed.
+         */
+        double *getTable( int inTable );
+
+
+        // passes over the tables, run on different row or column bands
+        // by each thread.  With inAddRowAbove, a single thread finishes
+        // the tables in one pass, without sumColumns.
+        void sumRows( Image *inImage, int inChannel, Image *inIncludeMask,
+                      int inStartRow, int inEndRow, char inAddRowAbove );
+
+        void sumColumns( int inStartColumn, int inEndColumn );
+
+
+    private:
+
+        int mWidth;
+        int mHeight;
+        int mTableWidth;
+
+        // without a mask, counts are region areas, and there is no
+        // COUNT table
+        int mNumTables;
+        double *mTables[3];
+
+
+        // sets inclusive pixel bounds, returning false if the region
+        // is empty
+        char getBounds( ImageRectangle *inRectangle,
+                        int *outXStart, int *outXEnd,
+                        int *outYStart, int *outYEnd );
+
+        double getRegionSum( int inTable, int inXStart, int inXEnd,
+                             int inYStart, int inYEnd );
+    };
+
+
+
+/**
+ * Thread that runs one pass of an IntegralImage build over a band of
+ * rows or columns.
+ *
+ * @author Jason Rohrer
+ */
+class IntegralImageThread : public Thread {
+
+    public:
+
+        /**
+         * Constructs a thread.
+         *
+         * Note that all parameters must be destroyed by the caller
+         * and that they are not copied by this constructor.
+         *
+         * @param inIntegral the tables to build.
+         * @param inImage the image, or NULL for the column pass.
+         * @param inChannel the channel of inImage.
+         * @param inIncludeMask the include mask, or NULL.
+         * @param inStart the first row or column in the band.
+         * @param inEnd one past the last row or column in the band.
+         */
+        IntegralImageThread( IntegralImage *inIntegral, Image *inImage,
+                             int inChannel, Image *inIncludeMask,
+                             int inStart, int inEnd );
+
+
+        // implements the Thread interface
+        void run();
+
+    private:
+        IntegralImage *mIntegral;
+        Image *mImage;
+        int mChannel;
+        Image *mIncludeMask;
+        int mStart;
+        int mEnd;
+    };
+
+
+
+inline IntegralImageThread::IntegralImageThread(
+    IntegralImage *inIntegral, Image *inImage, int inChannel,
+    Image *inIncludeMask, int inStart, int inEnd )
+    : mIntegral( inIntegral ), mImage( inImage ), mChannel( inChannel ),
+      mIncludeMask( inIncludeMask ), mStart( inStart ), mEnd( inEnd ) {
+
+    }
+
+
+
+inline void IntegralImageThread::run() {
+    if( mImage != NULL ) {
+        mIntegral->sumRows( mImage, mChannel, mIncludeMask, mStart, mEnd,
+                            false );
+        }
+    else {
+        mIntegral->sumColumns( mStart, mEnd );
+        }
+    }
+
+
+
+inline IntegralImage::IntegralImage( Image *inImage, int inChannel,
+                                     Image *inIncludeMask,
+                                     int inNumThreads )
+    : mWidth( 0 ), mHeight( 0 ), mTableWidth( 0 ), mNumTables( 0 ) {
+
+    for( int t=0; t<3; t++ ) {
+        mTables[t] = NULL;
+        }
+
+    setImage( inImage, inChannel, inIncludeMask, inNumThreads );
+    }
+
+
+
+inline IntegralImage::~IntegralImage() {
+    for( int t=0; t<3; t++ ) {
+        if( mTables[t] != NULL ) {
+            delete [] mTables[t];
+            }
+        }
+    }
+
+
+
+inline void IntegralImage::setImage( Image *inImage, int inChannel,
+                                     Image *inIncludeMask,
+                                     int inNumThreads ) {
+    int numTables = 2;
+    if( inIncludeMask != NULL ) {
+        numTables = 3;
+        }
+
+    if( inImage->getWidth() != mWidth || inImage->getHeight() != mHeight ||
+        numTables != mNumTables ) {
+
+        mWidth = inImage->getWidth();
+        mHeight = inImage->getHeight();
+        mTableWidth = mWidth + 1;
+        mNumTables = numTables;
+
+        int tableSize = mTableWidth * ( mHeight + 1 );
+
+        for( int t=0; t<3; t++ ) {
+            if( mTables[t] != NULL ) {
+                delete [] mTables[t];
+                mTables[t] = NULL;
+                }
+            if( t < mNumTables ) {
+                mTables[t] = new double[ tableSize ];
+
+                // first row stays zero, and sumRows fills the rest
+                memset( mTables[t], 0, mTableWidth * sizeof( double ) );
+                }
+            }
+        }
+
+    if( inNumThreads < 1 ) {
+        inNumThreads = 1;
+        }
+
+    if( inNumThreads == 1 ) {
+        sumRows( inImage, inChannel, inIncludeMask, 0, mHeight, true );
+        return;
+        }
+
+    // prefix sums along each row band, then add each row into the next
+    // in each column band
+    IntegralImageThread **threads = new IntegralImageThread*[ inNumThreads ];
+
+    for( int pass=0; pass<2; pass++ ) {
+        int numLines = mHeight;
+        Image *image = inImage;
+        if( pass == 1 ) {
+            numLines = mTableWidth;
+            image = NULL;
+            }
+
+        for( int t=0; t<inNumThreads; t++ ) {
+            threads[t] = new IntegralImageThread(
+                this, image, inChannel, inIncludeMask,
+                ( t * numLines ) / inNumThreads,
+                ( ( t + 1 ) * numLines ) / inNumThreads );
+            threads[t]->start();
+            }
+        for( int t=0; t<inNumThreads; t++ ) {
+            threads[t]->join();
+            delete threads[t];
+            }
+        }
+
+    delete [] threads;
+    }
+
+
+
+inline int IntegralImage::getWidth() {
+    return mWidth;
+    }
+
+
+
+inline int IntegralImage::getHeight() {
+    return mHeight;
+    }
+
+
+
+inline double *IntegralImage::getTable( int inTable ) {
+    return mTables[ inTable ];
+    }
+
+
+
+inline void IntegralImage::sumRows( Image *inImage, int inChannel,
+                                    Image *inIncludeMask,
+                                    int inStartRow, int inEndRow,
+                                    char inAddRowAbove ) {
+
+    double *channel = inImage->getChannel( inChannel );
+    double *maskChannel = NULL;
+    if( inIncludeMask != NULL ) {
+        maskChannel = inIncludeMask->getChannel( 0 );
+        }
+
+    for( int y=inStartRow; y<inEndRow; y++ ) {
+        double *pixels = &( channel[ y * mWidth ] );
+
+        // table row y + 1 holds pixel row y, and row 0 is all zero
+        double *sumRow = &( mTables[ SUM ][ ( y + 1 ) * mTableWidth ] );
+        double *squareRow =
+            &( mTables[ SUM_OF_SQUARES ][ ( y + 1 ) * mTableWidth ] );
+
+        sumRow[0] = 0;
+        squareRow[0] = 0;
+
+        double sum = 0;
+        double sumOfSquares = 0;
+
+        if( maskChannel == NULL ) {
+            if( inAddRowAbove ) {
+                double *sumAbove = &( sumRow[ -mTableWidth ] );
+                double *squareAbove = &( squareRow[ -mTableWidth ] );
+
+                for( int x=0; x<mWidth; x++ ) {
+                    double value = pixels[x];
+                    sum += value;
+                    sumOfSquares += value * value;
+                    sumRow[ x + 1 ] = sumAbove[ x + 1 ] + sum;
+                    squareRow[ x + 1 ] = squareAbove[ x + 1 ] + sumOfSquares;
+                    }
+                }
+            else {
+                for( int x=0; x<mWidth; x++ ) {
+                    double value = pixels[x];
+                    sum += value;
+                    sumOfSquares += value * value;
+                    sumRow[ x + 1 ] = sum;
+                    squareRow[ x + 1 ] = sumOfSquares;
+                    }
+                }
+            }
+        else {
+            double *includes = &( maskChannel[ y * mWidth ] );
+            double *countRow = &( mTables[ COUNT ][ ( y + 1 ) * mTableWidth ] );
+            countRow[0] = 0;
+
+            double count = 0;
+
+            for( int x=0; x<mWidth; x++ ) {
+                if( includes[x] > 0.5 ) {
+                    double value = pixels[x];
+                    sum += value;
+                    sumOfSquares += value * value;
+                    count += 1;
+                    }
+                sumRow[ x + 1 ] = sum;
+                squareRow[ x + 1 ] = sumOfSquares;
+                countRow[ x + 1 ] = count;
+                }
+
+            if( inAddRowAbove ) {
+                for( int x=1; x<mTableWidth; x++ ) {
+                    sumRow[x] += sumRow[ x - mTableWidth ];
+                    squareRow[x] += squareRow[ x - mTableWidth ];
+                    countRow[x] += countRow[ x - mTableWidth ];
+                    }
+                }
+            }
+        }
+    }
+
+
+
+inline void IntegralImage::sumColumns( int inStartColumn, int inEndColumn ) {
+    for( int t=0; t<mNumTables; t++ ) {
+        double *table = mTables[t];
+
+        for( int y=2; y<=mHeight; y++ ) {
+            double *row = &( table[ y * mTableWidth ] );
+            double *rowAbove = &( table[ ( y - 1 ) * mTableWidth ] );
+
+            for( int x=inStartColumn; x<inEndColumn; x++ ) {
+                row[x] += rowAbove[x];
+                }
+            }
+        }
+    }
+
+
+
+inline char IntegralImage::getBounds( ImageRectangle *inRectangle,
+                                      int *outXStart, int *outXEnd,
+                                      int *outYStart, int *outYEnd ) {
+    int xStart = (int)( mWidth * inRectangle->mXStart );
+    int xEnd = (int)( ( mWidth * inRectangle->mXEnd ) - 1 );
+
+    int yStart = (int)( mHeight * inRectangle->mYStart );
+    int yEnd = (int)( ( mHeight * inRectangle->mYEnd ) - 1 );
+
+    // keep lookups inside the tables
+    if( xStart < 0 ) {
+        xStart = 0;
+        }
+    if( yStart < 0 ) {
+        yStart = 0;
+        }
+    if( xEnd > mWidth - 1 ) {
+        xEnd = mWidth - 1;
+        }
+    if( yEnd > mHeight - 1 ) {
+        yEnd = mHeight - 1;
+        }
+
+    *outXStart = xStart;
+    *outXEnd = xEnd;
+    *outYStart = yStart;
+    *outYEnd = yEnd;
+
+    return ( xStart <= xEnd && yStart <= yEnd );
+    }
+
+
+
+inline double IntegralImage::getRegionSum( int inTable,
+                                           int inXStart, int inXEnd,
+                                           int inYStart, int inYEnd ) {
+    double *table = mTables[ inTable ];
+
+    double *topRow = &( table[ inYStart * mTableWidth ] );
+    double *bottomRow = &( table[ ( inYEnd + 1 ) * mTableWidth ] );
+
+    return ( bottomRow[ inXEnd + 1 ] - bottomRow[ inXStart ] ) -
+        ( topRow[ inXEnd + 1 ] - topRow[ inXStart ] );
+    }
+
+
+
+inline double IntegralImage::getSum( ImageRectangle *inRectangle ) {
+    int xStart, xEnd, yStart, yEnd;
+    if( !getBounds( inRectangle, &xStart, &xEnd, &yStart, &yEnd ) ) {
+        return 0;
+        }
+    return getRegionSum( SUM, xStart, xEnd, yStart, yEnd );
+    }
+
+
+
+inline double IntegralImage::getSumOfSquares( ImageRectangle *inRectangle ) {
+    int xStart, xEnd, yStart, yEnd;
+    if( !getBounds( inRectangle, &xStart, &xEnd, &yStart, &yEnd ) ) {
+        return 0;
+        }
+    return getRegionSum( SUM_OF_SQUARES, xStart, xEnd, yStart, yEnd );
+    }
+
+
+
+inline long IntegralImage::getCount( ImageRectangle *inRectangle ) {
+    int xStart, xEnd, yStart, yEnd;
+    if( !getBounds( inRectangle, &xStart, &xEnd, &yStart, &yEnd ) ) {
+        return 0;
+        }
+    if( mNumTables < 3 ) {
+        return (long)( xEnd - xStart + 1 ) * ( yEnd - yStart + 1 );
+        }
+    return (long)getRegionSum( COUNT, xStart, xEnd, yStart, yEnd );
+    }
+
+
+
+inline double IntegralImage::getMean( ImageRectangle *inRectangle ) {
+    double mean;
+    getStatistics( &inRectangle, 1, &mean, NULL );
+    return mean;
+    }
+
+
+
+inline double IntegralImage::getVariance( ImageRectangle *inRectangle ) {
+    double variance;
+    getStatistics( &inRectangle, 1, NULL, &variance );
+    return variance;
+    }
+
+
+
+inline void IntegralImage::getStatistics( ImageRectangle **inRectangles,
+                                          int inNumRectangles,
+                                          double *outMeans,
+                                          double *outVariances ) {
+    for( int r=0; r<inNumRectangles; r++ ) {
+        int xStart, xEnd, yStart, yEnd;
+
+        double sum = 0;
+        double count = 0;
+        double sumOfSquares = 0;
+
+        if( getBounds( inRectangles[r], &xStart, &xEnd, &yStart, &yEnd ) ) {
+            sum = getRegionSum( SUM, xStart, xEnd, yStart, yEnd );
+            if( mNumTables < 3 ) {
+                count = (double)( xEnd - xStart + 1 ) * ( yEnd - yStart + 1 );
+                }
+            else {
+                count = getRegionSum( COUNT, xStart, xEnd, yStart, yEnd );
+                }
+
+            if( outVariances != NULL ) {
+                sumOfSquares = getRegionSum( SUM_OF_SQUARES,
+                                             xStart, xEnd, yStart, yEnd );
+                }
+
+            // differences of sums can leave rounding crumbs where
+            // the mask excludes everything
+            if( count == 0 ) {
+                sum = 0;
+                sumOfSquares = 0;
+                }
+            }
+
+        // empty regions give NaN, as in ImageStatistics::averageValue
+        double mean = sum / count;
+
+        if( outMeans != NULL ) {
+            outMeans[r] = mean;
+            }
+        if( outVariances != NULL ) {
+            double variance = sumOfSquares / count - mean * mean;
+
+            // differences of large sums can dip just below zero
+            if( variance < 0 ) {
+                variance = 0;
+                }
+            outVariances[r] = variance;
+            }
+        }
+    }
+
+
+
+#endif
@@ -0,0 +1,486 @@
+// Checks IntegralImage region statistics against the ImageStatistics
+// scans, then measures region queries per second and the time to pick
+// a move from a sweep of overlapping regions each way.
+//
+// Usage:  integralImageBenchmark
+
+
+#include "IntegralImage.h"
+#include "ImageStatistics.h"
+
+#include "minorGems/util/random/XoshiroRandomSource.h"
+#include "minorGems/system/Time.h"
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+int failures = 0;
+
+
+void check( char inPassed, const char *inWhat ) {
+    if( !inPassed ) {
+        printf( "FAILED:  %s\n", inWhat );
+        failures++;
+        }
+    }
+
+
+
+// empty regions give NaN both ways
+char same( double inA, double inB ) {
+    if( isnan( inA ) || isnan( inB ) ) {
+        return isnan( inA ) && isnan( inB );
+        }
+    return inA == inB;
+    }
+
+
+
+char close( double inA, double inB ) {
+    if( isnan( inA ) || isnan( inB ) ) {
+        return isnan( inA ) && isnan( inB );
+        }
+    return fabs( inA - inB ) <= 1e-9 * ( 1 + fabs( inB ) );
+    }
+
+
+
+// smooth gradients plus noise, like a depth map
+Image *makeImage( int inWidth, int inHeight, RandomSource *inRandSource ) {
+    Image *image = new Image( inWidth, inHeight, 1 );
+    double *channel = image->getChannel( 0 );
+
+    for( int y=0; y<inHeight; y++ ) {
+        for( int x=0; x<inWidth; x++ ) {
+            double value = 0.5 +
+                0.25 * sin( x * 0.05 ) * cos( y * 0.03 ) +
+                inRandSource->getRandomBoundedDouble( -0.2, 0.2 );
+            channel[ y * inWidth + x ] = value;
+            }
+        }
+    return image;
+    }
+
+
+
+Image *makeMask( int inWidth, int inHeight, double inValue ) {
+    Image *mask = new Image( inWidth, inHeight, 1 );
+    double *channel = mask->getChannel( 0 );
+
+    for( int i=0; i<inWidth * inHeight; i++ ) {
+        channel[i] = inValue;
+        }
+    return mask;
+    }
+
+
+
+ImageRectangle *makeRectangle( RandomSource *inRandSource ) {
+    double x1 = inRandSource->getRandomDouble();
+    double x2 = inRandSource->getRandomDouble();
+    double y1 = inRandSource->getRandomDouble();
+    double y2 = inRandSource->getRandomDouble();
+
+    if( x1 > x2 ) {
+        double temp = x1;
+        x1 = x2;
+        x2 = temp;
+        }
+    if( y1 > y2 ) {
+        double temp = y1;
+        y1 = y2;
+        y2 = temp;
+        }
+    return new ImageRectangle( x1, x2, y1, y2 );
+    }
+
+
+
+double scanVariance( Image *inImage, ImageRectangle *inRectangle ) {
+    int w = inImage->getWidth();
+    int h = inImage->getHeight();
+    double *channel = inImage->getChannel( 0 );
+
+    int xStart = (int)( w * inRectangle->mXStart );
+    int xEnd = (int)( ( w * inRectangle->mXEnd ) - 1 );
+    int yStart = (int)( h * inRectangle->mYStart );
+    int yEnd = (int)( ( h * inRectangle->mYEnd ) - 1 );
+
+    double sum = 0;
+    long count = 0;
+    for( int y=yStart; y<=yEnd; y++ ) {
+        for( int x=xStart; x<=xEnd; x++ ) {
+            sum += channel[ y * w + x ];
+            count++;
+            }
+        }
+    double mean = sum / count;
+
+    double sumOfSquares = 0;
+    for( int y=yStart; y<=yEnd; y++ ) {
+        for( int x=xStart; x<=xEnd; x++ ) {
+            double d = channel[ y * w + x ] - mean;
+            sumOfSquares += d * d;
+            }
+        }
+    return sumOfSquares / count;
+    }
+
+
+
+void checkImage( int inWidth, int inHeight, RandomSource *inRandSource ) {
+    Image *image = makeImage( inWidth, inHeight, inRandSource );
+    Image *allOnesMask = makeMask( inWidth, inHeight, 1 );
+
+    Image *mask = makeMask( inWidth, inHeight, 0 );
+    double *maskChannel = mask->getChannel( 0 );
+    for( int i=0; i<inWidth * inHeight; i++ ) {
+        if( inRandSource->getRandomBoolean() ) {
+            maskChannel[i] = 1;
+            }
+        }
+
+    // 1 if over a threshold, for counting
+    double threshold = 0.6;
+    Image *overImage = makeMask( inWidth, inHeight, 0 );
+    double *overChannel = overImage->getChannel( 0 );
+    double *channel = image->getChannel( 0 );
+    for( int i=0; i<inWidth * inHeight; i++ ) {
+        if( channel[i] > threshold ) {
+            overChannel[i] = 1;
+            }
+        }
+
+    IntegralImage integral( image, 0 );
+    IntegralImage maskedIntegral( image, 0, mask );
+    IntegralImage overIntegral( overImage, 0 );
+
+    int numRectangles = 300;
+    ImageRectangle **rectangles = new ImageRectangle*[ numRectangles ];
+    for( int r=0; r<numRectangles; r++ ) {
+        rectangles[r] = makeRectangle( inRandSource );
+        }
+    // whole image, a single pixel, and an empty region
+    rectangles[0]->mXStart = 0;
+    rectangles[0]->mXEnd = 1;
+    rectangles[0]->mYStart = 0;
+    rectangles[0]->mYEnd = 1;
+    rectangles[1]->mXStart = 0.5;
+    rectangles[1]->mXEnd = ( (int)( 0.5 * inWidth ) + 1.5 ) / inWidth;
+    rectangles[1]->mYStart = 0.5;
+    rectangles[1]->mYEnd = ( (int)( 0.5 * inHeight ) + 1.5 ) / inHeight;
+    rectangles[2]->mXEnd = rectangles[2]->mXStart;
+
+    double *means = new double[ numRectangles ];
+    double *variances = new double[ numRectangles ];
+    integral.getStatistics( rectangles, numRectangles, means, variances );
+
+    char meansMatch = true;
+    char maskedMeansMatch = true;
+    char variancesMatch = true;
+    char fractionsMatch = true;
+    char singlesMatch = true;
+
+    for( int r=0; r<numRectangles; r++ ) {
+        double scanMean = ImageStatistics::averageValue(
+            image, 0, rectangles[r], allOnesMask );
+
+        if( !close( means[r], scanMean ) ) {
+            meansMatch = false;
+            }
+        if( !close( maskedIntegral.getMean( rectangles[r] ),
+                    ImageStatistics::averageValue( image, 0, rectangles[r],
+                                                   mask ) ) ) {
+            maskedMeansMatch = false;
+            }
+
+        // the sum of squares minus the squared sum loses a few digits
+        double scanned = scanVariance( image, rectangles[r] );
+        if( !same( variances[r], scanned ) &&
+            !( fabs( variances[r] - scanned ) <= 1e-9 ) ) {
+            variancesMatch = false;
+            }
+
+        // counts are exact
+        if( !same( overIntegral.getMean( rectangles[r] ),
+                   ImageStatistics::fractionOverThreshold(
+                       image, 0, rectangles[r], threshold ) ) ) {
+            fractionsMatch = false;
+            }
+
+        if( !same( integral.getMean( rectangles[r] ), means[r] ) ||
+            !same( integral.getVariance( rectangles[r] ), variances[r] ) ) {
+            singlesMatch = false;
+            }
+        }
+
+    char what[100];
+    sprintf( what, "means, %dx%d", inWidth, inHeight );
+    check( meansMatch, what );
+    sprintf( what, "masked means, %dx%d", inWidth, inHeight );
+    check( maskedMeansMatch, what );
+    sprintf( what, "variances, %dx%d", inWidth, inHeight );
+    check( variancesMatch, what );
+    sprintf( what, "fractions over threshold, %dx%d", inWidth, inHeight );
+    check( fractionsMatch, what );
+    sprintf( what, "single queries, %dx%d", inWidth, inHeight );
+    check( singlesMatch, what );
+    check( isnan( means[2] ) && integral.getCount( rectangles[2] ) == 0 &&
+           maskedIntegral.getCount( rectangles[2] ) == 0,
+           "empty region" );
+    check( integral.getCount( rectangles[1] ) == 1, "single pixel" );
+
+
+    // every thread count adds in the same order, with or without a
+    // mask, and tables can be rebuilt in place
+    int tableSize = ( inWidth + 1 ) * ( inHeight + 1 );
+    int threadCounts[3] = { 2, 3, 7 };
+    IntegralImage rebuilt( overImage, 0 );
+    for( int t=0; t<3; t++ ) {
+        IntegralImage threaded( image, 0, mask, threadCounts[t] );
+        rebuilt.setImage( image, 0, NULL, threadCounts[t] );
+
+        char tablesMatch = true;
+        for( int table=0; table<3; table++ ) {
+            if( memcmp( threaded.getTable( table ),
+                        maskedIntegral.getTable( table ),
+                        tableSize * sizeof( double ) ) != 0 ) {
+                tablesMatch = false;
+                }
+            }
+        for( int table=0; table<2; table++ ) {
+            if( memcmp( rebuilt.getTable( table ),
+                        integral.getTable( table ),
+                        tableSize * sizeof( double ) ) != 0 ) {
+                tablesMatch = false;
+                }
+            }
+        sprintf( what, "%d threads, %dx%d", threadCounts[t],
+                 inWidth, inHeight );
+        check( tablesMatch, what );
+        }
+
+
+    for( int r=0; r<numRectangles; r++ ) {
+        delete rectangles[r];
+        }
+    delete [] rectangles;
+    delete [] means;
+    delete [] variances;
+    delete image;
+    delete allOnesMask;
+    delete mask;
+    delete overImage;
+    }
+
+
+
+// Candidate openings for a move, as in RohrerMoveGenerator but swept
+// across the image:  windows a third of the image wide at 49 offsets
+// and 3 heights.
+int makeSweep( ImageRectangle ***outRectangles ) {
+    int numOffsets = 49;
+    int numHeights = 3;
+    double tops[3] = { 0.1, 0.15, 0.2 };
+
+    ImageRectangle **rectangles =
+        new ImageRectangle*[ numOffsets * numHeights ];
+
+    for( int h=0; h<numHeights; h++ ) {
+        for( int o=0; o<numOffsets; o++ ) {
+            double x = o * ( 2.0 / 3.0 ) / ( numOffsets - 1 );
+            rectangles[ h * numOffsets + o ] =
+                new ImageRectangle( x, x + 1.0 / 3.0, tops[h], 0.5 );
+            }
+        }
+
+    *outRectangles = rectangles;
+    return numOffsets * numHeights;
+    }
+
+
+
+// picks the window with the most depth, returning its index
+int pickByScanning( Image *inImage, Image *inAllOnesMask,
+                    ImageRectangle **inRectangles, int inNumRectangles ) {
+    int best = 0;
+    double bestMean = 2;
+    for( int r=0; r<inNumRectangles; r++ ) {
+        double mean = ImageStatistics::averageValue( inImage, 0,
+                                                     inRectangles[r],
+                                                     inAllOnesMask );
+        if( mean < bestMean ) {
+            bestMean = mean;
+            best = r;
+            }
+        }
+    return best;
+    }
+
+
+
+// tables are rebuilt for each frame
+int pickByIntegral( Image *inImage, IntegralImage *inIntegral,
+                    ImageRectangle **inRectangles, int inNumRectangles,
+                    double *inMeans ) {
+    inIntegral->setImage( inImage, 0 );
+    inIntegral->getStatistics( inRectangles, inNumRectangles, inMeans,
+                               NULL );
+
+    int best = 0;
+    for( int r=1; r<inNumRectangles; r++ ) {
+        if( inMeans[r] < inMeans[ best ] ) {
+            best = r;
+            }
+        }
+    return best;
+    }
+
+
+
+int main() {
+    XoshiroRandomSource randSource( 12345 );
+
+    // small, odd, and camera-sized images
+    checkImage( 17, 9, &randSource );
+    checkImage( 101, 77, &randSource );
+    checkImage( 320, 240, &randSource );
+
+    if( failures == 0 ) {
+        printf( "All region statistics match ImageStatistics\n" );
+        }
+
+
+    int sizes[2][2] = { { 320, 240 }, { 1280, 960 } };
+
+    for( int s=0; s<2; s++ ) {
+        int w = sizes[s][0];
+        int h = sizes[s][1];
+
+        printf( "\n%dx%d image:\n", w, h );
+
+        Image *image = makeImage( w, h, &randSource );
+        Image *allOnesMask = makeMask( w, h, 1 );
+
+        int numRectangles = 1000;
+        ImageRectangle **rectangles = new ImageRectangle*[ numRectangles ];
+        for( int r=0; r<numRectangles; r++ ) {
+            rectangles[r] = makeRectangle( &randSource );
+            }
+        double *means = new double[ numRectangles ];
+
+
+        // random region queries
+        int numQueries = 0;
+        double startTime = Time::getCurrentTime();
+        double time = 0;
+        while( numQueries < 100 || time < 0.5 ) {
+            means[0] = ImageStatistics::averageValue(
+                image, 0, rectangles[ numQueries % numRectangles ],
+                allOnesMask );
+            numQueries++;
+            time = Time::getCurrentTime() - startTime;
+            }
+        double scanRate = numQueries / time;
+
+        IntegralImage integral( image, 0 );
+        int numBatches = 0;
+        startTime = Time::getCurrentTime();
+        time = 0;
+        while( numBatches < 10 || time < 0.5 ) {
+            integral.getStatistics( rectangles, numRectangles, means, NULL );
+            numBatches++;
+            time = Time::getCurrentTime() - startTime;
+            }
+        double tableRate = (double)numBatches * numRectangles / time;
+
+        printf( "  region means per second:\n" );
+        printf( "    %-24s %14.0f  (%.2fx)\n", "scanning", scanRate, 1.0 );
+        printf( "    %-24s %14.0f  (%.2fx)\n", "integral image",
+                tableRate, tableRate / scanRate );
+
+
+        // building new tables
+        printf( "  table builds, ms:\n" );
+        int threadCounts[3] = { 1, 2, 4 };
+        for( int t=0; t<3; t++ ) {
+            int numBuilds = 0;
+            startTime = Time::getCurrentTime();
+            time = 0;
+            while( numBuilds < 5 || time < 0.5 ) {
+                IntegralImage built( image, 0, NULL, threadCounts[t] );
+                numBuilds++;
+                time = Time::getCurrentTime() - startTime;
+                }
+            char name[50];
+            sprintf( name, "%d thread%s", threadCounts[t],
+                     ( threadCounts[t] == 1 ) ? "" : "s" );
+            printf( "    %-24s %14.3f\n", name, 1000 * time / numBuilds );
+            }
+
+
+        // picking a move from a sweep of windows, per frame
+        ImageRectangle **sweep;
+        int numWindows = makeSweep( &sweep );
+        double *sweepMeans = new double[ numWindows ];
+
+        int numFrames = 0;
+        int scanPick = 0;
+        startTime = Time::getCurrentTime();
+        time = 0;
+        while( numFrames < 3 || time < 0.5 ) {
+            scanPick = pickByScanning( image, allOnesMask, sweep,
+                                       numWindows );
+            numFrames++;
+            time = Time::getCurrentTime() - startTime;
+            }
+        double scanLatency = time / numFrames;
+
+        numFrames = 0;
+        int tablePick = 0;
+        startTime = Time::getCurrentTime();
+        time = 0;
+        while( numFrames < 3 || time < 0.5 ) {
+            tablePick = pickByIntegral( image, &integral, sweep, numWindows,
+                                        sweepMeans );
+            numFrames++;
+            time = Time::getCurrentTime() - startTime;
+            }
+        double tableLatency = time / numFrames;
+
+        check( scanPick == tablePick, "picked move" );
+
+        printf( "  move from %d windows, ms per frame:\n", numWindows );
+        printf( "    %-24s %14.3f  (%.2fx)\n", "scanning",
+                1000 * scanLatency, 1.0 );
+        printf( "    %-24s %14.3f  (%.2fx)\n", "integral image",
+                1000 * tableLatency, scanLatency / tableLatency );
+
+
+        for( int r=0; r<numWindows; r++ ) {
+            delete sweep[r];
+            }
+        delete [] sweep;
+        delete [] sweepMeans;
+
+        for( int r=0; r<numRectangles; r++ ) {
+            delete rectangles[r];
+            }
+        delete [] rectangles;
+        delete [] means;
+        delete image;
+        delete allOnesMask;
+        }
+
+
+    if( failures > 0 ) {
+        printf( "%d checks FAILED\n", failures );
+        return 1;
+        }
+    return 0;
+    }
@@ -1,5 +1,7 @@
 #include "cryptoRandom.h"
 
+#include <string.h>
+
 
 
 
@@ -9,18 +11,18 @@
 #include <windows.h>
 #include <wincrypt.h>
 
-char getCryptoRandomBytes( unsigned char *outBytes, int inNumBytes ) {
-    
+char getSystemRandomBytes( unsigned char *outBytes, int inNumBytes ) {
+
     HCRYPTPROV hCryptProv;
-    
+
     char result =
-        CryptAcquireContext( &hCryptProv, NULL, NULL, PROV_RSA_FULL, 
+        CryptAcquireContext( &hCryptProv, NULL, NULL, PROV_RSA_FULL,
                              CRYPT_VERIFYCONTEXT );
-    
+
     if( !result ) {
         return false;
         }
-    
+
 
     result = CryptGenRandom( hCryptProv, inNumBytes, outBytes );
 
@@ -35,24 +37,358 @@ char getCryptoRandomBytes( unsigned char *outBytes, int inNumBytes ) {
 #else
 // general case:  most unix-like systems, including GNU/Linux and MacOSX,
 // provide /dev/urandom
+// GNU/Linux also has the getrandom system call, which needs no file
+// descriptor
 
-#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
-char getCryptoRandomBytes( unsigned char *outBytes, int inNumBytes ) {
 
-    FILE *urandomFile = fopen( "/dev/urandom", "rb" );
-    
-    if( urandomFile == NULL ) {
+char getSystemRandomBytes( unsigned char *outBytes, int inNumBytes ) {
+
+    int numDone = 0;
+
+#ifdef SYS_getrandom
+    while( numDone < inNumBytes ) {
+        long numRead = syscall( SYS_getrandom, &( outBytes[ numDone ] ),
+                                inNumBytes - numDone, 0 );
+        if( numRead < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+                }
+            // kernel too old, fall back to /dev/urandom
+            break;
+            }
+        numDone += numRead;
+        }
+
+    if( numDone == inNumBytes ) {
+        return true;
+        }
+#endif
+
+    int urandomFile = open( "/dev/urandom", O_RDONLY );
+
+    if( urandomFile == -1 ) {
         return false;
         }
-    
-    int numRead = fread( outBytes, 1, inNumBytes, urandomFile );
 
-    fclose( urandomFile );
-    
+    while( numDone < inNumBytes ) {
+        long numRead = read( urandomFile, &( outBytes[ numDone ] ),
+                             inNumBytes - numDone );
+        if( numRead < 0 && errno == EINTR ) {
+            continue;
+            }
+        if( numRead <= 0 ) {
+            break;
+            }
+        numDone += numRead;
+        }
+
+    close( urandomFile );
+
+
+    return ( numDone == inNumBytes );
+    }
+
+
+
+// bumped in the child after every fork, so each thread's generator
+// notices and reseeds instead of repeating the parent's output
+static unsigned int forkGeneration = 0;
+
+static pthread_once_t forkHandlerOnce = PTHREAD_ONCE_INIT;
+
 
-    return (numRead == inNumBytes );
+static void childAfterFork() {
+    forkGeneration++;
+    }
+
+
+static void registerForkHandler() {
+    pthread_atfork( NULL, NULL, childAfterFork );
     }
 
 
 #endif
+
+
+
+
+// ChaCha20 generator with "fast key erasure" (Bernstein):  each refill
+// produces a batch of blocks from the current key, and the first 32 bytes
+// of the batch replace the key before any of the rest is handed out.
+
+
+#if defined( _MSC_VER )
+#define CRYPTO_RANDOM_THREAD_LOCAL __declspec( thread )
+#else
+#define CRYPTO_RANDOM_THREAD_LOCAL __thread
+#endif
+
+
+#define CHACHA_BLOCK_BYTES 64
+
+#define BLOCKS_PER_REFILL 16
+#define BUFFER_BYTES ( BLOCKS_PER_REFILL * CHACHA_BLOCK_BYTES )
+
+// largest run of blocks generated straight into a caller's buffer
+// between re-keys
+#define MAX_BULK_BLOCKS 16384
+
+#define RESEED_INTERVAL_BYTES ( 4 * 1048576 )
+
+
+
+typedef struct RandomGenerator {
+        unsigned int key[8];
+
+        // unused output is the last numBufferBytesLeft bytes
+        unsigned char buffer[ BUFFER_BYTES ];
+        int numBufferBytesLeft;
+
+        int numBytesSinceReseed;
+
+#ifndef WIN_32
+        unsigned int forkGeneration;
+#endif
+
+        char seeded;
+    } RandomGenerator;
+
+
+static CRYPTO_RANDOM_THREAD_LOCAL RandomGenerator threadGenerator;
+
+
+
+// memset that the compiler can't drop for memory that's not read again
+static inline void wipe( void *inMemory, int inNumBytes ) {
+#ifdef __GNUC__
+    memset( inMemory, 0, inNumBytes );
+    // tells the compiler the zeros are used
+    __asm__ __volatile__( "" : : "r"( inMemory ) : "memory" );
+#else
+    volatile unsigned char *bytes = (volatile unsigned char *)inMemory;
+
+    for( int i=0; i<inNumBytes; i++ ) {
+        bytes[i] = 0;
+        }
+#endif
+    }
+
+
+
+static inline unsigned int readLittleEndian( const unsigned char *inBytes ) {
+    return
+        (unsigned int)inBytes[0] |
+        (unsigned int)inBytes[1] << 8 |
+        (unsigned int)inBytes[2] << 16 |
+        (unsigned int)inBytes[3] << 24;
+    }
+
+
+
+#define ROTATE_LEFT( v, n ) ( ( (v) << (n) ) | ( (v) >> ( 32 - (n) ) ) )
+
+#define QUARTER_ROUND( a, b, c, d ) \
+    a += b; d ^= a; d = ROTATE_LEFT( d, 16 ); \
+    c += d; b ^= c; b = ROTATE_LEFT( b, 12 ); \
+    a += b; d ^= a; d = ROTATE_LEFT( d, 8 ); \
+    c += d; b ^= c; b = ROTATE_LEFT( b, 7 );
+
+
+
+// one ChaCha20 block (RFC 8439) with the given key and block counter
+static void chachaBlock( const unsigned int inKey[8],
+                         unsigned int inCounter,
+                         const unsigned int inNonce[3],
+                         unsigned char outBlock[ CHACHA_BLOCK_BYTES ] ) {
+    unsigned int input[16] = {
+        // "expand 32-byte k"
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        inKey[0], inKey[1], inKey[2], inKey[3],
+        inKey[4], inKey[5], inKey[6], inKey[7],
+        inCounter, inNonce[0], inNonce[1], inNonce[2] };
+
+    unsigned int x[16];
+    memcpy( x, input, sizeof( x ) );
+
+    for( int i=0; i<10; i++ ) {
+        // columns
+        QUARTER_ROUND( x[0], x[4], x[8], x[12] );
+        QUARTER_ROUND( x[1], x[5], x[9], x[13] );
+        QUARTER_ROUND( x[2], x[6], x[10], x[14] );
+        QUARTER_ROUND( x[3], x[7], x[11], x[15] );
+
+        // diagonals
+        QUARTER_ROUND( x[0], x[5], x[10], x[15] );
+        QUARTER_ROUND( x[1], x[6], x[11], x[12] );
+        QUARTER_ROUND( x[2], x[7], x[8], x[13] );
+        QUARTER_ROUND( x[3], x[4], x[9], x[14] );
+        }
+
+    for( int i=0; i<16; i++ ) {
+        unsigned int word = x[i] + input[i];
+
+        outBlock[ 4 * i ] = (unsigned char)( word );
+        outBlock[ 4 * i + 1 ] = (unsigned char)( word >> 8 );
+        outBlock[ 4 * i + 2 ] = (unsigned char)( word >> 16 );
+        outBlock[ 4 * i + 3 ] = (unsigned char)( word >> 24 );
+        }
+
+    wipe( x, sizeof( x ) );
+    wipe( input, sizeof( input ) );
+    }
+
+
+
+// Writes inNumBlocks blocks of output and re-keys.
+// Every key is used for one batch only, so the nonce can stay zero.
+static void generateBlocks( RandomGenerator *inGenerator,
+                            unsigned char *outBytes, int inNumBlocks ) {
+    static const unsigned int nonce[3] = { 0, 0, 0 };
+
+    unsigned char nextKeyBlock[ CHACHA_BLOCK_BYTES ];
+
+    chachaBlock( inGenerator->key, 0, nonce, nextKeyBlock );
+
+    for( int b=0; b<inNumBlocks; b++ ) {
+        chachaBlock( inGenerator->key, b + 1, nonce,
+                     &( outBytes[ b * CHACHA_BLOCK_BYTES ] ) );
+        }
+
+    for( int i=0; i<8; i++ ) {
+        inGenerator->key[i] = readLittleEndian( &( nextKeyBlock[ 4 * i ] ) );
+        }
+
+    wipe( nextKeyBlock, sizeof( nextKeyBlock ) );
+
+    inGenerator->numBytesSinceReseed += inNumBlocks * CHACHA_BLOCK_BYTES;
+    }
+
+
+
+// seeds on first use and after fork, and mixes in fresh system
+// randomness every RESEED_INTERVAL_BYTES
+// returns false if the generator has no usable seed
+static char checkSeed( RandomGenerator *inGenerator ) {
+
+    char needsFreshSeed = ! inGenerator->seeded;
+
+#ifndef WIN_32
+    pthread_once( &forkHandlerOnce, registerForkHandler );
+
+    if( inGenerator->forkGeneration != forkGeneration ) {
+        needsFreshSeed = true;
+        }
+#endif
+
+    if( ! needsFreshSeed &&
+        inGenerator->numBytesSinceReseed < RESEED_INTERVAL_BYTES ) {
+        return true;
+        }
+
+
+    unsigned char seed[32];
+
+    if( ! getSystemRandomBytes( seed, 32 ) ) {
+        if( needsFreshSeed ) {
+            // never hand out a copy of the parent's stream (or an
+            // unseeded one)
+            return false;
+            }
+        // keep going on the old key, try again a bit later
+        inGenerator->numBytesSinceReseed = RESEED_INTERVAL_BYTES / 2;
+        return true;
+        }
+
+    for( int i=0; i<8; i++ ) {
+        unsigned int seedWord = readLittleEndian( &( seed[ 4 * i ] ) );
+
+        if( needsFreshSeed ) {
+            inGenerator->key[i] = seedWord;
+            }
+        else {
+            inGenerator->key[i] ^= seedWord;
+            }
+        }
+
+    wipe( seed, sizeof( seed ) );
+
+    if( needsFreshSeed ) {
+        // drop output buffered from before the fork
+        wipe( inGenerator->buffer, BUFFER_BYTES );
+        inGenerator->numBufferBytesLeft = 0;
+        }
+
+    inGenerator->numBytesSinceReseed = 0;
+    inGenerator->seeded = true;
+
+#ifndef WIN_32
+    inGenerator->forkGeneration = forkGeneration;
+#endif
+
+    return true;
+    }
+
+
+
+char getCryptoRandomBytes( unsigned char *outBytes, int inNumBytes ) {
+
+    RandomGenerator *generator = &threadGenerator;
+
+    if( ! checkSeed( generator ) ) {
+        return false;
+        }
+
+    while( inNumBytes > 0 ) {
+
+        if( generator->numBufferBytesLeft == 0 ) {
+            checkSeed( generator );
+
+            if( inNumBytes >= BUFFER_BYTES ) {
+                // bulk request, skip the buffer
+                int numBlocks = inNumBytes / CHACHA_BLOCK_BYTES;
+
+                if( numBlocks > MAX_BULK_BLOCKS ) {
+                    numBlocks = MAX_BULK_BLOCKS;
+                    }
+
+                generateBlocks( generator, outBytes, numBlocks );
+
+                outBytes += numBlocks * CHACHA_BLOCK_BYTES;
+                inNumBytes -= numBlocks * CHACHA_BLOCK_BYTES;
+                continue;
+                }
+
+            generateBlocks( generator, generator->buffer, BLOCKS_PER_REFILL );
+            generator->numBufferBytesLeft = BUFFER_BYTES;
+            }
+
+        int numToCopy = generator->numBufferBytesLeft;
+        if( numToCopy > inNumBytes ) {
+            numToCopy = inNumBytes;
+            }
+
+        unsigned char *source =
+            &( generator->buffer[ BUFFER_BYTES -
+                                  generator->numBufferBytesLeft ] );
+
+        memcpy( outBytes, source, numToCopy );
+
+        // bytes handed out don't stay in memory
+        memset( source, 0, numToCopy );
+
+        generator->numBufferBytesLeft -= numToCopy;
+        outBytes += numToCopy;
+        inNumBytes -= numToCopy;
+        }
+
+    return true;
+    }
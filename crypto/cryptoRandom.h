@@ -4,4 +4,22 @@
 
 // outBytes allocated by caller
 // returns true on success, or false if random bytes couldn't be acquired
+//
+// Bytes come from a ChaCha20 generator kept per thread, seeded from the
+// operating system and reseeded from it every few megabytes of output and
+// in the child after fork().  Small requests are served from a buffer
+// without system calls.  Large requests are generated straight into
+// outBytes, so this also works for bulk fills.
+//
+// Each refill re-keys the generator from its own output and the buffer
+// is wiped as it's handed out, so bytes already returned can't be
+// reconstructed from the generator's state later.
 char getCryptoRandomBytes( unsigned char *outBytes, int inNumBytes );
+
+
+
+// reads directly from the operating system's generator (getrandom,
+// /dev/urandom, or CryptGenRandom), bypassing the buffered generator
+// outBytes allocated by caller
+// returns true on success, or false if random bytes couldn't be acquired
+char getSystemRandomBytes( unsigned char *outBytes, int inNumBytes );
@@ -0,0 +1,84 @@
+// Throughput of getCryptoRandomBytes against the old approach of
+// opening /dev/urandom on every call, for key-sized draws and bulk fills.
+//
+// Usage:  cryptoRandomBenchmark
+
+
+#include "minorGems/crypto/cryptoRandom.h"
+
+#include "minorGems/system/Time.h"
+
+
+#include <stdio.h>
+
+
+
+// copy of the original implementation
+static char oldGetCryptoRandomBytes( unsigned char *outBytes,
+                                     int inNumBytes ) {
+
+    FILE *urandomFile = fopen( "/dev/urandom", "rb" );
+
+    if( urandomFile == NULL ) {
+        return false;
+        }
+
+    int numRead = fread( outBytes, 1, inNumBytes, urandomFile );
+
+    fclose( urandomFile );
+
+    return ( numRead == inNumBytes );
+    }
+
+
+
+static unsigned char *buffer;
+
+
+
+static void timeDraws( const char *inName,
+                       char (*inGetBytes)( unsigned char *, int ),
+                       int inDrawSize, int inNumDraws ) {
+    // warm up
+    inGetBytes( buffer, inDrawSize );
+
+    double startTime = Time::getCurrentTime();
+
+    for( int i=0; i<inNumDraws; i++ ) {
+        if( ! inGetBytes( buffer, inDrawSize ) ) {
+            printf( "%s failed\n", inName );
+            return;
+            }
+        }
+
+    double time = Time::getCurrentTime() - startTime;
+
+    printf( "  %-28s %10.0f draws/s %9.1f MB/s\n", inName,
+            inNumDraws / time, inNumDraws * (double)inDrawSize / time / 1e6 );
+    }
+
+
+
+int main() {
+
+    int bulkSize = 16 * 1048576;
+    buffer = new unsigned char[ bulkSize ];
+
+    printf( "32-byte draws (session keys, curve25519 secrets):\n" );
+    timeDraws( "fopen /dev/urandom", oldGetCryptoRandomBytes, 32, 50000 );
+    timeDraws( "getSystemRandomBytes", getSystemRandomBytes, 32, 200000 );
+    timeDraws( "getCryptoRandomBytes", getCryptoRandomBytes, 32, 2000000 );
+
+    printf( "\n8-byte draws (nonces):\n" );
+    timeDraws( "fopen /dev/urandom", oldGetCryptoRandomBytes, 8, 50000 );
+    timeDraws( "getCryptoRandomBytes", getCryptoRandomBytes, 8, 4000000 );
+
+    printf( "\n16 MiB bulk fills:\n" );
+    timeDraws( "fopen /dev/urandom", oldGetCryptoRandomBytes, bulkSize, 5 );
+    timeDraws( "getSystemRandomBytes", getSystemRandomBytes, bulkSize, 5 );
+    timeDraws( "getCryptoRandomBytes", getCryptoRandomBytes, bulkSize, 20 );
+
+    delete [] buffer;
+
+    return 0;
+    }
@@ -0,0 +1,272 @@
+// Statistical sanity tests for getCryptoRandomBytes.
+//
+// These can't show that output is cryptographically strong, only catch
+// gross breakage:  bias, stuck buffers, repeated output across calls,
+// threads, or fork().  Bounds are wide enough that a working generator
+// fails with probability around one in ten thousand per check.
+//
+// Usage:  cryptoRandomTest
+//
+// Exits with non-zero status on failure.
+
+
+#include "minorGems/crypto/cryptoRandom.h"
+
+#include "minorGems/system/Thread.h"
+
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+
+static int numFailures = 0;
+
+
+static void report( const char *inTest, char inPassed,
+                    const char *inDetails ) {
+    printf( "%-40s %s  (%s)\n", inTest, inPassed ? "passed" : "FAILED",
+            inDetails );
+    if( ! inPassed ) {
+        numFailures++;
+        }
+    }
+
+
+
+static void testStatistics( const char *inName, unsigned char *inData,
+                            int inLength ) {
+    char details[200];
+    char name[200];
+
+
+    // monobit:  proportion of 1 bits
+    double numOnes = 0;
+    for( int i=0; i<inLength; i++ ) {
+        numOnes += __builtin_popcount( inData[i] );
+        }
+    double numBits = 8.0 * inLength;
+    double z = ( numOnes - numBits / 2 ) / sqrt( numBits / 4 );
+
+    sprintf( name, "%s monobit", inName );
+    sprintf( details, "z = %.2f", z );
+    report( name, fabs( z ) < 4, details );
+
+
+    // byte frequencies, chi-square with 255 degrees of freedom
+    double counts[256];
+    memset( counts, 0, sizeof( counts ) );
+    for( int i=0; i<inLength; i++ ) {
+        counts[ inData[i] ]++;
+        }
+    double expected = inLength / 256.0;
+    double chiSquare = 0;
+    for( int b=0; b<256; b++ ) {
+        double d = counts[b] - expected;
+        chiSquare += d * d / expected;
+        }
+
+    sprintf( name, "%s byte chi-square", inName );
+    sprintf( details, "%.1f, expect 255 +- 23", chiSquare );
+    report( name, chiSquare > 180 && chiSquare < 340, details );
+
+
+    // successive nibble pairs, chi-square with 255 degrees of freedom
+    memset( counts, 0, sizeof( counts ) );
+    for( int i=0; i<inLength-1; i++ ) {
+        counts[ ( inData[i] & 0xF0 ) | ( inData[ i + 1 ] & 0x0F ) ]++;
+        }
+    expected = ( inLength - 1 ) / 256.0;
+    chiSquare = 0;
+    for( int b=0; b<256; b++ ) {
+        double d = counts[b] - expected;
+        chiSquare += d * d / expected;
+        }
+
+    sprintf( name, "%s pair chi-square", inName );
+    sprintf( details, "%.1f, expect 255 +- 23", chiSquare );
+    report( name, chiSquare > 180 && chiSquare < 340, details );
+
+
+    // serial correlation of successive bytes
+    double sumXY = 0, sumX = 0, sumXX = 0;
+    for( int i=0; i<inLength; i++ ) {
+        double x = inData[i];
+        double y = inData[ ( i + 1 ) % inLength ];
+        sumXY += x * y;
+        sumX += x;
+        sumXX += x * x;
+        }
+    double correlation =
+        ( inLength * sumXY - sumX * sumX ) /
+        ( inLength * sumXX - sumX * sumX );
+
+    sprintf( name, "%s serial correlation", inName );
+    sprintf( details, "%.5f", correlation );
+    report( name, fabs( correlation ) < 4 / sqrt( (double)inLength ),
+            details );
+    }
+
+
+
+// draws 32 bytes at a time and checks that no two draws in a row match
+static void testDrawsDiffer() {
+    unsigned char last[32];
+    unsigned char current[32];
+
+    char passed = getCryptoRandomBytes( last, 32 );
+
+    for( int i=0; i<100000 && passed; i++ ) {
+        passed = getCryptoRandomBytes( current, 32 ) &&
+            memcmp( current, last, 32 ) != 0;
+        memcpy( last, current, 32 );
+        }
+
+    report( "successive 32-byte draws differ", passed, "100000 draws" );
+    }
+
+
+
+class DrawThread : public Thread {
+    public:
+        unsigned char mBytes[64];
+        char mSuccess;
+
+        DrawThread() {
+            start();
+            }
+
+        ~DrawThread() {
+            join();
+            }
+
+        virtual void run() {
+            mSuccess = getCryptoRandomBytes( mBytes, 64 );
+            }
+    };
+
+
+
+static void testThreads() {
+    DrawThread *a = new DrawThread();
+    DrawThread *b = new DrawThread();
+
+    unsigned char mainBytes[64];
+    char passed = getCryptoRandomBytes( mainBytes, 64 );
+
+    a->join();
+    b->join();
+
+    passed = passed && a->mSuccess && b->mSuccess &&
+        memcmp( a->mBytes, b->mBytes, 64 ) != 0 &&
+        memcmp( a->mBytes, mainBytes, 64 ) != 0 &&
+        memcmp( b->mBytes, mainBytes, 64 ) != 0;
+
+    delete a;
+    delete b;
+
+    report( "threads draw different bytes", passed, "3 threads" );
+    }
+
+
+
+// after fork, parent and child both hold a copy of the same buffered
+// generator, so without a reseed they would draw the same bytes
+static void testFork() {
+    unsigned char primer[16];
+    getCryptoRandomBytes( primer, 16 );
+
+    int pipeEnds[2];
+    if( pipe( pipeEnds ) != 0 ) {
+        report( "fork reseeds", false, "pipe failed" );
+        return;
+        }
+
+    pid_t child = fork();
+
+    if( child == 0 ) {
+        unsigned char childBytes[32];
+        getCryptoRandomBytes( childBytes, 32 );
+        write( pipeEnds[1], childBytes, 32 );
+        _exit( 0 );
+        }
+
+    unsigned char parentBytes[32];
+    getCryptoRandomBytes( parentBytes, 32 );
+
+    unsigned char childBytes[32];
+    int numRead = read( pipeEnds[0], childBytes, 32 );
+    waitpid( child, NULL, 0 );
+
+    close( pipeEnds[0] );
+    close( pipeEnds[1] );
+
+    report( "fork reseeds", numRead == 32 &&
+            memcmp( parentBytes, childBytes, 32 ) != 0,
+            "parent and child draw after fork" );
+    }
+
+
+
+int main() {
+
+    int length = 4 * 1048576;
+    unsigned char *data = new unsigned char[ length ];
+
+
+    // small draws, through the buffer
+    char passed = true;
+    for( int i=0; i<length && passed; i+=32 ) {
+        passed = getCryptoRandomBytes( &( data[i] ), 32 );
+        }
+    report( "small draws succeed", passed, "32 bytes each" );
+    testStatistics( "small", data, length );
+
+
+    // odd sizes, mixing buffered bytes and bulk blocks
+    unsigned int sizeSeed = 1;
+    int i = 0;
+    passed = true;
+    while( i < length && passed ) {
+        sizeSeed = sizeSeed * 1103515245 + 12345;
+        int size = ( sizeSeed >> 8 ) % 5000;
+        if( i + size > length ) {
+            size = length - i;
+            }
+        passed = getCryptoRandomBytes( &( data[i] ), size );
+        i += size;
+        }
+    report( "mixed-size draws succeed", passed, "0 to 5000 bytes each" );
+    testStatistics( "mixed", data, length );
+
+
+    // one bulk fill, crossing reseeds
+    passed = getCryptoRandomBytes( data, length );
+    report( "bulk draw succeeds", passed, "4 MiB" );
+    testStatistics( "bulk", data, length );
+
+
+    // system source directly
+    passed = getSystemRandomBytes( data, 1048576 );
+    report( "system draw succeeds", passed, "1 MiB" );
+    testStatistics( "system", data, 1048576 );
+
+    delete [] data;
+
+
+    testDrawsDiffer();
+    testThreads();
+    testFork();
+
+
+    if( numFailures > 0 ) {
+        printf( "\n%d checks FAILED\n", numFailures );
+        return 1;
+        }
+
+    printf( "\nall checks passed\n" );
+    return 0;
+    }
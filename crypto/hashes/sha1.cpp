@@ -87,11 +87,14 @@ typedef union _BYTE64QUAD16 {
 } BYTE64QUAD16;
 
 /* Hash a single 512-bit block. This is the core of the algorithm. */
-void SHA1_Transform(sha1_quadbyte state[5], sha1_byte buffer[64]) {
+void SHA1_Transform(sha1_quadbyte state[5], const sha1_byte buffer[64]) {
 	sha1_quadbyte	a, b, c, d, e;
 	BYTE64QUAD16	*block;
 
-	block = (BYTE64QUAD16*)buffer;
+	/* Work on a copy, so the caller's data isn't overwritten */
+	BYTE64QUAD16	workspace;
+	memcpy(workspace.c, buffer, 64);
+	block = &workspace;
 	/* Copy context->state[] to working vars */
 	a = state[0];
 	b = state[1];
@@ -130,6 +133,257 @@ void SHA1_Transform(sha1_quadbyte state[5], sha1_byte buffer[64]) {
 }
 
 
+// Faster implementations, picked at runtime:
+//
+// SHA-NI (Intel SHA extensions) hash one stream with dedicated round
+// instructions, following Intel's "New Instructions Supporting the Secure
+// Hash Algorithm on Intel Architecture Processors" (Gulley et al.).
+//
+// Multi-buffer code runs the portable rounds on 4 (SSE2) or 8 (AVX2)
+// independent messages at once, one per 32-bit vector lane, for batches
+// of small messages on processors without SHA-NI.
+
+
+#include "minorGems/system/cpuFeatures.h"
+
+
+// 0 portable, 1 SSE2 multi-buffer, 2 AVX2 multi-buffer, 3 SHA-NI
+static int implementationLimit = 3;
+
+
+
+int getSHA1Implementation() {
+    const CPUFeatures *features = getCPUFeatures();
+
+    int level = 0;
+    if( features->sse2 ) {
+        level = 1;
+        }
+    if( features->avx2 ) {
+        level = 2;
+        }
+    if( features->sha && features->sse41 ) {
+        level = 3;
+        }
+
+    return limitImplementation( level, implementationLimit );
+    }
+
+
+
+void setSHA1ImplementationLimit( int inLevel ) {
+    implementationLimit = inLevel;
+    }
+
+
+
+#ifdef CPU_FEATURES_X86
+
+__attribute__(( target( "sha,sse4.1" ) ))
+static void transformBlocksSHANI( sha1_quadbyte state[5],
+                                  const sha1_byte *data,
+                                  unsigned int numBlocks ) {
+
+    const __m128i byteSwap = _mm_set_epi64x( 0x0001020304050607LL,
+                                             0x08090a0b0c0d0e0fLL );
+
+    // a in the high lane
+    __m128i abcd = _mm_shuffle_epi32(
+        _mm_loadu_si128( (const __m128i *)state ), 0x1B );
+    __m128i e0 = _mm_set_epi32( (int)state[4], 0, 0, 0 );
+    __m128i e1;
+
+    __m128i msg0, msg1, msg2, msg3;
+
+    const __m128i *in = (const __m128i *)data;
+
+    for( unsigned int b=0; b<numBlocks; b++ ) {
+        __m128i abcdSave = abcd;
+        __m128i eSave = e0;
+
+        // rounds 0-3
+        msg0 = _mm_shuffle_epi8( _mm_loadu_si128( in + 0 ), byteSwap );
+        e0 = _mm_add_epi32( e0, msg0 );
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 0 );
+
+        // rounds 4-7
+        msg1 = _mm_shuffle_epi8( _mm_loadu_si128( in + 1 ), byteSwap );
+        e1 = _mm_sha1nexte_epu32( e1, msg1 );
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 0 );
+        msg0 = _mm_sha1msg1_epu32( msg0, msg1 );
+
+        // rounds 8-11
+        msg2 = _mm_shuffle_epi8( _mm_loadu_si128( in + 2 ), byteSwap );
+        e0 = _mm_sha1nexte_epu32( e0, msg2 );
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 0 );
+        msg1 = _mm_sha1msg1_epu32( msg1, msg2 );
+        msg0 = _mm_xor_si128( msg0, msg2 );
+
+        // rounds 12-15
+        msg3 = _mm_shuffle_epi8( _mm_loadu_si128( in + 3 ), byteSwap );
+        e1 = _mm_sha1nexte_epu32( e1, msg3 );
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32( msg0, msg3 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 0 );
+        msg2 = _mm_sha1msg1_epu32( msg2, msg3 );
+        msg1 = _mm_xor_si128( msg1, msg3 );
+
+        // rounds 16-19
+        e0 = _mm_sha1nexte_epu32( e0, msg0 );
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32( msg1, msg0 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 0 );
+        msg3 = _mm_sha1msg1_epu32( msg3, msg0 );
+        msg2 = _mm_xor_si128( msg2, msg0 );
+
+        // rounds 20-23
+        e1 = _mm_sha1nexte_epu32( e1, msg1 );
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32( msg2, msg1 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 1 );
+        msg0 = _mm_sha1msg1_epu32( msg0, msg1 );
+        msg3 = _mm_xor_si128( msg3, msg1 );
+
+        // rounds 24-27
+        e0 = _mm_sha1nexte_epu32( e0, msg2 );
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32( msg3, msg2 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 1 );
+        msg1 = _mm_sha1msg1_epu32( msg1, msg2 );
+        msg0 = _mm_xor_si128( msg0, msg2 );
+
+        // rounds 28-31
+        e1 = _mm_sha1nexte_epu32( e1, msg3 );
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32( msg0, msg3 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 1 );
+        msg2 = _mm_sha1msg1_epu32( msg2, msg3 );
+        msg1 = _mm_xor_si128( msg1, msg3 );
+
+        // rounds 32-35
+        e0 = _mm_sha1nexte_epu32( e0, msg0 );
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32( msg1, msg0 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 1 );
+        msg3 = _mm_sha1msg1_epu32( msg3, msg0 );
+        msg2 = _mm_xor_si128( msg2, msg0 );
+
+        // rounds 36-39
+        e1 = _mm_sha1nexte_epu32( e1, msg1 );
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32( msg2, msg1 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 1 );
+        msg0 = _mm_sha1msg1_epu32( msg0, msg1 );
+        msg3 = _mm_xor_si128( msg3, msg1 );
+
+        // rounds 40-43
+        e0 = _mm_sha1nexte_epu32( e0, msg2 );
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32( msg3, msg2 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 2 );
+        msg1 = _mm_sha1msg1_epu32( msg1, msg2 );
+        msg0 = _mm_xor_si128( msg0, msg2 );
+
+        // rounds 44-47
+        e1 = _mm_sha1nexte_epu32( e1, msg3 );
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32( msg0, msg3 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 2 );
+        msg2 = _mm_sha1msg1_epu32( msg2, msg3 );
+        msg1 = _mm_xor_si128( msg1, msg3 );
+
+        // rounds 48-51
+        e0 = _mm_sha1nexte_epu32( e0, msg0 );
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32( msg1, msg0 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 2 );
+        msg3 = _mm_sha1msg1_epu32( msg3, msg0 );
+        msg2 = _mm_xor_si128( msg2, msg0 );
+
+        // rounds 52-55
+        e1 = _mm_sha1nexte_epu32( e1, msg1 );
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32( msg2, msg1 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 2 );
+        msg0 = _mm_sha1msg1_epu32( msg0, msg1 );
+        msg3 = _mm_xor_si128( msg3, msg1 );
+
+        // rounds 56-59
+        e0 = _mm_sha1nexte_epu32( e0, msg2 );
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32( msg3, msg2 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 2 );
+        msg1 = _mm_sha1msg1_epu32( msg1, msg2 );
+        msg0 = _mm_xor_si128( msg0, msg2 );
+
+        // rounds 60-63
+        e1 = _mm_sha1nexte_epu32( e1, msg3 );
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32( msg0, msg3 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 3 );
+        msg2 = _mm_sha1msg1_epu32( msg2, msg3 );
+        msg1 = _mm_xor_si128( msg1, msg3 );
+
+        // rounds 64-67
+        e0 = _mm_sha1nexte_epu32( e0, msg0 );
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32( msg1, msg0 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 3 );
+        msg3 = _mm_sha1msg1_epu32( msg3, msg0 );
+        msg2 = _mm_xor_si128( msg2, msg0 );
+
+        // rounds 68-71
+        e1 = _mm_sha1nexte_epu32( e1, msg1 );
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32( msg2, msg1 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 3 );
+        msg3 = _mm_xor_si128( msg3, msg1 );
+
+        // rounds 72-75
+        e0 = _mm_sha1nexte_epu32( e0, msg2 );
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32( msg3, msg2 );
+        abcd = _mm_sha1rnds4_epu32( abcd, e0, 3 );
+
+        // rounds 76-79
+        e1 = _mm_sha1nexte_epu32( e1, msg3 );
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32( abcd, e1, 3 );
+        e0 = _mm_sha1nexte_epu32( e0, eSave );
+        abcd = _mm_add_epi32( abcd, abcdSave );
+
+        in += 4;
+        }
+
+    _mm_storeu_si128( (__m128i *)state, _mm_shuffle_epi32( abcd, 0x1B ) );
+    state[4] = (sha1_quadbyte)_mm_extract_epi32( e0, 3 );
+    }
+
+#endif
+
+
+
+// hashes whole blocks into state
+static void transformBlocks( sha1_quadbyte state[5],
+                             const sha1_byte *data,
+                             unsigned int numBlocks ) {
+#ifdef CPU_FEATURES_X86
+    if( getSHA1Implementation() == 3 ) {
+        transformBlocksSHANI( state, data, numBlocks );
+        return;
+        }
+#endif
+
+    for( unsigned int b=0; b<numBlocks; b++ ) {
+        SHA1_Transform( state, &data[ b * 64 ] );
+        }
+    }
+
+
+
 /* SHA1_Init - Initialize new context */
 void SHA1_Init(SHA_CTX* context) {
 	/* SHA1 initialization constants */
@@ -142,7 +396,7 @@ void SHA1_Init(SHA_CTX* context) {
 }
 
 /* Run your data through this. */
-void SHA1_Update(SHA_CTX *context, sha1_byte *data, unsigned int len) {
+void SHA1_Update(SHA_CTX *context, const sha1_byte *data, unsigned int len) {
 	unsigned int	i, j;
 
 	j = (context->count[0] >> 3) & 63;
@@ -151,8 +405,10 @@ void SHA1_Update(SHA_CTX *context, sha1_byte *data, unsigned int len) {
 	if ((j + len) > 63) {
 	    memcpy(&context->buffer[j], data, (i = 64-j));
 	    SHA1_Transform(context->state, context->buffer);
-	    for ( ; i + 63 < len; i += 64) {
-	        SHA1_Transform(context->state, &data[i]);
+	    if (i + 63 < len) {
+	        unsigned int numBlocks = (len - i) / 64;
+	        transformBlocks(context->state, &data[i], numBlocks);
+	        i += numBlocks * 64;
 	    }
 	    j = 0;
 	}
@@ -161,6 +417,8 @@ void SHA1_Update(SHA_CTX *context, sha1_byte *data, unsigned int len) {
 }
 
 
+static const sha1_byte SHA1_Padding[SHA1_BLOCK_LENGTH] = { 0x80 };
+
 /* Add padding and return the message digest. */
 void SHA1_Final(sha1_byte digest[SHA1_DIGEST_LENGTH], SHA_CTX *context) {
 	sha1_quadbyte	i, j;
@@ -170,10 +428,9 @@ void SHA1_Final(sha1_byte digest[SHA1_DIGEST_LENGTH], SHA_CTX *context) {
 	    finalcount[i] = (sha1_byte)((context->count[(i >= 4 ? 0 : 1)]
 	     >> ((3-(i & 3)) * 8) ) & 255);  /* Endian independent */
 	}
-	SHA1_Update(context, (sha1_byte *)"\200", 1);
-	while ((context->count[0] & 504) != 448) {
-	    SHA1_Update(context, (sha1_byte *)"\0", 1);
-	}
+	/* Pad with 0x80 then zeros up to 56 bytes mod 64, in one update */
+	j = (context->count[0] >> 3) & 63;
+	SHA1_Update(context, SHA1_Padding, (j < 56) ? (56 - j) : (120 - j));
 	/* Should cause a SHA1_Transform() */
 	SHA1_Update(context, finalcount, 8);
 	for (i = 0; i < SHA1_DIGEST_LENGTH; i++) {
@@ -190,50 +447,99 @@ void SHA1_Final(sha1_byte digest[SHA1_DIGEST_LENGTH], SHA_CTX *context) {
 
 
 
-unsigned char *computeRawSHA1Digest( unsigned char *inData,
-                                     int inDataLength ) {
+// One-shot and batch hashing:  each message is hashed from its own
+// blocks, with the padded tail built in a small buffer, so nothing is
+// allocated or copied per message.
 
-    SHA_CTX context;
 
-    SHA1_Init( &context );
+// the last one or two blocks of a message, with padding and length
+typedef struct MessageTail {
+        sha1_byte blocks[ 2 * SHA1_BLOCK_LENGTH ];
+        unsigned int numBlocks;
+    } MessageTail;
 
-    // copy into buffer, since this SHA1 implementation seems to overwrite
-    // parts of the data buffer.
-    unsigned char *buffer = new unsigned char[ inDataLength ];
-    memcpy( (void *)buffer, (void *)inData, inDataLength ); 
 
-    SHA1_Update( &context, buffer, inDataLength );
 
-    delete [] buffer;
-    
-    unsigned char *digest = new unsigned char[ SHA1_DIGEST_LENGTH ];
+static void makeTail( const sha1_byte *inData, unsigned int inLength,
+                      MessageTail *outTail ) {
+    unsigned int numWhole = inLength / SHA1_BLOCK_LENGTH;
+    unsigned int tailLength = inLength - numWhole * SHA1_BLOCK_LENGTH;
 
-    SHA1_Final( digest, &context );
+    outTail->numBlocks = 1;
+    if( tailLength + 9 > SHA1_BLOCK_LENGTH ) {
+        outTail->numBlocks = 2;
+        }
 
-    return digest;
+    unsigned int paddedLength = outTail->numBlocks * SHA1_BLOCK_LENGTH;
+
+    memcpy( outTail->blocks, &inData[ numWhole * SHA1_BLOCK_LENGTH ],
+            tailLength );
+    outTail->blocks[ tailLength ] = 0x80;
+    memset( &outTail->blocks[ tailLength + 1 ], 0,
+            paddedLength - tailLength - 1 );
+
+    // bit length, big endian
+    unsigned int lowBits = inLength << 3;
+    unsigned int highBits = inLength >> 29;
+
+    sha1_byte *lengthBytes = &outTail->blocks[ paddedLength - 8 ];
+    for( int i=0; i<4; i++ ) {
+        lengthBytes[i] = (sha1_byte)( highBits >> ( 24 - 8 * i ) );
+        lengthBytes[ 4 + i ] = (sha1_byte)( lowBits >> ( 24 - 8 * i ) );
+        }
     }
 
 
 
-unsigned char *computeRawSHA1Digest( char *inString ) {
+static const sha1_quadbyte initialState[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
 
-    SHA_CTX context;
 
-    SHA1_Init( &context );
 
-    // copy into buffer, since this SHA1 implementation seems to overwrite
-    // parts of the data buffer.
-    int dataLength = strlen( inString );
-    unsigned char *buffer = new unsigned char[ dataLength ];
-    memcpy( (void *)buffer, (void *)inString, dataLength ); 
-    
-    SHA1_Update( &context, buffer, strlen( inString ) );
+static void writeDigest( const sha1_quadbyte inState[5],
+                         sha1_byte outDigest[ SHA1_DIGEST_LENGTH ] ) {
+    for( int i=0; i<SHA1_DIGEST_LENGTH; i++ ) {
+        outDigest[i] =
+            (sha1_byte)( inState[ i >> 2 ] >> ( ( 3 - ( i & 3 ) ) * 8 ) );
+        }
+    }
+
+
+
+static void hashOneMessage( const sha1_byte *inData, unsigned int inLength,
+                            sha1_byte outDigest[ SHA1_DIGEST_LENGTH ] ) {
+    sha1_quadbyte state[5];
+    memcpy( state, initialState, sizeof( state ) );
+
+    transformBlocks( state, inData, inLength / SHA1_BLOCK_LENGTH );
+
+    MessageTail tail;
+    makeTail( inData, inLength, &tail );
+
+    transformBlocks( state, tail.blocks, tail.numBlocks );
+
+    writeDigest( state, outDigest );
+    }
+
+
+
+unsigned char *computeRawSHA1Digest( unsigned char *inData,
+                                     int inDataLength ) {
 
-    delete [] buffer;
-    
     unsigned char *digest = new unsigned char[ SHA1_DIGEST_LENGTH ];
 
-    SHA1_Final( digest, &context );
+    hashOneMessage( inData, inDataLength, digest );
+
+    return digest;
+    }
+
+
+
+unsigned char *computeRawSHA1Digest( char *inString ) {
+
+    unsigned char *digest = new unsigned char[ SHA1_DIGEST_LENGTH ];
+
+    hashOneMessage( (unsigned char *)inString, strlen( inString ), digest );
 
     return digest;
     }
@@ -369,3 +675,388 @@ char *hmac_sha1( const char *inKey, const char *inData ) {
 
 
 
+
+
+
+
+#ifdef __GNUC__
+
+// Generic over the vector type using GCC vector extensions, and inlined
+// into wrappers compiled for each instruction set.
+
+typedef sha1_quadbyte SHA1Vector4 __attribute__(( vector_size( 16 ) ));
+typedef sha1_quadbyte SHA1Vector8 __attribute__(( vector_size( 32 ) ));
+
+
+#define VROL( v, n ) ( ( (v) << (n) ) | ( (v) >> ( 32 - (n) ) ) )
+
+
+template <class Vector, int numLanes>
+__attribute__(( always_inline ))
+static inline void multiBufferTransform( Vector ioState[5],
+                                         const sha1_byte **inBlocks ) {
+    Vector w[16];
+
+    // transpose:  word t of every lane's block into vector t
+    for( int t=0; t<16; t++ ) {
+        for( int lane=0; lane<numLanes; lane++ ) {
+            const sha1_byte *word = &inBlocks[ lane ][ 4 * t ];
+
+            w[t][ lane ] =
+                (sha1_quadbyte)word[0] << 24 | (sha1_quadbyte)word[1] << 16 |
+                (sha1_quadbyte)word[2] << 8 | (sha1_quadbyte)word[3];
+            }
+        }
+
+    Vector a = ioState[0];
+    Vector b = ioState[1];
+    Vector c = ioState[2];
+    Vector d = ioState[3];
+    Vector e = ioState[4];
+
+    for( int t=0; t<80; t++ ) {
+        if( t >= 16 ) {
+            w[ t & 15 ] = VROL( w[ ( t - 3 ) & 15 ] ^ w[ ( t - 8 ) & 15 ] ^
+                                w[ ( t - 14 ) & 15 ] ^ w[ t & 15 ], 1 );
+            }
+
+        Vector f;
+        sha1_quadbyte k;
+
+        if( t < 20 ) {
+            f = ( b & ( c ^ d ) ) ^ d;
+            k = 0x5A827999;
+            }
+        else if( t < 40 ) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+            }
+        else if( t < 60 ) {
+            f = ( ( b | c ) & d ) | ( b & c );
+            k = 0x8F1BBCDC;
+            }
+        else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+            }
+
+        Vector temp = VROL( a, 5 ) + f + e + k + w[ t & 15 ];
+        e = d;
+        d = c;
+        c = VROL( b, 30 );
+        b = a;
+        a = temp;
+        }
+
+    ioState[0] += a;
+    ioState[1] += b;
+    ioState[2] += c;
+    ioState[3] += d;
+    ioState[4] += e;
+    }
+
+
+
+// where a lane is in its current message
+typedef struct Lane {
+        const sha1_byte *data;
+        unsigned int numWholeBlocks;
+        unsigned int nextBlock;
+        int messageIndex;
+        MessageTail tail;
+    } Lane;
+
+
+
+// Runs each lane through its message, starting the next message in a
+// lane as soon as one finishes.
+template <class Vector, int numLanes>
+__attribute__(( always_inline ))
+static inline void multiBufferDigests( unsigned char **inMessages,
+                                       int *inLengths, int inNumMessages,
+                                       unsigned char *outDigests ) {
+    Lane lanes[ numLanes ];
+    Vector state[5];
+
+    // idle lanes hash this and are ignored
+    static const sha1_byte idleBlock[ SHA1_BLOCK_LENGTH ] = { 0 };
+
+    int nextMessage = 0;
+    int numActive = 0;
+
+    for( int lane=0; lane<numLanes; lane++ ) {
+        lanes[ lane ].messageIndex = -1;
+        }
+
+    while( true ) {
+        // fill idle lanes
+        for( int lane=0; lane<numLanes; lane++ ) {
+            Lane *l = &lanes[ lane ];
+
+            if( l->messageIndex == -1 && nextMessage < inNumMessages ) {
+                l->messageIndex = nextMessage;
+                l->data = inMessages[ nextMessage ];
+                l->numWholeBlocks =
+                    inLengths[ nextMessage ] / SHA1_BLOCK_LENGTH;
+                l->nextBlock = 0;
+                makeTail( l->data, inLengths[ nextMessage ], &l->tail );
+
+                for( int i=0; i<5; i++ ) {
+                    state[i][ lane ] = initialState[i];
+                    }
+
+                nextMessage++;
+                numActive++;
+                }
+            }
+
+        if( numActive == 0 ) {
+            break;
+            }
+
+        const sha1_byte *blocks[ numLanes ];
+
+        for( int lane=0; lane<numLanes; lane++ ) {
+            Lane *l = &lanes[ lane ];
+
+            if( l->messageIndex == -1 ) {
+                blocks[ lane ] = idleBlock;
+                }
+            else if( l->nextBlock < l->numWholeBlocks ) {
+                blocks[ lane ] = &l->data[ l->nextBlock * SHA1_BLOCK_LENGTH ];
+                }
+            else {
+                blocks[ lane ] =
+                    &l->tail.blocks[ ( l->nextBlock - l->numWholeBlocks ) *
+                                     SHA1_BLOCK_LENGTH ];
+                }
+            }
+
+        multiBufferTransform<Vector, numLanes>( state, blocks );
+
+        for( int lane=0; lane<numLanes; lane++ ) {
+            Lane *l = &lanes[ lane ];
+
+            if( l->messageIndex == -1 ) {
+                continue;
+                }
+
+            l->nextBlock++;
+
+            if( l->nextBlock == l->numWholeBlocks + l->tail.numBlocks ) {
+                sha1_quadbyte laneState[5];
+                for( int i=0; i<5; i++ ) {
+                    laneState[i] = state[i][ lane ];
+                    }
+                writeDigest( laneState, &outDigests[ l->messageIndex *
+                                                     SHA1_DIGEST_LENGTH ] );
+                l->messageIndex = -1;
+                numActive--;
+                }
+            }
+        }
+    }
+
+#endif
+
+
+
+#ifdef CPU_FEATURES_X86
+
+__attribute__(( target( "sse2" ) ))
+static void multiBufferDigestsSSE2( unsigned char **inMessages,
+                                    int *inLengths, int inNumMessages,
+                                    unsigned char *outDigests ) {
+    multiBufferDigests<SHA1Vector4, 4>( inMessages, inLengths,
+                                        inNumMessages, outDigests );
+    }
+
+
+__attribute__(( target( "avx2" ) ))
+static void multiBufferDigestsAVX2( unsigned char **inMessages,
+                                    int *inLengths, int inNumMessages,
+                                    unsigned char *outDigests ) {
+    multiBufferDigests<SHA1Vector8, 8>( inMessages, inLengths,
+                                        inNumMessages, outDigests );
+    }
+
+#endif
+
+
+
+void computeRawSHA1Digests( unsigned char **inMessages, int *inLengths,
+                            int inNumMessages, unsigned char *outDigests ) {
+#ifdef CPU_FEATURES_X86
+    int level = getSHA1Implementation();
+
+    if( level == 2 ) {
+        multiBufferDigestsAVX2( inMessages, inLengths, inNumMessages,
+                                outDigests );
+        return;
+        }
+    else if( level == 1 ) {
+        multiBufferDigestsSSE2( inMessages, inLengths, inNumMessages,
+                                outDigests );
+        return;
+        }
+#endif
+
+    // SHA-NI is fastest one message at a time
+    for( int i=0; i<inNumMessages; i++ ) {
+        hashOneMessage( inMessages[i], inLengths[i],
+                        &outDigests[ i * SHA1_DIGEST_LENGTH ] );
+        }
+    }
+
+
+
+
+#include "minorGems/io/InputStream.h"
+#include "minorGems/io/file/File.h"
+
+
+unsigned char *computeRawSHA1Digest( InputStream *inInput,
+                                     int inChunkSize ) {
+    SHA_CTX context;
+    SHA1_Init( &context );
+
+    unsigned char *buffer = new unsigned char[ inChunkSize ];
+
+    char error = false;
+
+    while( true ) {
+        long numRead = inInput->read( buffer, inChunkSize );
+
+        if( numRead < 0 ) {
+            error = true;
+            break;
+            }
+
+        SHA1_Update( &context, buffer, numRead );
+
+        if( numRead < inChunkSize ) {
+            // end of stream
+            break;
+            }
+        }
+
+    delete [] buffer;
+
+    unsigned char *digest = new unsigned char[ SHA1_DIGEST_LENGTH ];
+    SHA1_Final( digest, &context );
+
+    if( error ) {
+        delete [] digest;
+        return NULL;
+        }
+    return digest;
+    }
+
+
+
+#ifndef WIN_32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+unsigned char *computeRawSHA1Digest( File *inFile, char inUseMemoryMap ) {
+
+    char *fileName = inFile->getFullFileName();
+
+#ifndef WIN_32
+    if( inUseMemoryMap ) {
+        int fd = open( fileName, O_RDONLY );
+
+        struct stat fileStat;
+
+        if( fd != -1 && fstat( fd, &fileStat ) == 0 &&
+            fileStat.st_size > 0 &&
+            (unsigned long long)fileStat.st_size < 0x7FFFFFFFULL ) {
+
+            void *mapped = mmap( NULL, fileStat.st_size, PROT_READ,
+                                 MAP_PRIVATE, fd, 0 );
+
+            if( mapped != MAP_FAILED ) {
+                madvise( mapped, fileStat.st_size, MADV_SEQUENTIAL );
+
+                unsigned char *digest =
+                    new unsigned char[ SHA1_DIGEST_LENGTH ];
+                hashOneMessage( (sha1_byte *)mapped, fileStat.st_size,
+                                digest );
+
+                munmap( mapped, fileStat.st_size );
+                close( fd );
+                delete [] fileName;
+                return digest;
+                }
+            }
+
+        if( fd != -1 ) {
+            close( fd );
+            }
+        // else fall back to reading in chunks (empty, huge, or special
+        // files, or mapping failed)
+        }
+#endif
+
+    FILE *file = fopen( fileName, "rb" );
+    delete [] fileName;
+
+    if( file == NULL ) {
+        return NULL;
+        }
+
+    SHA_CTX context;
+    SHA1_Init( &context );
+
+    int chunkSize = 65536;
+    unsigned char *buffer = new unsigned char[ chunkSize ];
+
+    int numRead;
+    while( ( numRead = fread( buffer, 1, chunkSize, file ) ) > 0 ) {
+        SHA1_Update( &context, buffer, numRead );
+        }
+
+    char error = ferror( file );
+    fclose( file );
+
+    delete [] buffer;
+
+    unsigned char *digest = new unsigned char[ SHA1_DIGEST_LENGTH ];
+    SHA1_Final( digest, &context );
+
+    if( error ) {
+        delete [] digest;
+        return NULL;
+        }
+    return digest;
+    }
+
+
+
+static char *hexDigestOrNULL( unsigned char *inDigest ) {
+    if( inDigest == NULL ) {
+        return NULL;
+        }
+
+    char *digestHexString = hexEncode( inDigest, SHA1_DIGEST_LENGTH );
+
+    delete [] inDigest;
+
+    return digestHexString;
+    }
+
+
+
+char *computeSHA1Digest( InputStream *inInput, int inChunkSize ) {
+    return hexDigestOrNULL( computeRawSHA1Digest( inInput, inChunkSize ) );
+    }
+
+
+
+char *computeSHA1Digest( File *inFile, char inUseMemoryMap ) {
+    return hexDigestOrNULL( computeRawSHA1Digest( inFile, inUseMemoryMap ) );
+    }
@@ -74,12 +74,10 @@ typedef struct _SHA_CTX {
 
 
 
-// BIG NOTE:
-// These overwrite the data!
-// copy your data to a temporary buffer before passing it through
-// (the "nicer" functions below these 3 do not overwrite data)
+// Incremental interface, for data that arrives in pieces.
+// (These used to overwrite the data passed in, but no longer do.)
 void SHA1_Init(SHA_CTX *context);
-void SHA1_Update(SHA_CTX *context, sha1_byte *data, unsigned int len);
+void SHA1_Update(SHA_CTX *context, const sha1_byte *data, unsigned int len);
 void SHA1_Final(sha1_byte digest[SHA1_DIGEST_LENGTH], SHA_CTX* context);
 
 
@@ -145,5 +143,95 @@ char *hmac_sha1( const char *inKey, const char *inData );
 
 
 
+class InputStream;
+class File;
+
+
+/**
+ * Computes a unencoded 20-byte digest from everything remaining in a
+ * stream, reading it in fixed-size chunks.
+ *
+ * @param inInput the stream to read until it runs out.
+ *   Must be destroyed by caller.
+ * @param inChunkSize the number of bytes to read at a time.
+ *
+ * @return the digest as a byte array of length 20, or NULL on a read
+ *   error.
+ *   Must be destroyed by caller if non-NULL.
+ */
+unsigned char *computeRawSHA1Digest( InputStream *inInput,
+                                     int inChunkSize = 65536 );
+
+
+
+/**
+ * Computes a unencoded 20-byte digest from the contents of a file,
+ * without loading the whole file into memory.
+ *
+ * @param inFile the file to hash.
+ *   Must be destroyed by caller.
+ * @param inUseMemoryMap true to map the file into memory instead of
+ *   reading it (where supported), which avoids a copy for large files.
+ *
+ * @return the digest as a byte array of length 20, or NULL if the file
+ *   can't be read.
+ *   Must be destroyed by caller if non-NULL.
+ */
+unsigned char *computeRawSHA1Digest( File *inFile,
+                                     char inUseMemoryMap = true );
+
+
+
+/**
+ * Same as above, but returns a hex-encoded \0-terminated digest, or
+ * NULL on failure.
+ */
+char *computeSHA1Digest( InputStream *inInput, int inChunkSize = 65536 );
+
+char *computeSHA1Digest( File *inFile, char inUseMemoryMap = true );
+
+
+
+/**
+ * Computes unencoded 20-byte digests for many messages at once.
+ *
+ * Much faster than hashing small messages one at a time, since nothing
+ * is allocated per message and, on processors without SHA instructions,
+ * several messages are hashed in parallel in vector registers.
+ *
+ * @param inMessages array of pointers to the messages.
+ *   Must be destroyed by caller.
+ * @param inLengths array of message lengths.
+ *   Must be destroyed by caller.
+ * @param inNumMessages the number of messages.
+ * @param outDigests buffer with room for 20 * inNumMessages bytes, gets
+ *   the digests in message order.
+ *   Must be destroyed by caller.
+ */
+void computeRawSHA1Digests( unsigned char **inMessages, int *inLengths,
+                            int inNumMessages, unsigned char *outDigests );
+
+
+
+/**
+ * Gets the implementation used by the functions above:  0 for portable
+ * code, 1 for SSE2 multi-buffer, 2 for AVX2 multi-buffer, 3 for SHA-NI.
+ *
+ * The multi-buffer levels only apply to computeRawSHA1Digests, and use
+ * portable code for single messages.
+ *
+ * See minorGems/system/cpuFeatures.h.
+ */
+int getSHA1Implementation();
+
+
+
+/**
+ * Caps the implementation returned by getSHA1Implementation.
+ */
+void setSHA1ImplementationLimit( int inLevel );
+
+
+
 #endif
 
@@ -0,0 +1,216 @@
+// Throughput of each SHA1 implementation on large buffers and files, and
+// hashes per second for batches of small messages.
+//
+// Correctness is checked by sha1Test.
+//
+// Usage:  sha1Benchmark [megabytesPerRun]
+
+
+#include "sha1.h"
+
+#include "minorGems/io/file/File.h"
+#include "minorGems/io/file/FileInputStream.h"
+#include "minorGems/io/file/FileOutputStream.h"
+#include "minorGems/system/Time.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+static const char *implementationNames[4] =
+    { "portable", "SSE2 multi-buffer", "AVX2 multi-buffer", "SHA-NI" };
+
+
+static unsigned char *data;
+static int dataLength;
+
+// sink so results aren't optimized away
+static unsigned char digestSum = 0;
+
+
+static int numMessages = 200000;
+static int messageLength = 64;
+static unsigned char **messages;
+static int *lengths;
+static unsigned char *digests;
+
+static File *tempFile;
+
+
+
+static void runBuffer() {
+    unsigned char *digest = computeRawSHA1Digest( data, dataLength );
+    digestSum += digest[0];
+    delete [] digest;
+    }
+
+
+
+static void runMappedFile() {
+    unsigned char *digest = computeRawSHA1Digest( tempFile, true );
+    digestSum += digest[0];
+    delete [] digest;
+    }
+
+
+
+static void runReadFile() {
+    unsigned char *digest = computeRawSHA1Digest( tempFile, false );
+    digestSum += digest[0];
+    delete [] digest;
+    }
+
+
+
+static void runFileStream() {
+    FileInputStream *in = new FileInputStream( tempFile );
+    unsigned char *digest = computeRawSHA1Digest( in );
+    digestSum += digest[0];
+    delete [] digest;
+    delete in;
+    }
+
+
+
+static void runMessagesOneAtATime() {
+    for( int m=0; m<numMessages; m++ ) {
+        unsigned char *digest = computeRawSHA1Digest( messages[m],
+                                                      lengths[m] );
+        digestSum += digest[0];
+        delete [] digest;
+        }
+    }
+
+
+
+static void runMessagesBatch() {
+    computeRawSHA1Digests( messages, lengths, numMessages, digests );
+    digestSum += digests[0];
+    }
+
+
+
+static double timeOperation( void (*inOperation)() ) {
+    // warm up
+    inOperation();
+
+    int numRuns = 5;
+
+    double startTime = Time::getCurrentTime();
+    for( int i=0; i<numRuns; i++ ) {
+        inOperation();
+        }
+    return ( Time::getCurrentTime() - startTime ) / numRuns;
+    }
+
+
+
+static void timeThroughput( const char *inName, void (*inOperation)() ) {
+    double time = timeOperation( inOperation );
+
+    printf( "  %-36s %8.0f MB/s\n", inName, dataLength / time / 1e6 );
+    }
+
+
+
+static void timeMessages( const char *inName, void (*inOperation)() ) {
+    double time = timeOperation( inOperation );
+
+    printf( "  %-36s %8.2f M hashes/s\n", inName,
+            numMessages / time / 1e6 );
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    int megabytesPerRun = 64;
+
+    if( inNumArgs == 2 ) {
+        megabytesPerRun = atoi( inArgs[1] );
+        }
+
+    dataLength = megabytesPerRun * 1000000;
+    data = new unsigned char[ dataLength ];
+
+    unsigned int seed = 12345;
+    for( int i=0; i<dataLength; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (unsigned char)( seed >> 16 );
+        }
+
+    tempFile = new File( NULL, "sha1Benchmark.tmp" );
+    FileOutputStream *out = new FileOutputStream( tempFile );
+    out->write( data, dataLength );
+    delete out;
+
+
+    messages = new unsigned char*[ numMessages ];
+    lengths = new int[ numMessages ];
+    digests = new unsigned char[ numMessages * SHA1_DIGEST_LENGTH ];
+
+
+    int maxImplementation = 3;
+    for( ; maxImplementation > 0; maxImplementation-- ) {
+        setSHA1ImplementationLimit( maxImplementation );
+        if( getSHA1Implementation() == maxImplementation ) {
+            break;
+            }
+        }
+
+    printf( "%d MB buffer and file (file in page cache), average of "
+            "5 runs\n", megabytesPerRun );
+
+    for( int i=0; i<=maxImplementation; i++ ) {
+        setSHA1ImplementationLimit( i );
+
+        printf( "\n%s:\n", implementationNames[i] );
+
+        // multi-buffer levels hash single messages with portable code
+        if( i == 0 || i == 3 ) {
+            timeThroughput( "computeRawSHA1Digest, buffer", runBuffer );
+            timeThroughput( "file, memory mapped", runMappedFile );
+            timeThroughput( "file, read in chunks", runReadFile );
+            timeThroughput( "FileInputStream", runFileStream );
+            }
+
+        int sizes[3] = { 20, 64, 256 };
+
+        for( int s=0; s<3; s++ ) {
+            messageLength = sizes[s];
+
+            for( int m=0; m<numMessages; m++ ) {
+                messages[m] = &( data[ ( m * messageLength ) %
+                                       ( dataLength - messageLength ) ] );
+                lengths[m] = messageLength;
+                }
+
+            char name[100];
+
+            if( i == 0 || i == 3 ) {
+                sprintf( name, "%d-byte messages, one at a time",
+                         messageLength );
+                timeMessages( name, runMessagesOneAtATime );
+                }
+
+            sprintf( name, "%d-byte messages, batch", messageLength );
+            timeMessages( name, runMessagesBatch );
+            }
+        }
+
+    remove( "sha1Benchmark.tmp" );
+
+    // keep sum live
+    printf( "\n(digest sum %d)\n", digestSum );
+
+    delete tempFile;
+    delete [] messages;
+    delete [] lengths;
+    delete [] digests;
+    delete [] data;
+
+    return 0;
+    }
@@ -12,6 +12,10 @@
 
 #include "sha1.h"
 
+#include "minorGems/io/file/File.h"
+#include "minorGems/io/file/FileInputStream.h"
+#include "minorGems/io/file/FileOutputStream.h"
+
 
 
 #include <stdio.h>
@@ -19,6 +23,13 @@
 
 
 
+static int numFailures = 0;
+
+static const char *implementationNames[4] =
+    { "portable", "SSE2 multi-buffer", "AVX2 multi-buffer", "SHA-NI" };
+
+
+
 /**
  * All parameters must be destroyed by caller.
  */
@@ -26,6 +37,13 @@ void checkHash( char *inString, char *inTestName, char *inCorrectHash );
 
 
 
+/**
+ * Checks each implementation against the portable one.
+ */
+void checkImplementations();
+
+
+
 int main() {
 
 
@@ -60,11 +78,25 @@ int main() {
 
 
     
-    checkHash( abc, abc, correctABCHash );
-    checkHash( mixedAlpha, mixedAlpha, correctMixedAlphaHash );
-    
-    checkHash( millionAs, "A million repetions of \'a\'",
-               correctMillionHash );
+    // find what this processor supports
+    int maxImplementation = 3;
+    for( ; maxImplementation > 0; maxImplementation-- ) {
+        setSHA1ImplementationLimit( maxImplementation );
+        if( getSHA1Implementation() == maxImplementation ) {
+            break;
+            }
+        }
+
+    for( int i=0; i<=maxImplementation; i++ ) {
+        setSHA1ImplementationLimit( i );
+        printf( "Using %s implementation\n", implementationNames[i] );
+
+        checkHash( abc, abc, correctABCHash );
+        checkHash( mixedAlpha, mixedAlpha, correctMixedAlphaHash );
+
+        checkHash( millionAs, "A million repetions of \'a\'",
+                   correctMillionHash );
+        }
     
 
     
@@ -79,7 +111,17 @@ int main() {
 
     delete [] testString;
     delete [] testHash;
-    
+
+
+    checkImplementations();
+
+    if( numFailures > 0 ) {
+        printf( "%d checks FAILED\n", numFailures );
+        return 1;
+        }
+
+    printf( "All checks passed\n" );
+
     return 0;
     }
 
@@ -103,7 +145,185 @@ void checkHash( char *inString, char *inTestName, char *inCorrectHash ) {
         }
     else {
         printf( "    Hash is NOT correct.\n" );
+        numFailures++;
         }
 
     delete [] stringHash;
     }
+
+
+
+
+static unsigned int randSeed = 12345;
+
+static unsigned int nextRand() {
+    randSeed = randSeed * 1103515245 + 12345;
+    return randSeed >> 8;
+    }
+
+
+
+static void checkDigest( const char *inWhat, unsigned char *inDigest,
+                         unsigned char *inCorrectDigest, int inLength ) {
+    if( inDigest == NULL ||
+        memcmp( inDigest, inCorrectDigest, SHA1_DIGEST_LENGTH ) != 0 ) {
+
+        printf( "    %s digest wrong for length %d\n", inWhat, inLength );
+        numFailures++;
+        }
+    }
+
+
+
+void checkImplementations() {
+
+    int maxImplementation = 3;
+    for( ; maxImplementation > 0; maxImplementation-- ) {
+        setSHA1ImplementationLimit( maxImplementation );
+        if( getSHA1Implementation() == maxImplementation ) {
+            break;
+            }
+        }
+
+
+    // messages of random lengths at random alignments, mostly short so
+    // that padding boundaries get covered
+    int numMessages = 2000;
+
+    int bufferSize = 200000;
+    unsigned char *buffer = new unsigned char[ bufferSize ];
+    for( int i=0; i<bufferSize; i++ ) {
+        buffer[i] = (unsigned char)nextRand();
+        }
+
+    unsigned char *original = new unsigned char[ bufferSize ];
+    memcpy( original, buffer, bufferSize );
+
+    unsigned char **messages = new unsigned char*[ numMessages ];
+    int *lengths = new int[ numMessages ];
+
+    for( int m=0; m<numMessages; m++ ) {
+        if( m % 100 == 0 ) {
+            lengths[m] = nextRand() % ( bufferSize - 16 );
+            }
+        else {
+            lengths[m] = nextRand() % 300;
+            }
+        messages[m] = &( buffer[ nextRand() % 16 ] );
+        }
+
+
+    // portable, one at a time
+    setSHA1ImplementationLimit( 0 );
+
+    unsigned char *correct = new unsigned char[ numMessages *
+                                                SHA1_DIGEST_LENGTH ];
+    for( int m=0; m<numMessages; m++ ) {
+        unsigned char *digest = computeRawSHA1Digest( messages[m],
+                                                      lengths[m] );
+        memcpy( &correct[ m * SHA1_DIGEST_LENGTH ], digest,
+                SHA1_DIGEST_LENGTH );
+        delete [] digest;
+        }
+
+
+    unsigned char *batch = new unsigned char[ numMessages *
+                                              SHA1_DIGEST_LENGTH ];
+
+    for( int i=0; i<=maxImplementation; i++ ) {
+        setSHA1ImplementationLimit( i );
+        printf( "Checking %s against portable code\n",
+                implementationNames[i] );
+
+        int failuresBefore = numFailures;
+
+        memset( batch, 0, numMessages * SHA1_DIGEST_LENGTH );
+        computeRawSHA1Digests( messages, lengths, numMessages, batch );
+
+        for( int m=0; m<numMessages; m++ ) {
+            unsigned char *c = &correct[ m * SHA1_DIGEST_LENGTH ];
+
+            checkDigest( "batch", &batch[ m * SHA1_DIGEST_LENGTH ], c,
+                         lengths[m] );
+
+            unsigned char *digest = computeRawSHA1Digest( messages[m],
+                                                          lengths[m] );
+            checkDigest( "single", digest, c, lengths[m] );
+            delete [] digest;
+
+            // same message in random pieces
+            SHA_CTX context;
+            SHA1_Init( &context );
+            int done = 0;
+            while( done < lengths[m] ) {
+                int piece = nextRand() % ( lengths[m] - done + 1 );
+                SHA1_Update( &context, &( messages[m][ done ] ), piece );
+                done += piece;
+                }
+            unsigned char pieceDigest[ SHA1_DIGEST_LENGTH ];
+            SHA1_Final( pieceDigest, &context );
+            checkDigest( "incremental", pieceDigest, c, lengths[m] );
+            }
+
+        // batches smaller than the lane count
+        computeRawSHA1Digests( messages, lengths, 3, batch );
+        for( int m=0; m<3; m++ ) {
+            checkDigest( "short batch", &batch[ m * SHA1_DIGEST_LENGTH ],
+                         &correct[ m * SHA1_DIGEST_LENGTH ], lengths[m] );
+            }
+
+        // input must be left alone
+        if( memcmp( buffer, original, bufferSize ) != 0 ) {
+            printf( "    Input data was overwritten\n" );
+            numFailures++;
+            }
+
+
+        // files and streams, through a temporary file holding one of the
+        // long messages
+        int m = 0;
+        File tempFile( NULL, "sha1Test.tmp" );
+
+        FileOutputStream *out = new FileOutputStream( &tempFile );
+        out->write( messages[m], lengths[m] );
+        delete out;
+
+        unsigned char *c = &correct[ m * SHA1_DIGEST_LENGTH ];
+
+        unsigned char *digest = computeRawSHA1Digest( &tempFile, true );
+        checkDigest( "mapped file", digest, c, lengths[m] );
+        delete [] digest;
+
+        digest = computeRawSHA1Digest( &tempFile, false );
+        checkDigest( "read file", digest, c, lengths[m] );
+        delete [] digest;
+
+        FileInputStream *in = new FileInputStream( &tempFile );
+        digest = computeRawSHA1Digest( in, 1000 );
+        checkDigest( "stream", digest, c, lengths[m] );
+        delete [] digest;
+        delete in;
+
+        remove( "sha1Test.tmp" );
+
+        if( numFailures == failuresBefore ) {
+            printf( "    Digests are correct.\n" );
+            }
+        }
+
+
+    // missing files fail cleanly
+    File missingFile( NULL, "sha1TestMissing.tmp" );
+    if( computeRawSHA1Digest( &missingFile ) != NULL ) {
+        printf( "Missing file did not fail\n" );
+        numFailures++;
+        }
+
+
+    delete [] batch;
+    delete [] correct;
+    delete [] messages;
+    delete [] lengths;
+    delete [] buffer;
+    delete [] original;
+    }
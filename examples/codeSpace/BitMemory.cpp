@@ -4,106 +4,850 @@
  * 2000-November-19		Jason Rohrer
  * Created.
  */
- 
+
 #include "BitMemory.h"
 
 
+#include "minorGems/system/cpuFeatures.h"
+
+
+
+// 0 portable, 1 SSE2, 2 AVX2
+static int implementationLimit = 2;
+
+
+
+int BitMemory::getKernelImplementation() {
+	const CPUFeatures *features = getCPUFeatures();
+
+	int level = 0;
+	if( features->sse2 ) {
+		level = 1;
+		}
+	if( features->avx2 ) {
+		level = 2;
+		}
+
+	return limitImplementation( level, implementationLimit );
+	}
+
+
+
+void BitMemory::setKernelImplementationLimit( int inMaxImplementation ) {
+	implementationLimit = inMaxImplementation;
+	}
+
+
+
+// Bit 0 is the most significant bit of byte 0, so 8 bytes read in big
+// endian order hold 64 consecutive bits, first bit on top.
+
+
+static inline uint64_t readBigEndian( const unsigned char *inBytes ) {
+#if defined( __GNUC__ ) && defined( __BYTE_ORDER__ ) && \
+	__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	uint64_t word;
+	memcpy( &word, inBytes, 8 );
+	return __builtin_bswap64( word );
+#else
+	uint64_t word = 0;
+	for( int i=0; i<8; i++ ) {
+		word = ( word << 8 ) | inBytes[i];
+		}
+	return word;
+#endif
+	}
+
+
+
+static inline void writeBigEndian( unsigned char *outBytes,
+	uint64_t inWord ) {
+#if defined( __GNUC__ ) && defined( __BYTE_ORDER__ ) && \
+	__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	inWord = __builtin_bswap64( inWord );
+	memcpy( outBytes, &inWord, 8 );
+#else
+	for( int i=7; i>=0; i-- ) {
+		outBytes[i] = (unsigned char)( inWord & 0xFF );
+		inWord = inWord >> 8;
+		}
+#endif
+	}
+
+
+
+// gets the 64 bits starting at inBit, reading up to 9 bytes
+static inline uint64_t loadBits( const unsigned char *inBytes,
+	unsigned long inBit ) {
+
+	const unsigned char *bytes = &( inBytes[ inBit >> 3 ] );
+	int shift = inBit & 7;
+
+	uint64_t word = readBigEndian( bytes );
+
+	if( shift != 0 ) {
+		word = ( word << shift ) | ( bytes[8] >> ( 8 - shift ) );
+		}
+	return word;
+	}
+
+
+
+// sets inNumBits bits, 1 to 64, starting at inBit, from the top bits of
+// inValue, reading and writing up to 9 bytes but changing only those bits
+static inline void storeBits( unsigned char *inBytes, unsigned long inBit,
+	int inNumBits, uint64_t inValue ) {
+
+	unsigned char *bytes = &( inBytes[ inBit >> 3 ] );
+	int shift = inBit & 7;
+
+	uint64_t mask = ~(uint64_t)0 << ( 64 - inNumBits );
+	inValue = inValue & mask;
+
+	uint64_t word = readBigEndian( bytes );
+	word = ( word & ~( mask >> shift ) ) | ( inValue >> shift );
+	writeBigEndian( bytes, word );
+
+	if( shift != 0 ) {
+		// the last bits spill into the 9th byte
+		unsigned char spillMask =
+			(unsigned char)( ( mask << ( 64 - shift ) ) >> 56 );
+		unsigned char spillBits =
+			(unsigned char)( ( inValue << ( 64 - shift ) ) >> 56 );
+
+		bytes[8] = ( bytes[8] & ~spillMask ) | spillBits;
+		}
+	}
+
+
+
+// copies bits between different arrays, both padded
+static void copyBits( const unsigned char *inSrc, unsigned long inSrcBit,
+	unsigned char *inDest, unsigned long inDestBit,
+	unsigned long inNumBits ) {
+
+	if( ( inSrcBit & 7 ) == 0 && ( inDestBit & 7 ) == 0 ) {
+		unsigned long numBytes = inNumBits >> 3;
+
+		memcpy( &( inDest[ inDestBit >> 3 ] ), &( inSrc[ inSrcBit >> 3 ] ),
+				numBytes );
+
+		inSrcBit += numBytes << 3;
+		inDestBit += numBytes << 3;
+		inNumBits -= numBytes << 3;
+		}
+
+	while( inNumBits >= 64 ) {
+		storeBits( inDest, inDestBit, 64, loadBits( inSrc, inSrcBit ) );
+
+		inSrcBit += 64;
+		inDestBit += 64;
+		inNumBits -= 64;
+		}
+
+	if( inNumBits > 0 ) {
+		storeBits( inDest, inDestBit, inNumBits,
+				   loadBits( inSrc, inSrcBit ) );
+		}
+	}
+
+
+
+static inline int countWordOnes( uint64_t inWord ) {
+#ifdef __GNUC__
+	return __builtin_popcountll( inWord );
+#else
+	int count = 0;
+	while( inWord != 0 ) {
+		inWord = inWord & ( inWord - 1 );
+		count++;
+		}
+	return count;
+#endif
+	}
+
+
+
+// Kernels over whole bytes.  Vector kernels return how many bytes they
+// did and leave the rest to the portable kernels.
+
+
+// puts the result in inA
+static void combineBytesPortable( int inOperation, unsigned char *inA,
+	unsigned char *inB, unsigned long inStart, unsigned long inEnd ) {
+
+	unsigned long i = inStart;
+
+	// a word at a time, then the last few bytes
+	for( ; i + 8 <= inEnd; i += 8 ) {
+		uint64_t a, b;
+		memcpy( &a, &( inA[i] ), 8 );
+
+		if( inOperation == 3 ) {
+			a = ~a;
+			}
+		else {
+			memcpy( &b, &( inB[i] ), 8 );
+
+			switch( inOperation ) {
+				case 0:
+					a = a & b;
+					break;
+				case 1:
+					a = a | b;
+					break;
+				default:
+					a = a ^ b;
+					break;
+				}
+			}
+		memcpy( &( inA[i] ), &a, 8 );
+		}
+
+	for( ; i < inEnd; i++ ) {
+		switch( inOperation ) {
+			case 0:
+				inA[i] = inA[i] & inB[i];
+				break;
+			case 1:
+				inA[i] = inA[i] | inB[i];
+				break;
+			case 2:
+				inA[i] = inA[i] ^ inB[i];
+				break;
+			default:
+				inA[i] = ~( inA[i] );
+				break;
+			}
+		}
+	}
+
+
+
+static unsigned long countByteOnesPortable( const unsigned char *inBytes,
+	unsigned long inStart, unsigned long inEnd ) {
+
+	unsigned long count = 0;
+	unsigned long i = inStart;
+
+	for( ; i + 8 <= inEnd; i += 8 ) {
+		uint64_t word;
+		memcpy( &word, &( inBytes[i] ), 8 );
+		count += countWordOnes( word );
+		}
+	for( ; i < inEnd; i++ ) {
+		count += countWordOnes( inBytes[i] );
+		}
+	return count;
+	}
+
+
+
+#ifdef CPU_FEATURES_X86
+
+
+__attribute__(( target( "sse2" ) ))
+static unsigned long combineBytesSSE2( int inOperation, unsigned char *inA,
+	unsigned char *inB, unsigned long inNumBytes ) {
+
+	unsigned long i = 0;
+	__m128i allOnes = _mm_set1_epi8( (char)0xFF );
+
+	for( ; i + 16 <= inNumBytes; i += 16 ) {
+		__m128i a = _mm_loadu_si128( (__m128i *)&( inA[i] ) );
+
+		switch( inOperation ) {
+			case 0:
+				a = _mm_and_si128(
+					a, _mm_loadu_si128( (__m128i *)&( inB[i] ) ) );
+				break;
+			case 1:
+				a = _mm_or_si128(
+					a, _mm_loadu_si128( (__m128i *)&( inB[i] ) ) );
+				break;
+			case 2:
+				a = _mm_xor_si128(
+					a, _mm_loadu_si128( (__m128i *)&( inB[i] ) ) );
+				break;
+			default:
+				a = _mm_xor_si128( a, allOnes );
+				break;
+			}
+		_mm_storeu_si128( (__m128i *)&( inA[i] ), a );
+		}
+	return i;
+	}
+
+
+
+// counts bits in each byte with shifts and masks, then sums the bytes
+__attribute__(( target( "sse2" ) ))
+static unsigned long countByteOnesSSE2( const unsigned char *inBytes,
+	unsigned long inNumBytes, unsigned long *outCount ) {
+
+	__m128i mask1 = _mm_set1_epi8( 0x55 );
+	__m128i mask2 = _mm_set1_epi8( 0x33 );
+	__m128i mask4 = _mm_set1_epi8( 0x0F );
+	__m128i zero = _mm_setzero_si128();
+	__m128i total = _mm_setzero_si128();
+
+	unsigned long i = 0;
+	for( ; i + 16 <= inNumBytes; i += 16 ) {
+		__m128i v = _mm_loadu_si128( (__m128i *)&( inBytes[i] ) );
+
+		v = _mm_sub_epi8( v, _mm_and_si128( _mm_srli_epi64( v, 1 ),
+											mask1 ) );
+		v = _mm_add_epi8( _mm_and_si128( v, mask2 ),
+						  _mm_and_si128( _mm_srli_epi64( v, 2 ), mask2 ) );
+		v = _mm_and_si128( _mm_add_epi8( v, _mm_srli_epi64( v, 4 ) ),
+						   mask4 );
+
+		total = _mm_add_epi64( total, _mm_sad_epu8( v, zero ) );
+		}
+
+	uint64_t halves[2];
+	_mm_storeu_si128( (__m128i *)halves, total );
+	*outCount = halves[0] + halves[1];
+
+	return i;
+	}
+
+
+
+__attribute__(( target( "avx2" ) ))
+static unsigned long combineBytesAVX2( int inOperation, unsigned char *inA,
+	unsigned char *inB, unsigned long inNumBytes ) {
+
+	unsigned long i = 0;
+	__m256i allOnes = _mm256_set1_epi8( (char)0xFF );
+
+	for( ; i + 32 <= inNumBytes; i += 32 ) {
+		__m256i a = _mm256_loadu_si256( (__m256i *)&( inA[i] ) );
+
+		switch( inOperation ) {
+			case 0:
+				a = _mm256_and_si256(
+					a, _mm256_loadu_si256( (__m256i *)&( inB[i] ) ) );
+				break;
+			case 1:
+				a = _mm256_or_si256(
+					a, _mm256_loadu_si256( (__m256i *)&( inB[i] ) ) );
+				break;
+			case 2:
+				a = _mm256_xor_si256(
+					a, _mm256_loadu_si256( (__m256i *)&( inB[i] ) ) );
+				break;
+			default:
+				a = _mm256_xor_si256( a, allOnes );
+				break;
+			}
+		_mm256_storeu_si256( (__m256i *)&( inA[i] ), a );
+		}
+	return i;
+	}
+
+
+
+// looks up the count for each 4 bits, then sums the bytes
+__attribute__(( target( "avx2" ) ))
+static unsigned long countByteOnesAVX2( const unsigned char *inBytes,
+	unsigned long inNumBytes, unsigned long *outCount ) {
+
+	__m256i table = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3,
+									  1, 2, 2, 3, 2, 3, 3, 4,
+									  0, 1, 1, 2, 1, 2, 2, 3,
+									  1, 2, 2, 3, 2, 3, 3, 4 );
+	__m256i mask4 = _mm256_set1_epi8( 0x0F );
+	__m256i zero = _mm256_setzero_si256();
+	__m256i total = _mm256_setzero_si256();
+
+	unsigned long i = 0;
+	for( ; i + 32 <= inNumBytes; i += 32 ) {
+		__m256i v = _mm256_loadu_si256( (__m256i *)&( inBytes[i] ) );
+
+		__m256i low = _mm256_and_si256( v, mask4 );
+		__m256i high = _mm256_and_si256( _mm256_srli_epi16( v, 4 ), mask4 );
+
+		__m256i counts = _mm256_add_epi8(
+			_mm256_shuffle_epi8( table, low ),
+			_mm256_shuffle_epi8( table, high ) );
+
+		total = _mm256_add_epi64( total, _mm256_sad_epu8( counts, zero ) );
+		}
+
+	uint64_t quarters[4];
+	_mm256_storeu_si256( (__m256i *)quarters, total );
+	*outCount = quarters[0] + quarters[1] + quarters[2] + quarters[3];
+
+	return i;
+	}
+
+
+#endif
+
+
+
+static void combineBytes( int inOperation, unsigned char *inA,
+	unsigned char *inB, unsigned long inNumBytes ) {
+
+	unsigned long numDone = 0;
+
+#ifdef CPU_FEATURES_X86
+	int implementation = BitMemory::getKernelImplementation();
+
+	if( implementation >= 2 ) {
+		numDone = combineBytesAVX2( inOperation, inA, inB, inNumBytes );
+		}
+	else if( implementation == 1 ) {
+		numDone = combineBytesSSE2( inOperation, inA, inB, inNumBytes );
+		}
+#endif
+
+	combineBytesPortable( inOperation, inA, inB, numDone, inNumBytes );
+	}
+
+
+
+static unsigned long countByteOnes( const unsigned char *inBytes,
+	unsigned long inNumBytes ) {
+
+	unsigned long numDone = 0;
+	unsigned long count = 0;
+
+#ifdef CPU_FEATURES_X86
+	int implementation = BitMemory::getKernelImplementation();
+
+	if( implementation >= 2 ) {
+		numDone = countByteOnesAVX2( inBytes, inNumBytes, &count );
+		}
+	else if( implementation == 1 ) {
+		numDone = countByteOnesSSE2( inBytes, inNumBytes, &count );
+		}
+#endif
+
+	return count + countByteOnesPortable( inBytes, numDone, inNumBytes );
+	}
+
+
+
+// Spans of up to this many bits are buffered on the stack
+#define LOCAL_BUFFER_BITS 2048
+
+
+// bytes for a padded buffer
+static inline unsigned long getBufferSize( unsigned long inNumBits ) {
+	return ( ( inNumBits + 7 ) >> 3 ) + 8;
+	}
+
+
+
+void BitMemory::readRange( unsigned long inStart, unsigned long inLength,
+	unsigned char *outBuffer, unsigned long inBufferBit ) {
+
+	unsigned long position = inStart % mNumBits;
+
+	// one piece for each time the span wraps
+	while( inLength > 0 ) {
+		unsigned long pieceLength = mNumBits - position;
+		if( pieceLength > inLength ) {
+			pieceLength = inLength;
+			}
+
+		copyBits( mMemoryArray, position, outBuffer, inBufferBit,
+				  pieceLength );
+
+		inBufferBit += pieceLength;
+		inLength -= pieceLength;
+		position = 0;
+		}
+	}
+
+
+
+void BitMemory::writeRange( unsigned long inStart, unsigned long inLength,
+	unsigned char *inBuffer, unsigned long inBufferBit ) {
+
+	unsigned long position = inStart % mNumBits;
+
+	// later pieces overwrite earlier ones if the span is longer than
+	// memory, as with bit-by-bit writes
+	while( inLength > 0 ) {
+		unsigned long pieceLength = mNumBits - position;
+		if( pieceLength > inLength ) {
+			pieceLength = inLength;
+			}
+
+		copyBits( inBuffer, inBufferBit, mMemoryArray, position,
+				  pieceLength );
+
+		inBufferBit += pieceLength;
+		inLength -= pieceLength;
+		position = 0;
+		}
+	}
+
+
+
+void BitMemory::fillRange( unsigned long inStart, unsigned long inLength,
+	char inValue ) {
+
+	if( inLength > mNumBits ) {
+		inLength = mNumBits;
+		}
+
+	unsigned char byteValue = 0;
+	uint64_t wordValue = 0;
+	if( inValue ) {
+		byteValue = 0xFF;
+		wordValue = ~wordValue;
+		}
+
+	unsigned long position = inStart % mNumBits;
+
+	while( inLength > 0 ) {
+		unsigned long pieceLength = mNumBits - position;
+		if( pieceLength > inLength ) {
+			pieceLength = inLength;
+			}
+		inLength -= pieceLength;
+
+		// bits up to a byte boundary, whole bytes, then the last bits
+		unsigned long headLength = ( 8 - ( position & 7 ) ) & 7;
+		if( headLength > pieceLength ) {
+			headLength = pieceLength;
+			}
+		if( headLength > 0 ) {
+			storeBits( mMemoryArray, position, headLength, wordValue );
+			position += headLength;
+			pieceLength -= headLength;
+			}
+
+		unsigned long numBytes = pieceLength >> 3;
+		memset( &( mMemoryArray[ position >> 3 ] ), byteValue, numBytes );
+		position += numBytes << 3;
+		pieceLength -= numBytes << 3;
+
+		if( pieceLength > 0 ) {
+			storeBits( mMemoryArray, position, pieceLength, wordValue );
+			}
+
+		position = 0;
+		}
+	}
+
+
+
 unsigned char *BitMemory::getMemoryRange( unsigned long inRangeStart,
 	unsigned long inRangeEnd, unsigned long *outNumCharsReturned ) {
-	
+
 	// check memory range
 	if( inRangeStart < 0 || inRangeStart > inRangeEnd ) {
-		
+
 		printf( "Bad memory range: [%d, %d]\n", inRangeStart, inRangeEnd );
 		return NULL;
 		}
-	// wrapping is handled automatically by getBit()
-	
-	
-	unsigned long numBlocks = ( ( inRangeEnd - inRangeStart + 1 ) >> 3 );
-	if( ( inRangeEnd - inRangeStart + 1 ) - ( numBlocks >> 3 ) > 0 ) {
-		// extra bits
-		numBlocks++;
-		}
-	
-	unsigned char *output = new unsigned char[ numBlocks ];
-	
-	for( int b=0; b<numBlocks; b++ ) {
-		output[b] = 0;
-		}
-	
-	// bit index in output
-	int i = 0;
-	
-	for( int m=inRangeStart; m<=inRangeEnd; m++ ) {
-		unsigned char memBit = getBit( m );
-		
-		unsigned long block = i >> 3;	// index of block containing bit
-		int bit = i - ( block << 3 );	// index of bit in block
-		int shiftAmount = 7 - bit;
-		
-		output[block] = output[block] | ( memBit << shiftAmount );
-		
-		i++;
-		}
-		
+	// wrapping is handled automatically by readRange()
+
+	unsigned long numBits = inRangeEnd - inRangeStart + 1;
+
+	// round up to hold extra bits
+	unsigned long numBlocks = ( numBits + 7 ) >> 3;
+
+	// padded for readRange, but only numBlocks are returned
+	unsigned long bufferSize = getBufferSize( numBits );
+	unsigned char *output = new unsigned char[ bufferSize ];
+	memset( output, 0, bufferSize );
+
+	readRange( inRangeStart, numBits, output, 0 );
+
 	*outNumCharsReturned = numBlocks;
 	return output;
 	}
-	
-	
-	
+
+
+
 void BitMemory::setMemoryRange( unsigned long inRangeStart,
 	unsigned long inRangeEnd, unsigned char *inRangeContents ) {
-	
+
 	// check memory range
 	if( inRangeStart < 0 || inRangeStart > inRangeEnd ) {
-		
+
 		printf( "Bad memory range: [%d, %d]\n", inRangeStart, inRangeEnd );
 		return;
 		}
-	// wrapping is handled automatically by setBit()
-	
-	// bit index in input
-	int i = 0;
-	
-	for( int m=inRangeStart; m<=inRangeEnd; m++ ) {
-		char inputBit;
-		
-		unsigned long block = i >> 3;	// index of block containing bit
-		int bit = i - ( block << 3 );	// index of bit in block
-		int shiftAmount = 7 - bit;
-		
-		// shift and clear to extract bit from block
-		inputBit = 
-			(char)( ( inRangeContents[block] >> shiftAmount ) & 0x01 );
-		
-		setBit( m, inputBit );
-		i++;
-		}
-		
-	}	
-	
-	
-	
+	// wrapping is handled automatically by writeRange()
+
+	unsigned long numBits = inRangeEnd - inRangeStart + 1;
+
+	// copy into a padded buffer for writeRange
+	unsigned long bufferSize = getBufferSize( numBits );
+
+	unsigned char localBuffer[ ( LOCAL_BUFFER_BITS >> 3 ) + 8 ];
+	unsigned char *buffer = localBuffer;
+	if( numBits > LOCAL_BUFFER_BITS ) {
+		buffer = new unsigned char[ bufferSize ];
+		}
+
+	memcpy( buffer, inRangeContents, bufferSize - 8 );
+	memset( &( buffer[ bufferSize - 8 ] ), 0, 8 );
+
+	writeRange( inRangeStart, numBits, buffer, 0 );
+
+	if( buffer != localBuffer ) {
+		delete [] buffer;
+		}
+	}
+
+
+
 void BitMemory::clearMemoryRange( unsigned long inRangeStart,
 	unsigned long inRangeEnd ) {
-	
+
 	// check memory range
 	if( inRangeStart < 0 || inRangeEnd > mNumBits ||
 		inRangeStart > inRangeEnd ) {
-		
+
 		printf( "Bad memory range: [%d, %d]\n", inRangeStart, inRangeEnd );
 		return;
 		}
-	
-	for( int m=inRangeStart; m<=inRangeEnd; m++ ) {	
-		setBit( m, 0 );
-		}
+
+	fillRange( inRangeStart, inRangeEnd - inRangeStart + 1, 0 );
 	}
-	
-	
-	
+
+
+
 void BitMemory::clearMemory() {
 	clearMemoryRange( 0, mNumBits - 1 );
 	}
+
+
+
+uint64_t BitMemory::getBits( unsigned long inStart, int inNumBits ) {
+	if( inNumBits <= 0 ) {
+		return 0;
+		}
+
+	unsigned long position = inStart % mNumBits;
+	uint64_t word;
+
+	if( position + inNumBits <= mNumBits ) {
+		word = loadBits( mMemoryArray, position );
+		}
+	else {
+		// wraps
+		unsigned char buffer[ 16 ];
+		memset( buffer, 0, 16 );
+		readRange( position, inNumBits, buffer, 0 );
+		word = loadBits( buffer, 0 );
+		}
+
+	return word >> ( 64 - inNumBits );
+	}
+
+
+
+void BitMemory::setBits( unsigned long inStart, int inNumBits,
+	uint64_t inValue ) {
+
+	if( inNumBits <= 0 ) {
+		return;
+		}
+
+	// first bit on top
+	inValue = inValue << ( 64 - inNumBits );
+
+	unsigned long position = inStart % mNumBits;
+
+	if( position + inNumBits <= mNumBits ) {
+		storeBits( mMemoryArray, position, inNumBits, inValue );
+		}
+	else {
+		unsigned char buffer[ 16 ];
+		memset( buffer, 0, 16 );
+		storeBits( buffer, 0, inNumBits, inValue );
+		writeRange( position, inNumBits, buffer, 0 );
+		}
+	}
+
+
+
+void BitMemory::copyRange( unsigned long inSrc, unsigned long inDest,
+	unsigned long inLength ) {
+
+	if( inLength == 0 ) {
+		return;
+		}
+
+	unsigned long bufferSize = getBufferSize( inLength );
+
+	unsigned char localBuffer[ ( LOCAL_BUFFER_BITS >> 3 ) + 8 ];
+	unsigned char *buffer = localBuffer;
+	if( inLength > LOCAL_BUFFER_BITS ) {
+		buffer = new unsigned char[ bufferSize ];
+		}
+	memset( buffer, 0, bufferSize );
+
+	readRange( inSrc, inLength, buffer, 0 );
+	writeRange( inDest, inLength, buffer, 0 );
+
+	if( buffer != localBuffer ) {
+		delete [] buffer;
+		}
+	}
+
+
+
+void BitMemory::combineRanges( int inOperation, unsigned long inSrc1,
+	unsigned long inSrc2, unsigned long inDest, unsigned long inLength ) {
+
+	if( inLength == 0 ) {
+		return;
+		}
+
+	unsigned long bufferSize = getBufferSize( inLength );
+
+	unsigned char localBufferA[ ( LOCAL_BUFFER_BITS >> 3 ) + 8 ];
+	unsigned char localBufferB[ ( LOCAL_BUFFER_BITS >> 3 ) + 8 ];
+	unsigned char *bufferA = localBufferA;
+	unsigned char *bufferB = localBufferB;
+	if( inLength > LOCAL_BUFFER_BITS ) {
+		bufferA = new unsigned char[ bufferSize ];
+		bufferB = new unsigned char[ bufferSize ];
+		}
+	memset( bufferA, 0, bufferSize );
+
+	readRange( inSrc1, inLength, bufferA, 0 );
+
+	if( inOperation != NOT_BITS ) {
+		memset( bufferB, 0, bufferSize );
+		readRange( inSrc2, inLength, bufferB, 0 );
+		}
+
+	// both start at bit 0, so whole bytes line up
+	combineBytes( inOperation, bufferA, bufferB, bufferSize - 8 );
+
+	writeRange( inDest, inLength, bufferA, 0 );
+
+	if( bufferA != localBufferA ) {
+		delete [] bufferA;
+		delete [] bufferB;
+		}
+	}
+
+
+
+void BitMemory::andRange( unsigned long inSrc1, unsigned long inSrc2,
+	unsigned long inDest, unsigned long inLength ) {
+	combineRanges( AND_BITS, inSrc1, inSrc2, inDest, inLength );
+	}
+
+
+
+void BitMemory::orRange( unsigned long inSrc1, unsigned long inSrc2,
+	unsigned long inDest, unsigned long inLength ) {
+	combineRanges( OR_BITS, inSrc1, inSrc2, inDest, inLength );
+	}
+
+
+
+void BitMemory::xorRange( unsigned long inSrc1, unsigned long inSrc2,
+	unsigned long inDest, unsigned long inLength ) {
+	combineRanges( XOR_BITS, inSrc1, inSrc2, inDest, inLength );
+	}
+
+
+
+void BitMemory::notRange( unsigned long inSrc, unsigned long inDest,
+	unsigned long inLength ) {
+	combineRanges( NOT_BITS, inSrc, inSrc, inDest, inLength );
+	}
+
+
+
+unsigned long BitMemory::countOnes( unsigned long inStart,
+	unsigned long inLength ) {
+
+	unsigned long count = 0;
+	unsigned long position = inStart % mNumBits;
+
+	while( inLength > 0 ) {
+		unsigned long pieceLength = mNumBits - position;
+		if( pieceLength > inLength ) {
+			pieceLength = inLength;
+			}
+		inLength -= pieceLength;
+
+		// bits up to a byte boundary, whole bytes, then the last bits
+		unsigned long headLength = ( 8 - ( position & 7 ) ) & 7;
+		if( headLength > pieceLength ) {
+			headLength = pieceLength;
+			}
+		if( headLength > 0 ) {
+			count += countWordOnes(
+				loadBits( mMemoryArray, position ) >> ( 64 - headLength ) );
+			position += headLength;
+			pieceLength -= headLength;
+			}
+
+		unsigned long numBytes = pieceLength >> 3;
+		count += countByteOnes( &( mMemoryArray[ position >> 3 ] ),
+								numBytes );
+		position += numBytes << 3;
+		pieceLength -= numBytes << 3;
+
+		if( pieceLength > 0 ) {
+			count += countWordOnes(
+				loadBits( mMemoryArray, position ) >> ( 64 - pieceLength ) );
+			}
+
+		position = 0;
+		}
+
+	return count;
+	}
+
+
+
+void BitMemory::shiftRange( unsigned long inStart, unsigned long inLength,
+	long inShift ) {
+
+	unsigned long shiftLength = inShift;
+	if( inShift < 0 ) {
+		shiftLength = -inShift;
+		}
+
+	if( shiftLength >= inLength ) {
+		// everything shifted out
+		fillRange( inStart, inLength, 0 );
+		return;
+		}
+	if( shiftLength == 0 ) {
+		return;
+		}
+
+	unsigned long keptLength = inLength - shiftLength;
+
+	unsigned long bufferSize = getBufferSize( keptLength );
+
+	unsigned char localBuffer[ ( LOCAL_BUFFER_BITS >> 3 ) + 8 ];
+	unsigned char *buffer = localBuffer;
+	if( keptLength > LOCAL_BUFFER_BITS ) {
+		buffer = new unsigned char[ bufferSize ];
+		}
+	memset( buffer, 0, bufferSize );
+
+	if( inShift > 0 ) {
+		readRange( inStart, keptLength, buffer, 0 );
+		writeRange( inStart + shiftLength, keptLength, buffer, 0 );
+		fillRange( inStart, shiftLength, 0 );
+		}
+	else {
+		readRange( inStart + shiftLength, keptLength, buffer, 0 );
+		writeRange( inStart, keptLength, buffer, 0 );
+		fillRange( inStart + keptLength, shiftLength, 0 );
+		}
+
+	if( buffer != localBuffer ) {
+		delete [] buffer;
+		}
+	}
@@ -13,10 +13,14 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 
 /**
  * A codeSpace bit-addressable memory object.  Memory access is circular.
+ *
+ * Ranges are read and written 64 bits at a time, and span operations
+ * combine whole bytes with SSE2 or AVX2 where available.
  */
 class BitMemory {
 
@@ -103,6 +107,112 @@ class BitMemory {
 		void clearMemory();
 		
 		
+		
+		// Span operations.  All addresses wrap, and spans can be longer
+		// than memory.  Sources are read completely before the
+		// destination is written, so spans can overlap.
+		
+		
+		/**
+		 * Gets up to 64 bits.
+		 *
+		 * @param inStart the address of the first bit.
+		 * @param inNumBits the number of bits, 0 to 64.
+		 *
+		 * @return the bits in the low inNumBits bits, with the first bit
+		 *   most significant.
+		 */
+		uint64_t getBits( unsigned long inStart, int inNumBits );
+		
+		
+		/**
+		 * Sets up to 64 bits.
+		 *
+		 * @param inStart the address of the first bit.
+		 * @param inNumBits the number of bits, 0 to 64.
+		 * @param inValue the bits in the low inNumBits bits, with the
+		 *   first bit most significant.
+		 */
+		void setBits( unsigned long inStart, int inNumBits, 
+			uint64_t inValue );
+		
+		
+		/**
+		 * Copies a span of bits.
+		 *
+		 * @param inSrc the address of the first bit to copy.
+		 * @param inDest the address to copy the first bit to.
+		 * @param inLength the number of bits.
+		 */
+		void copyRange( unsigned long inSrc, unsigned long inDest,
+			unsigned long inLength );
+		
+		
+		/**
+		 * Combines two spans of bits, putting the result at inDest.
+		 */
+		void andRange( unsigned long inSrc1, unsigned long inSrc2,
+			unsigned long inDest, unsigned long inLength );
+		
+		void orRange( unsigned long inSrc1, unsigned long inSrc2,
+			unsigned long inDest, unsigned long inLength );
+		
+		void xorRange( unsigned long inSrc1, unsigned long inSrc2,
+			unsigned long inDest, unsigned long inLength );
+		
+		
+		/**
+		 * Inverts a span of bits, putting the result at inDest.
+		 */
+		void notRange( unsigned long inSrc, unsigned long inDest,
+			unsigned long inLength );
+		
+		
+		/**
+		 * Counts the 1 bits in a span.
+		 *
+		 * @param inStart the address of the first bit.
+		 * @param inLength the number of bits.
+		 *
+		 * @return the number of bits that are set.
+		 */
+		unsigned long countOnes( unsigned long inStart, 
+			unsigned long inLength );
+		
+		
+		/**
+		 * Shifts the bits within a span, filling vacated bits with 0.
+		 * Bits shifted past either end of the span are lost.
+		 *
+		 * @param inStart the address of the first bit.
+		 * @param inLength the number of bits.
+		 * @param inShift the number of bits to shift toward higher 
+		 *   addresses, or negative to shift toward lower addresses.
+		 */
+		void shiftRange( unsigned long inStart, unsigned long inLength,
+			long inShift );
+		
+		
+		
+		/**
+		 * Gets the span kernel implementation in use.
+		 *
+		 * @return 0 for portable code, 1 for SSE2, or 2 for AVX2.
+		 */
+		static int getKernelImplementation();
+		
+		
+		/**
+		 * Limits which span kernel implementation can be used, mostly for
+		 * testing and benchmarking.
+		 *
+		 * @param inMaxImplementation the highest implementation to use,
+		 *   if supported by this CPU, as numbered by 
+		 *   getKernelImplementation.
+		 */
+		static void setKernelImplementationLimit( int inMaxImplementation );
+		
+		
 		/**
 		 * Prints the contents of memory to standar out.
 		 */
@@ -110,11 +220,36 @@ class BitMemory {
 		
 		
 	private:
-		// memory packed into a char array
+		// memory packed into a char array, followed by 8 bytes of padding
+		// so that any bit can be read as part of a 64-bit word
 		unsigned char *mMemoryArray;
 		unsigned long mNumBits;
 		
 		
+		// copies inLength bits starting at inStart in memory into a 
+		// padded buffer, starting at bit inBufferBit
+		void readRange( unsigned long inStart, unsigned long inLength,
+			unsigned char *outBuffer, unsigned long inBufferBit );
+		
+		// copies inLength bits from a padded buffer into memory
+		void writeRange( unsigned long inStart, unsigned long inLength,
+			unsigned char *inBuffer, unsigned long inBufferBit );
+		
+		void fillRange( unsigned long inStart, unsigned long inLength,
+			char inValue );
+		
+		// for combineRanges
+		static const int AND_BITS = 0;
+		static const int OR_BITS = 1;
+		static const int XOR_BITS = 2;
+		static const int NOT_BITS = 3;
+		
+		// inSrc2 is ignored for NOT_BITS
+		void combineRanges( int inOperation, unsigned long inSrc1, 
+			unsigned long inSrc2, unsigned long inDest, 
+			unsigned long inLength );
+		
+		
 		/**
 		 * Gets a bit.  Note that no out-of-range test is performed, and
 		 * large positive indices wrap around.
@@ -138,8 +273,10 @@ class BitMemory {
 
 inline BitMemory::BitMemory( unsigned long inNumBits )
 	: mNumBits( inNumBits ),
-	mMemoryArray( new unsigned char[ inNumBits >> 3 ] ) {	// divide by 8
+	// divide by 8, rounding up, plus padding
+	mMemoryArray( new unsigned char[ ( ( inNumBits + 7 ) >> 3 ) + 8 ] ) {
 	
+	memset( mMemoryArray, 0, ( ( inNumBits + 7 ) >> 3 ) + 8 );
 	}
 
 
@@ -150,6 +287,12 @@ inline BitMemory::~BitMemory() {
 
 
 
+inline unsigned long BitMemory::getSize() {
+	return mNumBits;
+	}
+
+
+
 inline char BitMemory::getBit( unsigned long inIndex ) {
 	inIndex = inIndex % mNumBits;	// wrap around
 	// >> 3 = divide by 8
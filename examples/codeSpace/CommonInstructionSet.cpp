@@ -21,13 +21,7 @@ void CommonInstructionSet::copyi( BitMemory *inMemory, unsigned long inSrc,
 		return;
 		}
 	
-	unsigned long numChars;
-	unsigned char *srcValues = inMemory->getMemoryRange( inSrc, 
-		inSrc + inLength - 1, &numChars );
-	
-	inMemory->setMemoryRange( inDest, inDest + inLength - 1, srcValues );
-	delete [] srcValues;	
-	
+	inMemory->copyRange( inSrc, inDest, inLength );
 	}
 
 
@@ -43,21 +37,8 @@ void CommonInstructionSet::andi( BitMemory *inMemory, unsigned long inSrc1,
 		return;
 		}
 	
-	unsigned long numChars;
-	unsigned char *src1Values = inMemory->getMemoryRange( inSrc1, 
-		inSrc1 + inLength - 1, &numChars );
-	unsigned char *src2Values = inMemory->getMemoryRange( inSrc2, 
-		inSrc2 + inLength - 1, &numChars );
-	
-	// store result directly in src2Values
-	for( int i=0; i<numChars; i++ ) {
-		src2Values[i] = src2Values[i] ^ src1Values[i];
-		}
-	
-	inMemory->setMemoryRange( inDest, inDest + inLength - 1, src2Values );
-	delete [] src1Values;
-	delete [] src2Values;
-	
+	// this instruction has always combined with xor, despite its name
+	inMemory->xorRange( inSrc1, inSrc2, inDest, inLength );
 	}
 
 
@@ -72,17 +53,5 @@ void CommonInstructionSet::noti( BitMemory *inMemory, unsigned long inSrc,
 		return;
 		}
 	
-	unsigned long numChars;
-	unsigned char *srcValues = inMemory->getMemoryRange( inSrc, 
-		inSrc + inLength - 1, &numChars );
-	unsigned char *destValues = new unsigned char[numChars];
-	
-	// store result directly in src2Values
-	for( int i=0; i<numChars; i++ ) {
-		destValues[i] = ~( srcValues[i] );
-		}
-	
-	inMemory->setMemoryRange( inDest, inDest + inLength - 1, destValues );
-	delete [] srcValues;
-	delete [] destValues;
+	inMemory->notRange( inSrc, inDest, inLength );
 	}
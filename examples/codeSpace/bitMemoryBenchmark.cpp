@@ -0,0 +1,601 @@
+// Checks the BitMemory span operations and instruction steps against the
+// original bit-by-bit implementation, for every kernel implementation,
+// then measures each way on random programs and on 1M-bit spans.
+//
+// Usage:  bitMemoryBenchmark
+
+
+#include "BitMemory.h"
+#include "SimpleInstructionSet.h"
+
+#include "minorGems/util/random/XoshiroRandomSource.h"
+#include "minorGems/system/Time.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+int failures = 0;
+
+
+void check( char inPassed, const char *inWhat, int inLevel,
+            unsigned long inSize ) {
+    if( !inPassed ) {
+        printf( "FAILED:  %s, implementation %d, %lu bits\n",
+                inWhat, inLevel, inSize );
+        failures++;
+        }
+    }
+
+
+
+// The original BitMemory, which moves one bit at a time
+class PerBitMemory {
+
+    public:
+
+        PerBitMemory( unsigned long inNumBits )
+            : mNumBits( inNumBits ),
+              mMemoryArray( new unsigned char[ ( inNumBits + 7 ) >> 3 ] ) {
+            memset( mMemoryArray, 0, ( inNumBits + 7 ) >> 3 );
+            }
+
+        ~PerBitMemory() {
+            delete [] mMemoryArray;
+            }
+
+
+        char getBit( unsigned long inIndex ) {
+            inIndex = inIndex % mNumBits;
+            return (char)( ( mMemoryArray[ inIndex >> 3 ] >>
+                             ( 7 - ( inIndex & 7 ) ) ) & 0x01 );
+            }
+
+
+        void setBit( unsigned long inIndex, char inValue ) {
+            inIndex = inIndex % mNumBits;
+            unsigned char mask = 0x01 << ( 7 - ( inIndex & 7 ) );
+
+            mMemoryArray[ inIndex >> 3 ] = mMemoryArray[ inIndex >> 3 ] & ~mask;
+            if( inValue ) {
+                mMemoryArray[ inIndex >> 3 ] =
+                    mMemoryArray[ inIndex >> 3 ] | mask;
+                }
+            }
+
+
+        unsigned char *getMemoryRange( unsigned long inRangeStart,
+                                       unsigned long inRangeEnd,
+                                       unsigned long *outNumCharsReturned ) {
+            unsigned long numBits = inRangeEnd - inRangeStart + 1;
+            unsigned long numBlocks = ( numBits >> 3 ) + 1;
+
+            unsigned char *output = new unsigned char[ numBlocks ];
+            memset( output, 0, numBlocks );
+
+            for( unsigned long i=0; i<numBits; i++ ) {
+                output[ i >> 3 ] = output[ i >> 3 ] |
+                    ( getBit( inRangeStart + i ) << ( 7 - ( i & 7 ) ) );
+                }
+
+            *outNumCharsReturned = numBlocks;
+            return output;
+            }
+
+
+        void setMemoryRange( unsigned long inRangeStart,
+                             unsigned long inRangeEnd,
+                             unsigned char *inRangeContents ) {
+            unsigned long numBits = inRangeEnd - inRangeStart + 1;
+
+            for( unsigned long i=0; i<numBits; i++ ) {
+                setBit( inRangeStart + i,
+                        ( inRangeContents[ i >> 3 ] >> ( 7 - ( i & 7 ) ) )
+                        & 0x01 );
+                }
+            }
+
+
+        unsigned long mNumBits;
+        unsigned char *mMemoryArray;
+    };
+
+
+
+// the original CommonInstructionSet operations
+void perBitCopy( PerBitMemory *inMemory, unsigned long inSrc,
+                 unsigned long inDest, unsigned long inLength ) {
+    if( inLength == 0 ) {
+        return;
+        }
+    unsigned long numChars;
+    unsigned char *values = inMemory->getMemoryRange(
+        inSrc, inSrc + inLength - 1, &numChars );
+    inMemory->setMemoryRange( inDest, inDest + inLength - 1, values );
+    delete [] values;
+    }
+
+
+
+// inOperation as in BitMemory:  0 and, 1 or, 2 xor, 3 not
+void perBitCombine( PerBitMemory *inMemory, int inOperation,
+                    unsigned long inSrc1, unsigned long inSrc2,
+                    unsigned long inDest, unsigned long inLength ) {
+    if( inLength == 0 ) {
+        return;
+        }
+    unsigned long numChars;
+    unsigned char *values1 = inMemory->getMemoryRange(
+        inSrc1, inSrc1 + inLength - 1, &numChars );
+    unsigned char *values2 = inMemory->getMemoryRange(
+        inSrc2, inSrc2 + inLength - 1, &numChars );
+
+    for( unsigned long i=0; i<numChars; i++ ) {
+        switch( inOperation ) {
+            case 0:
+                values1[i] = values1[i] & values2[i];
+                break;
+            case 1:
+                values1[i] = values1[i] | values2[i];
+                break;
+            case 2:
+                values1[i] = values1[i] ^ values2[i];
+                break;
+            default:
+                values1[i] = ~( values1[i] );
+                break;
+            }
+        }
+
+    inMemory->setMemoryRange( inDest, inDest + inLength - 1, values1 );
+    delete [] values1;
+    delete [] values2;
+    }
+
+
+
+unsigned long perBitGetAddress( PerBitMemory *inMemory,
+                                unsigned long inStart, int inNumBits ) {
+    unsigned long address = 0;
+    for( int i=0; i<inNumBits; i++ ) {
+        address = ( address << 1 ) | inMemory->getBit( inStart + i );
+        }
+    return address;
+    }
+
+
+
+// the original SimpleInstructionSet step
+unsigned long perBitStep( PerBitMemory *inMemory, int inBitsInAddress,
+                          unsigned long inProgramCounter ) {
+    int instruction = (int)perBitGetAddress( inMemory, inProgramCounter, 2 );
+    inProgramCounter += 2;
+
+    unsigned long fields[4];
+    int numFields = 3;
+    if( instruction == 0 ) {
+        numFields = 1;
+        }
+    else if( instruction == 2 ) {
+        numFields = 4;
+        }
+
+    for( int f=0; f<numFields; f++ ) {
+        fields[f] = perBitGetAddress( inMemory, inProgramCounter,
+                                      inBitsInAddress );
+        inProgramCounter += inBitsInAddress;
+        }
+
+    switch( instruction ) {
+        case 0:
+            return fields[0];
+        case 1:
+            perBitCopy( inMemory, fields[0], fields[1], fields[2] );
+            break;
+        case 2:
+            // combines with xor, like the original
+            perBitCombine( inMemory, 2, fields[0], fields[1], fields[2],
+                           fields[3] );
+            break;
+        default:
+            perBitCombine( inMemory, 3, fields[0], fields[0], fields[1],
+                           fields[2] );
+            break;
+        }
+    return inProgramCounter;
+    }
+
+
+
+char sameMemory( BitMemory *inMemory, PerBitMemory *inPerBit ) {
+    unsigned long n = inPerBit->mNumBits;
+
+    for( unsigned long i=0; i<n; i++ ) {
+        if( inMemory->getBits( i, 1 ) !=
+            (uint64_t)inPerBit->getBit( i ) ) {
+            return false;
+            }
+        }
+    return true;
+    }
+
+
+
+void randomize( BitMemory *inMemory, PerBitMemory *inPerBit,
+                RandomSource *inRandSource ) {
+    unsigned long n = inPerBit->mNumBits;
+    unsigned long numBytes = ( n + 7 ) >> 3;
+
+    unsigned char *bytes = new unsigned char[ numBytes ];
+    for( unsigned long i=0; i<numBytes; i++ ) {
+        bytes[i] = (unsigned char)inRandSource->getRandomBoundedInt( 0, 255 );
+        }
+    inMemory->setMemoryRange( 0, n - 1, bytes );
+    inPerBit->setMemoryRange( 0, n - 1, bytes );
+    delete [] bytes;
+    }
+
+
+
+void checkImplementation( int inLevel, unsigned long inNumBits,
+                          RandomSource *inRandSource ) {
+    BitMemory::setKernelImplementationLimit( inLevel );
+
+    unsigned long n = inNumBits;
+
+    BitMemory memory( n );
+    PerBitMemory perBit( n );
+
+    randomize( &memory, &perBit, inRandSource );
+    check( sameMemory( &memory, &perBit ), "set all", inLevel, n );
+
+
+    // spans from 1 bit to a bit longer than twice memory, so that some
+    // of them wrap more than once
+    int numTrials = 200;
+
+    char allMatch = true;
+    for( int t=0; t<numTrials; t++ ) {
+        unsigned long start = inRandSource->getRandomBoundedInt( 0, 3 * n );
+        unsigned long length =
+            inRandSource->getRandomBoundedInt( 1, 2 * n + 70 );
+
+        unsigned long numChars, perBitNumChars;
+        unsigned char *values = memory.getMemoryRange(
+            start, start + length - 1, &numChars );
+        unsigned char *perBitValues = perBit.getMemoryRange(
+            start, start + length - 1, &perBitNumChars );
+
+        if( numChars != ( length + 7 ) >> 3 ||
+            memcmp( values, perBitValues, numChars ) != 0 ) {
+            allMatch = false;
+            }
+
+        // write somewhere else
+        start = inRandSource->getRandomBoundedInt( 0, 3 * n );
+        for( unsigned long i=0; i<numChars; i++ ) {
+            values[i] = (unsigned char)
+                inRandSource->getRandomBoundedInt( 0, 255 );
+            }
+        memory.setMemoryRange( start, start + length - 1, values );
+        perBit.setMemoryRange( start, start + length - 1, values );
+
+        delete [] values;
+        delete [] perBitValues;
+        }
+    check( allMatch, "get memory range", inLevel, n );
+    check( sameMemory( &memory, &perBit ), "set memory range", inLevel, n );
+
+
+    allMatch = true;
+    for( int t=0; t<numTrials; t++ ) {
+        unsigned long start = inRandSource->getRandomBoundedInt( 0, 3 * n );
+        int numBits = inRandSource->getRandomBoundedInt( 0, 64 );
+
+        if( memory.getBits( start, numBits ) !=
+            perBitGetAddress( &perBit, start, numBits ) ) {
+            allMatch = false;
+            }
+
+        uint64_t value = 0;
+        for( int i=0; i<4; i++ ) {
+            value = ( value << 16 ) |
+                (uint64_t)inRandSource->getRandomBoundedInt( 0, 0xFFFF );
+            }
+
+        memory.setBits( start, numBits, value );
+        for( int i=0; i<numBits; i++ ) {
+            perBit.setBit( start + i, ( value >> ( numBits - 1 - i ) ) & 1 );
+            }
+        }
+    check( allMatch, "get bits", inLevel, n );
+    check( sameMemory( &memory, &perBit ), "set bits", inLevel, n );
+
+
+    for( int t=0; t<numTrials; t++ ) {
+        unsigned long src1 = inRandSource->getRandomBoundedInt( 0, 3 * n );
+        unsigned long src2 = inRandSource->getRandomBoundedInt( 0, 3 * n );
+        unsigned long dest = inRandSource->getRandomBoundedInt( 0, 3 * n );
+        unsigned long length =
+            inRandSource->getRandomBoundedInt( 0, 2 * n + 70 );
+
+        int operation = t % 5;
+        switch( operation ) {
+            case 0:
+                memory.andRange( src1, src2, dest, length );
+                break;
+            case 1:
+                memory.orRange( src1, src2, dest, length );
+                break;
+            case 2:
+                memory.xorRange( src1, src2, dest, length );
+                break;
+            case 3:
+                memory.notRange( src1, dest, length );
+                break;
+            default:
+                memory.copyRange( src1, dest, length );
+                break;
+            }
+
+        if( operation < 4 ) {
+            perBitCombine( &perBit, operation, src1, src2, dest, length );
+            }
+        else {
+            perBitCopy( &perBit, src1, dest, length );
+            }
+        }
+    check( sameMemory( &memory, &perBit ), "span operations", inLevel, n );
+
+
+    allMatch = true;
+    for( int t=0; t<numTrials; t++ ) {
+        unsigned long start = inRandSource->getRandomBoundedInt( 0, 3 * n );
+        unsigned long length =
+            inRandSource->getRandomBoundedInt( 0, 2 * n + 70 );
+
+        unsigned long count = 0;
+        for( unsigned long i=0; i<length; i++ ) {
+            count += perBit.getBit( start + i );
+            }
+        if( memory.countOnes( start, length ) != count ) {
+            allMatch = false;
+            }
+        }
+    check( allMatch, "count ones", inLevel, n );
+
+
+    char *spanBits = new char[ n ];
+    for( int t=0; t<numTrials; t++ ) {
+        unsigned long start = inRandSource->getRandomBoundedInt( 0, 3 * n );
+        unsigned long length = inRandSource->getRandomBoundedInt( 0, n );
+        long shift = inRandSource->getRandomBoundedInt( -(int)n - 3,
+                                                        (int)n + 3 );
+
+        memory.shiftRange( start, length, shift );
+
+        for( unsigned long i=0; i<length; i++ ) {
+            spanBits[i] = perBit.getBit( start + i );
+            }
+        for( unsigned long i=0; i<length; i++ ) {
+            long from = (long)i - shift;
+            char value = 0;
+            if( from >= 0 && from < (long)length ) {
+                value = spanBits[ from ];
+                }
+            perBit.setBit( start + i, value );
+            }
+        }
+    delete [] spanBits;
+    check( sameMemory( &memory, &perBit ), "shift", inLevel, n );
+
+
+    memory.clearMemoryRange( n / 3, n - 1 );
+    for( unsigned long i=n/3; i<n; i++ ) {
+        perBit.setBit( i, 0 );
+        }
+    check( sameMemory( &memory, &perBit ), "clear range", inLevel, n );
+
+
+    // random programs, which copy and combine overlapping and wrapping
+    // spans
+    randomize( &memory, &perBit, inRandSource );
+
+    SimpleInstructionSet instructionSet;
+    instructionSet.setMemorySize( n );
+    int bitsInAddress = 0;
+    while( ( 2UL << bitsInAddress ) <= n ) {
+        bitsInAddress++;
+        }
+
+    unsigned long pc = 0;
+    unsigned long perBitPC = 0;
+    allMatch = true;
+    for( int s=0; s<1000 && allMatch; s++ ) {
+        pc = instructionSet.stepProgram( &memory, pc );
+        perBitPC = perBitStep( &perBit, bitsInAddress, perBitPC );
+
+        if( pc != perBitPC || !sameMemory( &memory, &perBit ) ) {
+            allMatch = false;
+            }
+        }
+    check( allMatch, "program steps", inLevel, n );
+    }
+
+
+
+// keeps counts from being optimized away
+volatile unsigned long countSink = 0;
+
+
+// runs at least inMinRounds rounds, and long enough for the millisecond
+// timer, returning rounds per second
+double timeSpanOperation( int inOperation, BitMemory *inMemory,
+                          PerBitMemory *inPerBit, unsigned long inLength,
+                          int inMinRounds ) {
+    // misaligned on both sides
+    unsigned long src = 3;
+    unsigned long dest = inLength + 13;
+
+    int numRounds = 0;
+    double startTime = Time::getCurrentTime();
+    double time = 0;
+    unsigned long count = 0;
+
+    while( numRounds < inMinRounds || time < 0.5 ) {
+        if( inPerBit != NULL ) {
+            switch( inOperation ) {
+                case 0:
+                    perBitCopy( inPerBit, src, dest, inLength );
+                    break;
+                case 1:
+                    perBitCombine( inPerBit, 2, src, src + 1, dest,
+                                   inLength );
+                    break;
+                case 2:
+                    perBitCombine( inPerBit, 3, src, src, dest, inLength );
+                    break;
+                default:
+                    for( unsigned long i=0; i<inLength; i++ ) {
+                        count += inPerBit->getBit( src + i );
+                        }
+                    break;
+                }
+            }
+        else {
+            switch( inOperation ) {
+                case 0:
+                    inMemory->copyRange( src, dest, inLength );
+                    break;
+                case 1:
+                    inMemory->xorRange( src, src + 1, dest, inLength );
+                    break;
+                case 2:
+                    inMemory->notRange( src, dest, inLength );
+                    break;
+                default:
+                    count += inMemory->countOnes( src, inLength );
+                    break;
+                }
+            }
+        numRounds++;
+        time = Time::getCurrentTime() - startTime;
+        }
+
+    countSink = countSink + count;
+    return numRounds / time;
+    }
+
+
+
+int main() {
+    XoshiroRandomSource randSource( 12345 );
+
+    int maxLevel = BitMemory::getKernelImplementation();
+
+    // odd sizes leave partial bytes at the end of memory
+    unsigned long sizes[4] = { 37, 256, 1000, 4099 };
+
+    for( int level=0; level<=maxLevel; level++ ) {
+        for( int s=0; s<4; s++ ) {
+            checkImplementation( level, sizes[s], &randSource );
+            }
+        }
+
+    if( failures == 0 ) {
+        printf( "All operations match bit-by-bit memory for "
+                "implementations 0 to %d\n", maxLevel );
+        }
+
+
+    const char *names[4] = { "bit by bit",
+                             "portable",
+                             "SSE2",
+                             "AVX2" };
+
+
+    // random programs in 64K bits of memory
+    unsigned long programSize = 65536;
+    int numSteps = 2000;
+
+    printf( "\nRandom programs, %lu bits of memory, steps per second:\n",
+            programSize );
+
+    BitMemory memory( programSize );
+    PerBitMemory perBit( programSize );
+    SimpleInstructionSet instructionSet;
+    instructionSet.setMemorySize( programSize );
+
+    double baseRate = 0;
+    for( int level=-1; level<=maxLevel; level++ ) {
+        if( level >= 0 ) {
+            BitMemory::setKernelImplementationLimit( level );
+            }
+
+        // the same program each round, and enough rounds for the timer
+        int numRounds = 0;
+        double time = 0;
+        while( numRounds < 1 || time < 0.5 ) {
+            XoshiroRandomSource programRandSource( 99 );
+            randomize( &memory, &perBit, &programRandSource );
+
+            unsigned long pc = 0;
+            double startTime = Time::getCurrentTime();
+            for( int s=0; s<numSteps; s++ ) {
+                if( level == -1 ) {
+                    pc = perBitStep( &perBit, 16, pc );
+                    }
+                else {
+                    pc = instructionSet.stepProgram( &memory, pc );
+                    }
+                }
+            time += Time::getCurrentTime() - startTime;
+            numRounds++;
+            }
+        double rate = numRounds * numSteps / time;
+        if( level == -1 ) {
+            baseRate = rate;
+            }
+        printf( "  %-16s %12.0f  (%.2fx)\n", names[ level + 1 ],
+                rate, rate / baseRate );
+        }
+
+
+    unsigned long spanLength = 1000000;
+    printf( "\n%lu-bit misaligned spans, Mbits per second:\n", spanLength );
+
+    BitMemory spanMemory( 3 * spanLength );
+    PerBitMemory spanPerBit( 3 * spanLength );
+    randomize( &spanMemory, &spanPerBit, &randSource );
+
+    const char *operationNames[4] = { "copy", "xor", "not", "count ones" };
+
+    for( int o=0; o<4; o++ ) {
+        printf( "  %s\n", operationNames[o] );
+
+        BitMemory::setKernelImplementationLimit( 0 );
+        double rate = timeSpanOperation( o, &spanMemory, &spanPerBit,
+                                         spanLength, 2 );
+        baseRate = rate;
+        printf( "    %-16s %10.1f  (%.2fx)\n", names[0],
+                rate * spanLength / 1e6, 1.0 );
+
+        for( int level=0; level<=maxLevel; level++ ) {
+            BitMemory::setKernelImplementationLimit( level );
+            rate = timeSpanOperation( o, &spanMemory, NULL,
+                                      spanLength, 20 );
+            printf( "    %-16s %10.1f  (%.2fx)\n", names[ level + 1 ],
+                    rate * spanLength / 1e6, rate / baseRate );
+            }
+        }
+
+
+    if( failures > 0 ) {
+        printf( "%d checks FAILED\n", failures );
+        return 1;
+        }
+    return 0;
+    }
@@ -12,6 +12,8 @@
 
 #include "minorGems/util/random/StdRandomSource.h"
 
+#include "ColorAutomaton.h"
+
 
 #include <signal.h>
 #include <stdio.h>
@@ -135,10 +137,10 @@ int main() {
 	int matrixSize = 2 * matrixRadius + 1;
 	int matrixCenterIndex = matrixRadius;
 	
-	double **matrix = new double*[matrixSize];
+	int **matrix = new int*[matrixSize];
 	
 	for( i=0; i<matrixSize; i++ ) {
-		matrix[i] = new double[matrixSize];
+		matrix[i] = new int[matrixSize];
 		}
 	/*
 	matrix[0][0] = 0;
@@ -209,102 +211,14 @@ int main() {
 		}
 	
 
-	while( running ) {
-		int x,y;
-		
-		unsigned long *newGrid = new unsigned long[ numGridSpaces ];
-		memcpy( newGrid, grid, sizeof( unsigned long ) * numGridSpaces );
-
-		for( x=0; x<width; x++ ) {
-			for( y=0; y<height; y++ ) {
-
-				int p = y * width + x;
-				
-
-				double newGridRed = 0;
-				double newGridGreen = 0;
-				double newGridBlue = 0;
-				
-				// sum of matrix times corresponding grid spaces
-				for( i=0; i<matrixSize; i++ ) {
-					for( j=0; j<matrixSize; j++ ) {
-
-						int gridX = x + i - matrixRadius;
-						int gridY = y + j - matrixRadius;
-
-						gridX = gridX % width;
-						gridY = gridY % height;
-
-						// handle negative wrap around
-						if( gridX < 0 ) {
-							gridX = width + gridX;
-							}
-						if( gridY < 0 ) {
-							gridY = height + gridY;
-							}
-						
-						unsigned long gridVal =
-							grid[ gridY * width + gridX ];
-						unsigned long gridRed =
-							gridVal >> 16 & 0xFF;
-						unsigned long gridGreen =
-							gridVal >> 8 & 0xFF;
-						unsigned long gridBlue =
-							gridVal & 0xFF;
-
-						double matrixVal = matrix[i][j];
-						
-						newGridRed += gridRed * matrixVal;
-						newGridGreen += gridGreen * matrixVal;
-						newGridBlue += gridBlue * matrixVal;				
-						}
-					}
-				// threshold colors at 0 and 255
-				/*
-				if( newGridRed < 0 ) {
-					newGridRed = 0;
-					}
-				if( newGridRed > 255 ) {
-					newGridRed = 255;
-					}
-				if( newGridGreen < 0 ) {
-					newGridGreen = 0;
-					}
-				if( newGridGreen > 255 ) {
-					newGridGreen = 255;
-					}
-				if( newGridBlue < 0 ) {
-					newGridBlue = 0;
-					}
-				if( newGridBlue > 255 ) {
-					newGridBlue = 255;
-					}
-				*/
-				int newRedInt = ( (int)newGridRed ) % 256;
-				int newGreenInt = ( (int)newGridGreen ) % 256;
-				int newBlueInt = ( (int)newGridBlue ) % 256;
-
-				if( newRedInt < 0 ) {
-					newRedInt += 256;
-					}
-				if( newGreenInt < 0 ) {
-					newGreenInt += 256;
-					}
-				if( newBlueInt < 0 ) {
-					newBlueInt += 256;
-					}
-				
-				newGrid[ p ] =
-					newRedInt << 16 |
-					newGreenInt << 8 |
-					newBlueInt;
-				
-				}
-			}
-
-		memcpy( grid, newGrid, sizeof( unsigned long ) * numGridSpaces );
+	// steps whole rows of each color channel at once
+	ColorAutomaton *automaton = new ColorAutomaton( width, height, 
+		matrix, matrixRadius );
+	automaton->setCells( grid );
 
-		delete [] newGrid;
+	while( running ) {
+		automaton->step();
+		automaton->getCells( grid );
 
 		setPixelsFromGrid();
 		
@@ -314,6 +228,7 @@ int main() {
 		}
 
 
+	delete automaton;
 	delete screenBuffer;
 	delete screen;
 
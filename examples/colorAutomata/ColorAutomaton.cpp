@@ -0,0 +1,286 @@
+#include "ColorAutomaton.h"
+
+#include <string.h>
+
+
+
+#include "minorGems/system/cpuFeatures.h"
+
+
+
+// 0 portable, 1 SSE2, 2 AVX2
+static int implementationLimit = 2;
+
+
+
+int ColorAutomaton::getKernelImplementation() {
+    const CPUFeatures *features = getCPUFeatures();
+
+    int level = 0;
+    if( features->sse2 ) {
+        level = 1;
+        }
+    if( features->avx2 ) {
+        level = 2;
+        }
+
+    return limitImplementation( level, implementationLimit );
+    }
+
+
+
+void ColorAutomaton::setKernelImplementationLimit( int inMaxImplementation ) {
+    implementationLimit = inMaxImplementation;
+    }
+
+
+
+// Row kernels.  Each output cell x is the sum of weight times
+// inWindow[ x + offset ] over the taps, keeping the low byte.
+// Vector kernels return how many cells they did and leave the rest to
+// the portable kernel.
+
+
+static void stepRowPortable( const uint16_t *inWindow, int inNumTaps,
+                             const int *inTapOffsets,
+                             const uint16_t *inTapWeights,
+                             uint16_t *outRow, int inStart, int inEnd ) {
+    for( int x=inStart; x<inEnd; x++ ) {
+        // wraps, but the low byte is still exact
+        unsigned int sum = 0;
+
+        for( int t=0; t<inNumTaps; t++ ) {
+            sum += (unsigned int)inTapWeights[t] *
+                inWindow[ x + inTapOffsets[t] ];
+            }
+        outRow[x] = (uint16_t)( sum & 0xFF );
+        }
+    }
+
+
+
+#ifdef CPU_FEATURES_X86
+
+
+__attribute__(( target( "sse2" ) ))
+static int stepRowSSE2( const uint16_t *inWindow, int inNumTaps,
+                        const int *inTapOffsets,
+                        const uint16_t *inTapWeights,
+                        uint16_t *outRow, int inWidth ) {
+    __m128i lowByte = _mm_set1_epi16( 0xFF );
+
+    int x = 0;
+    for( ; x + 8 <= inWidth; x += 8 ) {
+        __m128i sum = _mm_setzero_si128();
+
+        for( int t=0; t<inNumTaps; t++ ) {
+            __m128i cells = _mm_loadu_si128(
+                (__m128i *)&( inWindow[ x + inTapOffsets[t] ] ) );
+
+            sum = _mm_add_epi16(
+                sum, _mm_mullo_epi16(
+                    cells, _mm_set1_epi16( (short)inTapWeights[t] ) ) );
+            }
+        _mm_storeu_si128( (__m128i *)&( outRow[x] ),
+                          _mm_and_si128( sum, lowByte ) );
+        }
+    return x;
+    }
+
+
+
+__attribute__(( target( "avx2" ) ))
+static int stepRowAVX2( const uint16_t *inWindow, int inNumTaps,
+                        const int *inTapOffsets,
+                        const uint16_t *inTapWeights,
+                        uint16_t *outRow, int inWidth ) {
+    __m256i lowByte = _mm256_set1_epi16( 0xFF );
+
+    int x = 0;
+    for( ; x + 16 <= inWidth; x += 16 ) {
+        __m256i sum = _mm256_setzero_si256();
+
+        for( int t=0; t<inNumTaps; t++ ) {
+            __m256i cells = _mm256_loadu_si256(
+                (__m256i *)&( inWindow[ x + inTapOffsets[t] ] ) );
+
+            sum = _mm256_add_epi16(
+                sum, _mm256_mullo_epi16(
+                    cells, _mm256_set1_epi16( (short)inTapWeights[t] ) ) );
+            }
+        _mm256_storeu_si256( (__m256i *)&( outRow[x] ),
+                             _mm256_and_si256( sum, lowByte ) );
+        }
+    return x;
+    }
+
+
+#endif
+
+
+
+ColorAutomaton::ColorAutomaton( int inWidth, int inHeight, int **inMatrix,
+                                int inRadius )
+    : mWidth( inWidth ), mHeight( inHeight ), mRadius( inRadius ),
+      mPaddedWidth( inWidth + 2 * inRadius ),
+      mPaddedHeight( inHeight + 2 * inRadius ),
+      mPlaneSize( ( inWidth + 2 * inRadius ) * ( inHeight + 2 * inRadius ) ),
+      mPlanes( new uint16_t[ 3 * mPlaneSize ] ),
+      mNextPlanes( new uint16_t[ 3 * mPlaneSize ] ),
+      mNumTaps( 0 ) {
+
+    memset( mPlanes, 0, 3 * mPlaneSize * sizeof( uint16_t ) );
+    memset( mNextPlanes, 0, 3 * mPlaneSize * sizeof( uint16_t ) );
+
+    int matrixSize = 2 * inRadius + 1;
+
+    mTapOffsets = new int[ matrixSize * matrixSize ];
+    mTapWeights = new uint16_t[ matrixSize * matrixSize ];
+
+    for( int j=0; j<matrixSize; j++ ) {
+        for( int i=0; i<matrixSize; i++ ) {
+            if( inMatrix[i][j] != 0 ) {
+                mTapOffsets[ mNumTaps ] = j * mPaddedWidth + i;
+                // only the low 16 bits matter for the low byte
+                mTapWeights[ mNumTaps ] = (uint16_t)inMatrix[i][j];
+                mNumTaps++;
+                }
+            }
+        }
+    }
+
+
+
+ColorAutomaton::~ColorAutomaton() {
+    delete [] mPlanes;
+    delete [] mNextPlanes;
+    delete [] mTapOffsets;
+    delete [] mTapWeights;
+    }
+
+
+
+int ColorAutomaton::getWidth() {
+    return mWidth;
+    }
+
+
+
+int ColorAutomaton::getHeight() {
+    return mHeight;
+    }
+
+
+
+void ColorAutomaton::setCells( unsigned long *inCells ) {
+    for( int c=0; c<3; c++ ) {
+        uint16_t *plane = &( mPlanes[ c * mPlaneSize ] );
+        int shift = 16 - 8 * c;
+
+        for( int y=0; y<mHeight; y++ ) {
+            uint16_t *row = &( plane[ ( y + mRadius ) * mPaddedWidth +
+                                      mRadius ] );
+            unsigned long *cellRow = &( inCells[ y * mWidth ] );
+
+            for( int x=0; x<mWidth; x++ ) {
+                row[x] = (uint16_t)( ( cellRow[x] >> shift ) & 0xFF );
+                }
+            }
+        }
+    }
+
+
+
+void ColorAutomaton::getCells( unsigned long *outCells ) {
+    uint16_t *red = mPlanes;
+    uint16_t *green = &( mPlanes[ mPlaneSize ] );
+    uint16_t *blue = &( mPlanes[ 2 * mPlaneSize ] );
+
+    for( int y=0; y<mHeight; y++ ) {
+        int rowStart = ( y + mRadius ) * mPaddedWidth + mRadius;
+        unsigned long *cellRow = &( outCells[ y * mWidth ] );
+
+        for( int x=0; x<mWidth; x++ ) {
+            cellRow[x] =
+                (unsigned long)red[ rowStart + x ] << 16 |
+                (unsigned long)green[ rowStart + x ] << 8 |
+                (unsigned long)blue[ rowStart + x ];
+            }
+        }
+    }
+
+
+
+void ColorAutomaton::fillBorders( uint16_t *inPlane ) {
+    // sides of each row, wrapping more than once if the grid is
+    // narrower than the radius
+    for( int y=0; y<mHeight; y++ ) {
+        uint16_t *row = &( inPlane[ ( y + mRadius ) * mPaddedWidth ] );
+
+        for( int b=0; b<mRadius; b++ ) {
+            int leftSource = ( ( b - mRadius ) % mWidth + mWidth ) % mWidth;
+            int rightSource = b % mWidth;
+
+            row[b] = row[ mRadius + leftSource ];
+            row[ mRadius + mWidth + b ] = row[ mRadius + rightSource ];
+            }
+        }
+
+    // then whole rows above and below
+    for( int b=0; b<mRadius; b++ ) {
+        int topSource = ( ( b - mRadius ) % mHeight + mHeight ) % mHeight;
+        int bottomSource = b % mHeight;
+
+        memcpy( &( inPlane[ b * mPaddedWidth ] ),
+                &( inPlane[ ( mRadius + topSource ) * mPaddedWidth ] ),
+                mPaddedWidth * sizeof( uint16_t ) );
+        memcpy( &( inPlane[ ( mRadius + mHeight + b ) * mPaddedWidth ] ),
+                &( inPlane[ ( mRadius + bottomSource ) * mPaddedWidth ] ),
+                mPaddedWidth * sizeof( uint16_t ) );
+        }
+    }
+
+
+
+void ColorAutomaton::step( int inNumSteps ) {
+    int implementation = getKernelImplementation();
+
+    for( int s=0; s<inNumSteps; s++ ) {
+
+        for( int c=0; c<3; c++ ) {
+            uint16_t *plane = &( mPlanes[ c * mPlaneSize ] );
+            uint16_t *nextPlane = &( mNextPlanes[ c * mPlaneSize ] );
+
+            fillBorders( plane );
+
+            for( int y=0; y<mHeight; y++ ) {
+                // window for cell 0 of this row starts at the top left
+                // corner of the border around it
+                uint16_t *window = &( plane[ y * mPaddedWidth ] );
+                uint16_t *outRow =
+                    &( nextPlane[ ( y + mRadius ) * mPaddedWidth +
+                                  mRadius ] );
+
+                int numDone = 0;
+
+#ifdef CPU_FEATURES_X86
+                if( implementation >= 2 ) {
+                    numDone = stepRowAVX2( window, mNumTaps, mTapOffsets,
+                                           mTapWeights, outRow, mWidth );
+                    }
+                else if( implementation == 1 ) {
+                    numDone = stepRowSSE2( window, mNumTaps, mTapOffsets,
+                                           mTapWeights, outRow, mWidth );
+                    }
+#endif
+
+                stepRowPortable( window, mNumTaps, mTapOffsets, mTapWeights,
+                                 outRow, numDone, mWidth );
+                }
+            }
+
+        uint16_t *temp = mPlanes;
+        mPlanes = mNextPlanes;
+        mNextPlanes = temp;
+        }
+    }
@@ -0,0 +1,123 @@
+#ifndef COLOR_AUTOMATON_INCLUDED
+#define COLOR_AUTOMATON_INCLUDED
+
+
+#include <stdint.h>
+
+
+
+/**
+ * A grid of 0x00RRGGBB cells that wraps at the edges.  Each step sets
+ * every channel of every cell to the sum of an integer matrix times the
+ * same channel of the cells around it, modulo 256.
+ *
+ * Channels are kept as separate 16-bit planes with a wrapped border, so
+ * that whole rows are stepped at once by SSE2 or AVX2 kernels where
+ * available.  Low bytes of 16-bit sums are exact, so every
+ * implementation gives the same cells.
+ *
+ * @author Jason Rohrer
+ */
+class ColorAutomaton {
+
+    public:
+
+
+        /**
+         * Constructs an automaton with all cells 0.
+         *
+         * @param inWidth the width of the grid in cells.
+         * @param inHeight the height of the grid in cells.
+         * @param inMatrix the (2 * inRadius + 1) square matrix, where
+         *   inMatrix[i][j] multiplies the cell at offset
+         *   ( i - inRadius, j - inRadius ) in x and y.
+         *   Copied internally, so must be destroyed by caller.
+         * @param inRadius the radius of the matrix.
+         */
+        ColorAutomaton( int inWidth, int inHeight, int **inMatrix,
+                        int inRadius );
+
+        ~ColorAutomaton();
+
+
+        int getWidth();
+
+        int getHeight();
+
+
+        /**
+         * Sets all cells.
+         *
+         * @param inCells width * height cells in row order.  Only the
+         *   low 24 bits of each are used.
+         *   Must be destroyed by caller.
+         */
+        void setCells( unsigned long *inCells );
+
+
+        /**
+         * Gets all cells.
+         *
+         * @param outCells array of width * height cells to fill, in row
+         *   order.
+         *   Must be destroyed by caller.
+         */
+        void getCells( unsigned long *outCells );
+
+
+        /**
+         * Steps every cell.
+         *
+         * @param inNumSteps the number of steps to take.
+         */
+        void step( int inNumSteps = 1 );
+
+
+        /**
+         * Gets the row kernel implementation in use.
+         *
+         * @return 0 for portable code, 1 for SSE2, or 2 for AVX2.
+         */
+        static int getKernelImplementation();
+
+
+        /**
+         * Limits which row kernel implementation can be used, mostly for
+         * testing and benchmarking.
+         *
+         * @param inMaxImplementation the highest implementation to use,
+         *   if supported by this CPU, as numbered by
+         *   getKernelImplementation.
+         */
+        static void setKernelImplementationLimit( int inMaxImplementation );
+
+
+    private:
+
+        int mWidth;
+        int mHeight;
+        int mRadius;
+
+        // planes include a border of mRadius cells on every side
+        int mPaddedWidth;
+        int mPaddedHeight;
+        int mPlaneSize;
+
+        // red, green, and blue planes, one after another
+        uint16_t *mPlanes;
+        uint16_t *mNextPlanes;
+
+        // non-zero matrix entries, as offsets from the top left corner
+        // of the window in the padded plane
+        int mNumTaps;
+        int *mTapOffsets;
+        uint16_t *mTapWeights;
+
+
+        // copies cells across the edges into the border
+        void fillBorders( uint16_t *inPlane );
+    };
+
+
+
+#endif
@@ -0,0 +1,264 @@
+// Checks ColorAutomaton against the original cell-by-cell stepper from
+// AutomataTest, for every kernel implementation, then measures cells
+// stepped per second each way.
+//
+// Usage:  automatonBenchmark
+
+
+#include "ColorAutomaton.h"
+
+#include "minorGems/util/random/XoshiroRandomSource.h"
+#include "minorGems/system/Time.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+int failures = 0;
+
+
+void check( char inPassed, const char *inWhat, int inLevel ) {
+    if( !inPassed ) {
+        printf( "FAILED:  %s, implementation %d\n", inWhat, inLevel );
+        failures++;
+        }
+    }
+
+
+
+// the original step from AutomataTest, with a double matrix
+void stepCells( unsigned long *inGrid, int inWidth, int inHeight,
+                double **inMatrix, int inRadius ) {
+    int matrixSize = 2 * inRadius + 1;
+    int numCells = inWidth * inHeight;
+
+    unsigned long *newGrid = new unsigned long[ numCells ];
+
+    for( int x=0; x<inWidth; x++ ) {
+        for( int y=0; y<inHeight; y++ ) {
+
+            double newRed = 0;
+            double newGreen = 0;
+            double newBlue = 0;
+
+            for( int i=0; i<matrixSize; i++ ) {
+                for( int j=0; j<matrixSize; j++ ) {
+                    int gridX = ( x + i - inRadius ) % inWidth;
+                    int gridY = ( y + j - inRadius ) % inHeight;
+
+                    if( gridX < 0 ) {
+                        gridX = inWidth + gridX;
+                        }
+                    if( gridY < 0 ) {
+                        gridY = inHeight + gridY;
+                        }
+
+                    unsigned long gridVal = inGrid[ gridY * inWidth + gridX ];
+
+                    newRed += ( gridVal >> 16 & 0xFF ) * inMatrix[i][j];
+                    newGreen += ( gridVal >> 8 & 0xFF ) * inMatrix[i][j];
+                    newBlue += ( gridVal & 0xFF ) * inMatrix[i][j];
+                    }
+                }
+
+            int newRedInt = ( (int)newRed ) % 256;
+            int newGreenInt = ( (int)newGreen ) % 256;
+            int newBlueInt = ( (int)newBlue ) % 256;
+
+            if( newRedInt < 0 ) {
+                newRedInt += 256;
+                }
+            if( newGreenInt < 0 ) {
+                newGreenInt += 256;
+                }
+            if( newBlueInt < 0 ) {
+                newBlueInt += 256;
+                }
+
+            newGrid[ y * inWidth + x ] =
+                newRedInt << 16 | newGreenInt << 8 | newBlueInt;
+            }
+        }
+
+    memcpy( inGrid, newGrid, sizeof( unsigned long ) * numCells );
+    delete [] newGrid;
+    }
+
+
+
+// the zero-sum magic square from AutomataTest, or random weights
+void makeMatrix( int inRadius, char inRandom, RandomSource *inRandSource,
+                 int ***outMatrix, double ***outDoubleMatrix ) {
+    int matrixSize = 2 * inRadius + 1;
+
+    int magic[3][3] = { { -1, -2, 3 }, { 4, 0, -4 }, { -3, 2, 1 } };
+
+    int **matrix = new int*[ matrixSize ];
+    double **doubleMatrix = new double*[ matrixSize ];
+
+    for( int i=0; i<matrixSize; i++ ) {
+        matrix[i] = new int[ matrixSize ];
+        doubleMatrix[i] = new double[ matrixSize ];
+
+        for( int j=0; j<matrixSize; j++ ) {
+            if( inRandom ) {
+                matrix[i][j] = inRandSource->getRandomBoundedInt( -20, 20 );
+                }
+            else {
+                matrix[i][j] = magic[i][j];
+                }
+            doubleMatrix[i][j] = matrix[i][j];
+            }
+        }
+
+    *outMatrix = matrix;
+    *outDoubleMatrix = doubleMatrix;
+    }
+
+
+
+void destroyMatrix( int inRadius, int **inMatrix, double **inDoubleMatrix ) {
+    for( int i=0; i<2 * inRadius + 1; i++ ) {
+        delete [] inMatrix[i];
+        delete [] inDoubleMatrix[i];
+        }
+    delete [] inMatrix;
+    delete [] inDoubleMatrix;
+    }
+
+
+
+void checkImplementation( int inLevel, int inWidth, int inHeight,
+                          int inRadius, char inRandomMatrix,
+                          RandomSource *inRandSource ) {
+    ColorAutomaton::setKernelImplementationLimit( inLevel );
+
+    int **matrix;
+    double **doubleMatrix;
+    makeMatrix( inRadius, inRandomMatrix, inRandSource,
+                &matrix, &doubleMatrix );
+
+    int numCells = inWidth * inHeight;
+    unsigned long *grid = new unsigned long[ numCells ];
+    unsigned long *cells = new unsigned long[ numCells ];
+
+    for( int i=0; i<numCells; i++ ) {
+        grid[i] = (unsigned long)inRandSource->getRandomBoundedInt(
+            0, 0xFFFFFF );
+        }
+
+    ColorAutomaton automaton( inWidth, inHeight, matrix, inRadius );
+    automaton.setCells( grid );
+
+    char allMatch = true;
+    for( int s=0; s<20; s++ ) {
+        stepCells( grid, inWidth, inHeight, doubleMatrix, inRadius );
+        automaton.step();
+
+        automaton.getCells( cells );
+        if( memcmp( grid, cells, sizeof( unsigned long ) * numCells ) != 0 ) {
+            allMatch = false;
+            }
+        }
+
+    char what[100];
+    sprintf( what, "%dx%d grid, radius %d", inWidth, inHeight, inRadius );
+    check( allMatch, what, inLevel );
+
+    delete [] grid;
+    delete [] cells;
+    destroyMatrix( inRadius, matrix, doubleMatrix );
+    }
+
+
+
+int main() {
+    XoshiroRandomSource randSource( 12345 );
+
+    int maxLevel = ColorAutomaton::getKernelImplementation();
+
+    for( int level=0; level<=maxLevel; level++ ) {
+        // the AutomataTest grid, odd widths for the portable tail, and
+        // grids narrower than the matrix, which wrap more than once
+        checkImplementation( level, 50, 50, 1, false, &randSource );
+        checkImplementation( level, 37, 21, 1, true, &randSource );
+        checkImplementation( level, 101, 64, 2, true, &randSource );
+        checkImplementation( level, 3, 2, 3, true, &randSource );
+        }
+
+    if( failures == 0 ) {
+        printf( "All steps match cell-by-cell stepping for "
+                "implementations 0 to %d\n", maxLevel );
+        }
+
+
+    const char *names[4] = { "cell by cell",
+                             "portable",
+                             "SSE2",
+                             "AVX2" };
+
+    int sizes[3] = { 50, 512, 2048 };
+
+    int **matrix;
+    double **doubleMatrix;
+    makeMatrix( 1, false, &randSource, &matrix, &doubleMatrix );
+
+    for( int s=0; s<3; s++ ) {
+        int size = sizes[s];
+        int numCells = size * size;
+
+        printf( "\n%dx%d grid, million cells per second:\n", size, size );
+
+        unsigned long *grid = new unsigned long[ numCells ];
+        for( int i=0; i<numCells; i++ ) {
+            grid[i] = (unsigned long)randSource.getRandomBoundedInt(
+                0, 0xFFFFFF );
+            }
+
+        ColorAutomaton automaton( size, size, matrix, 1 );
+        automaton.setCells( grid );
+
+        double baseRate = 0;
+        for( int level=-1; level<=maxLevel; level++ ) {
+            if( level >= 0 ) {
+                ColorAutomaton::setKernelImplementationLimit( level );
+                }
+
+            // at least a few steps, and long enough for the timer
+            int numSteps = 0;
+            double startTime = Time::getCurrentTime();
+            double time = 0;
+            while( numSteps < 3 || time < 0.5 ) {
+                if( level == -1 ) {
+                    stepCells( grid, size, size, doubleMatrix, 1 );
+                    }
+                else {
+                    automaton.step();
+                    }
+                numSteps++;
+                time = Time::getCurrentTime() - startTime;
+                }
+
+            double rate = (double)numSteps * numCells / time;
+            if( level == -1 ) {
+                baseRate = rate;
+                }
+            printf( "  %-16s %9.1f  (%.2fx)\n", names[ level + 1 ],
+                    rate / 1e6, rate / baseRate );
+            }
+
+        delete [] grid;
+        }
+
+    destroyMatrix( 1, matrix, doubleMatrix );
+
+
+    if( failures > 0 ) {
+        printf( "%d checks FAILED\n", failures );
+        return 1;
+        }
+    return 0;
+    }
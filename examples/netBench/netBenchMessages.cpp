@@ -0,0 +1,260 @@
+// Measures small-message send throughput over loopback for the different
+// Socket send paths, and counts the send-side system calls each one makes.
+//
+// Each message is a 4-byte header followed by a payload, sent without
+// Nagle delay (the way games send their messages).
+//
+// Must be linked with the --wrap flags in the Makefile, which route the
+// counted calls through the wrappers below.
+//
+// Usage:  netBenchMessages [port numMessages payloadBytes]
+
+
+#include "minorGems/network/SocketServer.h"
+#include "minorGems/network/SocketClient.h"
+#include "minorGems/network/Socket.h"
+#include "minorGems/network/HostAddress.h"
+
+#include "minorGems/system/Thread.h"
+#include "minorGems/system/Time.h"
+
+#include "minorGems/util/stringUtils.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+
+
+static int numSyscalls = 0;
+
+
+extern "C" {
+
+ssize_t __real_send( int inSock, const void *inBuffer, size_t inLength,
+                     int inFlags );
+ssize_t __real_sendmsg( int inSock, const struct msghdr *inMessage,
+                        int inFlags );
+int __real_setsockopt( int inSock, int inLevel, int inName,
+                       const void *inValue, socklen_t inLength );
+int __real_fcntl( int inFD, int inCommand, ... );
+
+
+ssize_t __wrap_send( int inSock, const void *inBuffer, size_t inLength,
+                     int inFlags ) {
+    numSyscalls++;
+    return __real_send( inSock, inBuffer, inLength, inFlags );
+    }
+
+ssize_t __wrap_sendmsg( int inSock, const struct msghdr *inMessage,
+                        int inFlags ) {
+    numSyscalls++;
+    return __real_sendmsg( inSock, inMessage, inFlags );
+    }
+
+int __wrap_setsockopt( int inSock, int inLevel, int inName,
+                       const void *inValue, socklen_t inLength ) {
+    numSyscalls++;
+    return __real_setsockopt( inSock, inLevel, inName, inValue, inLength );
+    }
+
+// every fcntl use in Socket takes an int or no argument
+int __wrap_fcntl( int inFD, int inCommand, ... ) {
+    va_list args;
+    va_start( args, inCommand );
+    long arg = va_arg( args, long );
+    va_end( args );
+
+    numSyscalls++;
+    return __real_fcntl( inFD, inCommand, arg );
+    }
+
+}
+
+
+
+class ReceiverThread : public Thread {
+    public:
+        ReceiverThread( Socket *inSocket, long inBytesExpected )
+                : mSocket( inSocket ), mBytesExpected( inBytesExpected ),
+                  mBytesReceived( 0 ) {
+            start();
+            }
+
+        ~ReceiverThread() {
+            join();
+            }
+
+        void run() {
+            unsigned char buffer[ 65536 ];
+
+            while( mBytesReceived < mBytesExpected ) {
+                int numRead = mSocket->receive( buffer, sizeof( buffer ),
+                                                5000 );
+                if( numRead < 0 ) {
+                    printf( "Receive failed\n" );
+                    return;
+                    }
+                mBytesReceived += numRead;
+                }
+            }
+
+        long getBytesReceived() {
+            return mBytesReceived;
+            }
+
+    protected:
+        Socket *mSocket;
+        long mBytesExpected;
+        long mBytesReceived;
+    };
+
+
+
+static int port = 5888;
+static int numMessages = 200000;
+static int payloadBytes = 60;
+
+
+enum SendMode {
+    TWO_SENDS,
+    PERSISTENT_TWO_SENDS,
+    PERSISTENT_GATHER
+    };
+
+
+
+// keeps calling a non-blocking send until it goes through
+// returns false on error
+static char sendNonBlocking( Socket *inSocket, SendMode inMode,
+                             unsigned char *inHeader,
+                             unsigned char *inPayload ) {
+
+    unsigned char *buffers[2] = { inHeader, inPayload };
+    int lengths[2] = { 4, payloadBytes };
+
+    int totalBytes = 4 + payloadBytes;
+
+    int sent = 0;
+
+    // would-block retries keep all state in buffers/lengths
+    int b = 0;
+    while( sent < totalBytes ) {
+        int result;
+
+        if( inMode == PERSISTENT_GATHER ) {
+            result = inSocket->sendGather( &( buffers[b] ), &( lengths[b] ),
+                                           2 - b, false, false );
+            }
+        else {
+            result = inSocket->send( buffers[b], lengths[b], false, false );
+            }
+
+        if( result == -1 ) {
+            return false;
+            }
+        if( result == -2 ) {
+            continue;
+            }
+
+        sent += result;
+
+        while( b < 2 && result >= lengths[b] ) {
+            result -= lengths[b];
+            b++;
+            }
+        if( b < 2 ) {
+            buffers[b] += result;
+            lengths[b] -= result;
+            }
+        }
+    return true;
+    }
+
+
+
+static void runMode( SocketServer *inServer, const char *inName,
+                     SendMode inMode ) {
+
+    HostAddress address( stringDuplicate( "127.0.0.1" ), port );
+
+    Socket *sendSocket = SocketClient::connectToServer( &address );
+    Socket *receiveSocket = inServer->acceptConnection();
+
+    if( sendSocket == NULL || receiveSocket == NULL ) {
+        printf( "Failed to connect over loopback\n" );
+        exit( 1 );
+        }
+
+    if( inMode != TWO_SENDS ) {
+        sendSocket->setPersistentNonBlocking();
+        }
+
+    long totalBytes = (long)numMessages * ( 4 + payloadBytes );
+
+    ReceiverThread *receiver = new ReceiverThread( receiveSocket,
+                                                   totalBytes );
+
+    unsigned char header[4];
+    unsigned char *payload = new unsigned char[ payloadBytes ];
+    for( int i=0; i<payloadBytes; i++ ) {
+        payload[i] = (unsigned char)i;
+        }
+
+    numSyscalls = 0;
+
+    double startTime = Time::getCurrentTime();
+
+    for( int m=0; m<numMessages; m++ ) {
+        header[0] = (unsigned char)( m >> 24 );
+        header[1] = (unsigned char)( m >> 16 );
+        header[2] = (unsigned char)( m >> 8 );
+        header[3] = (unsigned char)( m );
+
+        if( ! sendNonBlocking( sendSocket, inMode, header, payload ) ) {
+            printf( "Send failed\n" );
+            break;
+            }
+        }
+
+    int sendSyscalls = numSyscalls;
+
+    delete receiver;
+
+    double totalTime = Time::getCurrentTime() - startTime;
+
+    printf( "%-28s %10.0f messages/sec   %6.2f send syscalls/message\n",
+            inName, numMessages / totalTime,
+            sendSyscalls / (double)numMessages );
+
+    delete [] payload;
+    delete sendSocket;
+    delete receiveSocket;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    if( inNumArgs == 4 ) {
+        port = atoi( inArgs[1] );
+        numMessages = atoi( inArgs[2] );
+        payloadBytes = atoi( inArgs[3] );
+        }
+
+    SocketServer *server = new SocketServer( port, 10 );
+
+    printf( "%d messages of 4 + %d bytes over loopback\n\n",
+            numMessages, payloadBytes );
+
+    runMode( server, "two sends (old path)", TWO_SENDS );
+    runMode( server, "two sends, persistent", PERSISTENT_TWO_SENDS );
+    runMode( server, "gather send, persistent", PERSISTENT_GATHER );
+
+    delete server;
+
+    return 0;
+    }
@@ -0,0 +1,575 @@
+#include "DeflateOutputStream.h"
+
+#include "miniz.h"
+
+#include <string.h>
+
+
+
+// serial mode output buffer
+#define OUT_BUFFER_SIZE 65536
+
+// blocks in flight per thread in parallel mode
+#define BLOCKS_PER_THREAD 2
+
+
+
+// combines adler32 of two adjacent pieces of data
+// same as zlib's adler32_combine
+static unsigned int combineAdler32( unsigned int inAdlerA,
+                                    unsigned int inAdlerB,
+                                    unsigned int inLengthB ) {
+    const unsigned int base = 65521;
+
+    unsigned int rem = inLengthB % base;
+    unsigned int sum1 = inAdlerA & 0xFFFF;
+    unsigned int sum2 = ( rem * sum1 ) % base;
+
+    sum1 += ( inAdlerB & 0xFFFF ) + base - 1;
+    sum2 += ( ( inAdlerA >> 16 ) & 0xFFFF ) + ( ( inAdlerB >> 16 ) & 0xFFFF )
+        + base - rem;
+
+    if( sum1 >= base ) {
+        sum1 -= base;
+        }
+    if( sum1 >= base ) {
+        sum1 -= base;
+        }
+    if( sum2 >= 2 * base ) {
+        sum2 -= 2 * base;
+        }
+    if( sum2 >= base ) {
+        sum2 -= base;
+        }
+    return sum1 | ( sum2 << 16 );
+    }
+
+
+
+DeflateOutputStream::DeflateOutputStream( OutputStream *inOutput,
+                                          int inLevel,
+                                          int inNumThreads,
+                                          int inBlockSize )
+        : mOutput( inOutput ),
+          mLevel( inLevel ),
+          mNumThreads( inNumThreads ),
+          mBlockSize( inBlockSize ),
+          mFinished( false ),
+          mFailed( false ),
+          mNumBytesIn( 0 ),
+          mNumBytesOut( 0 ),
+          mStream( NULL ),
+          mOutBuffer( NULL ),
+          mCurrentBlock( NULL ),
+          mAdler( 1 ),
+          mHeaderWritten( false ),
+          mStopping( false ) {
+
+    // 10 is not zlib compatible
+    if( mLevel < -1 ) {
+        mLevel = -1;
+        }
+    else if( mLevel > 9 ) {
+        mLevel = 9;
+        }
+
+    if( mNumThreads < 0 ) {
+        mNumThreads = 0;
+        }
+    if( mBlockSize < 1024 ) {
+        mBlockSize = 1024;
+        }
+
+
+    if( mNumThreads == 0 ) {
+        mStream = new mz_stream;
+        memset( mStream, 0, sizeof( mz_stream ) );
+
+        mz_deflateInit( mStream, mLevel );
+
+        mOutBuffer = new unsigned char[ OUT_BUFFER_SIZE ];
+        }
+    else {
+        for( int i=0; i<mNumThreads; i++ ) {
+            mThreads.push_back( new DeflateThread( this ) );
+            }
+        }
+    }
+
+
+
+DeflateOutputStream::~DeflateOutputStream() {
+    finish();
+
+    if( mStream != NULL ) {
+        mz_deflateEnd( mStream );
+        delete mStream;
+        }
+    if( mOutBuffer != NULL ) {
+        delete [] mOutBuffer;
+        }
+
+
+    mLock.lock();
+    mStopping = true;
+    mLock.unlock();
+
+    // each thread passes this along to the next one as it exits
+    mQueuedSignal.signal();
+
+    for( int i=0; i<mThreads.size(); i++ ) {
+        delete mThreads.getElementDirect( i );
+        }
+
+    // finish leaves no blocks in flight
+    for( int i=0; i<mFreeBlocks.size(); i++ ) {
+        DeflateBlock *block = mFreeBlocks.getElementDirect( i );
+
+        delete [] block->input;
+        if( block->output != NULL ) {
+            delete [] block->output;
+            }
+        delete block;
+        }
+    }
+
+
+
+char DeflateOutputStream::finish() {
+    if( mFinished ) {
+        return ! mFailed;
+        }
+    mFinished = true;
+
+    if( mNumThreads == 0 ) {
+        if( mFailed ) {
+            return false;
+            }
+
+        mStream->next_in = NULL;
+        mStream->avail_in = 0;
+
+        return deflateSerial( MZ_FINISH );
+        }
+
+
+    if( mCurrentBlock == NULL ) {
+        mCurrentBlock = getFreeBlock();
+        }
+    submitCurrentBlock( true );
+
+    // wait for everything, even after a failure, so that no block is
+    // left with a worker
+    while( mInFlightBlocks.size() > 0 ) {
+        writeDoneBlocks( true );
+        }
+
+    return ! mFailed;
+    }
+
+
+
+void DeflateOutputStream::reset( OutputStream *inOutput ) {
+    finish();
+
+    mOutput = inOutput;
+    mFinished = false;
+    mFailed = false;
+    mNumBytesIn = 0;
+    mNumBytesOut = 0;
+    mAdler = 1;
+    mHeaderWritten = false;
+
+    if( mStream != NULL ) {
+        mz_deflateReset( mStream );
+        }
+    }
+
+
+
+double DeflateOutputStream::getNumBytesIn() {
+    return mNumBytesIn;
+    }
+
+
+
+double DeflateOutputStream::getNumBytesOut() {
+    return mNumBytesOut;
+    }
+
+
+
+long DeflateOutputStream::write( unsigned char *inBuffer,
+                                 long inNumBytes ) {
+    if( mFinished ) {
+        setNewLastErrorConst( "Write to finished DeflateOutputStream" );
+        return -1;
+        }
+    if( mFailed ) {
+        return -1;
+        }
+
+    mNumBytesIn += inNumBytes;
+
+
+    if( mNumThreads == 0 ) {
+        unsigned char *next = inBuffer;
+        long remaining = inNumBytes;
+
+        // avail_in is 32 bits
+        while( remaining > 0 ) {
+            unsigned int numThisTime = 1 << 30;
+
+            if( remaining < numThisTime ) {
+                numThisTime = remaining;
+                }
+
+            mStream->next_in = next;
+            mStream->avail_in = numThisTime;
+
+            if( ! deflateSerial( MZ_NO_FLUSH ) ) {
+                return -1;
+                }
+
+            next += numThisTime;
+            remaining -= numThisTime;
+            }
+
+        return inNumBytes;
+        }
+
+
+    unsigned char *next = inBuffer;
+    long remaining = inNumBytes;
+
+    while( remaining > 0 ) {
+        if( mCurrentBlock == NULL ) {
+            mCurrentBlock = getFreeBlock();
+            }
+
+        int space = mBlockSize - mCurrentBlock->inputLength;
+
+        int numThisTime = space;
+        if( remaining < numThisTime ) {
+            numThisTime = remaining;
+            }
+
+        memcpy( &( mCurrentBlock->input[ mCurrentBlock->inputLength ] ),
+                next, numThisTime );
+
+        mCurrentBlock->inputLength += numThisTime;
+        next += numThisTime;
+        remaining -= numThisTime;
+
+        if( mCurrentBlock->inputLength == mBlockSize ) {
+            if( ! submitCurrentBlock( false ) ) {
+                return -1;
+                }
+            }
+        }
+
+    return inNumBytes;
+    }
+
+
+
+char DeflateOutputStream::deflateSerial( int inFlush ) {
+
+    while( true ) {
+        mStream->next_out = mOutBuffer;
+        mStream->avail_out = OUT_BUFFER_SIZE;
+
+        int result = mz_deflate( mStream, inFlush );
+
+        int numOut = OUT_BUFFER_SIZE - mStream->avail_out;
+
+        if( numOut > 0 && ! writeOutput( mOutBuffer, numOut ) ) {
+            return false;
+            }
+
+        if( result == MZ_STREAM_END ) {
+            return true;
+            }
+
+        if( result != MZ_OK && result != MZ_BUF_ERROR ) {
+            mFailed = true;
+            setNewLastErrorConst( "Compression failed" );
+            return false;
+            }
+
+        if( inFlush != MZ_FINISH &&
+            mStream->avail_in == 0 && mStream->avail_out != 0 ) {
+            // all input consumed, no output pending
+            return true;
+            }
+        }
+    }
+
+
+
+char DeflateOutputStream::writeOutput( unsigned char *inBytes,
+                                       int inNumBytes ) {
+    if( mFailed ) {
+        return false;
+        }
+
+    long numWritten = mOutput->write( inBytes, inNumBytes );
+
+    if( numWritten != inNumBytes ) {
+        mFailed = true;
+        setNewLastErrorConst( "Write to underlying stream failed" );
+        return false;
+        }
+
+    mNumBytesOut += inNumBytes;
+    return true;
+    }
+
+
+
+DeflateBlock *DeflateOutputStream::getFreeBlock() {
+    DeflateBlock *block;
+
+    int numFree = mFreeBlocks.size();
+
+    if( numFree > 0 ) {
+        block = mFreeBlocks.getElementDirect( numFree - 1 );
+        mFreeBlocks.deleteElement( numFree - 1 );
+        }
+    else {
+        block = new DeflateBlock;
+        block->input = new unsigned char[ mBlockSize ];
+        block->output = NULL;
+        block->outputCapacity = 0;
+        }
+
+    block->inputLength = 0;
+    block->outputLength = 0;
+    block->adler = 1;
+    block->last = false;
+    block->done = false;
+    block->failed = false;
+
+    return block;
+    }
+
+
+
+char DeflateOutputStream::submitCurrentBlock( char inLast ) {
+    DeflateBlock *block = mCurrentBlock;
+    mCurrentBlock = NULL;
+
+    block->last = inLast;
+
+    // bound memory use
+    while( mInFlightBlocks.size() >= BLOCKS_PER_THREAD * mNumThreads ) {
+        writeDoneBlocks( true );
+        }
+
+    mInFlightBlocks.push_back( block );
+
+    mLock.lock();
+    mQueuedBlocks.push_back( block );
+    mLock.unlock();
+
+    mQueuedSignal.signal();
+
+    writeDoneBlocks( false );
+
+    return ! mFailed;
+    }
+
+
+
+char DeflateOutputStream::writeDoneBlocks( char inWait ) {
+
+    while( mInFlightBlocks.size() > 0 ) {
+        DeflateBlock *block = mInFlightBlocks.getElementDirect( 0 );
+
+        mLock.lock();
+        char done = block->done;
+        mLock.unlock();
+
+        if( ! done ) {
+            if( ! inWait ) {
+                break;
+                }
+            mDoneSignal.wait( 100 );
+            continue;
+            }
+
+        // only wait for one
+        inWait = false;
+
+        mInFlightBlocks.deleteElement( 0 );
+
+        if( block->failed && ! mFailed ) {
+            mFailed = true;
+            setNewLastErrorConst( "Compression failed" );
+            }
+
+        if( ! mFailed ) {
+            if( ! mHeaderWritten ) {
+                // zlib header, 32K window, no dictionary
+                // miniz, used for serial streams and zipCompress, always
+                // gives the fastest-level hint, whatever the level, so
+                // parallel streams do the same and start with the same
+                // bytes
+                unsigned char header[2] = { 0x78, 0x01 };
+
+                writeOutput( header, 2 );
+                mHeaderWritten = true;
+                }
+
+            writeOutput( block->output, block->outputLength );
+
+            mAdler = combineAdler32( mAdler, block->adler,
+                                     block->inputLength );
+
+            if( block->last ) {
+                unsigned char trailer[4];
+                trailer[0] = (unsigned char)( mAdler >> 24 );
+                trailer[1] = (unsigned char)( mAdler >> 16 );
+                trailer[2] = (unsigned char)( mAdler >> 8 );
+                trailer[3] = (unsigned char)( mAdler );
+
+                writeOutput( trailer, 4 );
+                }
+            }
+
+        mFreeBlocks.push_back( block );
+        }
+
+    return ! mFailed;
+    }
+
+
+
+void DeflateOutputStream::runWorker() {
+    mz_stream compressor;
+    memset( &compressor, 0, sizeof( mz_stream ) );
+
+    // raw deflate, header and trailer are written by caller thread
+    mz_deflateInit2( &compressor, mLevel, MZ_DEFLATED,
+                     -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY );
+
+    while( processNextBlock( &compressor ) ) {
+        }
+
+    mz_deflateEnd( &compressor );
+    }
+
+
+
+char DeflateOutputStream::processNextBlock( mz_stream *inCompressor ) {
+    mLock.lock();
+
+    if( mQueuedBlocks.size() == 0 ) {
+        char stopping = mStopping;
+        mLock.unlock();
+
+        if( stopping ) {
+            // wake next thread so it can exit too
+            mQueuedSignal.signal();
+            return false;
+            }
+
+        mQueuedSignal.wait( 100 );
+        return true;
+        }
+
+    DeflateBlock *block = mQueuedBlocks.getElementDirect( 0 );
+    mQueuedBlocks.deleteElement( 0 );
+
+    char moreQueued = ( mQueuedBlocks.size() > 0 );
+
+    mLock.unlock();
+
+    if( moreQueued ) {
+        // wake another thread
+        mQueuedSignal.signal();
+        }
+
+
+    compressBlock( inCompressor, block );
+
+
+    mLock.lock();
+    block->done = true;
+    mLock.unlock();
+
+    mDoneSignal.signal();
+
+    return true;
+    }
+
+
+
+void DeflateOutputStream::compressBlock( mz_stream *inCompressor,
+                                         DeflateBlock *inBlock ) {
+
+    inBlock->adler = mz_adler32( 1, inBlock->input, inBlock->inputLength );
+
+    // fresh history, same settings
+    mz_deflateReset( inCompressor );
+
+    // room for sync flush marker
+    int neededCapacity =
+        mz_deflateBound( inCompressor, inBlock->inputLength ) + 64;
+
+    if( inBlock->outputCapacity < neededCapacity ) {
+        if( inBlock->output != NULL ) {
+            delete [] inBlock->output;
+            }
+        inBlock->output = new unsigned char[ neededCapacity ];
+        inBlock->outputCapacity = neededCapacity;
+        }
+
+    inCompressor->next_in = inBlock->input;
+    inCompressor->avail_in = inBlock->inputLength;
+    inCompressor->next_out = inBlock->output;
+    inCompressor->avail_out = inBlock->outputCapacity;
+
+    // every block but the last ends on a byte boundary with a sync flush,
+    // so blocks can be concatenated
+    int flush = MZ_SYNC_FLUSH;
+    if( inBlock->last ) {
+        flush = MZ_FINISH;
+        }
+
+    while( true ) {
+        int result = mz_deflate( inCompressor, flush );
+
+        if( result == MZ_STREAM_END ) {
+            break;
+            }
+
+        if( result != MZ_OK ) {
+            inBlock->failed = true;
+            break;
+            }
+
+        if( inCompressor->avail_out == 0 ) {
+            // bound was not enough, grow and keep going
+            int used = inBlock->outputCapacity;
+            int newCapacity = inBlock->outputCapacity * 2;
+
+            unsigned char *newOutput = new unsigned char[ newCapacity ];
+            memcpy( newOutput, inBlock->output, used );
+            delete [] inBlock->output;
+
+            inBlock->output = newOutput;
+            inBlock->outputCapacity = newCapacity;
+
+            inCompressor->next_out = &( newOutput[ used ] );
+            inCompressor->avail_out = newCapacity - used;
+            }
+        else if( ! inBlock->last && inCompressor->avail_in == 0 ) {
+            // flushed
+            break;
+            }
+        }
+
+    inBlock->outputLength =
+        inBlock->outputCapacity - inCompressor->avail_out;
+    }
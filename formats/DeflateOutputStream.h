@@ -0,0 +1,242 @@
+#ifndef DEFLATE_OUTPUT_STREAM_INCLUDED
+#define DEFLATE_OUTPUT_STREAM_INCLUDED
+
+
+
+#include "minorGems/io/OutputStream.h"
+
+#include "minorGems/system/Thread.h"
+#include "minorGems/system/MutexLock.h"
+#include "minorGems/system/BinarySemaphore.h"
+
+#include "minorGems/util/SimpleVector.h"
+
+
+
+// miniz stream state, kept out of this header
+struct mz_stream_s;
+
+
+
+typedef struct DeflateBlock {
+        unsigned char *input;
+        int inputLength;
+
+        unsigned char *output;
+        int outputLength;
+        int outputCapacity;
+
+        // adler32 of input
+        unsigned int adler;
+
+        // final block of stream, ends with a final deflate block instead
+        // of a sync flush
+        char last;
+
+        char done;
+        char failed;
+    } DeflateBlock;
+
+
+
+class DeflateThread;
+
+
+
+/**
+ * Output stream that compresses everything written to it into a zlib
+ * stream (the format read by zipDecompress and InflateInputStream) on
+ * another output stream.
+ *
+ * Data is compressed incrementally, so memory use does not depend on
+ * the total size written.
+ *
+ * In the default serial mode, one compressor works on the caller's thread.
+ *
+ * In parallel mode, input is cut into independent blocks that are
+ * compressed on worker threads, each with no history from earlier blocks.
+ * Blocks are joined with sync flushes and written in order, so the result
+ * is still one ordinary zlib stream, slightly larger than a serial one.
+ * At most two blocks per thread are held in memory at once.
+ *
+ * @author Jason Rohrer
+ */
+class DeflateOutputStream : public OutputStream {
+
+    public:
+
+        /**
+         * Constructs a stream.
+         *
+         * @param inOutput the stream to write compressed data to.
+         *   Destroyed by caller after this class is destroyed.
+         * @param inLevel compression level, 0 (none) to 9 (best), or -1
+         *   for the same settings as zipCompress.  Defaults to -1.
+         * @param inNumThreads number of compression threads, or 0
+         *   to compress serially on the caller's thread.  Defaults to 0.
+         * @param inBlockSize bytes of input in each independent block
+         *   in parallel mode.  Defaults to 1 MiB.
+         */
+        DeflateOutputStream( OutputStream *inOutput,
+                             int inLevel = -1,
+                             int inNumThreads = 0,
+                             int inBlockSize = 1048576 );
+
+
+        // finishes stream if finish has not been called
+        virtual ~DeflateOutputStream();
+
+
+
+        /**
+         * Completes the compressed stream, writing any buffered data and
+         * the zlib trailer.  Further writes fail until reset is called.
+         *
+         * @return true on success, or false if a write to the underlying
+         *   stream failed.
+         */
+        char finish();
+
+
+
+        /**
+         * Starts a new compressed stream, reusing compressor state,
+         * buffers, and threads.  Finishes the current stream first if
+         * needed.
+         *
+         * @param inOutput the stream to write the new compressed data to.
+         *   Destroyed by caller after this class is destroyed.
+         */
+        void reset( OutputStream *inOutput );
+
+
+
+        /**
+         * Gets bytes written to and produced by this stream since
+         * construction or the last reset.
+         */
+        double getNumBytesIn();
+        double getNumBytesOut();
+
+
+
+        // implements OutputStream interface
+        virtual long write( unsigned char *inBuffer, long inNumBytes );
+
+
+
+    protected:
+
+        friend class DeflateThread;
+
+        // called by worker threads, returns when stream is shutting down
+        void runWorker();
+
+        // returns false if stream is shutting down and no work is left
+        char processNextBlock( struct mz_stream_s *inCompressor );
+
+
+        // serial mode
+
+        // runs compressor over the rest of the input in mStream
+        char deflateSerial( int inFlush );
+
+        // writes to mOutput, tracking errors
+        char writeOutput( unsigned char *inBytes, int inNumBytes );
+
+
+        // parallel mode
+
+        // queues mCurrentBlock as the next block in the stream
+        char submitCurrentBlock( char inLast );
+
+        // writes finished blocks that are next in order, waiting for the
+        // oldest one if inWait is set
+        char writeDoneBlocks( char inWait );
+
+        // compresses a block on worker's compressor
+        static void compressBlock( struct mz_stream_s *inCompressor,
+                                   DeflateBlock *inBlock );
+
+        DeflateBlock *getFreeBlock();
+
+
+        OutputStream *mOutput;
+
+        int mLevel;
+        int mNumThreads;
+        int mBlockSize;
+
+        char mFinished;
+        char mFailed;
+
+        double mNumBytesIn;
+        double mNumBytesOut;
+
+
+        struct mz_stream_s *mStream;
+
+        unsigned char *mOutBuffer;
+
+
+        // parallel mode
+
+        // block being filled by write, or NULL
+        DeflateBlock *mCurrentBlock;
+
+        // adler32 of all input in blocks written so far
+        unsigned int mAdler;
+        char mHeaderWritten;
+
+        // used by caller thread only
+        SimpleVector<DeflateBlock*> mFreeBlocks;
+
+        // submitted blocks in stream order, used by caller thread only
+        SimpleVector<DeflateBlock*> mInFlightBlocks;
+
+
+        // protects everything below, and done flags of blocks
+        MutexLock mLock;
+
+        // Semaphore is not safe with several waiting threads, so lists
+        // are checked under mLock, and these are only used to wake
+        // sleeping threads
+
+        // signaled when a block is done
+        BinarySemaphore mDoneSignal;
+
+        // signaled when a block is queued, or when stopping
+        BinarySemaphore mQueuedSignal;
+        SimpleVector<DeflateBlock*> mQueuedBlocks;
+
+        char mStopping;
+
+        SimpleVector<DeflateThread*> mThreads;
+    };
+
+
+
+class DeflateThread : public Thread {
+
+    public:
+
+        DeflateThread( DeflateOutputStream *inStream )
+                : mStream( inStream ) {
+            start();
+            }
+
+        ~DeflateThread() {
+            join();
+            }
+
+        void run() {
+            mStream->runWorker();
+            }
+
+    protected:
+        DeflateOutputStream *mStream;
+    };
+
+
+
+#endif
@@ -0,0 +1,133 @@
+#include "InflateInputStream.h"
+
+#include "miniz.h"
+
+#include <string.h>
+
+
+
+InflateInputStream::InflateInputStream( InputStream *inInput,
+                                        int inBufferSize )
+        : mInput( inInput ),
+          mInBufferSize( inBufferSize ),
+          mInputEnded( false ),
+          mStreamEnded( false ),
+          mFailed( false ),
+          mNumBytesIn( 0 ),
+          mNumBytesOut( 0 ) {
+
+    if( mInBufferSize < 1 ) {
+        mInBufferSize = 1;
+        }
+
+    mInBuffer = new unsigned char[ mInBufferSize ];
+
+    mStream = new mz_stream;
+    memset( mStream, 0, sizeof( mz_stream ) );
+
+    mz_inflateInit( mStream );
+    }
+
+
+
+InflateInputStream::~InflateInputStream() {
+    mz_inflateEnd( mStream );
+    delete mStream;
+
+    delete [] mInBuffer;
+    }
+
+
+
+void InflateInputStream::reset( InputStream *inInput ) {
+    mInput = inInput;
+
+    mInputEnded = false;
+    mStreamEnded = false;
+    mFailed = false;
+    mNumBytesIn = 0;
+    mNumBytesOut = 0;
+
+    // miniz has no inflateReset
+    mz_inflateEnd( mStream );
+    memset( mStream, 0, sizeof( mz_stream ) );
+    mz_inflateInit( mStream );
+    }
+
+
+
+char InflateInputStream::isEndOfStream() {
+    return mStreamEnded;
+    }
+
+
+
+double InflateInputStream::getNumBytesIn() {
+    return mNumBytesIn;
+    }
+
+
+
+double InflateInputStream::getNumBytesOut() {
+    return mNumBytesOut;
+    }
+
+
+
+long InflateInputStream::read( unsigned char *inBuffer, long inNumBytes ) {
+    if( mFailed ) {
+        return -1;
+        }
+
+    // avail_out is 32 bits
+    if( inNumBytes > ( 1 << 30 ) ) {
+        inNumBytes = 1 << 30;
+        }
+
+    mStream->next_out = inBuffer;
+    mStream->avail_out = inNumBytes;
+
+    while( mStream->avail_out > 0 && ! mStreamEnded ) {
+
+        if( mStream->avail_in == 0 && ! mInputEnded ) {
+            long numRead = mInput->read( mInBuffer, mInBufferSize );
+
+            if( numRead <= 0 ) {
+                mInputEnded = true;
+                }
+            else {
+                mStream->next_in = mInBuffer;
+                mStream->avail_in = numRead;
+                mNumBytesIn += numRead;
+                }
+            }
+
+        int result = mz_inflate( mStream, MZ_NO_FLUSH );
+
+        if( result == MZ_STREAM_END ) {
+            mStreamEnded = true;
+            }
+        else if( result == MZ_BUF_ERROR ) {
+            // no progress possible without more input
+            if( mInputEnded && mStream->avail_in == 0 ) {
+                mFailed = true;
+                setNewLastErrorConst( "Compressed stream is truncated" );
+                break;
+                }
+            }
+        else if( result != MZ_OK ) {
+            mFailed = true;
+            setNewLastErrorConst( "Compressed stream is corrupt" );
+            break;
+            }
+        }
+
+    long numOut = inNumBytes - mStream->avail_out;
+
+    mNumBytesOut += numOut;
+
+    if( mFailed && numOut == 0 ) {
+        return -1;
+        }
+    return numOut;
+    }
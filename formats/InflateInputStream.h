@@ -0,0 +1,101 @@
+#ifndef INFLATE_INPUT_STREAM_INCLUDED
+#define INFLATE_INPUT_STREAM_INCLUDED
+
+
+
+#include "minorGems/io/InputStream.h"
+
+
+
+// miniz stream state, kept out of this header
+struct mz_stream_s;
+
+
+
+/**
+ * Input stream that decompresses a zlib stream (as written by
+ * zipCompress or DeflateOutputStream) read from another input stream.
+ *
+ * Data is decompressed incrementally, so memory use does not depend on
+ * the total size read.
+ *
+ * Decompression is always serial, including for streams written by
+ * DeflateOutputStream in parallel mode, since block boundaries in a
+ * deflate stream cannot be found without decoding everything before them.
+ *
+ * @author Jason Rohrer
+ */
+class InflateInputStream : public InputStream {
+
+    public:
+
+        /**
+         * Constructs a stream.
+         *
+         * @param inInput the stream to read compressed data from.
+         *   Destroyed by caller after this class is destroyed.
+         * @param inBufferSize size of compressed read buffer.
+         *   Defaults to 64 KiB.
+         */
+        InflateInputStream( InputStream *inInput,
+                            int inBufferSize = 65536 );
+
+        virtual ~InflateInputStream();
+
+
+
+        /**
+         * Starts reading a new compressed stream, reusing decompressor
+         * state and buffers.
+         *
+         * @param inInput the stream to read the new compressed data from.
+         *   Destroyed by caller after this class is destroyed.
+         */
+        void reset( InputStream *inInput );
+
+
+
+        /**
+         * Returns true once the end of the compressed stream has been
+         * reached and all data has been read.
+         */
+        char isEndOfStream();
+
+
+
+        /**
+         * Gets bytes consumed from the underlying stream and returned by
+         * this stream since construction or the last reset.
+         */
+        double getNumBytesIn();
+        double getNumBytesOut();
+
+
+
+        // implements InputStream interface
+        // returns fewer bytes than requested only at end of stream,
+        // and 0 after end of stream
+        virtual long read( unsigned char *inBuffer, long inNumBytes );
+
+
+
+    protected:
+
+        InputStream *mInput;
+
+        struct mz_stream_s *mStream;
+
+        unsigned char *mInBuffer;
+        int mInBufferSize;
+
+        char mInputEnded;
+        char mStreamEnded;
+        char mFailed;
+
+        double mNumBytesIn;
+        double mNumBytesOut;
+    };
+
+
+
+#endif
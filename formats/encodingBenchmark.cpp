@@ -0,0 +1,520 @@
+// Round-trip fuzz test and throughput benchmark for the hex and base64
+// codecs in encodingUtils.
+//
+// The fuzz test runs at each vectorization level this processor
+// supports, comparing every result against a copy of the original
+// byte-at-a-time code.  Inputs have random lengths and contents, and
+// decoder inputs get random garbage, line breaks, and invalid hex
+// characters mixed in.
+//
+// Usage:  encodingBenchmark [numFuzzRounds megabytesPerRun]
+//
+// Exits with non-zero status on failure.
+
+
+#include "minorGems/formats/encodingUtils.h"
+
+#include "minorGems/system/Time.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+static int numFuzzRounds = 20000;
+static int megabytesPerRun = 16;
+
+
+static const char *levelNames[3] = { "scalar", "SSSE3", "AVX2" };
+
+
+
+static unsigned int randSeed = 12345;
+
+static unsigned int nextRand() {
+    randSeed = randSeed * 1103515245 + 12345;
+    return randSeed >> 8;
+    }
+
+
+
+// reference copies of the original implementations
+
+static char refFourBitIntToHex( unsigned int inInt ) {
+    return "0123456789ABCDEF"[ inInt ];
+    }
+
+
+static char *refHexEncode( unsigned char *inData, int inDataLength ) {
+    char *result = new char[ inDataLength * 2 + 1 ];
+
+    for( int i=0; i<inDataLength; i++ ) {
+        result[ 2 * i ] = refFourBitIntToHex( 0xF & ( inData[i] >> 4 ) );
+        result[ 2 * i + 1 ] = refFourBitIntToHex( 0xF & inData[i] );
+        }
+    result[ inDataLength * 2 ] = '\0';
+    return result;
+    }
+
+
+
+static const char *refBinaryToAscii =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+
+static int refAsciiToBinary( unsigned char inChar ) {
+    const char *found = NULL;
+    if( inChar != '\0' ) {
+        found = strchr( refBinaryToAscii, inChar );
+        }
+    if( found == NULL ) {
+        return -1;
+        }
+    return found - refBinaryToAscii;
+    }
+
+
+
+static char *refBase64Encode( unsigned char *inData, int inDataLength,
+                              char inBreakLines ) {
+    char *result = new char[ inDataLength * 2 + 8 ];
+    int length = 0;
+    int numInLine = 0;
+
+    for( int i=0; i<inDataLength; i=i+3 ) {
+        if( i+2 < inDataLength ) {
+            unsigned int block =
+                inData[i] << 16 | inData[i+1] << 8 | inData[i+2];
+
+            result[ length++ ] = refBinaryToAscii[ 0x3F & ( block >> 18 ) ];
+            result[ length++ ] = refBinaryToAscii[ 0x3F & ( block >> 12 ) ];
+            result[ length++ ] = refBinaryToAscii[ 0x3F & ( block >> 6 ) ];
+            result[ length++ ] = refBinaryToAscii[ 0x3F & ( block ) ];
+            numInLine += 4;
+
+            if( inBreakLines && numInLine == 76 ) {
+                result[ length++ ] = '\r';
+                result[ length++ ] = '\n';
+                numInLine = 0;
+                }
+            }
+        else {
+            int numLeft = inDataLength - i;
+
+            unsigned int block = inData[i] << 16;
+            if( numLeft == 2 ) {
+                block |= inData[i+1] << 8;
+                }
+
+            result[ length++ ] = refBinaryToAscii[ 0x3F & ( block >> 18 ) ];
+            result[ length++ ] = refBinaryToAscii[ 0x3F & ( block >> 12 ) ];
+
+            if( numLeft == 2 ) {
+                result[ length++ ] =
+                    refBinaryToAscii[ 0x3F & ( block >> 6 ) ];
+                }
+            else {
+                result[ length++ ] = '=';
+                }
+            result[ length++ ] = '=';
+            }
+        }
+    result[ length ] = '\0';
+    return result;
+    }
+
+
+
+// skips characters outside the alphabet, as the original did
+static unsigned char *refBase64Decode( char *inString, int *outLength ) {
+    int encodingLength = strlen( inString );
+
+    unsigned char *result = new unsigned char[ encodingLength + 1 ];
+    int length = 0;
+
+    unsigned int block = 0;
+    int numInBlock = 0;
+
+    for( int i=0; i<encodingLength; i++ ) {
+        int value = refAsciiToBinary( inString[i] );
+        if( value == -1 ) {
+            continue;
+            }
+        block = block << 6 | value;
+        numInBlock++;
+
+        if( numInBlock == 4 ) {
+            result[ length++ ] = 0xFF & ( block >> 16 );
+            result[ length++ ] = 0xFF & ( block >> 8 );
+            result[ length++ ] = 0xFF & ( block );
+            block = 0;
+            numInBlock = 0;
+            }
+        }
+
+    if( numInBlock == 2 ) {
+        result[ length++ ] = 0xFF & ( block >> 4 );
+        }
+    else if( numInBlock == 3 ) {
+        result[ length++ ] = 0xFF & ( block >> 10 );
+        result[ length++ ] = 0xFF & ( block >> 2 );
+        }
+
+    *outLength = length;
+    return result;
+    }
+
+
+
+static char checkData( const char *inWhat, int inLevel, int inRound,
+                       unsigned char *inA, int inLengthA,
+                       unsigned char *inB, int inLengthB ) {
+    if( inLengthA != inLengthB ||
+        ( inLengthA > 0 && memcmp( inA, inB, inLengthA ) != 0 ) ) {
+        printf( "%s mismatch at level %s, round %d (lengths %d, %d)\n",
+                inWhat, levelNames[ inLevel ], inRound, inLengthA,
+                inLengthB );
+        return false;
+        }
+    return true;
+    }
+
+
+
+static unsigned char *makeRandomData( int inLength ) {
+    unsigned char *data = new unsigned char[ inLength + 1 ];
+
+    // sometimes only a few byte values, to hit every table entry
+    int range = 256;
+    if( nextRand() % 4 == 0 ) {
+        range = 1 + nextRand() % 8;
+        }
+
+    for( int i=0; i<inLength; i++ ) {
+        data[i] = nextRand() % range;
+        }
+    return data;
+    }
+
+
+
+// copies inString with random characters inserted, as a \0-terminated
+// string
+static char *addNoise( char *inString, const char *inNoiseChars ) {
+    int length = strlen( inString );
+    char *noisy = new char[ length * 2 + 2 ];
+
+    int numNoise = strlen( inNoiseChars );
+    int rate = 1 + nextRand() % 200;
+
+    int j = 0;
+    for( int i=0; i<length; i++ ) {
+        if( nextRand() % rate == 0 ) {
+            noisy[ j++ ] = inNoiseChars[ nextRand() % numNoise ];
+            }
+        noisy[ j++ ] = inString[i];
+        }
+    noisy[ j ] = '\0';
+    return noisy;
+    }
+
+
+
+static char runFuzz( int inLevel ) {
+    setEncodingSIMDLimit( inLevel );
+
+    // includes bytes above 127, and characters next to each range
+    const char *base64Noise = "\r\n =@[`{-.:\x80\xff\x7f\x01";
+
+    for( int r=0; r<numFuzzRounds; r++ ) {
+        int length = nextRand() % 300;
+        if( r % 10 == 0 ) {
+            length = nextRand() % 5000;
+            }
+
+        unsigned char *data = makeRandomData( length );
+        char breakLines = nextRand() % 2;
+
+
+        // hex
+        char *hex = hexEncode( data, length );
+        char *refHex = refHexEncode( data, length );
+
+        if( ! checkData( "hexEncode", inLevel, r,
+                         (unsigned char*)hex, strlen( hex ),
+                         (unsigned char*)refHex, strlen( refHex ) ) ) {
+            return false;
+            }
+
+        // mixed case decodes the same
+        for( int i=0; i<length * 2; i++ ) {
+            if( nextRand() % 2 == 0 && hex[i] >= 'A' ) {
+                hex[i] += 'a' - 'A';
+                }
+            }
+
+        unsigned char *hexDecoded = hexDecode( hex );
+        if( hexDecoded == NULL ||
+            ! checkData( "hexDecode", inLevel, r, hexDecoded, length,
+                         data, length ) ) {
+            printf( "hexDecode failed at round %d\n", r );
+            return false;
+            }
+        delete [] hexDecoded;
+
+        if( length > 0 ) {
+            // one bad character anywhere must fail
+            const char *badHex = "gG/:@`\x80 ";
+            int badIndex = nextRand() % ( length * 2 );
+            hex[ badIndex ] = badHex[ nextRand() % strlen( badHex ) ];
+
+            hexDecoded = hexDecode( hex );
+            if( hexDecoded != NULL ) {
+                printf( "hexDecode accepted bad character at level %s, "
+                        "round %d\n", levelNames[ inLevel ], r );
+                return false;
+                }
+
+            // odd length fails
+            hex[ badIndex ] = '0';
+            hex[ length * 2 - 1 ] = '\0';
+            if( hexDecode( hex ) != NULL ) {
+                printf( "hexDecode accepted odd length at round %d\n", r );
+                return false;
+                }
+            }
+        delete [] hex;
+        delete [] refHex;
+
+
+        // base64
+        char *encoded = base64Encode( data, length, breakLines );
+        char *refEncoded = refBase64Encode( data, length, breakLines );
+
+        if( ! checkData( "base64Encode", inLevel, r,
+                         (unsigned char*)encoded, strlen( encoded ),
+                         (unsigned char*)refEncoded,
+                         strlen( refEncoded ) ) ) {
+            return false;
+            }
+
+        int decodedLength;
+        unsigned char *decoded = base64Decode( encoded, &decodedLength );
+
+        if( ! checkData( "base64Decode", inLevel, r, decoded, decodedLength,
+                         data, length ) ) {
+            return false;
+            }
+        delete [] decoded;
+
+        // junk between characters is skipped, as before
+        char *noisy = addNoise( encoded, base64Noise );
+
+        int refLength;
+        unsigned char *refDecoded = refBase64Decode( noisy, &refLength );
+
+        decoded = base64Decode( noisy, &decodedLength );
+
+        if( ! checkData( "base64Decode with noise", inLevel, r,
+                         decoded, decodedLength, refDecoded, refLength ) ) {
+            return false;
+            }
+
+        delete [] decoded;
+        delete [] refDecoded;
+        delete [] noisy;
+        delete [] encoded;
+        delete [] refEncoded;
+        delete [] data;
+        }
+
+    printf( "%-8s %d fuzz rounds passed\n", levelNames[ inLevel ],
+            numFuzzRounds );
+    return true;
+    }
+
+
+
+// buffers shared by timed operations, touched before timing so that
+// page faults are not counted
+static int dataLength;
+static unsigned char *data;
+static char *hexBuffer;
+static unsigned char *dataBuffer;
+static char *base64Buffer;
+static int base64Length;
+static int brokenBase64Length;
+
+
+static void runHexEncodeInto() {
+    hexEncodeInto( data, dataLength, hexBuffer );
+    }
+
+static void runHexDecodeInto() {
+    hexDecodeInto( hexBuffer, 2 * dataLength, dataBuffer );
+    }
+
+static void runBase64EncodeInto() {
+    base64Length = base64EncodeInto( data, dataLength, base64Buffer, false );
+    }
+
+static void runBase64DecodeInto() {
+    base64DecodeInto( base64Buffer, base64Length, dataBuffer );
+    }
+
+static void runBase64EncodeIntoBroken() {
+    brokenBase64Length =
+        base64EncodeInto( data, dataLength, base64Buffer, true );
+    }
+
+static void runBase64DecodeIntoBroken() {
+    base64DecodeInto( base64Buffer, brokenBase64Length, dataBuffer );
+    }
+
+static void runHexRoundTrip() {
+    char *hex = hexEncode( data, dataLength );
+    unsigned char *decoded = hexDecode( hex );
+    delete [] hex;
+    delete [] decoded;
+    }
+
+static void runBase64RoundTrip() {
+    char *encoded = base64Encode( data, dataLength, true );
+    int decodedLength;
+    unsigned char *decoded = base64Decode( encoded, &decodedLength );
+    delete [] encoded;
+    delete [] decoded;
+    }
+
+static void runRefHexEncode() {
+    delete [] refHexEncode( data, dataLength );
+    }
+
+static void runRefBase64Encode() {
+    delete [] refBase64Encode( data, dataLength, true );
+    }
+
+static void runRefBase64Decode() {
+    int decodedLength;
+    delete [] refBase64Decode( base64Buffer, &decodedLength );
+    }
+
+
+
+// inNumBytes is the size of the input to inOperation
+static void timeOperation( const char *inName, void (*inOperation)(),
+                           double inNumBytes ) {
+    // warm up
+    inOperation();
+
+    int numRuns = 10;
+
+    double startTime = Time::getCurrentTime();
+    for( int i=0; i<numRuns; i++ ) {
+        inOperation();
+        }
+    double time = ( Time::getCurrentTime() - startTime ) / numRuns;
+
+    printf( "  %-30s %6.2f GB/s\n", inName, inNumBytes / time / 1e9 );
+    }
+
+
+
+static void runBenchmark( int inLevel ) {
+    setEncodingSIMDLimit( inLevel );
+
+    printf( "\n%s:\n", levelNames[ inLevel ] );
+
+    timeOperation( "hexEncodeInto", runHexEncodeInto, dataLength );
+    timeOperation( "hexDecodeInto (hex bytes)", runHexDecodeInto,
+                   2 * dataLength );
+
+    timeOperation( "base64EncodeInto", runBase64EncodeInto, dataLength );
+    timeOperation( "base64DecodeInto (chars)", runBase64DecodeInto,
+                   base64Length );
+
+    timeOperation( "base64EncodeInto, broken", runBase64EncodeIntoBroken,
+                   dataLength );
+    timeOperation( "base64DecodeInto, broken", runBase64DecodeIntoBroken,
+                   brokenBase64Length );
+
+    // includes allocation
+    timeOperation( "hexEncode + hexDecode", runHexRoundTrip, dataLength );
+    timeOperation( "base64Encode + base64Decode", runBase64RoundTrip,
+                   dataLength );
+    }
+
+
+
+static void runReferenceBenchmark() {
+    printf( "\noriginal code:\n" );
+
+    timeOperation( "hexEncode", runRefHexEncode, dataLength );
+
+    timeOperation( "base64Encode, broken", runRefBase64Encode, dataLength );
+
+    // leaves broken encoding in base64Buffer, \0-terminated
+    runBase64EncodeIntoBroken();
+    timeOperation( "base64Decode, broken", runRefBase64Decode,
+                   brokenBase64Length );
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    if( inNumArgs == 3 ) {
+        numFuzzRounds = atoi( inArgs[1] );
+        megabytesPerRun = atoi( inArgs[2] );
+        }
+
+    // find what this processor supports
+    int maxLevel = 2;
+    for( ; maxLevel > 0; maxLevel-- ) {
+        setEncodingSIMDLimit( maxLevel );
+        if( getEncodingSIMDLevel() == maxLevel ) {
+            break;
+            }
+        }
+
+    for( int level=0; level<=maxLevel; level++ ) {
+        if( ! runFuzz( level ) ) {
+            printf( "\nFAILED\n" );
+            return 1;
+            }
+        }
+
+
+    dataLength = megabytesPerRun * 1000000;
+    data = makeRandomData( dataLength );
+
+    hexBuffer = new char[ 2 * dataLength + 1 ];
+    dataBuffer = new unsigned char[ getBase64MaxDecodedLength(
+                                        2 * dataLength ) ];
+    base64Buffer = new char[ getBase64EncodedLength( dataLength, true ) + 1 ];
+
+    memset( hexBuffer, 0, 2 * dataLength + 1 );
+    memset( dataBuffer, 0, dataLength );
+    runBase64EncodeIntoBroken();
+    runBase64EncodeInto();
+
+    printf( "\n%d MB of random bytes, average of 10 runs\n",
+            megabytesPerRun );
+
+    runReferenceBenchmark();
+
+    for( int level=0; level<=maxLevel; level++ ) {
+        runBenchmark( level );
+        }
+
+    delete [] data;
+    delete [] hexBuffer;
+    delete [] dataBuffer;
+    delete [] base64Buffer;
+
+    return 0;
+    }
@@ -133,57 +133,364 @@ int hexToFourBitInt( char inHex ) {
 
 
 
-char *hexEncode( unsigned char *inData, int inDataLength ) {
+#include "minorGems/system/cpuFeatures.h"
 
-    char *resultHexString = new char[ inDataLength * 2 + 1 ];
-    int hexStringIndex = 0;
-    
-    for( int i=0; i<inDataLength; i++ ) {
 
-        unsigned char currentByte = inData[ i ];
 
-        int highBits = 0xF & ( currentByte >> 4 );
-        int lowBits = 0xF & ( currentByte );
+// 0 scalar, 1 SSSE3, 2 AVX2
+static int simdLevelLimit = 2;
+
 
-        resultHexString[ hexStringIndex ] = fourBitIntToHex( highBits );
-        hexStringIndex++;
 
-        resultHexString[ hexStringIndex ] = fourBitIntToHex( lowBits );
-        hexStringIndex++;
+int getEncodingSIMDLevel() {
+    const CPUFeatures *features = getCPUFeatures();
+
+    int level = 0;
+    if( features->ssse3 ) {
+        level = 1;
+        }
+    if( features->avx2 ) {
+        level = 2;
         }
 
-    resultHexString[ hexStringIndex ] = '\0';
-    
-    return resultHexString;
+    return limitImplementation( level, simdLevelLimit );
     }
 
 
 
-unsigned char *hexDecode( char *inHexString ) {
+void setEncodingSIMDLimit( int inLevel ) {
+    simdLevelLimit = inLevel;
+    }
 
-    int hexLength = strlen( inHexString );
-    
-    if( hexLength % 2 != 0 ) {
-        // hex strings must be even in length
-        return NULL;
+
+
+static const char *hexDigits = "0123456789ABCDEF";
+
+
+
+// Maps ascii characters to hex digit values, 0xff for non-hex characters
+static unsigned char asciiToHexDigit[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff };
+
+
+
+#ifdef CPU_FEATURES_X86
+
+// Each vectorized function handles as much of its input as fits in whole
+// vectors and returns how much it handled.  Callers finish the rest with
+// scalar code.
+
+
+__attribute__(( target( "ssse3" ) ))
+static int hexEncodeSSSE3( unsigned char *inData, int inDataLength,
+                           char *outHexString ) {
+    const __m128i digits = _mm_setr_epi8( '0', '1', '2', '3', '4', '5', '6',
+                                          '7', '8', '9', 'A', 'B', 'C', 'D',
+                                          'E', 'F' );
+    const __m128i lowMask = _mm_set1_epi8( 0x0F );
+
+    int i = 0;
+    for( ; i + 16 <= inDataLength; i += 16 ) {
+        __m128i bytes = _mm_loadu_si128( (__m128i *)( inData + i ) );
+
+        __m128i high =
+            _mm_and_si128( _mm_srli_epi16( bytes, 4 ), lowMask );
+        __m128i low = _mm_and_si128( bytes, lowMask );
+
+        high = _mm_shuffle_epi8( digits, high );
+        low = _mm_shuffle_epi8( digits, low );
+
+        _mm_storeu_si128( (__m128i *)( outHexString + 2 * i ),
+                          _mm_unpacklo_epi8( high, low ) );
+        _mm_storeu_si128( (__m128i *)( outHexString + 2 * i + 16 ),
+                          _mm_unpackhi_epi8( high, low ) );
         }
+    return i;
+    }
 
-    int dataLength = hexLength / 2;
-    
-    unsigned char *rawData = new unsigned char[ dataLength ];
 
 
-    for( int i=0; i<dataLength; i++ ) {
+__attribute__(( target( "avx2" ) ))
+static int hexEncodeAVX2( unsigned char *inData, int inDataLength,
+                          char *outHexString ) {
+    const __m256i digits = _mm256_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7',
+        '8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
+        '0', '1', '2', '3', '4', '5', '6', '7',
+        '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' );
+    const __m256i lowMask = _mm256_set1_epi8( 0x0F );
+
+    int i = 0;
+    for( ; i + 32 <= inDataLength; i += 32 ) {
+        __m256i bytes = _mm256_loadu_si256( (__m256i *)( inData + i ) );
+
+        __m256i high =
+            _mm256_and_si256( _mm256_srli_epi16( bytes, 4 ), lowMask );
+        __m256i low = _mm256_and_si256( bytes, lowMask );
+
+        high = _mm256_shuffle_epi8( digits, high );
+        low = _mm256_shuffle_epi8( digits, low );
 
-        int highBits = hexToFourBitInt( inHexString[ 2 * i ] );
-        int lowBits = hexToFourBitInt( inHexString[ 2 * i + 1 ] );
+        // unpack works within 128-bit lanes, so put lanes back in order
+        __m256i first = _mm256_unpacklo_epi8( high, low );
+        __m256i second = _mm256_unpackhi_epi8( high, low );
+
+        _mm256_storeu_si256( (__m256i *)( outHexString + 2 * i ),
+                             _mm256_permute2x128_si256( first, second,
+                                                        0x20 ) );
+        _mm256_storeu_si256( (__m256i *)( outHexString + 2 * i + 32 ),
+                             _mm256_permute2x128_si256( first, second,
+                                                        0x31 ) );
+        }
+
+    // finish whole 16-byte vectors
+    // (clear the upper halves first, or the non-VEX SSSE3 code pays
+    //  a state transition on every call)
+    _mm256_zeroupper();
+    return i + hexEncodeSSSE3( inData + i, inDataLength - i,
+                               outHexString + 2 * i );
+    }
+
+
+
+// sets outValid to 0xFF for each valid hex character
+__attribute__(( target( "ssse3" ) ))
+static inline __m128i hexCharsToValues( __m128i inChars, __m128i *outValid ) {
+    __m128i digit = _mm_sub_epi8( inChars, _mm_set1_epi8( '0' ) );
+    __m128i isDigit =
+        _mm_cmpeq_epi8( _mm_min_epu8( digit, _mm_set1_epi8( 9 ) ), digit );
+
+    __m128i letter = _mm_sub_epi8( _mm_or_si128( inChars,
+                                                 _mm_set1_epi8( 0x20 ) ),
+                                   _mm_set1_epi8( 'a' ) );
+    __m128i isLetter =
+        _mm_cmpeq_epi8( _mm_min_epu8( letter, _mm_set1_epi8( 5 ) ), letter );
+
+    *outValid = _mm_or_si128( isDigit, isLetter );
+
+    return _mm_or_si128(
+        _mm_and_si128( isDigit, digit ),
+        _mm_and_si128( isLetter,
+                       _mm_add_epi8( letter, _mm_set1_epi8( 10 ) ) ) );
+    }
+
+
+
+__attribute__(( target( "avx2" ) ))
+static inline __m256i hexCharsToValues( __m256i inChars, __m256i *outValid ) {
+    __m256i digit = _mm256_sub_epi8( inChars, _mm256_set1_epi8( '0' ) );
+    __m256i isDigit =
+        _mm256_cmpeq_epi8( _mm256_min_epu8( digit, _mm256_set1_epi8( 9 ) ),
+                           digit );
+
+    __m256i letter = _mm256_sub_epi8( _mm256_or_si256(
+                                          inChars,
+                                          _mm256_set1_epi8( 0x20 ) ),
+                                      _mm256_set1_epi8( 'a' ) );
+    __m256i isLetter =
+        _mm256_cmpeq_epi8( _mm256_min_epu8( letter, _mm256_set1_epi8( 5 ) ),
+                           letter );
+
+    *outValid = _mm256_or_si256( isDigit, isLetter );
+
+    return _mm256_or_si256(
+        _mm256_and_si256( isDigit, digit ),
+        _mm256_and_si256( isLetter,
+                          _mm256_add_epi8( letter,
+                                           _mm256_set1_epi8( 10 ) ) ) );
+    }
 
-        if( highBits == -1 || lowBits == -1 ) {
-            delete [] rawData;
-            return NULL;
+
+
+// sets outFailed if an invalid character is found
+__attribute__(( target( "ssse3" ) ))
+static int hexDecodeSSSE3( char *inHexString, int inDataLength,
+                           unsigned char *outData, char *outFailed ) {
+    // high digit times 16 plus low digit
+    const __m128i weights = _mm_set1_epi16( 0x0110 );
+
+    int i = 0;
+    for( ; i + 16 <= inDataLength; i += 16 ) {
+        __m128i validA, validB;
+
+        __m128i a = hexCharsToValues(
+            _mm_loadu_si128( (__m128i *)( inHexString + 2 * i ) ), &validA );
+        __m128i b = hexCharsToValues(
+            _mm_loadu_si128( (__m128i *)( inHexString + 2 * i + 16 ) ),
+            &validB );
+
+        if( _mm_movemask_epi8( _mm_and_si128( validA, validB ) )
+            != 0xFFFF ) {
+            *outFailed = true;
+            return i;
+            }
+
+        _mm_storeu_si128( (__m128i *)( outData + i ),
+                          _mm_packus_epi16( _mm_maddubs_epi16( a, weights ),
+                                            _mm_maddubs_epi16( b,
+                                                               weights ) ) );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "avx2" ) ))
+static int hexDecodeAVX2( char *inHexString, int inDataLength,
+                          unsigned char *outData, char *outFailed ) {
+    const __m256i weights = _mm256_set1_epi16( 0x0110 );
+
+    int i = 0;
+    for( ; i + 32 <= inDataLength; i += 32 ) {
+        __m256i validA, validB;
+
+        __m256i a = hexCharsToValues(
+            _mm256_loadu_si256( (__m256i *)( inHexString + 2 * i ) ),
+            &validA );
+        __m256i b = hexCharsToValues(
+            _mm256_loadu_si256( (__m256i *)( inHexString + 2 * i + 32 ) ),
+            &validB );
+
+        if( _mm256_movemask_epi8( _mm256_and_si256( validA, validB ) )
+            != -1 ) {
+            *outFailed = true;
+            return i;
             }
-        
-        rawData[i] = (unsigned char)( highBits << 4 | lowBits );
+
+        __m256i packed =
+            _mm256_packus_epi16( _mm256_maddubs_epi16( a, weights ),
+                                 _mm256_maddubs_epi16( b, weights ) );
+
+        // pack works within 128-bit lanes, so put quarters back in order
+        _mm256_storeu_si256( (__m256i *)( outData + i ),
+                             _mm256_permute4x64_epi64( packed, 0xD8 ) );
+        }
+
+    _mm256_zeroupper();
+    return i + hexDecodeSSSE3( inHexString + 2 * i, inDataLength - i,
+                               outData + i, outFailed );
+    }
+
+#endif
+
+
+
+void hexEncodeInto( unsigned char *inData, int inDataLength,
+                    char *outHexString ) {
+    int i = 0;
+
+#ifdef CPU_FEATURES_X86
+    int level = getEncodingSIMDLevel();
+
+    if( level == 2 ) {
+        i = hexEncodeAVX2( inData, inDataLength, outHexString );
+        }
+    else if( level == 1 ) {
+        i = hexEncodeSSSE3( inData, inDataLength, outHexString );
+        }
+#endif
+
+    for( ; i<inDataLength; i++ ) {
+        unsigned char currentByte = inData[ i ];
+
+        outHexString[ 2 * i ] = hexDigits[ currentByte >> 4 ];
+        outHexString[ 2 * i + 1 ] = hexDigits[ currentByte & 0xF ];
+        }
+
+    outHexString[ 2 * inDataLength ] = '\0';
+    }
+
+
+
+char hexDecodeInto( char *inHexString, int inHexLength,
+                    unsigned char *outData ) {
+
+    if( inHexLength % 2 != 0 ) {
+        // hex strings must be even in length
+        return false;
+        }
+
+    int dataLength = inHexLength / 2;
+
+    int i = 0;
+    char failed = false;
+
+#ifdef CPU_FEATURES_X86
+    int level = getEncodingSIMDLevel();
+
+    if( level == 2 ) {
+        i = hexDecodeAVX2( inHexString, dataLength, outData, &failed );
+        }
+    else if( level == 1 ) {
+        i = hexDecodeSSSE3( inHexString, dataLength, outData, &failed );
+        }
+#endif
+
+    if( failed ) {
+        return false;
+        }
+
+    unsigned char *hex = (unsigned char *)inHexString;
+
+    // check validity once at the end
+    unsigned char allBits = 0;
+
+    for( ; i<dataLength; i++ ) {
+        unsigned char highBits = asciiToHexDigit[ hex[ 2 * i ] ];
+        unsigned char lowBits = asciiToHexDigit[ hex[ 2 * i + 1 ] ];
+
+        allBits |= highBits | lowBits;
+
+        outData[i] = (unsigned char)( highBits << 4 | lowBits );
+        }
+
+    // 0xff for invalid characters is the only value with high bits set
+    return ( allBits & 0xF0 ) == 0;
+    }
+
+
+
+char *hexEncode( unsigned char *inData, int inDataLength ) {
+
+    char *resultHexString = new char[ inDataLength * 2 + 1 ];
+
+    hexEncodeInto( inData, inDataLength, resultHexString );
+
+    return resultHexString;
+    }
+
+
+
+unsigned char *hexDecode( char *inHexString ) {
+
+    int hexLength = strlen( inHexString );
+
+    unsigned char *rawData = new unsigned char[ hexLength / 2 ];
+
+    if( ! hexDecodeInto( inHexString, hexLength, rawData ) ) {
+        delete [] rawData;
+        return NULL;
         }
 
     return rawData;
@@ -191,6 +498,7 @@ unsigned char *hexDecode( char *inHexString ) {
 
 
 
+
 /*
  * These tables were taken from the GNU Privacy Guard source code.
  *
@@ -234,219 +542,520 @@ static unsigned char asciiToBinary[256] = {
     0xff, 0xff, 0xff, 0xff };
 
 
-char *base64Encode( unsigned char *inData, int inDataLength,
-                    char inBreakLines ) {
+// input bytes per broken line
+#define BASE64_LINE_BYTES 57
 
-    SimpleVector<char> *encodingVector = new SimpleVector<char>();
 
-    int numInLine = 0;
-    
-    // take groups of 3 data bytes and map them to 4 base64 digits
-    for( int i=0; i<inDataLength; i=i+3 ) {
-
-        if( i+2 < inDataLength ) {
-            // not at end yet
-
-            unsigned int block =
-                inData[i]   << 16 |
-                inData[i+1] << 8 |
-                inData[i+2];
-
-            // base64 digits, with digitA at left
-            unsigned int digitA = 0x3F & ( block >> 18 );
-            unsigned int digitB = 0x3F & ( block >> 12 );
-            unsigned int digitC = 0x3F & ( block >> 6 );
-            unsigned int digitD = 0x3F & ( block );
-
-            encodingVector->push_back( binaryToAscii[ digitA ] );
-            encodingVector->push_back( binaryToAscii[ digitB ] );
-            encodingVector->push_back( binaryToAscii[ digitC ] );
-            encodingVector->push_back( binaryToAscii[ digitD ] );
-            numInLine += 4;
-
-            if( inBreakLines && numInLine == 76 ) {
-                // break the line
-                encodingVector->push_back( '\r' );
-                encodingVector->push_back( '\n' );
-                numInLine = 0;
-                }
-            
+
+#ifdef CPU_FEATURES_X86
+
+// maps 6-bit values to base64 characters
+// (vectorized translation by Wojciech Mula and Daniel Lemire)
+__attribute__(( target( "ssse3" ) ))
+static inline __m128i base64ValuesToChars( __m128i inValues ) {
+    // offset added to each value, indexed by its range:
+    // 0 for a-z, 1-10 for 0-9, 11 for +, 12 for /, 13 for A-Z
+    const __m128i offsets = _mm_setr_epi8( 'a' - 26,
+                                           '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52,
+                                           '+' - 62, '/' - 63, 'A', 0, 0 );
+
+    __m128i range = _mm_subs_epu8( inValues, _mm_set1_epi8( 51 ) );
+    __m128i isUpper = _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), inValues );
+
+    range = _mm_or_si128( range,
+                          _mm_and_si128( isUpper, _mm_set1_epi8( 13 ) ) );
+
+    return _mm_add_epi8( inValues, _mm_shuffle_epi8( offsets, range ) );
+    }
+
+
+
+__attribute__(( target( "avx2" ) ))
+static inline __m256i base64ValuesToChars( __m256i inValues ) {
+    const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '+' - 62, '/' - 63, 'A', 0, 0 );
+
+    __m256i range = _mm256_subs_epu8( inValues, _mm256_set1_epi8( 51 ) );
+    __m256i isUpper = _mm256_cmpgt_epi8( _mm256_set1_epi8( 26 ), inValues );
+
+    range = _mm256_or_si256( range,
+                             _mm256_and_si256( isUpper,
+                                               _mm256_set1_epi8( 13 ) ) );
+
+    return _mm256_add_epi8( inValues, _mm256_shuffle_epi8( offsets, range ) );
+    }
+
+
+
+// inNumBytes is a multiple of 3, and inNumReadable bytes can be read
+// from inData (vectors read past the last whole block)
+__attribute__(( target( "ssse3" ) ))
+static int base64EncodeSSSE3( unsigned char *inData, int inNumBytes,
+                              int inNumReadable, char *outChars ) {
+
+    // each 32-bit lane gets the bytes of one 3-byte block, arranged so
+    // that the multiplies below can shift all four 6-bit fields into
+    // place at once
+    const __m128i spread = _mm_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4,
+                                          7, 6, 8, 7, 10, 9, 11, 10 );
+
+    int i = 0;
+    for( ; i + 12 <= inNumBytes && i + 16 <= inNumReadable; i += 12 ) {
+        __m128i bytes = _mm_loadu_si128( (__m128i *)( inData + i ) );
+
+        bytes = _mm_shuffle_epi8( bytes, spread );
+
+        __m128i fieldsAC = _mm_mulhi_epu16(
+            _mm_and_si128( bytes, _mm_set1_epi32( 0x0FC0FC00 ) ),
+            _mm_set1_epi32( 0x04000040 ) );
+        __m128i fieldsBD = _mm_mullo_epi16(
+            _mm_and_si128( bytes, _mm_set1_epi32( 0x003F03F0 ) ),
+            _mm_set1_epi32( 0x01000010 ) );
+
+        _mm_storeu_si128( (__m128i *)( outChars + i / 3 * 4 ),
+                          base64ValuesToChars(
+                              _mm_or_si128( fieldsAC, fieldsBD ) ) );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "avx2" ) ))
+static int base64EncodeAVX2( unsigned char *inData, int inNumBytes,
+                             int inNumReadable, char *outChars ) {
+
+    const __m256i spread = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 );
+
+    int i = 0;
+    for( ; i + 24 <= inNumBytes && i + 28 <= inNumReadable; i += 24 ) {
+        // 12 bytes in each lane
+        __m256i bytes = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128( (__m128i *)( inData + i ) ) ),
+            _mm_loadu_si128( (__m128i *)( inData + i + 12 ) ), 1 );
+
+        bytes = _mm256_shuffle_epi8( bytes, spread );
+
+        __m256i fieldsAC = _mm256_mulhi_epu16(
+            _mm256_and_si256( bytes, _mm256_set1_epi32( 0x0FC0FC00 ) ),
+            _mm256_set1_epi32( 0x04000040 ) );
+        __m256i fieldsBD = _mm256_mullo_epi16(
+            _mm256_and_si256( bytes, _mm256_set1_epi32( 0x003F03F0 ) ),
+            _mm256_set1_epi32( 0x01000010 ) );
+
+        _mm256_storeu_si256( (__m256i *)( outChars + i / 3 * 4 ),
+                             base64ValuesToChars(
+                                 _mm256_or_si256( fieldsAC, fieldsBD ) ) );
+        }
+
+    _mm256_zeroupper();
+    return i + base64EncodeSSSE3( inData + i, inNumBytes - i,
+                                  inNumReadable - i, outChars + i / 3 * 4 );
+    }
+
+
+
+// maps base64 characters to 6-bit values, setting outValid to 0xFF for
+// each character in the base64 alphabet
+__attribute__(( target( "ssse3" ) ))
+static inline __m128i base64CharsToValues( __m128i inChars,
+                                           __m128i *outValid ) {
+    // bytes above 127 are negative, and fall outside every range
+    __m128i isUpper = _mm_and_si128(
+        _mm_cmpgt_epi8( inChars, _mm_set1_epi8( 'A' - 1 ) ),
+        _mm_cmpgt_epi8( _mm_set1_epi8( 'Z' + 1 ), inChars ) );
+    __m128i isLower = _mm_and_si128(
+        _mm_cmpgt_epi8( inChars, _mm_set1_epi8( 'a' - 1 ) ),
+        _mm_cmpgt_epi8( _mm_set1_epi8( 'z' + 1 ), inChars ) );
+    __m128i isDigit = _mm_and_si128(
+        _mm_cmpgt_epi8( inChars, _mm_set1_epi8( '0' - 1 ) ),
+        _mm_cmpgt_epi8( _mm_set1_epi8( '9' + 1 ), inChars ) );
+    __m128i isPlus = _mm_cmpeq_epi8( inChars, _mm_set1_epi8( '+' ) );
+    __m128i isSlash = _mm_cmpeq_epi8( inChars, _mm_set1_epi8( '/' ) );
+
+    *outValid = _mm_or_si128( _mm_or_si128( isUpper, isLower ),
+                              _mm_or_si128( isDigit,
+                                            _mm_or_si128( isPlus,
+                                                          isSlash ) ) );
+
+    __m128i offset = _mm_or_si128(
+        _mm_or_si128( _mm_and_si128( isUpper, _mm_set1_epi8( -'A' ) ),
+                      _mm_and_si128( isLower,
+                                     _mm_set1_epi8( 26 - 'a' ) ) ),
+        _mm_or_si128( _mm_and_si128( isDigit,
+                                     _mm_set1_epi8( 52 - '0' ) ),
+                      _mm_or_si128(
+                          _mm_and_si128( isPlus,
+                                         _mm_set1_epi8( 62 - '+' ) ),
+                          _mm_and_si128( isSlash,
+                                         _mm_set1_epi8( 63 - '/' ) ) ) ) );
+
+    return _mm_add_epi8( inChars, offset );
+    }
+
+
+
+__attribute__(( target( "avx2" ) ))
+static inline __m256i base64CharsToValues( __m256i inChars,
+                                           __m256i *outValid ) {
+    __m256i isUpper = _mm256_and_si256(
+        _mm256_cmpgt_epi8( inChars, _mm256_set1_epi8( 'A' - 1 ) ),
+        _mm256_cmpgt_epi8( _mm256_set1_epi8( 'Z' + 1 ), inChars ) );
+    __m256i isLower = _mm256_and_si256(
+        _mm256_cmpgt_epi8( inChars, _mm256_set1_epi8( 'a' - 1 ) ),
+        _mm256_cmpgt_epi8( _mm256_set1_epi8( 'z' + 1 ), inChars ) );
+    __m256i isDigit = _mm256_and_si256(
+        _mm256_cmpgt_epi8( inChars, _mm256_set1_epi8( '0' - 1 ) ),
+        _mm256_cmpgt_epi8( _mm256_set1_epi8( '9' + 1 ), inChars ) );
+    __m256i isPlus = _mm256_cmpeq_epi8( inChars, _mm256_set1_epi8( '+' ) );
+    __m256i isSlash = _mm256_cmpeq_epi8( inChars, _mm256_set1_epi8( '/' ) );
+
+    *outValid = _mm256_or_si256(
+        _mm256_or_si256( isUpper, isLower ),
+        _mm256_or_si256( isDigit, _mm256_or_si256( isPlus, isSlash ) ) );
+
+    __m256i offset = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_and_si256( isUpper, _mm256_set1_epi8( -'A' ) ),
+            _mm256_and_si256( isLower, _mm256_set1_epi8( 26 - 'a' ) ) ),
+        _mm256_or_si256(
+            _mm256_and_si256( isDigit, _mm256_set1_epi8( 52 - '0' ) ),
+            _mm256_or_si256(
+                _mm256_and_si256( isPlus, _mm256_set1_epi8( 62 - '+' ) ),
+                _mm256_and_si256( isSlash,
+                                  _mm256_set1_epi8( 63 - '/' ) ) ) ) );
+
+    return _mm256_add_epi8( inChars, offset );
+    }
+
+
+
+// decodes 16-character vectors until one holds a character outside
+// the alphabet (a line break, padding, or garbage), keeping whole groups
+// of 4 before it
+// Each vector writes 16 bytes for 12 decoded, so needs 32 characters
+// left to be sure the output has room.
+__attribute__(( target( "ssse3" ) ))
+static int base64DecodeSSSE3( unsigned char *inChars, int inNumChars,
+                              unsigned char *outData ) {
+
+    // 32-bit lanes hold 24 decoded bits, low byte last
+    const __m128i gather = _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                          14, 13, 12, -1, -1, -1, -1 );
+    int i = 0;
+    for( ; i + 32 <= inNumChars; i += 16 ) {
+        __m128i valid;
+        __m128i values = base64CharsToValues(
+            _mm_loadu_si128( (__m128i *)( inChars + i ) ), &valid );
+
+        int validMask = _mm_movemask_epi8( valid );
+
+        // pairs of 6-bit values into 12 bits, then pairs of those into 24
+        __m128i merged = _mm_maddubs_epi16( values,
+                                            _mm_set1_epi32( 0x01400140 ) );
+        merged = _mm_madd_epi16( merged, _mm_set1_epi32( 0x00011000 ) );
+
+        _mm_storeu_si128( (__m128i *)( outData + i / 4 * 3 ),
+                          _mm_shuffle_epi8( merged, gather ) );
+
+        if( validMask != 0xFFFF ) {
+            // keep whole groups before the first invalid character,
+            // bytes stored past them are overwritten later
+            return i + ( __builtin_ctz( ~validMask ) & ~3 );
             }
-        else {
-            // at end
-            int numLeft = inDataLength - i;
-
-            switch( numLeft ) {
-                case 0:
-                    // no padding
-                    break;
-                case 1: {
-                    // two digits, two pads
-                    unsigned int block =
-                        inData[i]   << 16 |
-                        0;
-                    unsigned int digitA = 0x3F & ( block >> 18 );
-                    unsigned int digitB = 0x3F & ( block >> 12 );
-            
-                    encodingVector->push_back( binaryToAscii[ digitA ] );
-                    encodingVector->push_back( binaryToAscii[ digitB ] );
-
-                    encodingVector->push_back( '=' );
-                    encodingVector->push_back( '=' );
-                    break;
-                    }
-                case 2: {
-                    // three digits, one pad
-                    unsigned int block =
-                        inData[i]   << 16 |
-                        inData[i+1] << 8 |
-                        0;
-
-                    // base64 digits, with digitA at left
-                    unsigned int digitA = 0x3F & ( block >> 18 );
-                    unsigned int digitB = 0x3F & ( block >> 12 );
-                    unsigned int digitC = 0x3F & ( block >> 6 );
-                    
-                    encodingVector->push_back( binaryToAscii[ digitA ] );
-                    encodingVector->push_back( binaryToAscii[ digitB ] );
-                    encodingVector->push_back( binaryToAscii[ digitC ] );
-                    encodingVector->push_back( '=' );
-                    break;
-                    }
-                default:
-                    break;
-                }
-            // done with all data
-            i = inDataLength;
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "avx2" ) ))
+static int base64DecodeAVX2( unsigned char *inChars, int inNumChars,
+                             unsigned char *outData ) {
+
+    const __m256i gather = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+
+    // 12 bytes from each lane
+    const __m256i joinLanes = _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 7, 7 );
+
+    int i = 0;
+    for( ; i + 64 <= inNumChars; i += 32 ) {
+        __m256i valid;
+        __m256i values = base64CharsToValues(
+            _mm256_loadu_si256( (__m256i *)( inChars + i ) ), &valid );
+
+        unsigned int validMask = _mm256_movemask_epi8( valid );
+
+        __m256i merged =
+            _mm256_maddubs_epi16( values, _mm256_set1_epi32( 0x01400140 ) );
+        merged = _mm256_madd_epi16( merged,
+                                    _mm256_set1_epi32( 0x00011000 ) );
+
+        merged = _mm256_shuffle_epi8( merged, gather );
+
+        _mm256_storeu_si256( (__m256i *)( outData + i / 4 * 3 ),
+                             _mm256_permutevar8x32_epi32( merged,
+                                                          joinLanes ) );
+
+        if( validMask != 0xFFFFFFFF ) {
+            return i + ( __builtin_ctz( ~validMask ) & ~3 );
             }
         }
 
-    char *returnString = encodingVector->getElementString();
+    _mm256_zeroupper();
+    return i + base64DecodeSSSE3( inChars + i, inNumChars - i,
+                                  outData + i / 4 * 3 );
+    }
 
-    delete encodingVector;
+#endif
 
-    return returnString;
+
+
+// encodes whole 3-byte blocks, with no line breaks
+static void base64EncodeBlocks( unsigned char *inData, int inNumBytes,
+                                int inNumReadable, char *outChars ) {
+    int i = 0;
+
+#ifdef CPU_FEATURES_X86
+    int level = getEncodingSIMDLevel();
+
+    if( level == 2 ) {
+        i = base64EncodeAVX2( inData, inNumBytes, inNumReadable, outChars );
+        }
+    else if( level == 1 ) {
+        i = base64EncodeSSSE3( inData, inNumBytes, inNumReadable, outChars );
+        }
+#endif
+
+    char *out = &( outChars[ i / 3 * 4 ] );
+
+    for( ; i<inNumBytes; i += 3 ) {
+        unsigned int block =
+            inData[i]   << 16 |
+            inData[i+1] << 8 |
+            inData[i+2];
+
+        out[0] = binaryToAscii[ 0x3F & ( block >> 18 ) ];
+        out[1] = binaryToAscii[ 0x3F & ( block >> 12 ) ];
+        out[2] = binaryToAscii[ 0x3F & ( block >> 6 ) ];
+        out[3] = binaryToAscii[ 0x3F & ( block ) ];
+        out += 4;
+        }
     }
 
 
 
-unsigned char *base64Decode( char *inBase64String,
-                             int *outDataLength ) {
+int getBase64EncodedLength( int inDataLength, char inBreakLines ) {
+    int length = ( ( inDataLength + 2 ) / 3 ) * 4;
+
+    if( inBreakLines ) {
+        // each full line ends with a break, including the last one
+        length += ( inDataLength / BASE64_LINE_BYTES ) * 2;
+        }
+    return length;
+    }
 
-    SimpleVector<unsigned char> *decodedVector =
-        new SimpleVector<unsigned char>();
 
 
-    
-    int encodingLength = strlen( inBase64String );
+int base64EncodeInto( unsigned char *inData, int inDataLength,
+                      char *outString, char inBreakLines ) {
 
-    SimpleVector<unsigned char> *binaryEncodingVector =
-        new SimpleVector<unsigned char>();
+    char *out = outString;
+    int i = 0;
+
+    if( inBreakLines ) {
+        while( inDataLength - i >= BASE64_LINE_BYTES ) {
+            // 57 is not a whole number of vectors, so encode one extra
+            // block when there is enough data after the line (its 4
+            // characters are overwritten by the line break and the next
+            // line)
+            int numToEncode = BASE64_LINE_BYTES;
+            if( inDataLength - i >= BASE64_LINE_BYTES + 7 ) {
+                numToEncode += 3;
+                }
 
-    int i;
-    for( i=0; i<encodingLength; i++ ) {
-        unsigned char currentChar = (unsigned char)( inBase64String[i] );
+            base64EncodeBlocks( &( inData[i] ), numToEncode,
+                                inDataLength - i, out );
+            i += BASE64_LINE_BYTES;
+            out += BASE64_LINE_BYTES / 3 * 4;
 
-        unsigned char currentBinary = asciiToBinary[ currentChar ]; 
-        
-        if( currentBinary != 0xFF ) {
-            // in range
-            binaryEncodingVector->push_back( currentBinary );
+            *out = '\r';
+            out++;
+            *out = '\n';
+            out++;
             }
         }
 
-    int binaryEncodingLength = binaryEncodingVector->size();
+    int numBlockBytes = ( ( inDataLength - i ) / 3 ) * 3;
 
-    unsigned char *binaryEncoding = binaryEncodingVector->getElementArray();
-    delete binaryEncodingVector;
+    base64EncodeBlocks( &( inData[i] ), numBlockBytes, inDataLength - i,
+                        out );
+    i += numBlockBytes;
+    out += numBlockBytes / 3 * 4;
 
-    int blockCount = binaryEncodingLength / 4;
 
-    if( binaryEncodingLength % 4 != 0 ) {
-        // extra, 0-padded block
-        blockCount += 1;
+    int numLeft = inDataLength - i;
+
+    if( numLeft == 1 ) {
+        // two digits, two pads
+        unsigned int block = inData[i] << 16;
+
+        out[0] = binaryToAscii[ 0x3F & ( block >> 18 ) ];
+        out[1] = binaryToAscii[ 0x3F & ( block >> 12 ) ];
+        out[2] = '=';
+        out[3] = '=';
+        out += 4;
         }
+    else if( numLeft == 2 ) {
+        // three digits, one pad
+        unsigned int block =
+            inData[i]   << 16 |
+            inData[i+1] << 8;
+
+        out[0] = binaryToAscii[ 0x3F & ( block >> 18 ) ];
+        out[1] = binaryToAscii[ 0x3F & ( block >> 12 ) ];
+        out[2] = binaryToAscii[ 0x3F & ( block >> 6 ) ];
+        out[3] = '=';
+        out += 4;
+        }
+
+    *out = '\0';
+
+    return (int)( out - outString );
+    }
+
 
 
+char *base64Encode( unsigned char *inData, int inDataLength,
+                    char inBreakLines ) {
 
-    // take groups of 4 encoded digits and map them to 3 data bytes
-    for( i=0; i<binaryEncodingLength; i=i+4 ) {
+    char *returnString =
+        new char[ getBase64EncodedLength( inDataLength, inBreakLines ) + 1 ];
+
+    base64EncodeInto( inData, inDataLength, returnString, inBreakLines );
+
+    return returnString;
+    }
 
-        if( i+3 < binaryEncodingLength ) {
-            // not at end yet
 
-            unsigned int block =
-                binaryEncoding[i]   << 18 |
-                binaryEncoding[i+1] << 12 |
-                binaryEncoding[i+2] << 6 |
-                binaryEncoding[i+3];
 
-            // data byte digits, with digitA at left
-            unsigned int digitA = 0xFF & ( block >> 16 );
-            unsigned int digitB = 0xFF & ( block >> 8 );
-            unsigned int digitC = 0xFF & ( block );
-            
-            decodedVector->push_back( digitA );
-            decodedVector->push_back( digitB );
-            decodedVector->push_back( digitC );            
+int getBase64MaxDecodedLength( int inBase64Length ) {
+    return ( ( inBase64Length + 3 ) / 4 ) * 3;
+    }
+
+
+
+int base64DecodeInto( char *inBase64String, int inBase64Length,
+                      unsigned char *outData ) {
+
+    unsigned char *in = (unsigned char *)inBase64String;
+    unsigned char *out = outData;
+
+#ifdef CPU_FEATURES_X86
+    int level = getEncodingSIMDLevel();
+#endif
+
+    // decoded digits waiting for a full group of 4
+    unsigned int block = 0;
+    int numInBlock = 0;
+
+    int i = 0;
+    while( i < inBase64Length ) {
+
+#ifdef CPU_FEATURES_X86
+        // vectors only start on a group boundary
+        if( level > 0 ) {
+            int numDone;
+
+            if( level == 2 ) {
+                numDone = base64DecodeAVX2( &( in[i] ), inBase64Length - i,
+                                            out );
+                }
+            else {
+                numDone = base64DecodeSSSE3( &( in[i] ), inBase64Length - i,
+                                             out );
+                }
+            i += numDone;
+            out += numDone / 4 * 3;
             }
-        else {
-            // at end
-            int numLeft = binaryEncodingLength - i;
-
-            switch( numLeft ) {
-                case 0:
-                    // no padding
-                    break;
-                case 1: {
-                    // impossible
-                    break;
-                    }
-                case 2: {
-                    // two base64 digits, one data byte
-                    unsigned int block =
-                        binaryEncoding[i]   << 18 |
-                        binaryEncoding[i+1] << 12 |
-                        0;
-                    
-                    // data byte digits, with digitA at left
-                    unsigned int digitA = 0xFF & ( block >> 16 );
-                    
-                    decodedVector->push_back( digitA );
-                    break;
-                    }
-                case 3: {
-                    // three base64 digits, two data bytes
-                    unsigned int block =
-                        binaryEncoding[i]   << 18 |
-                        binaryEncoding[i+1] << 12 |
-                        binaryEncoding[i+2] << 6 |
-                        0;
-
-                    // data byte digits, with digitA at left
-                    unsigned int digitA = 0xFF & ( block >> 16 );
-                    unsigned int digitB = 0xFF & ( block >> 8 );
-                    
-            
-                    decodedVector->push_back( digitA );
-                    decodedVector->push_back( digitB );
-                    break;
-                    }
-                default:
-                    break;
+#endif
+
+        int stepEnd = inBase64Length;
+
+#ifdef CPU_FEATURES_X86
+        if( level > 0 ) {
+            // step over whatever stopped the vectors (usually a line
+            // break) and on to the next group boundary
+            stepEnd = i + 1;
+            }
+#endif
+
+        while( i < stepEnd || ( numInBlock != 0 && i < inBase64Length ) ) {
+            unsigned char currentBinary = asciiToBinary[ in[i] ];
+            i++;
+
+            if( currentBinary == 0xFF ) {
+                // skip characters outside the alphabet
+                continue;
+                }
+
+            block = block << 6 | currentBinary;
+            numInBlock++;
+
+            if( numInBlock == 4 ) {
+                out[0] = 0xFF & ( block >> 16 );
+                out[1] = 0xFF & ( block >> 8 );
+                out[2] = 0xFF & ( block );
+                out += 3;
+
+                block = 0;
+                numInBlock = 0;
                 }
-            // done with all data
-            i = binaryEncodingLength;
             }
-        }    
+        }
 
-    delete [] binaryEncoding;
-    
 
-    *outDataLength = decodedVector->size();
-    unsigned char* returnData = decodedVector->getElementArray();
+    // leftover digits at end
+    if( numInBlock == 2 ) {
+        // two base64 digits, one data byte
+        out[0] = 0xFF & ( block >> 4 );
+        out += 1;
+        }
+    else if( numInBlock == 3 ) {
+        // three base64 digits, two data bytes
+        out[0] = 0xFF & ( block >> 10 );
+        out[1] = 0xFF & ( block >> 2 );
+        out += 2;
+        }
+
+    return (int)( out - outData );
+    }
+
+
+
+unsigned char *base64Decode( char *inBase64String,
+                             int *outDataLength ) {
+
+    int encodingLength = strlen( inBase64String );
+
+    unsigned char *returnData =
+        new unsigned char[ getBase64MaxDecodedLength( encodingLength ) ];
 
-    delete decodedVector;
+    *outDataLength = base64DecodeInto( inBase64String, encodingLength,
+                                       returnData );
 
     return returnData;
     }
@@ -90,9 +90,107 @@ unsigned char *base64Decode( char *inBase64String,
 
 
 
+// Versions of the above that write into buffers supplied by the caller,
+// for hot paths that reuse their buffers.  Results are identical.
+
+
+/**
+ * Encodes data as an ASCII hexidecimal string.
+ *
+ * @param outHexString buffer with room for 2 * inDataLength + 1
+ *   characters.  Gets a \0-terminated string.
+ */
+void hexEncodeInto( unsigned char *inData, int inDataLength,
+                    char *outHexString );
+
+
+
+/**
+ * Decodes raw data from an ASCII hexidecimal string.
+ *
+ * @param inHexString the hex characters, need not be \0-terminated.
+ * @param inHexLength the number of characters in inHexString.
+ * @param outData buffer with room for inHexLength / 2 bytes.
+ *
+ * @return true on success, or false if inHexLength is odd or
+ *   inHexString contains non-hex characters.
+ */
+char hexDecodeInto( char *inHexString, int inHexLength,
+                    unsigned char *outData );
+
+
+
+/**
+ * Gets the length of the base64 encoding of inDataLength bytes, not
+ * counting the terminating \0.
+ */
+int getBase64EncodedLength( int inDataLength, char inBreakLines = true );
+
+
+
+/**
+ * Encodes data as an ASCII base64 string.
+ *
+ * @param outString buffer with room for
+ *   getBase64EncodedLength( inDataLength, inBreakLines ) + 1 characters.
+ *   Gets a \0-terminated string.
+ *
+ * @return the length of the string written, not counting the \0.
+ */
+int base64EncodeInto( unsigned char *inData, int inDataLength,
+                      char *outString, char inBreakLines = true );
+
+
+
+/**
+ * Gets an upper bound on the data decoded from inBase64Length
+ * characters.
+ */
+int getBase64MaxDecodedLength( int inBase64Length );
+
+
+
+/**
+ * Decodes raw data from an ASCII base64 string.
+ *
+ * @param inBase64String the base64 characters, need not be
+ *   \0-terminated.  Characters outside the base64 alphabet, like line
+ *   breaks, are skipped.
+ * @param inBase64Length the number of characters in inBase64String.
+ * @param outData buffer with room for
+ *   getBase64MaxDecodedLength( inBase64Length ) bytes.
+ *
+ * @return the number of bytes decoded.
+ */
+int base64DecodeInto( char *inBase64String, int inBase64Length,
+                      unsigned char *outData );
+
+
+
+/**
+ * Gets the vector instruction level used by the hex and base64
+ * functions:  0 for scalar code, 1 for SSSE3, 2 for AVX2.
+ *
+ * See minorGems/system/cpuFeatures.h.
+ */
+int getEncodingSIMDLevel();
+
+
+
+/**
+ * Caps the level returned by getEncodingSIMDLevel.
+ */
+void setEncodingSIMDLimit( int inLevel );
+
+
+
+
 
 // implements zlib-compatible compression and decompression
 
+// for data too large to hold in memory at once, see DeflateOutputStream
+// and InflateInputStream, which read and write the same format
+
 // return NULL on failure, caller destroys result
 
 unsigned char *zipCompress( unsigned char *inData, int inDataLength,
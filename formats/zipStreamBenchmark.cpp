@@ -0,0 +1,595 @@
+// Measures streaming compression and decompression speed and peak memory
+// for DeflateOutputStream and InflateInputStream, serial and parallel,
+// against one-shot zipCompress.
+//
+// Input is generated text-like data, produced in pieces as it is written,
+// so even 2 GiB runs never hold the whole input.  Compressed output is
+// counted and dropped, except in the decompression runs, which keep it
+// in memory.
+//
+// Each run happens in a forked process, so the peak resident size
+// reported for it is its own.
+//
+// First checks round trips, through InflateInputStream and through
+// zipDecompress, at 10 MiB, and that every mode writes the same header.
+//
+// Usage:  zipStreamBenchmark [sizeInMiB ...]
+//
+// Defaults to 10 and 100 MiB.  Exits with non-zero status on failure.
+
+
+#include "minorGems/formats/DeflateOutputStream.h"
+#include "minorGems/formats/InflateInputStream.h"
+#include "minorGems/formats/encodingUtils.h"
+
+#include "minorGems/util/StringBufferOutputStream.h"
+#include "minorGems/util/ByteBufferInputStream.h"
+
+#include "minorGems/system/Time.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+
+
+#define PIECE_SIZE 65536
+
+#define MIB 1048576.0
+
+
+static const char *words[16] = {
+    "the", "player", "sprite", "of", "and", "frame", "server", "a",
+    "to", "socket", "in", "map", "object", "is", "with", "time" };
+
+
+
+// fills a piece of generated data, same result for same inPieceIndex
+static void generatePiece( unsigned int inPieceIndex,
+                           unsigned char *outPiece, int inLength ) {
+    unsigned int seed = inPieceIndex * 2654435761U + 12345;
+
+    int i = 0;
+    while( i < inLength ) {
+        seed = seed * 1103515245 + 12345;
+
+        const char *word = words[ ( seed >> 16 ) & 0xF ];
+
+        while( *word != '\0' && i < inLength ) {
+            outPiece[ i++ ] = *word;
+            word++;
+            }
+
+        if( i < inLength ) {
+            // occasional digits keep it from being too easy
+            if( ( seed >> 8 ) % 7 == 0 ) {
+                outPiece[ i++ ] = '0' + ( seed >> 24 ) % 10;
+                }
+            else {
+                outPiece[ i++ ] = ' ';
+                }
+            }
+        }
+    }
+
+
+
+// writes inNumBytes of generated data
+static char writeGenerated( OutputStream *inStream, double inNumBytes ) {
+    unsigned char *piece = new unsigned char[ PIECE_SIZE ];
+
+    char ok = true;
+    unsigned int index = 0;
+    double remaining = inNumBytes;
+
+    while( remaining > 0 && ok ) {
+        int length = PIECE_SIZE;
+        if( remaining < length ) {
+            length = (int)remaining;
+            }
+
+        generatePiece( index, piece, length );
+        index++;
+
+        ok = ( inStream->write( piece, length ) == length );
+        remaining -= length;
+        }
+
+    delete [] piece;
+    return ok;
+    }
+
+
+
+// checks inNumBytes read from inStream against generated data
+static char readAndCheckGenerated( InputStream *inStream,
+                                   double inNumBytes ) {
+    unsigned char *piece = new unsigned char[ PIECE_SIZE ];
+    unsigned char *readPiece = new unsigned char[ PIECE_SIZE ];
+
+    char ok = true;
+    unsigned int index = 0;
+    double remaining = inNumBytes;
+
+    while( remaining > 0 && ok ) {
+        int length = PIECE_SIZE;
+        if( remaining < length ) {
+            length = (int)remaining;
+            }
+
+        generatePiece( index, piece, length );
+        index++;
+
+        // odd read sizes
+        int numRead = 0;
+        while( numRead < length && ok ) {
+            int numToRead = length - numRead;
+            if( numToRead > 1000 + (int)( index % 5000 ) ) {
+                numToRead = 1000 + index % 5000;
+                }
+            long result = inStream->read( &( readPiece[ numRead ] ),
+                                          numToRead );
+            if( result <= 0 ) {
+                ok = false;
+                }
+            else {
+                numRead += result;
+                }
+            }
+
+        if( ok && memcmp( piece, readPiece, length ) != 0 ) {
+            ok = false;
+            }
+        remaining -= length;
+        }
+
+    if( ok ) {
+        // nothing extra
+        unsigned char extra;
+        ok = ( inStream->read( &extra, 1 ) == 0 );
+        }
+
+    delete [] piece;
+    delete [] readPiece;
+    return ok;
+    }
+
+
+
+// counts and drops everything
+class CountingOutputStream : public OutputStream {
+    public:
+        CountingOutputStream()
+                : mNumBytes( 0 ) {
+            }
+
+        long write( unsigned char *inBuffer, long inNumBytes ) {
+            mNumBytes += inNumBytes;
+            return inNumBytes;
+            }
+
+        double mNumBytes;
+    };
+
+
+
+// reads back chunks held by a StringBufferOutputStream
+class ChunkInputStream : public InputStream {
+    public:
+        ChunkInputStream( StringBufferOutputStream *inSource )
+                : mChunk( 0 ), mPos( 0 ) {
+            mNumChunks = inSource->getNumChunks();
+            mChunks = new unsigned char*[ mNumChunks ];
+            mLengths = new int[ mNumChunks ];
+            inSource->getChunks( mChunks, mLengths, mNumChunks );
+            }
+
+        ~ChunkInputStream() {
+            delete [] mChunks;
+            delete [] mLengths;
+            }
+
+        long read( unsigned char *inBuffer, long inNumBytes ) {
+            long numRead = 0;
+
+            while( numRead < inNumBytes && mChunk < mNumChunks ) {
+                long numLeft = mLengths[ mChunk ] - mPos;
+                long numThisTime = inNumBytes - numRead;
+                if( numLeft < numThisTime ) {
+                    numThisTime = numLeft;
+                    }
+
+                memcpy( &( inBuffer[ numRead ] ),
+                        &( mChunks[ mChunk ][ mPos ] ), numThisTime );
+
+                numRead += numThisTime;
+                mPos += numThisTime;
+
+                if( mPos == mLengths[ mChunk ] ) {
+                    mChunk++;
+                    mPos = 0;
+                    }
+                }
+            return numRead;
+            }
+
+    protected:
+        unsigned char **mChunks;
+        int *mLengths;
+        int mNumChunks;
+        int mChunk;
+        long mPos;
+    };
+
+
+
+static char checkRoundTrip( const char *inName, int inLevel,
+                            int inNumThreads, int inBlockSize,
+                            int inNumBytes ) {
+
+    StringBufferOutputStream compressed;
+
+    DeflateOutputStream *deflater =
+        new DeflateOutputStream( &compressed, inLevel, inNumThreads,
+                                 inBlockSize );
+
+    char ok = writeGenerated( deflater, inNumBytes ) && deflater->finish();
+
+    int compressedLength = 0;
+    unsigned char *compressedBytes = NULL;
+
+    if( ok ) {
+        compressedBytes = compressed.getBytes( &compressedLength );
+
+        // through stream
+        ByteBufferInputStream byteStream( compressedBytes,
+                                          compressedLength );
+        InflateInputStream inflater( &byteStream, 4096 );
+
+        ok = readAndCheckGenerated( &inflater, inNumBytes ) &&
+            inflater.isEndOfStream();
+        }
+
+    if( ok ) {
+        // through one-shot call
+        unsigned char *raw = zipDecompress( compressedBytes, compressedLength,
+                                            inNumBytes );
+        ok = ( raw != NULL );
+
+        if( ok ) {
+            ByteBufferInputStream rawStream( raw, inNumBytes );
+            ok = readAndCheckGenerated( &rawStream, inNumBytes );
+            delete [] raw;
+            }
+        }
+
+    if( ok ) {
+        // reused stream gives same bytes
+        StringBufferOutputStream compressedAgain;
+        deflater->reset( &compressedAgain );
+
+        ok = writeGenerated( deflater, inNumBytes ) && deflater->finish();
+
+        int againLength = 0;
+        unsigned char *againBytes = compressedAgain.getBytes( &againLength );
+
+        ok = ok && againLength == compressedLength &&
+            memcmp( againBytes, compressedBytes, againLength ) == 0;
+
+        delete [] againBytes;
+        }
+
+    printf( "%-34s %s  (ratio %.2f)\n", inName, ok ? "ok    " : "FAILED",
+            (double)inNumBytes / compressedLength );
+
+    if( compressedBytes != NULL ) {
+        delete [] compressedBytes;
+        }
+    delete deflater;
+
+    return ok;
+    }
+
+
+
+static char checkTruncated() {
+    StringBufferOutputStream compressed;
+
+    DeflateOutputStream deflater( &compressed );
+    writeGenerated( &deflater, 100000 );
+    deflater.finish();
+
+    int length;
+    unsigned char *bytes = compressed.getBytes( &length );
+
+    ByteBufferInputStream byteStream( bytes, length / 2 );
+    InflateInputStream inflater( &byteStream );
+
+    unsigned char *buffer = new unsigned char[ 100000 ];
+
+    long total = 0;
+    long result = 1;
+    while( result > 0 ) {
+        result = inflater.read( buffer, 100000 );
+        if( result > 0 ) {
+            total += result;
+            }
+        }
+
+    char ok = ( result == -1 && total < 100000 );
+
+    printf( "%-34s %s\n", "truncated stream reports error",
+            ok ? "ok" : "FAILED" );
+
+    delete [] buffer;
+    delete [] bytes;
+    return ok;
+    }
+
+
+
+// parallel streams write the same zlib header as serial ones, and as
+// zipCompress
+static char checkHeaders() {
+    char ok = true;
+
+    for( int level=-1; level<=9; level++ ) {
+        unsigned char headers[2][2];
+
+        for( int parallel=0; parallel<2; parallel++ ) {
+            StringBufferOutputStream compressed;
+
+            DeflateOutputStream deflater( &compressed, level,
+                                          parallel ? 2 : 0, 65536 );
+            writeGenerated( &deflater, 100000 );
+            deflater.finish();
+
+            int length;
+            unsigned char *bytes = compressed.getBytes( &length );
+
+            memcpy( headers[ parallel ], bytes, 2 );
+            delete [] bytes;
+            }
+
+        if( memcmp( headers[0], headers[1], 2 ) != 0 ) {
+            ok = false;
+            }
+
+        if( level == -1 ) {
+            StringBufferOutputStream raw;
+            writeGenerated( &raw, 100000 );
+
+            int length;
+            unsigned char *rawBytes = raw.getBytes( &length );
+
+            int compressedLength;
+            unsigned char *compressed = zipCompress( rawBytes, length,
+                                                     &compressedLength );
+
+            if( memcmp( headers[1], compressed, 2 ) != 0 ) {
+                ok = false;
+                }
+
+            delete [] compressed;
+            delete [] rawBytes;
+            }
+        }
+
+    printf( "%-34s %s\n", "headers match across modes",
+            ok ? "ok" : "FAILED" );
+
+    return ok;
+    }
+
+
+
+// runs in forked process
+static void runDeflate( int inLevel, int inNumThreads, double inNumBytes ) {
+    CountingOutputStream counter;
+    DeflateOutputStream deflater( &counter, inLevel, inNumThreads );
+
+    double startTime = Time::getCurrentTime();
+
+    writeGenerated( &deflater, inNumBytes );
+    deflater.finish();
+
+    double time = Time::getCurrentTime() - startTime;
+
+    char levelName[20];
+    if( inLevel == -1 ) {
+        sprintf( levelName, "default" );
+        }
+    else {
+        sprintf( levelName, "level %d", inLevel );
+        }
+
+    char name[100];
+    if( inNumThreads == 0 ) {
+        sprintf( name, "deflate %s, serial", levelName );
+        }
+    else {
+        sprintf( name, "deflate %s, %d threads", levelName, inNumThreads );
+        }
+
+    printf( "  %-30s %8.1f MB/s  ratio %.2f", name,
+            inNumBytes / MIB / time, inNumBytes / counter.mNumBytes );
+    }
+
+
+
+// runs in forked process
+static void runZipCompress( double inNumBytes ) {
+    double startTime = Time::getCurrentTime();
+
+    // whole input in memory
+    StringBufferOutputStream raw;
+    writeGenerated( &raw, inNumBytes );
+
+    int length;
+    unsigned char *rawBytes = raw.detachBytes( &length );
+
+    int compressedLength;
+    unsigned char *compressed = zipCompress( rawBytes, length,
+                                             &compressedLength );
+
+    double time = Time::getCurrentTime() - startTime;
+
+    printf( "  %-30s %8.1f MB/s  ratio %.2f", "zipCompress, one shot",
+            inNumBytes / MIB / time, inNumBytes / compressedLength );
+
+    delete [] compressed;
+    delete [] rawBytes;
+    }
+
+
+
+// runs in forked process
+static void runInflate( double inNumBytes ) {
+    StringBufferOutputStream compressed;
+
+    DeflateOutputStream deflater( &compressed );
+    writeGenerated( &deflater, inNumBytes );
+    deflater.finish();
+
+    ChunkInputStream compressedStream( &compressed );
+    InflateInputStream inflater( &compressedStream );
+
+    unsigned char *buffer = new unsigned char[ PIECE_SIZE ];
+
+    double startTime = Time::getCurrentTime();
+
+    double total = 0;
+    long numRead = 1;
+    while( numRead > 0 ) {
+        numRead = inflater.read( buffer, PIECE_SIZE );
+        if( numRead > 0 ) {
+            total += numRead;
+            }
+        }
+
+    double time = Time::getCurrentTime() - startTime;
+
+    printf( "  %-30s %8.1f MB/s  %s", "inflate (input kept in memory)",
+            total / MIB / time, total == inNumBytes ? "" : "SIZE MISMATCH" );
+
+    delete [] buffer;
+    }
+
+
+
+static void runForked( int inKind, int inLevel, int inNumThreads,
+                       double inNumBytes ) {
+    fflush( stdout );
+
+    pid_t pid = fork();
+
+    if( pid == 0 ) {
+        if( inKind == 0 ) {
+            runDeflate( inLevel, inNumThreads, inNumBytes );
+            }
+        else if( inKind == 1 ) {
+            runZipCompress( inNumBytes );
+            }
+        else {
+            runInflate( inNumBytes );
+            }
+        fflush( stdout );
+        exit( 0 );
+        }
+
+    int status;
+    struct rusage usage;
+    wait4( pid, &status, 0, &usage );
+
+    if( ! WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+        printf( "  (run failed)\n" );
+        return;
+        }
+
+    // ru_maxrss is in KiB on Linux
+    printf( "  peak %7.1f MiB\n", usage.ru_maxrss / 1024.0 );
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    char ok = true;
+
+    int checkSize = 10 * 1048576;
+
+    ok &= checkRoundTrip( "serial, default level", -1, 0, 0, checkSize );
+    ok &= checkRoundTrip( "serial, level 1", 1, 0, 0, checkSize );
+    ok &= checkRoundTrip( "serial, level 6", 6, 0, 0, checkSize );
+    ok &= checkRoundTrip( "serial, level 9", 9, 0, 0, checkSize );
+    ok &= checkRoundTrip( "serial, level 0", 0, 0, 0, checkSize );
+    ok &= checkRoundTrip( "1 thread, level 6", 6, 1, 1048576, checkSize );
+    ok &= checkRoundTrip( "4 threads, default level", -1, 4, 1048576,
+                          checkSize );
+    ok &= checkRoundTrip( "4 threads, level 6", 6, 4, 1048576, checkSize );
+    ok &= checkRoundTrip( "4 threads, level 0", 0, 4, 1048576, checkSize );
+    ok &= checkRoundTrip( "3 threads, odd block size", 6, 3, 100003,
+                          checkSize );
+    ok &= checkRoundTrip( "2 threads, exact blocks", 6, 2, 1048576,
+                          4 * 1048576 );
+    ok &= checkRoundTrip( "serial, empty", 6, 0, 0, 0 );
+    ok &= checkRoundTrip( "2 threads, empty", 6, 2, 1048576, 0 );
+    ok &= checkTruncated();
+    ok &= checkHeaders();
+
+    if( ! ok ) {
+        printf( "\nFAILED\n" );
+        return 1;
+        }
+
+
+    double defaultSizes[2] = { 10, 100 };
+
+    int numSizes = 2;
+    double *sizes = defaultSizes;
+
+    if( inNumArgs > 1 ) {
+        numSizes = inNumArgs - 1;
+        sizes = new double[ numSizes ];
+        for( int i=0; i<numSizes; i++ ) {
+            sizes[i] = atof( inArgs[ i + 1 ] );
+            }
+        }
+
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+
+    // each forked run starts out with this much
+    printf( "\nBaseline resident size %.1f MiB\n", usage.ru_maxrss / 1024.0 );
+
+    for( int s=0; s<numSizes; s++ ) {
+        double numBytes = sizes[s] * MIB;
+
+        printf( "\n%.0f MiB:\n", sizes[s] );
+
+        // one-shot call needs input and output in memory, and an
+        // int size
+        if( numBytes < 512 * MIB ) {
+            runForked( 1, -1, 0, numBytes );
+            }
+
+        runForked( 0, 1, 0, numBytes );
+        runForked( 0, 6, 0, numBytes );
+        runForked( 0, -1, 0, numBytes );
+        runForked( 0, -1, 2, numBytes );
+        runForked( 0, -1, 4, numBytes );
+        runForked( 2, -1, 0, numBytes );
+        }
+
+    if( sizes != defaultSizes ) {
+        delete [] sizes;
+        }
+
+    return 0;
+    }
@@ -1,6 +1,7 @@
 #include "Font.h"
 
 #include "minorGems/graphics/RGBAImage.h"
+#include "minorGems/util/stringUtils.h"
 
 #include <string.h>
 
@@ -29,19 +30,30 @@ typedef union rgbaColor {
 const unsigned char inkA = 127;
 
 
+// number of laid-out strings remembered by each font
+// must be a power of 2
+#define RUN_CACHE_SIZE 1024
+
+
 
 Font::Font( const char *inFileName, int inCharSpacing, int inSpaceWidth,
             char inFixedWidth, double inScaleFactor, int inFixedCharWidth )
         : mScaleFactor( inScaleFactor ),
           mCharSpacing( inCharSpacing ), mSpaceWidth( inSpaceWidth ),
           mFixedWidth( inFixedWidth ), mEnableKerning( true ),
-          mMinimumPositionPrecision( 0 ) {
+          mMinimumPositionPrecision( 0 ),
+          mRunCache( new TextRun[ RUN_CACHE_SIZE ] ),
+          mDrawPositions( NULL ), mNumDrawPositions( 0 ) {
 
     for( int i=0; i<256; i++ ) {
         mSpriteMap[i] = NULL;
         mKerningTable[i] = NULL;
         }
     
+    for( int i=0; i<RUN_CACHE_SIZE; i++ ) {
+        mRunCache[i].string = NULL;
+        }
+    
 
 
     Image *spriteImage = readTGAFile( inFileName );
@@ -107,6 +119,11 @@ Font::Font( const char *inFileName, int inCharSpacing, int inSpaceWidth,
 
 
         int pixelsPerChar = mSpriteWidth * mSpriteHeight;
+        
+        // pack all glyphs into a shared atlas texture, so that whole strings
+        // can be drawn with one draw call
+        char oldAtlasPacking = getSpriteAtlasPacking();
+        toggleSpriteAtlasPacking( true );
             
         // hold onto these for true kerning after
         // we've read this data for all characters
@@ -220,6 +237,9 @@ Font::Font( const char *inFileName, int inCharSpacing, int inSpaceWidth,
             }
         
 
+        toggleSpriteAtlasPacking( oldAtlasPacking );
+        
+
         // now that we've read in all characters, we can do real kerning
         if( !mFixedWidth ) {
             
@@ -374,6 +394,28 @@ Font::~Font() {
             delete mKerningTable[i];
             }
         }
+    
+    clearTextRunCache();
+    delete [] mRunCache;
+    
+    if( mDrawPositions != NULL ) {
+        delete [] mDrawPositions;
+        }
+    }
+
+
+
+void Font::clearTextRunCache() {
+    for( int i=0; i<RUN_CACHE_SIZE; i++ ) {
+        TextRun *run = &( mRunCache[i] );
+        
+        if( run->string != NULL ) {
+            delete [] run->string;
+            delete [] run->sprites;
+            delete [] run->glyphOffsets;
+            run->string = NULL;
+            }
+        }
     }
 
 
@@ -415,6 +457,9 @@ void Font::copySpacing( Font *inOtherFont ) {
         
 
     mCharBlockWidth = inOtherFont->mCharBlockWidth;
+    
+    // cached layouts used old spacing
+    clearTextRunCache();
     }
 
 
@@ -433,22 +478,15 @@ double Font::getCharSpacing() {
 
 
 
-double Font::getCharPos( SimpleVector<doublePair> *outPositions,
-                         const char *inString, doublePair inPosition,
-                         TextAlignment inAlign ) {
-
+doublePair Font::getStartOffset( const char *inString, 
+                                 TextAlignment inAlign ) {
     double scale = scaleFactor * mScaleFactor;
     
-    unsigned int numChars = strlen( inString );
-    
-    double x = inPosition.x;
-    
-    
-    double y = inPosition.y;
+    doublePair offset = { 0, 0 };
 
     // compensate for extra headspace in accent-equipped font files
     if( mAccentsPresent ) { 
-        y += scale * mSpriteHeight / 4;
+        offset.y += scale * mSpriteHeight / 4;
         }
 
     
@@ -460,10 +498,10 @@ double Font::getCharPos( SimpleVector<doublePair> *outPositions,
     
     switch( inAlign ) {
         case alignCenter:
-            x -= stringWidth / 2;
+            offset.x -= stringWidth / 2;
             break;
         case alignRight:
-            x -= stringWidth;
+            offset.x -= stringWidth;
             break;
         default:
             // left?  do nothing
@@ -472,9 +510,16 @@ double Font::getCharPos( SimpleVector<doublePair> *outPositions,
     
     // character sprites are drawn on their centers, so the alignment
     // adjustments above aren't quite right.
-    x += scale * mSpriteWidth / 2;
+    offset.x += scale * mSpriteWidth / 2;
 
+    return offset;
+    }
 
+
+
+double Font::roundToPrecision( double inX ) {
+    double x = inX;
+    
     if( mMinimumPositionPrecision > 0 ) {
         x /= mMinimumPositionPrecision;
         
@@ -482,7 +527,20 @@ double Font::getCharPos( SimpleVector<doublePair> *outPositions,
         
         x *= mMinimumPositionPrecision;
         }
+    return x;
+    }
+
+
+
+double Font::layOutCharacters( SimpleVector<doublePair> *outPositions,
+                               const char *inString, doublePair inStart ) {
+
+    double scale = scaleFactor * mScaleFactor;
     
+    unsigned int numChars = strlen( inString );
+    
+    double x = inStart.x;
+    double y = inStart.y;
 
     for( unsigned int i=0; i<numChars; i++ ) {
         doublePair charPos = { x, y };
@@ -513,25 +571,102 @@ double Font::getCharPos( SimpleVector<doublePair> *outPositions,
 
 
 
-
-double Font::drawString( const char *inString, doublePair inPosition,
+double Font::getCharPos( SimpleVector<doublePair> *outPositions,
+                         const char *inString, doublePair inPosition,
                          TextAlignment inAlign ) {
-    SimpleVector<doublePair> pos( strlen( inString ) );
 
-    double returnVal = getCharPos( &pos, inString, inPosition, inAlign );
+    doublePair start = add( inPosition, getStartOffset( inString, inAlign ) );
+    
+    start.x = roundToPrecision( start.x );
+    
+    return layOutCharacters( outPositions, inString, start );
+    }
+
 
-    double scale = scaleFactor * mScaleFactor;
+
+TextRun *Font::getTextRun( const char *inString, TextAlignment inAlign ) {
+    
+    unsigned int hash = 5381 + inAlign;
+    
+    for( const char *c = inString; *c != '\0'; c++ ) {
+        hash = hash * 33 + (unsigned char)( *c );
+        }
+    
+    TextRun *run = &( mRunCache[ hash & ( RUN_CACHE_SIZE - 1 ) ] );
+    
+    if( run->string != NULL ) {
+        if( run->align == inAlign && strcmp( run->string, inString ) == 0 ) {
+            return run;
+            }
+        
+        // replace it
+        delete [] run->string;
+        delete [] run->sprites;
+        delete [] run->glyphOffsets;
+        run->string = NULL;
+        }
+    
+
+    // lay out from 0,0 so positions are relative to first character
+    doublePair start = getStartOffset( inString, inAlign );
+    doublePair origin = { 0, start.y };
+    
+    SimpleVector<doublePair> positions;
+    
+    run->endOffset = layOutCharacters( &positions, inString, origin );
+    run->startOffset = start.x;
+    
+
+    int numChars = positions.size();
     
-    for( int i=0; i<pos.size(); i++ ) {
+    run->numGlyphs = 0;
+    run->sprites = new SpriteHandle[ numChars ];
+    run->glyphOffsets = new doublePair[ numChars ];
+    
+    for( int i=0; i<numChars; i++ ) {
         SpriteHandle spriteID = mSpriteMap[ (unsigned char)( inString[i] ) ];
     
         if( spriteID != NULL ) {
-            drawSprite( spriteID, pos.getElementDirect(i), scale );
+            run->sprites[ run->numGlyphs ] = spriteID;
+            run->glyphOffsets[ run->numGlyphs ] = 
+                positions.getElementDirect( i );
+            run->numGlyphs++;
             }
+        }
     
+    run->string = stringDuplicate( inString );
+    run->align = inAlign;
+    
+    return run;
+    }
+
+
+
+
+double Font::drawString( const char *inString, doublePair inPosition,
+                         TextAlignment inAlign ) {
+    
+    TextRun *run = getTextRun( inString, inAlign );
+    
+    doublePair start = inPosition;
+    start.x = roundToPrecision( start.x + run->startOffset );
+    
+    if( run->numGlyphs > mNumDrawPositions ) {
+        delete [] mDrawPositions;
+        mNumDrawPositions = run->numGlyphs;
+        mDrawPositions = new doublePair[ mNumDrawPositions ];
         }
     
-    return returnVal;
+    for( int i=0; i<run->numGlyphs; i++ ) {
+        mDrawPositions[i] = add( start, run->glyphOffsets[i] );
+        }
+    
+    double scale = scaleFactor * mScaleFactor;
+
+    // whole string in one batch
+    drawSprites( run->numGlyphs, run->sprites, mDrawPositions, scale );
+    
+    return start.x + run->endOffset;
     }
 
 
@@ -656,6 +791,9 @@ double Font::getFontHeight() {
 
 
 void Font::enableKerning( char inKerningOn ) {
+    if( inKerningOn != mEnableKerning ) {
+        clearTextRunCache();
+        }
     mEnableKerning = inKerningOn;
     }
 
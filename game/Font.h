@@ -14,6 +14,29 @@ enum TextAlignment {
 
 
 
+// a string laid out relative to the position it is drawn at
+typedef struct TextRun {
+        // NULL for an empty cache slot
+        char *string;
+        
+        TextAlignment align;
+        
+        // offset from draw position to center of first character,
+        // before rounding to minimum position precision
+        double startOffset;
+        
+        // the rest are relative to the rounded first character position
+        
+        double endOffset;
+        
+        // only characters that have sprites
+        int numGlyphs;
+        SpriteHandle *sprites;
+        doublePair *glyphOffsets;
+    } TextRun;
+
+
+
 // a table for a given character
 // extra kerning offsets for each character that could follow
 // this character
@@ -94,6 +117,24 @@ class Font {
         double positionCharacter( unsigned char inC, doublePair inTargetPos,
                                   doublePair *outActualPos );
 
+        // offset from target position to center of first character, before
+        // rounding to minimum position precision
+        doublePair getStartOffset( const char *inString, 
+                                   TextAlignment inAlign );
+        
+        double roundToPrecision( double inX );
+        
+        // positions characters from center of first one
+        // returns x coordinate of string end
+        double layOutCharacters( SimpleVector<doublePair> *outPositions,
+                                 const char *inString, doublePair inStart );
+
+        // finds string in run cache, laying it out and adding it if needed
+        TextRun *getTextRun( const char *inString, TextAlignment inAlign );
+        
+        void clearTextRunCache();
+        
+
         
         double mScaleFactor;
         
@@ -128,6 +169,14 @@ class Font {
         char mEnableKerning;
 
         double mMinimumPositionPrecision;
+        
+        
+        // hashed by string and alignment, one run per slot
+        TextRun *mRunCache;
+        
+        // reused by drawString
+        doublePair *mDrawPositions;
+        int mNumDrawPositions;
     };
 
 
@@ -199,6 +199,31 @@ void toggleMipMapGeneration( char inGenerateMipMaps );
 void toggleTransparentCropping( char inCrop );
 
 
+// if on, small RGBA sprites are packed into shared atlas textures, so that
+// sprites from the same atlas can be drawn in one batch
+// (see toggleSpriteBatching)
+// Ignored for sprites loaded with mipmap generation on.
+// MUST be turned on before loading or filling sprites.
+// Defaults to off.
+void toggleSpriteAtlasPacking( char inPack );
+
+char getSpriteAtlasPacking();
+
+
+// if on, drawSprite calls are queued and drawn in batches, with a new
+// batch started whenever the texture or texture filtering changes
+// (or when blend mode, stenciling, or scissoring change through the calls
+//  in this file)
+//
+// Queued sprites are drawn at the end of each frame, or by
+// flushSpriteBatch, which must be called before changing GL state directly.
+//
+// Defaults to off.
+void toggleSpriteBatching( char inBatch );
+
+void flushSpriteBatch();
+
+
 // loads sprite from graphics directory
 // can be NULL on load failure
 SpriteHandle loadSprite( const char *inTGAFileName, 
@@ -287,6 +312,16 @@ double endCountingSpritesDrawn();
 
 
 
+void startCountingSpriteDrawCalls();
+
+// returns the number of GL draw calls used for drawing sprites since we 
+// started counting
+// outNumBatches, if not NULL, is set to how many of those calls drew
+// batches of sprites
+double endCountingSpriteDrawCalls( double *outNumBatches = NULL );
+
+
+
 // draw with current draw color
 // mag filter defaults to off (nearest neighbor, big pixels)
 // Rotation is in fractions of a full clockwise rotation (0.25 is 90 deg cw)
@@ -295,6 +330,13 @@ void drawSprite( SpriteHandle inSprite, doublePair inCenter,
                  double inRotation = 0.0,
                  char inFlipH = false );
 
+// draws several sprites with current draw color, all at the same zoom
+// Runs of sprites that share an atlas texture are drawn with one draw call,
+// even if sprite batching is off.
+void drawSprites( int inNumSprites, SpriteHandle inSprites[], 
+                  doublePair inCenters[], double inZoom = 1.0 );
+
+
 // draw sprite with separate colors set for each corner
 // corners in BL, BR, TR, TL order
 void drawSprite( SpriteHandle inSprite, doublePair inCenter, 
@@ -51,6 +51,7 @@ int main( int inArgCount, char **inArgs ) {
 #include "minorGems/network/HostAddress.h"
 #include "minorGems/network/Socket.h"
 #include "minorGems/network/SocketClient.h"
+#include "minorGems/network/SocketIOEngine.h"
 
 #include "minorGems/network/upnp/portMapping.h"
 
@@ -65,6 +66,7 @@ int main( int inArgCount, char **inArgs ) {
 #include "minorGems/util/log/FileLog.h"
 
 #include "minorGems/graphics/converters/TGAImageConverter.h"
+#include "minorGems/graphics/FrameCapture.h"
 
 #include "minorGems/io/file/FileInputStream.h"
 #include "minorGems/util/ByteBufferInputStream.h"
@@ -306,6 +308,19 @@ char blendOutputFramePairs = false;
 float blendOutputFrameFraction = 0;
 
 
+// when outputting all frames, frames are encoded on worker threads
+static FrameCapture *frameCapture = NULL;
+
+static int outputFrameThreads = 4;
+static int outputFrameBuffers = 8;
+
+// skip frames when encoding can't keep up, instead of slowing down game
+static char outputFrameDrop = false;
+
+// write all frames into a single raw y4m video stream instead of images
+static char outputAllFramesY4M = false;
+
+
 char *webProxy = NULL;
 
 
@@ -318,6 +333,10 @@ static unsigned int frameNumber = 0;
 
 static char recordAudio = false;
 
+// look-ahead limiter for master mix, or NULL to use audioNoClip,
+// which matches audio from older builds exactly
+static NoClipLimiter *totalAudioMixLimiter = NULL;
+
 static FILE *aiffOutFile = NULL;
 
 static int samplesLeftToRecord = 0;
@@ -505,9 +524,18 @@ SimpleVector<WebRequestRecord> webRequestRecords;
 typedef struct SocketConnectionRecord {
         int handle;
         Socket *sock;
+
+        // -1 if socket is not handled by socketIOEngine
+        int engineID;
     } SocketConnectionRecord;
 
-SimpleVector<SocketConnectionRecord> socketConnectionRecords;
+// indexed by handle, NULL for closed or failed handles
+SimpleVector<SocketConnectionRecord*> socketConnectionRecords;
+
+
+// optional background thread that does all socket I/O, so the
+// non-blocking socket calls below only copy memory
+static SocketIOEngine *socketIOEngine = NULL;
 
 
 
@@ -616,6 +644,11 @@ void cleanUpAtExit() {
         freeHintedBuffers();
         bufferSizeHinted = false;
         }
+
+    if( totalAudioMixLimiter != NULL ) {
+        deleteNoClipLimiter( totalAudioMixLimiter );
+        totalAudioMixLimiter = NULL;
+        }
     
 
     if( frameDrawerInited ) {
@@ -645,6 +678,20 @@ void cleanUpAtExit() {
         screenShotPrefix = NULL;
         }
 
+    if( socketIOEngine != NULL ) {
+        AppLog::info( "exiting: stopping socket I/O thread\n" ); 
+        
+        delete socketIOEngine;
+        socketIOEngine = NULL;
+        }
+
+    if( frameCapture != NULL ) {
+        AppLog::info( "exiting: finishing output of captured frames\n" ); 
+        
+        delete frameCapture;
+        frameCapture = NULL;
+        }
+
     if( lastFrame_rgbaBytes != NULL ) {
         AppLog::info( "exiting: deleting lastFrame_rgbaBytes\n" ); 
         
@@ -1199,9 +1246,9 @@ void audioCallback( void *inUserData, Uint8 *inStream, int inLengthToFill ) {
 
 
         // respect their collective volume cap
-        audioNoClip( &soundSpriteNoClip,
-                     soundSpriteMixingBufferL, soundSpriteMixingBufferR,
-                     numSamples );
+        audioNoClipBlock( &soundSpriteNoClip,
+                          soundSpriteMixingBufferL, soundSpriteMixingBufferR,
+                          numSamples );
 
         // and normalize to compensate for any compression below that cap
         if( totalSoundSpriteNormalizeFactor != 1.0 ) {
@@ -1250,9 +1297,17 @@ void audioCallback( void *inUserData, Uint8 *inStream, int inLengthToFill ) {
 
         
         // we have our final mix, make sure it never clips
-        audioNoClip( &totalAudioMixNoClip,
-                     soundSpriteMixingBufferL, soundSpriteMixingBufferR,
-                     numSamples );
+        if( totalAudioMixLimiter != NULL ) {
+            noClipLimit( totalAudioMixLimiter,
+                         soundSpriteMixingBufferL, soundSpriteMixingBufferR,
+                         numSamples );
+            }
+        else {
+            audioNoClipBlock( &totalAudioMixNoClip,
+                              soundSpriteMixingBufferL, 
+                              soundSpriteMixingBufferR,
+                              numSamples );
+            }
 
         
         // now convert back to integers
@@ -1719,6 +1774,15 @@ int mainFunction( int inNumArgs, char **inArgs ) {
     #endif
         
 
+#ifdef HEADLESS_OSMESA
+    if( SettingsManager::getIntSetting( "benchmarkPlayback", 0 ) == 1 ) {
+        // ScreenGL draws into an offscreen buffer, so SDL needs no
+        // display or sound device at all (for CI machines)
+        SDL_putenv( (char*)"SDL_VIDEODRIVER=dummy" );
+        SDL_putenv( (char*)"SDL_AUDIODRIVER=dummy" );
+        }
+#endif
+
     // check result below, after opening log, so we can log failure
     Uint32 flags = SDL_INIT_VIDEO | SDL_INIT_NOPARACHUTE;
     if( getUsesSound() ) {
@@ -2181,6 +2245,16 @@ int mainFunction( int inNumArgs, char **inArgs ) {
     blendOutputFrameFraction = 
         SettingsManager::getFloatSetting( "blendOutputFrameFraction", 0.0f );
 
+    outputFrameThreads = 
+        SettingsManager::getIntSetting( "outputAllFramesThreads", 4 );
+    outputFrameBuffers = 
+        SettingsManager::getIntSetting( "outputAllFramesBuffers", 
+                                        2 * outputFrameThreads );
+    outputFrameDrop = 
+        ( SettingsManager::getIntSetting( "outputAllFramesDrop", 0 ) == 1 );
+    outputAllFramesY4M = 
+        ( SettingsManager::getIntSetting( "outputAllFramesY4M", 0 ) == 1 );
+
     webProxy = SettingsManager::getStringSetting( "webProxy" );
     
     if( webProxy != NULL && 
@@ -2252,6 +2326,14 @@ int mainFunction( int inNumArgs, char **inArgs ) {
     // call this again here, because screenWidth or screenHeight might
     // have changed from what we requested
     handleTooWide();
+
+
+    // before any sprites are loaded
+    toggleSpriteAtlasPacking(
+        SettingsManager::getIntSetting( "spriteAtlas", 0 ) == 1 );
+    
+    toggleSpriteBatching(
+        SettingsManager::getIntSetting( "spriteBatching", 0 ) == 1 );
     
     
     
@@ -2617,6 +2699,25 @@ int mainFunction( int inNumArgs, char **inArgs ) {
                                       soundSampleRate / 20, 
                                       soundSampleRate / 20 );
 
+                // off by default, because it delays the mix and changes
+                // its output compared to older builds
+                int limiterLookAheadMS =
+                    SettingsManager::getIntSetting( 
+                        "audioLimiterLookAheadMS", 0 );
+
+                if( totalAudioMixLimiter != NULL ) {
+                    deleteNoClipLimiter( totalAudioMixLimiter );
+                    totalAudioMixLimiter = NULL;
+                    }
+                
+                if( limiterLookAheadMS > 0 ) {
+                    totalAudioMixLimiter = 
+                        newNoClipLimiter( 32767.0,
+                                          soundSampleRate / 20, 
+                                          soundSampleRate / 20,
+                                          limiterLookAheadMS * 
+                                          soundSampleRate / 1000 );
+                    }
 
 
                 if( !recordAudioFlag ) {
@@ -2816,6 +2917,9 @@ static float visibleHeight = -1;
 
 
 static void redoDrawMatrix() {
+    // queued sprites were positioned with old matrix
+    flushSpriteBatch();
+    
     // viewport square centered on screen (even if screen is rectangle)
     float hRadius = viewSize / 2;
     
@@ -3426,6 +3530,8 @@ void GameSceneHandler::drawScene() {
         
         drawFrame( update );
         
+        flushSpriteBatch();
+
         if( cursorMode > 0 ) {
             // draw emulated cursor
 
@@ -3770,6 +3876,8 @@ void GameSceneHandler::drawScene() {
         }
     
 
+    flushSpriteBatch();
+
     if( shouldTakeScreenshot ) {
         takeScreenShot();
 
@@ -4522,6 +4630,12 @@ void startOutputAllFrames() {
 void stopOutputAllFrames() {
     outputAllFrames = false;
     shouldTakeScreenshot = false;
+
+    if( frameCapture != NULL ) {
+        // finish writing queued frames and close any y4m stream
+        delete frameCapture;
+        frameCapture = NULL;
+        }
     }
 
 
@@ -4534,15 +4648,10 @@ void stopOutputAllFrames() {
 // according to blending settings)
 //
 // Region in screen pixels
-static Image *getScreenRegionInternal( 
-    int inStartX, int inStartY, int inWidth, int inHeight,
-    char inForceManual = false ) {    
-        
-    int numBytes = inWidth * inHeight * 3;
-    
-    unsigned char *rgbBytes = 
-        new unsigned char[ numBytes ];
-
+// reads raw RGB bytes, bottom row first
+static void readScreenBytes( int inStartX, int inStartY, 
+                             int inWidth, int inHeight,
+                             unsigned char *outRGBBytes ) {
     // w and h might not be multiples of 4
     GLint oldAlignment;
     glGetIntegerv( GL_PACK_ALIGNMENT, &oldAlignment );
@@ -4550,9 +4659,23 @@ static Image *getScreenRegionInternal(
     glPixelStorei( GL_PACK_ALIGNMENT, 1 );
     
     glReadPixels( inStartX, inStartY, inWidth, inHeight, 
-                  GL_RGB, GL_UNSIGNED_BYTE, rgbBytes );
+                  GL_RGB, GL_UNSIGNED_BYTE, outRGBBytes );
     
     glPixelStorei( GL_PACK_ALIGNMENT, oldAlignment );
+    }
+
+
+
+static Image *getScreenRegionInternal( 
+    int inStartX, int inStartY, int inWidth, int inHeight,
+    char inForceManual = false ) {    
+        
+    int numBytes = inWidth * inHeight * 3;
+    
+    unsigned char *rgbBytes = 
+        new unsigned char[ numBytes ];
+
+    readScreenBytes( inStartX, inStartY, inWidth, inHeight, rgbBytes );
 
 
     if( ! inForceManual &&
@@ -4645,6 +4768,101 @@ static char shotDirExists = false;
 static int outputFrameCount = 0;
 
 
+
+// makes sure frameCapture exists and matches current screen size
+// inY4MFile is NULL for image file output
+static void prepareFrameCapture( File *inY4MFile ) {
+    if( frameCapture != NULL &&
+        ( frameCapture->getWidth() != screenWidth ||
+          frameCapture->getHeight() != screenHeight ) ) {
+        delete frameCapture;
+        frameCapture = NULL;
+        }
+
+    if( frameCapture != NULL ) {
+        return;
+        }
+    
+    FrameCaptureOverflowPolicy policy = FRAME_CAPTURE_BLOCK;
+    if( outputFrameDrop ) {
+        policy = FRAME_CAPTURE_DROP;
+        }
+    
+    if( inY4MFile != NULL ) {
+        frameCapture = new FrameCapture( screenWidth, screenHeight,
+                                         inY4MFile, targetFrameRate,
+                                         outputFrameThreads,
+                                         outputFrameBuffers,
+                                         policy );
+        }
+    else {
+        frameCapture = new FrameCapture( screenWidth, screenHeight,
+                                         &screenShotConverter,
+                                         outputFrameThreads,
+                                         outputFrameBuffers,
+                                         policy );
+        }
+    }
+
+
+
+// reads the screen into a pooled frameCapture buffer and queues it
+// for encoding
+//
+// inFile destroyed by this call (NULL for y4m output)
+//
+// returns false if frame was skipped (by blending settings, or because
+// encoding is falling behind)
+static char captureOutputFrame( File *inFile ) {
+    unsigned char *rgbBytes = frameCapture->beginFrame();
+    
+    if( rgbBytes == NULL ) {
+        if( inFile != NULL ) {
+            delete inFile;
+            }
+        return false;
+        }
+
+    readScreenBytes( 0, 0, screenWidth, screenHeight, rgbBytes );
+
+    if( blendOutputFramePairs ) {
+        int numBytes = screenWidth * screenHeight * 3;
+
+        if( frameNumber % 2 == 0 ) {
+            // skip even frames, but save them for next blending
+            if( lastFrame_rgbaBytes == NULL ) {
+                lastFrame_rgbaBytes = new unsigned char[ numBytes ];
+                }
+            memcpy( lastFrame_rgbaBytes, rgbBytes, numBytes );
+            
+            frameCapture->cancelFrame();
+            
+            if( inFile != NULL ) {
+                delete inFile;
+                }
+            return false;
+            }
+        else if( lastFrame_rgbaBytes != NULL && 
+                 blendOutputFrameFraction > 0 ) {
+            
+            float blendA = 1 - blendOutputFrameFraction;
+            float blendB = blendOutputFrameFraction;
+            
+            for( int i=0; i<numBytes; i++ ) {
+                rgbBytes[i] = 
+                    (unsigned char)(
+                        blendA * rgbBytes[i] + 
+                        blendB * lastFrame_rgbaBytes[i] );
+                }
+            }
+        }
+    
+    frameCapture->endFrame( inFile );
+    
+    return true;
+    }
+
+
 void takeScreenShot() {
      
     
@@ -4695,6 +4913,33 @@ void takeScreenShot() {
     if( nextShotNumber < 1 ) {
         return;
         }
+
+    // all-frame output goes through worker threads
+    char asyncOutput = outputAllFrames && 
+        ! manualScreenShot && 
+        screenShotImageDest == NULL;
+    
+    if( asyncOutput && outputAllFramesY4M ) {
+        
+        if( frameCapture == NULL ) {
+            char *fileName = autoSprintf( "%s%05d.y4m", 
+                                          screenShotPrefix, nextShotNumber );
+            File *file = shotDir.getChildFile( fileName );
+            delete [] fileName;
+            
+            prepareFrameCapture( file );
+            delete file;
+            
+            nextShotNumber++;
+            }
+        
+        printf( "Output Frame %d (%.2f sec)\n", outputFrameCount, 
+                outputFrameCount / (double) targetFrameRate );
+        outputFrameCount ++;
+        
+        captureOutputFrame( NULL );
+        return;
+        }
     
     char *fileName = autoSprintf( "%s%05d.%s", 
                                   screenShotPrefix, nextShotNumber,
@@ -4713,6 +4958,15 @@ void takeScreenShot() {
         outputFrameCount ++;
         }
     
+    if( asyncOutput ) {
+        prepareFrameCapture( NULL );
+        
+        if( captureOutputFrame( file ) ) {
+            nextShotNumber++;
+            }
+        return;
+        }
+    
 
     Image *screenImage = 
         getScreenRegionInternal( 0, 0, screenWidth, screenHeight );
@@ -5049,6 +5303,12 @@ int openSocketConnection( const char *inNumericalAddress, int inPort ) {
     r.handle = nextSocketConnectionHandle;
     nextSocketConnectionHandle++;
 
+    r.engineID = -1;
+
+    // keep table index matching handle, even for failed or played-back
+    // handles
+    socketConnectionRecords.push_back( NULL );
+
 
     if( screen->isPlayingBack() ) {
         // stop here, don't actually open a real socket
@@ -5064,7 +5324,27 @@ int openSocketConnection( const char *inNumericalAddress, int inPort ) {
     r.sock = SocketClient::connectToServer( &address, 0, &timedOut );
     
     if( r.sock != NULL ) {
-        socketConnectionRecords.push_back( r );
+        // we only do non-blocking sends and receives, so stay in
+        // non-blocking mode instead of switching on every send
+        r.sock->setPersistentNonBlocking();
+        
+        if( socketIOEngine == NULL &&
+            SocketIOEngine::isSupported() &&
+            SettingsManager::getIntSetting( "socketIOThread", 0 ) == 1 ) {
+            
+            socketIOEngine = new SocketIOEngine(
+                SettingsManager::getIntSetting( "socketIOBufferSize",
+                                                65536 ) );
+            }
+        
+        if( socketIOEngine != NULL ) {
+            // engine owns socket now
+            r.engineID = socketIOEngine->addSocket( r.sock );
+            r.sock = NULL;
+            }
+        
+        *( socketConnectionRecords.getElement( r.handle ) ) =
+            new SocketConnectionRecord( r );
         
         return r.handle;
         }
@@ -5075,17 +5355,19 @@ int openSocketConnection( const char *inNumericalAddress, int inPort ) {
 
 
 
-static Socket *getSocketByHandle( int inHandle ) {
-    for( int i=0; i<socketConnectionRecords.size(); i++ ) {
-        SocketConnectionRecord *r = socketConnectionRecords.getElement( i );
+static SocketConnectionRecord *getSocketRecordByHandle( int inHandle ) {
+    if( inHandle >= 0 && inHandle < socketConnectionRecords.size() ) {
         
-        if( r->handle == inHandle ) {
-            return r->sock;
+        SocketConnectionRecord *r = 
+            socketConnectionRecords.getElementDirect( inHandle );
+        
+        if( r != NULL ) {
+            return r;
             }
         }
 
     // else not found?
-    AppLog::error( "gameSDL - getSocketByHandle:  "
+    AppLog::error( "gameSDL - getSocketRecordByHandle:  "
                    "Requested Socket handle not found\n" );
     return NULL;
     }
@@ -5122,16 +5404,20 @@ int sendToSocket( int inHandle, unsigned char *inData, int inDataLength ) {
         }
     
 
-    Socket *sock = getSocketByHandle( inHandle );
+    SocketConnectionRecord *r = getSocketRecordByHandle( inHandle );
     
-    if( sock != NULL ) {
+    if( r != NULL ) {
         
         int numSent = 0;
         
-
-        if( sock->isConnected() ) {
+        if( r->engineID != -1 ) {
+            // queued for I/O thread
+            numSent = socketIOEngine->send( r->engineID, 
+                                            inData, inDataLength );
+            }
+        else if( r->sock->isConnected() ) {
             
-            numSent = sock->send( inData, inDataLength, false, false );
+            numSent = r->sock->send( inData, inDataLength, false, false );
             
             if( numSent == -2 ) {
                 // would block
@@ -5198,15 +5484,20 @@ int readFromSocket( int inHandle,
         }
     
 
-    Socket *sock = getSocketByHandle( inHandle );
+    SocketConnectionRecord *r = getSocketRecordByHandle( inHandle );
     
-    if( sock != NULL ) {
+    if( r != NULL ) {
         
         int numRead = 0;
 
-        if( sock->isConnected() ) {
+        if( r->engineID != -1 ) {
+            // already received by I/O thread
+            numRead = socketIOEngine->receive( r->engineID, 
+                                               inDataBuffer, inBytesToRead );
+            }
+        else if( r->sock->isConnected() ) {
             
-            numRead = sock->receive( inDataBuffer, inBytesToRead, 0 );
+            numRead = r->sock->receive( inDataBuffer, inBytesToRead, 0 );
             
             if( numRead == -2 ) {
                 // would block
@@ -5241,22 +5532,19 @@ void closeSocket( int inHandle ) {
         return;
         }
     
-    for( int i=0; i<socketConnectionRecords.size(); i++ ) {
-        SocketConnectionRecord *r = socketConnectionRecords.getElement( i );
-        
-        if( r->handle == inHandle ) {
+    SocketConnectionRecord *r = getSocketRecordByHandle( inHandle );
+    
+    if( r != NULL ) {
+        if( r->engineID != -1 ) {
+            socketIOEngine->removeSocket( r->engineID );
+            }
+        else {
             delete r->sock;
-            
-            socketConnectionRecords.deleteElement( i );
-            
-            // found, done
-            return;
             }
+        
+        delete r;
+        *( socketConnectionRecords.getElement( inHandle ) ) = NULL;
         }
-
-    // else not found?
-    AppLog::error( "gameSDL - closeSocket:  "
-                   "Requested Socket handle not found\n" );
     }
 
 
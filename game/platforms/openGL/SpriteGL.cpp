@@ -3,8 +3,12 @@
 
 #include "minorGems/math/geometry/Angle3D.h"
 
+#include "minorGems/graphics/RGBAImage.h"
+
 #include "minorGems/util/log/AppLog.h"
 
+#include <string.h>
+
 
 
 char SpriteGL::sStateSet = false;
@@ -12,12 +16,292 @@ char SpriteGL::sStateSet = false;
 
 
 char SpriteGL::sGenerateMipMaps = false;
+char SpriteGL::sAtlasPacking = false;
+
+char SpriteGL::sBatching = false;
+double SpriteGL::sNumDrawCalls = 0;
+double SpriteGL::sNumBatches = 0;
 
 char SpriteGL::sCountingPixels = false;
 double SpriteGL::sPixelsDrawn = 0;
 
 
 
+// converts RGBA pixels to gray, keeping alpha
+// inWhiteThreshold of -1 means no threshold
+static void makeGrayscaleRGBA( unsigned char *inRGBA, 
+                               unsigned char *outRGBA,
+                               int inNumPixels, int inWhiteThreshold ) {
+
+    unsigned char threshold = 255;
+        
+    if( inWhiteThreshold != -1 ) {
+        threshold = (unsigned char) inWhiteThreshold;
+        }
+    
+    for( int i=0; i<inNumPixels; i++ ) {
+        int pixIndex = i * 4;
+        
+        unsigned char grayValue = 
+            inRGBA[pixIndex] * 0.299 +
+            inRGBA[ pixIndex + 1 ] * 0.587 +
+            inRGBA[ pixIndex + 2 ] * 0.114;
+        
+        if( grayValue > threshold ) {
+            grayValue = 255;
+            }
+        outRGBA[ pixIndex ] = grayValue;
+        outRGBA[ pixIndex + 1 ] = grayValue;
+        outRGBA[ pixIndex + 2 ] = grayValue;
+        // keep alpha
+        outRGBA[ pixIndex + 3 ] = inRGBA[ pixIndex + 3 ];
+        }
+    }
+
+
+
+#define ATLAS_PAGE_SIZE 1024
+
+
+int SpriteAtlasPageGL::sMaxImageSize = 256;
+
+SimpleVector<SpriteAtlasPageGL*> SpriteAtlasPageGL::sPages;
+
+
+
+// RGBA page texture with contents set directly, since the edge expansion
+// done when constructing a texture from bytes would bleed between images
+static SingleTextureGL *makePageTexture( unsigned char *inRGBA, 
+                                         int inSize ) {
+    int numBytes = inSize * inSize * 4;
+    
+    unsigned char *blankBytes = new unsigned char[ numBytes ];
+    memset( blankBytes, 0, numBytes );
+    
+    SingleTextureGL *texture = new SingleTextureGL( blankBytes, 
+                                                    inSize, inSize,
+                                                    // no wrap
+                                                    false,
+                                                    // no mip maps
+                                                    false );
+    delete [] blankBytes;
+    
+    if( inRGBA != NULL ) {
+        texture->replaceTextureSubData( inRGBA, 0, 0, inSize, inSize );
+        }
+    
+    return texture;
+    }
+
+
+
+SpriteAtlasPageGL::SpriteAtlasPageGL()
+        : mLastSetMinFilter( -1 ),
+          mLastSetMagFilter( -1 ),
+          mSize( ATLAS_PAGE_SIZE ),
+          mNumImages( 0 ) {
+
+    mTexture = makePageTexture( NULL, mSize );
+    
+    sPages.push_back( this );
+    }
+
+
+
+SpriteAtlasPageGL::~SpriteAtlasPageGL() {
+    sPages.deleteElementEqualTo( this );
+    
+    delete mTexture;
+    
+    for( int i=0; i<mGrayscaleTextures.size(); i++ ) {
+        delete mGrayscaleTextures.getElementDirect( i );
+        }
+    }
+
+
+
+char SpriteAtlasPageGL::findSpace( int inWidth, int inHeight, 
+                                   int *outX, int *outY ) {
+
+    // shortest shelf that fits
+    int bestShelf = -1;
+    
+    for( int i=0; i<mShelfY.size(); i++ ) {
+        int shelfHeight = mShelfHeight.getElementDirect( i );
+        
+        if( inHeight <= shelfHeight &&
+            mShelfNextX.getElementDirect( i ) + inWidth <= mSize ) {
+            
+            if( bestShelf == -1 ||
+                shelfHeight < mShelfHeight.getElementDirect( bestShelf ) ) {
+                bestShelf = i;
+                }
+            }
+        }
+    
+    if( bestShelf == -1 ) {
+        // start a new shelf
+        int nextShelfY = 0;
+        
+        int numShelves = mShelfY.size();
+        
+        if( numShelves > 0 ) {
+            nextShelfY = 
+                mShelfY.getElementDirect( numShelves - 1 ) +
+                mShelfHeight.getElementDirect( numShelves - 1 );
+            }
+        
+        if( nextShelfY + inHeight > mSize || inWidth > mSize ) {
+            return false;
+            }
+        
+        mShelfY.push_back( nextShelfY );
+        mShelfHeight.push_back( inHeight );
+        mShelfNextX.push_back( 0 );
+        
+        bestShelf = numShelves;
+        }
+    
+    int *nextX = mShelfNextX.getElement( bestShelf );
+    
+    *outX = *nextX;
+    *outY = mShelfY.getElementDirect( bestShelf );
+    
+    *nextX += inWidth;
+
+    return true;
+    }
+
+
+
+SpriteAtlasPageGL *SpriteAtlasPageGL::addImage( unsigned char *inRGBA,
+                                                int inWidth, int inHeight,
+                                                int *outX, int *outY ) {
+
+    if( inWidth > sMaxImageSize || inHeight > sMaxImageSize ) {
+        return NULL;
+        }
+    
+    // one pixel gutter on each side
+    int paddedW = inWidth + 2;
+    int paddedH = inHeight + 2;
+    
+    SpriteAtlasPageGL *page = NULL;
+    int x = 0;
+    int y = 0;
+    
+    for( int i=0; i<sPages.size(); i++ ) {
+        SpriteAtlasPageGL *p = sPages.getElementDirect( i );
+        
+        if( p->findSpace( paddedW, paddedH, &x, &y ) ) {
+            page = p;
+            break;
+            }
+        }
+    
+    if( page == NULL ) {
+        page = new SpriteAtlasPageGL();
+        
+        if( ! page->findSpace( paddedW, paddedH, &x, &y ) ) {
+            delete page;
+            return NULL;
+            }
+        }
+    
+
+    // gutter repeats edge pixels, like GL_CLAMP_TO_EDGE
+    unsigned char *paddedBytes = new unsigned char[ paddedW * paddedH * 4 ];
+    
+    for( int py=0; py<paddedH; py++ ) {
+        int sy = py - 1;
+        if( sy < 0 ) {
+            sy = 0;
+            }
+        else if( sy >= inHeight ) {
+            sy = inHeight - 1;
+            }
+        
+        unsigned char *sourceRow = &( inRGBA[ sy * inWidth * 4 ] );
+        unsigned char *destRow = &( paddedBytes[ py * paddedW * 4 ] );
+        
+        memcpy( &( destRow[4] ), sourceRow, inWidth * 4 );
+        
+        memcpy( destRow, sourceRow, 4 );
+        memcpy( &( destRow[ ( paddedW - 1 ) * 4 ] ),
+                &( sourceRow[ ( inWidth - 1 ) * 4 ] ), 4 );
+        }
+    
+    page->mTexture->replaceTextureSubData( paddedBytes, x, y, 
+                                           paddedW, paddedH );
+    
+    if( page->mGrayscaleTextures.size() > 0 ) {
+        unsigned char *grayBytes = 
+            new unsigned char[ paddedW * paddedH * 4 ];
+        
+        for( int i=0; i<page->mGrayscaleTextures.size(); i++ ) {
+            makeGrayscaleRGBA( paddedBytes, grayBytes, paddedW * paddedH,
+                               page->mGrayscaleThresholds.getElementDirect( 
+                                   i ) );
+            
+            page->mGrayscaleTextures.getElementDirect( i )->
+                replaceTextureSubData( grayBytes, x, y, paddedW, paddedH );
+            }
+        delete [] grayBytes;
+        }
+    
+    delete [] paddedBytes;
+
+    page->mNumImages++;
+    
+    *outX = x + 1;
+    *outY = y + 1;
+    
+    return page;
+    }
+
+
+
+void SpriteAtlasPageGL::removeImage() {
+    mNumImages--;
+    
+    if( mNumImages <= 0 ) {
+        delete this;
+        }
+    }
+
+
+
+SingleTextureGL *SpriteAtlasPageGL::getGrayscaleTexture( 
+    int inWhiteThreshold ) {
+    
+    for( int i=0; i<mGrayscaleThresholds.size(); i++ ) {
+        if( mGrayscaleThresholds.getElementDirect( i ) == inWhiteThreshold ) {
+            return mGrayscaleTextures.getElementDirect( i );
+            }
+        }
+    
+    unsigned char *backupBytes;
+    int w;
+    int h;
+    mTexture->getBackupBytes( &backupBytes, &w, &h );
+    
+    unsigned char *grayBytes = new unsigned char[ w * h * 4 ];
+    
+    makeGrayscaleRGBA( backupBytes, grayBytes, w * h, inWhiteThreshold );
+    
+    SingleTextureGL *grayTexture = makePageTexture( grayBytes, mSize );
+
+    delete [] grayBytes;
+    
+    mGrayscaleThresholds.push_back( inWhiteThreshold );
+    mGrayscaleTextures.push_back( grayTexture );
+    
+    return grayTexture;
+    }
+
+
+
+
 void SpriteGL::findColoredRadii( Image *inImage ) {
     
     if( inImage->getNumChannels() < 4 ) {
@@ -251,10 +535,26 @@ void SpriteGL::initTexture( Image *inImage,
         }
     
 
-    mTexture = new SingleTextureGL( spriteImage,
-                                    // no wrap
-                                    false,
-                                    sGenerateMipMaps );
+    mAtlasPage = NULL;
+    
+    if( sAtlasPacking && ! sGenerateMipMaps &&
+        spriteImage->getWidth() <= SpriteAtlasPageGL::sMaxImageSize &&
+        spriteImage->getHeight() <= SpriteAtlasPageGL::sMaxImageSize ) {
+        
+        unsigned char *rgbaBytes = RGBAImage::getRGBABytes( spriteImage );
+        
+        packIntoAtlas( rgbaBytes, 
+                       spriteImage->getWidth(), spriteImage->getHeight() );
+        
+        delete [] rgbaBytes;
+        }
+
+    if( mAtlasPage == NULL ) {
+        mTexture = new SingleTextureGL( spriteImage,
+                                        // no wrap
+                                        false,
+                                        sGenerateMipMaps );
+        }
     mAlphaOnly = false;
 
     mGrayscaleDrawingToggle = false;
@@ -301,10 +601,14 @@ SpriteGL::SpriteGL( unsigned char *inRGBA,
         findColoredRadii( inRGBA, inWidth, inHeight );
         }
     
-    mTexture = new SingleTextureGL( inRGBA, inWidth, inHeight,
-                                    // no wrap
-                                    false,
-                                    sGenerateMipMaps ); 
+    mAtlasPage = NULL;
+    
+    if( ! packIntoAtlas( inRGBA, inWidth, inHeight ) ) {
+        mTexture = new SingleTextureGL( inRGBA, inWidth, inHeight,
+                                        // no wrap
+                                        false,
+                                        sGenerateMipMaps ); 
+        }
     mAlphaOnly = false;
 
     mGrayscaleDrawingToggle = false;
@@ -353,6 +657,7 @@ SpriteGL::SpriteGL( char inAlphaOnly,
                                     // no wrap
                                     false,
                                     sGenerateMipMaps );
+    mAtlasPage = NULL;
     mAlphaOnly = true;
 
     mGrayscaleDrawingToggle = false;
@@ -376,7 +681,15 @@ SpriteGL::SpriteGL( char inAlphaOnly,
 
 
 SpriteGL::~SpriteGL() {
-    delete mTexture;
+    // queued sprites might be using our texture
+    flushBatch();
+    
+    if( mAtlasPage != NULL ) {
+        mAtlasPage->removeImage();
+        }
+    else {
+        delete mTexture;
+        }
     
     if( mGrayscaleTexture != NULL ) {
         delete mGrayscaleTexture;
@@ -385,6 +698,44 @@ SpriteGL::~SpriteGL() {
 
 
 
+char SpriteGL::packIntoAtlas( unsigned char *inRGBA, 
+                              unsigned int inWidth, unsigned int inHeight ) {
+    
+    #ifdef GLES
+        return false;
+    #endif
+
+    if( ! sAtlasPacking || sGenerateMipMaps ) {
+        return false;
+        }
+    
+    // same expansion that a stand-alone texture would get
+    SingleTextureGL::expandEdges( inRGBA, inWidth, inHeight );
+
+    int x, y;
+    
+    mAtlasPage = SpriteAtlasPageGL::addImage( inRGBA, inWidth, inHeight,
+                                              &x, &y );
+    
+    if( mAtlasPage == NULL ) {
+        return false;
+        }
+    
+    mTexture = mAtlasPage->getTexture();
+    
+    double pageSize = mAtlasPage->getSize();
+    
+    mAtlasOffsetX = x / pageSize;
+    mAtlasOffsetY = y / pageSize;
+    
+    mAtlasScaleX = inWidth / pageSize;
+    mAtlasScaleY = inHeight / pageSize;
+    
+    return true;
+    }
+
+
+
 void SpriteGL::toggleGrayscaleDrawing( char inGrayscale,
                                      int inGrayTextureWhiteThreshold ) {
     mGrayscaleDrawingToggle = inGrayscale;
@@ -393,14 +744,21 @@ void SpriteGL::toggleGrayscaleDrawing( char inGrayscale,
 
 
 
-void SpriteGL::enableGrayscaleTexture() {
-    if( mGrayscaleTexture != NULL ) {
-        mGrayscaleTexture->enable();
+SingleTextureGL *SpriteGL::getDrawTexture() {
+    if( ! mGrayscaleDrawingToggle ) {
+        // full color texture
+        return mTexture;
+        }
+    else if( mGrayscaleTexture != NULL ) {
+        return mGrayscaleTexture;
         }
     else if( mAlphaOnly ) {
         // no grayscale texture for alpha-only sprites
-        // enable regular texture
-        mTexture->enable();
+        // use regular texture
+        return mTexture;
+        }
+    else if( mAtlasPage != NULL ) {
+        return mAtlasPage->getGrayscaleTexture( mGrayTextureWhiteThreshold );
         }
     else {
         // duplicate texture to make grayscale version
@@ -413,36 +771,14 @@ void SpriteGL::enableGrayscaleTexture() {
         if( alphaOnly ) {
             // case that should never happen
             // we think we're RGBA, but mTexture is alpha only
-            mTexture->enable();
-            return;
+            return mTexture;
             }
         
         int numPixels = w * h;
         unsigned char *grayBytes = new unsigned char[ numPixels * 4 ];
         
-        unsigned char threshold = 255;
-        
-        if( mGrayTextureWhiteThreshold != -1 ) {
-            threshold = (unsigned char) mGrayTextureWhiteThreshold;
-            }
-        
-        for( int i=0; i<numPixels; i++ ) {
-            int pixIndex = i * 4;
-            
-            unsigned char grayValue = 
-                backupBytes[pixIndex] * 0.299 +
-                backupBytes[ pixIndex + 1 ] * 0.587 +
-                backupBytes[ pixIndex + 2 ] * 0.114;
-
-            if( grayValue > threshold ) {
-                grayValue = 255;
-                }
-            grayBytes[ pixIndex ] = grayValue;
-            grayBytes[ pixIndex + 1 ] = grayValue;
-            grayBytes[ pixIndex + 2 ] = grayValue;
-            // keep alpha
-            grayBytes[ pixIndex + 3 ] = backupBytes[ pixIndex + 3 ];
-            }
+        makeGrayscaleRGBA( backupBytes, grayBytes, numPixels,
+                           mGrayTextureWhiteThreshold );
         
         mGrayscaleTexture = new SingleTextureGL( grayBytes, w, h,
                                                  // no wrap
@@ -450,7 +786,7 @@ void SpriteGL::enableGrayscaleTexture() {
                                                  sGenerateMipMaps );
         delete [] grayBytes;
         
-        mGrayscaleTexture->enable();
+        return mGrayscaleTexture;
         }
     }
 
@@ -568,13 +904,7 @@ void SpriteGL::prepareDraw( int inFrame,
             }
         }
 
-    if( mGrayscaleDrawingToggle ) {
-        enableGrayscaleTexture();
-        }
-    else {
-        // full color texture
-        mTexture->enable();
-        }
+    getDrawTexture()->enable();
 
     
     if( inMipMapFilter ) {
@@ -673,6 +1003,7 @@ void SpriteGL::draw( int inFrame,
     glEnableClientState( GL_TEXTURE_COORD_ARRAY );
     
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    sNumDrawCalls++;
 
     glDisableClientState( GL_VERTEX_ARRAY );
     glDisableClientState( GL_TEXTURE_COORD_ARRAY );
@@ -727,6 +1058,7 @@ void SpriteGL::draw( int inFrame,
     glEnableClientState( GL_TEXTURE_COORD_ARRAY );
     
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    sNumDrawCalls++;
 
     glDisableClientState( GL_VERTEX_ARRAY );
     glDisableClientState( GL_COLOR_ARRAY );
@@ -735,6 +1067,16 @@ void SpriteGL::draw( int inFrame,
 
 
 
+// no batching on GLES
+void SpriteGL::flushBatch() {
+    }
+
+
+void SpriteGL::setBatchColor( float inR, float inG, float inB, float inA ) {
+    }
+
+
+
 
 
 
@@ -756,6 +1098,102 @@ GLfloat squareTextureCoords[4*2];
 
 
 
+// queued sprites, as two triangles each
+#define BATCH_MAX_SPRITES 1024
+
+static GLfloat batchVertices[ BATCH_MAX_SPRITES * 6 * 2 ];
+static GLfloat batchTextureCoords[ BATCH_MAX_SPRITES * 6 * 2 ];
+static GLfloat batchColors[ BATCH_MAX_SPRITES * 6 * 4 ];
+
+static int batchCount = 0;
+
+// texture used by queued sprites
+static SingleTextureGL *batchTexture = NULL;
+
+static GLfloat batchColor[4] = { 1, 1, 1, 1 };
+
+
+
+void SpriteGL::setBatchColor( float inR, float inG, float inB, float inA ) {
+    batchColor[0] = inR;
+    batchColor[1] = inG;
+    batchColor[2] = inB;
+    batchColor[3] = inA;
+    }
+
+
+
+void SpriteGL::flushBatch() {
+    if( batchCount == 0 ) {
+        return;
+        }
+
+    // other textures may have been bound since sprites were queued
+    batchTexture->enable();
+    
+    glVertexPointer( 2, GL_FLOAT, 0, batchVertices );
+    glTexCoordPointer( 2, GL_FLOAT, 0, batchTextureCoords );
+    
+    if( !sStateSet ) {    
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+        sStateSet = true;
+        }
+
+    glColorPointer( 4, GL_FLOAT, 0, batchColors );
+    glEnableClientState( GL_COLOR_ARRAY );
+    
+    glDrawArrays( GL_TRIANGLES, 0, batchCount * 6 );
+    
+    glDisableClientState( GL_COLOR_ARRAY );
+    
+    // current color is undefined after drawing with a color array
+    glColor4fv( batchColor );
+
+    sNumDrawCalls++;
+    sNumBatches++;
+    
+    batchCount = 0;
+    }
+
+
+
+void SpriteGL::addToBatch( GLfloat *inCornerColors ) {
+    if( batchCount == BATCH_MAX_SPRITES ) {
+        flushBatch();
+        }
+    
+    // same two triangles that the strip would produce
+    static const int stripIndices[6] = { 0, 1, 2, 1, 2, 3 };
+
+    GLfloat *vertices = &( batchVertices[ batchCount * 6 * 2 ] );
+    GLfloat *textureCoords = &( batchTextureCoords[ batchCount * 6 * 2 ] );
+    GLfloat *colors = &( batchColors[ batchCount * 6 * 4 ] );
+    
+    for( int i=0; i<6; i++ ) {
+        int s = stripIndices[i];
+        
+        vertices[ i * 2 ] = squareVertices[ s * 2 ];
+        vertices[ i * 2 + 1 ] = squareVertices[ s * 2 + 1 ];
+
+        textureCoords[ i * 2 ] = squareTextureCoords[ s * 2 ];
+        textureCoords[ i * 2 + 1 ] = squareTextureCoords[ s * 2 + 1 ];
+        
+        if( inCornerColors != NULL ) {
+            memcpy( &( colors[ i * 4 ] ), &( inCornerColors[ s * 4 ] ),
+                    4 * sizeof( GLfloat ) );
+            }
+        else {
+            memcpy( &( colors[ i * 4 ] ), batchColor, 
+                    4 * sizeof( GLfloat ) );
+            }
+        }
+    
+    batchCount++;
+    }
+
+
+
 
 void SpriteGL::prepareDraw( int inFrame, 
                             Vector3D *inPosition, 
@@ -890,51 +1328,69 @@ void SpriteGL::prepareDraw( int inFrame,
         }
     */  
 
-    if( mGrayscaleDrawingToggle ) {
-        enableGrayscaleTexture();
+    SingleTextureGL *texture = getDrawTexture();
+    
+    // atlas sprites share filter state through their page
+    int *lastSetMinFilter = &mLastSetMinFilter;
+    int *lastSetMagFilter = &mLastSetMagFilter;
+    
+    if( mAtlasPage != NULL ) {
+        lastSetMinFilter = &( mAtlasPage->mLastSetMinFilter );
+        lastSetMagFilter = &( mAtlasPage->mLastSetMagFilter );
         }
-    else {
-        // full color texture
-        mTexture->enable();
+
+    int minFilter = 0;
+    
+    if( inMipMapFilter ) {
+        minFilter = 2;
+        }
+    else if( inLinearMagFilter ) {
+        minFilter = 1;
+        }
+    
+    int magFilter = 0;
+    
+    if( inLinearMagFilter ) {
+        magFilter = 1;
+        }
+
+    
+    if( batchCount > 0 &&
+        ( texture != batchTexture ||
+          minFilter != *lastSetMinFilter ||
+          magFilter != *lastSetMagFilter ) ) {
+        // queued sprites must be drawn before texture state changes
+        flushBatch();
         }
+    batchTexture = texture;
+    
+    texture->enable();
     
 
-    if( inMipMapFilter ) {
-        if( mLastSetMinFilter != 2 ) {
+    if( minFilter != *lastSetMinFilter ) {
+        if( minFilter == 2 ) {
             glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
                              GL_LINEAR_MIPMAP_LINEAR );
-            mLastSetMinFilter = 2;
             }
-        }
-    else {
-        
-        if( inLinearMagFilter ) {
-            if( mLastSetMinFilter != 1 ) {
-                glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
-                                 GL_LINEAR );
-                mLastSetMinFilter = 1;
-                }
+        else if( minFilter == 1 ) {
+            glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
+                             GL_LINEAR );
             }
         else {
-            if( mLastSetMinFilter != 0 ) {
-                glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
-                                 GL_NEAREST );
-                mLastSetMinFilter = 0;
-                }
+            glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
+                             GL_NEAREST );
             }
+        *lastSetMinFilter = minFilter;
         }
     
-    if( inLinearMagFilter ) {
-        if( mLastSetMagFilter != 1 ) {
+    if( magFilter != *lastSetMagFilter ) {
+        if( magFilter == 1 ) {
             glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-            mLastSetMagFilter = 1;
             }
-        }
-    else {
-        if( mLastSetMagFilter != 0 ) {
+        else {
             glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-            mLastSetMagFilter = 0;
             }
+        *lastSetMagFilter = magFilter;
         }
 
     
@@ -953,6 +1409,14 @@ void SpriteGL::prepareDraw( int inFrame,
     textYB += 0.5 - mColoredRadiusTopY;
     textYA -= 0.5 - mColoredRadiusBottomY;
 
+    if( mAtlasPage != NULL ) {
+        textXA = mAtlasOffsetX + textXA * mAtlasScaleX;
+        textXB = mAtlasOffsetX + textXB * mAtlasScaleX;
+        
+        textYA = mAtlasOffsetY + textYA * mAtlasScaleY;
+        textYB = mAtlasOffsetY + textYB * mAtlasScaleY;
+        }
+
     squareTextureCoords[0] = textXA;
     squareTextureCoords[1] = textYA;
 
@@ -987,6 +1451,10 @@ void SpriteGL::draw( int inFrame,
                  inMipMapFilter,
                  inRotation, inFlipH );
 
+    if( sBatching ) {
+        addToBatch( NULL );
+        return;
+        }
 
     glVertexPointer( 2, GL_FLOAT, 0, squareVertices );
     
@@ -1000,6 +1468,7 @@ void SpriteGL::draw( int inFrame,
         }
     
     glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+    sNumDrawCalls++;
 
 
     /*
@@ -1042,15 +1511,6 @@ void SpriteGL::draw( int inFrame,
                  inRotation, inFlipH );
 
 
-    glVertexPointer( 2, GL_FLOAT, 0, squareVertices );
-    glTexCoordPointer( 2, GL_FLOAT, 0, squareTextureCoords );
-    
-    if( !sStateSet ) {    
-        glEnableClientState( GL_VERTEX_ARRAY );
-        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-        sStateSet = true;
-        }
-
     for( int c=0; c<4; c++ ) {
         
         int cDest = c;
@@ -1072,11 +1532,26 @@ void SpriteGL::draw( int inFrame,
         makeCornerColorsGray( squareColors );
         }
 
+    if( sBatching ) {
+        addToBatch( squareColors );
+        return;
+        }
+
+    glVertexPointer( 2, GL_FLOAT, 0, squareVertices );
+    glTexCoordPointer( 2, GL_FLOAT, 0, squareTextureCoords );
+    
+    if( !sStateSet ) {    
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+        sStateSet = true;
+        }
+
     glColorPointer( 4, GL_FLOAT, 0, squareColors );
     glEnableClientState( GL_COLOR_ARRAY );
 
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    sNumDrawCalls++;
 
     
     glDisableClientState( GL_COLOR_ARRAY );
@@ -1114,15 +1589,6 @@ void SpriteGL::draw( int inFrame,
     squareVertices[7] = inCornerPos[2].y;
     
     
-    glVertexPointer( 2, GL_FLOAT, 0, squareVertices );
-    glTexCoordPointer( 2, GL_FLOAT, 0, squareTextureCoords );
-    
-    if( !sStateSet ) {    
-        glEnableClientState( GL_VERTEX_ARRAY );
-        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-        sStateSet = true;
-        }
-
     for( int c=0; c<4; c++ ) {
         
         int cDest = c;
@@ -1144,11 +1610,26 @@ void SpriteGL::draw( int inFrame,
         makeCornerColorsGray( squareColors );
         }
 
+    if( sBatching ) {
+        addToBatch( squareColors );
+        return;
+        }
+
+    glVertexPointer( 2, GL_FLOAT, 0, squareVertices );
+    glTexCoordPointer( 2, GL_FLOAT, 0, squareTextureCoords );
+    
+    if( !sStateSet ) {    
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+        sStateSet = true;
+        }
+
     glColorPointer( 4, GL_FLOAT, 0, squareColors );
     glEnableClientState( GL_COLOR_ARRAY );
 
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    sNumDrawCalls++;
 
     
     glDisableClientState( GL_COLOR_ARRAY );
@@ -9,10 +9,94 @@
 
 #include "minorGems/math/geometry/Vector3D.h"
 
+#include "minorGems/util/SimpleVector.h"
+
 #include <stdlib.h>
 
 
 
+// A large shared texture that small sprites are packed into when they are
+// loaded, so that runs of sprites from the same page can be drawn with
+// one draw call.
+//
+// Images are placed on horizontal shelves, each surrounded by a one-pixel
+// gutter copied from its edge pixels, so that linear filtering matches
+// the edge clamping of a stand-alone texture.
+// Space is not reused when sprites are freed, but a page is destroyed
+// once all sprites on it have been freed.
+class SpriteAtlasPageGL {
+    public:
+        
+        // copies an RGBA image into a page with room for it, creating
+        // a new page if needed
+        //
+        // returns the page, or NULL if image is too big to be packed
+        // outX and outY are set to image's position in the page, in pixels
+        static SpriteAtlasPageGL *addImage( unsigned char *inRGBA,
+                                            int inWidth, int inHeight,
+                                            int *outX, int *outY );
+        
+
+        // called when a sprite on this page is freed
+        // page destroys itself when no sprites are left on it
+        void removeImage();
+        
+
+        int getSize() {
+            return mSize;
+            }
+        
+
+        SingleTextureGL *getTexture() {
+            return mTexture;
+            }
+        
+
+        // gets grayscale version of page for a given white threshold
+        // (-1 for no threshold), creating it if needed
+        SingleTextureGL *getGrayscaleTexture( int inWhiteThreshold );
+        
+
+        // filter state of page textures, shared by all sprites on page
+        // see SpriteGL for meaning of values
+        int mLastSetMinFilter;
+        int mLastSetMagFilter;
+
+
+        // largest width or height that will be packed
+        static int sMaxImageSize;
+        
+        
+    protected:
+        
+        SpriteAtlasPageGL();
+        ~SpriteAtlasPageGL();
+        
+        // finds space for an image (including gutter) 
+        // returns false if none left
+        char findSpace( int inWidth, int inHeight, int *outX, int *outY );
+        
+
+        int mSize;
+        
+        SingleTextureGL *mTexture;
+
+        SimpleVector<int> mGrayscaleThresholds;
+        SimpleVector<SingleTextureGL*> mGrayscaleTextures;
+        
+
+        // shelves, from bottom to top of page
+        SimpleVector<int> mShelfY;
+        SimpleVector<int> mShelfHeight;
+        SimpleVector<int> mShelfNextX;
+        
+        int mNumImages;
+        
+        static SimpleVector<SpriteAtlasPageGL*> sPages;
+    };
+
+
+
 class SpriteGL{
     public:
         
@@ -21,6 +105,20 @@ class SpriteGL{
             sGenerateMipMaps = inGenerateMipMaps;
             }
             
+
+        // small RGBA sprites are packed into shared SpriteAtlasPageGL
+        // textures when this is on
+        // Ignored for sprites that are generated with mip maps, and for
+        // alpha-only sprites.
+        // Defaults to off.
+        static void toggleAtlasPacking( char inPack ) {
+            sAtlasPacking = inPack;
+            }
+        
+        static char getAtlasPacking() {
+            return sAtlasPacking;
+            }
+        
         
 
         // transparent color for RGB images can be taken from lower-left
@@ -167,17 +265,71 @@ class SpriteGL{
         
         
         static void setTexturingDisabled() {
+            flushBatch();
+            
             // need to renable client states later
             sStateSet = false;
             SingleTextureGL::disableTexturing();
             }
 
+
+
+        // When batching is on, drawn sprites are queued, and runs of
+        // sprites that share a texture and filter settings are sent
+        // to GL with one draw call.
+        //
+        // Queued sprites are drawn by flushBatch, which must be called 
+        // before any GL state that affects sprite drawing is changed 
+        // (blend mode, stencil, scissor, texture environment, transforms), 
+        // and before the frame ends.
+        //
+        // Defaults to off.  Ignored on GLES.
+        static void toggleBatching( char inBatch ) {
+            flushBatch();
+            sBatching = inBatch;
+            }
+        
+        static char getBatching() {
+            return sBatching;
+            }
+        
+        static void flushBatch();
+        
+
+        // sprites drawn without corner colors are drawn with the current
+        // GL color, which is not part of the GL state seen by queued 
+        // sprites
+        // Thus, the color set with glColor must also be passed in here.
+        static void setBatchColor( float inR, float inG, float inB, 
+                                   float inA );
+
+
+        // counts of glDrawArrays calls for sprites, and how many of those
+        // were flushed batches, since last reset
+        static void resetDrawCallCounts() {
+            sNumDrawCalls = 0;
+            sNumBatches = 0;
+            }
+        
+        static double getNumDrawCalls() {
+            return sNumDrawCalls;
+            }
+
+        static double getNumBatches() {
+            return sNumBatches;
+            }
+
         
         int mWidth, mHeight;
 
     protected:
 
         static char sGenerateMipMaps;
+        static char sAtlasPacking;
+        
+        static char sBatching;
+        static double sNumDrawCalls;
+        static double sNumBatches;
         
         static char sCountingPixels;
         static double sPixelsDrawn;
@@ -201,6 +353,14 @@ class SpriteGL{
 
         // NULL if never drawn in grayscale
         SingleTextureGL *mGrayscaleTexture;
+
+        // NULL if sprite has its own texture
+        // if set, mTexture is the page's texture, owned by page
+        SpriteAtlasPageGL *mAtlasPage;
+        
+        // maps sprite texture coordinates into atlas page
+        double mAtlasOffsetX, mAtlasOffsetY;
+        double mAtlasScaleX, mAtlasScaleY;
         
         int mNumFrames;
         int mNumPages;
@@ -247,7 +407,19 @@ class SpriteGL{
                           char inComputeCornerPos = true );
         
 
-        void enableGrayscaleTexture();
+        // gets texture to use for next draw, without enabling it
+        SingleTextureGL *getDrawTexture();
+        
+
+        // tries to place RGBA image in an atlas page
+        // sets mTexture and returns true on success
+        char packIntoAtlas( unsigned char *inRGBA, 
+                            unsigned int inWidth, unsigned int inHeight );
+        
+
+        // queues the current corner positions and texture coordinates
+        // inCornerColors in triangle strip order, or NULL to use batch color
+        static void addToBatch( GLfloat *inCornerColors );
         
 
 
@@ -0,0 +1,293 @@
+// Measures Font::drawString speed for a UI-like screen of 5000 short labels
+// per frame, rendering offscreen with Mesa's software rasterizer (OSMesa).
+//
+// Compares against the previous drawString, which laid out every string
+// on every call and drew each glyph with its own drawSprite call (done
+// here through getCharPos and drawCharacterSprite).  The glyphs are in
+// the font's atlas in both cases, so the old path is measured without the
+// texture switches it used to have between glyphs.
+//
+// Also checks that all modes produce the same pixels.
+//
+// The font sheet is generated here, in place of reading a TGA file.
+//
+// Usage:  fontBenchmark [numLabelsPerFrame numFrames]
+
+
+#include "minorGems/game/gameGraphics.h"
+#include "minorGems/game/Font.h"
+
+#include "minorGems/graphics/openGL/glInclude.h"
+
+#include "minorGems/system/Time.h"
+
+#include "minorGems/util/random/CustomRandomSource.h"
+#include "minorGems/util/stringUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#include "minorGems/graphics/openGL/OSMesaGLSurface.cpp"
+
+
+
+static int screenW = 1024;
+static int screenH = 768;
+
+static int numLabelsPerFrame = 5000;
+static int numFrames = 20;
+
+// different label strings, few enough to stay in the run cache
+#define NUM_STRINGS 500
+
+#define GLYPH_SIZE 16
+
+#define MAX_ALLOWED_PIXEL_DIFF 2
+
+
+static char *labelStrings[ NUM_STRINGS ];
+
+static char mismatchFound = false;
+
+
+
+// Font reads its glyph sheet through this
+// Makes a 16x16 grid of glyphs, with ink in red channel.
+Image *readTGAFile( const char *inTGAFileName ) {
+    int size = GLYPH_SIZE * 16;
+    
+    Image *image = new Image( size, size, 4, true );
+    
+    double *red = image->getChannel( 0 );
+    
+    for( int c=33; c<127; c++ ) {
+        int cellX = ( c % 16 ) * GLYPH_SIZE;
+        int cellY = ( c / 16 ) * GLYPH_SIZE;
+        
+        // glyphs of varying width, with a pattern that depends on the
+        // character
+        int width = 4 + c % 9;
+        
+        for( int y=3; y<GLYPH_SIZE - 3; y++ ) {
+            for( int x=2; x<2 + width; x++ ) {
+                if( ( ( x * 7 + y * c ) % 5 ) != 0 ) {
+                    red[ ( cellY + y ) * size + cellX + x ] = 1.0;
+                    }
+                }
+            }
+        }
+    
+    return image;
+    }
+
+
+
+static void makeLabelStrings() {
+    const char *words[8] = { "Score", "Health", "Wood", "Stone", 
+                             "Iron Ore", "Berries", "Rope", "Water" };
+    
+    for( int i=0; i<NUM_STRINGS; i++ ) {
+        labelStrings[i] = autoSprintf( "%s: %d", words[ i % 8 ], i * 37 );
+        }
+    }
+
+
+
+// previous drawString implementation
+static void drawStringOld( Font *inFont, const char *inString, 
+                           doublePair inPosition, TextAlignment inAlign ) {
+    SimpleVector<doublePair> pos( strlen( inString ) );
+
+    inFont->getCharPos( &pos, inString, inPosition, inAlign );
+
+    for( int i=0; i<pos.size(); i++ ) {
+        inFont->drawCharacterSprite( (unsigned char)( inString[i] ),
+                                     pos.getElementDirect( i ) );
+        }
+    }
+
+
+
+// same labels, positions, and alignments every frame
+static void drawTestFrame( Font *inFont, char inOld ) {
+    glClear( GL_COLOR_BUFFER_BIT );
+
+    CustomRandomSource randSource( 17 );
+
+    for( int i=0; i<numLabelsPerFrame; i++ ) {
+        int s = randSource.getRandomBoundedInt( 0, NUM_STRINGS - 1 );
+
+        doublePair pos =
+            { (double)randSource.getRandomBoundedInt( 0, screenW ),
+              (double)randSource.getRandomBoundedInt( 0, screenH ) };
+        
+        TextAlignment align = 
+            (TextAlignment)randSource.getRandomBoundedInt( 0, 2 );
+
+        setDrawColor( 1, 1, 1,
+                      randSource.getRandomBoundedInt( 128, 255 ) / 255.0 );
+
+        if( inOld ) {
+            drawStringOld( inFont, labelStrings[s], pos, align );
+            }
+        else {
+            inFont->drawString( labelStrings[s], pos, align );
+            }
+        }
+
+    flushSpriteBatch();
+    }
+
+
+
+static unsigned char *readFrame() {
+    unsigned char *pixels = new unsigned char[ screenW * screenH * 4 ];
+
+    glReadPixels( 0, 0, screenW, screenH, GL_RGBA, GL_UNSIGNED_BYTE,
+                  pixels );
+    return pixels;
+    }
+
+
+
+// returns frames per second
+static double runMode( const char *inName, Font *inFont, 
+                       char inOld, char inBatch,
+                       unsigned char *inReferenceFrame,
+                       unsigned char **outFrame ) {
+
+    toggleSpriteBatching( inBatch );
+
+    // warm up, and one frame to check against reference
+    drawTestFrame( inFont, inOld );
+    glFinish();
+
+    unsigned char *frame = readFrame();
+
+    int maxDiff = 0;
+    if( inReferenceFrame != NULL ) {
+        for( int i=0; i<screenW * screenH * 4; i++ ) {
+            int d = abs( frame[i] - inReferenceFrame[i] );
+            if( d > maxDiff ) {
+                maxDiff = d;
+                }
+            }
+        }
+
+    if( maxDiff > MAX_ALLOWED_PIXEL_DIFF ) {
+        mismatchFound = true;
+        }
+
+    startCountingSpriteDrawCalls();
+
+    double startTime = Time::getCurrentTime();
+    
+    // time spent before glFinish, mostly layout and draw call submission
+    // rather than rasterization
+    double submitTime = 0;
+
+    for( int f=0; f<numFrames; f++ ) {
+        double frameStart = Time::getCurrentTime();
+        
+        drawTestFrame( inFont, inOld );
+        
+        submitTime += Time::getCurrentTime() - frameStart;
+        
+        glFinish();
+        }
+
+    double time = Time::getCurrentTime() - startTime;
+
+    double numBatches;
+    double numDrawCalls = endCountingSpriteDrawCalls( &numBatches );
+
+    toggleSpriteBatching( false );
+
+    double fps = numFrames / time;
+
+    printf( "%-28s %6.2f fps   %7.1f ms/frame submitting   "
+            "%8.1f draw calls/frame   max pixel diff %d\n",
+            inName, fps, 1000 * submitTime / numFrames, 
+            numDrawCalls / numFrames, maxDiff );
+
+    *outFrame = frame;
+    return fps;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    if( inNumArgs == 3 ) {
+        numLabelsPerFrame = atoi( inArgs[1] );
+        numFrames = atoi( inArgs[2] );
+        }
+
+    if( ! osMesaCreateSurface( screenW, screenH ) ) {
+        printf( "Failed to create OSMesa surface\n" );
+        return 1;
+        }
+
+    printf( "GL renderer:  %s\n", glGetString( GL_RENDERER ) );
+    printf( "%d labels per frame, %d frames\n\n",
+            numLabelsPerFrame, numFrames );
+
+    glViewport( 0, 0, screenW, screenH );
+
+    glMatrixMode( GL_PROJECTION );
+    glLoadIdentity();
+    glOrtho( 0, screenW, 0, screenH, -1, 1 );
+
+    glMatrixMode( GL_MODELVIEW );
+    glLoadIdentity();
+
+    glDisable( GL_CULL_FACE );
+    glDisable( GL_DEPTH_TEST );
+    glEnable( GL_BLEND );
+    toggleAdditiveBlend( false );
+
+    makeLabelStrings();
+
+    // scale so that one glyph pixel is one screen pixel
+    Font *font = new Font( "font.tga", 1, 6, false, 16 );
+    
+    // whole-pixel string positions
+    font->setMinimumPositionPrecision( 1 );
+    
+
+    unsigned char *reference;
+    unsigned char *frame;
+
+    double oldFPS = runMode( "per-glyph drawSprite (old)", font, true, false,
+                             NULL, &reference );
+
+    double newFPS = runMode( "drawString", font, false, false,
+                             reference, &frame );
+    delete [] frame;
+
+    double batchFPS = runMode( "drawString, sprite batching", font, 
+                               false, true, reference, &frame );
+    delete [] frame;
+
+    delete [] reference;
+
+    printf( "\nspeedup:  drawString %.2fx, with sprite batching %.2fx\n",
+            newFPS / oldFPS, batchFPS / oldFPS );
+
+    delete font;
+    
+    for( int i=0; i<NUM_STRINGS; i++ ) {
+        delete [] labelStrings[i];
+        }
+
+    osMesaReleaseSurface();
+
+    if( mismatchFound ) {
+        printf( "\nMISMATCH:  drawing differs from old drawString\n" );
+        return 1;
+        }
+
+    return 0;
+    }
@@ -117,6 +117,7 @@ void setDrawColor( float inR, float inG, float inB, float inA ) {
         }
         
     glColor4f( inR, inG, inB, inA );
+    SpriteGL::setBatchColor( inR, inG, inB, inA );
     }
 
 
@@ -142,6 +143,7 @@ void setDrawFade( float inA ) {
     lastA = inA;
     
     glColor4f( lastR, lastG, lastB, inA * globalFadeTotal );
+    SpriteGL::setBatchColor( lastR, lastG, lastB, inA * globalFadeTotal );
     }
 
 
@@ -184,6 +186,8 @@ static void setNormalBlend() {
 
 
 void toggleAdditiveBlend( char inAdditive ) {
+    SpriteGL::flushBatch();
+    
     if( inAdditive ) {
         glBlendFunc( GL_SRC_ALPHA, GL_ONE );
         additiveBlend = true;
@@ -198,6 +202,8 @@ void toggleAdditiveBlend( char inAdditive ) {
 
 
 void toggleMultiplicativeBlend( char inMultiplicative ) {
+    SpriteGL::flushBatch();
+    
     if( inMultiplicative ) {
         glBlendFunc( GL_DST_COLOR, GL_ZERO );
         additiveBlend = false;
@@ -211,6 +217,8 @@ void toggleMultiplicativeBlend( char inMultiplicative ) {
 
 
 void toggleInvertedBlend( char inInverted ) {
+    SpriteGL::flushBatch();
+    
     if( inInverted ) {
         glBlendFunc( GL_ONE_MINUS_DST_COLOR, GL_ZERO );
         additiveBlend = false;
@@ -238,6 +246,8 @@ void toggleGrayscaleDrawing( char inGrayscale, float inForceGrayColorValue,
 
 
 void toggleAdditiveTextureColoring( char inAdditive ) {
+    SpriteGL::flushBatch();
+    
     if( inAdditive ) {
         glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_ADD );
         }
@@ -285,6 +295,30 @@ void toggleTransparentCropping( char inCrop ) {
     }
 
 
+
+void toggleSpriteAtlasPacking( char inPack ) {
+    SpriteGL::toggleAtlasPacking( inPack );
+    }
+
+
+
+char getSpriteAtlasPacking() {
+    return SpriteGL::getAtlasPacking();
+    }
+
+
+
+void toggleSpriteBatching( char inBatch ) {
+    SpriteGL::toggleBatching( inBatch );
+    }
+
+
+
+void flushSpriteBatch() {
+    SpriteGL::flushBatch();
+    }
+
+
 #ifdef GLES
 // GL ES versions of these functions
 
@@ -572,6 +606,7 @@ void drawTrianglesColor( int inNumTriangles, double inVertices[],
 
 
 void enableScissor( double inX, double inY, double inWidth, double inHeight ) {
+    SpriteGL::flushBatch();
     
     double endX = inX + inWidth;
     double endY = inY + inHeight;
@@ -606,6 +641,7 @@ void enableScissor( double inX, double inY, double inWidth, double inHeight ) {
 
 
 void disableScissor() {
+    SpriteGL::flushBatch();
     glDisable( GL_SCISSOR_TEST );
     }
 
@@ -613,6 +649,8 @@ void disableScissor() {
 
 void startAddingToStencil( char inDrawColorToo, char inAdd,
                            float inMinAlpha ) {
+    SpriteGL::flushBatch();
+    
     if( !inDrawColorToo ) {
         
         // stop updating color
@@ -645,6 +683,8 @@ void startAddingToStencil( char inDrawColorToo, char inAdd,
 
 
 void startDrawingThroughStencil( char inInvertStencil ) {
+    SpriteGL::flushBatch();
+    
     // Re-enable update of color
     glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
     glDisable( GL_ALPHA_TEST );
@@ -673,6 +713,8 @@ void stopStencil() {
 
 
 void disableStencil() {
+    SpriteGL::flushBatch();
+    
     // Re-enable update of color (just in case stencil drawing was not started)
     glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
     glDisable( GL_ALPHA_TEST );
@@ -775,6 +817,21 @@ double endCountingSpritesDrawn() {
 
 
 
+void startCountingSpriteDrawCalls() {
+    SpriteGL::resetDrawCallCounts();
+    }
+
+
+
+double endCountingSpriteDrawCalls( double *outNumBatches ) {
+    if( outNumBatches != NULL ) {
+        *outNumBatches = SpriteGL::getNumBatches();
+        }
+    return SpriteGL::getNumDrawCalls();
+    }
+
+
+
 // profiler found constructor/deconstructor calls were using 1.8% of time
 static Vector3D spritePos( 0, 0, 0 );
 
@@ -806,6 +863,28 @@ void drawSprite( SpriteHandle inSprite, doublePair inCenter,
 
 
 
+void drawSprites( int inNumSprites, SpriteHandle inSprites[], 
+                  doublePair inCenters[], double inZoom ) {
+    
+    // queue them all, even if caller isn't batching
+    char wasBatching = SpriteGL::getBatching();
+    
+    if( ! wasBatching ) {
+        SpriteGL::toggleBatching( true );
+        }
+    
+    for( int i=0; i<inNumSprites; i++ ) {
+        drawSprite( inSprites[i], inCenters[i], inZoom );
+        }
+    
+    if( ! wasBatching ) {
+        // flushes
+        SpriteGL::toggleBatching( false );
+        }
+    }
+
+
+
 void drawSprite( SpriteHandle inSprite, doublePair inCenter, 
                  FloatColor inCornerColors[4],
                  double inZoom, double inRotation, char inFlipH ) {
@@ -867,6 +946,8 @@ void drawSpriteAlphaOnly( SpriteHandle inSprite, doublePair inCenter,
     // http://stackoverflow.com/questions/2485370/
     //      use-only-alpha-channel-of-texture-in-opengl
 
+    SpriteGL::flushBatch();
+    
     glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
     glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE);
     glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PREVIOUS);
@@ -878,6 +959,8 @@ void drawSpriteAlphaOnly( SpriteHandle inSprite, doublePair inCenter,
 
     drawSprite( inSprite, inCenter, inZoom, inRotation, inFlipH );
 
+    SpriteGL::flushBatch();
+
     // restore texture mode
     glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
     }
@@ -0,0 +1,275 @@
+// Measures sprite drawing speed with and without batching and atlas
+// packing, rendering offscreen with Mesa's software rasterizer (OSMesa).
+//
+// Also checks that batched and atlas-packed drawing produce the same
+// pixels as plain drawing.
+//
+// Usage:  spriteBatchBenchmark [numSpritesPerFrame numFrames]
+
+
+#include "minorGems/game/gameGraphics.h"
+
+#include "minorGems/graphics/openGL/glInclude.h"
+
+#include "minorGems/system/Time.h"
+
+#include "minorGems/util/random/CustomRandomSource.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#include "minorGems/graphics/openGL/OSMesaGLSurface.cpp"
+
+
+
+static int screenW = 1024;
+static int screenH = 768;
+
+static int numSpritesPerFrame = 5000;
+static int numFrames = 30;
+
+#define NUM_SPRITE_IMAGES 64
+#define SPRITE_SIZE 32
+
+
+
+static unsigned char *spriteImages[ NUM_SPRITE_IMAGES ];
+
+
+// batched sprites get their color from a color array instead of glColor,
+// which can round differently
+#define MAX_ALLOWED_PIXEL_DIFF 2
+
+static char mismatchFound = false;
+
+
+
+static void makeSpriteImages() {
+    CustomRandomSource randSource( 3 );
+
+    for( int i=0; i<NUM_SPRITE_IMAGES; i++ ) {
+        spriteImages[i] = new unsigned char[ SPRITE_SIZE * SPRITE_SIZE * 4 ];
+
+        unsigned char r = randSource.getRandomBoundedInt( 0, 255 );
+        unsigned char g = randSource.getRandomBoundedInt( 0, 255 );
+        unsigned char b = randSource.getRandomBoundedInt( 0, 255 );
+
+        double radius = SPRITE_SIZE / 2 - 2;
+
+        for( int y=0; y<SPRITE_SIZE; y++ ) {
+            for( int x=0; x<SPRITE_SIZE; x++ ) {
+                unsigned char *p =
+                    &( spriteImages[i][ ( y * SPRITE_SIZE + x ) * 4 ] );
+
+                double dX = x - SPRITE_SIZE / 2 + 0.5;
+                double dY = y - SPRITE_SIZE / 2 + 0.5;
+
+                p[0] = r ^ ( x * 4 );
+                p[1] = g ^ ( y * 4 );
+                p[2] = b;
+
+                if( dX * dX + dY * dY < radius * radius ) {
+                    p[3] = 255;
+                    }
+                else {
+                    p[3] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+
+
+static SpriteHandle sprites[ NUM_SPRITE_IMAGES ];
+
+
+static void loadSprites() {
+    unsigned char *bytes = new unsigned char[ SPRITE_SIZE * SPRITE_SIZE * 4 ];
+
+    for( int i=0; i<NUM_SPRITE_IMAGES; i++ ) {
+        // fillSprite can modify bytes
+        memcpy( bytes, spriteImages[i], SPRITE_SIZE * SPRITE_SIZE * 4 );
+        sprites[i] = fillSprite( bytes, SPRITE_SIZE, SPRITE_SIZE );
+        }
+    delete [] bytes;
+    }
+
+
+static void freeSprites() {
+    for( int i=0; i<NUM_SPRITE_IMAGES; i++ ) {
+        freeSprite( sprites[i] );
+        }
+    }
+
+
+
+// same sprites, positions, and colors every frame, in a scattered order
+// like a scene sorted by depth rather than by sprite
+static void drawTestFrame() {
+    glClear( GL_COLOR_BUFFER_BIT );
+
+    CustomRandomSource randSource( 17 );
+
+    for( int i=0; i<numSpritesPerFrame; i++ ) {
+        int s = randSource.getRandomBoundedInt( 0, NUM_SPRITE_IMAGES - 1 );
+
+        doublePair pos =
+            { (double)randSource.getRandomBoundedInt( 0, screenW ),
+              (double)randSource.getRandomBoundedInt( 0, screenH ) };
+
+        if( i % 10 == 0 ) {
+            FloatColor corners[4] = { { 1, 0, 0, 1 },
+                                      { 0, 1, 0, 1 },
+                                      { 0, 0, 1, 1 },
+                                      { 1, 1, 1, 0.5 } };
+            drawSprite( sprites[s], pos, corners );
+            }
+        else {
+            setDrawColor( 1, 1, 1,
+                          randSource.getRandomBoundedInt( 128, 255 ) / 255.0 );
+            drawSprite( sprites[s], pos );
+            }
+        }
+
+    flushSpriteBatch();
+    }
+
+
+
+static unsigned char *readFrame() {
+    unsigned char *pixels = new unsigned char[ screenW * screenH * 4 ];
+
+    glReadPixels( 0, 0, screenW, screenH, GL_RGBA, GL_UNSIGNED_BYTE,
+                  pixels );
+    return pixels;
+    }
+
+
+
+// returns frames per second
+static double runMode( const char *inName, char inBatch, char inAtlas,
+                       unsigned char *inReferenceFrame,
+                       unsigned char **outFrame ) {
+
+    toggleSpriteAtlasPacking( inAtlas );
+    loadSprites();
+
+    toggleSpriteBatching( inBatch );
+
+    // warm up, and one frame to check against reference
+    drawTestFrame();
+    glFinish();
+
+    unsigned char *frame = readFrame();
+
+    int maxDiff = 0;
+    if( inReferenceFrame != NULL ) {
+        for( int i=0; i<screenW * screenH * 4; i++ ) {
+            int d = abs( frame[i] - inReferenceFrame[i] );
+            if( d > maxDiff ) {
+                maxDiff = d;
+                }
+            }
+        }
+
+    if( maxDiff > MAX_ALLOWED_PIXEL_DIFF ) {
+        mismatchFound = true;
+        }
+
+    startCountingSpriteDrawCalls();
+
+    double startTime = Time::getCurrentTime();
+
+    for( int f=0; f<numFrames; f++ ) {
+        drawTestFrame();
+        glFinish();
+        }
+
+    double time = Time::getCurrentTime() - startTime;
+
+    double numBatches;
+    double numDrawCalls = endCountingSpriteDrawCalls( &numBatches );
+
+    toggleSpriteBatching( false );
+    freeSprites();
+
+    double fps = numFrames / time;
+
+    printf( "%-16s %8.2f fps   %8.1f draw calls/frame   "
+            "%8.1f batches/frame   max pixel diff %d\n",
+            inName, fps, numDrawCalls / numFrames, numBatches / numFrames,
+            maxDiff );
+
+    *outFrame = frame;
+    return fps;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    if( inNumArgs == 3 ) {
+        numSpritesPerFrame = atoi( inArgs[1] );
+        numFrames = atoi( inArgs[2] );
+        }
+
+    if( ! osMesaCreateSurface( screenW, screenH ) ) {
+        printf( "Failed to create OSMesa surface\n" );
+        return 1;
+        }
+
+    printf( "GL renderer:  %s\n", glGetString( GL_RENDERER ) );
+    printf( "%d sprites per frame, %d frames\n\n",
+            numSpritesPerFrame, numFrames );
+
+    glViewport( 0, 0, screenW, screenH );
+
+    glMatrixMode( GL_PROJECTION );
+    glLoadIdentity();
+    glOrtho( 0, screenW, 0, screenH, -1, 1 );
+
+    glMatrixMode( GL_MODELVIEW );
+    glLoadIdentity();
+
+    glDisable( GL_CULL_FACE );
+    glDisable( GL_DEPTH_TEST );
+    glEnable( GL_BLEND );
+    toggleAdditiveBlend( false );
+
+    makeSpriteImages();
+
+    unsigned char *reference;
+    unsigned char *frame;
+
+    double plainFPS = runMode( "plain", false, false, NULL, &reference );
+
+    double batchFPS = runMode( "batched", true, false, reference, &frame );
+    delete [] frame;
+
+    double atlasFPS = runMode( "atlas", false, true, reference, &frame );
+    delete [] frame;
+
+    double bothFPS = runMode( "atlas+batched", true, true, reference, &frame );
+    delete [] frame;
+
+    delete [] reference;
+
+    printf( "\nspeedup:  batched %.2fx, atlas %.2fx, atlas+batched %.2fx\n",
+            batchFPS / plainFPS, atlasFPS / plainFPS, bothFPS / plainFPS );
+
+    for( int i=0; i<NUM_SPRITE_IMAGES; i++ ) {
+        delete [] spriteImages[i];
+        }
+
+    osMesaReleaseSurface();
+
+    if( mismatchFound ) {
+        printf( "\nMISMATCH:  drawing differs from plain drawing\n" );
+        return 1;
+        }
+
+    return 0;
+    }
@@ -234,6 +234,24 @@ class Primitive3D : public Serializable {
 		 */
 		virtual void stopAnimation( int inAnimationIndex );
 
+
+		/**
+		 * Marks this primitive's packed vertex arrays as out of date.
+		 *
+		 * Must be called after changing mVertices, mNormals, or the
+		 * anchors of a primitive that has already been drawn, for
+		 * example by a subclass in setParameter() or step().
+		 */
+		void verticesChanged();
+
+		
+		/**
+		 * Rebuilds the packed vertex arrays if they are out of date.
+		 *
+		 * @return true if the arrays were rebuilt by this call.
+		 */
+		char updatePackedArrays();
+
 		
 		long mHigh, mWide;
 		long mNumVertices;
@@ -250,6 +268,22 @@ class Primitive3D : public Serializable {
 		double **mAnchorX; 
 		double **mAnchorY;
 		
+
+		// Flat copies of the mesh, one array per attribute, for drawing
+		// from vertex arrays.  Valid after updatePackedArrays().
+		
+		// x, y, z for each vertex
+		float *mPackedVertices;
+		float *mPackedNormals;
+		
+		// x, y anchor for each vertex, one array per texture
+		float **mPackedAnchors;
+		
+		// vertex indices for drawing the whole mesh as one triangle
+		// strip, with rows joined by degenerate triangles
+		unsigned int *mStripIndices;
+		long mNumStripIndices;
+		
 		
 		// implement the Serializable interface
 		virtual int serialize( OutputStream *inOutputStream );
@@ -272,6 +306,16 @@ class Primitive3D : public Serializable {
 		char mBackVisible;
 		
 		
+		char mPackedArraysStale;
+		
+		// sizes that the packed arrays were allocated with
+		long mPackedNumVertices;
+		long mPackedNumTextures;
+		
+		// frees the packed arrays
+		void deletePackedArrays();
+		
+		
 		
 	};
 
@@ -284,7 +328,11 @@ inline Primitive3D::Primitive3D(  long inWide, long inHigh,
 	mNumTextures( inNumTextures ), mVertices( inVertices ),
 	mTexture( inTexture ), mAnchorX( inAnchorX ), mAnchorY( inAnchorY ),
 	mTransparent( false ), mBackVisible( false ),
-	mMembersAllocated( true ) {
+	mMembersAllocated( true ),
+	mPackedVertices( NULL ), mPackedNormals( NULL ), 
+	mPackedAnchors( NULL ), mStripIndices( NULL ), mNumStripIndices( 0 ),
+	mPackedArraysStale( true ), 
+	mPackedNumVertices( 0 ), mPackedNumTextures( 0 ) {
 	
 	generateNormals();	
 	}
@@ -293,13 +341,19 @@ inline Primitive3D::Primitive3D(  long inWide, long inHigh,
 
 inline Primitive3D::Primitive3D()
 	: mTransparent( false ), mBackVisible( false ),
-	mMembersAllocated( false ) {
+	mMembersAllocated( false ),
+	mPackedVertices( NULL ), mPackedNormals( NULL ), 
+	mPackedAnchors( NULL ), mStripIndices( NULL ), mNumStripIndices( 0 ),
+	mPackedArraysStale( true ), 
+	mPackedNumVertices( 0 ), mPackedNumTextures( 0 ) {
 	
 	}
 
 
 
 inline Primitive3D::~Primitive3D() {
+	deletePackedArrays();
+	
 	if( mMembersAllocated ) {
 		int i;
 		for( i=0; i<mNumVertices; i++ ) {
@@ -414,6 +468,123 @@ inline void Primitive3D::generateNormals() {
 
 
 
+inline void Primitive3D::verticesChanged() {
+	mPackedArraysStale = true;
+	}
+
+
+
+inline void Primitive3D::deletePackedArrays() {
+	if( mPackedVertices != NULL ) {
+		delete [] mPackedVertices;
+		delete [] mPackedNormals;
+		
+		for( int t=0; t<mPackedNumTextures; t++ ) {
+			delete [] mPackedAnchors[t];
+			}
+		delete [] mPackedAnchors;
+		delete [] mStripIndices;
+		
+		mPackedVertices = NULL;
+		mPackedNormals = NULL;
+		mPackedAnchors = NULL;
+		mStripIndices = NULL;
+		mNumStripIndices = 0;
+		}
+	}
+
+
+
+inline char Primitive3D::updatePackedArrays() {
+	if( !mPackedArraysStale ) {
+		return false;
+		}
+	
+	int i, t;
+	
+	if( mPackedVertices == NULL || 
+		mPackedNumVertices != mNumVertices ||
+		mPackedNumTextures != mNumTextures ) {
+		
+		deletePackedArrays();
+		
+		mPackedNumVertices = mNumVertices;
+		mPackedNumTextures = mNumTextures;
+		
+		mPackedVertices = new float[ 3 * mNumVertices ];
+		mPackedNormals = new float[ 3 * mNumVertices ];
+		
+		mPackedAnchors = new float*[ mNumTextures ];
+		for( t=0; t<mNumTextures; t++ ) {
+			mPackedAnchors[t] = new float[ 2 * mNumVertices ];
+			}
+		
+		// each strip between two rows has 2 vertices per column,
+		// and each join between strips repeats the last vertex of one
+		// and the first of the next, so every strip starts at an even
+		// index and keeps its winding order
+		int numStrips = mHigh - 1;
+		if( numStrips < 0 ) {
+			numStrips = 0;
+			}
+		
+		mNumStripIndices = numStrips * 2 * mWide;
+		if( numStrips > 1 ) {
+			mNumStripIndices += ( numStrips - 1 ) * 2;
+			}
+		
+		mStripIndices = new unsigned int[ mNumStripIndices ];
+		
+		int next = 0;
+		for( int y=0; y<numStrips; y++ ) {
+			unsigned int thisRow = y * mWide;
+			unsigned int nextRow = ( y + 1 ) * mWide;
+			
+			if( y > 0 ) {
+				// repeat last vertex of last strip, and first of this one
+				mStripIndices[ next ] = mStripIndices[ next - 1 ];
+				next++;
+				mStripIndices[ next++ ] = nextRow;
+				}
+			
+			// same order as the vertices of one strip in PrimitiveGL
+			for( int x=0; x<mWide; x++ ) {
+				mStripIndices[ next++ ] = nextRow + x;
+				mStripIndices[ next++ ] = thisRow + x;
+				}
+			}
+		}
+	
+	for( i=0; i<mNumVertices; i++ ) {
+		float *vertex = &( mPackedVertices[ 3 * i ] );
+		vertex[0] = (float)( mVertices[i]->mX );
+		vertex[1] = (float)( mVertices[i]->mY );
+		vertex[2] = (float)( mVertices[i]->mZ );
+		
+		float *normal = &( mPackedNormals[ 3 * i ] );
+		normal[0] = (float)( mNormals[i]->mX );
+		normal[1] = (float)( mNormals[i]->mY );
+		normal[2] = (float)( mNormals[i]->mZ );
+		}
+	
+	for( t=0; t<mNumTextures; t++ ) {
+		float *anchors = mPackedAnchors[t];
+		double *anchorX = mAnchorX[t];
+		double *anchorY = mAnchorY[t];
+		
+		for( i=0; i<mNumVertices; i++ ) {
+			anchors[ 2 * i ] = (float)( anchorX[i] );
+			anchors[ 2 * i + 1 ] = (float)( anchorY[i] );
+			}
+		}
+	
+	mPackedArraysStale = false;
+	
+	return true;
+	}
+
+
+
 inline void Primitive3D::setTransparent( char inTransparent ) {
 	mTransparent = inTransparent;
 	}
@@ -667,6 +838,7 @@ inline int Primitive3D::deserialize( InputStream *inInputStream ) {
 		inInputStream->read( (unsigned char *)&mBackVisible, 1 );
 	
 	mMembersAllocated = true;
+	mPackedArraysStale = true;
 	
 	return numBytesRead;
 	}
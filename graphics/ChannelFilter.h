@@ -24,6 +24,24 @@ class ChannelFilter {
 		virtual void apply( double *inChannel, int inWidth, int inHeight ) = 0;
 
 
+		/**
+		 * Gets how far each filtered value can depend on values around
+		 * it, so that a channel can be filtered in pieces.
+		 *
+		 * @return 0 if each value depends only on the value at the
+		 *   same position, so that any run of values can be filtered
+		 *   as a 1-row channel,
+		 *   r if each value depends only on values within r rows and
+		 *   columns of it, and on the channel edges only within r
+		 *   rows or columns of them,
+		 *   or -1 if the whole channel is needed.
+		 *   Defaults to -1.
+		 */
+		virtual int getNeighborhoodRadius() {
+			return -1;
+			}
+
+
         // ensure proper destruction of subclasses
         virtual ~ChannelFilter() {
             }
@@ -0,0 +1,458 @@
+#include "FrameCapture.h"
+
+#include "minorGems/graphics/Image.h"
+#include "minorGems/io/file/FileOutputStream.h"
+
+#include <string.h>
+
+
+
+FrameCapture::FrameCapture( int inWidth, int inHeight,
+                            ImageConverter *inConverter,
+                            int inNumThreads, int inNumBuffers,
+                            FrameCaptureOverflowPolicy inPolicy )
+        : mWidth( inWidth ), mHeight( inHeight ),
+          mConverter( inConverter ),
+          mY4MFile( NULL ),
+          mPolicy( inPolicy ) {
+
+    init( inNumThreads, inNumBuffers );
+    }
+
+
+
+FrameCapture::FrameCapture( int inWidth, int inHeight,
+                            File *inY4MFile, int inFrameRate,
+                            int inNumThreads, int inNumBuffers,
+                            FrameCaptureOverflowPolicy inPolicy )
+        : mWidth( inWidth ), mHeight( inHeight ),
+          mConverter( NULL ),
+          mY4MFile( NULL ),
+          mPolicy( inPolicy ) {
+
+    char *fileName = inY4MFile->getFullFileName();
+
+    mY4MFile = fopen( fileName, "wb" );
+
+    delete [] fileName;
+
+    if( mY4MFile != NULL ) {
+        // full-range (JPEG) 4:2:0 with square pixels
+        fprintf( mY4MFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+                 mWidth, mHeight, inFrameRate );
+        }
+
+    init( inNumThreads, inNumBuffers );
+    }
+
+
+
+void FrameCapture::init( int inNumThreads, int inNumBuffers ) {
+    if( inNumThreads < 1 ) {
+        inNumThreads = 1;
+        }
+    if( inNumBuffers < 1 ) {
+        inNumBuffers = 1;
+        }
+
+    mStopping = false;
+    mCurrentSlot = -1;
+    mNextSequenceNumber = 0;
+    mNextSequenceNumberToWrite = 0;
+    mNumWritten = 0;
+    mNumDropped = 0;
+
+    mNumBuffers = inNumBuffers;
+    mSlots = new FrameCaptureSlot[ mNumBuffers ];
+
+    int numBytes = mWidth * mHeight * 3;
+
+    for( int i=0; i<mNumBuffers; i++ ) {
+        mSlots[i].rgbBytes = new unsigned char[ numBytes ];
+        mSlots[i].file = NULL;
+        mSlots[i].sequenceNumber = 0;
+        mSlots[i].encodedBytes = NULL;
+        mSlots[i].numEncodedBytes = 0;
+        mSlots[i].encodedDone = false;
+
+        mFreeSlots.push_back( i );
+        }
+
+    for( int i=0; i<inNumThreads; i++ ) {
+        mThreads.push_back( new FrameCaptureThread( this ) );
+        }
+    }
+
+
+
+FrameCapture::~FrameCapture() {
+    if( mCurrentSlot != -1 ) {
+        cancelFrame();
+        }
+
+    mLock.lock();
+    mStopping = true;
+    mLock.unlock();
+
+    // each thread passes this along to the next one as it exits
+    mQueuedSignal.signal();
+
+    for( int i=0; i<mThreads.size(); i++ ) {
+        delete mThreads.getElementDirect( i );
+        }
+
+    if( mY4MFile != NULL ) {
+        fclose( mY4MFile );
+        mY4MFile = NULL;
+        }
+
+    for( int i=0; i<mNumBuffers; i++ ) {
+        delete [] mSlots[i].rgbBytes;
+
+        if( mSlots[i].file != NULL ) {
+            delete mSlots[i].file;
+            }
+        if( mSlots[i].encodedBytes != NULL ) {
+            delete [] mSlots[i].encodedBytes;
+            }
+        }
+    delete [] mSlots;
+    }
+
+
+
+unsigned char *FrameCapture::beginFrame() {
+    if( mCurrentSlot != -1 ) {
+        // last frame never ended, reuse its buffer
+        return mSlots[ mCurrentSlot ].rgbBytes;
+        }
+
+    while( true ) {
+        mLock.lock();
+        
+        if( mFreeSlots.size() > 0 ) {
+            mCurrentSlot = mFreeSlots.getElementDirect( 0 );
+            mFreeSlots.deleteElement( 0 );
+            mLock.unlock();
+            
+            return mSlots[ mCurrentSlot ].rgbBytes;
+            }
+        
+        if( mPolicy == FRAME_CAPTURE_DROP ) {
+            mNumDropped++;
+            mLock.unlock();
+            return NULL;
+            }
+        mLock.unlock();
+        
+        // timeout guards against missed signals
+        mFreeSignal.wait( 100 );
+        }
+    }
+
+
+
+void FrameCapture::endFrame( File *inFile ) {
+    if( mCurrentSlot == -1 ) {
+        if( inFile != NULL ) {
+            delete inFile;
+            }
+        return;
+        }
+
+    FrameCaptureSlot *slot = &( mSlots[ mCurrentSlot ] );
+
+    if( mY4MFile != NULL && inFile != NULL ) {
+        delete inFile;
+        inFile = NULL;
+        }
+
+    slot->file = inFile;
+    slot->encodedDone = false;
+
+    mLock.lock();
+    slot->sequenceNumber = mNextSequenceNumber;
+    mNextSequenceNumber++;
+
+    mQueuedSlots.push_back( mCurrentSlot );
+    mLock.unlock();
+
+    mCurrentSlot = -1;
+
+    mQueuedSignal.signal();
+    }
+
+
+
+void FrameCapture::cancelFrame() {
+    if( mCurrentSlot == -1 ) {
+        return;
+        }
+    releaseSlot( mCurrentSlot );
+    mCurrentSlot = -1;
+    }
+
+
+
+void FrameCapture::releaseSlot( int inSlotIndex ) {
+    mLock.lock();
+    mFreeSlots.push_back( inSlotIndex );
+    mLock.unlock();
+
+    mFreeSignal.signal();
+    }
+
+
+
+void FrameCapture::flush() {
+    int numHeld = 0;
+    if( mCurrentSlot != -1 ) {
+        // caller is still filling one
+        numHeld = 1;
+        }
+
+    while( true ) {
+        mLock.lock();
+        int numFree = mFreeSlots.size();
+        mLock.unlock();
+
+        if( numFree + numHeld >= mNumBuffers ) {
+            return;
+            }
+        Thread::staticSleep( 1 );
+        }
+    }
+
+
+
+int FrameCapture::getNumFramesWritten() {
+    mLock.lock();
+    int n = mNumWritten;
+    mLock.unlock();
+    return n;
+    }
+
+
+
+int FrameCapture::getNumFramesDropped() {
+    mLock.lock();
+    int n = mNumDropped;
+    mLock.unlock();
+    return n;
+    }
+
+
+
+char FrameCapture::processNextFrame() {
+    mLock.lock();
+
+    if( mQueuedSlots.size() == 0 ) {
+        char stopping = mStopping;
+        mLock.unlock();
+
+        if( stopping ) {
+            // wake next thread so it can exit too
+            mQueuedSignal.signal();
+            return false;
+            }
+
+        // timeout guards against missed signals
+        mQueuedSignal.wait( 100 );
+        return true;
+        }
+
+    int slotIndex = mQueuedSlots.getElementDirect( 0 );
+    mQueuedSlots.deleteElement( 0 );
+    
+    char moreQueued = ( mQueuedSlots.size() > 0 );
+    mLock.unlock();
+
+    if( moreQueued ) {
+        // one signal may have covered several queued frames
+        // wake another thread to help
+        mQueuedSignal.signal();
+        }
+
+
+    FrameCaptureSlot *slot = &( mSlots[ slotIndex ] );
+
+    if( mY4MFile != NULL ) {
+        encodeY4M( slot );
+
+        mLock.lock();
+        slot->encodedDone = true;
+        writeReadyY4MFrames();
+        mLock.unlock();
+        }
+    else {
+        if( mConverter != NULL && slot->file != NULL ) {
+            encodeImageFile( slot );
+            }
+        if( slot->file != NULL ) {
+            delete slot->file;
+            slot->file = NULL;
+            }
+
+        mLock.lock();
+        mNumWritten++;
+        mLock.unlock();
+
+        releaseSlot( slotIndex );
+        }
+
+    return true;
+    }
+
+
+
+void FrameCapture::encodeImageFile( FrameCaptureSlot *inSlot ) {
+    Image screenImage( mWidth, mHeight, 3, false );
+
+    double *channelOne = screenImage.getChannel( 0 );
+    double *channelTwo = screenImage.getChannel( 1 );
+    double *channelThree = screenImage.getChannel( 2 );
+
+    unsigned char *rgbBytes = inSlot->rgbBytes;
+
+    // buffer is upside down
+    int outputRow = 0;
+    for( int y=mHeight - 1; y>=0; y-- ) {
+        unsigned char *rowBytes = &( rgbBytes[ y * mWidth * 3 ] );
+
+        int outputRowStart = outputRow * mWidth;
+
+        for( int x=0; x<mWidth; x++ ) {
+            int outputPixelIndex = outputRowStart + x;
+
+            // divide by 255, with a multiply
+            channelOne[outputPixelIndex] = *( rowBytes++ ) * 0.003921569;
+            channelTwo[outputPixelIndex] = *( rowBytes++ ) * 0.003921569;
+            channelThree[outputPixelIndex] = *( rowBytes++ ) * 0.003921569;
+            }
+        outputRow++;
+        }
+
+    FileOutputStream stream( inSlot->file );
+    mConverter->formatImage( &screenImage, &stream );
+    }
+
+
+
+static inline unsigned char clampByte( int inValue ) {
+    if( inValue > 255 ) {
+        return 255;
+        }
+    if( inValue < 0 ) {
+        return 0;
+        }
+    return (unsigned char)inValue;
+    }
+
+
+
+void FrameCapture::encodeY4M( FrameCaptureSlot *inSlot ) {
+    int chromaW = ( mWidth + 1 ) / 2;
+    int chromaH = ( mHeight + 1 ) / 2;
+
+    const char *frameHeader = "FRAME\n";
+    int headerLength = strlen( frameHeader );
+
+    int numBytes = headerLength + mWidth * mHeight + 2 * chromaW * chromaH;
+
+    if( inSlot->encodedBytes == NULL ) {
+        // reused for all frames that pass through this slot
+        inSlot->encodedBytes = new unsigned char[ numBytes ];
+        }
+    inSlot->numEncodedBytes = numBytes;
+
+    memcpy( inSlot->encodedBytes, frameHeader, headerLength );
+
+    unsigned char *yPlane = &( inSlot->encodedBytes[ headerLength ] );
+    unsigned char *uPlane = &( yPlane[ mWidth * mHeight ] );
+    unsigned char *vPlane = &( uPlane[ chromaW * chromaH ] );
+
+    unsigned char *rgbBytes = inSlot->rgbBytes;
+    int rowBytes = mWidth * 3;
+
+    // full-range BT.601 in 8.8 fixed point
+    // output rows top first, buffer rows bottom first
+    for( int outY=0; outY<mHeight; outY++ ) {
+        unsigned char *rgb = &( rgbBytes[ ( mHeight - 1 - outY ) * rowBytes ] );
+        unsigned char *yRow = &( yPlane[ outY * mWidth ] );
+
+        for( int x=0; x<mWidth; x++ ) {
+            int r = rgb[0];
+            int g = rgb[1];
+            int b = rgb[2];
+            rgb += 3;
+
+            yRow[x] = (unsigned char)( ( 77 * r + 150 * g + 29 * b + 128 )
+                                       >> 8 );
+            }
+        }
+
+    // chroma from average of each 2x2 block
+    for( int cy=0; cy<chromaH; cy++ ) {
+        int outYA = cy * 2;
+        int outYB = outYA + 1;
+        if( outYB >= mHeight ) {
+            outYB = outYA;
+            }
+
+        unsigned char *rowA = &( rgbBytes[ ( mHeight - 1 - outYA ) * rowBytes ] );
+        unsigned char *rowB = &( rgbBytes[ ( mHeight - 1 - outYB ) * rowBytes ] );
+
+        for( int cx=0; cx<chromaW; cx++ ) {
+            int xA = cx * 2 * 3;
+            int xB = xA + 3;
+            if( cx * 2 + 1 >= mWidth ) {
+                xB = xA;
+                }
+
+            int r = rowA[xA] + rowA[xB] + rowB[xA] + rowB[xB];
+            int g = rowA[xA+1] + rowA[xB+1] + rowB[xA+1] + rowB[xB+1];
+            int b = rowA[xA+2] + rowA[xB+2] + rowB[xA+2] + rowB[xB+2];
+
+            // sums are 4x, fold the divide into the shift
+            int index = cy * chromaW + cx;
+
+            uPlane[ index ] = clampByte(
+                ( -43 * r - 85 * g + 128 * b + 4 * 32896 ) >> 10 );
+            vPlane[ index ] = clampByte(
+                ( 128 * r - 107 * g - 21 * b + 4 * 32896 ) >> 10 );
+            }
+        }
+    }
+
+
+
+void FrameCapture::writeReadyY4MFrames() {
+    char found = true;
+
+    while( found ) {
+        found = false;
+
+        for( int i=0; i<mNumBuffers; i++ ) {
+            FrameCaptureSlot *slot = &( mSlots[i] );
+
+            if( slot->encodedDone &&
+                slot->sequenceNumber == mNextSequenceNumberToWrite ) {
+
+                if( mY4MFile != NULL ) {
+                    fwrite( slot->encodedBytes, 1, slot->numEncodedBytes,
+                            mY4MFile );
+                    }
+
+                slot->encodedDone = false;
+                mNextSequenceNumberToWrite++;
+                mNumWritten++;
+
+                mFreeSlots.push_back( i );
+                mFreeSignal.signal();
+
+                found = true;
+                break;
+                }
+            }
+        }
+    }
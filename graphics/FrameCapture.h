@@ -0,0 +1,247 @@
+#ifndef FRAME_CAPTURE_INCLUDED
+#define FRAME_CAPTURE_INCLUDED
+
+
+#include "minorGems/graphics/ImageConverter.h"
+#include "minorGems/io/file/File.h"
+
+#include "minorGems/system/Thread.h"
+#include "minorGems/system/MutexLock.h"
+#include "minorGems/system/BinarySemaphore.h"
+
+#include "minorGems/util/SimpleVector.h"
+
+#include <stdio.h>
+
+
+
+// what beginFrame does when all frame buffers are still waiting to be
+// encoded
+enum FrameCaptureOverflowPolicy {
+    // wait for a buffer to free up (no frames lost, but caller slows
+    // down to encoding speed)
+    FRAME_CAPTURE_BLOCK,
+    // skip this frame
+    FRAME_CAPTURE_DROP
+    };
+
+
+
+typedef struct FrameCaptureSlot {
+        // raw RGB bytes, bottom row first (as returned by glReadPixels)
+        unsigned char *rgbBytes;
+
+        // where this frame goes (NULL in y4m mode)
+        File *file;
+
+        unsigned int sequenceNumber;
+
+        // y4m mode only, encoded FRAME record waiting to be written in order
+        unsigned char *encodedBytes;
+        int numEncodedBytes;
+        char encodedDone;
+    } FrameCaptureSlot;
+
+
+
+class FrameCaptureThread;
+
+
+
+// Pipeline for saving a sequence of rendered frames to disk without
+// stalling the render thread on image encoding.
+//
+// The render thread reads pixels directly into one of a fixed ring of
+// pre-allocated raw RGB buffers.  Worker threads convert and encode
+// filled buffers, then return them to the ring.
+//
+// Two output modes:
+//   -- one file per frame, encoded by an ImageConverter (TGA, PNG, JPEG)
+//      Files are named by the caller, so output order does not depend on
+//      which worker finishes first.
+//   -- a single raw YUV4MPEG2 (y4m) stream, 4:2:0, which can be fed
+//      directly to video encoders.  Workers do the color conversion, and
+//      frames are written to the stream in submission order.
+//
+// beginFrame/endFrame must all be called from the same thread.
+class FrameCapture {
+
+    public:
+
+        /**
+         * Constructs a capture pipeline that writes one image file per
+         * frame.
+         *
+         * @param inWidth, inHeight frame dimensions in pixels.
+         * @param inConverter converter used to encode each frame.
+         *   Called from several worker threads at once, so must not
+         *   keep per-call state.
+         *   Destroyed by caller after this class is destroyed.
+         * @param inNumThreads number of encoding threads.
+         * @param inNumBuffers number of frame buffers in the ring.
+         * @param inPolicy what to do when all buffers are in use.
+         */
+        FrameCapture( int inWidth, int inHeight,
+                      ImageConverter *inConverter,
+                      int inNumThreads, int inNumBuffers,
+                      FrameCaptureOverflowPolicy inPolicy );
+
+
+        /**
+         * Constructs a capture pipeline that writes a single y4m stream.
+         *
+         * @param inWidth, inHeight frame dimensions in pixels.
+         * @param inY4MFile file to write the stream to.  Destroyed by caller.
+         * @param inFrameRate frame rate to put in stream header.
+         * @param inNumThreads number of conversion threads.
+         * @param inNumBuffers number of frame buffers in the ring.
+         * @param inPolicy what to do when all buffers are in use.
+         */
+        FrameCapture( int inWidth, int inHeight,
+                      File *inY4MFile, int inFrameRate,
+                      int inNumThreads, int inNumBuffers,
+                      FrameCaptureOverflowPolicy inPolicy );
+
+
+        // finishes encoding all submitted frames before returning
+        ~FrameCapture();
+
+
+
+        /**
+         * Gets a free buffer for the next frame.
+         *
+         * @return a buffer of width * height * 3 bytes to fill with
+         *   bottom-row-first RGB data, or NULL if the frame should be
+         *   skipped (FRAME_CAPTURE_DROP policy, no buffer free).
+         *   Not destroyed by caller.
+         */
+        unsigned char *beginFrame();
+
+
+        /**
+         * Queues the buffer from the last beginFrame call for encoding.
+         *
+         * @param inFile file to write this frame to.  Ignored (and can be
+         *   NULL) in y4m mode.  Destroyed by this class.
+         */
+        void endFrame( File *inFile );
+
+
+        /**
+         * Returns the buffer from the last beginFrame call to the ring
+         * without encoding it.
+         */
+        void cancelFrame();
+
+
+        /**
+         * Blocks until all queued frames have been written.
+         */
+        void flush();
+
+
+        int getNumFramesWritten();
+
+        int getNumFramesDropped();
+
+
+        int getWidth() {
+            return mWidth;
+            }
+
+        int getHeight() {
+            return mHeight;
+            }
+
+
+
+    protected:
+
+        friend class FrameCaptureThread;
+
+        // called by worker threads
+        // returns false if the pipeline is shutting down and no work is left
+        char processNextFrame();
+
+
+        void init( int inNumThreads, int inNumBuffers );
+
+        void encodeImageFile( FrameCaptureSlot *inSlot );
+        void encodeY4M( FrameCaptureSlot *inSlot );
+
+        // writes any y4m frames that are next in sequence
+        // mLock must be held
+        void writeReadyY4MFrames();
+
+        void releaseSlot( int inSlotIndex );
+
+
+        int mWidth;
+        int mHeight;
+
+        ImageConverter *mConverter;
+
+        FILE *mY4MFile;
+
+        FrameCaptureOverflowPolicy mPolicy;
+
+        int mNumBuffers;
+        FrameCaptureSlot *mSlots;
+
+        // protects everything below
+        MutexLock mLock;
+
+        // Semaphore is not safe with several waiting threads, so lists
+        // are checked under mLock, and these are only used to wake
+        // sleeping threads
+        
+        // signaled when a slot is freed
+        BinarySemaphore mFreeSignal;
+        SimpleVector<int> mFreeSlots;
+
+        // signaled when a slot is queued, or when stopping
+        BinarySemaphore mQueuedSignal;
+        SimpleVector<int> mQueuedSlots;
+
+        char mStopping;
+
+        // slot handed out by beginFrame, or -1
+        int mCurrentSlot;
+
+        unsigned int mNextSequenceNumber;
+        unsigned int mNextSequenceNumberToWrite;
+
+        int mNumWritten;
+        int mNumDropped;
+
+        SimpleVector<FrameCaptureThread*> mThreads;
+    };
+
+
+
+class FrameCaptureThread : public Thread {
+
+    public:
+
+        FrameCaptureThread( FrameCapture *inCapture )
+                : mCapture( inCapture ) {
+            start();
+            }
+
+        ~FrameCaptureThread() {
+            join();
+            }
+
+        void run() {
+            while( mCapture->processNextFrame() ) {
+                }
+            }
+
+    protected:
+        FrameCapture *mCapture;
+    };
+
+
+
+#endif
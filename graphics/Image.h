@@ -446,6 +446,8 @@ inline void Image::filter( ChannelFilter *inFilter, int inChannel ) {
 		// now paste filtered channel back into selected region
 		mSelection = tempSelection;
 		pasteChannel( filteredChannel, inChannel );
+		
+		delete [] filteredChannel;
 		}
 	}
 		
@@ -0,0 +1,355 @@
+#include "ImageFilterEngine.h"
+
+#include "minorGems/graphics/filters/MultiFilter.h"
+
+#include <string.h>
+
+
+
+// values per block when fusing per-pixel filters, small enough to stay
+// in the first-level cache between filters
+static const int pixelBlockLength = 2048;
+
+// values per band when fusing per-pixel filters
+static const int pixelBandLength = 65536;
+
+
+
+ImageFilterEngine::ImageFilterEngine( int inNumThreads )
+        : mSpareChannelSize( 0 ),
+          mPool( inNumThreads ),
+          mJobFilters( NULL ), mJobNumFilters( 0 ), mJobRadius( 0 ),
+          mJobChannels( NULL ), mJobDestChannels( NULL ),
+          mJobWidth( 0 ), mJobHeight( 0 ),
+          mJobBandHeight( 0 ), mJobNumBands( 0 ) {
+
+    int numWorkers = mPool.getNumThreads() + 1;
+
+    mScratch = new ImageFilterScratch[ numWorkers ];
+
+    for( int i=0; i<numWorkers; i++ ) {
+        mScratch[i].values = NULL;
+        mScratch[i].size = 0;
+        }
+    }
+
+
+
+ImageFilterEngine::~ImageFilterEngine() {
+    for( int i=0; i<mSpareChannels.size(); i++ ) {
+        delete [] mSpareChannels.getElementDirect( i );
+        }
+
+    for( int i=0; i<mPool.getNumThreads() + 1; i++ ) {
+        if( mScratch[i].values != NULL ) {
+            delete [] mScratch[i].values;
+            }
+        }
+    delete [] mScratch;
+    }
+
+
+
+void ImageFilterEngine::filter( Image *inImage, ChannelFilter *inFilter ) {
+    int numChannels = inImage->getNumChannels();
+
+    int *channels = new int[ numChannels ];
+    for( int c=0; c<numChannels; c++ ) {
+        channels[c] = c;
+        }
+
+    filterChannels( inImage, inFilter, channels, numChannels );
+
+    delete [] channels;
+    }
+
+
+
+void ImageFilterEngine::filter( Image *inImage, ChannelFilter *inFilter,
+                                int inChannel ) {
+    filterChannels( inImage, inFilter, &inChannel, 1 );
+    }
+
+
+
+// adds inFilter to outFilters, or the filters inside it if it is a
+// MultiFilter
+static void flattenFilter( ChannelFilter *inFilter,
+                           SimpleVector<ChannelFilter*> *outFilters ) {
+
+    MultiFilter *multi = dynamic_cast<MultiFilter*>( inFilter );
+
+    if( multi == NULL ) {
+        outFilters->push_back( inFilter );
+        return;
+        }
+
+    for( int i=0; i<multi->getNumFilters(); i++ ) {
+        flattenFilter( multi->getFilter( i ), outFilters );
+        }
+    }
+
+
+
+void ImageFilterEngine::filterChannels( Image *inImage,
+                                        ChannelFilter *inFilter,
+                                        int *inChannels,
+                                        int inNumChannels ) {
+
+    int width = inImage->getWidth();
+    int height = inImage->getHeight();
+    int numPixels = width * height;
+
+    SimpleVector<ChannelFilter*> filterVector;
+    flattenFilter( inFilter, &filterVector );
+
+    int numFilters = filterVector.size();
+
+    if( numPixels == 0 || numFilters == 0 || inNumChannels == 0 ) {
+        return;
+        }
+
+    ChannelFilter **filters = filterVector.getElementArray();
+
+
+    // with a selection, filter whole copies and paste them back through
+    // the selection, as Image::filter does
+    char selected = ( inImage->getSelection() != NULL );
+
+    double **imageChannels = new double*[ inNumChannels ];
+    double **channels = new double*[ inNumChannels ];
+    double **otherChannels = new double*[ inNumChannels ];
+
+    for( int c=0; c<inNumChannels; c++ ) {
+        imageChannels[c] = inImage->getChannel( inChannels[c] );
+
+        if( selected ) {
+            // copyChannel would apply the selection to the copy
+            double *copy = new double[ numPixels ];
+            memcpy( copy, imageChannels[c], numPixels * sizeof( double ) );
+            imageChannels[c] = copy;
+            }
+        channels[c] = imageChannels[c];
+        otherChannels[c] = NULL;
+        }
+
+
+    int f = 0;
+    while( f < numFilters ) {
+
+        // longest run of filters with known radii
+        int radius = filters[f]->getNeighborhoodRadius();
+        int runLength = 1;
+
+        if( radius >= 0 ) {
+            while( f + runLength < numFilters ) {
+                int nextRadius =
+                    filters[ f + runLength ]->getNeighborhoodRadius();
+
+                if( nextRadius < 0 ) {
+                    break;
+                    }
+                radius += nextRadius;
+                runLength++;
+                }
+            }
+
+        if( radius < 0 ) {
+            // whole channels, in place
+            runPass( &( filters[f] ), 1, -1, channels, NULL,
+                     inNumChannels, width, height, height );
+            }
+        else if( radius == 0 ) {
+            // fused blocks, in place
+            int bandHeight = pixelBandLength / width;
+            if( bandHeight < 1 ) {
+                bandHeight = 1;
+                }
+
+            runPass( &( filters[f] ), runLength, 0, channels, NULL,
+                     inNumChannels, width, height, bandHeight );
+            }
+        else {
+            // bands, written to the other buffer
+            if( otherChannels[0] == NULL ) {
+                if( mSpareChannelSize != numPixels ) {
+                    for( int i=0; i<mSpareChannels.size(); i++ ) {
+                        delete [] mSpareChannels.getElementDirect( i );
+                        }
+                    mSpareChannels.deleteAll();
+                    mSpareChannelSize = numPixels;
+                    }
+                while( mSpareChannels.size() < inNumChannels ) {
+                    mSpareChannels.push_back( new double[ numPixels ] );
+                    }
+
+                for( int c=0; c<inNumChannels; c++ ) {
+                    otherChannels[c] = mSpareChannels.getElementDirect( c );
+                    }
+                }
+
+            // halo rows are a growing share of each band as it gets
+            // shorter
+            int bandHeight = 8 * radius;
+            if( bandHeight < 32 ) {
+                bandHeight = 32;
+                }
+
+            runPass( &( filters[f] ), runLength, radius, channels,
+                     otherChannels, inNumChannels, width, height,
+                     bandHeight );
+
+            for( int c=0; c<inNumChannels; c++ ) {
+                double *temp = channels[c];
+                channels[c] = otherChannels[c];
+                otherChannels[c] = temp;
+                }
+            }
+
+        f += runLength;
+        }
+
+
+    if( selected ) {
+        for( int c=0; c<inNumChannels; c++ ) {
+            inImage->pasteChannel( channels[c], inChannels[c] );
+            delete [] imageChannels[c];
+            }
+        }
+    else if( channels[0] != imageChannels[0] ) {
+        // every channel took the same number of swaps, so all results
+        // are in spare buffers
+        runPass( NULL, 0, 0, channels, imageChannels,
+                 inNumChannels, width, height,
+                 pixelBandLength / width + 1 );
+        }
+
+    delete [] imageChannels;
+    delete [] channels;
+    delete [] otherChannels;
+    delete [] filters;
+    }
+
+
+
+void ImageFilterEngine::runPass( ChannelFilter **inFilters,
+                                 int inNumFilters, int inRadius,
+                                 double **inChannels,
+                                 double **inDestChannels, int inNumChannels,
+                                 int inWidth, int inHeight,
+                                 int inBandHeight ) {
+
+    int numBands = ( inHeight + inBandHeight - 1 ) / inBandHeight;
+
+    mJobFilters = inFilters;
+    mJobNumFilters = inNumFilters;
+    mJobRadius = inRadius;
+    mJobChannels = inChannels;
+    mJobDestChannels = inDestChannels;
+    mJobWidth = inWidth;
+    mJobHeight = inHeight;
+    mJobBandHeight = inBandHeight;
+    mJobNumBands = numBands;
+
+    mPool.runJobs( this, inNumChannels * numBands );
+
+    mJobFilters = NULL;
+    mJobChannels = NULL;
+    mJobDestChannels = NULL;
+    }
+
+
+
+void ImageFilterEngine::runJob( int inJobIndex, int inWorkerIndex ) {
+    filterBand( inJobIndex / mJobNumBands, inJobIndex % mJobNumBands,
+                &( mScratch[ inWorkerIndex ] ) );
+    }
+
+
+
+void ImageFilterEngine::filterBand( int inChannelIndex, int inBand,
+                                    ImageFilterScratch *inScratch ) {
+
+    int width = mJobWidth;
+    int height = mJobHeight;
+
+    int startY = inBand * mJobBandHeight;
+    int endY = startY + mJobBandHeight;
+    if( endY > height ) {
+        endY = height;
+        }
+
+    double *channel = mJobChannels[ inChannelIndex ];
+
+
+    if( mJobDestChannels == NULL ) {
+
+        if( mJobRadius < 0 ) {
+            // band is the whole channel
+            for( int f=0; f<mJobNumFilters; f++ ) {
+                mJobFilters[f]->apply( channel, width, height );
+                }
+            return;
+            }
+
+        // run every filter over each block before moving to the next
+        double *values = &( channel[ startY * width ] );
+        int numValues = ( endY - startY ) * width;
+
+        for( int i=0; i<numValues; i += pixelBlockLength ) {
+            int blockLength = numValues - i;
+            if( blockLength > pixelBlockLength ) {
+                blockLength = pixelBlockLength;
+                }
+
+            for( int f=0; f<mJobNumFilters; f++ ) {
+                mJobFilters[f]->apply( &( values[i] ), blockLength, 1 );
+                }
+            }
+        return;
+        }
+
+
+    double *dest = mJobDestChannels[ inChannelIndex ];
+
+    if( mJobNumFilters == 0 ) {
+        memcpy( &( dest[ startY * width ] ), &( channel[ startY * width ] ),
+                ( endY - startY ) * width * sizeof( double ) );
+        return;
+        }
+
+    // band plus enough rows around it for the whole run, cut off at
+    // the channel edges, which the filters handle themselves
+    int haloStartY = startY - mJobRadius;
+    if( haloStartY < 0 ) {
+        haloStartY = 0;
+        }
+    int haloEndY = endY + mJobRadius;
+    if( haloEndY > height ) {
+        haloEndY = height;
+        }
+
+    int haloHeight = haloEndY - haloStartY;
+    int neededSize = haloHeight * width;
+
+    if( inScratch->size < neededSize ) {
+        if( inScratch->values != NULL ) {
+            delete [] inScratch->values;
+            }
+        inScratch->values = new double[ neededSize ];
+        inScratch->size = neededSize;
+        }
+
+    double *values = inScratch->values;
+
+    memcpy( values, &( channel[ haloStartY * width ] ),
+            neededSize * sizeof( double ) );
+
+    for( int f=0; f<mJobNumFilters; f++ ) {
+        mJobFilters[f]->apply( values, width, haloHeight );
+        }
+
+    memcpy( &( dest[ startY * width ] ),
+            &( values[ ( startY - haloStartY ) * width ] ),
+            ( endY - startY ) * width * sizeof( double ) );
+    }
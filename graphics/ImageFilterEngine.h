@@ -0,0 +1,149 @@
+#ifndef IMAGE_FILTER_ENGINE_INCLUDED
+#define IMAGE_FILTER_ENGINE_INCLUDED
+
+
+#include "minorGems/graphics/Image.h"
+#include "minorGems/graphics/ChannelFilter.h"
+
+#include "minorGems/system/WorkerPool.h"
+#include "minorGems/util/SimpleVector.h"
+
+
+
+// scratch space for one thread's bands
+typedef struct ImageFilterScratch {
+        double *values;
+        int size;
+    } ImageFilterScratch;
+
+
+
+/**
+ * Applies ChannelFilters to Images the same way Image::filter does, but
+ * in pieces spread across a pool of worker threads.
+ *
+ * MultiFilter chains are flattened and cut into runs of filters that
+ * report a neighborhood radius (see ChannelFilter::getNeighborhoodRadius):
+ *
+ * Runs of per-pixel filters (radius 0) are fused, with the whole run
+ * applied to one cache-sized block of values before moving on to the
+ * next, so the channel is read once rather than once per filter.
+ *
+ * Other runs are applied to bands of rows, each copied out along with
+ * enough rows above and below to cover the radii of the whole run, and
+ * only the middle rows of each band are kept.
+ *
+ * Filters with radius -1 are applied to whole channels.
+ *
+ * Every channel of every band is a separate job, so channels are filtered
+ * in parallel too.
+ *
+ * Results match Image::filter, except for rounding in filters that sum
+ * over the whole channel, like BoxBlurFilter.
+ *
+ * @author Jason Rohrer
+ */
+class ImageFilterEngine : public WorkerPoolTask {
+
+    public:
+
+        /**
+         * Constructs an engine.
+         *
+         * @param inNumThreads the number of worker threads to start.  The
+         *   calling thread works too, so 0 filters everything on the
+         *   calling thread.  -1 picks one fewer than the number of
+         *   processors.  Defaults to -1.
+         */
+        ImageFilterEngine( int inNumThreads = -1 );
+
+        ~ImageFilterEngine();
+
+
+
+        /**
+         * Filters all channels of an image, as Image::filter.
+         *
+         * Not safe to call from several threads at once.
+         *
+         * @param inImage the image to filter.
+         *   Destroyed by caller.
+         * @param inFilter the filter to apply.  Must not be changed until
+         *   this call returns.
+         *   Destroyed by caller.
+         */
+        void filter( Image *inImage, ChannelFilter *inFilter );
+
+
+
+        /**
+         * Filters one channel of an image, as Image::filter.
+         *
+         * @param inImage the image to filter.
+         *   Destroyed by caller.
+         * @param inFilter the filter to apply.
+         *   Destroyed by caller.
+         * @param inChannel the channel to filter.
+         */
+        void filter( Image *inImage, ChannelFilter *inFilter,
+                     int inChannel );
+
+
+
+        // implements the WorkerPoolTask interface
+        // filters one band of one channel of the current pass
+        void runJob( int inJobIndex, int inWorkerIndex );
+
+
+
+    protected:
+
+        // channel-sized buffers that bands are written into, reused
+        // between calls
+        SimpleVector<double*> mSpareChannels;
+        int mSpareChannelSize;
+
+        WorkerPool mPool;
+
+        // one for each worker, indexed as by WorkerPoolTask::runJob, so
+        // the calling thread uses the first
+        ImageFilterScratch *mScratch;
+
+
+        // the current pass:  inFilters applied to each channel in
+        // mJobChannels, band by band, results written to mJobDestChannels,
+        // or in place if NULL
+        ChannelFilter **mJobFilters;
+        int mJobNumFilters;
+        int mJobRadius;
+
+        double **mJobChannels;
+        double **mJobDestChannels;
+        int mJobWidth;
+        int mJobHeight;
+
+        int mJobBandHeight;
+        int mJobNumBands;
+
+
+
+        void filterChannels( Image *inImage, ChannelFilter *inFilter,
+                             int *inChannels, int inNumChannels );
+
+
+        // runs a pass over all bands of all channels, returning once
+        // every band is done
+        void runPass( ChannelFilter **inFilters, int inNumFilters,
+                      int inRadius, double **inChannels,
+                      double **inDestChannels, int inNumChannels,
+                      int inWidth, int inHeight, int inBandHeight );
+
+
+        void filterBand( int inChannelIndex, int inBand,
+                         ImageFilterScratch *inScratch );
+
+    };
+
+
+
+#endif
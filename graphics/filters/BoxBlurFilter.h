@@ -59,6 +59,10 @@ class BoxBlurFilter : public ChannelFilter {
 		
 		// implements the ChannelFilter interface
 		void apply( double *inChannel, int inWidth, int inHeight );
+		
+		int getNeighborhoodRadius() {
+			return mRadius;
+			}
 
 	private:
 		int mRadius;
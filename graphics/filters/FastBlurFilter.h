@@ -25,6 +25,10 @@ class FastBlurFilter : public ChannelFilter {
         // implements the ChannelFilter interface
         void apply( double *inChannel, int inWidth, int inHeight );
 
+        int getNeighborhoodRadius() {
+            return 1;
+            }
+
     };
         
     
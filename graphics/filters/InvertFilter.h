@@ -22,6 +22,10 @@ class InvertFilter : public ChannelFilter {
 		
 		// implements the ChannelFilter interface
 		void apply( double *inChannel, int inWidth, int inHeight );
+		
+		int getNeighborhoodRadius() {
+			return 0;
+			}
 	};
 	
 	
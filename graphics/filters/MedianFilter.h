@@ -60,6 +60,10 @@ class MedianFilter : public ChannelFilter {
   // implements the ChannelFilter interface
   void apply( double *inChannel, int inWidth, int inHeight );
 
+  int getNeighborhoodRadius() {
+    return mRadius;
+  }
+
  private:
   int mRadius;
 };
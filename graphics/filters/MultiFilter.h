@@ -48,8 +48,28 @@ class MultiFilter : public ChannelFilter {
 		void removeFilter( ChannelFilter *inFilter );
 		
 		
+		/**
+		 * Gets the number of filters in this MultiFilter.
+		 */
+		int getNumFilters();
+		
+		
+		/**
+		 * Gets a filter.
+		 *
+		 * @param inIndex the index of the filter, in the order
+		 *   filters are applied.
+		 *
+		 * @return the filter.  Is not destroyed by caller.
+		 */
+		ChannelFilter *getFilter( int inIndex );
+		
+		
 		// implements the ChannelFilter interface
 		void apply( double *inChannel, int inWidth, int inHeight );
+		
+		// sum of the radii of the filters, or -1 if any are -1
+		int getNeighborhoodRadius();
 	
 	
 	private:
@@ -72,6 +92,30 @@ inline MultiFilter::~MultiFilter() {
 	
 		
 	
+inline void MultiFilter::addFilter( ChannelFilter *inFilter ) {
+	mFilterVector->push_back( inFilter );
+	}
+
+
+
+inline void MultiFilter::removeFilter( ChannelFilter *inFilter ) {
+	mFilterVector->deleteElementEqualTo( inFilter );
+	}
+
+
+
+inline int MultiFilter::getNumFilters() {
+	return mFilterVector->size();
+	}
+
+
+
+inline ChannelFilter *MultiFilter::getFilter( int inIndex ) {
+	return *( mFilterVector->getElement( inIndex ) );
+	}
+	
+		
+	
 inline void MultiFilter::apply( double *inChannel, 
 	int inWidth, int inHeight ) {
 	
@@ -81,6 +125,25 @@ inline void MultiFilter::apply( double *inChannel,
 		thisFilter->apply( inChannel, inWidth, inHeight );
 		}
 	}
+
+
+
+inline int MultiFilter::getNeighborhoodRadius() {
+	int radius = 0;
+	
+	int numFilters = mFilterVector->size();
+	for( int i=0; i<numFilters; i++ ) {
+		ChannelFilter *thisFilter = *( mFilterVector->getElement( i ) );
+		int filterRadius = thisFilter->getNeighborhoodRadius();
+		
+		if( filterRadius < 0 ) {
+			return -1;
+			}
+		radius += filterRadius;
+		}
+	
+	return radius;
+	}
 	
 	
 	
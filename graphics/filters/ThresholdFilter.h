@@ -42,6 +42,10 @@ class ThresholdFilter : public ChannelFilter {
 		
 		// implements the ChannelFilter interface
 		void apply( double *inChannel, int inWidth, int inHeight );
+		
+		int getNeighborhoodRadius() {
+			return 0;
+			}
 
 	private:
 		double mThreshold;
@@ -0,0 +1,62 @@
+// offscreen software GL surface used for headless playback benchmarking
+// (no display or window system needed)
+//
+// included directly by ScreenGL_SDL.cpp when HEADLESS_OSMESA is defined
+// link with -lOSMesa
+
+#include <GL/osmesa.h>
+
+#include <stdlib.h>
+
+
+
+
+static OSMesaContext osMesaContext = NULL;
+static unsigned char *osMesaBuffer = NULL;
+
+
+
+// returns true on success
+static char osMesaCreateSurface( int inWidth, int inHeight ) {
+    
+    // 24-bit depth buffer, 1-bit (or more) stencil, no accumulation buffer
+    osMesaContext = OSMesaCreateContextExt( OSMESA_RGBA, 24, 8, 0, NULL );
+    
+    if( osMesaContext == NULL ) {
+        return false;
+        }
+    
+    osMesaBuffer = new unsigned char[ inWidth * inHeight * 4 ];
+    
+    if( ! OSMesaMakeCurrent( osMesaContext, osMesaBuffer, GL_UNSIGNED_BYTE,
+                             inWidth, inHeight ) ) {
+        OSMesaDestroyContext( osMesaContext );
+        osMesaContext = NULL;
+        
+        delete [] osMesaBuffer;
+        osMesaBuffer = NULL;
+        return false;
+        }
+    
+    return true;
+    }
+
+
+
+// there is only one buffer, so a swap just means finishing the frame
+static void osMesaSwapBuffers() {
+    glFinish();
+    }
+
+
+
+static void osMesaReleaseSurface() {
+    if( osMesaContext != NULL ) {
+        OSMesaDestroyContext( osMesaContext );
+        osMesaContext = NULL;
+        }
+    if( osMesaBuffer != NULL ) {
+        delete [] osMesaBuffer;
+        osMesaBuffer = NULL;
+        }
+    }
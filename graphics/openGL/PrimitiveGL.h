@@ -51,6 +51,7 @@
 
 #include <GL/gl.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "TextureGL.h"
 #include "LightingGL.h"
@@ -62,18 +63,35 @@
 
 #include "minorGems/graphics/openGL/NoLightingGL.h"
 
-// try and include extensions if multitexture isn't
+// try and include extensions if multitexture or buffer objects aren't
 // built-in to gl.h
-#ifndef GL_ARB_multitexture
+#if !defined( GL_ARB_multitexture ) || \
+    !defined( GL_ARB_vertex_buffer_object )
 #include <GL/glext.h>
 #endif
 
+
+// buffer object functions are looked up at runtime, since many gl.h
+// headers and GL libraries (Windows) don't provide them directly
+#ifdef WIN32
+#define getPrimitiveGLProcAddress( inName ) wglGetProcAddress( inName )
+#else
+#include <dlfcn.h>
+#define getPrimitiveGLProcAddress( inName ) dlsym( RTLD_DEFAULT, inName )
+#endif
+
  
 /**
  * OpenGL primitive object.
  *
  * Comprised of a triangle mesh, texture map, and anchor points.
  *
+ * The mesh is drawn as one indexed triangle strip from the primitive's
+ * packed vertex arrays.  Where buffer objects are supported, vertices,
+ * anchors, and indices are kept in buffers on the card and uploaded
+ * again only when the mesh changes.  Lighting is computed on the CPU,
+ * so per-vertex colors are rebuilt every draw.
+ *
  * @author Jason Rohrer 
  */
 class PrimitiveGL { 
@@ -173,6 +191,26 @@ class PrimitiveGL {
 		virtual void stopAnimation( int inAnimationIndex );
 
 		
+		/**
+		 * Gets whether buffer objects are used to hold vertex data.
+		 * 
+		 * Only valid after the first draw.
+		 *
+		 * @return true if buffer objects are supported.
+		 */
+		static char isBufferObjectSupported();
+		
+		
+		/**
+		 * Turns the use of buffer objects off, even if they are 
+		 * supported, mostly for testing.  Takes effect at the next
+		 * draw.
+		 *
+		 * @param inDisable true to draw straight from the packed arrays.
+		 */
+		static void disableBufferObjects( char inDisable );
+		
+		
 	protected:
 		
 		Primitive3D *mPrimitive;
@@ -180,17 +218,75 @@ class PrimitiveGL {
 		TextureGL *mTextureGL;
 		
 		
+		// 0 until buffers have been created
+		GLuint mVertexBuffer;
+		GLuint mIndexBuffer;
+		GLuint mColorBuffer;
+		// one for each texture layer
+		GLuint *mAnchorBuffers;
+		
+		// r, g, b, a lighting color for each vertex, refilled
+		// each draw
+		float *mColors;
+		long mNumColors;
+		
+		
 		// Equivalent to the public draw(), but does manual multi-texturing
 		// by multi-pass rendering.  Does not depend on ARB calls.
 		void drawNoMultitexture( Transform3D *inTransform, 
 			LightingGL *inLighting );
 		
+		
+		// draws the strip with anchors from the first 
+		// inNumTextureLayers layers
+		void drawStrip( Transform3D *inTransform, LightingGL *inLighting,
+			int inNumTextureLayers );
+		
+		
+		// fills mColors with the lighting for each vertex, 
+		// after inTransform
+		void computeLighting( Transform3D *inTransform, 
+			LightingGL *inLighting );
+		
+		
+		// packs the primitive's vertex data again if it has changed,
+		// and uploads it to our buffers
+		void updateBuffers();
+		
+		void deleteBuffers();
+		
+		
+		static char sBufferObjectsChecked;
+		static char sBufferObjectsSupported;
+		static char sBufferObjectsDisabled;
+		
+		static PFNGLGENBUFFERSARBPROC sGenBuffers;
+		static PFNGLDELETEBUFFERSARBPROC sDeleteBuffers;
+		static PFNGLBINDBUFFERARBPROC sBindBuffer;
+		static PFNGLBUFFERDATAARBPROC sBufferData;
+		
+		// looks up the buffer object functions
+		static void checkBufferObjects();
+		
 	};
 
 
 
+// initialize static members
+char PrimitiveGL::sBufferObjectsChecked = false;
+char PrimitiveGL::sBufferObjectsSupported = false;
+char PrimitiveGL::sBufferObjectsDisabled = false;
+PFNGLGENBUFFERSARBPROC PrimitiveGL::sGenBuffers = NULL;
+PFNGLDELETEBUFFERSARBPROC PrimitiveGL::sDeleteBuffers = NULL;
+PFNGLBINDBUFFERARBPROC PrimitiveGL::sBindBuffer = NULL;
+PFNGLBUFFERDATAARBPROC PrimitiveGL::sBufferData = NULL;
+
+
+
 inline PrimitiveGL::PrimitiveGL( Primitive3D *inPrimitive ) 
-	: mPrimitive( inPrimitive ) {
+	: mPrimitive( inPrimitive ),
+	mVertexBuffer( 0 ), mIndexBuffer( 0 ), mColorBuffer( 0 ),
+	mAnchorBuffers( NULL ), mColors( NULL ), mNumColors( 0 ) {
 	
 	
 	int numTextures = mPrimitive->mNumTextures;	
@@ -209,223 +305,240 @@ inline PrimitiveGL::PrimitiveGL( Primitive3D *inPrimitive )
 
 
 inline PrimitiveGL::~PrimitiveGL() {
+	deleteBuffers();
+	
+	if( mColors != NULL ) {
+		delete [] mColors;
+		}
+	
 	delete mPrimitive;
 	delete mTextureGL;
 	}
 
 
 
-// this is the ARB version of draw
-inline void PrimitiveGL::draw( Transform3D *inTransform, 
-	LightingGL *inLighting ) {
+inline void PrimitiveGL::deleteBuffers() {
+	if( mVertexBuffer != 0 ) {
+		sDeleteBuffers( 1, &mVertexBuffer );
+		sDeleteBuffers( 1, &mIndexBuffer );
+		sDeleteBuffers( 1, &mColorBuffer );
+		sDeleteBuffers( mTextureGL->getNumLayers(), mAnchorBuffers );
+		
+		delete [] mAnchorBuffers;
+		mAnchorBuffers = NULL;
+		
+		mVertexBuffer = 0;
+		mIndexBuffer = 0;
+		mColorBuffer = 0;
+		}
+	}
+
+
+
+inline char PrimitiveGL::isBufferObjectSupported() {
+	return sBufferObjectsSupported;
+	}
+
+
+
+inline void PrimitiveGL::disableBufferObjects( char inDisable ) {
+	sBufferObjectsDisabled = inDisable;
 	
-	// check for multi-texture availability before proceeding
-	if( !TextureGL::isMultiTexturingSupported() ) {
-		drawNoMultitexture( inTransform, inLighting );
+	// check again at next draw
+	sBufferObjectsChecked = false;
+	}
+
+
+
+inline void PrimitiveGL::checkBufferObjects() {
+	sBufferObjectsChecked = true;
+	sBufferObjectsSupported = false;
+	
+	if( sBufferObjectsDisabled ) {
 		return;
 		}
 	
-	// first, copy the vertices and translate/rotate/scale them
-	Vector3D **worldVertices = new Vector3D*[ mPrimitive->mNumVertices ];
-	Vector3D **worldNormals = new Vector3D*[ mPrimitive->mNumVertices ]; 
-	for( int i=0; i<mPrimitive->mNumVertices; i++ ) {
-		// copy
-		worldVertices[i] = new Vector3D( mPrimitive->mVertices[i] );
-		worldNormals[i] = new Vector3D( mPrimitive->mNormals[i] );
-		
-		// translate/rotate/scale
-		inTransform->apply( worldVertices[i] );
-		
-		// only rotate normals
-		inTransform->applyNoTranslation( worldNormals[i] );
-		// normalize to get rid of any scaling
-		worldNormals[i]->normalize();
-		} 
-	
+	// core in 1.5, otherwise check for the ARB extension
+	const char *version = (const char *)glGetString( GL_VERSION );
+	const char *extensions = (const char *)glGetString( GL_EXTENSIONS );
 	
-	// now draw vertices as triangle strips
+	int major = 0;
+	int minor = 0;
+	char isCore = false;
+	if( version != NULL && sscanf( version, "%d.%d", &major, &minor ) == 2 ) {
+		isCore = ( major > 1 || ( major == 1 && minor >= 5 ) );
+		}
 	
-	mTextureGL->enable();
-	int numTextureLayers = mTextureGL->getNumLayers();
-	int t;
+	char isExtension = 
+		( extensions != NULL && 
+		  strstr( extensions, "GL_ARB_vertex_buffer_object" ) != NULL );
 	
-	if( mPrimitive->isTransparent() ) {
-		glEnable( GL_BLEND );
-		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+	if( isCore ) {
+		sGenBuffers = (PFNGLGENBUFFERSARBPROC)
+			getPrimitiveGLProcAddress( "glGenBuffers" );
+		sDeleteBuffers = (PFNGLDELETEBUFFERSARBPROC)
+			getPrimitiveGLProcAddress( "glDeleteBuffers" );
+		sBindBuffer = (PFNGLBINDBUFFERARBPROC)
+			getPrimitiveGLProcAddress( "glBindBuffer" );
+		sBufferData = (PFNGLBUFFERDATAARBPROC)
+			getPrimitiveGLProcAddress( "glBufferData" );
 		}
-	else {
-		glDisable( GL_BLEND );
+	else if( isExtension ) {
+		sGenBuffers = (PFNGLGENBUFFERSARBPROC)
+			getPrimitiveGLProcAddress( "glGenBuffersARB" );
+		sDeleteBuffers = (PFNGLDELETEBUFFERSARBPROC)
+			getPrimitiveGLProcAddress( "glDeleteBuffersARB" );
+		sBindBuffer = (PFNGLBINDBUFFERARBPROC)
+			getPrimitiveGLProcAddress( "glBindBufferARB" );
+		sBufferData = (PFNGLBUFFERDATAARBPROC)
+			getPrimitiveGLProcAddress( "glBufferDataARB" );
 		}
 	
-	if( mPrimitive->isBackVisible() ) {
-		glDisable( GL_CULL_FACE );
+	sBufferObjectsSupported = 
+		( sGenBuffers != NULL && sDeleteBuffers != NULL &&
+		  sBindBuffer != NULL && sBufferData != NULL );
+	}
+
+
+
+inline void PrimitiveGL::updateBuffers() {
+	char changed = mPrimitive->updatePackedArrays();
+	
+	long numVertices = mPrimitive->mNumVertices;
+	
+	if( mColors == NULL || mNumColors != numVertices ) {
+		if( mColors != NULL ) {
+			delete [] mColors;
+			}
+		mNumColors = numVertices;
+		mColors = new float[ 4 * mNumColors ];
 		}
-	else {
-		glEnable( GL_CULL_FACE );
-		glCullFace( GL_BACK );
-		glFrontFace( GL_CCW );
-		}	
-		
 	
-	Color *lightColor = new Color( 0, 0, 0, 1.0 );
-	
-	// for each strip of triangles
-	for( int y=0; y<mPrimitive->mHigh-1; y++ ) {
-		// note that we skip the last row of verts, since they are the bottom
-		// of the last strip.
-		
-		int thisRow = y * mPrimitive->mWide;
-		int nextRow = ( y + 1 ) * mPrimitive->mWide;
-		
-		glBegin( GL_TRIANGLE_STRIP );
-			// draw first triangle
-			
-			// first vert in next row
-			int index = nextRow + 0;
-			
-			inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-			glColor4f( lightColor->r, lightColor->g, lightColor->b, 1.0 );
-			
-			// pass in each layer's anchor points
-			for(  t=0; t<numTextureLayers; t++ ) {
-				glMultiTexCoord2fARB( TextureGL::sMultiTextureEnum[t],
-					mPrimitive->mAnchorX[t][ index ], 
-					mPrimitive->mAnchorY[t][ index ] );
-				}
-	    	glVertex3d( worldVertices[index]->mX, 
-				worldVertices[index]->mY, worldVertices[index]->mZ );
-			
-			index = thisRow + 0;
-			
-			inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-			glColor4f( lightColor->r, lightColor->g, lightColor->b, 1.0 );
-			
-			// pass in each layer's anchor points
-			for(  t=0; t<numTextureLayers; t++ ) {
-				glMultiTexCoord2fARB( TextureGL::sMultiTextureEnum[t],
-					mPrimitive->mAnchorX[t][ index ], 
-					mPrimitive->mAnchorY[t][ index ] );
-				}
-	    	glVertex3d( worldVertices[index]->mX, 
-				worldVertices[index]->mY, worldVertices[index]->mZ );
-			
-			index = nextRow + 1;
-			
-			inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-			glColor4f( lightColor->r, lightColor->g, lightColor->b, 1.0 );
-			
-			// pass in each layer's anchor points
-			for(  t=0; t<numTextureLayers; t++ ) {
-				glMultiTexCoord2fARB( TextureGL::sMultiTextureEnum[t],
-					mPrimitive->mAnchorX[t][ index ], 
-					mPrimitive->mAnchorY[t][ index ] );
-				}
-	    	glVertex3d( worldVertices[index]->mX, 
-				worldVertices[index]->mY, worldVertices[index]->mZ );
-			
-			// draw next vertex to complete first "rectangle"
-			
-			index = thisRow + 1;
-			
-			inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-			glColor4f( lightColor->r, lightColor->g, lightColor->b, 1.0 );
-			
-			// pass in each layer's anchor points
-			for(  t=0; t<numTextureLayers; t++ ) {
-				glMultiTexCoord2fARB( TextureGL::sMultiTextureEnum[t],
-					mPrimitive->mAnchorX[t][ index ], 
-					mPrimitive->mAnchorY[t][ index ] );
-				}
-	    	glVertex3d( worldVertices[index]->mX, 
-				worldVertices[index]->mY, worldVertices[index]->mZ );
-			
-			
-			// then add rest of vertices as part of strip
-			for( int x=2; x<mPrimitive->mWide; x++ ) {
-				
-				// every additional pair of vertices completes
-				// another "rectangle"
-				index = nextRow + x;
-				
-				inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-				glColor4f( lightColor->r, lightColor->g, 
-					lightColor->b, 1.0 );
-			
-				// pass in each layer's anchor points
-				for(  t=0; t<numTextureLayers; t++ ) {
-					glMultiTexCoord2fARB( TextureGL::sMultiTextureEnum[t],
-						mPrimitive->mAnchorX[t][ index ], 
-						mPrimitive->mAnchorY[t][ index ] );
-					}
-	    		glVertex3d( worldVertices[index]->mX, 
-					worldVertices[index]->mY, worldVertices[index]->mZ );
-
-				index = thisRow + x;
-
-				inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-				glColor4f( lightColor->r, lightColor->g, 
-					lightColor->b, 1.0 );
-
-				// pass in each layer's anchor points
-				for(  t=0; t<numTextureLayers; t++ ) {
-					glMultiTexCoord2fARB( TextureGL::sMultiTextureEnum[t],
-						mPrimitive->mAnchorX[t][ index ], 
-						mPrimitive->mAnchorY[t][ index ] );
-					}
-	    		glVertex3d( worldVertices[index]->mX, 
-					worldVertices[index]->mY, worldVertices[index]->mZ );
-				}
-		glEnd();		
+	if( !sBufferObjectsSupported ) {
+		if( changed ) {
+			// buffers left from before buffer objects were disabled
+			// are now out of date
+			deleteBuffers();
+			}
+		return;
 		}
 	
+	int numTextureLayers = mTextureGL->getNumLayers();
 	
-	mTextureGL->disable();
+	if( mVertexBuffer == 0 ) {
+		sGenBuffers( 1, &mVertexBuffer );
+		sGenBuffers( 1, &mIndexBuffer );
+		sGenBuffers( 1, &mColorBuffer );
+		
+		mAnchorBuffers = new GLuint[ numTextureLayers ];
+		sGenBuffers( numTextureLayers, mAnchorBuffers );
+		
+		changed = true;
+		}
 	
-	// cleanup
-	for( int i=0; i<mPrimitive->mNumVertices; i++ ) {
-		delete worldVertices[i];
-		delete worldNormals[i];
+	if( !changed ) {
+		return;
 		}
-	delete [] worldVertices;
-	delete [] worldNormals;
-	delete lightColor;
-	}	
 	
+	sBindBuffer( GL_ARRAY_BUFFER_ARB, mVertexBuffer );
+	sBufferData( GL_ARRAY_BUFFER_ARB, 
+				 3 * numVertices * sizeof( float ),
+				 mPrimitive->mPackedVertices, GL_STATIC_DRAW_ARB );
+	
+	for( int t=0; t<numTextureLayers; t++ ) {
+		sBindBuffer( GL_ARRAY_BUFFER_ARB, mAnchorBuffers[t] );
+		sBufferData( GL_ARRAY_BUFFER_ARB, 
+					 2 * numVertices * sizeof( float ),
+					 mPrimitive->mPackedAnchors[t], GL_STATIC_DRAW_ARB );
+		}
+	sBindBuffer( GL_ARRAY_BUFFER_ARB, 0 );
+	
+	sBindBuffer( GL_ELEMENT_ARRAY_BUFFER_ARB, mIndexBuffer );
+	sBufferData( GL_ELEMENT_ARRAY_BUFFER_ARB, 
+				 mPrimitive->mNumStripIndices * sizeof( unsigned int ),
+				 mPrimitive->mStripIndices, GL_STATIC_DRAW_ARB );
+	sBindBuffer( GL_ELEMENT_ARRAY_BUFFER_ARB, 0 );
+	}
 
 
-// this is the non-ARB version of draw
-inline void PrimitiveGL::drawNoMultitexture( Transform3D *inTransform, 
+
+inline void PrimitiveGL::computeLighting( Transform3D *inTransform,
 	LightingGL *inLighting ) {
 	
-	// first, copy the vertices and translate/rotate/scale them
-	Vector3D **worldVertices = new Vector3D*[ mPrimitive->mNumVertices ];
-	Vector3D **worldNormals = new Vector3D*[ mPrimitive->mNumVertices ]; 
-	for( int i=0; i<mPrimitive->mNumVertices; i++ ) {
-		// copy
-		worldVertices[i] = new Vector3D( mPrimitive->mVertices[i] );
-		worldNormals[i] = new Vector3D( mPrimitive->mNormals[i] );
+	double *m = inTransform->getMatrix();
+	
+	float *vertices = mPrimitive->mPackedVertices;
+	float *normals = mPrimitive->mPackedNormals;
+	
+	Vector3D worldVertex( 0, 0, 0 );
+	Vector3D worldNormal( 0, 0, 0 );
+	Color lightColor( 0, 0, 0, 1.0 );
+	
+	long numVertices = mPrimitive->mNumVertices;
+	
+	for( long i=0; i<numVertices; i++ ) {
+		double x = vertices[ 3 * i ];
+		double y = vertices[ 3 * i + 1 ];
+		double z = vertices[ 3 * i + 2 ];
 		
 		// translate/rotate/scale
-		inTransform->apply( worldVertices[i] );
+		worldVertex.mX = m[0] * x + m[1] * y + m[2] * z + m[3];
+		worldVertex.mY = m[4] * x + m[5] * y + m[6] * z + m[7];
+		worldVertex.mZ = m[8] * x + m[9] * y + m[10] * z + m[11];
+		
+		x = normals[ 3 * i ];
+		y = normals[ 3 * i + 1 ];
+		z = normals[ 3 * i + 2 ];
 		
 		// only rotate normals
-		inTransform->applyNoTranslation( worldNormals[i] );
+		worldNormal.mX = m[0] * x + m[1] * y + m[2] * z;
+		worldNormal.mY = m[4] * x + m[5] * y + m[6] * z;
+		worldNormal.mZ = m[8] * x + m[9] * y + m[10] * z;
+		
 		// normalize to get rid of any scaling
-		worldNormals[i]->normalize();
-		} 
+		worldNormal.normalize();
 		
-	Color *lightColor = new Color( 0, 0, 0, 1.0 );
-	
-	// now draw vertices as triangle strips
+		inLighting->getLighting( &worldVertex, &worldNormal, &lightColor );
 		
-	mTextureGL->enable();
+		float *color = &( mColors[ 4 * i ] );
+		color[0] = lightColor.r;
+		color[1] = lightColor.g;
+		color[2] = lightColor.b;
+		color[3] = 1.0;
+		}
+	}
+
+
 
+inline void PrimitiveGL::drawStrip( Transform3D *inTransform, 
+	LightingGL *inLighting, int inNumTextureLayers ) {
+	
+	if( !sBufferObjectsChecked ) {
+		checkBufferObjects();
+		}
+	
+	updateBuffers();
+	
+	computeLighting( inTransform, inLighting );
+	
+	
+	// let GL translate/rotate/scale the vertices
+	// our matrix is row-major, GL's is column-major
+	double *m = inTransform->getMatrix();
+	GLdouble glMatrix[16];
+	for( int row=0; row<4; row++ ) {
+		for( int column=0; column<4; column++ ) {
+			glMatrix[ column * 4 + row ] = m[ row * 4 + column ];
+			}
+		}
+	
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix();
+	glMultMatrixd( glMatrix );
+	
+	
+	mTextureGL->enable();
+	
 	if( mPrimitive->isTransparent() ) {
 		glEnable( GL_BLEND );
 		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
@@ -433,7 +546,7 @@ inline void PrimitiveGL::drawNoMultitexture( Transform3D *inTransform,
 	else {
 		glDisable( GL_BLEND );
 		}
-
+	
 	if( mPrimitive->isBackVisible() ) {
 		glDisable( GL_CULL_FACE );
 		}
@@ -442,117 +555,101 @@ inline void PrimitiveGL::drawNoMultitexture( Transform3D *inTransform,
 		glCullFace( GL_BACK );
 		glFrontFace( GL_CCW );
 		}	
+	
+	
+	char useBuffers = sBufferObjectsSupported;
+	long numVertices = mPrimitive->mNumVertices;
+	
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_COLOR_ARRAY );
+	
+	if( useBuffers ) {
+		sBindBuffer( GL_ARRAY_BUFFER_ARB, mVertexBuffer );
+		glVertexPointer( 3, GL_FLOAT, 0, NULL );
+		
+		// colors change every frame
+		sBindBuffer( GL_ARRAY_BUFFER_ARB, mColorBuffer );
+		sBufferData( GL_ARRAY_BUFFER_ARB, 
+					 4 * numVertices * sizeof( float ),
+					 mColors, GL_STREAM_DRAW_ARB );
+		glColorPointer( 4, GL_FLOAT, 0, NULL );
+		}
+	else {
+		glVertexPointer( 3, GL_FLOAT, 0, mPrimitive->mPackedVertices );
+		glColorPointer( 4, GL_FLOAT, 0, mColors );
+		}
+	
+	int t;
+	for( t=0; t<inNumTextureLayers; t++ ) {
+		if( TextureGL::isMultiTexturingSupported() ) {
+			glClientActiveTextureARB( TextureGL::sMultiTextureEnum[t] );
+			}
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		
+		if( useBuffers ) {
+			sBindBuffer( GL_ARRAY_BUFFER_ARB, mAnchorBuffers[t] );
+			glTexCoordPointer( 2, GL_FLOAT, 0, NULL );
+			}
+		else {
+			glTexCoordPointer( 2, GL_FLOAT, 0, 
+							   mPrimitive->mPackedAnchors[t] );
+			}
+		}
+	
+	if( useBuffers ) {
+		sBindBuffer( GL_ELEMENT_ARRAY_BUFFER_ARB, mIndexBuffer );
+		glDrawElements( GL_TRIANGLE_STRIP, mPrimitive->mNumStripIndices,
+						GL_UNSIGNED_INT, NULL );
+		sBindBuffer( GL_ELEMENT_ARRAY_BUFFER_ARB, 0 );
+		sBindBuffer( GL_ARRAY_BUFFER_ARB, 0 );
+		}
+	else {
+		glDrawElements( GL_TRIANGLE_STRIP, mPrimitive->mNumStripIndices,
+						GL_UNSIGNED_INT, mPrimitive->mStripIndices );
+		}
+	
+	
+	for( t=0; t<inNumTextureLayers; t++ ) {
+		if( TextureGL::isMultiTexturingSupported() ) {
+			glClientActiveTextureARB( TextureGL::sMultiTextureEnum[t] );
+			}
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+		}
+	if( TextureGL::isMultiTexturingSupported() ) {
+		glClientActiveTextureARB( TextureGL::sMultiTextureEnum[0] );
+		}
+	
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	
+	mTextureGL->disable();
+	
+	glPopMatrix();
+	}
 
 
-	// for each strip of triangles
-	for( int y=0; y<mPrimitive->mHigh-1; y++ ) {
-		// note that we skip the last row of verts, since they are the bottom
-		// of the last strip.
-
-		int thisRow = y * mPrimitive->mWide;
-		int nextRow = ( y + 1 ) * mPrimitive->mWide;
-
-		glBegin( GL_TRIANGLE_STRIP );
-			// draw first triangle
-
-			// first vert in next row
-			int index = nextRow + 0;
-
-			inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-			glColor4f( lightColor->r, lightColor->g, lightColor->b, 1.0 );
-
-
-			glTexCoord2d( mPrimitive->mAnchorX[0][ index ], 
-                		mPrimitive->mAnchorY[0][ index ] );
-	    	glVertex3d( worldVertices[index]->mX, 
-				worldVertices[index]->mY, worldVertices[index]->mZ );
-
-			index = thisRow + 0;
-
-			inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-			glColor4f( lightColor->r, lightColor->g, lightColor->b, 1.0 );
-
-
-			glTexCoord2d( mPrimitive->mAnchorX[0][ index ], 
-                		mPrimitive->mAnchorY[0][ index ] );
-	    	glVertex3d( worldVertices[index]->mX, 
-				worldVertices[index]->mY, worldVertices[index]->mZ );
-
-			index = nextRow + 1;
-
-			inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-			glColor4f( lightColor->r, lightColor->g, lightColor->b, 1.0 );
-
-
-			glTexCoord2d( mPrimitive->mAnchorX[0][ index ], 
-                		mPrimitive->mAnchorY[0][ index ] );	
-	    	glVertex3d( worldVertices[index]->mX, 
-				worldVertices[index]->mY, worldVertices[index]->mZ );
-
-			// draw next vertex to complete first "rectangle"
-
-			index = thisRow + 1;
-
-			inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-			glColor4f( lightColor->r, lightColor->g, lightColor->b, 1.0 );
-
-
-			glTexCoord2d( mPrimitive->mAnchorX[0][ index ], 
-                		mPrimitive->mAnchorY[0][ index ] );
-	    	glVertex3d( worldVertices[index]->mX, 
-				worldVertices[index]->mY, worldVertices[index]->mZ );
-
-
-			// then add rest of vertices as part of strip
-			for( int x=2; x<mPrimitive->mWide; x++ ) {
-
-				// every additional pair of vertices completes
-				// another "rectangle"
-				index = nextRow + x;
-
-				inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-				glColor4f( lightColor->r, lightColor->g, 
-					lightColor->b, 1.0 );
-
-
-				glTexCoord2d( mPrimitive->mAnchorX[0][ index ], 
-                		mPrimitive->mAnchorY[0][ index ] );
-	    		glVertex3d( worldVertices[index]->mX, 
-					worldVertices[index]->mY, worldVertices[index]->mZ );
-
-				index = thisRow + x;
-
-				inLighting->getLighting( worldVertices[index],
-					worldNormals[index], lightColor );
-				glColor4f( lightColor->r, lightColor->g, 
-					lightColor->b, 1.0 );
-
 
-				glTexCoord2d( mPrimitive->mAnchorX[0][ index ], 
-                		mPrimitive->mAnchorY[0][ index ] );
-	    		glVertex3d( worldVertices[index]->mX, 
-					worldVertices[index]->mY, worldVertices[index]->mZ );
-				}
-		glEnd();		
+// this is the ARB version of draw
+inline void PrimitiveGL::draw( Transform3D *inTransform, 
+	LightingGL *inLighting ) {
+	
+	// check for multi-texture availability before proceeding
+	if( !TextureGL::isMultiTexturingSupported() ) {
+		drawNoMultitexture( inTransform, inLighting );
+		return;
 		}
+	
+	drawStrip( inTransform, inLighting, mTextureGL->getNumLayers() );
+	}	
+	
 
 
-	mTextureGL->disable();
-	
-	// cleanup
-	for( int i=0; i<mPrimitive->mNumVertices; i++ ) {
-		delete worldVertices[i];
-		delete worldNormals[i];
-		}
-	delete [] worldVertices;
-	delete [] worldNormals;
-	delete lightColor;
+// this is the non-ARB version of draw
+inline void PrimitiveGL::drawNoMultitexture( Transform3D *inTransform, 
+	LightingGL *inLighting ) {
 	
+	// only the first layer's anchors are used
+	drawStrip( inTransform, inLighting, 1 );
 	}
 
 
@@ -572,6 +669,9 @@ inline int PrimitiveGL::getNumAnimations() {
 
 inline void PrimitiveGL::setParameter( int inParameterIndex, double inValue ) {
 	mPrimitive->setParameter( inParameterIndex, inValue );
+	
+	// parameters can reshape the mesh
+	mPrimitive->verticesChanged();
 	}
 
 
@@ -585,6 +685,11 @@ inline double PrimitiveGL::getParameter( int inParameterIndex ) {
 
 inline void PrimitiveGL::step( double inStepSize ) {
 	mPrimitive->step( inStepSize );
+	
+	if( mPrimitive->getNumAnimations() > 0 ) {
+		// running animations can reshape the mesh
+		mPrimitive->verticesChanged();
+		}
 	}
 
 
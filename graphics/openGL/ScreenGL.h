@@ -263,6 +263,20 @@ class ScreenGL {
          * Returns whether playback display is on or off.
          */
         char shouldShowPlaybackDisplay();
+
+
+        /**
+         * True if playing back as a benchmark (benchmarkPlayback setting).
+         *
+         * In this mode, frames are drawn as fast as possible (no frame
+         * sleep or vsync), per-frame CPU time is measured, and a report
+         * is written to playbackBenchmark.txt before exiting at the end
+         * of the recording.
+         *
+         * If compiled with HEADLESS_OSMESA, frames are drawn into an
+         * offscreen software GL buffer instead of a window.
+         */
+        char isBenchmarkingPlayback();
         
         
 
@@ -798,6 +812,19 @@ class ScreenGL {
         void playNextEventBatch();
         
 
+        // for benchmark playback
+        char mBenchmarkPlayback;
+        // drawing into an offscreen buffer instead of a window
+        char mHeadless;
+        
+        SimpleVector<double> mBenchmarkFrameCPUTimes;
+        double mBenchmarkStartTime;
+        unsigned long mBenchmarkStartAllocations;
+        
+        // writes report and exits
+        void finishPlaybackBenchmark();
+        
+
         // recording file may contain gaps between web event sequence
         // numbers (if recording was trimmed by hand)
         // adjust these so that they don't have gaps
@@ -149,6 +149,7 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <time.h>
 
 
 #include "minorGems/util/stringUtils.h"
@@ -172,6 +173,16 @@
 
 #endif
 
+#ifdef HEADLESS_OSMESA
+
+#include "OSMesaGLSurface.cpp"
+
+#endif
+
+#ifdef COUNT_ALLOCATIONS
+#include "minorGems/util/development/memory/allocationCounter.h"
+#endif
+
 
 
 /* ScreenGL to be accessed by callback functions.
@@ -305,6 +316,11 @@ ScreenGL::ScreenGL( int inWide, int inHigh, char inFullScreen,
     
     mObscureRecordedNumericTyping = false;
 
+    mBenchmarkPlayback = false;
+    mHeadless = false;
+    mBenchmarkStartTime = 0;
+    mBenchmarkStartAllocations = 0;
+    
     // playback overrides recording, check for it first
     // do this before setting up surface
     
@@ -476,7 +492,32 @@ ScreenGL::ScreenGL( int inWide, int inHigh, char inFullScreen,
     delete [] childFiles;
 
 
+    int benchmarkPlaybackFlag = 
+        SettingsManager::getIntSetting( "benchmarkPlayback", 0 );
+    
+    if( benchmarkPlaybackFlag == 1 ) {
+        if( ! mPlaybackEvents ) {
+            AppLog::error( 
+                "benchmarkPlayback set, but no valid recording found in "
+                "playbackGame folder" );
+            exit( 1 );
+            }
+        
+        AppLog::info( "Benchmarking playback:  no frame sleep or vsync" );
 
+        mBenchmarkPlayback = true;
+        mUseFrameSleep = false;
+        mShouldShowPlaybackDisplay = false;
+        
+        // window size doesn't matter when benchmarking
+        mFullScreen = false;
+
+#ifdef HEADLESS_OSMESA
+        AppLog::info( "Drawing into offscreen OSMesa buffer" );
+        mHeadless = true;
+#endif
+        }
+    
 
 
     mStartedFullScreen = mFullScreen;
@@ -711,6 +752,29 @@ int computeAspectRatio( int inW, int inH ) {
 
 
 void ScreenGL::setupSurface() {
+#ifdef HEADLESS_OSMESA
+    if( mHeadless ) {
+        if( ! osMesaCreateSurface( mWide, mHigh ) ) {
+            AppLog::error( "Failed to create OSMesa offscreen surface" );
+            exit( 1 );
+            }
+        
+        GLint stencilBits = 0;
+        glGetIntegerv( GL_STENCIL_BITS, &stencilBits );
+        if( stencilBits > 0 ) {
+            screenGLStencilBufferSupported = true;
+            }
+
+        glEnable( GL_DEPTH_TEST );
+        glEnable( GL_CULL_FACE );
+        glEnable( GL_BLEND );
+        glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+        glCullFace( GL_BACK );
+        glFrontFace( GL_CCW );
+        return;
+        }
+#endif
+
     SDL_GL_SetAttribute( SDL_GL_DOUBLEBUFFER, 1 );
 	
     int flags = 0;
@@ -1013,8 +1077,14 @@ void ScreenGL::setupSurface() {
     // 1-bit stencil buffer
     SDL_GL_SetAttribute( SDL_GL_STENCIL_SIZE, 1 );
 
-    // vsync to avoid tearing
-    SDL_GL_SetAttribute( SDL_GL_SWAP_CONTROL, 1 );
+    if( mBenchmarkPlayback ) {
+        // never wait for vsync when benchmarking
+        SDL_GL_SetAttribute( SDL_GL_SWAP_CONTROL, 0 );
+        }
+    else {
+        // vsync to avoid tearing
+        SDL_GL_SetAttribute( SDL_GL_SWAP_CONTROL, 1 );
+        }
 
     // current color depth
     SDL_Surface *screen = SDL_SetVideoMode( mWide, mHigh, 0, flags);
@@ -1616,6 +1686,131 @@ char ScreenGL::shouldShowPlaybackDisplay() {
     }
 
 
+
+char ScreenGL::isBenchmarkingPlayback() {
+    return mBenchmarkPlayback;
+    }
+
+
+
+static int compareDoubles( const void *inA, const void *inB ) {
+    double a = *( (double *)inA );
+    double b = *( (double *)inB );
+    
+    if( a < b ) {
+        return -1;
+        }
+    if( a > b ) {
+        return 1;
+        }
+    return 0;
+    }
+
+
+
+void ScreenGL::finishPlaybackBenchmark() {
+    double wallTime = Time::getCurrentTime() - mBenchmarkStartTime;
+    
+    int numFrames = mBenchmarkFrameCPUTimes.size();
+    
+    double *frameTimes = mBenchmarkFrameCPUTimes.getElementArray();
+
+    double totalTime = 0;
+    for( int i=0; i<numFrames; i++ ) {
+        totalTime += frameTimes[i];
+        }
+    
+    qsort( frameTimes, numFrames, sizeof( double ), compareDoubles );
+    
+    double meanTime = 0;
+    double medianTime = 0;
+    double p95Time = 0;
+    double p99Time = 0;
+    double maxTime = 0;
+    
+    if( numFrames > 0 ) {
+        meanTime = totalTime / numFrames;
+        medianTime = frameTimes[ numFrames / 2 ];
+        p95Time = frameTimes[ ( numFrames * 95 ) / 100 ];
+        p99Time = frameTimes[ ( numFrames * 99 ) / 100 ];
+        maxTime = frameTimes[ numFrames - 1 ];
+        }
+    delete [] frameTimes;
+    
+
+    // hash of final frame contents
+    // any divergence in game state during playback shows up here
+    int numPixelBytes = mWide * mHigh * 4;
+    unsigned char *pixels = new unsigned char[ numPixelBytes ];
+    
+    glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+    if( ! mHeadless ) {
+        // last frame has already been swapped to front
+        glReadBuffer( GL_FRONT );
+        }
+    glReadPixels( 0, 0, mWide, mHigh, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+    
+    char *frameHash = computeSHA1Digest( pixels, numPixelBytes );
+    delete [] pixels;
+    
+
+    char *allocationString;
+#ifdef COUNT_ALLOCATIONS
+    unsigned long numAllocations = 
+        getAllocationCount() - mBenchmarkStartAllocations;
+    
+    double allocationsPerFrame = 0;
+    if( numFrames > 0 ) {
+        allocationsPerFrame = numAllocations / (double)numFrames;
+        }
+    allocationString = autoSprintf( "allocations: %lu (%.1f per frame)",
+                                    numAllocations, allocationsPerFrame );
+#else
+    allocationString = 
+        stringDuplicate( "allocations: not counted "
+                         "(build with COUNT_ALLOCATIONS = yes)" );
+#endif
+    
+    
+    char *report = autoSprintf( 
+        "frames: %d\n"
+        "wall seconds: %.3f\n"
+        "frames per second: %.2f\n"
+        "frame CPU ms mean: %.3f\n"
+        "frame CPU ms median: %.3f\n"
+        "frame CPU ms p95: %.3f\n"
+        "frame CPU ms p99: %.3f\n"
+        "frame CPU ms max: %.3f\n"
+        "%s\n"
+        "final frame SHA1: %s\n",
+        numFrames, 
+        wallTime, 
+        ( wallTime > 0 ) ? numFrames / wallTime : 0,
+        meanTime, medianTime, p95Time, p99Time, maxTime,
+        allocationString,
+        frameHash );
+    
+    delete [] allocationString;
+    delete [] frameHash;
+    
+    AppLog::infoF( "Playback benchmark done:\n%s", report );
+    
+    File reportFile( NULL, "playbackBenchmark.txt" );
+    
+    if( ! reportFile.writeToFile( report ) ) {
+        AppLog::error( "Failed to write playbackBenchmark.txt" );
+        }
+    
+    delete [] report;
+    
+#ifdef HEADLESS_OSMESA
+    osMesaReleaseSurface();
+#endif
+
+    exit( 0 );
+    }
+
+
 char ScreenGL::isMinimized() {
     // we use mMinimized internally to keep track of whether we ever
     // minimized ourself and were properly restored from that minimization
@@ -1681,6 +1876,9 @@ void ScreenGL::start() {
         
         Time::getCurrentTime( &frameStartSec, &frameStartMSec );
 
+        // process CPU time, for benchmarking
+        clock_t frameStartClock = clock();
+
 
         // pre-display first, this might involve a sleep for frame timing
         // purposes
@@ -1979,10 +2177,23 @@ void ScreenGL::start() {
                 }
             
 
+            if( mBenchmarkPlayback && mNumBatchesPlayed == 0 ) {
+                mBenchmarkStartTime = Time::getCurrentTime();
+#ifdef COUNT_ALLOCATIONS
+                mBenchmarkStartAllocations = getAllocationCount();
+#endif
+                }
+            
             // this may overwrite the mLastTimeValue that we're emulating
             // if this recorded frame involved a recorded time() call.
             playNextEventBatch();
 
+            if( mBenchmarkPlayback && ! mPlaybackEvents ) {
+                // end of recording
+                // never returns
+                finishPlaybackBenchmark();
+                }
+
 
             // dump events, but responde to ESC to stop playback
             // let player take over from that point
@@ -2129,6 +2340,15 @@ void ScreenGL::start() {
             writeEventBatchToFile();
             }
 
+        if( mBenchmarkPlayback && mPlaybackEvents && 
+            mRecordingOrPlaybackStarted ) {
+            
+            double frameCPUTime = 
+                ( 1000.0 * ( clock() - frameStartClock ) ) / CLOCKS_PER_SEC;
+            
+            mBenchmarkFrameCPUTimes.push_back( frameCPUTime );
+            }
+        
 
         int frameTime =
             Time::getMillisecondsSince( frameStartSec, frameStartMSec );
@@ -2192,6 +2412,10 @@ unsigned int ScreenGL::getMaxFramerate() {
 
 
 void ScreenGL::useFrameSleep( char inUse ) {
+    if( mBenchmarkPlayback ) {
+        // never sleep when benchmarking
+        return;
+        }
     mUseFrameSleep = inUse;
     }
 
@@ -2915,7 +3139,18 @@ void callbackDisplay() {
 #ifdef RASPBIAN
     raspbianSwapBuffers();
 #else
+
+#ifdef HEADLESS_OSMESA
+    if( s->mHeadless ) {
+        osMesaSwapBuffers();
+        }
+    else {
+        SDL_GL_SwapBuffers();
+        }
+#else
 	SDL_GL_SwapBuffers();
+#endif
+
 #endif
 
     // thanks to Andrew McClure for the idea of doing this AFTER
@@ -127,6 +127,19 @@ class SingleTextureGL {
                                  char inAlphaOnly,
                                  unsigned int inWidth, 
                                  unsigned int inHeight );
+
+
+        
+        /**
+         * Replaces a rectangle of data in an RGBA texture.
+         *
+         * inRGBA contains inWidth * inHeight * 4 bytes, to be placed with
+         * its first pixel at inX, inY in the texture.
+         */
+        void replaceTextureSubData( unsigned char *inRGBA,
+                                    unsigned int inX, unsigned int inY,
+                                    unsigned int inWidth, 
+                                    unsigned int inHeight );
         
 
 		
@@ -166,6 +179,16 @@ class SingleTextureGL {
                              unsigned int inHeight,
                              char inExpandEdge = false );        
 
+
+        
+        /**
+         * Applies the edge expansion described above to RGBA bytes
+         * in place.
+         */
+        static void expandEdges( unsigned char *inBytes,
+                                 unsigned int inWidth, 
+                                 unsigned int inHeight );
+
 		
 		/**
 		 * Enables this texture.
@@ -0,0 +1,380 @@
+// Draws a 512x512 LandscapePrimitive3D in an offscreen software (Mesa)
+// context with PrimitiveGL, from packed arrays and from buffer objects,
+// and with a copy of the original immediate-mode drawing code.  Checks
+// that all three produce the same image, then measures frame times.
+//
+// Usage:  primitiveGLBenchmark [mesh_size]
+
+
+#include <GL/osmesa.h>
+
+#include "PrimitiveGL.h"
+#include "DirectionLightingGL.h"
+
+#include "minorGems/graphics/3d/LandscapePrimitive3D.h"
+#include "minorGems/system/Time.h"
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+// copy of the original draw, which transforms every vertex on the CPU
+// and sends each one with immediate-mode calls
+void drawImmediate( Primitive3D *inPrimitive, TextureGL *inTextureGL,
+                    Transform3D *inTransform, LightingGL *inLighting ) {
+
+    Vector3D **worldVertices = new Vector3D*[ inPrimitive->mNumVertices ];
+    Vector3D **worldNormals = new Vector3D*[ inPrimitive->mNumVertices ];
+    for( int i=0; i<inPrimitive->mNumVertices; i++ ) {
+        worldVertices[i] = new Vector3D( inPrimitive->mVertices[i] );
+        worldNormals[i] = new Vector3D( inPrimitive->mNormals[i] );
+
+        inTransform->apply( worldVertices[i] );
+
+        inTransform->applyNoTranslation( worldNormals[i] );
+        worldNormals[i]->normalize();
+        }
+
+    inTextureGL->enable();
+    int numTextureLayers = inTextureGL->getNumLayers();
+
+    glDisable( GL_BLEND );
+    glEnable( GL_CULL_FACE );
+    glCullFace( GL_BACK );
+    glFrontFace( GL_CCW );
+
+    Color *lightColor = new Color( 0, 0, 0, 1.0 );
+
+    for( int y=0; y<inPrimitive->mHigh-1; y++ ) {
+        int thisRow = y * inPrimitive->mWide;
+        int nextRow = ( y + 1 ) * inPrimitive->mWide;
+
+        glBegin( GL_TRIANGLE_STRIP );
+
+        // same vertex order as the original's unrolled first rectangle
+        for( int x=0; x<inPrimitive->mWide; x++ ) {
+            for( int v=0; v<2; v++ ) {
+                int index = ( v == 0 ) ? nextRow + x : thisRow + x;
+
+                inLighting->getLighting( worldVertices[index],
+                                         worldNormals[index], lightColor );
+                glColor4f( lightColor->r, lightColor->g, lightColor->b,
+                           1.0 );
+
+                for( int t=0; t<numTextureLayers; t++ ) {
+                    glMultiTexCoord2fARB(
+                        TextureGL::sMultiTextureEnum[t],
+                        inPrimitive->mAnchorX[t][ index ],
+                        inPrimitive->mAnchorY[t][ index ] );
+                    }
+                glVertex3d( worldVertices[index]->mX,
+                            worldVertices[index]->mY,
+                            worldVertices[index]->mZ );
+                }
+            }
+        glEnd();
+        }
+
+    inTextureGL->disable();
+
+    for( int i=0; i<inPrimitive->mNumVertices; i++ ) {
+        delete worldVertices[i];
+        delete worldNormals[i];
+        }
+    delete [] worldVertices;
+    delete [] worldNormals;
+    delete lightColor;
+    }
+
+
+
+RGBAImage *makeTexture( int inSize, int inCycles ) {
+    RGBAImage *image = new RGBAImage( inSize, inSize );
+
+    for( int c=0; c<4; c++ ) {
+        double *channel = image->getChannel( c );
+
+        for( int y=0; y<inSize; y++ ) {
+            for( int x=0; x<inSize; x++ ) {
+                double value =
+                    0.5 + 0.5 * sin( inCycles * ( x + 2 * c * y ) *
+                                     2 * M_PI / inSize );
+                if( c == 3 ) {
+                    value = 0.5 + 0.5 * value;
+                    }
+                channel[ y * inSize + x ] = value;
+                }
+            }
+        }
+    return image;
+    }
+
+
+
+Primitive3D *makeLandscape( int inSize ) {
+    double *heights = new double[ inSize * inSize ];
+
+    for( int y=0; y<inSize; y++ ) {
+        for( int x=0; x<inSize; x++ ) {
+            double fx = (double)x / inSize;
+            double fy = (double)y / inSize;
+
+            heights[ y * inSize + x ] =
+                0.25 + 0.15 * sin( 9 * fx ) * cos( 7 * fy ) +
+                0.05 * sin( 41 * fx + 23 * fy );
+            }
+        }
+
+    Primitive3D *landscape =
+        new LandscapePrimitive3D( inSize, inSize, heights,
+                                  makeTexture( 256, 3 ),
+                                  makeTexture( 64, 1 ), 0.125 );
+    delete [] heights;
+
+    return landscape;
+    }
+
+
+
+void setFrameTransform( Transform3D *inTransform, int inFrame ) {
+    Transform3D identity;
+    memcpy( inTransform->getMatrix(), identity.getMatrix(),
+            16 * sizeof( double ) );
+
+    Angle3D angle( 0, 0.01 * inFrame, 0 );
+    inTransform->rotate( &angle );
+    }
+
+
+
+int imageWidth = 640;
+int imageHeight = 480;
+
+
+
+void startFrame() {
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    }
+
+
+
+unsigned char *readFrame() {
+    glFinish();
+
+    unsigned char *pixels = new unsigned char[ imageWidth * imageHeight * 4 ];
+    glReadPixels( 0, 0, imageWidth, imageHeight, GL_RGBA, GL_UNSIGNED_BYTE,
+                  pixels );
+    return pixels;
+    }
+
+
+
+// fraction of pixels where any channel differs by more than inTolerance
+double compareFrames( unsigned char *inA, unsigned char *inB,
+                      int inTolerance ) {
+    int numPixels = imageWidth * imageHeight;
+    int numDifferent = 0;
+
+    for( int p=0; p<numPixels; p++ ) {
+        for( int c=0; c<4; c++ ) {
+            if( abs( inA[ p * 4 + c ] - inB[ p * 4 + c ] ) > inTolerance ) {
+                numDifferent++;
+                break;
+                }
+            }
+        }
+    return (double)numDifferent / numPixels;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+    int meshSize = 512;
+
+    if( inNumArgs > 1 ) {
+        meshSize = atoi( inArgs[1] );
+        }
+
+
+    OSMesaContext context = OSMesaCreateContextExt( OSMESA_RGBA, 24, 0, 0,
+                                                    NULL );
+    unsigned char *buffer = new unsigned char[ imageWidth * imageHeight * 4 ];
+
+    if( context == NULL ||
+        ! OSMesaMakeCurrent( context, buffer, GL_UNSIGNED_BYTE,
+                             imageWidth, imageHeight ) ) {
+        printf( "Failed to create OSMesa context\n" );
+        return 1;
+        }
+
+    printf( "%s, %s\n", glGetString( GL_RENDERER ), glGetString( GL_VERSION ) );
+
+    glViewport( 0, 0, imageWidth, imageHeight );
+    glMatrixMode( GL_PROJECTION );
+    glLoadIdentity();
+    glFrustum( -0.4, 0.4, -0.3, 0.3, 0.5, 10 );
+    glMatrixMode( GL_MODELVIEW );
+    glLoadIdentity();
+    glTranslated( 0, -0.6, -2.2 );
+    glRotated( 35, 1, 0, 0 );
+    glEnable( GL_DEPTH_TEST );
+    glClearColor( 0, 0, 0, 1 );
+
+
+    DirectionLightingGL lighting( new Color( 1, 1, 0.9 ),
+                                  new Vector3D( 0.3, -1, -0.4 ) );
+
+    Primitive3D *reference = makeLandscape( meshSize );
+
+    TextureGL referenceTexture( reference->mNumTextures );
+    for( int t=0; t<reference->mNumTextures; t++ ) {
+        unsigned char *rgba = reference->mTexture[t]->getRGBABytes();
+        referenceTexture.setTextureData( t, rgba,
+                                         reference->mTexture[t]->getWidth(),
+                                         reference->mTexture[t]->getHeight() );
+        delete [] rgba;
+        }
+
+    PrimitiveGL primitive( makeLandscape( meshSize ) );
+
+    if( !TextureGL::isMultiTexturingSupported() ) {
+        printf( "Multitexturing not supported\n" );
+        return 1;
+        }
+
+
+    Transform3D transform;
+    int failures = 0;
+
+
+    // same image from all three, apart from rounding in the transform
+    // (float on the card instead of double on the CPU)
+    for( int frame=0; frame<200; frame += 67 ) {
+        setFrameTransform( &transform, frame );
+
+        startFrame();
+        drawImmediate( reference, &referenceTexture, &transform, &lighting );
+        unsigned char *expected = readFrame();
+
+        for( int useBuffers=0; useBuffers<2; useBuffers++ ) {
+            PrimitiveGL::disableBufferObjects( !useBuffers );
+
+            startFrame();
+            primitive.draw( &transform, &lighting );
+            unsigned char *result = readFrame();
+
+            if( useBuffers && !PrimitiveGL::isBufferObjectSupported() ) {
+                printf( "Buffer objects not supported\n" );
+                }
+
+            double different = compareFrames( expected, result, 8 );
+
+            if( different > 0.002 ) {
+                printf( "FAILED:  frame %d, buffers %d, %.3f%% of pixels "
+                        "differ\n", frame, useBuffers, different * 100 );
+                failures++;
+                }
+            delete [] result;
+            }
+        delete [] expected;
+        }
+
+    // mesh changes reach the buffers after a parameter change
+    PrimitiveGL::disableBufferObjects( false );
+
+    Primitive3D *changedPrimitive = reference->copy();
+    PrimitiveGL changed( changedPrimitive );
+
+    setFrameTransform( &transform, 20 );
+    startFrame();
+    changed.draw( &transform, &lighting );
+
+    for( int i=0; i<reference->mNumVertices; i++ ) {
+        reference->mVertices[i]->mY *= 0.5;
+        changedPrimitive->mVertices[i]->mY *= 0.5;
+        }
+    changed.setParameter( 0, 0 );
+
+    startFrame();
+    drawImmediate( reference, &referenceTexture, &transform, &lighting );
+    unsigned char *expected = readFrame();
+
+    startFrame();
+    changed.draw( &transform, &lighting );
+    unsigned char *result = readFrame();
+
+    double different = compareFrames( expected, result, 8 );
+    if( different > 0.002 ) {
+        printf( "FAILED:  changed mesh, %.3f%% of pixels differ\n",
+                different * 100 );
+        failures++;
+        }
+    delete [] expected;
+    delete [] result;
+
+    for( int i=0; i<reference->mNumVertices; i++ ) {
+        reference->mVertices[i]->mY *= 2;
+        }
+
+
+    reference->updatePackedArrays();
+
+    printf( "%d x %d landscape, %ld strip indices, %d texture layers\n",
+            meshSize, meshSize, reference->mNumStripIndices,
+            reference->mNumTextures );
+
+
+    const char *names[3] = { "immediate mode (original)",
+                             "packed vertex arrays",
+                             "buffer objects" };
+
+    double frameTimes[3];
+
+    for( int method=0; method<3; method++ ) {
+        PrimitiveGL::disableBufferObjects( method != 2 );
+
+        int numFrames = 0;
+        double startTime = Time::getCurrentTime();
+        double time = 0;
+
+        // at least 10 frames and 2 seconds
+        while( numFrames < 10 || time < 2 ) {
+            setFrameTransform( &transform, numFrames );
+
+            startFrame();
+            if( method == 0 ) {
+                drawImmediate( reference, &referenceTexture, &transform,
+                               &lighting );
+                }
+            else {
+                primitive.draw( &transform, &lighting );
+                }
+            glFinish();
+
+            numFrames++;
+            time = Time::getCurrentTime() - startTime;
+            }
+
+        frameTimes[ method ] = 1000 * time / numFrames;
+
+        printf( "%-28s %8.2f ms/frame  (%.2fx)\n", names[ method ],
+                frameTimes[ method ], frameTimes[0] / frameTimes[ method ] );
+        }
+
+
+    delete reference;
+
+    OSMesaDestroyContext( context );
+    delete [] buffer;
+
+    if( failures > 0 ) {
+        printf( "%d checks FAILED\n", failures );
+        return 1;
+        }
+    printf( "All checks passed\n" );
+    return 0;
+    }
@@ -0,0 +1,179 @@
+// Measures achievable capture frame rates for FrameCapture using
+// synthetic frames, compared against encoding each frame synchronously
+// (the old outputAllFrames path).
+//
+// Usage:  frameCaptureBenchmark [width height numFrames]
+
+
+#include "minorGems/graphics/FrameCapture.h"
+#include "minorGems/graphics/Image.h"
+#include "minorGems/graphics/converters/TGAImageConverter.h"
+
+#include "minorGems/io/file/File.h"
+#include "minorGems/io/file/FileOutputStream.h"
+
+#include "minorGems/system/Time.h"
+
+#include "minorGems/util/stringUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+
+static int width = 1280;
+static int height = 720;
+static int numFrames = 120;
+
+
+
+static void fillSyntheticFrame( unsigned char *inBytes, int inFrame ) {
+    int i = 0;
+    for( int y=0; y<height; y++ ) {
+        for( int x=0; x<width; x++ ) {
+            inBytes[i++] = (unsigned char)( x + inFrame );
+            inBytes[i++] = (unsigned char)( y + 2 * inFrame );
+            inBytes[i++] = (unsigned char)( ( x ^ y ) + 3 * inFrame );
+            }
+        }
+    }
+
+
+
+static File *getFrameFile( File *inDir, int inFrame ) {
+    char *name = autoSprintf( "frame%05d.tga", inFrame );
+    File *file = inDir->getChildFile( name );
+    delete [] name;
+    return file;
+    }
+
+
+
+// the old path:  convert to Image and encode on the calling thread
+static double runSynchronous( File *inDir, ImageConverter *inConverter ) {
+    unsigned char *rgbBytes = new unsigned char[ width * height * 3 ];
+
+    double startTime = Time::getCurrentTime();
+
+    for( int f=0; f<numFrames; f++ ) {
+        fillSyntheticFrame( rgbBytes, f );
+
+        Image image( width, height, 3, false );
+
+        for( int c=0; c<3; c++ ) {
+            double *channel = image.getChannel( c );
+            int outputRow = 0;
+            for( int y=height - 1; y>=0; y-- ) {
+                for( int x=0; x<width; x++ ) {
+                    channel[ outputRow * width + x ] =
+                        rgbBytes[ ( y * width + x ) * 3 + c ] * 0.003921569;
+                    }
+                outputRow++;
+                }
+            }
+
+        File *file = getFrameFile( inDir, f );
+        FileOutputStream stream( file );
+        inConverter->formatImage( &image, &stream );
+        delete file;
+        }
+
+    double time = Time::getCurrentTime() - startTime;
+
+    delete [] rgbBytes;
+
+    return numFrames / time;
+    }
+
+
+
+static double runPipeline( FrameCapture *inCapture, File *inDir,
+                           int *outDropped ) {
+
+    double startTime = Time::getCurrentTime();
+
+    for( int f=0; f<numFrames; f++ ) {
+        unsigned char *rgbBytes = inCapture->beginFrame();
+
+        if( rgbBytes != NULL ) {
+            fillSyntheticFrame( rgbBytes, f );
+            inCapture->endFrame( getFrameFile( inDir, f ) );
+            }
+        }
+    inCapture->flush();
+
+    double time = Time::getCurrentTime() - startTime;
+
+    *outDropped = inCapture->getNumFramesDropped();
+
+    return numFrames / time;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    if( inNumArgs == 4 ) {
+        width = atoi( inArgs[1] );
+        height = atoi( inArgs[2] );
+        numFrames = atoi( inArgs[3] );
+        }
+
+    File outDir( NULL, "frameCaptureBenchmarkOut" );
+    if( ! outDir.exists() ) {
+        outDir.makeDirectory();
+        }
+
+    TGAImageConverter converter;
+
+    printf( "%d frames at %dx%d\n\n", numFrames, width, height );
+
+    // baseline also includes cost of generating synthetic frames,
+    // like all runs below
+    printf( "synchronous TGA:            %7.2f fps\n",
+            runSynchronous( &outDir, &converter ) );
+
+
+    int threadCounts[4] = { 1, 2, 4, 8 };
+
+    for( int t=0; t<4; t++ ) {
+        int numThreads = threadCounts[t];
+        int dropped;
+
+        FrameCapture *capture =
+            new FrameCapture( width, height, &converter,
+                              numThreads, numThreads * 2,
+                              FRAME_CAPTURE_BLOCK );
+
+        double fps = runPipeline( capture, &outDir, &dropped );
+        delete capture;
+
+        printf( "TGA, %d threads, block:     %7.2f fps\n", numThreads, fps );
+
+
+        capture = new FrameCapture( width, height, &converter,
+                                    numThreads, numThreads * 2,
+                                    FRAME_CAPTURE_DROP );
+
+        fps = runPipeline( capture, &outDir, &dropped );
+        delete capture;
+
+        printf( "TGA, %d threads, drop:      %7.2f fps (%d dropped)\n",
+                numThreads, fps, dropped );
+
+
+        File *y4mFile = outDir.getChildFile( "frames.y4m" );
+
+        capture = new FrameCapture( width, height, y4mFile, 60,
+                                    numThreads, numThreads * 2,
+                                    FRAME_CAPTURE_BLOCK );
+        delete y4mFile;
+
+        fps = runPipeline( capture, &outDir, &dropped );
+        delete capture;
+
+        printf( "y4m, %d threads, block:     %7.2f fps\n\n", numThreads, fps );
+        }
+
+    return 0;
+    }
@@ -0,0 +1,285 @@
+// Checks ImageFilterEngine against Image::filter for chains of filters,
+// then measures the time to filter a 4K RGB image with each, across
+// thread counts.
+//
+// Usage:  imageFilterEngineBenchmark
+
+
+#include "minorGems/graphics/ImageFilterEngine.h"
+#include "minorGems/graphics/Image.h"
+
+#include "minorGems/graphics/filters/MultiFilter.h"
+#include "minorGems/graphics/filters/InvertFilter.h"
+#include "minorGems/graphics/filters/ThresholdFilter.h"
+#include "minorGems/graphics/filters/BoxBlurFilter.h"
+#include "minorGems/graphics/filters/FastBlurFilter.h"
+#include "minorGems/graphics/filters/MedianFilter.h"
+
+#include "minorGems/util/random/XoshiroRandomSource.h"
+#include "minorGems/system/Time.h"
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+int failures = 0;
+
+
+void check( char inPassed, const char *inWhat, int inNumThreads ) {
+    if( !inPassed ) {
+        printf( "FAILED:  %s, %d worker threads\n", inWhat, inNumThreads );
+        failures++;
+        }
+    }
+
+
+
+// needs the whole channel, so it is never cut into bands
+class RecenterFilter : public ChannelFilter {
+
+    public:
+
+        void apply( double *inChannel, int inWidth, int inHeight ) {
+            int numPixels = inWidth * inHeight;
+
+            double sum = 0;
+            for( int i=0; i<numPixels; i++ ) {
+                sum += inChannel[i];
+                }
+            double shift = 0.5 - sum / numPixels;
+
+            for( int i=0; i<numPixels; i++ ) {
+                inChannel[i] += shift;
+                }
+            }
+    };
+
+
+
+Image *makeImage( int inWidth, int inHeight, int inNumChannels,
+                  RandomSource *inRandSource ) {
+    Image *image = new Image( inWidth, inHeight, inNumChannels );
+
+    for( int c=0; c<inNumChannels; c++ ) {
+        double *channel = image->getChannel( c );
+
+        for( int i=0; i<inWidth * inHeight; i++ ) {
+            channel[i] = inRandSource->getRandomDouble();
+            }
+        }
+    return image;
+    }
+
+
+
+// largest difference between two images
+double maxDifference( Image *inA, Image *inB ) {
+    double maxDiff = 0;
+
+    for( int c=0; c<inA->getNumChannels(); c++ ) {
+        double *a = inA->getChannel( c );
+        double *b = inB->getChannel( c );
+
+        for( int i=0; i<inA->getWidth() * inA->getHeight(); i++ ) {
+            double diff = fabs( a[i] - b[i] );
+            if( diff > maxDiff ) {
+                maxDiff = diff;
+                }
+            }
+        }
+    return maxDiff;
+    }
+
+
+
+// inChannel of -1 filters all channels
+void checkChain( ImageFilterEngine *inEngine, int inNumThreads,
+                 ChannelFilter *inFilter, const char *inName,
+                 double inTolerance,
+                 int inWidth, int inHeight, int inChannel, char inSelect,
+                 RandomSource *inRandSource ) {
+
+    Image *image = makeImage( inWidth, inHeight, 3, inRandSource );
+    Image *selection = makeImage( inWidth, inHeight, 1, inRandSource );
+
+    // copy pastes through the selection, so copy first
+    Image *expected = image->copy();
+
+    if( inSelect ) {
+        image->setSelection( selection );
+        expected->setSelection( selection );
+        }
+
+    if( inChannel == -1 ) {
+        expected->filter( inFilter );
+        inEngine->filter( image, inFilter );
+        }
+    else {
+        expected->filter( inFilter, inChannel );
+        inEngine->filter( image, inFilter, inChannel );
+        }
+
+    char what[200];
+    sprintf( what, "%s on %dx%d image, channel %d%s", inName,
+             inWidth, inHeight, inChannel,
+             inSelect ? ", with selection" : "" );
+    check( maxDifference( image, expected ) <= inTolerance, what,
+           inNumThreads );
+
+    delete image;
+    delete expected;
+    delete selection;
+    }
+
+
+
+int main() {
+    XoshiroRandomSource randSource( 12345 );
+
+    InvertFilter invert;
+    ThresholdFilter threshold( 0.5 );
+    BoxBlurFilter boxBlur( 2 );
+    FastBlurFilter fastBlur;
+    MedianFilter median( 2 );
+    RecenterFilter recenter;
+
+    // fused per-pixel filters
+    MultiFilter pixelChain;
+    pixelChain.addFilter( &invert );
+    pixelChain.addFilter( &threshold );
+    pixelChain.addFilter( &invert );
+
+    // filters that agree exactly when run on bands
+    MultiFilter exactChain;
+    exactChain.addFilter( &invert );
+    exactChain.addFilter( &median );
+    exactChain.addFilter( &fastBlur );
+    exactChain.addFilter( &threshold );
+
+    // box blur sums over the whole band, so it rounds differently, and
+    // nothing after it can round to integers, like the median filter
+    MultiFilter blurChain;
+    blurChain.addFilter( &invert );
+    blurChain.addFilter( &boxBlur );
+    blurChain.addFilter( &threshold );
+    blurChain.addFilter( &fastBlur );
+    blurChain.addFilter( &invert );
+
+    // nested chains, cut by a whole-channel filter
+    MultiFilter mixedChain;
+    mixedChain.addFilter( &fastBlur );
+    mixedChain.addFilter( &pixelChain );
+    mixedChain.addFilter( &recenter );
+    mixedChain.addFilter( &median );
+    mixedChain.addFilter( &boxBlur );
+
+    int threadCounts[3] = { 0, 1, 3 };
+
+    for( int t=0; t<3; t++ ) {
+        int numThreads = threadCounts[t];
+        ImageFilterEngine engine( numThreads );
+
+        // odd sizes, bands shorter than the blur, and images thinner
+        // than a band
+        int widths[5] = { 97, 3000, 5, 1, 40 };
+        int heights[5] = { 61, 70, 3, 40, 1 };
+
+        for( int s=0; s<5; s++ ) {
+            int w = widths[s];
+            int h = heights[s];
+
+            checkChain( &engine, numThreads, &invert, "invert", 0,
+                        w, h, -1, false, &randSource );
+            checkChain( &engine, numThreads, &pixelChain, "pixel chain", 0,
+                        w, h, -1, false, &randSource );
+            checkChain( &engine, numThreads, &exactChain, "exact chain", 0,
+                        w, h, -1, false, &randSource );
+            checkChain( &engine, numThreads, &blurChain, "blur chain",
+                        1e-9, w, h, -1, false, &randSource );
+            checkChain( &engine, numThreads, &mixedChain, "mixed chain",
+                        1e-9, w, h, -1, false, &randSource );
+            }
+
+        checkChain( &engine, numThreads, &exactChain, "exact chain", 0,
+                    97, 61, 1, false, &randSource );
+        checkChain( &engine, numThreads, &blurChain, "blur chain", 1e-9,
+                    97, 61, 2, false, &randSource );
+        checkChain( &engine, numThreads, &exactChain, "exact chain", 0,
+                    97, 61, -1, true, &randSource );
+        checkChain( &engine, numThreads, &blurChain, "blur chain", 1e-9,
+                    97, 61, 0, true, &randSource );
+        }
+
+    if( failures == 0 ) {
+        printf( "All chains match Image::filter\n" );
+        }
+
+
+    int width = 3840;
+    int height = 2160;
+
+    Image *image = makeImage( width, height, 3, &randSource );
+
+    MultiFilter *chains[2] = { &pixelChain, &blurChain };
+    const char *chainNames[2] = {
+        "invert, threshold, invert",
+        "invert, box blur, threshold, fast blur, invert" };
+
+    int workerCounts[5] = { 1, 2, 4, 8, 16 };
+
+    for( int c=0; c<2; c++ ) {
+        printf( "\n%dx%d RGB image, %s, ms per image:\n",
+                width, height, chainNames[c] );
+
+        double baseTime = 0;
+        for( int i=-1; i<5; i++ ) {
+            ImageFilterEngine *engine = NULL;
+            if( i >= 0 ) {
+                // the calling thread is one of the workers
+                engine = new ImageFilterEngine( workerCounts[i] - 1 );
+                }
+
+            // at least a few rounds, and long enough for the timer
+            int numRounds = 0;
+            double startTime = Time::getCurrentTime();
+            double time = 0;
+            while( numRounds < 3 || time < 0.5 ) {
+                if( engine == NULL ) {
+                    image->filter( chains[c] );
+                    }
+                else {
+                    engine->filter( image, chains[c] );
+                    }
+                numRounds++;
+                time = Time::getCurrentTime() - startTime;
+                }
+
+            double imageTime = time / numRounds;
+
+            char name[100];
+            if( engine == NULL ) {
+                baseTime = imageTime;
+                sprintf( name, "Image::filter" );
+                }
+            else {
+                sprintf( name, "engine, %d threads", workerCounts[i] );
+                delete engine;
+                }
+            printf( "  %-22s %8.1f  (%.2fx)\n", name,
+                    imageTime * 1000, baseTime / imageTime );
+            }
+        }
+
+    delete image;
+
+
+    if( failures > 0 ) {
+        printf( "%d checks FAILED\n", failures );
+        return 1;
+        }
+    return 0;
+    }
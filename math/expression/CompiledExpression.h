@@ -0,0 +1,1316 @@
+#ifndef COMPILED_EXPRESSION_INCLUDED
+#define COMPILED_EXPRESSION_INCLUDED
+
+
+#include "Expression.h"
+#include "Variable.h"
+#include "ConstantExpression.h"
+#include "FixedConstantExpression.h"
+#include "MultiConstantArgumentExpression.h"
+#include "VariableExpression.h"
+#include "NegateExpression.h"
+#include "InvertExpression.h"
+#include "SinExpression.h"
+#include "CosExpression.h"
+#include "TanExpression.h"
+#include "LnExpression.h"
+#include "SqrtExpression.h"
+#include "SumExpression.h"
+#include "ProductExpression.h"
+#include "PowerExpression.h"
+#include "ComparisonExpression.h"
+#include "BinaryLogicExpression.h"
+
+#include "minorGems/util/SimpleVector.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#include "minorGems/system/cpuFeatures.h"
+
+
+
+// where an instruction finds one of its arguments
+typedef struct CompiledOperand {
+        // one of the CompiledExpression operand kinds
+        int kind;
+        int index;
+    } CompiledOperand;
+
+
+
+typedef struct CompiledInstruction {
+        int operation;
+
+        // b is unused for unary operations, and a holds the fallback
+        // expression index for EVALUATE_TREE
+        CompiledOperand a;
+        CompiledOperand b;
+
+        // register that receives the result, or -1 for the output values
+        int destRegister;
+    } CompiledInstruction;
+
+
+
+/**
+ * An expression flattened into register bytecode for fast repeated
+ * evaluation, especially over large arrays of variable values.
+ *
+ * Subexpressions without variables are folded into constants when
+ * compiling.  Each instruction then runs over a block of values at once,
+ * with SSE2 or AVX for the arithmetic, comparison, and logic operations.
+ *
+ * Results match Expression::evaluate exactly, except that each variable
+ * is read once per evaluation, so a RandomVariable that appears more than
+ * once gets the same value at each appearance.
+ *
+ * Expression subtypes unknown to the compiler are evaluated through
+ * a copy of their subtree, one value at a time, after setting each
+ * variable with Variable::setValue.
+ *
+ * The program is a snapshot:  recompile after changing the expression or
+ * its constants.  It keeps ExpressionSerializer's view of the tree
+ * intact, so compile from a deserialized expression as from any other.
+ *
+ * Not safe to evaluate from more than one thread at once.
+ *
+ * @author Jason Rohrer
+ */
+class CompiledExpression {
+
+    public:
+
+        /**
+         * Compiles an expression.
+         *
+         * @param inExpression the expression to compile.
+         *   Destroyed by caller, and can be destroyed as soon as this
+         *   constructor returns.
+         * @param inVariables the variables in the order that their values
+         *   will be passed to evaluate, or NULL.  Variables in the
+         *   expression that are not in this list are added after it,
+         *   in the order that they are first found (depth-first,
+         *   left-first).  Defaults to NULL.
+         *   Array and variables destroyed by caller, variables after
+         *   this class is destroyed.
+         * @param inNumVariables the number of variables in inVariables.
+         *   Defaults to 0.
+         */
+        CompiledExpression( Expression *inExpression,
+                            Variable **inVariables = NULL,
+                            int inNumVariables = 0 );
+
+        ~CompiledExpression();
+
+
+
+        int getNumVariables();
+
+
+        /**
+         * Gets a variable.
+         *
+         * @param inIndex the index of the variable, as ordered for
+         *   evaluate.
+         *
+         * @return the variable.
+         *   Must not be destroyed by caller.
+         */
+        Variable *getVariable( int inIndex );
+
+
+        // size of the compiled program
+        int getNumInstructions();
+        int getNumRegisters();
+
+
+
+        /**
+         * Evaluates using the current value of each variable.
+         *
+         * @return the value of the expression.
+         */
+        double evaluate();
+
+
+        /**
+         * Evaluates for many sets of variable values in one call.
+         *
+         * @param inVariableValues one array of inNumValues values for
+         *   each variable, as ordered by getVariable.
+         *   Arrays destroyed by caller.
+         * @param outValues array where inNumValues results will be
+         *   returned.
+         *   Destroyed by caller.
+         * @param inNumValues the number of values.
+         */
+        void evaluate( double **inVariableValues, double *outValues,
+                       int inNumValues );
+
+
+
+        /**
+         * Prints the compiled program to standard out.
+         */
+        void print();
+
+
+
+        /**
+         * Gets the evaluation kernel implementation in use.
+         *
+         * @return 0 for portable code, 1 for SSE2, or 2 for AVX.
+         */
+        static int getKernelImplementation();
+
+
+        /**
+         * Limits which kernel implementation can be used, mostly for
+         * testing and benchmarking.
+         *
+         * @param inMaxImplementation the highest implementation to use,
+         *   if supported by this CPU, as numbered by
+         *   getKernelImplementation.
+         */
+        static void setKernelImplementationLimit( int inMaxImplementation );
+
+
+
+        // operations
+        static const int NEGATE = 0;
+        static const int INVERT = 1;
+        static const int SIN = 2;
+        static const int COS = 3;
+        static const int TAN = 4;
+        static const int LN = 5;
+        static const int SQRT = 6;
+        static const int SUM = 7;
+        static const int PRODUCT = 8;
+        static const int POWER = 9;
+        // in the same order as ComparisonExpression's comparisons
+        static const int GREATER_THAN = 10;
+        static const int LESS_THAN = 11;
+        static const int GREATER_THAN_OR_EQUAL_TO = 12;
+        static const int LESS_THAN_OR_EQUAL_TO = 13;
+        static const int EQUAL_TO = 14;
+        static const int NOT_EQUAL_TO = 15;
+        // in the same order as BinaryLogicExpression's operations
+        static const int LOGIC_AND = 16;
+        static const int LOGIC_OR = 17;
+        static const int LOGIC_XOR = 18;
+        static const int EVALUATE_TREE = 19;
+
+
+        // operand kinds
+        static const int REGISTER_OPERAND = 0;
+        static const int VARIABLE_OPERAND = 1;
+        static const int CONSTANT_OPERAND = 2;
+        static const int TREE_OPERAND = 3;
+
+
+        // values per register, and per pass through the program
+        static const int BLOCK_SIZE = 256;
+
+
+
+    protected:
+
+        SimpleVector<Variable *> mVariables;
+        SimpleVector<CompiledInstruction> mInstructions;
+        SimpleVector<double> mConstantValues;
+
+        // copies of subtrees that the compiler does not know
+        SimpleVector<Expression *> mTrees;
+
+        // result when the program has no instructions
+        CompiledOperand mResult;
+
+        // mInstructions as an array, once compiled
+        int mNumInstructions;
+        CompiledInstruction *mProgram;
+
+        int mNumRegisters;
+        double *mRegisters;
+
+        // 4 copies of each constant, so vector kernels can load them
+        // like an array that does not advance
+        double *mConstants;
+
+        // pointers into the variable arrays for the current block
+        double **mBlockVariables;
+
+        // variable values and registers for single evaluations, and
+        // pointers to the values as arrays of one value
+        double *mSingleValues;
+        double **mSingleValuePointers;
+        double *mSingleRegisters;
+
+
+        static int mImplementationLimit;
+
+
+
+        /**
+         * Compiles a subexpression.
+         *
+         * @param inExpression the subexpression.
+         *   Destroyed by caller.
+         * @param inFirstFreeRegister the lowest register that is not
+         *   holding a value still needed.
+         *
+         * @return where the value of the subexpression will be.
+         */
+        CompiledOperand compileNode( Expression *inExpression,
+                                     int inFirstFreeRegister );
+
+
+        // gets the operation for an expression, or -1 if unknown
+        int getOperation( Expression *inExpression );
+
+        int addVariable( Variable *inVariable );
+
+        // adds variables from a subtree that will be evaluated directly
+        void addTreeVariables( Expression *inExpression );
+
+        CompiledOperand addConstant( double inValue );
+
+        CompiledOperand addInstruction( int inOperation,
+                                        CompiledOperand inA,
+                                        CompiledOperand inB,
+                                        int inDestRegister );
+
+
+        void getOperandValues( CompiledOperand inOperand,
+                               const double **outValues, int *outStep );
+
+        double getSingleValue( CompiledOperand inOperand );
+
+
+        /**
+         * Runs the program over one block of values.
+         *
+         * @param inVariableValues one pointer per variable to its first
+         *   value in this block.
+         * @param outValues where inNumValues results will be returned.
+         * @param inNumValues the number of values, at most BLOCK_SIZE.
+         * @param inImplementation the kernel implementation to use.
+         */
+        void runBlock( double **inVariableValues, double *outValues,
+                       int inNumValues, int inImplementation );
+
+
+        void evaluateTree( Expression *inTree, double **inVariableValues,
+                           double *outValues, int inNumValues );
+
+
+
+        // applies an operation to one value, for folding constants and
+        // for single evaluations
+        static double applyOperation( int inOperation, double inA,
+                                      double inB );
+
+
+        // Kernels apply an operation to inCount values.  Operand values
+        // are at inA[ i * inAStep ], so a step of 0 reads a constant.
+        // Vector kernels return how many values they did, and leave the
+        // rest, and the operations that they do not handle, to the
+        // portable kernel.  All give identical results.
+
+        static void runOperationPortable( int inOperation,
+                                          const double *inA, int inAStep,
+                                          const double *inB, int inBStep,
+                                          double *outValues,
+                                          int inStart, int inEnd );
+
+#ifdef CPU_FEATURES_X86
+        static int runOperationSSE2( int inOperation,
+                                     const double *inA, int inAStep,
+                                     const double *inB, int inBStep,
+                                     double *outValues, int inCount )
+            __attribute__(( target( "sse2" ) ));
+
+        static int runOperationAVX( int inOperation,
+                                    const double *inA, int inAStep,
+                                    const double *inB, int inBStep,
+                                    double *outValues, int inCount )
+            __attribute__(( target( "avx" ) ));
+#endif
+
+    };
+
+
+
+// static init
+// 0 portable, 1 SSE2, 2 AVX
+int CompiledExpression::mImplementationLimit = 2;
+
+
+
+inline CompiledExpression::CompiledExpression( Expression *inExpression,
+                                               Variable **inVariables,
+                                               int inNumVariables )
+    : mNumRegisters( 0 ) {
+
+    for( int i=0; i<inNumVariables; i++ ) {
+        addVariable( inVariables[i] );
+        }
+
+    mResult = compileNode( inExpression, 0 );
+
+    mNumInstructions = mInstructions.size();
+
+    if( mNumInstructions > 0 ) {
+        // the root is always compiled last, so its instruction can
+        // write straight to the output values
+        mInstructions.getElement( mNumInstructions - 1 )->destRegister = -1;
+        }
+    mProgram = mInstructions.getElementArray();
+
+    mRegisters = new double[ mNumRegisters * BLOCK_SIZE ];
+    // never read before being set, but keep lanes past the end of a
+    // partial block defined
+    memset( mRegisters, 0, mNumRegisters * BLOCK_SIZE * sizeof( double ) );
+
+    int numConstants = mConstantValues.size();
+    mConstants = new double[ numConstants * 4 ];
+    for( int c=0; c<numConstants; c++ ) {
+        for( int j=0; j<4; j++ ) {
+            mConstants[ c * 4 + j ] = mConstantValues.getElementDirect( c );
+            }
+        }
+
+    int numVariables = mVariables.size();
+    mBlockVariables = new double*[ numVariables ];
+    mSingleValues = new double[ numVariables ];
+    mSingleValuePointers = new double*[ numVariables ];
+
+    for( int v=0; v<numVariables; v++ ) {
+        mSingleValuePointers[v] = &( mSingleValues[v] );
+        }
+
+    mSingleRegisters = new double[ mNumRegisters ];
+    }
+
+
+
+inline CompiledExpression::~CompiledExpression() {
+    for( int i=0; i<mTrees.size(); i++ ) {
+        delete mTrees.getElementDirect( i );
+        }
+
+    delete [] mRegisters;
+    delete [] mConstants;
+    delete [] mBlockVariables;
+    delete [] mSingleValues;
+    delete [] mSingleValuePointers;
+    delete [] mSingleRegisters;
+    delete [] mProgram;
+    }
+
+
+
+inline int CompiledExpression::getNumVariables() {
+    return mVariables.size();
+    }
+
+
+
+inline Variable *CompiledExpression::getVariable( int inIndex ) {
+    return mVariables.getElementDirect( inIndex );
+    }
+
+
+
+inline int CompiledExpression::getNumInstructions() {
+    return mNumInstructions;
+    }
+
+
+
+inline int CompiledExpression::getNumRegisters() {
+    return mNumRegisters;
+    }
+
+
+
+inline int CompiledExpression::getOperation( Expression *inExpression ) {
+    long id = inExpression->getID();
+
+    if( id == NegateExpression::staticGetID() ) {
+        return NEGATE;
+        }
+    else if( id == InvertExpression::staticGetID() ) {
+        return INVERT;
+        }
+    else if( id == SinExpression::staticGetID() ) {
+        return SIN;
+        }
+    else if( id == CosExpression::staticGetID() ) {
+        return COS;
+        }
+    else if( id == TanExpression::staticGetID() ) {
+        return TAN;
+        }
+    else if( id == LnExpression::staticGetID() ) {
+        return LN;
+        }
+    else if( id == SqrtExpression::staticGetID() ) {
+        return SQRT;
+        }
+    else if( id == SumExpression::staticGetID() ) {
+        return SUM;
+        }
+    else if( id == ProductExpression::staticGetID() ) {
+        return PRODUCT;
+        }
+    else if( id == PowerExpression::staticGetID() ) {
+        return POWER;
+        }
+    else if( id == ComparisonExpression::staticGetID() ) {
+        int comparison =
+            ( (ComparisonExpression *)inExpression )->getComparison();
+
+        if( comparison >= ComparisonExpression::GREATER_THAN &&
+            comparison <= ComparisonExpression::NOT_EQUAL_TO ) {
+            return GREATER_THAN + comparison;
+            }
+        }
+    else if( id == BinaryLogicExpression::staticGetID() ) {
+        int logicOperation =
+            ( (BinaryLogicExpression *)inExpression )->getLogicOperation();
+
+        if( logicOperation >= BinaryLogicExpression::LOGIC_AND &&
+            logicOperation <= BinaryLogicExpression::LOGIC_XOR ) {
+            return LOGIC_AND + logicOperation;
+            }
+        }
+
+    // unknown, including comparison and logic expressions with
+    // operations that they do not know either
+    return -1;
+    }
+
+
+
+inline int CompiledExpression::addVariable( Variable *inVariable ) {
+    int index = mVariables.getElementIndex( inVariable );
+
+    if( index == -1 ) {
+        mVariables.push_back( inVariable );
+        index = mVariables.size() - 1;
+        }
+    return index;
+    }
+
+
+
+inline void CompiledExpression::addTreeVariables( Expression *inExpression ) {
+    long id = inExpression->getID();
+
+    if( id == VariableExpression::staticGetID() ) {
+        addVariable( ( (VariableExpression *)inExpression )->getVariable() );
+        }
+    else if( id == MultiConstantArgumentExpression::staticGetID() ) {
+        // its arguments are its constants, not its subexpressions
+        addTreeVariables( ( (MultiConstantArgumentExpression *)inExpression )
+                          ->getWrappedExpression() );
+        }
+    else {
+        for( int i=0; i<inExpression->getNumArguments(); i++ ) {
+            Expression *argument = inExpression->getArgument( i );
+
+            if( argument != NULL ) {
+                addTreeVariables( argument );
+                }
+            }
+        }
+    }
+
+
+
+inline CompiledOperand CompiledExpression::addConstant( double inValue ) {
+    CompiledOperand operand;
+    operand.kind = CONSTANT_OPERAND;
+    operand.index = mConstantValues.size();
+
+    mConstantValues.push_back( inValue );
+
+    return operand;
+    }
+
+
+
+inline CompiledOperand CompiledExpression::addInstruction(
+    int inOperation, CompiledOperand inA, CompiledOperand inB,
+    int inDestRegister ) {
+
+    CompiledInstruction instruction;
+    instruction.operation = inOperation;
+    instruction.a = inA;
+    instruction.b = inB;
+    instruction.destRegister = inDestRegister;
+
+    mInstructions.push_back( instruction );
+
+    if( inDestRegister >= mNumRegisters ) {
+        mNumRegisters = inDestRegister + 1;
+        }
+
+    CompiledOperand result;
+    result.kind = REGISTER_OPERAND;
+    result.index = inDestRegister;
+
+    return result;
+    }
+
+
+
+inline CompiledOperand CompiledExpression::compileNode(
+    Expression *inExpression, int inFirstFreeRegister ) {
+
+    long id = inExpression->getID();
+
+    if( id == ConstantExpression::staticGetID() ) {
+        return addConstant(
+            ( (ConstantExpression *)inExpression )->getValue() );
+        }
+    else if( id == FixedConstantExpression::staticGetID() ) {
+        return addConstant(
+            ( (FixedConstantExpression *)inExpression )->getValue() );
+        }
+    else if( id == MultiConstantArgumentExpression::staticGetID() ) {
+        return compileNode(
+            ( (MultiConstantArgumentExpression *)inExpression )
+            ->getWrappedExpression(),
+            inFirstFreeRegister );
+        }
+    else if( id == VariableExpression::staticGetID() ) {
+        CompiledOperand operand;
+        operand.kind = VARIABLE_OPERAND;
+        operand.index = addVariable(
+            ( (VariableExpression *)inExpression )->getVariable() );
+        return operand;
+        }
+
+
+    int operation = getOperation( inExpression );
+
+    if( operation == -1 ) {
+        addTreeVariables( inExpression );
+
+        CompiledOperand tree;
+        tree.kind = TREE_OPERAND;
+        tree.index = mTrees.size();
+
+        mTrees.push_back( inExpression->copy() );
+
+        return addInstruction( EVALUATE_TREE, tree, tree,
+                               inFirstFreeRegister );
+        }
+
+
+    CompiledOperand a = compileNode( inExpression->getArgument( 0 ),
+                                     inFirstFreeRegister );
+    // unused placeholder for unary operations
+    CompiledOperand b = a;
+
+    if( inExpression->getNumArguments() == 2 ) {
+        int nextFreeRegister = inFirstFreeRegister;
+        if( a.kind == REGISTER_OPERAND ) {
+            nextFreeRegister++;
+            }
+        b = compileNode( inExpression->getArgument( 1 ), nextFreeRegister );
+        }
+
+    if( a.kind == CONSTANT_OPERAND && b.kind == CONSTANT_OPERAND ) {
+        // fold with the same code that would run for it
+        double result = applyOperation(
+            operation,
+            mConstantValues.getElementDirect( a.index ),
+            mConstantValues.getElementDirect( b.index ) );
+
+        // drop folded arguments, which are always the newest constants
+        mConstantValues.deleteElement( mConstantValues.size() - 1 );
+        if( b.index != a.index ) {
+            mConstantValues.deleteElement( mConstantValues.size() - 1 );
+            }
+
+        return addConstant( result );
+        }
+
+    return addInstruction( operation, a, b, inFirstFreeRegister );
+    }
+
+
+
+inline void CompiledExpression::getOperandValues( CompiledOperand inOperand,
+                                                  const double **outValues,
+                                                  int *outStep ) {
+    switch( inOperand.kind ) {
+        case REGISTER_OPERAND:
+            *outValues = &( mRegisters[ inOperand.index * BLOCK_SIZE ] );
+            *outStep = 1;
+            break;
+        case VARIABLE_OPERAND:
+            *outValues = mBlockVariables[ inOperand.index ];
+            *outStep = 1;
+            break;
+        default:
+            *outValues = &( mConstants[ inOperand.index * 4 ] );
+            *outStep = 0;
+            break;
+        }
+    }
+
+
+
+inline double CompiledExpression::getSingleValue(
+    CompiledOperand inOperand ) {
+
+    switch( inOperand.kind ) {
+        case REGISTER_OPERAND:
+            return mSingleRegisters[ inOperand.index ];
+        case VARIABLE_OPERAND:
+            return mSingleValues[ inOperand.index ];
+        default:
+            return mConstants[ inOperand.index * 4 ];
+        }
+    }
+
+
+
+inline void CompiledExpression::runBlock( double **inVariableValues,
+                                          double *outValues,
+                                          int inNumValues,
+                                          int inImplementation ) {
+
+    int numVariables = mVariables.size();
+    for( int v=0; v<numVariables; v++ ) {
+        mBlockVariables[v] = inVariableValues[v];
+        }
+
+    if( mNumInstructions == 0 ) {
+        const double *values;
+        int step;
+        getOperandValues( mResult, &values, &step );
+
+        for( int i=0; i<inNumValues; i++ ) {
+            outValues[i] = values[ i * step ];
+            }
+        return;
+        }
+
+
+    for( int p=0; p<mNumInstructions; p++ ) {
+        CompiledInstruction *instruction = &( mProgram[p] );
+
+        double *dest = outValues;
+        if( instruction->destRegister != -1 ) {
+            dest = &( mRegisters[ instruction->destRegister * BLOCK_SIZE ] );
+            }
+
+        if( instruction->operation == EVALUATE_TREE ) {
+            evaluateTree( mTrees.getElementDirect( instruction->a.index ),
+                          inVariableValues, dest, inNumValues );
+            continue;
+            }
+
+        const double *a, *b;
+        int aStep, bStep;
+        getOperandValues( instruction->a, &a, &aStep );
+        getOperandValues( instruction->b, &b, &bStep );
+
+        int numDone = 0;
+
+#ifdef CPU_FEATURES_X86
+        if( inImplementation >= 2 ) {
+            numDone = runOperationAVX( instruction->operation,
+                                       a, aStep, b, bStep,
+                                       dest, inNumValues );
+            }
+        else if( inImplementation == 1 ) {
+            numDone = runOperationSSE2( instruction->operation,
+                                        a, aStep, b, bStep,
+                                        dest, inNumValues );
+            }
+#endif
+
+        runOperationPortable( instruction->operation, a, aStep, b, bStep,
+                              dest, numDone, inNumValues );
+        }
+    }
+
+
+
+inline void CompiledExpression::evaluateTree( Expression *inTree,
+                                              double **inVariableValues,
+                                              double *outValues,
+                                              int inNumValues ) {
+    int numVariables = mVariables.size();
+
+    for( int i=0; i<inNumValues; i++ ) {
+        for( int v=0; v<numVariables; v++ ) {
+            mVariables.getElementDirect( v )->setValue(
+                inVariableValues[v][i] );
+            }
+        outValues[i] = inTree->evaluate();
+        }
+    }
+
+
+
+inline double CompiledExpression::evaluate() {
+    int numVariables = mVariables.size();
+
+    for( int v=0; v<numVariables; v++ ) {
+        mSingleValues[v] = mVariables.getElementDirect( v )->getValue();
+        }
+
+    if( mNumInstructions == 0 ) {
+        return getSingleValue( mResult );
+        }
+
+    double result = 0;
+
+    for( int p=0; p<mNumInstructions; p++ ) {
+        CompiledInstruction *instruction = &( mProgram[p] );
+
+        double value;
+
+        if( instruction->operation == EVALUATE_TREE ) {
+            evaluateTree( mTrees.getElementDirect( instruction->a.index ),
+                          mSingleValuePointers, &value, 1 );
+            }
+        else {
+            value = applyOperation( instruction->operation,
+                                    getSingleValue( instruction->a ),
+                                    getSingleValue( instruction->b ) );
+            }
+
+        if( instruction->destRegister == -1 ) {
+            result = value;
+            }
+        else {
+            mSingleRegisters[ instruction->destRegister ] = value;
+            }
+        }
+
+    return result;
+    }
+
+
+
+inline void CompiledExpression::evaluate( double **inVariableValues,
+                                          double *outValues,
+                                          int inNumValues ) {
+    int numVariables = mVariables.size();
+    double **blockValues = new double*[ numVariables ];
+
+    int implementation = getKernelImplementation();
+
+    for( int start=0; start<inNumValues; start += BLOCK_SIZE ) {
+        int numValues = inNumValues - start;
+        if( numValues > BLOCK_SIZE ) {
+            numValues = BLOCK_SIZE;
+            }
+
+        for( int v=0; v<numVariables; v++ ) {
+            blockValues[v] = &( inVariableValues[v][ start ] );
+            }
+
+        runBlock( blockValues, &( outValues[ start ] ), numValues,
+                  implementation );
+        }
+
+    delete [] blockValues;
+    }
+
+
+
+inline void CompiledExpression::print() {
+    const char *names[20] = { "-", "1 /", "sin", "cos", "tan", "ln", "sqrt",
+                              "+", "*", "^",
+                              ">", "<", ">=", "<=", "==", "!=",
+                              "and", "or", "xor", "tree" };
+
+    for( int p=0; p<mNumInstructions; p++ ) {
+        CompiledInstruction *instruction = &( mProgram[p] );
+
+        if( instruction->destRegister == -1 ) {
+            printf( "  out = " );
+            }
+        else {
+            printf( "  r%d = ", instruction->destRegister );
+            }
+
+        CompiledOperand operands[2] = { instruction->a, instruction->b };
+        int numOperands = 2;
+
+        if( instruction->operation < SUM ||
+            instruction->operation == EVALUATE_TREE ) {
+            numOperands = 1;
+            printf( "%s ", names[ instruction->operation ] );
+            }
+
+        for( int o=0; o<numOperands; o++ ) {
+            if( o == 1 ) {
+                printf( " %s ", names[ instruction->operation ] );
+                }
+
+            CompiledOperand operand = operands[o];
+
+            switch( operand.kind ) {
+                case REGISTER_OPERAND:
+                    printf( "r%d", operand.index );
+                    break;
+                case VARIABLE_OPERAND: {
+                    char *name =
+                        mVariables.getElementDirect( operand.index )
+                        ->getName();
+                    printf( "%s", name );
+                    delete [] name;
+                    break;
+                    }
+                case CONSTANT_OPERAND:
+                    printf( "%g", mConstantValues.getElementDirect(
+                                operand.index ) );
+                    break;
+                default:
+                    printf( "t%d", operand.index );
+                    break;
+                }
+            }
+        printf( "\n" );
+        }
+
+    if( mNumInstructions == 0 ) {
+        if( mResult.kind == CONSTANT_OPERAND ) {
+            printf( "  out = %g\n",
+                    mConstantValues.getElementDirect( mResult.index ) );
+            }
+        else {
+            char *name = mVariables.getElementDirect( mResult.index )
+                ->getName();
+            printf( "  out = %s\n", name );
+            delete [] name;
+            }
+        }
+    }
+
+
+
+inline int CompiledExpression::getKernelImplementation() {
+    const CPUFeatures *features = getCPUFeatures();
+
+    int level = 0;
+    if( features->sse2 ) {
+        level = 1;
+        }
+    if( features->avx ) {
+        level = 2;
+        }
+
+    return limitImplementation( level, mImplementationLimit );
+    }
+
+
+
+inline void CompiledExpression::setKernelImplementationLimit(
+    int inMaxImplementation ) {
+
+    mImplementationLimit = inMaxImplementation;
+    }
+
+
+
+// Each case here and in runOperationPortable does what the matching
+// Expression::evaluate does, so that results and folded constants match
+// the tree exactly.
+inline double CompiledExpression::applyOperation( int inOperation,
+                                                  double inA, double inB ) {
+    switch( inOperation ) {
+        case NEGATE:
+            return -( inA );
+        case INVERT:
+            return 1 / ( inA );
+        case SIN:
+            return sin( inA );
+        case COS:
+            return cos( inA );
+        case TAN:
+            return tan( inA );
+        case LN:
+            return log( inA );
+        case SQRT:
+            return sqrt( inA );
+        case SUM:
+            return inA + inB;
+        case PRODUCT:
+            return inA * inB;
+        case POWER:
+            return pow( inA, inB );
+        case GREATER_THAN:
+            return ( inA > inB );
+        case LESS_THAN:
+            return ( inA < inB );
+        case GREATER_THAN_OR_EQUAL_TO:
+            return ( inA >= inB );
+        case LESS_THAN_OR_EQUAL_TO:
+            return ( inA <= inB );
+        case EQUAL_TO:
+            return ( inA == inB );
+        case NOT_EQUAL_TO:
+            return ( inA != inB );
+        case LOGIC_AND:
+            return ( inA > 0 && inB > 0 );
+        case LOGIC_OR:
+            return ( inA > 0 || inB > 0 );
+        case LOGIC_XOR:
+            return ( ( inA > 0 && inB <= 0 ) || ( inA <= 0 && inB > 0 ) );
+        default:
+            return 0;
+        }
+    }
+
+
+
+inline void CompiledExpression::runOperationPortable(
+    int inOperation, const double *inA, int inAStep,
+    const double *inB, int inBStep, double *outValues,
+    int inStart, int inEnd ) {
+
+    switch( inOperation ) {
+        case NEGATE:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = -( inA[ i * inAStep ] );
+                }
+            break;
+        case INVERT:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = 1 / ( inA[ i * inAStep ] );
+                }
+            break;
+        case SIN:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = sin( inA[ i * inAStep ] );
+                }
+            break;
+        case COS:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = cos( inA[ i * inAStep ] );
+                }
+            break;
+        case TAN:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = tan( inA[ i * inAStep ] );
+                }
+            break;
+        case LN:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = log( inA[ i * inAStep ] );
+                }
+            break;
+        case SQRT:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = sqrt( inA[ i * inAStep ] );
+                }
+            break;
+        case SUM:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = inA[ i * inAStep ] + inB[ i * inBStep ];
+                }
+            break;
+        case PRODUCT:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = inA[ i * inAStep ] * inB[ i * inBStep ];
+                }
+            break;
+        case POWER:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = pow( inA[ i * inAStep ], inB[ i * inBStep ] );
+                }
+            break;
+        case GREATER_THAN:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = ( inA[ i * inAStep ] > inB[ i * inBStep ] );
+                }
+            break;
+        case LESS_THAN:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = ( inA[ i * inAStep ] < inB[ i * inBStep ] );
+                }
+            break;
+        case GREATER_THAN_OR_EQUAL_TO:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = ( inA[ i * inAStep ] >= inB[ i * inBStep ] );
+                }
+            break;
+        case LESS_THAN_OR_EQUAL_TO:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = ( inA[ i * inAStep ] <= inB[ i * inBStep ] );
+                }
+            break;
+        case EQUAL_TO:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = ( inA[ i * inAStep ] == inB[ i * inBStep ] );
+                }
+            break;
+        case NOT_EQUAL_TO:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = ( inA[ i * inAStep ] != inB[ i * inBStep ] );
+                }
+            break;
+        case LOGIC_AND:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = ( inA[ i * inAStep ] > 0 &&
+                                 inB[ i * inBStep ] > 0 );
+                }
+            break;
+        case LOGIC_OR:
+            for( int i=inStart; i<inEnd; i++ ) {
+                outValues[i] = ( inA[ i * inAStep ] > 0 ||
+                                 inB[ i * inBStep ] > 0 );
+                }
+            break;
+        case LOGIC_XOR:
+            for( int i=inStart; i<inEnd; i++ ) {
+                double valA = inA[ i * inAStep ];
+                double valB = inB[ i * inBStep ];
+                outValues[i] = ( ( valA > 0 && valB <= 0 ) ||
+                                 ( valA <= 0 && valB > 0 ) );
+                }
+            break;
+        }
+    }
+
+
+
+#ifdef CPU_FEATURES_X86
+
+
+inline int CompiledExpression::runOperationSSE2(
+    int inOperation, const double *inA, int inAStep,
+    const double *inB, int inBStep, double *outValues, int inCount ) {
+
+    __m128d zero = _mm_setzero_pd();
+    __m128d one = _mm_set1_pd( 1.0 );
+    __m128d signBit = _mm_set1_pd( -0.0 );
+
+    int i = 0;
+
+#define LOAD_A _mm_loadu_pd( &( inA[ i * inAStep ] ) )
+#define LOAD_B _mm_loadu_pd( &( inB[ i * inBStep ] ) )
+#define STORE( v ) _mm_storeu_pd( &( outValues[i] ), v )
+#define FOR_EACH_PAIR for( ; i + 2 <= inCount; i += 2 )
+
+    switch( inOperation ) {
+        case NEGATE:
+            FOR_EACH_PAIR {
+                STORE( _mm_xor_pd( LOAD_A, signBit ) );
+                }
+            break;
+        case INVERT:
+            FOR_EACH_PAIR {
+                STORE( _mm_div_pd( one, LOAD_A ) );
+                }
+            break;
+        case SQRT:
+            FOR_EACH_PAIR {
+                STORE( _mm_sqrt_pd( LOAD_A ) );
+                }
+            break;
+        case SUM:
+            FOR_EACH_PAIR {
+                STORE( _mm_add_pd( LOAD_A, LOAD_B ) );
+                }
+            break;
+        case PRODUCT:
+            FOR_EACH_PAIR {
+                STORE( _mm_mul_pd( LOAD_A, LOAD_B ) );
+                }
+            break;
+        case GREATER_THAN:
+            FOR_EACH_PAIR {
+                STORE( _mm_and_pd( _mm_cmpgt_pd( LOAD_A, LOAD_B ), one ) );
+                }
+            break;
+        case LESS_THAN:
+            FOR_EACH_PAIR {
+                STORE( _mm_and_pd( _mm_cmplt_pd( LOAD_A, LOAD_B ), one ) );
+                }
+            break;
+        case GREATER_THAN_OR_EQUAL_TO:
+            FOR_EACH_PAIR {
+                STORE( _mm_and_pd( _mm_cmpge_pd( LOAD_A, LOAD_B ), one ) );
+                }
+            break;
+        case LESS_THAN_OR_EQUAL_TO:
+            FOR_EACH_PAIR {
+                STORE( _mm_and_pd( _mm_cmple_pd( LOAD_A, LOAD_B ), one ) );
+                }
+            break;
+        case EQUAL_TO:
+            FOR_EACH_PAIR {
+                STORE( _mm_and_pd( _mm_cmpeq_pd( LOAD_A, LOAD_B ), one ) );
+                }
+            break;
+        case NOT_EQUAL_TO:
+            // true for NaN, as != is
+            FOR_EACH_PAIR {
+                STORE( _mm_and_pd( _mm_cmpneq_pd( LOAD_A, LOAD_B ), one ) );
+                }
+            break;
+        case LOGIC_AND:
+            FOR_EACH_PAIR {
+                __m128d bothPositive = _mm_and_pd(
+                    _mm_cmpgt_pd( LOAD_A, zero ),
+                    _mm_cmpgt_pd( LOAD_B, zero ) );
+                STORE( _mm_and_pd( bothPositive, one ) );
+                }
+            break;
+        case LOGIC_OR:
+            FOR_EACH_PAIR {
+                __m128d eitherPositive = _mm_or_pd(
+                    _mm_cmpgt_pd( LOAD_A, zero ),
+                    _mm_cmpgt_pd( LOAD_B, zero ) );
+                STORE( _mm_and_pd( eitherPositive, one ) );
+                }
+            break;
+        case LOGIC_XOR:
+            // NaN is neither > 0 nor <= 0
+            FOR_EACH_PAIR {
+                __m128d a = LOAD_A;
+                __m128d b = LOAD_B;
+                __m128d onlyA = _mm_and_pd( _mm_cmpgt_pd( a, zero ),
+                                            _mm_cmple_pd( b, zero ) );
+                __m128d onlyB = _mm_and_pd( _mm_cmple_pd( a, zero ),
+                                            _mm_cmpgt_pd( b, zero ) );
+                STORE( _mm_and_pd( _mm_or_pd( onlyA, onlyB ), one ) );
+                }
+            break;
+        }
+
+#undef LOAD_A
+#undef LOAD_B
+#undef STORE
+#undef FOR_EACH_PAIR
+
+    return i;
+    }
+
+
+
+inline int CompiledExpression::runOperationAVX(
+    int inOperation, const double *inA, int inAStep,
+    const double *inB, int inBStep, double *outValues, int inCount ) {
+
+    __m256d zero = _mm256_setzero_pd();
+    __m256d one = _mm256_set1_pd( 1.0 );
+    __m256d signBit = _mm256_set1_pd( -0.0 );
+
+    int i = 0;
+
+#define LOAD_A _mm256_loadu_pd( &( inA[ i * inAStep ] ) )
+#define LOAD_B _mm256_loadu_pd( &( inB[ i * inBStep ] ) )
+#define STORE( v ) _mm256_storeu_pd( &( outValues[i] ), v )
+#define FOR_EACH_QUAD for( ; i + 4 <= inCount; i += 4 )
+#define COMPARE( predicate )                                            \
+    FOR_EACH_QUAD {                                                     \
+        STORE( _mm256_and_pd( _mm256_cmp_pd( LOAD_A, LOAD_B,            \
+                                             predicate ), one ) );      \
+        }
+
+    switch( inOperation ) {
+        case NEGATE:
+            FOR_EACH_QUAD {
+                STORE( _mm256_xor_pd( LOAD_A, signBit ) );
+                }
+            break;
+        case INVERT:
+            FOR_EACH_QUAD {
+                STORE( _mm256_div_pd( one, LOAD_A ) );
+                }
+            break;
+        case SQRT:
+            FOR_EACH_QUAD {
+                STORE( _mm256_sqrt_pd( LOAD_A ) );
+                }
+            break;
+        case SUM:
+            FOR_EACH_QUAD {
+                STORE( _mm256_add_pd( LOAD_A, LOAD_B ) );
+                }
+            break;
+        case PRODUCT:
+            FOR_EACH_QUAD {
+                STORE( _mm256_mul_pd( LOAD_A, LOAD_B ) );
+                }
+            break;
+        // ordered compares are false for NaN, as C's are, except !=
+        case GREATER_THAN:
+            COMPARE( _CMP_GT_OQ );
+            break;
+        case LESS_THAN:
+            COMPARE( _CMP_LT_OQ );
+            break;
+        case GREATER_THAN_OR_EQUAL_TO:
+            COMPARE( _CMP_GE_OQ );
+            break;
+        case LESS_THAN_OR_EQUAL_TO:
+            COMPARE( _CMP_LE_OQ );
+            break;
+        case EQUAL_TO:
+            COMPARE( _CMP_EQ_OQ );
+            break;
+        case NOT_EQUAL_TO:
+            COMPARE( _CMP_NEQ_UQ );
+            break;
+        case LOGIC_AND:
+            FOR_EACH_QUAD {
+                __m256d bothPositive = _mm256_and_pd(
+                    _mm256_cmp_pd( LOAD_A, zero, _CMP_GT_OQ ),
+                    _mm256_cmp_pd( LOAD_B, zero, _CMP_GT_OQ ) );
+                STORE( _mm256_and_pd( bothPositive, one ) );
+                }
+            break;
+        case LOGIC_OR:
+            FOR_EACH_QUAD {
+                __m256d eitherPositive = _mm256_or_pd(
+                    _mm256_cmp_pd( LOAD_A, zero, _CMP_GT_OQ ),
+                    _mm256_cmp_pd( LOAD_B, zero, _CMP_GT_OQ ) );
+                STORE( _mm256_and_pd( eitherPositive, one ) );
+                }
+            break;
+        case LOGIC_XOR:
+            FOR_EACH_QUAD {
+                __m256d a = LOAD_A;
+                __m256d b = LOAD_B;
+                __m256d onlyA = _mm256_and_pd(
+                    _mm256_cmp_pd( a, zero, _CMP_GT_OQ ),
+                    _mm256_cmp_pd( b, zero, _CMP_LE_OQ ) );
+                __m256d onlyB = _mm256_and_pd(
+                    _mm256_cmp_pd( a, zero, _CMP_LE_OQ ),
+                    _mm256_cmp_pd( b, zero, _CMP_GT_OQ ) );
+                STORE( _mm256_and_pd( _mm256_or_pd( onlyA, onlyB ), one ) );
+                }
+            break;
+        }
+
+#undef LOAD_A
+#undef LOAD_B
+#undef STORE
+#undef FOR_EACH_QUAD
+#undef COMPARE
+
+    return i;
+    }
+
+
+#endif
+
+
+
+#endif
@@ -0,0 +1,510 @@
+// Checks CompiledExpression against Expression::evaluate on random
+// expression trees, for every kernel implementation, and through an
+// ExpressionSerializer round trip.  Then measures evaluations per second
+// of a genetic-programming style expression over 1M points, with the
+// tree walker and with the compiled program.
+//
+// Usage:  compiledExpressionBenchmark
+
+
+#include "CompiledExpression.h"
+#include "ExpressionSerializer.h"
+#include "RandomExpressionFactory.h"
+#include "UnaryOperationExpression.h"
+
+#include "minorGems/io/PipedStream.h"
+#include "minorGems/util/random/XoshiroRandomSource.h"
+#include "minorGems/system/Time.h"
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+int failures = 0;
+
+
+void check( char inPassed, const char *inWhat, int inLevel ) {
+    if( !inPassed ) {
+        printf( "FAILED:  %s, implementation %d\n", inWhat, inLevel );
+        failures++;
+        }
+    }
+
+
+
+// bit for bit, except that any NaN matches any other, since the sign of
+// a NaN from two NaN arguments depends on which one the C compiler
+// happens to put first
+char same( double inA, double inB ) {
+    if( isnan( inA ) && isnan( inB ) ) {
+        return true;
+        }
+    return memcmp( &inA, &inB, sizeof( double ) ) == 0;
+    }
+
+
+
+// an expression type that the compiler does not know, to exercise the
+// fallback to the tree
+class AbsExpression : public UnaryOperationExpression {
+
+    public:
+
+        AbsExpression( Expression *inArgument )
+            : UnaryOperationExpression( inArgument ) {
+            }
+
+        virtual double evaluate() {
+            return fabs( mArgument->evaluate() );
+            }
+
+        virtual long getID() {
+            return 100;
+            }
+
+        virtual void print() {
+            printf( "abs(" );
+            mArgument->print();
+            printf( " )" );
+            }
+
+        virtual Expression *copy() {
+            return new AbsExpression( mArgument->copy() );
+            }
+    };
+
+
+
+Expression *makeLeaf( Variable **inVariables, int inNumVariables,
+                      RandomSource *inRandSource ) {
+    int pick = inRandSource->getRandomBoundedInt( 0, 9 );
+
+    if( pick < 5 ) {
+        return new VariableExpression(
+            inVariables[ inRandSource->getRandomBoundedInt(
+                0, inNumVariables - 1 ) ] );
+        }
+    else if( pick < 9 ) {
+        return new ConstantExpression(
+            inRandSource->getRandomBoundedDouble( -4, 4 ) );
+        }
+    else {
+        return new FixedConstantExpression(
+            inRandSource->getRandomBoundedInt( -2, 2 ) );
+        }
+    }
+
+
+
+// the first 5 types have vector kernels, the first 12 are all of the
+// types that the compiler knows, and the rest test fallbacks
+int arithmeticTypes = 5;
+int knownTypes = 12;
+int allTypes = 17;
+
+
+Expression *makeExpression( int inDepth, int inNumTypes,
+                            Variable **inVariables, int inNumVariables,
+                            RandomSource *inRandSource ) {
+
+    if( inDepth == 0 || inRandSource->getRandomBoundedInt( 0, 9 ) == 0 ) {
+        return makeLeaf( inVariables, inNumVariables, inRandSource );
+        }
+
+    int type = inRandSource->getRandomBoundedInt( 0, inNumTypes - 1 );
+
+    Expression *a = makeExpression( inDepth - 1, inNumTypes,
+                                    inVariables, inNumVariables,
+                                    inRandSource );
+
+    // binary operations second, so they can take b
+    switch( type ) {
+        case 0:
+            return new SumExpression(
+                a, makeExpression( inDepth - 1, inNumTypes,
+                                   inVariables, inNumVariables,
+                                   inRandSource ) );
+        case 1:
+            return new ProductExpression(
+                a, makeExpression( inDepth - 1, inNumTypes,
+                                   inVariables, inNumVariables,
+                                   inRandSource ) );
+        case 2:
+            return new NegateExpression( a );
+        case 3:
+            return new ComparisonExpression(
+                inRandSource->getRandomBoundedInt( 0, 5 ),
+                a, makeExpression( inDepth - 1, inNumTypes,
+                                   inVariables, inNumVariables,
+                                   inRandSource ) );
+        case 4:
+            return new BinaryLogicExpression(
+                inRandSource->getRandomBoundedInt( 0, 2 ),
+                a, makeExpression( inDepth - 1, inNumTypes,
+                                   inVariables, inNumVariables,
+                                   inRandSource ) );
+        case 5:
+            return new PowerExpression(
+                a, makeExpression( inDepth - 1, inNumTypes,
+                                   inVariables, inNumVariables,
+                                   inRandSource ) );
+        case 6:
+            return new InvertExpression( a );
+        case 7:
+            return new SinExpression( a );
+        case 8:
+            return new CosExpression( a );
+        case 9:
+            return new TanExpression( a );
+        case 10:
+            return new LnExpression( a );
+        case 11:
+            return new SqrtExpression( a );
+        case 12:
+            return new AbsExpression( a );
+        case 13:
+            return new MultiConstantArgumentExpression( a );
+        default:
+            // common ones again
+            if( inRandSource->getRandomBoolean() ) {
+                return new SumExpression(
+                    a, makeExpression( inDepth - 1, inNumTypes,
+                                       inVariables, inNumVariables,
+                                       inRandSource ) );
+                }
+            return new ProductExpression(
+                a, makeExpression( inDepth - 1, inNumTypes,
+                                   inVariables, inNumVariables,
+                                   inRandSource ) );
+        }
+    }
+
+
+
+int countNodes( Expression *inExpression ) {
+    if( inExpression->getID() == MultiConstantArgumentExpression::staticGetID()
+        ) {
+        return 1 + countNodes(
+            ( (MultiConstantArgumentExpression *)inExpression )
+            ->getWrappedExpression() );
+        }
+
+    int count = 1;
+    for( int i=0; i<inExpression->getNumArguments(); i++ ) {
+        count += countNodes( inExpression->getArgument( i ) );
+        }
+    return count;
+    }
+
+
+
+// tree walker over arrays of values
+void evaluateTree( Expression *inExpression, Variable **inVariables,
+                   int inNumVariables, double **inValues,
+                   double *outValues, int inNumValues ) {
+    for( int i=0; i<inNumValues; i++ ) {
+        for( int v=0; v<inNumVariables; v++ ) {
+            inVariables[v]->setValue( inValues[v][i] );
+            }
+        outValues[i] = inExpression->evaluate();
+        }
+    }
+
+
+
+void checkImplementation( int inLevel, RandomSource *inRandSource ) {
+    CompiledExpression::setKernelImplementationLimit( inLevel );
+
+    Variable x( (char *)"x", 0 );
+    Variable y( (char *)"y", 0 );
+    Variable z( (char *)"z", 0 );
+    Variable *variables[3] = { &x, &y, &z };
+
+    // odd size to exercise partial blocks and vector tails
+    int n = 1003;
+
+    double *values[3];
+    for( int v=0; v<3; v++ ) {
+        values[v] = new double[n];
+        for( int i=0; i<n; i++ ) {
+            values[v][i] = inRandSource->getRandomBoundedDouble( -3, 3 );
+            }
+        }
+    // edge values
+    double edges[7] = { 0, -0.0, 1, -1, NAN, INFINITY, -INFINITY };
+    for( int i=0; i<7; i++ ) {
+        values[0][ 10 + i ] = edges[i];
+        values[1][ 20 + i * 3 ] = edges[i];
+        values[2][ 500 + i ] = edges[ 6 - i ];
+        }
+
+    double *expected = new double[n];
+    double *results = new double[n];
+
+    char allMatch = true;
+    char singleMatch = true;
+
+    for( int e=0; e<200; e++ ) {
+        Expression *expression =
+            makeExpression( inRandSource->getRandomBoundedInt( 0, 7 ),
+                            ( e % 4 == 0 ) ? arithmeticTypes : allTypes,
+                            variables, 3, inRandSource );
+
+        CompiledExpression compiled( expression, variables, 3 );
+
+        evaluateTree( expression, variables, 3, values, expected, n );
+        compiled.evaluate( values, results, n );
+
+        for( int i=0; i<n; i++ ) {
+            if( !same( expected[i], results[i] ) ) {
+                if( allMatch ) {
+                    printf( "Expression %d, value %d:  %.17g, not %.17g\n",
+                            e, i, expected[i], results[i] );
+                    expression->print();
+                    printf( "\n" );
+                    compiled.print();
+                    }
+                allMatch = false;
+                break;
+                }
+            }
+
+        for( int i=0; i<n; i+=97 ) {
+            for( int v=0; v<3; v++ ) {
+                variables[v]->setValue( values[v][i] );
+                }
+            if( !same( compiled.evaluate(), expression->evaluate() ) ) {
+                singleMatch = false;
+                }
+            }
+
+        delete expression;
+        }
+    check( allMatch, "array evaluation", inLevel );
+    check( singleMatch, "single evaluation", inLevel );
+
+    for( int v=0; v<3; v++ ) {
+        delete [] values[v];
+        }
+    delete [] expected;
+    delete [] results;
+    }
+
+
+
+void checkCompiling( RandomSource *inRandSource ) {
+    Variable x( (char *)"x", 2 );
+    Variable y( (char *)"y", 3 );
+
+
+    // folds to one instruction:  x + ( 2 * 3 )
+    Expression *expression =
+        new SumExpression( new VariableExpression( &x ),
+                           new ProductExpression(
+                               new ConstantExpression( 2 ),
+                               new ConstantExpression( 3 ) ) );
+
+    CompiledExpression folded( expression );
+    check( folded.getNumInstructions() == 1, "fold constants", 0 );
+    check( folded.getNumVariables() == 1 &&
+           folded.getVariable( 0 ) == &x, "find variables", 0 );
+    check( folded.evaluate() == 8, "folded value", 0 );
+    delete expression;
+
+
+    // listed variables come first, unused or not
+    expression = new ProductExpression( new VariableExpression( &x ),
+                                        new VariableExpression( &y ) );
+    Variable *order[2] = { &y, &x };
+
+    CompiledExpression ordered( expression, order, 2 );
+    check( ordered.getNumVariables() == 2 &&
+           ordered.getVariable( 0 ) == &y &&
+           ordered.getVariable( 1 ) == &x, "variable order", 0 );
+
+    double yValues[2] = { 10, 20 };
+    double xValues[2] = { 1, 2 };
+    double *values[2] = { yValues, xValues };
+    double results[2];
+    ordered.evaluate( values, results, 2 );
+    check( results[0] == 10 && results[1] == 40, "ordered values", 0 );
+    delete expression;
+
+
+    // a serialized tree compiles as the original does, with no
+    // variables, all the way to a constant
+    for( int e=0; e<50; e++ ) {
+        RandomExpressionFactory factory( inRandSource );
+        Expression *original = new MultiConstantArgumentExpression(
+            factory.constructRandomExpression( 0.2, 0.3, 6, 5 ) );
+
+        PipedStream stream;
+        ExpressionSerializer::serializeExpression( original, &stream );
+
+        Expression *readBack;
+        ExpressionSerializer::deserializeExpression( &readBack, &stream );
+
+        CompiledExpression compiled( readBack );
+
+        if( compiled.getNumInstructions() != 0 ||
+            !same( compiled.evaluate(), original->evaluate() ) ) {
+            check( false, "serialized expression", 0 );
+            break;
+            }
+
+        delete original;
+        delete readBack;
+        }
+    }
+
+
+
+void benchmark( const char *inName, Expression *inExpression,
+                Variable **inVariables, double **inValues,
+                int inNumValues ) {
+
+    CompiledExpression compiled( inExpression, inVariables, 2 );
+
+    printf( "\n%s:  %d nodes, %d instructions, %d registers\n",
+            inName, countNodes( inExpression ),
+            compiled.getNumInstructions(), compiled.getNumRegisters() );
+
+    double *expected = new double[ inNumValues ];
+    double *results = new double[ inNumValues ];
+
+    evaluateTree( inExpression, inVariables, 2, inValues, expected,
+                  inNumValues );
+
+
+    const char *names[5] = { "tree walk",
+                             "compiled, one at a time",
+                             "compiled arrays, portable",
+                             "compiled arrays, SSE2",
+                             "compiled arrays, AVX" };
+
+    int maxLevel = CompiledExpression::getKernelImplementation();
+    double treeRate = 0;
+
+    for( int method=0; method<=2 + maxLevel; method++ ) {
+        if( method >= 2 ) {
+            CompiledExpression::setKernelImplementationLimit( method - 2 );
+            }
+
+        int numRounds = 0;
+        double startTime = Time::getCurrentTime();
+        double time = 0;
+
+        // at least 3 rounds and half a second
+        while( numRounds < 3 || time < 0.5 ) {
+            if( method == 0 ) {
+                evaluateTree( inExpression, inVariables, 2, inValues,
+                              results, inNumValues );
+                }
+            else if( method == 1 ) {
+                for( int i=0; i<inNumValues; i++ ) {
+                    inVariables[0]->setValue( inValues[0][i] );
+                    inVariables[1]->setValue( inValues[1][i] );
+                    results[i] = compiled.evaluate();
+                    }
+                }
+            else {
+                compiled.evaluate( inValues, results, inNumValues );
+                }
+
+            numRounds++;
+            time = Time::getCurrentTime() - startTime;
+            }
+
+        double rate = numRounds * inNumValues / time;
+        if( method == 0 ) {
+            treeRate = rate;
+            }
+
+        printf( "  %-32s %8.2f M/s  (%.2fx)\n", names[ method ],
+                rate / 1e6, rate / treeRate );
+
+        for( int i=0; i<inNumValues; i++ ) {
+            if( !same( expected[i], results[i] ) ) {
+                printf( "FAILED:  benchmark values, %s\n", names[ method ] );
+                failures++;
+                break;
+                }
+            }
+        }
+
+    delete [] expected;
+    delete [] results;
+    }
+
+
+
+int main() {
+    XoshiroRandomSource randSource( 12345 );
+
+    int maxLevel = CompiledExpression::getKernelImplementation();
+
+    checkCompiling( &randSource );
+
+    for( int level=0; level<=maxLevel; level++ ) {
+        checkImplementation( level, &randSource );
+        }
+
+    if( failures == 0 ) {
+        printf( "Compiled expressions match the tree for implementations "
+                "0 to %d\n", maxLevel );
+        }
+
+
+    int n = 1000000;
+
+    Variable x( (char *)"x", 0 );
+    Variable y( (char *)"y", 0 );
+    Variable *variables[2] = { &x, &y };
+
+    double *values[2];
+    for( int v=0; v<2; v++ ) {
+        values[v] = new double[n];
+        for( int i=0; i<n; i++ ) {
+            values[v][i] = randSource.getRandomBoundedDouble( -3, 3 );
+            }
+        }
+
+    printf( "\n%d points, evaluations per second:\n", n );
+
+
+    // fixed seeds, picked for trees of a typical size
+    XoshiroRandomSource arithmeticSource( 7 );
+    Expression *arithmetic = NULL;
+    while( arithmetic == NULL || countNodes( arithmetic ) < 40 ) {
+        delete arithmetic;
+        arithmetic = makeExpression( 6, arithmeticTypes, variables, 2,
+                                     &arithmeticSource );
+        }
+    benchmark( "Arithmetic and logic", arithmetic, variables, values, n );
+    delete arithmetic;
+
+
+    XoshiroRandomSource mixedSource( 11 );
+    Expression *mixed = NULL;
+    while( mixed == NULL || countNodes( mixed ) < 40 ) {
+        delete mixed;
+        mixed = makeExpression( 6, knownTypes, variables, 2, &mixedSource );
+        }
+    benchmark( "All operations", mixed, variables, values, n );
+    delete mixed;
+
+
+    for( int v=0; v<2; v++ ) {
+        delete [] values[v];
+        }
+
+    if( failures > 0 ) {
+        printf( "%d checks FAILED\n", failures );
+        return 1;
+        }
+    return 0;
+    }
@@ -0,0 +1,812 @@
+#include "PointCloud3D.h"
+
+#include <string.h>
+#include <math.h>
+
+
+
+#include "minorGems/system/cpuFeatures.h"
+
+
+
+// 0 portable, 1 SSE2, 2 AVX
+static int implementationLimit = 2;
+
+
+
+int getPointKernelImplementation() {
+    const CPUFeatures *features = getCPUFeatures();
+
+    int level = 0;
+    if( features->sse2 ) {
+        level = 1;
+        }
+    if( features->avx ) {
+        level = 2;
+        }
+
+    return limitImplementation( level, implementationLimit );
+    }
+
+
+
+void setPointKernelImplementationLimit( int inMaxImplementation ) {
+    implementationLimit = inMaxImplementation;
+    }
+
+
+
+// Every kernel does the same operations in the same order as the Vector3D
+// code, with no fused multiply-add, so all implementations give
+// identical results.  Vector kernels leave the last few points to the
+// portable kernels.
+
+
+// cos and sin for each axis of an Angle3D, for rotateAngles
+typedef struct AxisRotations {
+        char rotateX, rotateY, rotateZ;
+        double cosX, sinX;
+        double cosY, sinY;
+        double cosZ, sinZ;
+    } AxisRotations;
+
+
+
+// inMatrix is 3 rows of 4, translation in the last column
+static void affinePortable( const double *inMatrix, char inTranslate,
+                            double *inX, double *inY, double *inZ,
+                            int inStart, int inEnd ) {
+    const double *m = inMatrix;
+
+    for( int i=inStart; i<inEnd; i++ ) {
+        double x = inX[i];
+        double y = inY[i];
+        double z = inZ[i];
+
+        double newX = m[0] * x + m[1] * y + m[2] * z;
+        double newY = m[4] * x + m[5] * y + m[6] * z;
+        double newZ = m[8] * x + m[9] * y + m[10] * z;
+
+        if( inTranslate ) {
+            newX += m[3];
+            newY += m[7];
+            newZ += m[11];
+            }
+
+        inX[i] = newX;
+        inY[i] = newY;
+        inZ[i] = newZ;
+        }
+    }
+
+
+
+static void rotateAnglesPortable( const AxisRotations *inR,
+                                  double *inX, double *inY, double *inZ,
+                                  int inStart, int inEnd ) {
+    for( int i=inStart; i<inEnd; i++ ) {
+        double x = inX[i];
+        double y = inY[i];
+        double z = inZ[i];
+
+        if( inR->rotateX ) {
+            double oldY = y;
+            y = y * inR->cosX - z * inR->sinX;
+            z = oldY * inR->sinX + z * inR->cosX;
+            }
+        if( inR->rotateY ) {
+            double oldX = x;
+            x = inR->cosY * x + inR->sinY * z;
+            z = -inR->sinY * oldX + inR->cosY * z;
+            }
+        if( inR->rotateZ ) {
+            double oldX = x;
+            x = inR->cosZ * x - inR->sinZ * y;
+            y = inR->sinZ * oldX + inR->cosZ * y;
+            }
+
+        inX[i] = x;
+        inY[i] = y;
+        inZ[i] = z;
+        }
+    }
+
+
+
+static void normalizePortable( double *inX, double *inY, double *inZ,
+                               int inStart, int inEnd ) {
+    for( int i=inStart; i<inEnd; i++ ) {
+        double x = inX[i];
+        double y = inY[i];
+        double z = inZ[i];
+
+        double scale = 1 / sqrt( x * x + y * y + z * z );
+
+        inX[i] = x * scale;
+        inY[i] = y * scale;
+        inZ[i] = z * scale;
+        }
+    }
+
+
+
+static void dotPortable( const double *inAX, const double *inAY,
+                         const double *inAZ,
+                         const double *inBX, const double *inBY,
+                         const double *inBZ,
+                         double *outDots, int inStart, int inEnd ) {
+    for( int i=inStart; i<inEnd; i++ ) {
+        outDots[i] = inAX[i] * inBX[i] + inAY[i] * inBY[i] +
+            inAZ[i] * inBZ[i];
+        }
+    }
+
+
+
+static void crossPortable( double *inAX, double *inAY, double *inAZ,
+                           const double *inBX, const double *inBY,
+                           const double *inBZ,
+                           int inStart, int inEnd ) {
+    for( int i=inStart; i<inEnd; i++ ) {
+        double ax = inAX[i];
+        double ay = inAY[i];
+        double az = inAZ[i];
+        double bx = inBX[i];
+        double by = inBY[i];
+        double bz = inBZ[i];
+
+        inAX[i] = ay * bz - az * by;
+        inAY[i] = az * bx - ax * bz;
+        inAZ[i] = ax * by - ay * bx;
+        }
+    }
+
+
+
+
+#ifdef CPU_FEATURES_X86
+
+
+// each returns the index of the first point left for the portable kernel
+
+
+__attribute__(( target( "sse2" ) ))
+static int affineSSE2( const double *inMatrix, char inTranslate,
+                       double *inX, double *inY, double *inZ,
+                       int inNumPoints ) {
+    __m128d m[12];
+    for( int j=0; j<12; j++ ) {
+        m[j] = _mm_set1_pd( inMatrix[j] );
+        }
+
+    int i = 0;
+    for( ; i + 2 <= inNumPoints; i += 2 ) {
+        __m128d x = _mm_loadu_pd( &( inX[i] ) );
+        __m128d y = _mm_loadu_pd( &( inY[i] ) );
+        __m128d z = _mm_loadu_pd( &( inZ[i] ) );
+
+        __m128d newX = _mm_add_pd( _mm_add_pd( _mm_mul_pd( m[0], x ),
+                                               _mm_mul_pd( m[1], y ) ),
+                                   _mm_mul_pd( m[2], z ) );
+        __m128d newY = _mm_add_pd( _mm_add_pd( _mm_mul_pd( m[4], x ),
+                                               _mm_mul_pd( m[5], y ) ),
+                                   _mm_mul_pd( m[6], z ) );
+        __m128d newZ = _mm_add_pd( _mm_add_pd( _mm_mul_pd( m[8], x ),
+                                               _mm_mul_pd( m[9], y ) ),
+                                   _mm_mul_pd( m[10], z ) );
+        if( inTranslate ) {
+            newX = _mm_add_pd( newX, m[3] );
+            newY = _mm_add_pd( newY, m[7] );
+            newZ = _mm_add_pd( newZ, m[11] );
+            }
+
+        _mm_storeu_pd( &( inX[i] ), newX );
+        _mm_storeu_pd( &( inY[i] ), newY );
+        _mm_storeu_pd( &( inZ[i] ), newZ );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "sse2" ) ))
+static int rotateAnglesSSE2( const AxisRotations *inR,
+                             double *inX, double *inY, double *inZ,
+                             int inNumPoints ) {
+    __m128d cosX = _mm_set1_pd( inR->cosX );
+    __m128d sinX = _mm_set1_pd( inR->sinX );
+    __m128d cosY = _mm_set1_pd( inR->cosY );
+    __m128d sinY = _mm_set1_pd( inR->sinY );
+    __m128d negSinY = _mm_set1_pd( -inR->sinY );
+    __m128d cosZ = _mm_set1_pd( inR->cosZ );
+    __m128d sinZ = _mm_set1_pd( inR->sinZ );
+
+    int i = 0;
+    for( ; i + 2 <= inNumPoints; i += 2 ) {
+        __m128d x = _mm_loadu_pd( &( inX[i] ) );
+        __m128d y = _mm_loadu_pd( &( inY[i] ) );
+        __m128d z = _mm_loadu_pd( &( inZ[i] ) );
+
+        if( inR->rotateX ) {
+            __m128d oldY = y;
+            y = _mm_sub_pd( _mm_mul_pd( y, cosX ), _mm_mul_pd( z, sinX ) );
+            z = _mm_add_pd( _mm_mul_pd( oldY, sinX ),
+                            _mm_mul_pd( z, cosX ) );
+            }
+        if( inR->rotateY ) {
+            __m128d oldX = x;
+            x = _mm_add_pd( _mm_mul_pd( cosY, x ), _mm_mul_pd( sinY, z ) );
+            z = _mm_add_pd( _mm_mul_pd( negSinY, oldX ),
+                            _mm_mul_pd( cosY, z ) );
+            }
+        if( inR->rotateZ ) {
+            __m128d oldX = x;
+            x = _mm_sub_pd( _mm_mul_pd( cosZ, x ), _mm_mul_pd( sinZ, y ) );
+            y = _mm_add_pd( _mm_mul_pd( sinZ, oldX ),
+                            _mm_mul_pd( cosZ, y ) );
+            }
+
+        _mm_storeu_pd( &( inX[i] ), x );
+        _mm_storeu_pd( &( inY[i] ), y );
+        _mm_storeu_pd( &( inZ[i] ), z );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "sse2" ) ))
+static int normalizeSSE2( double *inX, double *inY, double *inZ,
+                          int inNumPoints ) {
+    __m128d one = _mm_set1_pd( 1.0 );
+
+    int i = 0;
+    for( ; i + 2 <= inNumPoints; i += 2 ) {
+        __m128d x = _mm_loadu_pd( &( inX[i] ) );
+        __m128d y = _mm_loadu_pd( &( inY[i] ) );
+        __m128d z = _mm_loadu_pd( &( inZ[i] ) );
+
+        __m128d lengthSquared =
+            _mm_add_pd( _mm_add_pd( _mm_mul_pd( x, x ), _mm_mul_pd( y, y ) ),
+                        _mm_mul_pd( z, z ) );
+        __m128d scale = _mm_div_pd( one, _mm_sqrt_pd( lengthSquared ) );
+
+        _mm_storeu_pd( &( inX[i] ), _mm_mul_pd( x, scale ) );
+        _mm_storeu_pd( &( inY[i] ), _mm_mul_pd( y, scale ) );
+        _mm_storeu_pd( &( inZ[i] ), _mm_mul_pd( z, scale ) );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "sse2" ) ))
+static int dotSSE2( const double *inAX, const double *inAY,
+                    const double *inAZ,
+                    const double *inBX, const double *inBY,
+                    const double *inBZ,
+                    double *outDots, int inNumPoints ) {
+    int i = 0;
+    for( ; i + 2 <= inNumPoints; i += 2 ) {
+        __m128d dot = _mm_add_pd(
+            _mm_add_pd( _mm_mul_pd( _mm_loadu_pd( &( inAX[i] ) ),
+                                    _mm_loadu_pd( &( inBX[i] ) ) ),
+                        _mm_mul_pd( _mm_loadu_pd( &( inAY[i] ) ),
+                                    _mm_loadu_pd( &( inBY[i] ) ) ) ),
+            _mm_mul_pd( _mm_loadu_pd( &( inAZ[i] ) ),
+                        _mm_loadu_pd( &( inBZ[i] ) ) ) );
+
+        _mm_storeu_pd( &( outDots[i] ), dot );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "sse2" ) ))
+static int crossSSE2( double *inAX, double *inAY, double *inAZ,
+                      const double *inBX, const double *inBY,
+                      const double *inBZ,
+                      int inNumPoints ) {
+    int i = 0;
+    for( ; i + 2 <= inNumPoints; i += 2 ) {
+        __m128d ax = _mm_loadu_pd( &( inAX[i] ) );
+        __m128d ay = _mm_loadu_pd( &( inAY[i] ) );
+        __m128d az = _mm_loadu_pd( &( inAZ[i] ) );
+        __m128d bx = _mm_loadu_pd( &( inBX[i] ) );
+        __m128d by = _mm_loadu_pd( &( inBY[i] ) );
+        __m128d bz = _mm_loadu_pd( &( inBZ[i] ) );
+
+        _mm_storeu_pd( &( inAX[i] ),
+                       _mm_sub_pd( _mm_mul_pd( ay, bz ),
+                                   _mm_mul_pd( az, by ) ) );
+        _mm_storeu_pd( &( inAY[i] ),
+                       _mm_sub_pd( _mm_mul_pd( az, bx ),
+                                   _mm_mul_pd( ax, bz ) ) );
+        _mm_storeu_pd( &( inAZ[i] ),
+                       _mm_sub_pd( _mm_mul_pd( ax, by ),
+                                   _mm_mul_pd( ay, bx ) ) );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "avx" ) ))
+static int affineAVX( const double *inMatrix, char inTranslate,
+                      double *inX, double *inY, double *inZ,
+                      int inNumPoints ) {
+    __m256d m[12];
+    for( int j=0; j<12; j++ ) {
+        m[j] = _mm256_set1_pd( inMatrix[j] );
+        }
+
+    int i = 0;
+    for( ; i + 4 <= inNumPoints; i += 4 ) {
+        __m256d x = _mm256_loadu_pd( &( inX[i] ) );
+        __m256d y = _mm256_loadu_pd( &( inY[i] ) );
+        __m256d z = _mm256_loadu_pd( &( inZ[i] ) );
+
+        __m256d newX =
+            _mm256_add_pd( _mm256_add_pd( _mm256_mul_pd( m[0], x ),
+                                          _mm256_mul_pd( m[1], y ) ),
+                           _mm256_mul_pd( m[2], z ) );
+        __m256d newY =
+            _mm256_add_pd( _mm256_add_pd( _mm256_mul_pd( m[4], x ),
+                                          _mm256_mul_pd( m[5], y ) ),
+                           _mm256_mul_pd( m[6], z ) );
+        __m256d newZ =
+            _mm256_add_pd( _mm256_add_pd( _mm256_mul_pd( m[8], x ),
+                                          _mm256_mul_pd( m[9], y ) ),
+                           _mm256_mul_pd( m[10], z ) );
+        if( inTranslate ) {
+            newX = _mm256_add_pd( newX, m[3] );
+            newY = _mm256_add_pd( newY, m[7] );
+            newZ = _mm256_add_pd( newZ, m[11] );
+            }
+
+        _mm256_storeu_pd( &( inX[i] ), newX );
+        _mm256_storeu_pd( &( inY[i] ), newY );
+        _mm256_storeu_pd( &( inZ[i] ), newZ );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "avx" ) ))
+static int rotateAnglesAVX( const AxisRotations *inR,
+                            double *inX, double *inY, double *inZ,
+                            int inNumPoints ) {
+    __m256d cosX = _mm256_set1_pd( inR->cosX );
+    __m256d sinX = _mm256_set1_pd( inR->sinX );
+    __m256d cosY = _mm256_set1_pd( inR->cosY );
+    __m256d sinY = _mm256_set1_pd( inR->sinY );
+    __m256d negSinY = _mm256_set1_pd( -inR->sinY );
+    __m256d cosZ = _mm256_set1_pd( inR->cosZ );
+    __m256d sinZ = _mm256_set1_pd( inR->sinZ );
+
+    int i = 0;
+    for( ; i + 4 <= inNumPoints; i += 4 ) {
+        __m256d x = _mm256_loadu_pd( &( inX[i] ) );
+        __m256d y = _mm256_loadu_pd( &( inY[i] ) );
+        __m256d z = _mm256_loadu_pd( &( inZ[i] ) );
+
+        if( inR->rotateX ) {
+            __m256d oldY = y;
+            y = _mm256_sub_pd( _mm256_mul_pd( y, cosX ),
+                               _mm256_mul_pd( z, sinX ) );
+            z = _mm256_add_pd( _mm256_mul_pd( oldY, sinX ),
+                               _mm256_mul_pd( z, cosX ) );
+            }
+        if( inR->rotateY ) {
+            __m256d oldX = x;
+            x = _mm256_add_pd( _mm256_mul_pd( cosY, x ),
+                               _mm256_mul_pd( sinY, z ) );
+            z = _mm256_add_pd( _mm256_mul_pd( negSinY, oldX ),
+                               _mm256_mul_pd( cosY, z ) );
+            }
+        if( inR->rotateZ ) {
+            __m256d oldX = x;
+            x = _mm256_sub_pd( _mm256_mul_pd( cosZ, x ),
+                               _mm256_mul_pd( sinZ, y ) );
+            y = _mm256_add_pd( _mm256_mul_pd( sinZ, oldX ),
+                               _mm256_mul_pd( cosZ, y ) );
+            }
+
+        _mm256_storeu_pd( &( inX[i] ), x );
+        _mm256_storeu_pd( &( inY[i] ), y );
+        _mm256_storeu_pd( &( inZ[i] ), z );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "avx" ) ))
+static int normalizeAVX( double *inX, double *inY, double *inZ,
+                         int inNumPoints ) {
+    __m256d one = _mm256_set1_pd( 1.0 );
+
+    int i = 0;
+    for( ; i + 4 <= inNumPoints; i += 4 ) {
+        __m256d x = _mm256_loadu_pd( &( inX[i] ) );
+        __m256d y = _mm256_loadu_pd( &( inY[i] ) );
+        __m256d z = _mm256_loadu_pd( &( inZ[i] ) );
+
+        __m256d lengthSquared =
+            _mm256_add_pd( _mm256_add_pd( _mm256_mul_pd( x, x ),
+                                          _mm256_mul_pd( y, y ) ),
+                           _mm256_mul_pd( z, z ) );
+        __m256d scale = _mm256_div_pd( one, _mm256_sqrt_pd( lengthSquared ) );
+
+        _mm256_storeu_pd( &( inX[i] ), _mm256_mul_pd( x, scale ) );
+        _mm256_storeu_pd( &( inY[i] ), _mm256_mul_pd( y, scale ) );
+        _mm256_storeu_pd( &( inZ[i] ), _mm256_mul_pd( z, scale ) );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "avx" ) ))
+static int dotAVX( const double *inAX, const double *inAY,
+                   const double *inAZ,
+                   const double *inBX, const double *inBY,
+                   const double *inBZ,
+                   double *outDots, int inNumPoints ) {
+    int i = 0;
+    for( ; i + 4 <= inNumPoints; i += 4 ) {
+        __m256d dot = _mm256_add_pd(
+            _mm256_add_pd( _mm256_mul_pd( _mm256_loadu_pd( &( inAX[i] ) ),
+                                          _mm256_loadu_pd( &( inBX[i] ) ) ),
+                           _mm256_mul_pd( _mm256_loadu_pd( &( inAY[i] ) ),
+                                          _mm256_loadu_pd( &( inBY[i] ) ) ) ),
+            _mm256_mul_pd( _mm256_loadu_pd( &( inAZ[i] ) ),
+                           _mm256_loadu_pd( &( inBZ[i] ) ) ) );
+
+        _mm256_storeu_pd( &( outDots[i] ), dot );
+        }
+    return i;
+    }
+
+
+
+__attribute__(( target( "avx" ) ))
+static int crossAVX( double *inAX, double *inAY, double *inAZ,
+                     const double *inBX, const double *inBY,
+                     const double *inBZ,
+                     int inNumPoints ) {
+    int i = 0;
+    for( ; i + 4 <= inNumPoints; i += 4 ) {
+        __m256d ax = _mm256_loadu_pd( &( inAX[i] ) );
+        __m256d ay = _mm256_loadu_pd( &( inAY[i] ) );
+        __m256d az = _mm256_loadu_pd( &( inAZ[i] ) );
+        __m256d bx = _mm256_loadu_pd( &( inBX[i] ) );
+        __m256d by = _mm256_loadu_pd( &( inBY[i] ) );
+        __m256d bz = _mm256_loadu_pd( &( inBZ[i] ) );
+
+        _mm256_storeu_pd( &( inAX[i] ),
+                          _mm256_sub_pd( _mm256_mul_pd( ay, bz ),
+                                         _mm256_mul_pd( az, by ) ) );
+        _mm256_storeu_pd( &( inAY[i] ),
+                          _mm256_sub_pd( _mm256_mul_pd( az, bx ),
+                                         _mm256_mul_pd( ax, bz ) ) );
+        _mm256_storeu_pd( &( inAZ[i] ),
+                          _mm256_sub_pd( _mm256_mul_pd( ax, by ),
+                                         _mm256_mul_pd( ay, bx ) ) );
+        }
+    return i;
+    }
+
+
+#endif
+
+
+
+void transformPoints( double *inMatrix, char inTranslate,
+                      double *inX, double *inY, double *inZ,
+                      int inNumPoints ) {
+    int done = 0;
+
+#ifdef CPU_FEATURES_X86
+    int level = getPointKernelImplementation();
+
+    if( level == 2 ) {
+        done = affineAVX( inMatrix, inTranslate, inX, inY, inZ,
+                          inNumPoints );
+        }
+    else if( level == 1 ) {
+        done = affineSSE2( inMatrix, inTranslate, inX, inY, inZ,
+                           inNumPoints );
+        }
+#endif
+
+    affinePortable( inMatrix, inTranslate, inX, inY, inZ,
+                    done, inNumPoints );
+    }
+
+
+
+void multiplyPoints( double *inMatrix,
+                     double *inX, double *inY, double *inZ,
+                     int inNumPoints ) {
+    double affine[12] = { inMatrix[0], inMatrix[1], inMatrix[2], 0,
+                          inMatrix[3], inMatrix[4], inMatrix[5], 0,
+                          inMatrix[6], inMatrix[7], inMatrix[8], 0 };
+
+    transformPoints( affine, false, inX, inY, inZ, inNumPoints );
+    }
+
+
+
+void rotatePoints( Angle3D *inAngle,
+                   double *inX, double *inY, double *inZ, int inNumPoints ) {
+    AxisRotations r;
+    r.rotateX = ( inAngle->mX != 0 );
+    r.rotateY = ( inAngle->mY != 0 );
+    r.rotateZ = ( inAngle->mZ != 0 );
+    r.cosX = cos( inAngle->mX );
+    r.sinX = sin( inAngle->mX );
+    r.cosY = cos( inAngle->mY );
+    r.sinY = sin( inAngle->mY );
+    r.cosZ = cos( inAngle->mZ );
+    r.sinZ = sin( inAngle->mZ );
+
+    int done = 0;
+
+#ifdef CPU_FEATURES_X86
+    int level = getPointKernelImplementation();
+
+    if( level == 2 ) {
+        done = rotateAnglesAVX( &r, inX, inY, inZ, inNumPoints );
+        }
+    else if( level == 1 ) {
+        done = rotateAnglesSSE2( &r, inX, inY, inZ, inNumPoints );
+        }
+#endif
+
+    rotateAnglesPortable( &r, inX, inY, inZ, done, inNumPoints );
+    }
+
+
+
+void normalizePoints( double *inX, double *inY, double *inZ,
+                      int inNumPoints ) {
+    int done = 0;
+
+#ifdef CPU_FEATURES_X86
+    int level = getPointKernelImplementation();
+
+    if( level == 2 ) {
+        done = normalizeAVX( inX, inY, inZ, inNumPoints );
+        }
+    else if( level == 1 ) {
+        done = normalizeSSE2( inX, inY, inZ, inNumPoints );
+        }
+#endif
+
+    normalizePortable( inX, inY, inZ, done, inNumPoints );
+    }
+
+
+
+void dotPoints( double *inAX, double *inAY, double *inAZ,
+                double *inBX, double *inBY, double *inBZ,
+                double *outDots, int inNumPoints ) {
+    int done = 0;
+
+#ifdef CPU_FEATURES_X86
+    int level = getPointKernelImplementation();
+
+    if( level == 2 ) {
+        done = dotAVX( inAX, inAY, inAZ, inBX, inBY, inBZ,
+                       outDots, inNumPoints );
+        }
+    else if( level == 1 ) {
+        done = dotSSE2( inAX, inAY, inAZ, inBX, inBY, inBZ,
+                        outDots, inNumPoints );
+        }
+#endif
+
+    dotPortable( inAX, inAY, inAZ, inBX, inBY, inBZ,
+                 outDots, done, inNumPoints );
+    }
+
+
+
+void crossPoints( double *inAX, double *inAY, double *inAZ,
+                  double *inBX, double *inBY, double *inBZ,
+                  int inNumPoints ) {
+    int done = 0;
+
+#ifdef CPU_FEATURES_X86
+    int level = getPointKernelImplementation();
+
+    if( level == 2 ) {
+        done = crossAVX( inAX, inAY, inAZ, inBX, inBY, inBZ, inNumPoints );
+        }
+    else if( level == 1 ) {
+        done = crossSSE2( inAX, inAY, inAZ, inBX, inBY, inBZ, inNumPoints );
+        }
+#endif
+
+    crossPortable( inAX, inAY, inAZ, inBX, inBY, inBZ, done, inNumPoints );
+    }
+
+
+
+
+PointCloud3D::PointCloud3D( int inNumPoints )
+        : mNumPoints( 0 ), mCapacity( 0 ),
+          mX( NULL ), mY( NULL ), mZ( NULL ) {
+
+    setNumPoints( inNumPoints );
+    }
+
+
+
+PointCloud3D::PointCloud3D( Vector3D **inPoints, int inNumPoints )
+        : mNumPoints( 0 ), mCapacity( 0 ),
+          mX( NULL ), mY( NULL ), mZ( NULL ) {
+
+    setNumPoints( inNumPoints );
+
+    for( int i=0; i<inNumPoints; i++ ) {
+        mX[i] = inPoints[i]->mX;
+        mY[i] = inPoints[i]->mY;
+        mZ[i] = inPoints[i]->mZ;
+        }
+    }
+
+
+
+PointCloud3D::PointCloud3D( doubleTriple *inPoints, int inNumPoints )
+        : mNumPoints( 0 ), mCapacity( 0 ),
+          mX( NULL ), mY( NULL ), mZ( NULL ) {
+
+    setNumPoints( inNumPoints );
+
+    for( int i=0; i<inNumPoints; i++ ) {
+        setPoint( i, inPoints[i] );
+        }
+    }
+
+
+
+PointCloud3D::~PointCloud3D() {
+    if( mX != NULL ) {
+        delete [] mX;
+        delete [] mY;
+        delete [] mZ;
+        }
+    }
+
+
+
+void PointCloud3D::ensureCapacity( int inCapacity ) {
+    if( inCapacity <= mCapacity ) {
+        return;
+        }
+
+    int newCapacity = mCapacity * 2;
+    if( newCapacity < inCapacity ) {
+        newCapacity = inCapacity;
+        }
+
+    double *newX = new double[ newCapacity ];
+    double *newY = new double[ newCapacity ];
+    double *newZ = new double[ newCapacity ];
+
+    if( mX != NULL ) {
+        memcpy( newX, mX, mNumPoints * sizeof( double ) );
+        memcpy( newY, mY, mNumPoints * sizeof( double ) );
+        memcpy( newZ, mZ, mNumPoints * sizeof( double ) );
+
+        delete [] mX;
+        delete [] mY;
+        delete [] mZ;
+        }
+
+    mX = newX;
+    mY = newY;
+    mZ = newZ;
+    mCapacity = newCapacity;
+    }
+
+
+
+void PointCloud3D::setNumPoints( int inNumPoints ) {
+    ensureCapacity( inNumPoints );
+
+    for( int i=mNumPoints; i<inNumPoints; i++ ) {
+        mX[i] = 0;
+        mY[i] = 0;
+        mZ[i] = 0;
+        }
+    mNumPoints = inNumPoints;
+    }
+
+
+
+int PointCloud3D::addPoint( doubleTriple inPoint ) {
+    ensureCapacity( mNumPoints + 1 );
+
+    setPoint( mNumPoints, inPoint );
+    mNumPoints++;
+
+    return mNumPoints - 1;
+    }
+
+
+
+void PointCloud3D::getPoints( Vector3D **outPoints ) {
+    for( int i=0; i<mNumPoints; i++ ) {
+        outPoints[i]->setCoordinates( mX[i], mY[i], mZ[i] );
+        }
+    }
+
+
+
+void PointCloud3D::getPoints( doubleTriple *outPoints ) {
+    for( int i=0; i<mNumPoints; i++ ) {
+        outPoints[i] = getPoint( i );
+        }
+    }
+
+
+
+// simple enough for the compiler to vectorize
+
+void PointCloud3D::translate( doubleTriple inOffset ) {
+    for( int i=0; i<mNumPoints; i++ ) {
+        mX[i] += inOffset.x;
+        mY[i] += inOffset.y;
+        mZ[i] += inOffset.z;
+        }
+    }
+
+
+
+void PointCloud3D::scale( double inScale ) {
+    for( int i=0; i<mNumPoints; i++ ) {
+        mX[i] *= inScale;
+        mY[i] *= inScale;
+        mZ[i] *= inScale;
+        }
+    }
+
+
+
+void PointCloud3D::normalize() {
+    normalizePoints( mX, mY, mZ, mNumPoints );
+    }
+
+
+
+void PointCloud3D::rotate( Angle3D *inAngle ) {
+    rotatePoints( inAngle, mX, mY, mZ, mNumPoints );
+    }
+
+
+
+void PointCloud3D::rotate( doubleTriple inAxis, double inAngle ) {
+    double m[9];
+    getAxisRotationMatrix( inAxis, inAngle, m );
+
+    multiplyPoints( m, mX, mY, mZ, mNumPoints );
+    }
+
+
+
+void PointCloud3D::dot( PointCloud3D *inOther, double *outDots ) {
+    dotPoints( mX, mY, mZ, inOther->mX, inOther->mY, inOther->mZ,
+               outDots, mNumPoints );
+    }
+
+
+
+void PointCloud3D::cross( PointCloud3D *inOther ) {
+    crossPoints( mX, mY, mZ, inOther->mX, inOther->mY, inOther->mZ,
+                 mNumPoints );
+    }
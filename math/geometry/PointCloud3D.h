@@ -0,0 +1,243 @@
+#ifndef POINT_CLOUD_3D_INCLUDED
+#define POINT_CLOUD_3D_INCLUDED
+
+
+#include "doubleTriple.h"
+#include "Vector3D.h"
+#include "Angle3D.h"
+
+
+
+/**
+ * Gets the point kernel implementation in use.
+ *
+ * @return 0 for portable code, 1 for SSE2, or 2 for AVX.
+ */
+int getPointKernelImplementation();
+
+
+/**
+ * Limits which point kernel implementation can be used, mostly for
+ * testing and benchmarking.
+ *
+ * @param inMaxImplementation the highest implementation to use, if
+ *   supported by this CPU, as numbered by getPointKernelImplementation.
+ */
+void setPointKernelImplementationLimit( int inMaxImplementation );
+
+
+
+// Kernels that work in place on points stored as separate x, y, and z
+// arrays of length inNumPoints.
+// Results match the Vector3D and Transform3D functions exactly.
+
+
+/**
+ * Applies an affine transform to points.
+ *
+ * @param inMatrix 4x4 row-major matrix, as returned by
+ *   Transform3D::getMatrix.  The last row is ignored.
+ * @param inTranslate true to apply the translation column, false to
+ *   only rotate and scale, as for directions and normals.
+ */
+void transformPoints( double *inMatrix, char inTranslate,
+                      double *inX, double *inY, double *inZ,
+                      int inNumPoints );
+
+
+/**
+ * Multiplies points by a 3x3 row-major matrix.
+ */
+void multiplyPoints( double *inMatrix,
+                     double *inX, double *inY, double *inZ,
+                     int inNumPoints );
+
+
+/**
+ * Rotates points about the origin, around x, then y, then z, as
+ * Vector3D::rotate( Angle3D * ).
+ */
+void rotatePoints( Angle3D *inAngle,
+                   double *inX, double *inY, double *inZ, int inNumPoints );
+
+
+/**
+ * Scales points to unit length.
+ */
+void normalizePoints( double *inX, double *inY, double *inZ,
+                      int inNumPoints );
+
+
+/**
+ * Computes dot products of pairs of points.
+ *
+ * @param outDots array where inNumPoints dot products will be returned.
+ *   Destroyed by caller.
+ */
+void dotPoints( double *inAX, double *inAY, double *inAZ,
+                double *inBX, double *inBY, double *inBZ,
+                double *outDots, int inNumPoints );
+
+
+/**
+ * Computes cross products of pairs of points, A x B, into A.
+ */
+void crossPoints( double *inAX, double *inAY, double *inAZ,
+                  double *inBX, double *inBY, double *inBZ,
+                  int inNumPoints );
+
+
+
+/**
+ * A set of points stored as structure-of-arrays, one array each for
+ * x, y, and z, so that whole sets can be transformed by the SIMD point
+ * kernels above.
+ *
+ * @author Jason Rohrer
+ */
+class PointCloud3D {
+
+    public:
+
+        /**
+         * Constructs a cloud of zero points.
+         *
+         * @param inNumPoints the number of points.  Defaults to 0.
+         */
+        PointCloud3D( int inNumPoints = 0 );
+
+
+        /**
+         * Constructs a cloud by copying points.
+         *
+         * @param inPoints the points to copy.
+         *   Destroyed by caller.
+         * @param inNumPoints the number of points.
+         */
+        PointCloud3D( Vector3D **inPoints, int inNumPoints );
+
+        PointCloud3D( doubleTriple *inPoints, int inNumPoints );
+
+
+        ~PointCloud3D();
+
+
+
+        int getNumPoints() {
+            return mNumPoints;
+            }
+
+
+        /**
+         * Changes the number of points.  Points kept are unchanged, and
+         * new points are zero.
+         */
+        void setNumPoints( int inNumPoints );
+
+
+        /**
+         * Adds a point at the end.
+         *
+         * @return the index of the new point.
+         */
+        int addPoint( doubleTriple inPoint );
+
+
+        doubleTriple getPoint( int inIndex ) {
+            return makeTriple( mX[ inIndex ], mY[ inIndex ], mZ[ inIndex ] );
+            }
+
+
+        void setPoint( int inIndex, doubleTriple inPoint ) {
+            mX[ inIndex ] = inPoint.x;
+            mY[ inIndex ] = inPoint.y;
+            mZ[ inIndex ] = inPoint.z;
+            }
+
+
+
+        /**
+         * Copies points out.
+         *
+         * @param outPoints array of getNumPoints() existing vectors to
+         *   set.
+         *   Destroyed by caller.
+         */
+        void getPoints( Vector3D **outPoints );
+
+        void getPoints( doubleTriple *outPoints );
+
+
+
+        // direct access to the arrays, valid until the number of points
+        // changes
+        double *getX() {
+            return mX;
+            }
+
+        double *getY() {
+            return mY;
+            }
+
+        double *getZ() {
+            return mZ;
+            }
+
+
+
+        // in-place operations on all points
+
+        void translate( doubleTriple inOffset );
+
+        void scale( double inScale );
+
+        void normalize();
+
+        void rotate( Angle3D *inAngle );
+
+        // inAxis must be normalized
+        void rotate( doubleTriple inAxis, double inAngle );
+
+
+        /**
+         * Computes dot products with the matching points of another cloud.
+         *
+         * @param inOther the other cloud, with at least as many points.
+         *   Destroyed by caller.
+         * @param outDots array where getNumPoints() products will be
+         *   returned.
+         *   Destroyed by caller.
+         */
+        void dot( PointCloud3D *inOther, double *outDots );
+
+
+        /**
+         * Replaces each point with its cross product with the matching
+         * point of another cloud (this x other).
+         *
+         * @param inOther the other cloud, with at least as many points.
+         *   Can be this cloud.
+         *   Destroyed by caller.
+         */
+        void cross( PointCloud3D *inOther );
+
+
+
+    protected:
+
+        int mNumPoints;
+        int mCapacity;
+
+        double *mX;
+        double *mY;
+        double *mZ;
+
+
+        // grows the arrays to hold at least inCapacity points
+        void ensureCapacity( int inCapacity );
+
+    };
+
+
+
+#endif
@@ -20,6 +20,8 @@
 
 #include "Vector3D.h"
 #include "Angle3D.h"
+#include "doubleTriple.h"
+#include "PointCloud3D.h"
  
 /**
  * An affine transformation in 3D. 
@@ -111,6 +113,44 @@ class Transform3D : public Serializable {
 		void applyNoTranslation( Vector3D *inTarget );
 		
 		
+		/**
+		 * Transforms every point in a cloud in place, with SIMD kernels.
+		 * Requires PointCloud3D.cpp.
+		 *
+		 * Results are the same as calling apply on each point.
+		 *
+		 * @param inTarget the points to transform.
+		 *   Must be destroyed by the caller.
+		 */
+		void apply( PointCloud3D *inTarget );
+		
+		void applyNoTranslation( PointCloud3D *inTarget );
+		
+		
+		/**
+		 * Transforms points stored as separate x, y, and z arrays 
+		 * in place.  Requires PointCloud3D.cpp.
+		 *
+		 * @param inX, inY, inZ the coordinate arrays.
+		 *   Must be destroyed by the caller.
+		 * @param inNumPoints the length of each array.
+		 */
+		void apply( double *inX, double *inY, double *inZ, int inNumPoints );
+		
+		void applyNoTranslation( double *inX, double *inY, double *inZ,
+			int inNumPoints );
+		
+		
+		/**
+		 * Transforms an array of points in place.
+		 *
+		 * @param inPoints the points to transform.
+		 *   Must be destroyed by the caller.
+		 * @param inNumPoints the number of points.
+		 */
+		void apply( doubleTriple *inPoints, int inNumPoints );
+		
+		
 		/**
 		 * Gets the transformation matrix underlying this transform.
 		 *
@@ -288,6 +328,53 @@ inline void Transform3D::applyNoTranslation( Vector3D *inTarget ) {
 
 
 
+inline void Transform3D::apply( PointCloud3D *inTarget ) {
+	transformPoints( getMatrix(), true, 
+		inTarget->getX(), inTarget->getY(), inTarget->getZ(),
+		inTarget->getNumPoints() );
+	}
+
+
+
+inline void Transform3D::applyNoTranslation( PointCloud3D *inTarget ) {
+	transformPoints( getMatrix(), false, 
+		inTarget->getX(), inTarget->getY(), inTarget->getZ(),
+		inTarget->getNumPoints() );
+	}
+
+
+
+inline void Transform3D::apply( double *inX, double *inY, double *inZ, 
+	int inNumPoints ) {
+	transformPoints( getMatrix(), true, inX, inY, inZ, inNumPoints );
+	}
+
+
+
+inline void Transform3D::applyNoTranslation( double *inX, double *inY, 
+	double *inZ, int inNumPoints ) {
+	transformPoints( getMatrix(), false, inX, inY, inZ, inNumPoints );
+	}
+
+
+
+inline void Transform3D::apply( doubleTriple *inPoints, int inNumPoints ) {
+	for( int i=0; i<inNumPoints; i++ ) {
+		double x = inPoints[i].x;
+		double y = inPoints[i].y;
+		double z = inPoints[i].z;
+		
+		inPoints[i].x = mMatrix[0][0] * x + mMatrix[0][1] * y + 
+			mMatrix[0][2] * z + mMatrix[0][3];
+		inPoints[i].y = mMatrix[1][0] * x + mMatrix[1][1] * y + 
+			mMatrix[1][2] * z + mMatrix[1][3];
+		inPoints[i].z = mMatrix[2][0] * x + mMatrix[2][1] * y + 
+			mMatrix[2][2] * z + mMatrix[2][3];
+		}
+	}
+
+
+
 inline void Transform3D::multiply( double inMatrix[][4] ) {
 	double destM[4][4];
 	
@@ -68,6 +68,7 @@
 #include <stdio.h>
 
 #include "Angle3D.h" 
+#include "doubleTriple.h"
 #include "minorGems/io/Serializable.h"
  
 /**
@@ -120,6 +121,15 @@ class Vector3D : public Serializable {
 		 */
 		void setCoordinates( Vector3D *inOther );
 
+        void setCoordinates( doubleTriple inOther );
+
+
+        
+        /**
+         * Gets the coordinates as a plain struct.
+         */
+        doubleTriple getTriple();
+
         
         
 		/**
@@ -365,6 +375,18 @@ inline void Vector3D::setCoordinates( Vector3D *inOther ) {
 
 
 
+inline void Vector3D::setCoordinates( doubleTriple inOther ) {
+	setCoordinates( inOther.x, inOther.y, inOther.z );
+	}
+
+
+
+inline doubleTriple Vector3D::getTriple() {
+	return makeTriple( mX, mY, mZ );
+	}
+
+
+
 inline void Vector3D::normalize() {
 	scale( 1/sqrt( dot( this ) ) );
 	}
@@ -414,13 +436,11 @@ inline Vector3D *Vector3D::cross( Vector3D *inOther ) {
 
 inline double Vector3D::getAngleTo( Vector3D *inOther ) {
     // normalize and remove z component
-    Vector3D *normalThis = new Vector3D( this );
-    normalThis->normalize();
+    doubleTriple normalThis = ::normalize( getTriple() );
     
-    Vector3D *normalOther = new Vector3D( inOther );
-    normalOther->normalize();
+    doubleTriple normalOther = ::normalize( inOther->getTriple() );
     
-    double cosineOfAngle = normalThis->dot( normalOther );
+    double cosineOfAngle = ::dot( normalThis, normalOther );
 
 
     // cosine is ambiguous (same for negative and positive angles)
@@ -429,12 +449,7 @@ inline double Vector3D::getAngleTo( Vector3D *inOther ) {
     // the magnitude of the cross is the sine of the angle between the two
     // vectors
 
-    Vector3D *crossVector = normalThis->cross( normalOther );
-    double sineOfAngle = crossVector->getLength();
-
-    delete crossVector;
-    delete normalThis;
-    delete normalOther;
+    double sineOfAngle = ::length( ::cross( normalThis, normalOther ) );
 
     double angle = acos( cosineOfAngle );
 
@@ -519,15 +534,15 @@ inline void Vector3D::rotate( Vector3D *inAxis, double inAngle ) {
 
 inline Angle3D *Vector3D::getZAngleTo( Vector3D *inOther ) {
     // normalize and remove z component
-    Vector3D *normalThis = new Vector3D( this );
-    normalThis->mZ = 0;
-    normalThis->normalize();
+    doubleTriple normalThis = getTriple();
+    normalThis.z = 0;
+    normalThis = ::normalize( normalThis );
     
-    Vector3D *normalOther = new Vector3D( inOther );
-    normalOther->mZ = 0;
-    normalOther->normalize();
+    doubleTriple normalOther = inOther->getTriple();
+    normalOther.z = 0;
+    normalOther = ::normalize( normalOther );
 
-    double cosineOfZAngle = normalThis->dot( normalOther );
+    double cosineOfZAngle = ::dot( normalThis, normalOther );
 
 
     // cosine is ambiguous (same for negative and positive angles)
@@ -535,16 +550,11 @@ inline Angle3D *Vector3D::getZAngleTo( Vector3D *inOther ) {
     // compute dot product with perpendicular vector to get sine
     // sign of sine will tell us whether angle is positive or negative
     
-    Angle3D *rightAngleZ = new Angle3D( 0, 0, M_PI / 2 );
-
-    normalThis->rotate( rightAngleZ );
+    Angle3D rightAngleZ( 0, 0, M_PI / 2 );
 
-    delete rightAngleZ;
+    normalThis = ::rotate( normalThis, &rightAngleZ );
     
-    double sineOfZAngle = normalThis->dot( normalOther );
-    
-    delete normalThis;
-    delete normalOther;
+    double sineOfZAngle = ::dot( normalThis, normalOther );
 
     double zAngle = acos( cosineOfZAngle );
 
@@ -570,15 +580,15 @@ inline Angle3D *Vector3D::getZAngleTo( Vector3D *inOther ) {
 
 inline Angle3D *Vector3D::getYAngleTo( Vector3D *inOther ) {
     // normalize and remove y component
-    Vector3D *normalThis = new Vector3D( this );
-    normalThis->mY = 0;
-    normalThis->normalize();
+    doubleTriple normalThis = getTriple();
+    normalThis.y = 0;
+    normalThis = ::normalize( normalThis );
     
-    Vector3D *normalOther = new Vector3D( inOther );
-    normalOther->mY = 0;
-    normalOther->normalize();
+    doubleTriple normalOther = inOther->getTriple();
+    normalOther.y = 0;
+    normalOther = ::normalize( normalOther );
 
-    double cosineOfYAngle = normalThis->dot( normalOther );
+    double cosineOfYAngle = ::dot( normalThis, normalOther );
 
 
     // cosine is ambiguous (same for negative and positive angles)
@@ -586,16 +596,11 @@ inline Angle3D *Vector3D::getYAngleTo( Vector3D *inOther ) {
     // compute dot product with perpendicular vector to get sine
     // sign of sine will tell us whether angle is positive or negative
     
-    Angle3D *rightAngleY = new Angle3D( 0, M_PI / 2, 0 );
-
-    normalThis->rotate( rightAngleY );
+    Angle3D rightAngleY( 0, M_PI / 2, 0 );
 
-    delete rightAngleY;
-    
-    double sineOfYAngle = normalThis->dot( normalOther );
+    normalThis = ::rotate( normalThis, &rightAngleY );
     
-    delete normalThis;
-    delete normalOther;
+    double sineOfYAngle = ::dot( normalThis, normalOther );
 
     double yAngle = acos( cosineOfYAngle );
 
@@ -621,15 +626,15 @@ inline Angle3D *Vector3D::getYAngleTo( Vector3D *inOther ) {
 
 inline Angle3D *Vector3D::getXAngleTo( Vector3D *inOther ) {
     // normalize and remove y component
-    Vector3D *normalThis = new Vector3D( this );
-    normalThis->mX = 0;
-    normalThis->normalize();
+    doubleTriple normalThis = getTriple();
+    normalThis.x = 0;
+    normalThis = ::normalize( normalThis );
     
-    Vector3D *normalOther = new Vector3D( inOther );
-    normalOther->mX = 0;
-    normalOther->normalize();
+    doubleTriple normalOther = inOther->getTriple();
+    normalOther.x = 0;
+    normalOther = ::normalize( normalOther );
 
-    double cosineOfXAngle = normalThis->dot( normalOther );
+    double cosineOfXAngle = ::dot( normalThis, normalOther );
 
 
     // cosine is ambiguous (same for negative and positive angles)
@@ -637,16 +642,11 @@ inline Angle3D *Vector3D::getXAngleTo( Vector3D *inOther ) {
     // compute dot product with perpendicular vector to get sine
     // sign of sine will tell us whether angle is positive or negative
     
-    Angle3D *rightAngleX = new Angle3D( M_PI / 2, 0, 0 );
+    Angle3D rightAngleX( M_PI / 2, 0, 0 );
 
-    normalThis->rotate( rightAngleX );
-
-    delete rightAngleX;
-    
-    double sineOfXAngle = normalThis->dot( normalOther );
+    normalThis = ::rotate( normalThis, &rightAngleX );
     
-    delete normalThis;
-    delete normalOther;
+    double sineOfXAngle = ::dot( normalThis, normalOther );
 
     double xAngle = acos( cosineOfXAngle );
 
@@ -743,11 +743,9 @@ inline void Vector3D::rotate( Angle3D *inAngle ) {
 
 
 inline void Vector3D::reverseRotate( Angle3D *inAngle ) {
-	Angle3D *actualAngle = 
-		new Angle3D( -inAngle->mX, -inAngle->mY, -inAngle->mZ );
+	Angle3D actualAngle( -inAngle->mX, -inAngle->mY, -inAngle->mZ );
 	
-	rotate( actualAngle );
-	delete actualAngle;
+	rotate( &actualAngle );
 	}
 	
 
@@ -0,0 +1,178 @@
+#ifndef DOUBLE_TRIPLE_INCLUDED
+#define DOUBLE_TRIPLE_INCLUDED
+
+
+#include <math.h>
+
+#include "Angle3D.h"
+
+
+
+/**
+ * Plain 3D vector that can be passed and stored by value, with no
+ * vtable or heap allocation.  Use it where Vector3D's allocating
+ * interface is too slow, and PointCloud3D for large sets of points.
+ *
+ * Operations give the same results as the matching Vector3D functions.
+ *
+ * @author Jason Rohrer
+ */
+typedef struct doubleTriple {
+        double x;
+        double y;
+        double z;
+    } doubleTriple;
+
+
+
+inline doubleTriple makeTriple( double inX, double inY, double inZ ) {
+    doubleTriple t = { inX, inY, inZ };
+    return t;
+    }
+
+
+inline doubleTriple add( doubleTriple inA, doubleTriple inB ) {
+    return makeTriple( inA.x + inB.x, inA.y + inB.y, inA.z + inB.z );
+    }
+
+
+inline doubleTriple sub( doubleTriple inA, doubleTriple inB ) {
+    return makeTriple( inA.x - inB.x, inA.y - inB.y, inA.z - inB.z );
+    }
+
+
+inline doubleTriple mult( doubleTriple inP, double inV ) {
+    return makeTriple( inP.x * inV, inP.y * inV, inP.z * inV );
+    }
+
+
+inline double dot( doubleTriple inA, doubleTriple inB ) {
+    return inA.x * inB.x + inA.y * inB.y + inA.z * inB.z;
+    }
+
+
+// right handed, inA x inB
+inline doubleTriple cross( doubleTriple inA, doubleTriple inB ) {
+    return makeTriple( inA.y * inB.z - inA.z * inB.y,
+                       inA.z * inB.x - inA.x * inB.z,
+                       inA.x * inB.y - inA.y * inB.x );
+    }
+
+
+inline double length( doubleTriple inP ) {
+    return sqrt( dot( inP, inP ) );
+    }
+
+
+inline doubleTriple normalize( doubleTriple inP ) {
+    return mult( inP, 1 / sqrt( dot( inP, inP ) ) );
+    }
+
+
+inline double distance( doubleTriple inA, doubleTriple inB ) {
+    return length( sub( inA, inB ) );
+    }
+
+
+inline char equal( doubleTriple inA, doubleTriple inB ) {
+    return inA.x == inB.x && inA.y == inB.y && inA.z == inB.z;
+    }
+
+
+
+// rotates about the origin, around x, then y, then z
+inline doubleTriple rotate( doubleTriple inP, Angle3D *inAngle ) {
+    double x = inP.x;
+    double y = inP.y;
+    double z = inP.z;
+
+    if( inAngle->mX != 0 ) {
+        double cosTheta = cos( inAngle->mX );
+        double sinTheta = sin( inAngle->mX );
+        double oldY = y;
+        y = y * cosTheta - z * sinTheta;
+        z = oldY * sinTheta + z * cosTheta;
+        }
+    if( inAngle->mY != 0 ) {
+        double cosTheta = cos( inAngle->mY );
+        double sinTheta = sin( inAngle->mY );
+        double oldX = x;
+        x = cosTheta * x + sinTheta * z;
+        z = -sinTheta * oldX + cosTheta * z;
+        }
+    if( inAngle->mZ != 0 ) {
+        double cosTheta = cos( inAngle->mZ );
+        double sinTheta = sin( inAngle->mZ );
+        double oldX = x;
+        x = cosTheta * x - sinTheta * y;
+        y = sinTheta * oldX + cosTheta * y;
+        }
+
+    return makeTriple( x, y, z );
+    }
+
+
+
+/**
+ * Gets the 3x3 matrix, row-major, that rotates around an axis.
+ *
+ * @param inAxis the axis.  Must be normalized.
+ * @param inAngle the angle in radians.
+ * @param outMatrix array where 9 values will be returned.
+ */
+inline void getAxisRotationMatrix( doubleTriple inAxis, double inAngle,
+                                   double *outMatrix ) {
+    // same terms as Vector3D::rotate
+    double c = cos( inAngle );
+    double s = sin( inAngle );
+    double t = 1 - c;
+
+    double x = inAxis.x;
+    double y = inAxis.y;
+    double z = inAxis.z;
+
+    double sx = s * x;
+    double sy = s * y;
+    double sz = s * z;
+
+    double tx = t * x;
+    double ty = t * y;
+
+    double txx = tx * x;
+    double txy = tx * y;
+    double txz = tx * z;
+
+    double tyy = ty * y;
+    double tyz = ty * z;
+
+    double tzz = t * z * z;
+
+    outMatrix[0] = txx + c;
+    outMatrix[1] = txy + sz;
+    outMatrix[2] = txz - sy;
+
+    outMatrix[3] = txy - sz;
+    outMatrix[4] = tyy + c;
+    outMatrix[5] = tyz + sx;
+
+    outMatrix[6] = txz + sy;
+    outMatrix[7] = tyz - sx;
+    outMatrix[8] = tzz + c;
+    }
+
+
+
+// rotates around an axis, which must be normalized
+inline doubleTriple rotate( doubleTriple inP, doubleTriple inAxis,
+                            double inAngle ) {
+    double m[9];
+    getAxisRotationMatrix( inAxis, inAngle, m );
+
+    return makeTriple( m[0] * inP.x + m[1] * inP.y + m[2] * inP.z,
+                       m[3] * inP.x + m[4] * inP.y + m[5] * inP.z,
+                       m[6] * inP.x + m[7] * inP.y + m[8] * inP.z );
+    }
+
+
+
+#endif
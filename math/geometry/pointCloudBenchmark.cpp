@@ -0,0 +1,362 @@
+// Checks the PointCloud3D kernels and doubleTriple functions against the
+// Vector3D and Transform3D functions they replace, for every kernel
+// implementation, then measures 1M-point transforms each way.
+//
+// Usage:  pointCloudBenchmark
+
+
+#include "PointCloud3D.h"
+#include "Transform3D.h"
+
+#include "minorGems/util/random/XoshiroRandomSource.h"
+#include "minorGems/system/Time.h"
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+int failures = 0;
+
+
+void check( char inPassed, const char *inWhat, int inLevel ) {
+    if( !inPassed ) {
+        printf( "FAILED:  %s, implementation %d\n", inWhat, inLevel );
+        failures++;
+        }
+    }
+
+
+
+char sameAsVectors( PointCloud3D *inCloud, Vector3D **inVectors ) {
+    for( int i=0; i<inCloud->getNumPoints(); i++ ) {
+        doubleTriple p = inCloud->getPoint( i );
+
+        if( p.x != inVectors[i]->mX ||
+            p.y != inVectors[i]->mY ||
+            p.z != inVectors[i]->mZ ) {
+            return false;
+            }
+        }
+    return true;
+    }
+
+
+
+Transform3D *makeTransform() {
+    Transform3D *transform = new Transform3D();
+
+    Angle3D angle( 0.3, -1.1, 2.0 );
+    transform->rotate( &angle );
+    transform->scale( 1.5, 0.75, 2.25 );
+
+    Vector3D offset( 10, -3, 0.125 );
+    transform->translate( &offset );
+
+    return transform;
+    }
+
+
+
+void checkImplementation( int inLevel, RandomSource *inRandSource ) {
+    setPointKernelImplementationLimit( inLevel );
+
+    // odd size to exercise the portable tail after vector blocks
+    int n = 1003;
+
+    Vector3D **vectors = new Vector3D*[n];
+    Vector3D **others = new Vector3D*[n];
+    doubleTriple *triples = new doubleTriple[n];
+
+    for( int i=0; i<n; i++ ) {
+        vectors[i] = new Vector3D(
+            inRandSource->getRandomBoundedDouble( -100, 100 ),
+            inRandSource->getRandomBoundedDouble( -100, 100 ),
+            inRandSource->getRandomBoundedDouble( -100, 100 ) );
+        others[i] = new Vector3D(
+            inRandSource->getRandomBoundedDouble( -1, 1 ),
+            inRandSource->getRandomBoundedDouble( -1, 1 ),
+            inRandSource->getRandomBoundedDouble( -1, 1 ) );
+        triples[i] = vectors[i]->getTriple();
+        }
+
+    PointCloud3D cloud( vectors, n );
+    PointCloud3D otherCloud( others, n );
+
+    check( sameAsVectors( &cloud, vectors ), "copy in", inLevel );
+
+
+    Transform3D *transform = makeTransform();
+
+    transform->apply( &cloud );
+    transform->apply( triples, n );
+    for( int i=0; i<n; i++ ) {
+        transform->apply( vectors[i] );
+        }
+    check( sameAsVectors( &cloud, vectors ), "apply", inLevel );
+
+    PointCloud3D tripleCloud( triples, n );
+    check( sameAsVectors( &tripleCloud, vectors ), "apply triples",
+           inLevel );
+
+    transform->applyNoTranslation( &cloud );
+    for( int i=0; i<n; i++ ) {
+        transform->applyNoTranslation( vectors[i] );
+        }
+    check( sameAsVectors( &cloud, vectors ), "apply no translation",
+           inLevel );
+    delete transform;
+
+
+    Angle3D angles[4] = { Angle3D( 0.7, -0.2, 1.9 ),
+                          Angle3D( 0, 0.4, 0 ),
+                          Angle3D( -1.2, 0, 0.3 ),
+                          Angle3D( 0, 0, 0 ) };
+    for( int a=0; a<4; a++ ) {
+        cloud.rotate( &( angles[a] ) );
+        for( int i=0; i<n; i++ ) {
+            vectors[i]->rotate( &( angles[a] ) );
+            }
+        check( sameAsVectors( &cloud, vectors ), "rotate angle", inLevel );
+
+        doubleTriple p = rotate( triples[a], &( angles[a] ) );
+        Vector3D v( triples[a].x, triples[a].y, triples[a].z );
+        v.rotate( &( angles[a] ) );
+        check( equal( p, v.getTriple() ), "rotate triple", inLevel );
+        }
+
+
+    Vector3D axis( 0.3, -0.5, 0.8 );
+    axis.normalize();
+    cloud.rotate( axis.getTriple(), 0.9 );
+    for( int i=0; i<n; i++ ) {
+        vectors[i]->rotate( &axis, 0.9 );
+        }
+    check( sameAsVectors( &cloud, vectors ), "rotate axis", inLevel );
+
+
+    cloud.translate( makeTriple( 1, 2, 3 ) );
+    cloud.scale( 0.25 );
+    Vector3D offset( 1, 2, 3 );
+    for( int i=0; i<n; i++ ) {
+        vectors[i]->add( &offset );
+        vectors[i]->scale( 0.25 );
+        }
+    check( sameAsVectors( &cloud, vectors ), "translate and scale",
+           inLevel );
+
+
+    double *dots = new double[n];
+    cloud.dot( &otherCloud, dots );
+    char dotsMatch = true;
+    for( int i=0; i<n; i++ ) {
+        if( dots[i] != vectors[i]->dot( others[i] ) ||
+            dots[i] != dot( vectors[i]->getTriple(),
+                            others[i]->getTriple() ) ) {
+            dotsMatch = false;
+            }
+        }
+    check( dotsMatch, "dot", inLevel );
+    delete [] dots;
+
+
+    cloud.cross( &otherCloud );
+    char triplesMatch = true;
+    for( int i=0; i<n; i++ ) {
+        doubleTriple c = cross( vectors[i]->getTriple(),
+                                others[i]->getTriple() );
+        Vector3D *crossVector = vectors[i]->cross( others[i] );
+        vectors[i]->setCoordinates( crossVector );
+        delete crossVector;
+
+        if( !equal( c, vectors[i]->getTriple() ) ) {
+            triplesMatch = false;
+            }
+        }
+    check( sameAsVectors( &cloud, vectors ), "cross", inLevel );
+    check( triplesMatch, "cross triple", inLevel );
+
+
+    cloud.normalize();
+    for( int i=0; i<n; i++ ) {
+        vectors[i]->normalize();
+
+        doubleTriple t = normalize( others[i]->getTriple() );
+        others[i]->normalize();
+        if( !equal( t, others[i]->getTriple() ) ) {
+            triplesMatch = false;
+            }
+        }
+    check( sameAsVectors( &cloud, vectors ), "normalize", inLevel );
+    check( triplesMatch, "normalize triple", inLevel );
+
+
+    PointCloud3D grown;
+    for( int i=0; i<n; i++ ) {
+        grown.addPoint( vectors[i]->getTriple() );
+        }
+    check( sameAsVectors( &grown, vectors ), "add points", inLevel );
+
+
+    for( int i=0; i<n; i++ ) {
+        delete vectors[i];
+        delete others[i];
+        }
+    delete [] vectors;
+    delete [] others;
+    delete [] triples;
+    }
+
+
+
+int main() {
+    XoshiroRandomSource randSource( 12345 );
+
+    int maxLevel = getPointKernelImplementation();
+
+    for( int level=0; level<=maxLevel; level++ ) {
+        checkImplementation( level, &randSource );
+        }
+
+    if( failures == 0 ) {
+        printf( "All kernels match Vector3D for implementations 0 to %d\n",
+                maxLevel );
+        }
+
+
+    int n = 1000000;
+    int numRounds = 20;
+
+    printf( "\n%d points, %d transforms each, points per second:\n",
+            n, numRounds );
+
+    Vector3D **vectors = new Vector3D*[n];
+    doubleTriple *triples = new doubleTriple[n];
+    PointCloud3D cloud( n );
+
+    for( int i=0; i<n; i++ ) {
+        vectors[i] = new Vector3D(
+            randSource.getRandomBoundedDouble( -100, 100 ),
+            randSource.getRandomBoundedDouble( -100, 100 ),
+            randSource.getRandomBoundedDouble( -100, 100 ) );
+        triples[i] = vectors[i]->getTriple();
+        cloud.setPoint( i, triples[i] );
+        }
+
+    // a transform close to identity, so repeated rounds stay finite
+    Transform3D transform;
+    Angle3D angle( 0.01, -0.02, 0.03 );
+    transform.rotate( &angle );
+    Vector3D offset( 0.001, 0, -0.001 );
+    transform.translate( &offset );
+
+
+    // the way PrimitiveGL used to transform each frame
+    double startTime = Time::getCurrentTime();
+    for( int r=0; r<numRounds; r++ ) {
+        Vector3D **copies = new Vector3D*[n];
+        for( int i=0; i<n; i++ ) {
+            copies[i] = new Vector3D( vectors[i] );
+            transform.apply( copies[i] );
+            }
+        for( int i=0; i<n; i++ ) {
+            delete copies[i];
+            }
+        delete [] copies;
+        }
+    double time = Time::getCurrentTime() - startTime;
+    double baseRate = numRounds * n / time;
+    printf( "  %-32s %7.1f M  (%.2fx)\n", "Vector3D copies",
+            baseRate / 1e6, 1.0 );
+
+
+    startTime = Time::getCurrentTime();
+    for( int r=0; r<numRounds; r++ ) {
+        for( int i=0; i<n; i++ ) {
+            transform.apply( vectors[i] );
+            }
+        }
+    time = Time::getCurrentTime() - startTime;
+    printf( "  %-32s %7.1f M  (%.2fx)\n", "Vector3D in place",
+            numRounds * n / time / 1e6, numRounds * n / time / baseRate );
+
+
+    startTime = Time::getCurrentTime();
+    for( int r=0; r<numRounds; r++ ) {
+        transform.apply( triples, n );
+        }
+    time = Time::getCurrentTime() - startTime;
+    printf( "  %-32s %7.1f M  (%.2fx)\n", "doubleTriple array",
+            numRounds * n / time / 1e6, numRounds * n / time / baseRate );
+
+
+    const char *names[3] = { "PointCloud3D portable",
+                             "PointCloud3D SSE2",
+                             "PointCloud3D AVX" };
+
+    for( int level=0; level<=maxLevel; level++ ) {
+        setPointKernelImplementationLimit( level );
+
+        startTime = Time::getCurrentTime();
+        for( int r=0; r<numRounds; r++ ) {
+            transform.apply( &cloud );
+            }
+        time = Time::getCurrentTime() - startTime;
+        printf( "  %-32s %7.1f M  (%.2fx)\n", names[level],
+                numRounds * n / time / 1e6,
+                numRounds * n / time / baseRate );
+        }
+
+
+    printf( "\nOther operations, AVX or best available:\n" );
+    setPointKernelImplementationLimit( maxLevel );
+
+    startTime = Time::getCurrentTime();
+    for( int r=0; r<numRounds; r++ ) {
+        for( int i=0; i<n; i++ ) {
+            vectors[i]->normalize();
+            }
+        }
+    double vectorTime = Time::getCurrentTime() - startTime;
+
+    startTime = Time::getCurrentTime();
+    for( int r=0; r<numRounds; r++ ) {
+        cloud.normalize();
+        }
+    time = Time::getCurrentTime() - startTime;
+    printf( "  %-32s %7.1f M  (%.2fx over Vector3D)\n", "normalize",
+            numRounds * n / time / 1e6, vectorTime / time );
+
+
+    startTime = Time::getCurrentTime();
+    for( int r=0; r<numRounds; r++ ) {
+        for( int i=0; i<n; i++ ) {
+            vectors[i]->rotate( &angle );
+            }
+        }
+    vectorTime = Time::getCurrentTime() - startTime;
+
+    startTime = Time::getCurrentTime();
+    for( int r=0; r<numRounds; r++ ) {
+        cloud.rotate( &angle );
+        }
+    time = Time::getCurrentTime() - startTime;
+    printf( "  %-32s %7.1f M  (%.2fx over Vector3D)\n", "rotate",
+            numRounds * n / time / 1e6, vectorTime / time );
+
+
+    for( int i=0; i<n; i++ ) {
+        delete vectors[i];
+        }
+    delete [] vectors;
+    delete [] triples;
+
+    if( failures > 0 ) {
+        printf( "%d checks FAILED\n", failures );
+        return 1;
+        }
+    return 0;
+    }
@@ -0,0 +1,236 @@
+#ifndef ALIAS_SAMPLER_INCLUDED
+#define ALIAS_SAMPLER_INCLUDED
+
+
+#include "minorGems/util/random/RandomSource.h"
+
+#include <stddef.h>
+
+
+
+/**
+ * Samples from a fixed discrete distribution in constant time, using
+ * Walker's alias method as built by Vose's algorithm.
+ *
+ * Each element i gets a column holding a probability and an alias.  A
+ * sample picks a column uniformly, then returns the column's own element
+ * or its alias by a weighted coin flip.
+ *
+ * Building takes O(n), so this pays off for distributions that are
+ * sampled many times between changes.  See FenwickSampler for
+ * distributions that change often.
+ *
+ * @author Jason Rohrer
+ */
+class AliasSampler {
+
+    public:
+
+        /**
+         * Builds a sampler.
+         *
+         * @param inNumElements the number of elements.
+         * @param inWeights the relative weight of each element, need not
+         *   sum to 1.  Must not be negative.
+         *   Destroyed by caller.
+         */
+        AliasSampler( int inNumElements, const double *inWeights );
+
+
+        ~AliasSampler();
+
+
+
+        /**
+         * Rebuilds this sampler for a new distribution.
+         *
+         * Parameters are the same as for the constructor.
+         */
+        void rebuild( int inNumElements, const double *inWeights );
+
+
+
+        /**
+         * Samples an element according to the distribution.
+         *
+         * @param inRandSource the random source to draw from.
+         *   Destroyed by caller.
+         *
+         * @return the index of the sampled element, or 0 if there are
+         *   no elements.
+         */
+        int sample( RandomSource *inRandSource );
+
+
+
+        /**
+         * Samples many elements.
+         *
+         * @param inRandSource the random source to draw from.
+         *   Destroyed by caller.
+         * @param inNumSamples the number of samples to draw.
+         * @param outIndices array where inNumSamples indices will be
+         *   returned.
+         *   Destroyed by caller.
+         */
+        void sampleMany( RandomSource *inRandSource,
+                         int inNumSamples, int *outIndices );
+
+
+
+        int getNumElements() {
+            return mNumElements;
+            }
+
+
+    protected:
+
+        int mNumElements;
+
+        // chance of keeping the column's own element
+        double *mKeepProbability;
+
+        int *mAlias;
+
+    };
+
+
+
+inline AliasSampler::AliasSampler( int inNumElements,
+                                   const double *inWeights )
+        : mNumElements( 0 ),
+          mKeepProbability( NULL ),
+          mAlias( NULL ) {
+
+    rebuild( inNumElements, inWeights );
+    }
+
+
+
+inline AliasSampler::~AliasSampler() {
+    if( mKeepProbability != NULL ) {
+        delete [] mKeepProbability;
+        }
+    if( mAlias != NULL ) {
+        delete [] mAlias;
+        }
+    }
+
+
+
+inline void AliasSampler::rebuild( int inNumElements,
+                                   const double *inWeights ) {
+
+    if( inNumElements != mNumElements ) {
+        if( mKeepProbability != NULL ) {
+            delete [] mKeepProbability;
+            delete [] mAlias;
+            }
+        mNumElements = inNumElements;
+
+        mKeepProbability = new double[ mNumElements ];
+        mAlias = new int[ mNumElements ];
+        }
+
+    int n = mNumElements;
+
+    if( n == 0 ) {
+        return;
+        }
+
+    double total = 0;
+    for( int i=0; i<n; i++ ) {
+        total += inWeights[i];
+        }
+
+    if( total <= 0 ) {
+        // treat as uniform
+        for( int i=0; i<n; i++ ) {
+            mKeepProbability[i] = 1;
+            mAlias[i] = i;
+            }
+        return;
+        }
+
+
+    // weights scaled so that the average column is exactly full
+    double scale = n / total;
+
+    // work lists of columns below and above full, both kept in one
+    // array, small from the front and large from the back
+    int *work = new int[ n ];
+    int numSmall = 0;
+    int numLarge = 0;
+
+    for( int i=0; i<n; i++ ) {
+        mKeepProbability[i] = inWeights[i] * scale;
+        mAlias[i] = i;
+
+        if( mKeepProbability[i] < 1 ) {
+            work[ numSmall ] = i;
+            numSmall++;
+            }
+        else {
+            numLarge++;
+            work[ n - numLarge ] = i;
+            }
+        }
+
+    while( numSmall > 0 && numLarge > 0 ) {
+        numSmall--;
+        int small = work[ numSmall ];
+
+        int large = work[ n - numLarge ];
+
+        // fill the rest of small's column with large
+        mAlias[ small ] = large;
+
+        mKeepProbability[ large ] =
+            ( mKeepProbability[ large ] + mKeepProbability[ small ] ) - 1;
+
+        if( mKeepProbability[ large ] < 1 ) {
+            // large is now small
+            numLarge--;
+            work[ numSmall ] = large;
+            numSmall++;
+            }
+        }
+
+    // whatever is left is full, up to rounding error
+    for( int i=0; i<numLarge; i++ ) {
+        mKeepProbability[ work[ n - 1 - i ] ] = 1;
+        }
+    for( int i=0; i<numSmall; i++ ) {
+        mKeepProbability[ work[i] ] = 1;
+        }
+
+    delete [] work;
+    }
+
+
+
+inline int AliasSampler::sample( RandomSource *inRandSource ) {
+    if( mNumElements == 0 ) {
+        return 0;
+        }
+
+    int column = inRandSource->getRandomBoundedInt( 0, mNumElements - 1 );
+
+    if( inRandSource->getRandomDouble() < mKeepProbability[ column ] ) {
+        return column;
+        }
+    return mAlias[ column ];
+    }
+
+
+
+inline void AliasSampler::sampleMany( RandomSource *inRandSource,
+                                      int inNumSamples, int *outIndices ) {
+    for( int i=0; i<inNumSamples; i++ ) {
+        outIndices[i] = sample( inRandSource );
+        }
+    }
+
+
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef FENWICK_SAMPLER_INCLUDED
+#define FENWICK_SAMPLER_INCLUDED
+
+
+#include "minorGems/util/SimpleVector.h"
+#include "minorGems/util/random/RandomSource.h"
+
+
+
+/**
+ * Samples from a discrete distribution that changes over time, with
+ * O(log n) weight updates and samples.
+ *
+ * Weights are kept in a Fenwick tree (binary indexed tree) of partial
+ * sums.  A sample draws a point in [0, total) and walks down the tree to
+ * the element whose range holds it.
+ *
+ * Weights are relative and need not sum to 1.
+ *
+ * See AliasSampler for faster sampling of distributions that don't
+ * change.
+ *
+ * @author Jason Rohrer
+ */
+class FenwickSampler {
+
+    public:
+
+        FenwickSampler();
+
+
+        /**
+         * Constructs a sampler with elements already inserted, in O(n).
+         *
+         * @param inNumElements the number of elements.
+         * @param inWeights the weight of each element.  Must not be
+         *   negative.
+         *   Destroyed by caller.
+         */
+        FenwickSampler( int inNumElements, const double *inWeights );
+
+
+
+        int getNumElements() {
+            return mWeights.size();
+            }
+
+
+
+        /**
+         * Adds an element at the end.  O(log n).
+         *
+         * @return the index of the new element.
+         */
+        int addElement( double inWeight );
+
+
+
+        /**
+         * Removes an element, shifting later elements down one index.
+         *
+         * O(log n) for the last element, O(n) otherwise.
+         */
+        void removeElement( int inIndex );
+
+
+
+        /**
+         * Sets the weight of an element.  O(log n).
+         */
+        void setWeight( int inIndex, double inWeight );
+
+
+
+        double getWeight( int inIndex ) {
+            return mWeights.getElementDirect( inIndex );
+            }
+
+
+
+        /**
+         * Multiplies all weights by a factor.  O(n).
+         */
+        void scaleWeights( double inFactor );
+
+
+
+        /**
+         * Gets the sum of all weights.  O(log n).
+         */
+        double getTotalWeight();
+
+
+
+        /**
+         * Gets a pointer to all of the weights, in index order, for
+         * building other samplers.
+         *
+         * Valid until the next change to this sampler.
+         */
+        const double *getWeights() {
+            return mWeights.getElementFast( 0 );
+            }
+
+
+
+        /**
+         * Samples an element according to the distribution.
+         *
+         * @param inRandSource the random source to draw from.
+         *   Destroyed by caller.
+         *
+         * @return the index of the sampled element, or 0 if there are
+         *   no elements.
+         */
+        int sample( RandomSource *inRandSource );
+
+
+
+        /**
+         * Samples many elements.
+         *
+         * @param inRandSource the random source to draw from.
+         *   Destroyed by caller.
+         * @param inNumSamples the number of samples to draw.
+         * @param outIndices array where inNumSamples indices will be
+         *   returned.
+         *   Destroyed by caller.
+         */
+        void sampleMany( RandomSource *inRandSource,
+                         int inNumSamples, int *outIndices );
+
+
+
+    protected:
+
+        SimpleVector<double> mWeights;
+
+        // 1-based Fenwick tree, so mTree[0] is unused
+        // mTree[i] holds the sum of weights ( i - lowbit(i), i ]
+        SimpleVector<double> mTree;
+
+        // updates add and subtract into the partial sums, so rounding
+        // error builds up, rebuild from mWeights once it could matter
+        int mUpdatesSinceRebuild;
+
+
+        // rebuilds all partial sums in O(n)
+        void rebuildTree();
+
+
+        // adds inDelta to the weight of element inIndex in the tree
+        void addToTree( int inIndex, double inDelta );
+
+
+        // finds the element whose range of partial sums holds inTarget
+        int findElement( double inTarget );
+
+    };
+
+
+
+inline FenwickSampler::FenwickSampler()
+        : mUpdatesSinceRebuild( 0 ) {
+    mTree.push_back( 0 );
+    }
+
+
+
+inline FenwickSampler::FenwickSampler( int inNumElements,
+                                       const double *inWeights )
+        : mWeights( inNumElements ),
+          mTree( inNumElements + 1 ),
+          mUpdatesSinceRebuild( 0 ) {
+
+    mWeights.appendArray( (double *)inWeights, inNumElements );
+
+    rebuildTree();
+    }
+
+
+
+inline void FenwickSampler::rebuildTree() {
+    int n = mWeights.size();
+
+    mTree.deleteAll();
+    mTree.push_back( 0 );
+    mTree.appendArray( mWeights.getElementFast( 0 ), n );
+
+    double *tree = mTree.getElementFast( 0 );
+
+    // push each node's sum up to its parent
+    for( int i=1; i<=n; i++ ) {
+        int parent = i + ( i & -i );
+        if( parent <= n ) {
+            tree[ parent ] += tree[i];
+            }
+        }
+
+    mUpdatesSinceRebuild = 0;
+    }
+
+
+
+inline void FenwickSampler::addToTree( int inIndex, double inDelta ) {
+    int n = mWeights.size();
+    double *tree = mTree.getElementFast( 0 );
+
+    for( int i = inIndex + 1; i <= n; i += ( i & -i ) ) {
+        tree[i] += inDelta;
+        }
+    }
+
+
+
+inline int FenwickSampler::addElement( double inWeight ) {
+    mWeights.push_back( inWeight );
+
+    int n = mWeights.size();
+
+    // new node n covers ( n - lowbit(n), n ], the elements before n in
+    // that range are the differences of partial sums
+    double nodeSum = inWeight;
+
+    double *tree = mTree.getElementFast( 0 );
+
+    int stop = n - ( n & -n );
+    for( int i = n - 1; i > stop; i -= ( i & -i ) ) {
+        nodeSum += tree[i];
+        }
+
+    mTree.push_back( nodeSum );
+
+    return n - 1;
+    }
+
+
+
+inline void FenwickSampler::removeElement( int inIndex ) {
+    int n = mWeights.size();
+
+    if( inIndex < 0 || inIndex >= n ) {
+        return;
+        }
+
+    if( inIndex == n - 1 ) {
+        // last node's sum is not part of any other node
+        mWeights.deleteLastElement();
+        mTree.deleteLastElement();
+        return;
+        }
+
+    mWeights.deleteElement( inIndex );
+    rebuildTree();
+    }
+
+
+
+inline void FenwickSampler::setWeight( int inIndex, double inWeight ) {
+    if( inIndex < 0 || inIndex >= mWeights.size() ) {
+        return;
+        }
+
+    double *weight = mWeights.getElementFast( inIndex );
+
+    double delta = inWeight - *weight;
+    *weight = inWeight;
+
+    mUpdatesSinceRebuild++;
+
+    if( mUpdatesSinceRebuild > mWeights.size() + 64 ) {
+        // O(n) once every n updates
+        rebuildTree();
+        }
+    else {
+        addToTree( inIndex, delta );
+        }
+    }
+
+
+
+inline void FenwickSampler::scaleWeights( double inFactor ) {
+    int n = mWeights.size();
+    double *weights = mWeights.getElementFast( 0 );
+
+    for( int i=0; i<n; i++ ) {
+        weights[i] *= inFactor;
+        }
+
+    rebuildTree();
+    }
+
+
+
+inline double FenwickSampler::getTotalWeight() {
+    double *tree = mTree.getElementFast( 0 );
+
+    double total = 0;
+    for( int i = mWeights.size(); i > 0; i -= ( i & -i ) ) {
+        total += tree[i];
+        }
+    return total;
+    }
+
+
+
+inline int FenwickSampler::findElement( double inTarget ) {
+    int n = mWeights.size();
+    double *tree = mTree.getElementFast( 0 );
+
+    int step = 1;
+    while( step * 2 <= n ) {
+        step *= 2;
+        }
+
+    // largest position whose prefix sum is <= inTarget
+    int position = 0;
+    double remaining = inTarget;
+
+    for( ; step > 0; step >>= 1 ) {
+        int next = position + step;
+
+        if( next <= n && tree[ next ] <= remaining ) {
+            position = next;
+            remaining -= tree[ next ];
+            }
+        }
+
+    // element at 1-based position + 1
+    if( position >= n ) {
+        // inTarget at (or past, by rounding) the total
+        position = n - 1;
+
+        // never land on a weightless element
+        while( position > 0 &&
+               mWeights.getElementDirectFast( position ) <= 0 ) {
+            position--;
+            }
+        }
+
+    return position;
+    }
+
+
+
+inline int FenwickSampler::sample( RandomSource *inRandSource ) {
+    if( mWeights.size() == 0 ) {
+        return 0;
+        }
+
+    double target = inRandSource->getRandomDouble() * getTotalWeight();
+
+    return findElement( target );
+    }
+
+
+
+inline void FenwickSampler::sampleMany( RandomSource *inRandSource,
+                                        int inNumSamples, int *outIndices ) {
+    if( mWeights.size() == 0 ) {
+        for( int i=0; i<inNumSamples; i++ ) {
+            outIndices[i] = 0;
+            }
+        return;
+        }
+
+    double total = getTotalWeight();
+
+    for( int i=0; i<inNumSamples; i++ ) {
+        outIndices[i] =
+            findElement( inRandSource->getRandomDouble() * total );
+        }
+    }
+
+
+
+#endif
@@ -24,9 +24,13 @@
 #define PROBABILITY_MASS_FUNCTION_INCLUDED
 
 
-#include "minorGems/util/SimpleVector.h"
 #include "minorGems/util/random/RandomSource.h"
 
+#include "AliasSampler.h"
+#include "FenwickSampler.h"
+
+
+#include <stdio.h>
 
 
 
@@ -34,6 +38,11 @@
  * A discrete probability distribution.
  * All probabilities are constrained to sum to 1.
  *
+ * Probabilities are stored as relative weights in a FenwickSampler, so
+ * changes and samples take O(log n) time.  When a distribution is sampled
+ * more times than it has elements without changing, an AliasSampler is
+ * built so that further samples take constant time.
+ *
  * @author Jason Rohrer
  */
 class ProbabilityMassFunction {
@@ -139,6 +148,20 @@ class ProbabilityMassFunction {
 		 * @return the index of the sampled element.
 		 */
 		virtual int sampleElement();
+
+
+
+		/**
+		 * Samples many elements at random according to this distribution.
+		 *
+		 * Faster than calling sampleElement repeatedly.
+		 *
+		 * @param inNumSamples the number of samples to draw.
+		 * @param outIndices array where inNumSamples indices of sampled
+		 *   elements will be returned.
+		 *   Destroyed by caller.
+		 */
+		virtual void sampleMany( int inNumSamples, int *outIndices );
 		
 
 
@@ -164,7 +187,16 @@ class ProbabilityMassFunction {
 	protected:
 		RandomSource *mRandSource;
 		
-		SimpleVector< double > *mProbabilityVector;
+		// relative weights, probabilities are weights over the total
+		FenwickSampler mWeights;
+
+		// built on demand, NULL until first needed
+		AliasSampler *mAliasSampler;
+
+		char mAliasSamplerValid;
+
+		// samples drawn since the distribution last changed
+		int mSamplesSinceChange;
 
 
 
@@ -183,6 +215,15 @@ class ProbabilityMassFunction {
 		virtual double getProbabilitySum();
 
 
+
+		// called after any change to the distribution
+		void distributionChanged();
+
+
+		// true if the alias sampler is (now) ready to use for
+		// inNumSamples more samples
+		char useAliasSampler( int inNumSamples );
+
 		
 	};
 
@@ -191,7 +232,9 @@ class ProbabilityMassFunction {
 inline ProbabilityMassFunction::ProbabilityMassFunction(
 	RandomSource *inRandSource )
 	: mRandSource( inRandSource ),
-	  mProbabilityVector( new SimpleVector< double >() ) {
+	  mAliasSampler( NULL ),
+	  mAliasSamplerValid( false ),
+	  mSamplesSinceChange( 0 ) {
 	}
 
 
@@ -200,11 +243,10 @@ inline ProbabilityMassFunction::ProbabilityMassFunction(
 	RandomSource *inRandSource,
 	int inNumElements, double *inProbabilities )
 	: mRandSource( inRandSource ),
-	  mProbabilityVector( new SimpleVector< double >( inNumElements ) ){
-
-	for( int i=0; i<inNumElements; i++ ) {
-		mProbabilityVector->push_back( inProbabilities[i] );
-		}
+	  mWeights( inNumElements, inProbabilities ),
+	  mAliasSampler( NULL ),
+	  mAliasSamplerValid( false ),
+	  mSamplesSinceChange( 0 ) {
 
 	normalize();
 	}
@@ -213,8 +255,24 @@ inline ProbabilityMassFunction::ProbabilityMassFunction(
 
 inline ProbabilityMassFunction::~ProbabilityMassFunction() {
 
-	// we can simply delete this vector, since its elements are primitives
-	delete mProbabilityVector;	
+	if( mAliasSampler != NULL ) {
+		delete mAliasSampler;
+		}
+	}
+
+
+
+inline void ProbabilityMassFunction::distributionChanged() {
+	mAliasSamplerValid = false;
+	mSamplesSinceChange = 0;
+
+	double total = mWeights.getTotalWeight();
+
+	// probabilities are added and set relative to the total, so
+	// weights drift up or down over many changes
+	if( total > 1e100 || ( total > 0 && total < 1e-100 ) ) {
+		normalize();
+		}
 	}
 
 
@@ -222,11 +280,19 @@ inline ProbabilityMassFunction::~ProbabilityMassFunction() {
 inline int ProbabilityMassFunction::addElement(
 	double inProbability ) {
 
-	mProbabilityVector->push_back( inProbability );
+	double total = mWeights.getTotalWeight();
 
-	normalize();
+	if( total > 0 ) {
+		// other probabilities sum to 1, so scale to match
+		mWeights.addElement( inProbability * total );
+		}
+	else {
+		mWeights.addElement( inProbability );
+		}
+
+	distributionChanged();
 	
-	return mProbabilityVector->size();
+	return mWeights.getNumElements();
 	}
 
 
@@ -234,9 +300,9 @@ inline int ProbabilityMassFunction::addElement(
 inline void ProbabilityMassFunction::removeElement(
 	int inIndex ) {
 
-	mProbabilityVector->deleteElement( (int)inIndex );
+	mWeights.removeElement( inIndex );
 
-	normalize();	
+	distributionChanged();
 	}
 
 
@@ -244,12 +310,15 @@ inline void ProbabilityMassFunction::removeElement(
 inline double ProbabilityMassFunction::getProbability(
 	int inIndex ) {
 
-	if( inIndex >= 0 && inIndex < mProbabilityVector->size() ) {
-		return *( mProbabilityVector->getElement( inIndex ) );
-		}
-	else {
-		return 0;
+	if( inIndex >= 0 && inIndex < mWeights.getNumElements() ) {
+		double total = mWeights.getTotalWeight();
+
+		if( total > 0 ) {
+			return mWeights.getWeight( inIndex ) / total;
+			}
 		}
+
+	return 0;
 	}
 
 
@@ -257,45 +326,71 @@ inline double ProbabilityMassFunction::getProbability(
 inline void ProbabilityMassFunction::setProbability( int inIndex,
 													 double inProbability ) {
 
-	if( inIndex >= 0 && inIndex < mProbabilityVector->size() ) {
-		*( mProbabilityVector->getElement( inIndex ) ) = inProbability;
-		normalize();
+	if( inIndex >= 0 && inIndex < mWeights.getNumElements() ) {
+		double total = mWeights.getTotalWeight();
+
+		if( total > 0 ) {
+			mWeights.setWeight( inIndex, inProbability * total );
+			}
+		else {
+			mWeights.setWeight( inIndex, inProbability );
+			}
+
+		distributionChanged();
 		}
 	}
 
 
 
-inline int ProbabilityMassFunction::sampleElement() {
+inline char ProbabilityMassFunction::useAliasSampler( int inNumSamples ) {
 
-	double randVal = mRandSource->getRandomDouble();
-	
-	// compute a running CDF value until we surpass randVal
-	double currentCDFVal = 0;
-	int currentIndex = -1;
-	
-    int numValues = mProbabilityVector->size();
-    
+	if( mAliasSamplerValid ) {
+		return true;
+		}
 
-	while( currentCDFVal < randVal && 
-           currentIndex < numValues - 1 ) {
-		
-        currentIndex++;
+	mSamplesSinceChange += inNumSamples;
 
-		double currentProb =
-			*( mProbabilityVector->getElement( currentIndex ) );
+	int numElements = mWeights.getNumElements();
 
-		currentCDFVal += currentProb;
+	if( mSamplesSinceChange < numElements ) {
+		// O(n) build not paid for yet
+		return false;
 		}
-	// when we exit the while loop, we are at the index of the
-	// element whose probability pushed the CDF past randVal
 
-	
-	if( currentIndex == -1 ) {
-		// randVal was 0
-		return 0;
+	if( mAliasSampler == NULL ) {
+		mAliasSampler =
+			new AliasSampler( numElements, mWeights.getWeights() );
 		}
 	else {
-		return currentIndex;
+		mAliasSampler->rebuild( numElements, mWeights.getWeights() );
+		}
+
+	mAliasSamplerValid = true;
+
+	return true;
+	}
+
+
+
+inline int ProbabilityMassFunction::sampleElement() {
+
+	if( useAliasSampler( 1 ) ) {
+		return mAliasSampler->sample( mRandSource );
+		}
+
+	return mWeights.sample( mRandSource );
+	}
+
+
+
+inline void ProbabilityMassFunction::sampleMany( int inNumSamples,
+												 int *outIndices ) {
+
+	if( useAliasSampler( inNumSamples ) ) {
+		mAliasSampler->sampleMany( mRandSource, inNumSamples, outIndices );
+		}
+	else {
+		mWeights.sampleMany( mRandSource, inNumSamples, outIndices );
 		}
 	}
 
@@ -305,11 +400,16 @@ inline double ProbabilityMassFunction::getMinimumProbability() {
 	// works, since all values <= 1
 	double minValue = 2;
 
-	int numElements = mProbabilityVector->size();
+	double total = mWeights.getTotalWeight();
+
+	int numElements = mWeights.getNumElements();
 	
 	for( int i=0; i<numElements; i++ ) {
 
-		double prob = *( mProbabilityVector->getElement( i ) );
+		double prob = 0;
+		if( total > 0 ) {
+			prob = mWeights.getWeight( i ) / total;
+			}
 
 		if( prob < minValue ) {
 			minValue = prob;
@@ -323,20 +423,10 @@ inline double ProbabilityMassFunction::getMinimumProbability() {
 
 inline void ProbabilityMassFunction::normalize() {
 
-	double currentSum = getProbabilitySum();
-
-	if( currentSum != 1 ) {
-		double invCurrentSum = 1.0 / currentSum;
-
-		int numElements = mProbabilityVector->size();
-
-		for( int i=0; i<numElements; i++ ) {
-
-			double *prob = mProbabilityVector->getElement( i );
-
-			*prob = (*prob) * invCurrentSum;
-			}
+	double currentSum = mWeights.getTotalWeight();
 
+	if( currentSum != 1 && currentSum > 0 ) {
+		mWeights.scaleWeights( 1.0 / currentSum );
 		}
 	}
 
@@ -345,11 +435,11 @@ inline void ProbabilityMassFunction::normalize() {
 inline double ProbabilityMassFunction::getProbabilitySum() {
 	double sum = 0;
 
-	int numElements = mProbabilityVector->size();
+	int numElements = mWeights.getNumElements();
 
 	for( int i=0; i<numElements; i++ ) {
 		
-		sum += *( mProbabilityVector->getElement( i ) );
+		sum += getProbability( i );
 		}
 	
 	return sum;
@@ -358,10 +448,10 @@ inline double ProbabilityMassFunction::getProbabilitySum() {
 
 
 inline void ProbabilityMassFunction::print() {
-	int numElements = mProbabilityVector->size();
+	int numElements = mWeights.getNumElements();
 
 	for( int i=0; i<numElements; i++ ) {
-		double prob = *( mProbabilityVector->getElement( i ) );
+		double prob = getProbability( i );
 
 		printf( "%lf ", prob );
 		}
@@ -0,0 +1,494 @@
+// Checks AliasSampler, FenwickSampler, and ProbabilityMassFunction against
+// a copy of the original linear-scan mass function, then measures samples
+// per second for each across distribution sizes.
+//
+// Usage:  pmfBenchmark
+
+
+#include "ProbabilityMassFunction.h"
+
+#include "minorGems/util/random/XoshiroRandomSource.h"
+#include "minorGems/system/Time.h"
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+
+// copy of the original implementation, normalized probabilities with a
+// linear CDF scan
+class OldProbabilityMassFunction {
+    public:
+
+        OldProbabilityMassFunction( RandomSource *inRandSource,
+                                    int inNumElements,
+                                    double *inProbabilities )
+                : mRandSource( inRandSource ) {
+            for( int i=0; i<inNumElements; i++ ) {
+                mProbabilities.push_back( inProbabilities[i] );
+                }
+            normalize();
+            }
+
+
+        int addElement( double inProbability ) {
+            mProbabilities.push_back( inProbability );
+            normalize();
+            return mProbabilities.size();
+            }
+
+
+        void removeElement( int inIndex ) {
+            mProbabilities.deleteElement( inIndex );
+            normalize();
+            }
+
+
+        double getProbability( int inIndex ) {
+            if( inIndex >= 0 && inIndex < mProbabilities.size() ) {
+                return mProbabilities.getElementDirect( inIndex );
+                }
+            return 0;
+            }
+
+
+        void setProbability( int inIndex, double inProbability ) {
+            if( inIndex >= 0 && inIndex < mProbabilities.size() ) {
+                *( mProbabilities.getElement( inIndex ) ) = inProbability;
+                normalize();
+                }
+            }
+
+
+        int sampleElement() {
+            double randVal = mRandSource->getRandomDouble();
+
+            double currentCDFVal = 0;
+            int currentIndex = -1;
+
+            int numValues = mProbabilities.size();
+
+            while( currentCDFVal < randVal &&
+                   currentIndex < numValues - 1 ) {
+                currentIndex++;
+                currentCDFVal += mProbabilities.getElementDirect(
+                    currentIndex );
+                }
+
+            if( currentIndex == -1 ) {
+                return 0;
+                }
+            return currentIndex;
+            }
+
+
+    protected:
+        RandomSource *mRandSource;
+        SimpleVector<double> mProbabilities;
+
+        void normalize() {
+            double sum = 0;
+            int n = mProbabilities.size();
+            for( int i=0; i<n; i++ ) {
+                sum += mProbabilities.getElementDirect( i );
+                }
+            if( sum != 1 ) {
+                for( int i=0; i<n; i++ ) {
+                    *( mProbabilities.getElement( i ) ) /= sum;
+                    }
+                }
+            }
+    };
+
+
+
+static int numFailures = 0;
+
+
+static void check( char inCondition, const char *inDescription ) {
+    if( ! inCondition ) {
+        printf( "FAILED:  %s\n", inDescription );
+        numFailures++;
+        }
+    }
+
+
+
+static double *makeWeights( int inNumElements, RandomSource *inRandSource ) {
+    double *weights = new double[ inNumElements ];
+
+    for( int i=0; i<inNumElements; i++ ) {
+        // skewed, with some zeros
+        double r = inRandSource->getRandomDouble();
+        weights[i] = r * r * r;
+
+        if( i % 7 == 3 ) {
+            weights[i] = 0;
+            }
+        }
+    return weights;
+    }
+
+
+
+// chi-square statistic of sample counts against expected probabilities,
+// returns how many standard deviations above its mean it is
+static double chiSquareDeviation( int inNumElements, double *inProbabilities,
+                                  int *inCounts, int inNumSamples,
+                                  char *outZeroSampled ) {
+    double chiSquare = 0;
+    int degrees = -1;
+
+    *outZeroSampled = false;
+
+    for( int i=0; i<inNumElements; i++ ) {
+        double expected = inProbabilities[i] * inNumSamples;
+
+        if( expected == 0 ) {
+            if( inCounts[i] != 0 ) {
+                *outZeroSampled = true;
+                }
+            continue;
+            }
+
+        double diff = inCounts[i] - expected;
+        chiSquare += diff * diff / expected;
+        degrees++;
+        }
+
+    return ( chiSquare - degrees ) / sqrt( 2.0 * degrees );
+    }
+
+
+
+static void checkDistribution( const char *inName, int inNumElements,
+                               double *inProbabilities, int *inSamples,
+                               int inNumSamples ) {
+    int *counts = new int[ inNumElements ];
+    for( int i=0; i<inNumElements; i++ ) {
+        counts[i] = 0;
+        }
+
+    char outOfRange = false;
+    for( int s=0; s<inNumSamples; s++ ) {
+        if( inSamples[s] < 0 || inSamples[s] >= inNumElements ) {
+            outOfRange = true;
+            }
+        else {
+            counts[ inSamples[s] ]++;
+            }
+        }
+
+    char zeroSampled;
+    double deviation = chiSquareDeviation( inNumElements, inProbabilities,
+                                           counts, inNumSamples,
+                                           &zeroSampled );
+
+    char description[200];
+
+    sprintf( description, "%s, %d elements, index out of range",
+             inName, inNumElements );
+    check( ! outOfRange, description );
+
+    sprintf( description, "%s, %d elements, zero-probability element sampled",
+             inName, inNumElements );
+    check( ! zeroSampled, description );
+
+    // chi-square about 5 standard deviations off happens by chance
+    // less than once in a million
+    sprintf( description, "%s, %d elements, chi-square %.1f sd from mean",
+             inName, inNumElements, deviation );
+    check( fabs( deviation ) < 5, description );
+
+    delete [] counts;
+    }
+
+
+
+static void checkSamplers( int inNumElements ) {
+    XoshiroRandomSource randSource( 1234 + inNumElements );
+
+    double *weights = makeWeights( inNumElements, &randSource );
+
+    double total = 0;
+    for( int i=0; i<inNumElements; i++ ) {
+        total += weights[i];
+        }
+
+    double *probabilities = new double[ inNumElements ];
+    for( int i=0; i<inNumElements; i++ ) {
+        probabilities[i] = weights[i] / total;
+        }
+
+    int numSamples = 200 * inNumElements;
+    if( numSamples < 100000 ) {
+        numSamples = 100000;
+        }
+
+    int *samples = new int[ numSamples ];
+
+
+    AliasSampler alias( inNumElements, weights );
+    alias.sampleMany( &randSource, numSamples, samples );
+    checkDistribution( "AliasSampler", inNumElements, probabilities,
+                       samples, numSamples );
+
+
+    FenwickSampler fenwick( inNumElements, weights );
+    fenwick.sampleMany( &randSource, numSamples, samples );
+    checkDistribution( "FenwickSampler", inNumElements, probabilities,
+                       samples, numSamples );
+
+
+    // build one element at a time, then move weights around
+    FenwickSampler grown;
+    for( int i=0; i<inNumElements; i++ ) {
+        grown.addElement( randSource.getRandomDouble() );
+        }
+    for( int i=0; i<inNumElements * 3; i++ ) {
+        int index = randSource.getRandomBoundedInt( 0, inNumElements - 1 );
+        grown.setWeight( index, randSource.getRandomDouble() );
+        }
+    for( int i=0; i<inNumElements; i++ ) {
+        grown.setWeight( i, weights[i] );
+        }
+    check( fabs( grown.getTotalWeight() - total ) < 1e-9 * total,
+           "FenwickSampler total after updates" );
+
+    for( int s=0; s<numSamples; s++ ) {
+        samples[s] = grown.sample( &randSource );
+        }
+    checkDistribution( "FenwickSampler after updates", inNumElements,
+                       probabilities, samples, numSamples );
+
+
+    ProbabilityMassFunction pmf( &randSource, inNumElements, weights );
+
+    // first samples come from the Fenwick tree, the rest from the
+    // alias table
+    for( int s=0; s<numSamples; s++ ) {
+        samples[s] = pmf.sampleElement();
+        }
+    checkDistribution( "PMF sampleElement", inNumElements, probabilities,
+                       samples, numSamples );
+
+    pmf.sampleMany( numSamples, samples );
+    checkDistribution( "PMF sampleMany", inNumElements, probabilities,
+                       samples, numSamples );
+
+    delete [] samples;
+    delete [] probabilities;
+    delete [] weights;
+    }
+
+
+
+// the facade must report the same probabilities as the original
+static void checkFacade() {
+    XoshiroRandomSource randSource( 99 );
+
+    double start[5] = { 1, 2, 3, 0, 4 };
+
+    OldProbabilityMassFunction oldPMF( &randSource, 5, start );
+    ProbabilityMassFunction pmf( &randSource, 5, start );
+
+    int numElements = 5;
+
+    for( int step=0; step<2000; step++ ) {
+
+        int action = randSource.getRandomBoundedInt( 0, 9 );
+        double p = randSource.getRandomDouble();
+
+        if( action < 3 ) {
+            int oldIndex = oldPMF.addElement( p );
+            int newIndex = pmf.addElement( p );
+            check( oldIndex == newIndex, "addElement return value" );
+            numElements++;
+            }
+        else if( action < 5 ) {
+            if( numElements > 1 ) {
+                int index =
+                    randSource.getRandomBoundedInt( 0, numElements - 1 );
+                oldPMF.removeElement( index );
+                pmf.removeElement( index );
+                numElements--;
+                }
+            }
+        else {
+            // sometimes out of range, which both ignore
+            int index = randSource.getRandomBoundedInt( 0, numElements );
+            oldPMF.setProbability( index, p );
+            pmf.setProbability( index, p );
+            }
+
+        // interleave samples so the alias table gets built and dropped
+        pmf.sampleElement();
+
+        for( int i=0; i<numElements + 2; i++ ) {
+            double oldP = oldPMF.getProbability( i );
+            double newP = pmf.getProbability( i );
+
+            if( fabs( oldP - newP ) > 1e-9 ) {
+                printf( "step %d, element %d: %f vs %f\n", step, i,
+                        oldP, newP );
+                check( false, "facade probability matches original" );
+                return;
+                }
+            }
+        }
+    }
+
+
+
+// sink so results aren't optimized away
+static unsigned int indexSum = 0;
+
+
+
+static void printRate( const char *inName, int inNumSamples, double inTime ) {
+    printf( "  %-34s %9.3f M samples/s\n", inName,
+            inNumSamples / inTime / 1e6 );
+    }
+
+
+
+static void timeSamplers( int inNumElements ) {
+    XoshiroRandomSource randSource( 5678 );
+
+    double *weights = makeWeights( inNumElements, &randSource );
+
+    int numSamples = 2000000;
+    int numOldSamples = numSamples;
+    if( inNumElements >= 1000 ) {
+        // linear scan is too slow for a full run
+        numOldSamples = numSamples / ( inNumElements / 100 );
+        }
+
+    int *samples = new int[ numSamples ];
+
+    printf( "\n%d elements:\n", inNumElements );
+
+    double startTime;
+
+
+    OldProbabilityMassFunction oldPMF( &randSource, inNumElements, weights );
+
+    startTime = Time::getCurrentTime();
+    for( int s=0; s<numOldSamples; s++ ) {
+        indexSum += oldPMF.sampleElement();
+        }
+    printRate( "original linear scan", numOldSamples,
+               Time::getCurrentTime() - startTime );
+
+
+    FenwickSampler fenwick( inNumElements, weights );
+
+    startTime = Time::getCurrentTime();
+    for( int s=0; s<numSamples; s++ ) {
+        indexSum += fenwick.sample( &randSource );
+        }
+    printRate( "FenwickSampler sample", numSamples,
+               Time::getCurrentTime() - startTime );
+
+    startTime = Time::getCurrentTime();
+    fenwick.sampleMany( &randSource, numSamples, samples );
+    indexSum += samples[ numSamples - 1 ];
+    printRate( "FenwickSampler sampleMany", numSamples,
+               Time::getCurrentTime() - startTime );
+
+
+    AliasSampler alias( inNumElements, weights );
+
+    startTime = Time::getCurrentTime();
+    for( int s=0; s<numSamples; s++ ) {
+        indexSum += alias.sample( &randSource );
+        }
+    printRate( "AliasSampler sample", numSamples,
+               Time::getCurrentTime() - startTime );
+
+    startTime = Time::getCurrentTime();
+    alias.sampleMany( &randSource, numSamples, samples );
+    indexSum += samples[ numSamples - 1 ];
+    printRate( "AliasSampler sampleMany", numSamples,
+               Time::getCurrentTime() - startTime );
+
+
+    ProbabilityMassFunction pmf( &randSource, inNumElements, weights );
+
+    startTime = Time::getCurrentTime();
+    for( int s=0; s<numSamples; s++ ) {
+        indexSum += pmf.sampleElement();
+        }
+    printRate( "PMF sampleElement", numSamples,
+               Time::getCurrentTime() - startTime );
+
+    startTime = Time::getCurrentTime();
+    pmf.sampleMany( numSamples, samples );
+    indexSum += samples[ numSamples - 1 ];
+    printRate( "PMF sampleMany", numSamples,
+               Time::getCurrentTime() - startTime );
+
+
+    // one probability change per sample
+    int numMixed = numSamples / 4;
+    int numOldMixed = numOldSamples / 4;
+    if( inNumElements >= 1000 ) {
+        // original normalizes on every change
+        numOldMixed /= ( inNumElements / 100 );
+        }
+    if( numOldMixed < 100 ) {
+        numOldMixed = 100;
+        }
+
+    startTime = Time::getCurrentTime();
+    for( int s=0; s<numOldMixed; s++ ) {
+        oldPMF.setProbability( s % inNumElements,
+                               randSource.getRandomDouble() );
+        indexSum += oldPMF.sampleElement();
+        }
+    printRate( "original, change + sample", numOldMixed,
+               Time::getCurrentTime() - startTime );
+
+    startTime = Time::getCurrentTime();
+    for( int s=0; s<numMixed; s++ ) {
+        pmf.setProbability( s % inNumElements,
+                            randSource.getRandomDouble() );
+        indexSum += pmf.sampleElement();
+        }
+    printRate( "PMF, change + sample", numMixed,
+               Time::getCurrentTime() - startTime );
+
+
+    delete [] samples;
+    delete [] weights;
+    }
+
+
+
+int main() {
+
+    int sizes[5] = { 10, 100, 1000, 10000, 100000 };
+
+    for( int i=0; i<5; i++ ) {
+        checkSamplers( sizes[i] );
+        }
+    checkFacade();
+
+    if( numFailures > 0 ) {
+        printf( "%d checks FAILED\n", numFailures );
+        return 1;
+        }
+    printf( "All sampler checks passed\n" );
+
+
+    for( int i=0; i<5; i++ ) {
+        timeSamplers( sizes[i] );
+        }
+
+    // keep sum live
+    printf( "\n(index sum %u)\n", indexSum );
+
+    return 0;
+    }
@@ -133,7 +133,9 @@ class Socket {
          * For platforms that use FD_SET for non-blocking reads
          * is this socket's internal ID in range for FD_SET calls?
          *
-         * Returns true on platforms that aren't using FD_SET.
+         * Returns true on platforms that aren't using FD_SET, including
+         * Linux and BSD, where all timed waits use poll and any
+         * descriptor number works.
          */
         char isSocketInFDRange();
         
@@ -150,6 +152,11 @@ class Socket {
          *   where a buffer should be sent NOW without waiting for
          *   more data accumulation.
          *   Defaults to true.
+         * @param inMoreComing set to true as a hint that another send
+         *   will follow right away, so that this data can be held and
+         *   sent along with it (MSG_MORE on platforms that support it).
+         *   Ignored if inAllowDelay is false.
+         *   Defaults to false.
          *
 		 * @return the number of bytes sent successfully,
 		 *   or -1 for a socket error.
@@ -158,7 +165,49 @@ class Socket {
 		 */
 		int send( unsigned char *inBuffer, int inNumBytes,
                   char inAllowedToBlock = true,
-                  char inAllowDelay = true );
+                  char inAllowDelay = true,
+                  char inMoreComing = false );
+
+
+        
+        /**
+         * Sends several buffers through this socket, in order, as if they
+         * were one buffer (for example, a message header followed by its 
+         * payload), without copying them together first.
+         *
+         * Takes a single system call on platforms that support gathered
+         * sends, or one per group of IOV_MAX buffers for longer lists.
+         *
+         * @param inBuffers the buffers to send.
+         * @param inNumBytes the number of bytes in each buffer.
+         * @param inNumBuffers the number of buffers.
+         * @param inAllowedToBlock, inAllowDelay same as for send.
+         *
+         * @return the total number of bytes sent successfully,
+         *   or -1 for a socket error.
+         *   Returns -2 if not allowed to block and the operation
+         *   would block.
+         */
+        int sendGather( unsigned char **inBuffers, int *inNumBytes,
+                        int inNumBuffers,
+                        char inAllowedToBlock = true,
+                        char inAllowDelay = true );
+
+
+        
+        /**
+         * Puts this socket into non-blocking mode for the rest of its
+         * lifetime.
+         *
+         * Afterward, non-blocking sends and receives take a single
+         * system call, instead of switching the socket's mode around
+         * each call.  Operations that are allowed to block still block,
+         * by waiting for the socket to become ready.
+         *
+         * @return 0 on success, or -1 on failure or if not supported on
+         *   this platform (socket left in normal mode).
+         */
+        int setPersistentNonBlocking();
 		
 		
 		/**
@@ -283,8 +332,14 @@ class Socket {
         
         char mIsConnectionBroken;
         
+        char mPersistentNonBlocking;
+        
+        // last value passed to setNoDelay
+        int mNoDelay;
+        
 
         // toggle Nagle algorithm (inValue=1 turns it off)
+        // does nothing if already set to inValue
         void setNoDelay( int inValue );
         
         
@@ -293,7 +348,10 @@ class Socket {
 
 
 inline Socket::Socket()
-    : mConnected( true ), mIsConnectionBroken( false ) {
+    : mConnected( true ), mIsConnectionBroken( false ),
+      mPersistentNonBlocking( false ),
+      // Nagle algorithm on by default
+      mNoDelay( 0 ) {
 
     }
 
@@ -0,0 +1,791 @@
+#include "SocketIOEngine.h"
+
+#include <string.h>
+
+
+#ifdef __linux__
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+
+#endif
+
+
+
+SocketIORing::SocketIORing( int inSize )
+        : mBuffer( new unsigned char[ inSize ] ),
+          mSize( inSize ),
+          mHead( 0 ),
+          mTail( 0 ) {
+    }
+
+
+
+SocketIORing::~SocketIORing() {
+    delete [] mBuffer;
+    }
+
+
+
+int SocketIORing::getNumReadable() {
+    unsigned int tail = mTail;
+    // don't read data before seeing tail
+    __sync_synchronize();
+    return tail - mHead;
+    }
+
+
+
+int SocketIORing::getNumWritable() {
+    unsigned int head = mHead;
+    __sync_synchronize();
+    return mSize - ( mTail - head );
+    }
+
+
+
+int SocketIORing::getWriteRegions( unsigned char **outRegions,
+                                   int *outLengths ) {
+    int numFree = getNumWritable();
+
+    if( numFree == 0 ) {
+        return 0;
+        }
+
+    unsigned int start = mTail & ( mSize - 1 );
+
+    int firstLength = mSize - start;
+    if( firstLength > numFree ) {
+        firstLength = numFree;
+        }
+
+    outRegions[0] = &( mBuffer[ start ] );
+    outLengths[0] = firstLength;
+
+    if( firstLength == numFree ) {
+        return 1;
+        }
+
+    outRegions[1] = mBuffer;
+    outLengths[1] = numFree - firstLength;
+    return 2;
+    }
+
+
+
+void SocketIORing::commitWrite( int inNumBytes ) {
+    // data must be in place before consumer sees new tail
+    __sync_synchronize();
+    mTail = mTail + inNumBytes;
+    }
+
+
+
+int SocketIORing::getReadRegions( unsigned char **outRegions,
+                                  int *outLengths ) {
+    int numReadable = getNumReadable();
+
+    if( numReadable == 0 ) {
+        return 0;
+        }
+
+    unsigned int start = mHead & ( mSize - 1 );
+
+    int firstLength = mSize - start;
+    if( firstLength > numReadable ) {
+        firstLength = numReadable;
+        }
+
+    outRegions[0] = &( mBuffer[ start ] );
+    outLengths[0] = firstLength;
+
+    if( firstLength == numReadable ) {
+        return 1;
+        }
+
+    outRegions[1] = mBuffer;
+    outLengths[1] = numReadable - firstLength;
+    return 2;
+    }
+
+
+
+void SocketIORing::commitRead( int inNumBytes ) {
+    // done with data before producer sees new head
+    __sync_synchronize();
+    mHead = mHead + inNumBytes;
+    }
+
+
+
+int SocketIORing::write( unsigned char *inData, int inNumBytes ) {
+    unsigned char *regions[2];
+    int lengths[2];
+
+    int numRegions = getWriteRegions( regions, lengths );
+
+    int numCopied = 0;
+
+    for( int i=0; i<numRegions && numCopied < inNumBytes; i++ ) {
+        int length = inNumBytes - numCopied;
+        if( length > lengths[i] ) {
+            length = lengths[i];
+            }
+        memcpy( regions[i], &( inData[ numCopied ] ), length );
+        numCopied += length;
+        }
+
+    commitWrite( numCopied );
+    return numCopied;
+    }
+
+
+
+int SocketIORing::read( unsigned char *outData, int inNumBytes ) {
+    unsigned char *regions[2];
+    int lengths[2];
+
+    int numRegions = getReadRegions( regions, lengths );
+
+    int numCopied = 0;
+
+    for( int i=0; i<numRegions && numCopied < inNumBytes; i++ ) {
+        int length = inNumBytes - numCopied;
+        if( length > lengths[i] ) {
+            length = lengths[i];
+            }
+        memcpy( &( outData[ numCopied ] ), regions[i], length );
+        numCopied += length;
+        }
+
+    commitRead( numCopied );
+    return numCopied;
+    }
+
+
+
+
+#ifdef __linux__
+
+
+// most events handled per epoll_wait
+#define MAX_EVENTS 64
+
+
+
+SocketIOEngine::SocketIOEngine( int inRingSize )
+        : mRingSize( 1 ),
+          mWakePending( false ),
+          mStopping( false ) {
+
+    while( mRingSize < inRingSize ) {
+        mRingSize *= 2;
+        }
+
+    mEpollFD = epoll_create1( EPOLL_CLOEXEC );
+    mWakeFD = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    // NULL pointer marks wake events
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+
+    epoll_ctl( mEpollFD, EPOLL_CTL_ADD, mWakeFD, &event );
+
+    start();
+    }
+
+
+
+SocketIOEngine::~SocketIOEngine() {
+    mStopping = true;
+
+    uint64_t one = 1;
+    write( mWakeFD, &one, sizeof( one ) );
+
+    join();
+
+    // catch any adds or removes that thread did not see
+    processPending();
+
+    for( int i=0; i<mWatchedRecords.size(); i++ ) {
+        destroyRecord( mWatchedRecords.getElementDirect( i ) );
+        }
+
+    close( mWakeFD );
+    close( mEpollFD );
+    }
+
+
+
+char SocketIOEngine::isSupported() {
+    return true;
+    }
+
+
+
+int SocketIOEngine::addSocket( Socket *inSocket ) {
+
+    // sending is always immediate, like send with inAllowDelay false
+    int flag = 1;
+    setsockopt( inSocket->mNativeSocketID, IPPROTO_TCP, TCP_NODELAY,
+                &flag, sizeof( flag ) );
+
+    SocketIORecord *r = new SocketIORecord;
+
+    r->sock = inSocket;
+    r->receiveRing = new SocketIORing( mRingSize );
+    r->sendRing = new SocketIORing( mRingSize );
+    r->connected = false;
+    r->error = false;
+    r->receiveStalled = false;
+    r->sendPending = false;
+    r->resumePending = false;
+    r->removed = false;
+    r->watchedEvents = 0;
+
+    int id;
+
+    if( mFreeIDs.size() > 0 ) {
+        id = mFreeIDs.getElementDirect( mFreeIDs.size() - 1 );
+        mFreeIDs.deleteElement( mFreeIDs.size() - 1 );
+        *( mRecords.getElement( id ) ) = r;
+        }
+    else {
+        id = mRecords.size();
+        mRecords.push_back( r );
+        }
+
+    mLock.lock();
+    mAddedRecords.push_back( r );
+    mLock.unlock();
+
+    wake();
+
+    return id;
+    }
+
+
+
+void SocketIOEngine::removeSocket( int inID ) {
+    SocketIORecord *r = mRecords.getElementDirect( inID );
+
+    *( mRecords.getElement( inID ) ) = NULL;
+    mFreeIDs.push_back( inID );
+
+    r->removed = true;
+
+    mLock.lock();
+    mRemovedRecords.push_back( r );
+    mLock.unlock();
+
+    wake();
+    }
+
+
+
+int SocketIOEngine::send( int inID, unsigned char *inData, int inNumBytes ) {
+    SocketIORecord *r = mRecords.getElementDirect( inID );
+
+    if( r->error ) {
+        return -1;
+        }
+
+    int numQueued = r->sendRing->write( inData, inNumBytes );
+
+    // see sendPending only after data is in ring
+    __sync_synchronize();
+
+    if( numQueued > 0 && ! r->sendPending ) {
+        r->sendPending = true;
+        queuePending( r );
+        }
+
+    return numQueued;
+    }
+
+
+
+int SocketIOEngine::receive( int inID, unsigned char *outData,
+                             int inMaxBytes ) {
+    SocketIORecord *r = mRecords.getElementDirect( inID );
+
+    int numRead = r->receiveRing->read( outData, inMaxBytes );
+
+    if( numRead > 0 ) {
+        // see receiveStalled only after freeing space
+        __sync_synchronize();
+
+        if( r->receiveStalled && ! r->resumePending ) {
+            r->resumePending = true;
+            queuePending( r );
+            }
+        return numRead;
+        }
+
+    if( r->error ) {
+        // last data was received before error was set
+        __sync_synchronize();
+
+        numRead = r->receiveRing->read( outData, inMaxBytes );
+
+        if( numRead > 0 ) {
+            return numRead;
+            }
+        return -1;
+        }
+
+    return 0;
+    }
+
+
+
+int SocketIOEngine::isConnected( int inID ) {
+    SocketIORecord *r = mRecords.getElementDirect( inID );
+
+    if( r->error ) {
+        return -1;
+        }
+    if( r->connected ) {
+        return 1;
+        }
+    return 0;
+    }
+
+
+
+void SocketIOEngine::queuePending( SocketIORecord *inRecord ) {
+    mLock.lock();
+    mPendingRecords.push_back( inRecord );
+    mLock.unlock();
+
+    wake();
+    }
+
+
+
+void SocketIOEngine::wake() {
+    // only one wake in flight at a time, so queueing many sends costs
+    // at most one system call until the thread catches up
+    if( __sync_bool_compare_and_swap( &mWakePending, 0, 1 ) ) {
+        uint64_t one = 1;
+        write( mWakeFD, &one, sizeof( one ) );
+        }
+    }
+
+
+
+void SocketIOEngine::run() {
+
+    struct epoll_event events[ MAX_EVENTS ];
+
+    while( ! mStopping ) {
+
+        int numEvents = epoll_wait( mEpollFD, events, MAX_EVENTS, -1 );
+
+        if( numEvents < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+                }
+            return;
+            }
+
+        char woken = false;
+
+        for( int i=0; i<numEvents; i++ ) {
+            SocketIORecord *r = (SocketIORecord *)( events[i].data.ptr );
+
+            if( r == NULL ) {
+                woken = true;
+                }
+            else if( ! r->removed ) {
+                handleEvents( r, events[i].events );
+                }
+            }
+
+        // after the batch, because removed records are destroyed here,
+        // and later events in the batch may still point at them
+        if( woken ) {
+            uint64_t count;
+            read( mWakeFD, &count, sizeof( count ) );
+
+            // callers that queue after this point must wake us again
+            __sync_lock_release( &mWakePending );
+            __sync_synchronize();
+
+            processPending();
+            }
+        }
+    }
+
+
+
+void SocketIOEngine::processPending() {
+    SimpleVector<SocketIORecord*> added;
+    SimpleVector<SocketIORecord*> pending;
+    SimpleVector<SocketIORecord*> removed;
+
+    mLock.lock();
+    added.push_back_other( &mAddedRecords );
+    pending.push_back_other( &mPendingRecords );
+    removed.push_back_other( &mRemovedRecords );
+    mAddedRecords.deleteAll();
+    mPendingRecords.deleteAll();
+    mRemovedRecords.deleteAll();
+    mLock.unlock();
+
+    for( int i=0; i<added.size(); i++ ) {
+        SocketIORecord *r = added.getElementDirect( i );
+
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+
+        // writable once connected
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.ptr = r;
+
+        if( epoll_ctl( mEpollFD, EPOLL_CTL_ADD,
+                       r->sock->mNativeSocketID, &event ) == 0 ) {
+            r->watchedEvents = event.events;
+            }
+        else {
+            r->error = true;
+            }
+        mWatchedRecords.push_back( r );
+        }
+
+    for( int i=0; i<pending.size(); i++ ) {
+        SocketIORecord *r = pending.getElementDirect( i );
+
+        if( r->removed || r->error ) {
+            continue;
+            }
+
+        if( r->resumePending ) {
+            r->resumePending = false;
+            __sync_synchronize();
+            r->receiveStalled = false;
+            }
+
+        flushSocket( r );
+        updateWatchedEvents( r );
+        }
+
+    for( int i=0; i<removed.size(); i++ ) {
+        SocketIORecord *r = removed.getElementDirect( i );
+
+        if( r->watchedEvents != 0 ) {
+            epoll_ctl( mEpollFD, EPOLL_CTL_DEL, r->sock->mNativeSocketID,
+                       NULL );
+            }
+
+        mWatchedRecords.deleteElementEqualTo( r );
+        destroyRecord( r );
+        }
+    }
+
+
+
+void SocketIOEngine::handleEvents( SocketIORecord *inRecord,
+                                   unsigned int inEvents ) {
+
+    if( ! inRecord->connected ) {
+        int connected = inRecord->sock->isConnected();
+
+        if( connected == 1 ) {
+            inRecord->connected = true;
+            }
+        else if( connected == -1 ) {
+            inRecord->error = true;
+            updateWatchedEvents( inRecord );
+            return;
+            }
+        else {
+            return;
+            }
+        }
+
+    if( inEvents & ( EPOLLIN | EPOLLERR | EPOLLHUP ) ) {
+        readSocket( inRecord );
+        }
+
+    // try to flush even without EPOLLOUT, in case caller queued data
+    // before connection finished
+    flushSocket( inRecord );
+
+    updateWatchedEvents( inRecord );
+    }
+
+
+
+void SocketIOEngine::readSocket( SocketIORecord *inRecord ) {
+
+    if( inRecord->error || inRecord->receiveStalled ) {
+        return;
+        }
+
+    int sock = inRecord->sock->mNativeSocketID;
+    SocketIORing *ring = inRecord->receiveRing;
+
+    while( true ) {
+        unsigned char *regions[2];
+        int lengths[2];
+
+        int numRegions = ring->getWriteRegions( regions, lengths );
+
+        if( numRegions == 0 ) {
+            inRecord->receiveStalled = true;
+
+            // caller may have freed space before it could see stall
+            __sync_synchronize();
+
+            if( ring->getNumWritable() > 0 ) {
+                inRecord->receiveStalled = false;
+                continue;
+                }
+            return;
+            }
+
+        struct iovec vectors[2];
+        int totalLength = 0;
+        for( int i=0; i<numRegions; i++ ) {
+            vectors[i].iov_base = regions[i];
+            vectors[i].iov_len = lengths[i];
+            totalLength += lengths[i];
+            }
+
+        struct msghdr message;
+        memset( &message, 0, sizeof( message ) );
+        message.msg_iov = vectors;
+        message.msg_iovlen = numRegions;
+
+        int numRead = recvmsg( sock, &message, MSG_DONTWAIT );
+
+        if( numRead > 0 ) {
+            ring->commitWrite( numRead );
+
+            if( numRead < totalLength ) {
+                // drained
+                return;
+                }
+            }
+        else if( numRead == 0 ) {
+            // closed on remote end
+            inRecord->error = true;
+            return;
+            }
+        else if( errno == EINTR ) {
+            continue;
+            }
+        else {
+            if( errno != EAGAIN && errno != EWOULDBLOCK ) {
+                inRecord->error = true;
+                }
+            return;
+            }
+        }
+    }
+
+
+
+void SocketIOEngine::flushSocket( SocketIORecord *inRecord ) {
+
+    if( inRecord->error || ! inRecord->connected ) {
+        return;
+        }
+
+    int sock = inRecord->sock->mNativeSocketID;
+    SocketIORing *ring = inRecord->sendRing;
+
+    while( true ) {
+        unsigned char *regions[2];
+        int lengths[2];
+
+        int numRegions = ring->getReadRegions( regions, lengths );
+
+        if( numRegions == 0 ) {
+            inRecord->sendPending = false;
+
+            // caller may have queued more before it could see that
+            // sendPending was cleared
+            __sync_synchronize();
+
+            if( ring->getNumReadable() > 0 ) {
+                inRecord->sendPending = true;
+                continue;
+                }
+            return;
+            }
+
+        struct iovec vectors[2];
+        int totalLength = 0;
+        for( int i=0; i<numRegions; i++ ) {
+            vectors[i].iov_base = regions[i];
+            vectors[i].iov_len = lengths[i];
+            totalLength += lengths[i];
+            }
+
+        struct msghdr message;
+        memset( &message, 0, sizeof( message ) );
+        message.msg_iov = vectors;
+        message.msg_iovlen = numRegions;
+
+        int numSent = sendmsg( sock, &message, MSG_DONTWAIT | MSG_NOSIGNAL );
+
+        if( numSent > 0 ) {
+            ring->commitRead( numSent );
+
+            if( numSent < totalLength ) {
+                // socket buffer full, wait for EPOLLOUT
+                return;
+                }
+            }
+        else if( numSent < 0 && errno == EINTR ) {
+            continue;
+            }
+        else {
+            if( numSent < 0 && errno != EAGAIN && errno != EWOULDBLOCK ) {
+                inRecord->error = true;
+                }
+            return;
+            }
+        }
+    }
+
+
+
+void SocketIOEngine::updateWatchedEvents( SocketIORecord *inRecord ) {
+    unsigned int events = 0;
+
+    if( ! inRecord->error ) {
+        if( ! inRecord->connected ) {
+            events = EPOLLIN | EPOLLOUT;
+            }
+        else {
+            if( ! inRecord->receiveStalled ) {
+                events |= EPOLLIN;
+                }
+            if( inRecord->sendRing->getNumReadable() > 0 ) {
+                events |= EPOLLOUT;
+                }
+            }
+        }
+
+    if( events == inRecord->watchedEvents ) {
+        return;
+        }
+
+    int sock = inRecord->sock->mNativeSocketID;
+
+    // epoll always reports hangups and errors, even with no events
+    // watched, so take socket out completely instead of spinning on them
+    if( events == 0 ) {
+        epoll_ctl( mEpollFD, EPOLL_CTL_DEL, sock, NULL );
+        inRecord->watchedEvents = 0;
+        return;
+        }
+
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = events;
+    event.data.ptr = inRecord;
+
+    int operation = EPOLL_CTL_MOD;
+    if( inRecord->watchedEvents == 0 ) {
+        operation = EPOLL_CTL_ADD;
+        }
+
+    epoll_ctl( mEpollFD, operation, sock, &event );
+
+    inRecord->watchedEvents = events;
+    }
+
+
+
+void SocketIOEngine::destroyRecord( SocketIORecord *inRecord ) {
+    delete inRecord->sock;
+    delete inRecord->receiveRing;
+    delete inRecord->sendRing;
+    delete inRecord;
+    }
+
+
+
+#else
+
+// no epoll, callers use sockets directly
+
+
+SocketIOEngine::SocketIOEngine( int inRingSize )
+        : mRingSize( inRingSize ),
+          mEpollFD( -1 ),
+          mWakeFD( -1 ),
+          mWakePending( false ),
+          mStopping( false ) {
+    }
+
+SocketIOEngine::~SocketIOEngine() {
+    }
+
+char SocketIOEngine::isSupported() {
+    return false;
+    }
+
+int SocketIOEngine::addSocket( Socket *inSocket ) {
+    return -1;
+    }
+
+void SocketIOEngine::removeSocket( int inID ) {
+    }
+
+int SocketIOEngine::send( int inID, unsigned char *inData, int inNumBytes ) {
+    return -1;
+    }
+
+int SocketIOEngine::receive( int inID, unsigned char *outData,
+                             int inMaxBytes ) {
+    return -1;
+    }
+
+int SocketIOEngine::isConnected( int inID ) {
+    return -1;
+    }
+
+void SocketIOEngine::run() {
+    }
+
+void SocketIOEngine::queuePending( SocketIORecord *inRecord ) {
+    }
+
+void SocketIOEngine::wake() {
+    }
+
+void SocketIOEngine::processPending() {
+    }
+
+void SocketIOEngine::handleEvents( SocketIORecord *inRecord,
+                                   unsigned int inEvents ) {
+    }
+
+void SocketIOEngine::readSocket( SocketIORecord *inRecord ) {
+    }
+
+void SocketIOEngine::flushSocket( SocketIORecord *inRecord ) {
+    }
+
+void SocketIOEngine::updateWatchedEvents( SocketIORecord *inRecord ) {
+    }
+
+void SocketIOEngine::destroyRecord( SocketIORecord *inRecord ) {
+    }
+
+#endif
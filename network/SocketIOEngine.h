@@ -0,0 +1,236 @@
+#ifndef SOCKET_IO_ENGINE_INCLUDED
+#define SOCKET_IO_ENGINE_INCLUDED
+
+
+#include "minorGems/network/Socket.h"
+
+#include "minorGems/system/Thread.h"
+#include "minorGems/system/MutexLock.h"
+
+#include "minorGems/util/SimpleVector.h"
+
+
+
+// Byte ring with one producer thread and one consumer thread, and no locks.
+//
+// Head and tail are running byte counts, so they can wrap around freely.
+class SocketIORing {
+
+    public:
+
+        // inSize must be a power of 2
+        SocketIORing( int inSize );
+
+        ~SocketIORing();
+
+
+        // called by consumer
+        int getNumReadable();
+
+        // called by producer
+        int getNumWritable();
+
+
+        // copies in up to inNumBytes, returns number copied
+        // called by producer
+        int write( unsigned char *inData, int inNumBytes );
+
+        // copies out up to inNumBytes, returns number copied
+        // called by consumer
+        int read( unsigned char *outData, int inNumBytes );
+
+
+        // gets up to two regions that can be filled directly (the second
+        // is used when the free space wraps around), returns number of
+        // regions
+        // called by producer, followed by commitWrite
+        int getWriteRegions( unsigned char **outRegions, int *outLengths );
+
+        void commitWrite( int inNumBytes );
+
+
+        // gets up to two regions that can be read directly, returns
+        // number of regions
+        // called by consumer, followed by commitRead
+        int getReadRegions( unsigned char **outRegions, int *outLengths );
+
+        void commitRead( int inNumBytes );
+
+
+    protected:
+
+        unsigned char *mBuffer;
+        unsigned int mSize;
+
+        // bytes read so far, written only by consumer
+        volatile unsigned int mHead;
+
+        // bytes written so far, written only by producer
+        volatile unsigned int mTail;
+    };
+
+
+
+typedef struct SocketIORecord {
+        Socket *sock;
+
+        // filled by I/O thread, drained by caller
+        SocketIORing *receiveRing;
+
+        // filled by caller, drained by I/O thread
+        SocketIORing *sendRing;
+
+        // set by I/O thread
+        volatile char connected;
+        volatile char error;
+
+        // set by I/O thread when receiveRing is full and it has stopped
+        // reading
+        volatile char receiveStalled;
+
+        // set by caller when record is queued for I/O thread to flush
+        // sendRing, cleared by I/O thread once sendRing is empty
+        volatile char sendPending;
+
+        // set by caller when record is queued for I/O thread to resume
+        // reading
+        volatile char resumePending;
+
+        // set by caller before queueing record for removal
+        volatile char removed;
+
+        // used by I/O thread only
+        unsigned int watchedEvents;
+    } SocketIORecord;
+
+
+
+// Background thread that moves data between sockets and per-socket ring
+// buffers, so that callers polling many non-blocking sockets every frame
+// only copy memory.
+//
+// Uses epoll, and an eventfd to wake the thread when sends are queued.
+// Not supported on other platforms (see isSupported), where callers should
+// use their sockets directly.
+//
+// All calls other than the constructor and destructor must come from
+// the same thread.
+class SocketIOEngine : public Thread {
+
+    public:
+
+        /**
+         * Constructs and starts an engine.
+         *
+         * @param inRingSize size of each socket's send and receive rings,
+         *   in bytes.  Rounded up to a power of 2.
+         */
+        SocketIOEngine( int inRingSize = 65536 );
+
+
+        // stops thread and destroys all remaining sockets
+        ~SocketIOEngine();
+
+
+        /**
+         * Returns true if the engine can run on this platform.
+         */
+        static char isSupported();
+
+
+        /**
+         * Hands a socket to the engine.
+         *
+         * @param inSocket a non-blocking socket, connected or still
+         *   connecting.  Destroyed by this engine.
+         *
+         * @return an id for this socket, or -1 on failure.
+         *   Ids of removed sockets are reused.
+         */
+        int addSocket( Socket *inSocket );
+
+
+        /**
+         * Removes a socket from the engine and destroys it.  Unsent data
+         * is dropped.
+         */
+        void removeSocket( int inID );
+
+
+        /**
+         * Queues bytes to send.
+         *
+         * @return number of bytes queued (maybe 0 if send ring is full),
+         *   or -1 on error.
+         */
+        int send( int inID, unsigned char *inData, int inNumBytes );
+
+
+        /**
+         * Copies out received bytes.
+         *
+         * @return number of bytes copied (maybe 0), or -1 if the
+         *   connection has failed or closed and no bytes remain.
+         */
+        int receive( int inID, unsigned char *outData, int inMaxBytes );
+
+
+        /**
+         * Returns 1 if connected, 0 if still connecting, -1 on error.
+         */
+        int isConnected( int inID );
+
+
+        // implements Thread
+        void run();
+
+
+    protected:
+
+        // queues record for I/O thread attention and wakes thread
+        void queuePending( SocketIORecord *inRecord );
+
+        void wake();
+
+
+        // called by I/O thread
+        void processPending();
+        void handleEvents( SocketIORecord *inRecord, unsigned int inEvents );
+        void readSocket( SocketIORecord *inRecord );
+        void flushSocket( SocketIORecord *inRecord );
+        void updateWatchedEvents( SocketIORecord *inRecord );
+        void destroyRecord( SocketIORecord *inRecord );
+
+
+        int mRingSize;
+
+        int mEpollFD;
+        int mWakeFD;
+
+        // set while a wake is already on its way
+        volatile int mWakePending;
+
+        volatile char mStopping;
+
+
+        // indexed by id, NULL for free ids
+        // used by caller thread only
+        SimpleVector<SocketIORecord*> mRecords;
+        SimpleVector<int> mFreeIDs;
+
+
+        // protects lists below
+        MutexLock mLock;
+
+        SimpleVector<SocketIORecord*> mAddedRecords;
+        SimpleVector<SocketIORecord*> mPendingRecords;
+        SimpleVector<SocketIORecord*> mRemovedRecords;
+
+
+        // records being watched, used by I/O thread only
+        SimpleVector<SocketIORecord*> mWatchedRecords;
+    };
+
+
+
+#endif
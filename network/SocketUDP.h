@@ -30,6 +30,44 @@ struct UDPAddress {
 
 
 
+/**
+ * One datagram in a batch send or receive.
+ *
+ * Data buffers are owned by the caller, and the address is stored inline,
+ * so batches can be reused without any allocation.
+ */
+struct UDPDatagram {
+        // destination for sends, source for receives
+        struct UDPAddress mAddress;
+
+        // caller-owned buffer
+        unsigned char *mData;
+
+        // for receives, the size of mData
+        // ignored for sends
+        int mBufferSize;
+
+        // for sends, the number of bytes to send from mData
+        // for receives, set to the number of bytes received
+        int mNumBytes;
+
+        // for sends, if greater than 0 and less than mNumBytes, mData is
+        // sent as a run of datagrams of this size (the last may be
+        // shorter), using segmentation offload where the kernel supports
+        // it
+        // for receives, set to the size of the coalesced datagrams in
+        // mData if receive coalescing is on, or 0 if mData holds a single
+        // datagram
+        int mSegmentSize;
+
+        // for receives, set to true if datagram was larger than
+        // mBufferSize and was cut off
+        char mTruncated;
+    };
+
+
+
+
 /**
  * Network socket that can be used as an endpoint for sending and receiving
  * UDP packets (unreliable datagrams).
@@ -161,6 +199,62 @@ class SocketUDP {
 
         
         
+        /**
+         * Sends a batch of datagrams through this socket, using as few
+         * system calls as possible (sendmmsg on Linux).
+         *
+         * @param inDatagrams the datagrams to send.  Destroyed by caller.
+         * @param inNumDatagrams the number of datagrams in the batch.
+         *
+         * @return the number of datagrams (batch entries) sent
+         *   successfully, or -1 for a socket error before anything was
+         *   sent.
+         */
+        int sendBatch( struct UDPDatagram *inDatagrams, int inNumDatagrams );
+
+
+        /**
+         * Receives a batch of datagrams from this socket into
+         * caller-provided buffers, using as few system calls as possible
+         * (recvmmsg on Linux).
+         *
+         * Waits for the first datagram, then returns it along with any
+         * others that are already waiting, up to inMaxDatagrams.
+         *
+         * @param inDatagrams the datagrams to fill.  mData and mBufferSize
+         *   must be set for each.  Destroyed by caller.
+         * @param inMaxDatagrams the number of datagrams in the batch.
+         * @param inTimeout the timeout for the first datagram in
+         *   milliseconds.  Set to -1 for an infinite timeout.
+         *   Defaults to -1.
+         *
+         * @return the number of datagrams received, -1 for a socket error,
+         *   or -2 for a timeout.
+         */
+        int receiveBatch( struct UDPDatagram *inDatagrams, 
+                          int inMaxDatagrams,
+                          long inTimeout = -1 );
+
+
+        /**
+         * Turns receive coalescing (UDP GRO) on or off.
+         *
+         * When on, a run of same-sized datagrams from one sender can
+         * arrive in a single receiveBatch entry, with mSegmentSize set.
+         * Buffers should be at least 65535 bytes to hold a full run.
+         *
+         * While on, receive can also return a coalesced run without any
+         * way to split it, so use receiveBatch instead.
+         *
+         * @param inOn true to turn coalescing on.
+         *
+         * @return true if the setting was applied, or false if it is not
+         *   supported on this platform.
+         */
+        char setReceiveCoalescing( char inOn );
+
+        
+        
         /**
          * Used by platform-specific implementations.
          */        
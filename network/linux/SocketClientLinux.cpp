@@ -65,6 +65,7 @@
 
 #include "minorGems/network/SocketClient.h"
 #include "minorGems/network/NetworkFunctionLocks.h"
+#include "minorGems/network/linux/waitForSocket.h"
 #include "minorGems/system/MutexLock.h"
 
 
@@ -78,6 +79,7 @@
 
 #include <fcntl.h>
 #include <sys/time.h>
+#include <poll.h>
 
 #include <unistd.h>
 #include <errno.h>
@@ -284,8 +286,6 @@ int timed_connect( int inSocketID,
                    int inAddressLength,
                    int inTimeoutInMilliseconds ) {
 	int ret;
-	fd_set fsr;
-	struct timeval tv;
 	int val;
     socklen_t len;
     
@@ -318,16 +318,8 @@ int timed_connect( int inSocketID,
 //	}
 	
 
-	FD_ZERO( &fsr );
-	FD_SET( inSocketID, &fsr );
-
-    tv.tv_sec = inTimeoutInMilliseconds / 1000;
-	int remainder = inTimeoutInMilliseconds % 1000;
-	tv.tv_usec = remainder * 1000;
-    
-
-	ret = select( inSocketID+1, NULL, &fsr, NULL, &tv );
-	//g_debug(5,"select returned %i\n",ret);
+	ret = waitForSocket( inSocketID, POLLOUT, inTimeoutInMilliseconds );
+	//g_debug(5,"poll returned %i\n",ret);
 
 	if( ret==0 ) {
 		// timeout
@@ -336,6 +328,10 @@ int timed_connect( int inSocketID,
 		return -2;
         }
 
+	if( ret < 0 ) {
+		return ret;
+        }
+
 	len = 4;
 	ret = getsockopt( inSocketID, SOL_SOCKET, SO_ERROR, &val, &len );
 	//g_debug(5,"getsockopt returned %i val=%i\n",ret,val);
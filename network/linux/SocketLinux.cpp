@@ -89,11 +89,14 @@
 
 #include "minorGems/network/Socket.h"
 #include "minorGems/network/NetworkFunctionLocks.h"
+#include "minorGems/network/linux/waitForSocket.h"
 
 #include <sys/time.h>
+#include <time.h>
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/errno.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -107,6 +110,19 @@
 #include <unistd.h>
 #include <signal.h>
 #include <errno.h>
+#include <poll.h>
+#include <limits.h>
+
+
+// sendmsg takes at most this many vectors at once
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+
+// sendGather builds this many vectors on the stack, enough for the usual
+// header and payload, and only allocates for longer lists
+#define SEND_GATHER_STACK_VECTORS 16
 
 
 
@@ -175,20 +191,17 @@ int Socket::isConnected() {
     
 
     int ret;
-	fd_set fsr;
-	struct timeval tv;
+	struct pollfd p;
 	int val;
     socklen_t len;
 
-	FD_ZERO( &fsr );
-	FD_SET( mNativeSocketID, &fsr );
+	p.fd = mNativeSocketID;
+	p.events = POLLOUT;
+	p.revents = 0;
 
     // check if connection event waiting right now
     // timeout of 0
-    tv.tv_sec = 0;
-	tv.tv_usec = 0;    
-
-	ret = select( mNativeSocketID + 1, NULL, &fsr, NULL, &tv );
+	ret = poll( &p, 1, 0 );
 
 	if( ret==0 ) {
 		// timeout
@@ -221,35 +234,142 @@ int Socket::isConnected() {
 
 void Socket::setNoDelay( int inValue ) {
 	
+    // Nagle state is left as it was after each send, and only changed
+    // when the next send needs something different
+    if( mNoDelay == inValue ) {
+        return;
+        }
+    
     int flag = inValue;
     setsockopt( mNativeSocketID,
                 IPPROTO_TCP,
                 TCP_NODELAY,
                 (char *) &flag,
                 sizeof(int) ); 
+
+    mNoDelay = inValue;
+    }
+
+
+
+int Socket::setPersistentNonBlocking() {
+    if( mPersistentNonBlocking ) {
+        return 0;
+        }
+    
+    int flags = fcntl( mNativeSocketID, F_GETFL, 0 );
+    
+    if( flags < 0 ) {
+        return -1;
+        }
+    
+    if( fcntl( mNativeSocketID, F_SETFL, flags | O_NONBLOCK ) < 0 ) {
+        return -1;
+        }
+    
+    mPersistentNonBlocking = true;
+    return 0;
+    }
+
+
+
+// sends all of inVectors, waiting for socket to become writable if needed
+// inVectors is modified
+// returns total sent or -1 on error
+static int sendAllVectors( int inSock, struct iovec *inVectors, 
+                           int inNumVectors, int inFlags ) {
+    int totalSent = 0;
+    
+    struct msghdr message;
+    memset( &message, 0, sizeof( message ) );
+    
+    message.msg_iov = inVectors;
+    message.msg_iovlen = inNumVectors;
+    
+    while( message.msg_iovlen > 0 ) {
+        
+        int numSent = sendmsg( inSock, &message, inFlags );
+        
+        if( numSent < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+                }
+            if( errno == EAGAIN || errno == EWOULDBLOCK ) {
+                // persistent non-blocking socket that is full
+                if( waitForSocket( inSock, POLLOUT ) != 1 ) {
+                    return -1;
+                    }
+                continue;
+                }
+            return -1;
+            }
+        
+        totalSent += numSent;
+        
+        // skip what was sent
+        while( message.msg_iovlen > 0 &&
+               (unsigned int)numSent >= message.msg_iov[0].iov_len ) {
+            numSent -= message.msg_iov[0].iov_len;
+            message.msg_iov ++;
+            message.msg_iovlen --;
+            }
+        if( message.msg_iovlen > 0 ) {
+            message.msg_iov[0].iov_base = 
+                (char *)( message.msg_iov[0].iov_base ) + numSent;
+            message.msg_iov[0].iov_len -= numSent;
+            }
+        }
+    
+    return totalSent;
     }
 
 
 
 int Socket::send( unsigned char *inBuffer, int inNumBytes,
                   char inAllowedToBlock,
-                  char inAllowDelay ) {
+                  char inAllowDelay,
+                  char inMoreComing ) {
     
+    if( ! inAllowDelay ) {
+        // turn nodelay on
+        setNoDelay( 1 );
+        }
+    else {
+        setNoDelay( 0 );
+        }
+    
+    int flags = 0;
+    
+    #ifdef MSG_MORE
+    if( inMoreComing && inAllowDelay ) {
+        flags |= MSG_MORE;
+        }
+    #endif
 
-    if( inAllowedToBlock ) {
-        if( ! inAllowDelay ) {
-            // turn nodelay on
-            setNoDelay( 1 );
-            }
+
+    if( mPersistentNonBlocking ) {
+        
+        if( inAllowedToBlock ) {
+            struct iovec vector;
+            vector.iov_base = inBuffer;
+            vector.iov_len = inNumBytes;
             
-        int returnVal = ::send( mNativeSocketID, inBuffer, inNumBytes, 0 );
+            return sendAllVectors( mNativeSocketID, &vector, 1, flags );
+            }
+        
+        int returnValue = ::send( mNativeSocketID, inBuffer, inNumBytes,
+                                  flags | MSG_DONTWAIT );
         
-        if( ! inAllowDelay ) {
-            // turn nodelay back off
-            setNoDelay( 0 );
+        if( returnValue == -1 && 
+            ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+            return -2;
             }
+        return returnValue;
+        }
+    
 
-        return returnVal;
+    if( inAllowedToBlock ) {
+        return ::send( mNativeSocketID, inBuffer, inNumBytes, flags );
         }
     else {
 
@@ -260,23 +380,11 @@ int Socket::send( unsigned char *inBuffer, int inNumBytes,
             return result;
             }
         
-        if( ! inAllowDelay ) {
-            // turn nodelay on
-            setNoDelay( 1 );
-            }
-
 
         int returnValue = ::send( mNativeSocketID, inBuffer, inNumBytes,
-                                  // no flags
-                                  0 );
+                                  flags );
         
         
-        if( ! inAllowDelay ) {
-            // turn nodelay back off
-            setNoDelay( 0 );
-            }
-
-
         // back into blocking mode
         result = fcntl( mNativeSocketID, F_SETFL, 0 );
 
@@ -293,12 +401,130 @@ int Socket::send( unsigned char *inBuffer, int inNumBytes,
             }
         }
     }
+
+
+
+int Socket::sendGather( unsigned char **inBuffers, int *inNumBytes,
+                        int inNumBuffers,
+                        char inAllowedToBlock,
+                        char inAllowDelay ) {
+    
+    if( ! inAllowDelay ) {
+        setNoDelay( 1 );
+        }
+    else {
+        setNoDelay( 0 );
+        }
+
+    struct iovec stackVectors[ SEND_GATHER_STACK_VECTORS ];
+    struct iovec *vectors = stackVectors;
+    
+    // longer lists go out in groups of up to IOV_MAX buffers
+    int groupSize = inNumBuffers;
+    
+    if( groupSize > SEND_GATHER_STACK_VECTORS ) {
+        if( groupSize > IOV_MAX ) {
+            groupSize = IOV_MAX;
+            }
+        vectors = new struct iovec[ groupSize ];
+        }
+    
+    int totalSent = 0;
+    int returnValue = 0;
+    
+    for( int start=0; start<inNumBuffers; start += groupSize ) {
+        int numVectors = inNumBuffers - start;
+        if( numVectors > groupSize ) {
+            numVectors = groupSize;
+            }
+        
+        int groupBytes = 0;
+        for( int i=0; i<numVectors; i++ ) {
+            vectors[i].iov_base = inBuffers[ start + i ];
+            vectors[i].iov_len = inNumBytes[ start + i ];
+            groupBytes += inNumBytes[ start + i ];
+            }
+        
+        int numSent;
+        
+        if( inAllowedToBlock ) {
+            numSent = sendAllVectors( mNativeSocketID, 
+                                      vectors, numVectors, 0 );
+            }
+        else {
+            struct msghdr message;
+            memset( &message, 0, sizeof( message ) );
+            
+            message.msg_iov = vectors;
+            message.msg_iovlen = numVectors;
+            
+            numSent = sendmsg( mNativeSocketID, &message, MSG_DONTWAIT );
+            
+            if( numSent == -1 && 
+                ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+                numSent = -2;
+                }
+            }
+        
+        if( numSent < 0 ) {
+            // report what earlier groups sent, if anything
+            if( totalSent == 0 ) {
+                returnValue = numSent;
+                }
+            break;
+            }
+        
+        totalSent += numSent;
+        
+        if( numSent < groupBytes ) {
+            // socket is full
+            break;
+            }
+        }
+    
+    if( vectors != stackVectors ) {
+        delete [] vectors;
+        }
+    
+    if( returnValue < 0 ) {
+        return returnValue;
+        }
+    return totalSent;
+    }
 		
 		
 int Socket::receive( unsigned char *inBuffer, int inNumBytes,
 	long inTimeout ) {
 	
 	if( inTimeout == -1 ) {
+        
+        if( mPersistentNonBlocking ) {
+            // MSG_WAITALL does not wait on a non-blocking socket
+            int numReceived = 0;
+            
+            while( numReceived < inNumBytes ) {
+                int ret = recv( mNativeSocketID, &( inBuffer[ numReceived ] ),
+                                inNumBytes - numReceived, MSG_WAITALL );
+                
+                if( ret == 0 ) {
+                    // closed
+                    return numReceived;
+                    }
+                else if( ret > 0 ) {
+                    numReceived += ret;
+                    }
+                else if( errno == EAGAIN || errno == EWOULDBLOCK ) {
+                    if( waitForSocket( mNativeSocketID, POLLIN ) != 1 ) {
+                        return -1;
+                        }
+                    }
+                else if( errno != EINTR ) {
+                    return -1;
+                    }
+                }
+            return numReceived;
+            }
+        
         // use MSG_WAITALL flag here to block until inNumBytes has arrived
 		return recv( mNativeSocketID, inBuffer, inNumBytes, MSG_WAITALL );
 		}
@@ -382,10 +608,8 @@ HostAddress *Socket::getLocalHostAddress() {
 
 
 char Socket::isSocketInFDRange() {
-    if( mNativeSocketID >= FD_SETSIZE || mNativeSocketID < 0 ) {
-        return false;
-        }
-    return true;
+    // all waits use poll, which has no descriptor limit
+    return ( mNativeSocketID >= 0 );
     }
 
 
@@ -398,53 +622,21 @@ char Socket::isSocketInFDRange() {
 // if no data was read before the timeout occurred...
 int timed_read( int inSock, unsigned char *inBuf, 
 	int inLen, long inMilliseconds ) {
-	fd_set fsr;
-	struct timeval tv;
 	int ret;
 
-    // only need to do select stuff, which consumes substantial resources
-    // if we need a non-zero timeout
+    // only need to wait if we need a non-zero timeout
+    // (MSG_DONTWAIT below handles the 0-timeout case)
     if( inMilliseconds > 0 ) {
         
-	
-        //ret = fcntl( inSock, F_SETFL, O_NONBLOCK );
-	
-        if( inSock >= FD_SETSIZE || inSock < 0 ) {
-            printf( "Socket ID %d out of range (FD_SETSIZE=%d) in timed_read, "
-                    "treating it like a socket error.\n",
-                    inSock, FD_SETSIZE );
-            return -1;
-            }
-    
-
-        FD_ZERO( &fsr );
-        FD_SET( inSock, &fsr );
-        
-        tv.tv_sec = inMilliseconds / 1000;
-        int remainder = inMilliseconds % 1000;
-        tv.tv_usec = remainder * 1000;
+        ret = waitForSocket( inSock, POLLIN, inMilliseconds );
         
-        ret = select( inSock + 1, &fsr, NULL, NULL, &tv );
-        
-        if( ret==0 ) {
-            // printf( "Timed out waiting for data on socket receive.\n" );
-            return -2;
-            }
-	
-        while( ret<0 && errno == EINTR ) {
-            // interrupted
-            // try again
-            ret = select( inSock + 1, &fsr, NULL, NULL, &tv );
-            }
-
         if( ret == 0 ) {
-            // time out after at least one EINTR
+            // printf( "Timed out waiting for data on socket receive.\n" );
             return -2;
             }
-    
-
-        if( ret<0 ) {
-            perror( "Selecting socket during receive failed" );
+        
+        if( ret < 0 ) {
+            perror( "Polling socket during receive failed" );
             return ret;
             }
         }
@@ -457,7 +649,7 @@ int timed_read( int inSock, unsigned char *inBuf,
 	
 
     if( ret == 0  ) {
-        // select came back as 1 (or MSG_DONTWAIT specified, if we
+        // poll came back ready (or MSG_DONTWAIT specified, if we
         // have 0-timeout) but no data there
         // connection closed on remote end
         return -1;
@@ -465,7 +657,7 @@ int timed_read( int inSock, unsigned char *inBuf,
     
     if( ret == -1 && 
         ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) ) {
-        // select came back 1, but then our recv operation was interrupted
+        // poll came back ready, but then our recv operation was interrupted
         // or would block
         
         // treat like a timeout
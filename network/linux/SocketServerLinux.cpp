@@ -52,6 +52,7 @@
 
 
 #include "minorGems/network/SocketServer.h"
+#include "minorGems/network/linux/waitForSocket.h"
 
 #include <string.h>
 #include <sys/types.h>
@@ -74,10 +75,8 @@ typedef int socklen_t;
 #endif
 #endif
 
-#ifndef BSD
-// poll not available on BSD
-#include <sys/poll.h>
-#endif
+#include <poll.h>
+#include <errno.h>
 
 
 /**
@@ -180,24 +179,13 @@ Socket *SocketServer::acceptConnection( long inTimeoutInMilliseconds,
 
     
     if( inTimeoutInMilliseconds != -1 ) {
-        // if we have a timeout specified, select before accepting
-
-        // this found in the Linux man page for select,
-        // but idea (which originally used poll) was found
-        // in the Unix Socket FAQ
-        fd_set rfds;
-        struct timeval tv;
-        int retval;
-        
-        // insert our socket descriptor into this set
-        FD_ZERO( &rfds );
-        FD_SET( socketID, &rfds );
+        // if we have a timeout specified, poll before accepting
+        // (poll works for any descriptor number, unlike select)
 
-        // convert our timeout into the structure's format
-        tv.tv_sec = inTimeoutInMilliseconds / 1000;
-        tv.tv_usec = ( inTimeoutInMilliseconds % 1000 ) * 1000 ;
+        // idea found in the Unix Socket FAQ
+        int retval = waitForSocket( socketID, POLLIN, 
+                                    inTimeoutInMilliseconds );
         
-        retval = select( socketID + 1, &rfds, NULL, NULL, &tv );
         if( retval == 0 ) {
             // timeout
             if( outTimedOut != NULL ) {
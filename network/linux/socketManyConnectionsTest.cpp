@@ -0,0 +1,308 @@
+// Stress test for timed socket waits on descriptors beyond FD_SETSIZE.
+//
+// Opens many loopback connections (20000 by default) so that most sockets
+// have descriptor numbers far above 1023, then checks that connect,
+// accept, receive, and flush timeouts still behave, and measures
+// round-trip message throughput across all connections.
+//
+// Client sockets live in this process, and accepted sockets live in a
+// forked server process, so each side needs one descriptor per
+// connection.  The connection count is reduced if the open file limit
+// does not allow it.
+//
+// Usage:  socketManyConnectionsTest [port numConnections numRounds]
+//
+// Exits with non-zero status on failure.
+
+
+#include "minorGems/network/SocketServer.h"
+#include "minorGems/network/SocketClient.h"
+#include "minorGems/network/Socket.h"
+#include "minorGems/network/HostAddress.h"
+
+#include "minorGems/system/Time.h"
+
+#include "minorGems/util/stringUtils.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <sys/resource.h>
+
+
+
+static int port = 5890;
+static int numConnections = 20000;
+static int numRounds = 5;
+
+
+// timeouts must fire within this window to count as correct
+#define SHORT_TIMEOUT 200
+#define MAX_TIMEOUT_OVERSHOOT 800
+
+
+
+static char checkTimeout( const char *inName, double inStartTime,
+                          int inExpectedMS ) {
+    double elapsedMS = ( Time::getCurrentTime() - inStartTime ) * 1000;
+
+    // allow a little slack below for clock granularity
+    char ok = ( elapsedMS >= inExpectedMS - 5 &&
+                elapsedMS <= inExpectedMS + MAX_TIMEOUT_OVERSHOOT );
+
+    printf( "%-36s %s (%.0f ms, expected %d ms)\n",
+            inName, ok ? "ok    " : "FAILED", elapsedMS, inExpectedMS );
+    return ok;
+    }
+
+
+
+// returns false on error or timeout
+static char receiveFully( Socket *inSocket, unsigned char *inBuffer,
+                          int inNumBytes ) {
+    int numReceived = 0;
+    while( numReceived < inNumBytes ) {
+        int numRead = inSocket->receive( inBuffer + numReceived,
+                                         inNumBytes - numReceived, 5000 );
+        if( numRead < 0 ) {
+            return false;
+            }
+        numReceived += numRead;
+        }
+    return true;
+    }
+
+
+
+// runs in forked process
+// returns exit status
+static int runServer( SocketServer *inServer ) {
+    Socket **sockets = new Socket*[ numConnections + 1 ];
+
+    char ok = true;
+
+    // one extra for the non-blocking connect
+    for( int i=0; i<numConnections + 1; i++ ) {
+        char timedOut;
+        sockets[i] = inServer->acceptConnection( 5000, &timedOut );
+
+        if( sockets[i] == NULL ) {
+            printf( "Server failed to accept connection %d\n", i );
+            return 1;
+            }
+        }
+
+    printf( "Server accepted %d connections, highest socket is in "
+            "FD_SET range:  %s\n", numConnections + 1,
+            sockets[ numConnections ]->isSocketInFDRange() ? "yes" : "no" );
+
+
+    char timedOut;
+    double startTime = Time::getCurrentTime();
+    Socket *extra = inServer->acceptConnection( SHORT_TIMEOUT, &timedOut );
+
+    if( extra != NULL || ! timedOut ) {
+        printf( "Accept with no pending connection did not time out\n" );
+        ok = false;
+        }
+    ok &= checkTimeout( "accept timeout", startTime, SHORT_TIMEOUT );
+
+
+    // client keeps this connection open without sending anything,
+    // so flush should wait for the full time
+    startTime = Time::getCurrentTime();
+    sockets[ numConnections ]->sendFlushBeforeClose( SHORT_TIMEOUT );
+    ok &= checkTimeout( "flush-before-close timeout, high fd", startTime,
+                        SHORT_TIMEOUT );
+
+
+    // echo every message
+    unsigned char message[4];
+
+    for( int r=0; r<numRounds && ok; r++ ) {
+        for( int i=0; i<numConnections; i++ ) {
+            if( ! receiveFully( sockets[i], message, 4 ) ||
+                sockets[i]->send( message, 4, true, false ) != 4 ) {
+                printf( "Server failed to echo on connection %d\n", i );
+                ok = false;
+                break;
+                }
+            }
+        }
+
+    for( int i=0; i<numConnections + 1; i++ ) {
+        delete sockets[i];
+        }
+    delete [] sockets;
+
+    if( ok ) {
+        return 0;
+        }
+    return 1;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    if( inNumArgs == 4 ) {
+        port = atoi( inArgs[1] );
+        numConnections = atoi( inArgs[2] );
+        numRounds = atoi( inArgs[3] );
+        }
+
+    // each process needs one descriptor per connection, plus a few spare
+    struct rlimit limit;
+    getrlimit( RLIMIT_NOFILE, &limit );
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit( RLIMIT_NOFILE, &limit );
+    getrlimit( RLIMIT_NOFILE, &limit );
+
+    if( limit.rlim_cur != RLIM_INFINITY &&
+        (long)limit.rlim_cur < numConnections + 32 ) {
+        printf( "Open file limit is %ld, reducing connection count\n",
+                (long)limit.rlim_cur );
+        numConnections = limit.rlim_cur - 32;
+        }
+
+    printf( "Testing %d loopback connections\n\n", numConnections );
+
+
+    SocketServer *server = new SocketServer( port, 1024 );
+
+    // don't let both processes print what is buffered so far
+    fflush( stdout );
+
+    pid_t serverPID = fork();
+
+    if( serverPID == 0 ) {
+        int result = runServer( server );
+        delete server;
+        exit( result );
+        }
+
+    // server socket only used by child
+    delete server;
+
+
+    char ok = true;
+
+    Socket **sockets = new Socket*[ numConnections ];
+
+    HostAddress address( stringDuplicate( "127.0.0.1" ), port );
+
+    double startTime = Time::getCurrentTime();
+
+    for( int i=0; i<numConnections; i++ ) {
+        char timedOut;
+        sockets[i] = SocketClient::connectToServer( &address, 5000,
+                                                    &timedOut );
+        if( sockets[i] == NULL ) {
+            printf( "Failed to open connection %d\n", i );
+            kill( serverPID, SIGKILL );
+            return 1;
+            }
+        }
+
+    double connectTime = Time::getCurrentTime() - startTime;
+
+    printf( "Opened %d connections in %.2f sec (%.0f connects/sec)\n",
+            numConnections, connectTime, numConnections / connectTime );
+
+
+    // non-blocking connect completes through isConnected
+    char timedOut;
+    Socket *extra = SocketClient::connectToServer( &address, 0, &timedOut );
+
+    int connected = 0;
+    startTime = Time::getCurrentTime();
+    while( extra != NULL && connected == 0 &&
+           Time::getCurrentTime() - startTime < 5 ) {
+        connected = extra->isConnected();
+        }
+
+    printf( "%-36s %s\n", "non-blocking connect, high fd",
+            connected == 1 ? "ok" : "FAILED" );
+    ok &= ( connected == 1 );
+
+
+    // nothing has been sent yet, so receive must time out
+    unsigned char message[4];
+
+    startTime = Time::getCurrentTime();
+    int numRead = sockets[ numConnections - 1 ]->receive( message, 4,
+                                                          SHORT_TIMEOUT );
+    if( numRead != -2 ) {
+        printf( "Receive on idle connection returned %d\n", numRead );
+        ok = false;
+        }
+    ok &= checkTimeout( "receive timeout, high fd", startTime,
+                        SHORT_TIMEOUT );
+
+
+    // each round sends one message on every connection and then
+    // collects all the echoes
+    startTime = Time::getCurrentTime();
+
+    for( int r=0; r<numRounds && ok; r++ ) {
+        for( int i=0; i<numConnections; i++ ) {
+            message[0] = (unsigned char)( i >> 24 );
+            message[1] = (unsigned char)( i >> 16 );
+            message[2] = (unsigned char)( i >> 8 );
+            message[3] = (unsigned char)( r );
+
+            if( sockets[i]->send( message, 4, true, false ) != 4 ) {
+                printf( "Send failed on connection %d\n", i );
+                ok = false;
+                break;
+                }
+            }
+
+        for( int i=0; i<numConnections && ok; i++ ) {
+            if( ! receiveFully( sockets[i], message, 4 ) ||
+                message[2] != (unsigned char)( i >> 8 ) ||
+                message[3] != (unsigned char)( r ) ) {
+                printf( "Bad echo on connection %d\n", i );
+                ok = false;
+                }
+            }
+        }
+
+    double roundTime = Time::getCurrentTime() - startTime;
+
+    if( ok ) {
+        printf( "\n%d round trips in %.2f sec (%.0f round trips/sec)\n",
+                numConnections * numRounds, roundTime,
+                numConnections * numRounds / roundTime );
+        }
+
+
+    int status = 1;
+    waitpid( serverPID, &status, 0 );
+
+    if( ! WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+        printf( "Server process reported failure\n" );
+        ok = false;
+        }
+
+    for( int i=0; i<numConnections; i++ ) {
+        delete sockets[i];
+        }
+    delete [] sockets;
+
+    if( extra != NULL ) {
+        delete extra;
+        }
+
+    if( ! ok ) {
+        printf( "\nFAILED\n" );
+        return 1;
+        }
+
+    printf( "\nAll checks passed\n" );
+    return 0;
+    }
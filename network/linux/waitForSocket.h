@@ -0,0 +1,74 @@
+#ifndef WAIT_FOR_SOCKET_INCLUDED
+#define WAIT_FOR_SOCKET_INCLUDED
+
+
+#include <time.h>
+#include <poll.h>
+#include <errno.h>
+
+
+
+// shared by the Linux Socket, SocketClient, and SocketServer
+// implementations and by the Unix SocketUDP, so that every socket
+// timeout is handled the same way
+
+
+
+// milliseconds since an arbitrary start point, unaffected by clock changes
+static inline double getMonotonicMS() {
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return t.tv_sec * 1000.0 + t.tv_nsec / 1000000.0;
+    }
+
+
+
+// waits until inSock is ready for inEvents (POLLIN or POLLOUT)
+//
+// poll works for any descriptor number, unlike select, which cannot
+// watch descriptors at or above FD_SETSIZE
+//
+// if interrupted by a signal, waits again only for the time that is left
+// of inTimeoutMS, so signals never stretch the timeout
+//
+// inTimeoutMS of -1 waits forever
+//
+// returns 1 if ready, 0 on timeout, or -1 on error
+static inline int waitForSocket( int inSock, short inEvents, 
+                                 long inTimeoutMS = -1 ) {
+    struct pollfd p;
+    p.fd = inSock;
+    p.events = inEvents;
+    p.revents = 0;
+    
+    double deadline = 0;
+    if( inTimeoutMS > 0 ) {
+        deadline = getMonotonicMS() + inTimeoutMS;
+        }
+    
+    int ret = poll( &p, 1, inTimeoutMS );
+    
+    while( ret < 0 && errno == EINTR ) {
+        // interrupted, wait again for the time that is left
+        if( inTimeoutMS > 0 ) {
+            long remaining = (long)( deadline - getMonotonicMS() );
+            if( remaining <= 0 ) {
+                return 0;
+                }
+            inTimeoutMS = remaining;
+            }
+        ret = poll( &p, 1, inTimeoutMS );
+        }
+    
+    if( ret < 0 ) {
+        return -1;
+        }
+    if( ret > 0 ) {
+        return 1;
+        }
+    return 0;
+    }
+
+
+
+#endif
@@ -0,0 +1,250 @@
+// Measures the per-frame cost of polling many non-blocking sockets from a
+// game's frame loop, calling Socket directly (the way gameSDL does without
+// an I/O thread) versus going through SocketIOEngine.
+//
+// A forked echo server holds the other end of each connection.  Every
+// frame, the client reads whatever has arrived on each socket and sends
+// one small message on each.  Only time spent in socket calls is counted
+// toward frame cost.
+//
+// Usage:  socketIOEngineBenchmark [port numSockets numFrames]
+
+
+#include "minorGems/network/SocketIOEngine.h"
+#include "minorGems/network/SocketServer.h"
+#include "minorGems/network/SocketClient.h"
+#include "minorGems/network/SocketPoll.h"
+#include "minorGems/network/Socket.h"
+#include "minorGems/network/HostAddress.h"
+
+#include "minorGems/system/Thread.h"
+#include "minorGems/system/Time.h"
+
+#include "minorGems/util/stringUtils.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+
+
+static int port = 5895;
+static int numSockets = 1000;
+static int numFrames = 300;
+
+#define MESSAGE_BYTES 32
+
+// frame time left for everything else
+#define SLEEP_PER_FRAME_MS 2
+
+
+
+// runs in forked process, echoes everything until killed
+static void runEchoServer( SocketServer *inServer, int inNumConnections ) {
+    SocketPoll poll;
+
+    for( int i=0; i<inNumConnections; i++ ) {
+        Socket *sock = inServer->acceptConnection();
+        if( sock == NULL ) {
+            exit( 1 );
+            }
+        poll.addSocket( sock );
+        }
+
+    unsigned char buffer[ 4096 ];
+
+    while( true ) {
+        SocketOrServer *ready = poll.wait( -1 );
+
+        if( ready == NULL || ! ready->isSocket ) {
+            continue;
+            }
+
+        int numRead = ready->sock->receive( buffer, sizeof( buffer ), 0 );
+
+        if( numRead == -1 ) {
+            poll.removeSocket( ready->sock );
+            }
+        else if( numRead > 0 ) {
+            ready->sock->send( buffer, numRead, true, false );
+            }
+        }
+    }
+
+
+
+static Socket **openSockets( HostAddress *inAddress ) {
+    Socket **sockets = new Socket*[ numSockets ];
+
+    for( int i=0; i<numSockets; i++ ) {
+        char timedOut;
+        sockets[i] = SocketClient::connectToServer( inAddress, 0, &timedOut );
+
+        if( sockets[i] == NULL ) {
+            printf( "Failed to open connection %d\n", i );
+            exit( 1 );
+            }
+        sockets[i]->setPersistentNonBlocking();
+        }
+    return sockets;
+    }
+
+
+
+// returns bytes echoed back
+static long runFrames( const char *inName, Socket **inSockets,
+                       SocketIOEngine *inEngine, int *inEngineIDs ) {
+
+    unsigned char message[ MESSAGE_BYTES ];
+    memset( message, 1, MESSAGE_BYTES );
+
+    unsigned char buffer[ 4096 ];
+
+    long bytesReceived = 0;
+    long bytesSent = 0;
+
+    double socketTime = 0;
+    double startTime = Time::getCurrentTime();
+
+    for( int f=0; f<numFrames; f++ ) {
+
+        double frameStart = Time::getCurrentTime();
+
+        for( int i=0; i<numSockets; i++ ) {
+
+            // read everything waiting, as a game's message loop would
+            int numRead = 1;
+            while( numRead > 0 ) {
+                if( inEngine != NULL ) {
+                    numRead = inEngine->receive( inEngineIDs[i],
+                                                 buffer, sizeof( buffer ) );
+                    }
+                else {
+                    numRead = 0;
+                    if( inSockets[i]->isConnected() ) {
+                        numRead = inSockets[i]->receive( buffer,
+                                                         sizeof( buffer ),
+                                                         0 );
+                        }
+                    }
+                if( numRead > 0 ) {
+                    bytesReceived += numRead;
+                    }
+                }
+
+            int numSent = 0;
+            if( inEngine != NULL ) {
+                numSent = inEngine->send( inEngineIDs[i],
+                                          message, MESSAGE_BYTES );
+                }
+            else if( inSockets[i]->isConnected() ) {
+                numSent = inSockets[i]->send( message, MESSAGE_BYTES,
+                                              false, false );
+                }
+            if( numSent > 0 ) {
+                bytesSent += numSent;
+                }
+            }
+
+        socketTime += Time::getCurrentTime() - frameStart;
+
+        Thread::staticSleep( SLEEP_PER_FRAME_MS );
+        }
+
+    double totalTime = Time::getCurrentTime() - startTime;
+
+    printf( "%-22s %9.1f usec/frame in socket calls   "
+            "%5.1f%% of frame time   %ld of %ld bytes echoed\n",
+            inName, 1000000 * socketTime / numFrames,
+            100 * socketTime / totalTime, bytesReceived, bytesSent );
+
+    return bytesReceived;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    if( inNumArgs == 4 ) {
+        port = atoi( inArgs[1] );
+        numSockets = atoi( inArgs[2] );
+        numFrames = atoi( inArgs[3] );
+        }
+
+    if( ! SocketIOEngine::isSupported() ) {
+        printf( "SocketIOEngine not supported on this platform\n" );
+        return 1;
+        }
+
+    struct rlimit limit;
+    getrlimit( RLIMIT_NOFILE, &limit );
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit( RLIMIT_NOFILE, &limit );
+
+    Socket::initSocketFramework();
+
+    SocketServer *server = new SocketServer( port, 1024 );
+
+    fflush( stdout );
+
+    // one echo server process for each run
+    pid_t serverPID = fork();
+    if( serverPID == 0 ) {
+        runEchoServer( server, numSockets );
+        exit( 0 );
+        }
+
+    printf( "%d sockets, %d frames\n\n", numSockets, numFrames );
+
+    HostAddress address( stringDuplicate( "127.0.0.1" ), port );
+
+
+    // direct
+    Socket **sockets = openSockets( &address );
+
+    runFrames( "direct Socket calls", sockets, NULL, NULL );
+
+    for( int i=0; i<numSockets; i++ ) {
+        delete sockets[i];
+        }
+    delete [] sockets;
+
+    kill( serverPID, SIGKILL );
+    waitpid( serverPID, NULL, 0 );
+
+
+    // engine
+    serverPID = fork();
+    if( serverPID == 0 ) {
+        runEchoServer( server, numSockets );
+        exit( 0 );
+        }
+    delete server;
+
+    sockets = openSockets( &address );
+
+    SocketIOEngine *engine = new SocketIOEngine();
+    int *ids = new int[ numSockets ];
+
+    for( int i=0; i<numSockets; i++ ) {
+        ids[i] = engine->addSocket( sockets[i] );
+        }
+
+    runFrames( "SocketIOEngine", NULL, engine, ids );
+
+    // destroys sockets
+    delete engine;
+    delete [] ids;
+    delete [] sockets;
+
+    kill( serverPID, SIGKILL );
+    waitpid( serverPID, NULL, 0 );
+
+    return 0;
+    }
@@ -0,0 +1,208 @@
+// Measures loopback UDP packets/sec for one-at-a-time send/receive
+// versus the batch calls, with and without segmentation offload and
+// receive coalescing.
+//
+// Runs on one thread:  each round sends a burst small enough to fit in
+// the receive buffer, then receives all of it, so the numbers reflect
+// per-packet cost of both sides rather than scheduling.
+//
+// Usage:  udpBatchBenchmark [port numPackets payloadBytes]
+//
+// Keep payloadBytes at 512 or less so each burst fits in the default
+// receive buffer.
+
+
+#include "minorGems/network/SocketUDP.h"
+#include "minorGems/network/Socket.h"
+
+#include "minorGems/system/Time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+static int port = 5892;
+static int numPackets = 1000000;
+static int payloadBytes = 64;
+
+// packets per round, small enough to fit in default receive buffer
+#define BURST 128
+
+// batch entries per call
+#define BATCH 64
+
+// largest coalesced run
+#define RUN_BUFFER_SIZE 65536
+
+
+
+static void printResult( const char *inName, int inNumSent, int inNumGot,
+                         double inTime ) {
+    printf( "%-30s %10.0f packets/sec   (%d lost)\n",
+            inName, inNumGot / inTime, inNumSent - inNumGot );
+    }
+
+
+
+static void runSingle( SocketUDP *inSocket, struct UDPAddress *inAddress ) {
+    unsigned char *payload = new unsigned char[ payloadBytes ];
+    memset( payload, 1, payloadBytes );
+
+    int numGot = 0;
+
+    double startTime = Time::getCurrentTime();
+
+    for( int p=0; p<numPackets; p += BURST ) {
+        for( int b=0; b<BURST; b++ ) {
+            inSocket->send( inAddress, payload, payloadBytes );
+            }
+
+        for( int b=0; b<BURST; b++ ) {
+            struct UDPAddress *from;
+            unsigned char *data;
+
+            int numBytes = inSocket->receive( &from, &data, 100 );
+
+            if( numBytes < 0 ) {
+                // lost
+                break;
+                }
+            delete from;
+            delete [] data;
+            numGot++;
+            }
+        }
+
+    printResult( "send/receive", numPackets, numGot,
+                 Time::getCurrentTime() - startTime );
+
+    delete [] payload;
+    }
+
+
+
+// one batch entry per packet, or one entry per run of packets if
+// inSegmented
+static void runBatch( const char *inName, SocketUDP *inSocket,
+                      struct UDPAddress *inAddress, char inSegmented ) {
+
+    // entries sent per burst, and per call
+    int numEntries = BURST;
+    int numEntriesPerCall = BATCH;
+    int bufferSize = payloadBytes;
+
+    if( inSegmented ) {
+        // BATCH packets in each run
+        numEntries = BURST / BATCH;
+        numEntriesPerCall = numEntries;
+        bufferSize = RUN_BUFFER_SIZE;
+        }
+
+    struct UDPDatagram sendBatch[ BURST ];
+    struct UDPDatagram receiveBatch[ BURST ];
+
+    for( int i=0; i<BURST; i++ ) {
+        sendBatch[i].mAddress = *inAddress;
+        sendBatch[i].mData = new unsigned char[ bufferSize ];
+        memset( sendBatch[i].mData, 1, bufferSize );
+        sendBatch[i].mNumBytes = payloadBytes;
+        sendBatch[i].mSegmentSize = 0;
+
+        if( inSegmented ) {
+            sendBatch[i].mNumBytes = payloadBytes * BATCH;
+            sendBatch[i].mSegmentSize = payloadBytes;
+            }
+
+        receiveBatch[i].mData = new unsigned char[ bufferSize ];
+        receiveBatch[i].mBufferSize = bufferSize;
+        }
+
+    int numGot = 0;
+
+    double startTime = Time::getCurrentTime();
+
+    for( int p=0; p<numPackets; p += BURST ) {
+
+        for( int e=0; e<numEntries; e += numEntriesPerCall ) {
+            inSocket->sendBatch( &( sendBatch[e] ), numEntriesPerCall );
+            }
+
+        int numGotThisBurst = 0;
+
+        while( numGotThisBurst < BURST ) {
+            int numEntriesGot = inSocket->receiveBatch( receiveBatch,
+                                                        BURST, 100 );
+            if( numEntriesGot < 0 ) {
+                // lost
+                break;
+                }
+
+            for( int i=0; i<numEntriesGot; i++ ) {
+                int segmentSize = receiveBatch[i].mSegmentSize;
+
+                if( segmentSize > 0 ) {
+                    numGotThisBurst +=
+                        ( receiveBatch[i].mNumBytes + segmentSize - 1 ) /
+                        segmentSize;
+                    }
+                else {
+                    numGotThisBurst ++;
+                    }
+                }
+            }
+        numGot += numGotThisBurst;
+        }
+
+    printResult( inName, numPackets, numGot,
+                 Time::getCurrentTime() - startTime );
+
+    for( int i=0; i<BURST; i++ ) {
+        delete [] sendBatch[i].mData;
+        delete [] receiveBatch[i].mData;
+        }
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    if( inNumArgs == 4 ) {
+        port = atoi( inArgs[1] );
+        numPackets = atoi( inArgs[2] );
+        payloadBytes = atoi( inArgs[3] );
+        }
+
+    Socket::initSocketFramework();
+
+    SocketUDP *socket = new SocketUDP( port );
+
+    struct UDPAddress *address = SocketUDP::makeAddress( "127.0.0.1", port );
+
+    // whole bursts only
+    numPackets -= numPackets % BURST;
+
+    printf( "%d packets of %d bytes over loopback\n\n",
+            numPackets, payloadBytes );
+
+    runSingle( socket, address );
+
+    runBatch( "batch", socket, address, false );
+
+    if( socket->setReceiveCoalescing( true ) ) {
+        runBatch( "batch, offload+coalescing", socket, address, true );
+        socket->setReceiveCoalescing( false );
+        }
+    else {
+        printf( "receive coalescing not supported\n" );
+        }
+
+    // splitting in software or kernel, without coalescing
+    runBatch( "batch, offload only", socket, address, true );
+
+    delete address;
+    delete socket;
+
+    return 0;
+    }
@@ -43,6 +43,9 @@
     #include <string.h>
     #include <unistd.h>
     #include <sys/time.h>
+    #include <errno.h>
+
+    #include "minorGems/network/linux/waitForSocket.h"
 #else
     // special includes for win32
     #include <winsock.h>
@@ -61,6 +64,41 @@
 #endif
 
 
+#if defined( __linux__ ) && !defined( WIN32 )
+    // batch calls (sendmmsg, recvmmsg) and UDP segmentation offload
+    #define USE_MMSG
+    #include <netinet/udp.h>
+
+    // older headers lack these, but newer kernels still support them
+    #ifndef SOL_UDP
+        #define SOL_UDP 17
+    #endif
+    #ifndef UDP_SEGMENT
+        #define UDP_SEGMENT 103
+    #endif
+    #ifndef UDP_GRO
+        #define UDP_GRO 104
+    #endif
+#endif
+
+
+// most messages passed to one sendmmsg or recvmmsg call
+#define UDP_BATCH_CHUNK 64
+
+// kernel limits for one offloaded send
+#define UDP_MAX_OFFLOAD_SEGMENTS 64
+#define UDP_MAX_OFFLOAD_BYTES 65507
+
+
+// mNativeObjectPointer points to an int array with these entries
+#define UDP_NATIVE_SOCKET_ID 0
+// set once a send with segmentation offload has been refused
+#define UDP_NATIVE_NO_SEGMENT_OFFLOAD 1
+// set when receive coalescing is on
+#define UDP_NATIVE_COALESCING 2
+#define UDP_NATIVE_LENGTH 3
+
+
 
 
 // prototypes
@@ -98,8 +136,10 @@ SocketUDP::SocketUDP( unsigned short inReceivePort ) {
     bind( socketID, (struct sockaddr *)&bindAddress, sizeof(bindAddress) );
 
     
-    int *socketIDArray = new int[1];
-	socketIDArray[0] = socketID;
+    int *socketIDArray = new int[ UDP_NATIVE_LENGTH ];
+	socketIDArray[ UDP_NATIVE_SOCKET_ID ] = socketID;
+    socketIDArray[ UDP_NATIVE_NO_SEGMENT_OFFLOAD ] = false;
+    socketIDArray[ UDP_NATIVE_COALESCING ] = false;
 
     mNativeObjectPointer = (void *)socketIDArray;
     }
@@ -248,15 +288,386 @@ int SocketUDP::receive( struct UDPAddress **outAddress,
     }
 
 
+// the part of a datagram that goes into the next message
+// advances inDatagram and inOffset past that part
+// returns the message length
+static int nextMessagePart( struct UDPDatagram *inDatagrams,
+                            int *inDatagram, int *inOffset,
+                            char inUseOffload, char *outOffloaded ) {
+    
+    struct UDPDatagram *d = &( inDatagrams[ *inDatagram ] );
+    
+    int remaining = d->mNumBytes - *inOffset;
+    int segmentSize = d->mSegmentSize;
+    
+    *outOffloaded = false;
+
+    if( segmentSize > 0 && segmentSize < remaining ) {
+
+        if( inUseOffload && *inOffset == 0 &&
+            d->mNumBytes <= UDP_MAX_OFFLOAD_BYTES &&
+            ( d->mNumBytes + segmentSize - 1 ) / segmentSize <= 
+            UDP_MAX_OFFLOAD_SEGMENTS ) {
+            
+            // kernel splits whole run
+            *outOffloaded = true;
+            }
+        else {
+            // one segment per message
+            *inOffset += segmentSize;
+            return segmentSize;
+            }
+        }
+    
+    (*inDatagram) ++;
+    *inOffset = 0;
+    return remaining;
+    }
+
+
+
+static void fillAddress( struct sockaddr_in *inAddress, 
+                         struct UDPAddress *inUDPAddress ) {
+    memset( inAddress, 0, sizeof( struct sockaddr_in ) );
+    inAddress->sin_family = AF_INET;
+    inAddress->sin_port = inUDPAddress->mPort; 
+    inAddress->sin_addr.s_addr = inUDPAddress->mIPAddress;
+    }
+
+
+
+int SocketUDP::sendBatch( struct UDPDatagram *inDatagrams, 
+                          int inNumDatagrams ) {
+    
+    int *socketIDArray = (int *)( mNativeObjectPointer );
+	int socketID = socketIDArray[ UDP_NATIVE_SOCKET_ID ];
+
+    // position of the next unsent byte
+    int datagram = 0;
+    int offset = 0;
+    
+#ifdef USE_MMSG
+
+    struct mmsghdr messages[ UDP_BATCH_CHUNK ];
+    struct iovec vectors[ UDP_BATCH_CHUNK ];
+    struct sockaddr_in addresses[ UDP_BATCH_CHUNK ];
+    
+    union {
+            char buffer[ CMSG_SPACE( sizeof( uint16_t ) ) ];
+            struct cmsghdr align;
+        } controls[ UDP_BATCH_CHUNK ];
+    
+    // where sending resumes after each message
+    int endDatagram[ UDP_BATCH_CHUNK ];
+    int endOffset[ UDP_BATCH_CHUNK ];
+    
+    
+    while( datagram < inNumDatagrams ) {
+        
+        char useOffload = 
+            ! socketIDArray[ UDP_NATIVE_NO_SEGMENT_OFFLOAD ];
+        
+        int numMessages = 0;
+        char firstOffloaded = false;
+        
+        int d = datagram;
+        int o = offset;
+        
+        while( d < inNumDatagrams && numMessages < UDP_BATCH_CHUNK ) {
+            
+            struct UDPDatagram *dg = &( inDatagrams[d] );
+            
+            struct msghdr *h = &( messages[ numMessages ].msg_hdr );
+            memset( h, 0, sizeof( struct msghdr ) );
+
+            vectors[ numMessages ].iov_base = dg->mData + o;
+
+            char offloaded;
+            vectors[ numMessages ].iov_len = 
+                nextMessagePart( inDatagrams, &d, &o, useOffload, 
+                                 &offloaded );
+            
+            fillAddress( &( addresses[ numMessages ] ), &( dg->mAddress ) );
+            
+            h->msg_name = &( addresses[ numMessages ] );
+            h->msg_namelen = sizeof( struct sockaddr_in );
+            h->msg_iov = &( vectors[ numMessages ] );
+            h->msg_iovlen = 1;
+            
+            if( offloaded ) {
+                h->msg_control = controls[ numMessages ].buffer;
+                h->msg_controllen = sizeof( controls[ numMessages ].buffer );
+                
+                struct cmsghdr *c = CMSG_FIRSTHDR( h );
+                c->cmsg_level = SOL_UDP;
+                c->cmsg_type = UDP_SEGMENT;
+                c->cmsg_len = CMSG_LEN( sizeof( uint16_t ) );
+
+                uint16_t segmentSize = (uint16_t)dg->mSegmentSize;
+                memcpy( CMSG_DATA( c ), &segmentSize, sizeof( uint16_t ) );
+
+                if( numMessages == 0 ) {
+                    firstOffloaded = true;
+                    }
+                }
+            
+            endDatagram[ numMessages ] = d;
+            endOffset[ numMessages ] = o;
+            numMessages++;
+            }
+        
+        
+        int numSent = sendmmsg( socketID, messages, numMessages, 0 );
+        
+        if( numSent < 0 && errno == EINTR ) {
+            continue;
+            }
+        
+        if( numSent < 0 && firstOffloaded &&
+            ( errno == EIO || errno == EINVAL || 
+              errno == ENOPROTOOPT || errno == EOPNOTSUPP ) ) {
+            // kernel or device can't offload, split runs ourselves
+            // from now on
+            socketIDArray[ UDP_NATIVE_NO_SEGMENT_OFFLOAD ] = true;
+            continue;
+            }
+        
+        if( numSent <= 0 ) {
+            break;
+            }
+
+        datagram = endDatagram[ numSent - 1 ];
+        offset = endOffset[ numSent - 1 ];
+        }
+
+#else
+
+    while( datagram < inNumDatagrams ) {
+        
+        struct UDPDatagram *dg = &( inDatagrams[ datagram ] );
+        unsigned char *data = dg->mData + offset;
+        
+        char offloaded;
+        int length = nextMessagePart( inDatagrams, &datagram, &offset, 
+                                      false, &offloaded );
+        
+        struct sockaddr_in toAddress;
+        fillAddress( &toAddress, &( dg->mAddress ) );
+        
+        if( sendto( socketID, (char *)data, length, 0,
+                    (struct sockaddr *)( &toAddress ),
+                    sizeof( toAddress ) ) < 0 ) {
+            // back up to start of this datagram, which was not fully sent
+            datagram = dg - inDatagrams;
+            break;
+            }
+        }
+
+#endif
+    
+    if( datagram == 0 && inNumDatagrams > 0 ) {
+        return -1;
+        }
+    return datagram;
+    }
+
+
+
+int SocketUDP::receiveBatch( struct UDPDatagram *inDatagrams, 
+                             int inMaxDatagrams,
+                             long inTimeout ) {
+
+    int *socketIDArray = (int *)( mNativeObjectPointer );
+	int socketID = socketIDArray[ UDP_NATIVE_SOCKET_ID ];
+
+    if( inTimeout != -1 ) {
+        int waitValue = waitForIncomingData( socketID, inTimeout );
+
+        // timed out or saw an error while waiting
+        if( waitValue == -1 || waitValue == -2 ) {
+            return waitValue;
+            }
+        }
+
+    int numReceived = 0;
+
+#ifdef USE_MMSG
+
+    char coalescing = socketIDArray[ UDP_NATIVE_COALESCING ];
+    
+    struct mmsghdr messages[ UDP_BATCH_CHUNK ];
+    struct iovec vectors[ UDP_BATCH_CHUNK ];
+    struct sockaddr_in addresses[ UDP_BATCH_CHUNK ];
+    
+    union {
+            char buffer[ CMSG_SPACE( sizeof( int ) ) ];
+            struct cmsghdr align;
+        } controls[ UDP_BATCH_CHUNK ];
+
+    
+    while( numReceived < inMaxDatagrams ) {
+        
+        int numMessages = inMaxDatagrams - numReceived;
+        if( numMessages > UDP_BATCH_CHUNK ) {
+            numMessages = UDP_BATCH_CHUNK;
+            }
+        
+        for( int i=0; i<numMessages; i++ ) {
+            struct UDPDatagram *dg = &( inDatagrams[ numReceived + i ] );
+            
+            struct msghdr *h = &( messages[i].msg_hdr );
+            memset( h, 0, sizeof( struct msghdr ) );
+            
+            vectors[i].iov_base = dg->mData;
+            vectors[i].iov_len = dg->mBufferSize;
+            
+            h->msg_name = &( addresses[i] );
+            h->msg_namelen = sizeof( struct sockaddr_in );
+            h->msg_iov = &( vectors[i] );
+            h->msg_iovlen = 1;
+
+            if( coalescing ) {
+                h->msg_control = controls[i].buffer;
+                h->msg_controllen = sizeof( controls[i].buffer );
+                }
+            }
+        
+        // block for first datagram only
+        int flags = MSG_WAITFORONE;
+        if( numReceived > 0 ) {
+            flags = MSG_DONTWAIT;
+            }
+        
+        int numGot = recvmmsg( socketID, messages, numMessages, flags, 
+                               NULL );
+        
+        if( numGot < 0 && errno == EINTR ) {
+            continue;
+            }
+        
+        if( numGot <= 0 ) {
+            if( numReceived == 0 ) {
+                return -1;
+                }
+            // nothing more waiting
+            break;
+            }
+        
+        for( int i=0; i<numGot; i++ ) {
+            struct UDPDatagram *dg = &( inDatagrams[ numReceived + i ] );
+            struct msghdr *h = &( messages[i].msg_hdr );
+            
+            dg->mNumBytes = messages[i].msg_len;
+            dg->mTruncated = ( ( h->msg_flags & MSG_TRUNC ) != 0 );
+            dg->mAddress.mIPAddress = addresses[i].sin_addr.s_addr;
+            dg->mAddress.mPort = addresses[i].sin_port;
+            dg->mSegmentSize = 0;
+
+            if( coalescing ) {
+                for( struct cmsghdr *c = CMSG_FIRSTHDR( h ); c != NULL;
+                     c = CMSG_NXTHDR( h, c ) ) {
+                    
+                    if( c->cmsg_level == SOL_UDP && 
+                        c->cmsg_type == UDP_GRO ) {
+                        int segmentSize;
+                        memcpy( &segmentSize, CMSG_DATA( c ), 
+                                sizeof( int ) );
+                        dg->mSegmentSize = segmentSize;
+                        }
+                    }
+                }
+            }
+
+        numReceived += numGot;
+        
+        if( numGot < numMessages ) {
+            // took everything that was waiting
+            break;
+            }
+        }
+
+#else
+
+    while( numReceived < inMaxDatagrams ) {
+        struct UDPDatagram *dg = &( inDatagrams[ numReceived ] );
+
+        struct sockaddr_in fromAddress;
+        socklen_t fromAddressLength = sizeof( fromAddress );
+        
+        int flags = 0;
+    #ifndef WIN32
+        // block for first datagram only
+        if( numReceived > 0 ) {
+            flags = MSG_DONTWAIT;
+            }
+    #endif
+
+        int numGot = recvfrom( socketID, (char *)( dg->mData ),
+                               dg->mBufferSize, flags,
+                               (struct sockaddr *)( &fromAddress ),
+                               &fromAddressLength );
+        if( numGot < 0 ) {
+            if( numReceived == 0 ) {
+                return -1;
+                }
+            break;
+            }
+        
+        dg->mNumBytes = numGot;
+        dg->mTruncated = false;
+        dg->mAddress.mIPAddress = fromAddress.sin_addr.s_addr;
+        dg->mAddress.mPort = fromAddress.sin_port;
+        dg->mSegmentSize = 0;
+        
+        numReceived++;
+        
+    #ifdef WIN32
+        // no way to check for more without blocking
+        break;
+    #endif
+        }
+
+#endif
+
+    return numReceived;
+    }
+
+
+
+char SocketUDP::setReceiveCoalescing( char inOn ) {
+#ifdef USE_MMSG
+    int *socketIDArray = (int *)( mNativeObjectPointer );
+	int socketID = socketIDArray[ UDP_NATIVE_SOCKET_ID ];
+    
+    int value = inOn;
+    
+    if( setsockopt( socketID, SOL_UDP, UDP_GRO, 
+                    &value, sizeof( value ) ) < 0 ) {
+        return false;
+        }
+    
+    socketIDArray[ UDP_NATIVE_COALESCING ] = inOn;
+    return true;
+#else
+    return false;
+#endif
+    }
+
+
+
 /* socket timing code adapted from gnut, by Josh Pieper */
 /* Josh Pieper, (c) 2000 */
 /* This file is distributed under the GPL, see file COPYING for details */
 int waitForIncomingData( int inSocketID, 
                          long inMilliseconds ) {
 
+	int returnValue;
+
+#ifndef WIN32
+    returnValue = waitForSocket( inSocketID, POLLIN, inMilliseconds );
+#else
     fd_set fsr;
 	struct timeval tv;
-	int returnValue;
 	
 	FD_ZERO( &fsr );
 	FD_SET( inSocketID, &fsr );
@@ -265,12 +676,13 @@ int waitForIncomingData( int inSocketID,
 	int remainder = inMilliseconds % 1000;
 	tv.tv_usec = remainder * 1000; 
 	returnValue = select( inSocketID + 1, &fsr, NULL, NULL, &tv );
+#endif
 	
 	if( returnValue == 0 ) {
 		return -2;
 		}
 	else if( returnValue == -1 ) {
-		printf( "Selecting socket during receive failed.\n" );
+		printf( "Waiting on socket during receive failed.\n" );
 		return returnValue;
 		}
     else {
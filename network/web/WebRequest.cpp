@@ -145,7 +145,7 @@ WebRequest::WebRequest( const char *inMethod, const char *inURL,
         tempStream.writeString( "\r\n" );
         }
         
-    mRequest = tempStream.getString();
+    mRequest = tempStream.detachString();
     mRequestPosition = 0;
 
         
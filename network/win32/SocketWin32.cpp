@@ -210,12 +210,26 @@ int Socket::isConnected() {
 
 void Socket::setNoDelay( int inValue ) {
 
+    // only change Nagle state when the next send needs something different
+    if( mNoDelay == inValue ) {
+        return;
+        }
+
     int flag = inValue;
     setsockopt( mNativeSocketID,
                 IPPROTO_TCP,
                 TCP_NODELAY,
                 (char *) &flag,
                 sizeof(int) ); 
+
+    mNoDelay = inValue;
+    }
+
+
+
+int Socket::setPersistentNonBlocking() {
+    // not supported here, since receive relies on blocking mode
+    return -1;
     }
 
 
@@ -223,23 +237,22 @@ void Socket::setNoDelay( int inValue ) {
 
 int Socket::send( unsigned char *inBuffer, int inNumBytes,
                   char inAllowedToBlock,
-                  char inAllowDelay ) {
+                  char inAllowDelay,
+                  char inMoreComing ) {
 	
 	unsigned int socketID = mNativeSocketID;
 
+    if( ! inAllowDelay ) {
+        // turn nodelay on
+        setNoDelay( 1 );
+        }
+    else {
+        setNoDelay( 0 );
+        }
+
     if( inAllowedToBlock ) {
-        if( ! inAllowDelay ) {
-            // turn nodelay on
-            setNoDelay( 1 );
-            }        
-        
         int returnVal = ::send( socketID, (char*)inBuffer, inNumBytes, 0 );
         
-        if( ! inAllowDelay ) {
-            // turn nodelay back off
-            setNoDelay( 0 );
-            }
-        
         return returnVal;
         }
     else {
@@ -247,18 +260,8 @@ int Socket::send( unsigned char *inBuffer, int inNumBytes,
         u_long socketMode = 1;
         ioctlsocket( socketID, FIONBIO, &socketMode );
 
-        if( ! inAllowDelay ) {
-            // turn nodelay on
-            setNoDelay( 1 );
-            }
-
         int result = ::send( socketID, (char*)inBuffer, inNumBytes, 0 );
         
-        if( ! inAllowDelay ) {
-            // turn nodelay back off
-            setNoDelay( 0 );
-            }
-
 
         // set back to blocking
         socketMode = 0;
@@ -278,6 +281,35 @@ int Socket::send( unsigned char *inBuffer, int inNumBytes,
 		
 		
 		
+int Socket::sendGather( unsigned char **inBuffers, int *inNumBytes,
+                        int inNumBuffers,
+                        char inAllowedToBlock,
+                        char inAllowDelay ) {
+    
+    // copy into one buffer and send that
+    int totalBytes = 0;
+    
+    for( int i=0; i<inNumBuffers; i++ ) {
+        totalBytes += inNumBytes[i];
+        }
+    
+    unsigned char *allBytes = new unsigned char[ totalBytes ];
+    
+    int next = 0;
+    for( int i=0; i<inNumBuffers; i++ ) {
+        memcpy( &( allBytes[ next ] ), inBuffers[i], inNumBytes[i] );
+        next += inNumBytes[i];
+        }
+    
+    int result = send( allBytes, totalBytes, inAllowedToBlock, inAllowDelay );
+    
+    delete [] allBytes;
+    
+    return result;
+    }
+		
+		
+		
 int Socket::receive( unsigned char *inBuffer, int inNumBytes,
 	long inTimeout ) {
 	
@@ -2,6 +2,7 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 
 
@@ -100,3 +101,408 @@ void audioNoClip( NoClip *inC,
     
     }
 
+
+
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+static inline __m128d absPair( double *inValues ) {
+    __m128d signMask = _mm_set1_pd( -0.0 );
+    return _mm_andnot_pd( signMask, _mm_loadu_pd( inValues ) );
+    }
+#endif
+
+
+
+// index of the first sample in [inStart, inEnd) where either channel's
+// magnitude is above inLimit, or inEnd if there is none
+static int findFirstAbove( double *inSamplesL, double *inSamplesR,
+                           int inStart, int inEnd, double inLimit ) {
+    int i = inStart;
+    
+#ifdef __SSE2__
+    __m128d limit = _mm_set1_pd( inLimit );
+
+    for( ; i + 4 <= inEnd; i += 4 ) {
+        __m128d a = _mm_max_pd( absPair( &( inSamplesL[i] ) ),
+                                absPair( &( inSamplesR[i] ) ) );
+        __m128d b = _mm_max_pd( absPair( &( inSamplesL[i + 2] ) ),
+                                absPair( &( inSamplesR[i + 2] ) ) );
+        
+        if( _mm_movemask_pd( _mm_cmpgt_pd( _mm_max_pd( a, b ), 
+                                           limit ) ) ) {
+            // found in this group, scalar loop below finds which one
+            break;
+            }
+        }
+#endif
+
+    for( ; i<inEnd; i++ ) {
+        if( fabs( inSamplesL[i] ) > inLimit || 
+            fabs( inSamplesR[i] ) > inLimit ) {
+            return i;
+            }
+        }
+    return inEnd;
+    }
+
+
+
+// largest magnitude in either channel
+static double findPeak( double *inSamplesL, double *inSamplesR,
+                        int inNumSamples ) {
+    double peak = 0;
+    int i = 0;
+    
+#ifdef __SSE2__
+    __m128d peakA = _mm_setzero_pd();
+    __m128d peakB = _mm_setzero_pd();
+
+    for( ; i + 4 <= inNumSamples; i += 4 ) {
+        peakA = _mm_max_pd( peakA, 
+                            _mm_max_pd( absPair( &( inSamplesL[i] ) ),
+                                        absPair( &( inSamplesR[i] ) ) ) );
+        peakB = _mm_max_pd( peakB, 
+                            _mm_max_pd( absPair( &( inSamplesL[i + 2] ) ),
+                                        absPair( &( inSamplesR[i + 2] ) ) ) );
+        }
+    
+    double lanes[2];
+    _mm_storeu_pd( lanes, _mm_max_pd( peakA, peakB ) );
+    
+    peak = lanes[0];
+    if( lanes[1] > peak ) {
+        peak = lanes[1];
+        }
+#endif
+
+    for( ; i<inNumSamples; i++ ) {
+        double l = fabs( inSamplesL[i] );
+        double r = fabs( inSamplesR[i] );
+        
+        if( l > peak ) {
+            peak = l;
+            }
+        if( r > peak ) {
+            peak = r;
+            }
+        }
+    return peak;
+    }
+
+
+
+// multiplies sample i by inStartGain + i * inGainStep
+static void applyGainRamp( double *inSamplesL, double *inSamplesR,
+                           int inNumSamples,
+                           double inStartGain, double inGainStep ) {
+    int i = 0;
+    
+#ifdef __SSE2__
+    __m128d startGain = _mm_set1_pd( inStartGain );
+    __m128d gainStep = _mm_set1_pd( inGainStep );
+    __m128d index = _mm_set_pd( 1.0, 0.0 );
+    __m128d two = _mm_set1_pd( 2.0 );
+
+    for( ; i + 2 <= inNumSamples; i += 2 ) {
+        __m128d gain = _mm_add_pd( startGain, _mm_mul_pd( gainStep, index ) );
+        
+        _mm_storeu_pd( &( inSamplesL[i] ),
+                       _mm_mul_pd( gain, _mm_loadu_pd( &( inSamplesL[i] ) ) ) );
+        _mm_storeu_pd( &( inSamplesR[i] ),
+                       _mm_mul_pd( gain, _mm_loadu_pd( &( inSamplesR[i] ) ) ) );
+
+        index = _mm_add_pd( index, two );
+        }
+#endif
+
+    for( ; i<inNumSamples; i++ ) {
+        double gain = inStartGain + i * inGainStep;
+        
+        inSamplesL[i] *= gain;
+        inSamplesR[i] *= gain;
+        }
+    }
+
+
+
+// audioNoClip is a serial state machine, so it can be run on any split
+// of the samples with the same result
+#define NO_CLIP_CHUNK 64
+
+
+void audioNoClipBlock( NoClip *inC,
+                       double *inSamplesL, double *inSamplesR, 
+                       int inNumSamples ) {
+    int i = 0;
+    
+    while( i < inNumSamples ) {
+        
+        if( inC->gain == 1.0 ) {
+            // audioNoClip leaves samples untouched until one clips
+            i = findFirstAbove( inSamplesL, inSamplesR, i, inNumSamples,
+                                inC->maxVolume );
+            
+            if( i == inNumSamples ) {
+                break;
+                }
+            }
+        
+        int chunk = inNumSamples - i;
+        if( chunk > NO_CLIP_CHUNK ) {
+            chunk = NO_CLIP_CHUNK;
+            }
+
+        audioNoClip( inC, &( inSamplesL[i] ), &( inSamplesR[i] ), chunk );
+        
+        i += chunk;
+        }
+    }
+
+
+
+// samples per gain step of NoClipLimiter
+#define LIMITER_BLOCK 32
+
+
+
+NoClipLimiter *newNoClipLimiter( double inMaxVolume, 
+                                 int inHoldTimeInSamples,
+                                 int inDecayTimeInSamples,
+                                 int inLookAheadInSamples ) {
+    NoClipLimiter *l = new NoClipLimiter;
+    
+    l->maxVolume = inMaxVolume;
+    l->holdTime = inHoldTimeInSamples;
+    l->currentHoldTime = 0;
+    l->decayTime = inDecayTimeInSamples;
+    l->gain = 1.0;
+    l->gainDecayPerSample = 0;
+    
+    l->lookAheadBlocks = 
+        ( inLookAheadInSamples + LIMITER_BLOCK - 1 ) / LIMITER_BLOCK;
+
+    l->delayL = NULL;
+    l->delayR = NULL;
+    l->blockTargets = NULL;
+    l->orderedTargets = NULL;
+    
+    l->currentBlock = 0;
+    l->currentBlockFill = 0;
+
+    if( l->lookAheadBlocks > 0 ) {
+        int numBlocks = l->lookAheadBlocks + 1;
+        
+        l->delayL = new double[ numBlocks * LIMITER_BLOCK ];
+        l->delayR = new double[ numBlocks * LIMITER_BLOCK ];
+        l->blockTargets = new double[ numBlocks ];
+        l->orderedTargets = new double[ numBlocks ];
+
+        for( int i=0; i<numBlocks * LIMITER_BLOCK; i++ ) {
+            l->delayL[i] = 0;
+            l->delayR[i] = 0;
+            }
+        for( int b=0; b<numBlocks; b++ ) {
+            l->blockTargets[b] = 1.0;
+            }
+        }
+    
+    return l;
+    }
+
+
+
+void deleteNoClipLimiter( NoClipLimiter *inL ) {
+    if( inL->delayL != NULL ) {
+        delete [] inL->delayL;
+        delete [] inL->delayR;
+        delete [] inL->blockTargets;
+        delete [] inL->orderedTargets;
+        }
+    delete inL;
+    }
+
+
+
+int getNoClipLimiterLatency( NoClipLimiter *inL ) {
+    if( inL->lookAheadBlocks == 0 ) {
+        return 0;
+        }
+    return ( inL->lookAheadBlocks + 1 ) * LIMITER_BLOCK;
+    }
+
+
+
+static double getTargetGain( NoClipLimiter *inL, 
+                             double *inSamplesL, double *inSamplesR,
+                             int inNumSamples ) {
+    double peak = findPeak( inSamplesL, inSamplesR, inNumSamples );
+
+    if( peak > inL->maxVolume ) {
+        return inL->maxVolume / peak;
+        }
+    return 1.0;
+    }
+
+
+
+// ramps gain across one sub-block
+// inTargets[0] is the target gain for this sub-block, and inTargets[k] for
+// the sub-block k ahead of it, up to inNumAhead
+static void limitBlock( NoClipLimiter *inL, 
+                        double *inSamplesL, double *inSamplesR,
+                        int inNumSamples,
+                        double *inTargets, int inNumAhead ) {
+    
+    // sudden peak that look-ahead didn't prepare for
+    double startGain = inL->gain;
+    if( startGain > inTargets[0] ) {
+        startGain = inTargets[0];
+        }
+
+    // lowest gain allowed at end of this sub-block:
+    // under this sub-block's peak, and on a straight line down to
+    // each peak ahead, reaching it just as the peak arrives
+    double limit = inTargets[0];
+    
+    for( int k=1; k<=inNumAhead; k++ ) {
+        double t = inTargets[k];
+        double aheadLimit = t + ( 1.0 - t ) * ( k - 1 ) / inNumAhead;
+        
+        if( aheadLimit < limit ) {
+            limit = aheadLimit;
+            }
+        }
+
+    double endGain;
+    
+    if( startGain + inL->gainDecayPerSample * inNumSamples > limit ) {
+        // can't release without clipping now or soon, hold
+        inL->currentHoldTime = 0;
+        
+        endGain = startGain;
+        if( endGain > limit ) {
+            endGain = limit;
+            }
+        }
+    else {
+        inL->currentHoldTime += inNumSamples;
+        
+        endGain = startGain;
+
+        if( inL->currentHoldTime > inL->holdTime ) {
+            endGain += inL->gainDecayPerSample * inNumSamples;
+            
+            if( endGain > 1.0 ) {
+                endGain = 1.0;
+                }
+            }
+        }
+
+    double lowestGain = startGain;
+    if( endGain < lowestGain ) {
+        lowestGain = endGain;
+        }
+    
+    if( lowestGain < inL->gain ) {
+        // new peak, release from here over decay time
+        inL->gainDecayPerSample = ( 1.0 - lowestGain ) / inL->decayTime;
+        }
+    
+    
+    if( startGain != 1.0 || endGain != 1.0 ) {
+        applyGainRamp( inSamplesL, inSamplesR, inNumSamples,
+                       startGain, ( endGain - startGain ) / inNumSamples );
+        }
+    
+    inL->gain = endGain;
+    }
+
+
+
+void noClipLimit( NoClipLimiter *inL,
+                  double *inSamplesL, double *inSamplesR, int inNumSamples ) {
+
+    if( inL->lookAheadBlocks == 0 ) {
+        for( int i=0; i<inNumSamples; i += LIMITER_BLOCK ) {
+            int blockLength = inNumSamples - i;
+            if( blockLength > LIMITER_BLOCK ) {
+                blockLength = LIMITER_BLOCK;
+                }
+            
+            double target = getTargetGain( inL, 
+                                           &( inSamplesL[i] ), 
+                                           &( inSamplesR[i] ),
+                                           blockLength );
+
+            limitBlock( inL, &( inSamplesL[i] ), &( inSamplesR[i] ),
+                        blockLength, &target, 0 );
+            }
+        return;
+        }
+    
+
+    int numBlocks = inL->lookAheadBlocks + 1;
+    
+    int i = 0;
+    
+    while( i < inNumSamples ) {
+        int count = LIMITER_BLOCK - inL->currentBlockFill;
+        if( count > inNumSamples - i ) {
+            count = inNumSamples - i;
+            }
+
+        int delayStart = 
+            inL->currentBlock * LIMITER_BLOCK + inL->currentBlockFill;
+        
+        double *delayL = &( inL->delayL[ delayStart ] );
+        double *delayR = &( inL->delayR[ delayStart ] );
+
+        // swap new samples in, limited samples from lookAheadBlocks + 1
+        // sub-blocks ago out
+        double temp[ LIMITER_BLOCK ];
+        int countBytes = count * sizeof( double );
+        
+        memcpy( temp, delayL, countBytes );
+        memcpy( delayL, &( inSamplesL[i] ), countBytes );
+        memcpy( &( inSamplesL[i] ), temp, countBytes );
+
+        memcpy( temp, delayR, countBytes );
+        memcpy( delayR, &( inSamplesR[i] ), countBytes );
+        memcpy( &( inSamplesR[i] ), temp, countBytes );
+        
+        inL->currentBlockFill += count;
+        i += count;
+
+        if( inL->currentBlockFill == LIMITER_BLOCK ) {
+            int blockStart = inL->currentBlock * LIMITER_BLOCK;
+            
+            inL->blockTargets[ inL->currentBlock ] = 
+                getTargetGain( inL, 
+                               &( inL->delayL[ blockStart ] ),
+                               &( inL->delayR[ blockStart ] ),
+                               LIMITER_BLOCK );
+
+            // oldest sub-block is limited now that all the sub-blocks
+            // it can see ahead to are known, and is output next
+            int oldest = ( inL->currentBlock + 1 ) % numBlocks;
+
+            for( int k=0; k<numBlocks; k++ ) {
+                inL->orderedTargets[k] = 
+                    inL->blockTargets[ ( oldest + k ) % numBlocks ];
+                }
+            
+            int oldestStart = oldest * LIMITER_BLOCK;
+            
+            limitBlock( inL, 
+                        &( inL->delayL[ oldestStart ] ),
+                        &( inL->delayR[ oldestStart ] ),
+                        LIMITER_BLOCK,
+                        inL->orderedTargets, inL->lookAheadBlocks );
+
+            inL->currentBlock = oldest;
+            inL->currentBlockFill = 0;
+            }
+        }
+    }
@@ -29,3 +29,72 @@ void audioNoClip( NoClip *inC,
 
 
 
+// same results as audioNoClip, bit for bit, but skips quickly over stretches
+// that are not clipping while gain is at full, which is the common case
+void audioNoClipBlock( NoClip *inC,
+                       double *inSamplesL, double *inSamplesR, 
+                       int inNumSamples );
+
+
+
+
+// Block-based limiter with optional look-ahead.
+//
+// Gain is computed once per short sub-block from its peak, and ramped
+// linearly across each sub-block, so no sample ever exceeds max volume.
+//
+// With look-ahead, the output is delayed, and gain starts ramping down
+// before a peak arrives instead of dropping suddenly on the peak, which
+// avoids distorting transients.
+//
+// Output differs from audioNoClip, so use audioNoClipBlock where output
+// must match older recordings.
+typedef struct NoClipLimiter {
+        double maxVolume;
+        
+        int holdTime;
+        int currentHoldTime;
+
+        int decayTime;
+
+        double gain;
+        double gainDecayPerSample;
+
+        // in sub-blocks
+        int lookAheadBlocks;
+
+        // lookAheadBlocks + 1 sub-blocks of delayed samples, 
+        // and the target gain for each
+        double *delayL;
+        double *delayR;
+        double *blockTargets;
+
+        // blockTargets reordered starting from the oldest sub-block
+        double *orderedTargets;
+        
+        // sub-block currently being filled, and how full it is
+        int currentBlock;
+        int currentBlockFill;
+        
+    } NoClipLimiter;
+
+
+
+// inLookAheadInSamples is rounded up to a whole number of sub-blocks
+// 0 disables look-ahead and adds no latency
+NoClipLimiter *newNoClipLimiter( double inMaxVolume, 
+                                 int inHoldTimeInSamples,
+                                 int inDecayTimeInSamples,
+                                 int inLookAheadInSamples );
+
+
+void deleteNoClipLimiter( NoClipLimiter *inL );
+
+
+// output delay in samples
+int getNoClipLimiterLatency( NoClipLimiter *inL );
+
+
+// limits samples in place
+void noClipLimit( NoClipLimiter *inL,
+                  double *inSamplesL, double *inSamplesR, int inNumSamples );
@@ -0,0 +1,266 @@
+// Compares the block limiters in audioNoClip.h against the original
+// per-sample audioNoClip, offline, on a synthetic game-like mix, and
+// measures their speed.
+//
+// audioNoClipBlock must match audioNoClip exactly, and NoClipLimiter must
+// never exceed max volume.  Returns non-zero if either check fails.
+//
+// Usage:  audioNoClipBenchmark [secondsOfAudio]
+
+
+#include "audioNoClip.h"
+
+#include "minorGems/system/Time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+
+static int sampleRate = 44100;
+static int callbackSize = 512;
+static double maxVolume = 32767.0;
+
+// each run is repeated to get above timer resolution
+static int numPasses = 20;
+
+
+
+// quiet music, with occasional loud percussive hits that clip
+static void fillTestMix( double *outL, double *outR, int inNumSamples ) {
+    unsigned int seed = 4321;
+    
+    double hitLevel = 0;
+    
+    for( int i=0; i<inNumSamples; i++ ) {
+        // a hit every ~0.3 seconds, some loud enough to clip
+        if( i % 13331 == 0 ) {
+            seed = seed * 1103515245 + 12345;
+            hitLevel = 10000 + ( ( seed >> 16 ) % 40000 );
+            }
+        hitLevel *= 0.9995;
+
+        seed = seed * 1103515245 + 12345;
+        double noise = ( ( seed >> 16 ) & 0x7FFF ) / 32768.0 - 0.5;
+        
+        double music = 12000 * sin( i * 0.031 ) + 6000 * sin( i * 0.0071 );
+        
+        outL[i] = music + hitLevel * noise;
+        outR[i] = music * 0.8 - hitLevel * noise;
+        }
+    }
+
+
+
+// feeds whole mix through in callback-sized pieces
+static double runOriginal( double *inMixL, double *inMixR,
+                           double *outL, double *outR, int inNumSamples ) {
+    double time = 0;
+    
+    for( int p=0; p<numPasses; p++ ) {
+        NoClip c = resetAudioNoClip( maxVolume, sampleRate / 20, 
+                                     sampleRate / 20 );
+        memcpy( outL, inMixL, inNumSamples * sizeof( double ) );
+        memcpy( outR, inMixR, inNumSamples * sizeof( double ) );
+        
+        double startTime = Time::getCurrentTime();
+        for( int i=0; i<inNumSamples; i += callbackSize ) {
+            audioNoClip( &c, &( outL[i] ), &( outR[i] ), callbackSize );
+            }
+        time += Time::getCurrentTime() - startTime;
+        }
+    return time / numPasses;
+    }
+
+
+
+static double runBlock( double *inMixL, double *inMixR,
+                        double *outL, double *outR, int inNumSamples ) {
+    double time = 0;
+    
+    for( int p=0; p<numPasses; p++ ) {
+        NoClip c = resetAudioNoClip( maxVolume, sampleRate / 20, 
+                                     sampleRate / 20 );
+        memcpy( outL, inMixL, inNumSamples * sizeof( double ) );
+        memcpy( outR, inMixR, inNumSamples * sizeof( double ) );
+        
+        double startTime = Time::getCurrentTime();
+        for( int i=0; i<inNumSamples; i += callbackSize ) {
+            audioNoClipBlock( &c, &( outL[i] ), &( outR[i] ), 
+                              callbackSize );
+            }
+        time += Time::getCurrentTime() - startTime;
+        }
+    return time / numPasses;
+    }
+
+
+
+static double runLimiter( double *inMixL, double *inMixR,
+                          double *outL, double *outR, int inNumSamples,
+                          int inLookAhead, int *outLatency ) {
+    double time = 0;
+    
+    for( int p=0; p<numPasses; p++ ) {
+        NoClipLimiter *l = newNoClipLimiter( maxVolume, sampleRate / 20, 
+                                             sampleRate / 20, inLookAhead );
+        *outLatency = getNoClipLimiterLatency( l );
+
+        memcpy( outL, inMixL, inNumSamples * sizeof( double ) );
+        memcpy( outR, inMixR, inNumSamples * sizeof( double ) );
+        
+        double startTime = Time::getCurrentTime();
+        for( int i=0; i<inNumSamples; i += callbackSize ) {
+            noClipLimit( l, &( outL[i] ), &( outR[i] ), callbackSize );
+            }
+        time += Time::getCurrentTime() - startTime;
+
+        deleteNoClipLimiter( l );
+        }
+    return time / numPasses;
+    }
+
+
+
+// largest jump in applied gain from one sample to the next, a measure
+// of how much the limiter distorts transients
+static double maxGainJump( double *inOriginal, double *inLimited, 
+                           int inNumSamples, int inLatency ) {
+    double lastGain = 1.0;
+    double maxJump = 0;
+    
+    for( int i=inLatency; i<inNumSamples; i++ ) {
+        double in = inOriginal[ i - inLatency ];
+        
+        if( fabs( in ) < 1000 ) {
+            // gain estimate too noisy near zero crossings
+            continue;
+            }
+        double gain = inLimited[i] / in;
+        
+        double jump = fabs( gain - lastGain );
+        if( jump > maxJump ) {
+            maxJump = jump;
+            }
+        lastGain = gain;
+        }
+    return maxJump;
+    }
+
+
+
+static double getPeak( double *inL, double *inR, int inNumSamples ) {
+    double peak = 0;
+    for( int i=0; i<inNumSamples; i++ ) {
+        if( fabs( inL[i] ) > peak ) {
+            peak = fabs( inL[i] );
+            }
+        if( fabs( inR[i] ) > peak ) {
+            peak = fabs( inR[i] );
+            }
+        }
+    return peak;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+    
+    double seconds = 20;
+    
+    if( inNumArgs == 2 ) {
+        seconds = atof( inArgs[1] );
+        }
+    
+    int numSamples = 
+        (int)( seconds * sampleRate / callbackSize ) * callbackSize;
+    seconds = numSamples / (double)sampleRate;
+
+    double *mixL = new double[ numSamples ];
+    double *mixR = new double[ numSamples ];
+    fillTestMix( mixL, mixR, numSamples );
+
+    double *origL = new double[ numSamples ];
+    double *origR = new double[ numSamples ];
+    double *testL = new double[ numSamples ];
+    double *testR = new double[ numSamples ];
+
+    int bytes = numSamples * sizeof( double );
+
+    printf( "%.1f seconds of stereo audio at %d Hz, %d-sample callbacks, "
+            "input peak %.0f\n"
+            "(speed in seconds of audio per second)\n\n",
+            seconds, sampleRate, callbackSize, 
+            getPeak( mixL, mixR, numSamples ) );
+    
+    int failed = false;
+    
+    
+    double time = runOriginal( mixL, mixR, origL, origR, numSamples );
+    printf( "audioNoClip:                  %9.1fx\n", seconds / time );
+
+    
+    time = runBlock( mixL, mixR, testL, testR, numSamples );
+
+    char identical = 
+        memcmp( testL, origL, bytes ) == 0 &&
+        memcmp( testR, origR, bytes ) == 0;
+    
+    printf( "audioNoClipBlock:             %9.1fx  (%s)\n", seconds / time,
+            identical ? "identical" : "MISMATCH" );
+    if( ! identical ) {
+        failed = true;
+        }
+
+    
+    // quiet input, where nothing clips, is the usual case
+    double *quietL = new double[ numSamples ];
+    double *quietR = new double[ numSamples ];
+    for( int i=0; i<numSamples; i++ ) {
+        quietL[i] = mixL[i] * 0.25;
+        quietR[i] = mixR[i] * 0.25;
+        }
+    time = runOriginal( quietL, quietR, testL, testR, numSamples );
+    printf( "audioNoClip, not clipping:    %9.1fx\n", seconds / time );
+
+    time = runBlock( quietL, quietR, testL, testR, numSamples );
+    printf( "audioNoClipBlock, not clipping:%8.1fx\n\n", seconds / time );
+
+    
+    printf( "original gain jump:  %.4f\n\n", 
+            maxGainJump( mixL, origL, numSamples, 0 ) );
+    
+    int lookAheads[3] = { 0, 64, 256 };
+    
+    for( int a=0; a<3; a++ ) {
+        int latency;
+        time = runLimiter( mixL, mixR, testL, testR, numSamples, 
+                           lookAheads[a], &latency );
+
+        double peak = getPeak( testL, testR, numSamples );
+
+        printf( "NoClipLimiter, look-ahead %3d: %8.1fx  "
+                "(latency %d, peak %.1f, gain jump %.4f)\n",
+                lookAheads[a], seconds / time, latency, peak,
+                maxGainJump( mixL, testL, numSamples, latency ) );
+        
+        // allow for rounding in gain computation
+        if( peak > maxVolume + 0.001 ) {
+            printf( "  CLIPPED\n" );
+            failed = true;
+            }
+        }
+
+    delete [] mixL;
+    delete [] mixR;
+    delete [] origL;
+    delete [] origR;
+    delete [] testL;
+    delete [] testR;
+    delete [] quietL;
+    delete [] quietR;
+
+    return failed;
+    }
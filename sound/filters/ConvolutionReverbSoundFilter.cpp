@@ -0,0 +1,357 @@
+#include "ConvolutionReverbSoundFilter.h"
+#include "sampleBlocks.h"
+
+
+#include <math.h>
+#include <string.h>
+
+
+
+static float *newZeroedFloats( unsigned long inNumFloats ) {
+    float *floats = new float[ inNumFloats ];
+    memset( floats, 0, inNumFloats * sizeof( float ) );
+    return floats;
+    }
+
+
+
+ConvolutionReverbSoundFilter::ConvolutionReverbSoundFilter( 
+    SoundSamples *inImpulseResponse,
+    double inWetLevel,
+    unsigned long inPartitionSize )
+    : mWetLevel( (float)inWetLevel ),
+      mNewestInput( 0 ),
+      mWindowFill( 0 ) {
+
+    mPartitionSize = 1;
+    while( mPartitionSize < inPartitionSize ) {
+        mPartitionSize *= 2;
+        }
+
+    mFFTSize = 2 * mPartitionSize;
+    mNumBins = mPartitionSize + 1;
+
+    unsigned long impulseLength = inImpulseResponse->mSampleCount;
+    
+    mNumPartitions = 
+        ( impulseLength + mPartitionSize - 1 ) / mPartitionSize;
+    if( mNumPartitions < 1 ) {
+        mNumPartitions = 1;
+        }
+
+
+    mCosTable = new float[ mFFTSize / 2 ];
+    mSinTable = new float[ mFFTSize / 2 ];
+
+    for( unsigned long k=0; k<mFFTSize / 2; k++ ) {
+        double angle = 2 * M_PI * k / mFFTSize;
+        mCosTable[k] = (float)cos( angle );
+        mSinTable[k] = (float)sin( angle );
+        }
+
+    int numBits = 0;
+    while( ( 1UL << numBits ) < mFFTSize ) {
+        numBits++;
+        }
+    
+    mBitReverse = new unsigned long[ mFFTSize ];
+    for( unsigned long i=0; i<mFFTSize; i++ ) {
+        unsigned long r = 0;
+        for( int b=0; b<numBits; b++ ) {
+            if( i & ( 1UL << b ) ) {
+                r |= 1UL << ( numBits - 1 - b );
+                }
+            }
+        mBitReverse[i] = r;
+        }
+
+
+    unsigned long spectraSize = mNumPartitions * mNumBins;
+
+    mFilterLeftReal = newZeroedFloats( spectraSize );
+    mFilterLeftImag = newZeroedFloats( spectraSize );
+    mFilterRightReal = newZeroedFloats( spectraSize );
+    mFilterRightImag = newZeroedFloats( spectraSize );
+
+    mInputLeftReal = newZeroedFloats( spectraSize );
+    mInputLeftImag = newZeroedFloats( spectraSize );
+    mInputRightReal = newZeroedFloats( spectraSize );
+    mInputRightImag = newZeroedFloats( spectraSize );
+
+    mAccumLeftReal = newZeroedFloats( mNumBins );
+    mAccumLeftImag = newZeroedFloats( mNumBins );
+    mAccumRightReal = newZeroedFloats( mNumBins );
+    mAccumRightImag = newZeroedFloats( mNumBins );
+    
+    mFFTReal = newZeroedFloats( mFFTSize );
+    mFFTImag = newZeroedFloats( mFFTSize );
+
+    mWindowLeft = newZeroedFloats( mFFTSize );
+    mWindowRight = newZeroedFloats( mFFTSize );
+
+    mOutputLeft = newZeroedFloats( mPartitionSize );
+    mOutputRight = newZeroedFloats( mPartitionSize );
+    
+
+    // transform each zero-padded partition of the impulse response,
+    // folding the 1/N inverse FFT scale into the filter
+    float scale = 1.0f / mFFTSize;
+    
+    for( unsigned long p=0; p<mNumPartitions; p++ ) {
+        memset( mFFTReal, 0, mFFTSize * sizeof( float ) );
+        memset( mFFTImag, 0, mFFTSize * sizeof( float ) );
+
+        unsigned long start = p * mPartitionSize;
+        
+        for( unsigned long i=0; 
+             i < mPartitionSize && start + i < impulseLength; i++ ) {
+            
+            mFFTReal[i] = 
+                inImpulseResponse->mLeftChannel[ start + i ] * scale;
+            mFFTImag[i] = 
+                inImpulseResponse->mRightChannel[ start + i ] * scale;
+            }
+
+        fft( mFFTReal, mFFTImag );
+
+        unsigned long offset = p * mNumBins;
+        
+        splitStereoSpectrum( &( mFilterLeftReal[ offset ] ),
+                             &( mFilterLeftImag[ offset ] ),
+                             &( mFilterRightReal[ offset ] ),
+                             &( mFilterRightImag[ offset ] ) );
+        }
+    }
+
+
+
+ConvolutionReverbSoundFilter::~ConvolutionReverbSoundFilter() {
+    delete [] mCosTable;
+    delete [] mSinTable;
+    delete [] mBitReverse;
+
+    delete [] mFilterLeftReal;
+    delete [] mFilterLeftImag;
+    delete [] mFilterRightReal;
+    delete [] mFilterRightImag;
+
+    delete [] mInputLeftReal;
+    delete [] mInputLeftImag;
+    delete [] mInputRightReal;
+    delete [] mInputRightImag;
+
+    delete [] mAccumLeftReal;
+    delete [] mAccumLeftImag;
+    delete [] mAccumRightReal;
+    delete [] mAccumRightImag;
+    
+    delete [] mFFTReal;
+    delete [] mFFTImag;
+
+    delete [] mWindowLeft;
+    delete [] mWindowRight;
+
+    delete [] mOutputLeft;
+    delete [] mOutputRight;
+    }
+
+
+
+unsigned long ConvolutionReverbSoundFilter::getLatency() {
+    return mPartitionSize;
+    }
+
+
+
+void ConvolutionReverbSoundFilter::fft( float *ioReal, float *ioImag ) {
+    unsigned long n = mFFTSize;
+
+    for( unsigned long i=0; i<n; i++ ) {
+        unsigned long j = mBitReverse[i];
+        if( j > i ) {
+            float temp = ioReal[i];
+            ioReal[i] = ioReal[j];
+            ioReal[j] = temp;
+
+            temp = ioImag[i];
+            ioImag[i] = ioImag[j];
+            ioImag[j] = temp;
+            }
+        }
+
+    for( unsigned long size=2; size<=n; size *= 2 ) {
+        unsigned long half = size / 2;
+        unsigned long tableStep = n / size;
+
+        for( unsigned long start=0; start<n; start += size ) {
+            for( unsigned long k=0; k<half; k++ ) {
+                float wr = mCosTable[ k * tableStep ];
+                float wi = - mSinTable[ k * tableStep ];
+
+                unsigned long a = start + k;
+                unsigned long b = a + half;
+
+                float tr = ioReal[b] * wr - ioImag[b] * wi;
+                float ti = ioReal[b] * wi + ioImag[b] * wr;
+
+                ioReal[b] = ioReal[a] - tr;
+                ioImag[b] = ioImag[a] - ti;
+                ioReal[a] += tr;
+                ioImag[a] += ti;
+                }
+            }
+        }
+    }
+
+
+
+void ConvolutionReverbSoundFilter::splitStereoSpectrum( 
+    float *outLeftReal, float *outLeftImag,
+    float *outRightReal, float *outRightImag ) {
+
+    // both channels are real, so for Z = FFT( left + i * right ):
+    //   Left[k]  = ( Z[k] + conj( Z[N-k] ) ) / 2
+    //   Right[k] = ( Z[k] - conj( Z[N-k] ) ) / 2i
+    for( unsigned long k=0; k<mNumBins; k++ ) {
+        unsigned long m = ( mFFTSize - k ) % mFFTSize;
+
+        float zr = mFFTReal[k];
+        float zi = mFFTImag[k];
+        float mr = mFFTReal[m];
+        float mi = mFFTImag[m];
+
+        outLeftReal[k] = 0.5f * ( zr + mr );
+        outLeftImag[k] = 0.5f * ( zi - mi );
+        outRightReal[k] = 0.5f * ( zi + mi );
+        outRightImag[k] = 0.5f * ( mr - zr );
+        }
+    }
+
+
+
+void ConvolutionReverbSoundFilter::processPartition() {
+
+    memcpy( mFFTReal, mWindowLeft, mFFTSize * sizeof( float ) );
+    memcpy( mFFTImag, mWindowRight, mFFTSize * sizeof( float ) );
+    
+    fft( mFFTReal, mFFTImag );
+
+    mNewestInput = ( mNewestInput + 1 ) % mNumPartitions;
+
+    unsigned long offset = mNewestInput * mNumBins;
+    
+    splitStereoSpectrum( &( mInputLeftReal[ offset ] ),
+                         &( mInputLeftImag[ offset ] ),
+                         &( mInputRightReal[ offset ] ),
+                         &( mInputRightImag[ offset ] ) );
+
+
+    memset( mAccumLeftReal, 0, mNumBins * sizeof( float ) );
+    memset( mAccumLeftImag, 0, mNumBins * sizeof( float ) );
+    memset( mAccumRightReal, 0, mNumBins * sizeof( float ) );
+    memset( mAccumRightImag, 0, mNumBins * sizeof( float ) );
+
+    // newest input with first impulse partition, next newest with
+    // second, and so on
+    for( unsigned long p=0; p<mNumPartitions; p++ ) {
+        unsigned long inputOffset =
+            ( ( mNewestInput + mNumPartitions - p ) % mNumPartitions ) 
+            * mNumBins;
+        unsigned long filterOffset = p * mNumBins;
+
+        complexMultiplyAccumulate( mAccumLeftReal, mAccumLeftImag,
+                                   &( mInputLeftReal[ inputOffset ] ),
+                                   &( mInputLeftImag[ inputOffset ] ),
+                                   &( mFilterLeftReal[ filterOffset ] ),
+                                   &( mFilterLeftImag[ filterOffset ] ),
+                                   mNumBins );
+        
+        complexMultiplyAccumulate( mAccumRightReal, mAccumRightImag,
+                                   &( mInputRightReal[ inputOffset ] ),
+                                   &( mInputRightImag[ inputOffset ] ),
+                                   &( mFilterRightReal[ filterOffset ] ),
+                                   &( mFilterRightImag[ filterOffset ] ),
+                                   mNumBins );
+        }
+
+
+    // pack Left + i * Right back into one full spectrum, conjugated so
+    // that the forward FFT can be used as an inverse
+    for( unsigned long k=0; k<mNumBins; k++ ) {
+        mFFTReal[k] = mAccumLeftReal[k] - mAccumRightImag[k];
+        mFFTImag[k] = - ( mAccumLeftImag[k] + mAccumRightReal[k] );
+        }
+    for( unsigned long k=mNumBins; k<mFFTSize; k++ ) {
+        unsigned long m = mFFTSize - k;
+        
+        mFFTReal[k] = mAccumLeftReal[m] + mAccumRightImag[m];
+        mFFTImag[k] = - ( mAccumRightReal[m] - mAccumLeftImag[m] );
+        }
+
+    fft( mFFTReal, mFFTImag );
+
+    // real part is left, conjugated imaginary part is right
+    // first half wrapped around during circular convolution, so skip it
+    for( unsigned long i=0; i<mPartitionSize; i++ ) {
+        mOutputLeft[i] = mFFTReal[ mPartitionSize + i ];
+        mOutputRight[i] = - mFFTImag[ mPartitionSize + i ];
+        }
+
+    
+    // current partition becomes previous partition
+    memcpy( mWindowLeft, &( mWindowLeft[ mPartitionSize ] ),
+            mPartitionSize * sizeof( float ) );
+    memcpy( mWindowRight, &( mWindowRight[ mPartitionSize ] ),
+            mPartitionSize * sizeof( float ) );
+    }
+
+
+
+SoundSamples *ConvolutionReverbSoundFilter::filterSamples( 
+    SoundSamples *inSamples ) {
+
+    SoundSamples *outputSamples = new SoundSamples( inSamples );
+
+    filterSamplesInPlace( outputSamples->mLeftChannel,
+                          outputSamples->mRightChannel,
+                          outputSamples->mSampleCount );
+
+    return outputSamples;
+    }
+
+
+
+void ConvolutionReverbSoundFilter::filterSamplesInPlace( 
+    float *ioLeftChannel, float *ioRightChannel, 
+    unsigned long inNumSamples ) {
+
+    unsigned long i = 0;
+    
+    while( i < inNumSamples ) {
+        unsigned long count = mPartitionSize - mWindowFill;
+        if( count > inNumSamples - i ) {
+            count = inNumSamples - i;
+            }
+
+        // save dry input before mixing over it
+        memcpy( &( mWindowLeft[ mPartitionSize + mWindowFill ] ),
+                &( ioLeftChannel[i] ), count * sizeof( float ) );
+        memcpy( &( mWindowRight[ mPartitionSize + mWindowFill ] ),
+                &( ioRightChannel[i] ), count * sizeof( float ) );
+
+        addScaledSampleBlock( &( ioLeftChannel[i] ), 
+                              &( mOutputLeft[ mWindowFill ] ),
+                              count, mWetLevel );
+        addScaledSampleBlock( &( ioRightChannel[i] ), 
+                              &( mOutputRight[ mWindowFill ] ),
+                              count, mWetLevel );
+
+        mWindowFill += count;
+        i += count;
+
+        if( mWindowFill == mPartitionSize ) {
+            processPartition();
+            mWindowFill = 0;
+            }
+        }
+    }
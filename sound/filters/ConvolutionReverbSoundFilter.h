@@ -0,0 +1,118 @@
+#ifndef CONVOLUTION_REVERB_SOUND_FILTER_INCLUDED
+#define CONVOLUTION_REVERB_SOUND_FILTER_INCLUDED
+
+
+
+#include "SoundFilter.h"
+
+
+
+/**
+ * A reverb filter that convolves sound with a recorded or synthesized
+ * impulse response.
+ *
+ * Uses uniformly-partitioned FFT convolution (overlap-save), so cost per
+ * sample grows with the impulse length divided by the partition size,
+ * not with the impulse length itself.  Both channels share one complex
+ * FFT in each direction.
+ *
+ * The reverberated signal is delayed by one partition (see getLatency)
+ * and mixed over the unchanged input.
+ *
+ * @author Jason Rohrer
+ */
+class ConvolutionReverbSoundFilter : public SoundFilter {
+
+    public:
+
+        /**
+         * Constructs a filter.
+         *
+         * @param inImpulseResponse the impulse response for each channel.
+         *   Must be destroyed by caller.
+         * @param inWetLevel the gain applied to the reverberated signal.
+         * @param inPartitionSize the number of samples processed per FFT.
+         *   Rounded up to a power of 2.  Larger sizes are faster but add
+         *   latency.
+         */
+        ConvolutionReverbSoundFilter( SoundSamples *inImpulseResponse,
+                                      double inWetLevel,
+                                      unsigned long inPartitionSize = 256 );
+
+        virtual ~ConvolutionReverbSoundFilter();
+
+
+        
+        // delay, in samples, of the reverberated signal
+        unsigned long getLatency();
+
+        
+
+        // implements the SoundFilter interface
+        virtual SoundSamples *filterSamples( SoundSamples *inSamples );
+
+        virtual void filterSamplesInPlace( float *ioLeftChannel,
+                                           float *ioRightChannel,
+                                           unsigned long inNumSamples );
+
+        
+
+    private:
+
+        // convolves the last full partition of input
+        void processPartition();
+
+        // in-place, unscaled, forward complex FFT of size mFFTSize
+        void fft( float *ioReal, float *ioImag );
+
+        // splits the FFT of ( left + i * right ) in mFFTReal/mFFTImag
+        // into the first mNumBins bins of each channel's spectrum
+        void splitStereoSpectrum( float *outLeftReal, float *outLeftImag,
+                                  float *outRightReal, float *outRightImag );
+        
+        
+        float mWetLevel;
+        
+        unsigned long mPartitionSize;
+        unsigned long mFFTSize;
+        unsigned long mNumBins;
+        unsigned long mNumPartitions;
+
+        float *mCosTable;
+        float *mSinTable;
+        unsigned long *mBitReverse;
+        
+        // spectra of each impulse partition, mNumBins values per partition
+        float *mFilterLeftReal;
+        float *mFilterLeftImag;
+        float *mFilterRightReal;
+        float *mFilterRightImag;
+
+        // spectra of the last mNumPartitions input windows, used as a ring
+        float *mInputLeftReal;
+        float *mInputLeftImag;
+        float *mInputRightReal;
+        float *mInputRightImag;
+        unsigned long mNewestInput;
+
+        float *mAccumLeftReal;
+        float *mAccumLeftImag;
+        float *mAccumRightReal;
+        float *mAccumRightImag;
+        
+        float *mFFTReal;
+        float *mFFTImag;
+
+        // previous partition followed by the partition being filled
+        float *mWindowLeft;
+        float *mWindowRight;
+        unsigned long mWindowFill;
+
+        // reverberated output of the last full partition
+        float *mOutputLeft;
+        float *mOutputRight;
+    };
+
+
+
+#endif
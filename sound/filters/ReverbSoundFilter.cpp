@@ -8,6 +8,7 @@
 
 
 #include "ReverbSoundFilter.h"
+#include "sampleBlocks.h"
 
 
 
@@ -38,37 +39,58 @@ ReverbSoundFilter::~ReverbSoundFilter() {
 
 SoundSamples *ReverbSoundFilter::filterSamples( SoundSamples *inSamples ) {
 
+    // pass the input through to the output
+    SoundSamples *outputSamples = new SoundSamples( inSamples );
+
+    filterSamplesInPlace( outputSamples->mLeftChannel,
+                          outputSamples->mRightChannel,
+                          outputSamples->mSampleCount );
+    
+    return outputSamples;    
+    }
+
+
+
+void ReverbSoundFilter::filterSamplesInPlace( float *ioLeftChannel,
+                                              float *ioRightChannel,
+                                              unsigned long inNumSamples ) {
+
     unsigned long delaySize = mDelayBuffer->mSampleCount;
 
-    unsigned long numSamples = inSamples->mSampleCount;
+    unsigned long i = 0;
+    
+    while( i < inNumSamples ) {
 
-    // pass the input through to the output
-    SoundSamples *outputSamples = new SoundSamples( inSamples );
+        // longest run that doesn't wrap around the delay buffer
+        // each delay buffer slot in the run is read before it is
+        // overwritten, just like when stepping sample by sample
+        unsigned long runLength = delaySize - mDelayBufferPosition;
 
+        if( runLength > inNumSamples - i ) {
+            runLength = inNumSamples - i;
+            }
 
-    for( unsigned long i=0; i<numSamples; i++ ) {
+        float *delayL = &( mDelayBuffer->mLeftChannel[ mDelayBufferPosition ] );
+        float *delayR = 
+            &( mDelayBuffer->mRightChannel[ mDelayBufferPosition ] );
 
+        float *outL = &( ioLeftChannel[i] );
+        float *outR = &( ioRightChannel[i] );
         
         // add in reverb from the buffer to our output
-        outputSamples->mLeftChannel[i] +=
-            mDelayBuffer->mLeftChannel[ mDelayBufferPosition ];
-        outputSamples->mRightChannel[i] +=
-            mDelayBuffer->mRightChannel[ mDelayBufferPosition ]; 
-
+        addSampleBlock( outL, delayL, runLength );
+        addSampleBlock( outR, delayR, runLength );
+        
         // save our gained output in the delay buffer
-        mDelayBuffer->mLeftChannel[ mDelayBufferPosition ] =
-            mGain * coeffFilter( outputSamples->mLeftChannel[i], 
-                                 &mLowPassStateL );
-        mDelayBuffer->mRightChannel[ mDelayBufferPosition ] =
-            mGain * coeffFilter( outputSamples->mRightChannel[i],
-                                 &mLowPassStateR );
+        coeffFilterBlockStereo( outL, outR, delayL, delayR, runLength,
+                                &mLowPassStateL, &mLowPassStateR, mGain );
+
+        i += runLength;
         
         // step through delay buffer, wrapping around at end
-        mDelayBufferPosition++;
+        mDelayBufferPosition += runLength;
         if( mDelayBufferPosition >= delaySize ) {
             mDelayBufferPosition = 0;
             }
         }
-
-    return outputSamples;    
     }
@@ -48,6 +48,10 @@ class ReverbSoundFilter : public SoundFilter {
         // implements the SoundFilter interface
         virtual SoundSamples *filterSamples( SoundSamples *inSamples );
 
+        virtual void filterSamplesInPlace( float *ioLeftChannel,
+                                           float *ioRightChannel,
+                                           unsigned long inNumSamples );
+
         
 
     private:
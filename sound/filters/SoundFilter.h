@@ -14,6 +14,8 @@
 
 #include "SoundSamples.h"
 
+#include <string.h>
+
 
 
 /**
@@ -39,6 +41,24 @@ class SoundFilter {
         virtual SoundSamples *filterSamples( SoundSamples *inSamples ) = 0;
 
 
+        
+        /**
+         * Filters a block of samples in place.
+         *
+         * Filters that override this do no allocation here, so it can be
+         * called from an audio callback.  The default implementation
+         * goes through filterSamples, which allocates.
+         *
+         * @param ioLeftChannel, ioRightChannel the samples to filter,
+         *   replaced by the filtered samples.
+         *   Must be destroyed by caller.
+         * @param inNumSamples the number of samples in each channel.
+         */
+        virtual void filterSamplesInPlace( float *ioLeftChannel,
+                                           float *ioRightChannel,
+                                           unsigned long inNumSamples );
+
+
 
         // virtual destructor to ensure proper destruction of classes that
         // implement this interface
@@ -57,4 +77,31 @@ inline SoundFilter::~SoundFilter() {
 
 
 
+inline void SoundFilter::filterSamplesInPlace( float *ioLeftChannel,
+                                               float *ioRightChannel,
+                                               unsigned long inNumSamples ) {
+    
+    SoundSamples wrapper( inNumSamples, ioLeftChannel, ioRightChannel );
+
+    SoundSamples *result = filterSamples( &wrapper );
+
+    unsigned long numToCopy = result->mSampleCount;
+    if( numToCopy > inNumSamples ) {
+        numToCopy = inNumSamples;
+        }
+    
+    memcpy( ioLeftChannel, result->mLeftChannel,
+            numToCopy * sizeof( float ) );
+    memcpy( ioRightChannel, result->mRightChannel,
+            numToCopy * sizeof( float ) );
+
+    delete result;
+
+    // wrapper does not own these
+    wrapper.mLeftChannel = NULL;
+    wrapper.mRightChannel = NULL;
+    }
+
+
+
 #endif
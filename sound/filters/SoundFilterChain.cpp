@@ -0,0 +1,117 @@
+#include "SoundFilterChain.h"
+
+
+
+SoundFilterChain::SoundFilterChain( unsigned long inBlockSize )
+    : mBlockSize( inBlockSize ),
+      mLeftBlock( new float[ inBlockSize ] ),
+      mRightBlock( new float[ inBlockSize ] ) {
+    
+    }
+
+
+
+SoundFilterChain::~SoundFilterChain() {
+    for( int i=0; i<mFilters.size(); i++ ) {
+        delete *( mFilters.getElement( i ) );
+        }
+    
+    delete [] mLeftBlock;
+    delete [] mRightBlock;
+    }
+
+
+
+void SoundFilterChain::addFilter( SoundFilter *inFilter ) {
+    mFilters.push_back( inFilter );
+    }
+
+
+
+int SoundFilterChain::getNumFilters() {
+    return mFilters.size();
+    }
+
+
+
+unsigned long SoundFilterChain::getBlockSize() {
+    return mBlockSize;
+    }
+
+
+
+SoundSamples *SoundFilterChain::filterSamples( SoundSamples *inSamples ) {
+    SoundSamples *outputSamples = new SoundSamples( inSamples );
+
+    filterSamplesInPlace( outputSamples->mLeftChannel,
+                          outputSamples->mRightChannel,
+                          outputSamples->mSampleCount );
+
+    return outputSamples;
+    }
+
+
+
+void SoundFilterChain::filterSamplesInPlace( float *ioLeftChannel,
+                                             float *ioRightChannel,
+                                             unsigned long inNumSamples ) {
+    int numFilters = mFilters.size();
+    
+    for( unsigned long b=0; b<inNumSamples; b += mBlockSize ) {
+        
+        unsigned long blockLength = inNumSamples - b;
+        if( blockLength > mBlockSize ) {
+            blockLength = mBlockSize;
+            }
+
+        for( int f=0; f<numFilters; f++ ) {
+            mFilters.getElementDirect( f )->filterSamplesInPlace( 
+                &( ioLeftChannel[b] ), &( ioRightChannel[b] ), blockLength );
+            }
+        }
+    }
+
+
+
+void SoundFilterChain::filterStereo16InPlace( 
+    short *ioSamples, unsigned long inNumSampleFrames ) {
+
+    for( unsigned long b=0; b<inNumSampleFrames; b += mBlockSize ) {
+
+        unsigned long blockLength = inNumSampleFrames - b;
+        if( blockLength > mBlockSize ) {
+            blockLength = mBlockSize;
+            }
+
+        short *blockSamples = &( ioSamples[ 2 * b ] );
+        
+        for( unsigned long i=0; i<blockLength; i++ ) {
+            mLeftBlock[i] = blockSamples[ 2 * i ] / 32768.0f;
+            mRightBlock[i] = blockSamples[ 2 * i + 1 ] / 32768.0f;
+            }
+
+        filterSamplesInPlace( mLeftBlock, mRightBlock, blockLength );
+
+        for( unsigned long i=0; i<blockLength; i++ ) {
+            float l = mLeftBlock[i] * 32768.0f;
+            float r = mRightBlock[i] * 32768.0f;
+
+            // hard clip
+            if( l > 32767 ) {
+                l = 32767;
+                }
+            else if( l < -32768 ) {
+                l = -32768;
+                }
+            if( r > 32767 ) {
+                r = 32767;
+                }
+            else if( r < -32768 ) {
+                r = -32768;
+                }
+            
+            blockSamples[ 2 * i ] = (short)l;
+            blockSamples[ 2 * i + 1 ] = (short)r;
+            }
+        }
+    }
@@ -0,0 +1,87 @@
+#ifndef SOUND_FILTER_CHAIN_INCLUDED
+#define SOUND_FILTER_CHAIN_INCLUDED
+
+
+
+#include "SoundFilter.h"
+
+#include "minorGems/util/SimpleVector.h"
+
+
+
+/**
+ * A series of filters run in place on fixed-size blocks of samples.
+ *
+ * Each block passes through every filter before the next block starts,
+ * so the block stays in cache.  All buffers are allocated up front, and
+ * no allocation happens while filtering as long as every filter in the
+ * chain overrides filterSamplesInPlace.
+ *
+ * @author Jason Rohrer
+ */
+class SoundFilterChain : public SoundFilter {
+
+    public:
+
+        /**
+         * Constructs an empty chain.
+         *
+         * @param inBlockSize the maximum number of samples passed to
+         *   each filter at a time.
+         */
+        SoundFilterChain( unsigned long inBlockSize = 256 );
+
+        virtual ~SoundFilterChain();
+
+
+        
+        /**
+         * Adds a filter to the end of the chain.
+         *
+         * @param inFilter the filter to add.  Destroyed by this class.
+         */
+        void addFilter( SoundFilter *inFilter );
+
+
+        int getNumFilters();
+
+        unsigned long getBlockSize();
+
+        
+
+        /**
+         * Filters interleaved stereo 16-bit samples in place, like those
+         * passed to an SDL audio callback.
+         *
+         * @param ioSamples the L,R interleaved samples to filter.
+         *   Must be destroyed by caller.
+         * @param inNumSampleFrames the number of L,R pairs in ioSamples.
+         */
+        void filterStereo16InPlace( short *ioSamples,
+                                    unsigned long inNumSampleFrames );
+
+        
+
+        // implements the SoundFilter interface
+        virtual SoundSamples *filterSamples( SoundSamples *inSamples );
+
+        virtual void filterSamplesInPlace( float *ioLeftChannel,
+                                           float *ioRightChannel,
+                                           unsigned long inNumSamples );
+
+        
+
+    private:
+        
+        unsigned long mBlockSize;
+
+        SimpleVector<SoundFilter*> mFilters;
+
+        // conversion space for filterStereo16InPlace
+        float *mLeftBlock;
+        float *mRightBlock;
+    };
+
+
+
+#endif
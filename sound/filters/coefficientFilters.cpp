@@ -4,6 +4,11 @@
 #include <math.h>
 
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
 
 double coeffFilter( double inSample, CoeffFilterState *s ) {
     double nextOut = 
@@ -63,3 +68,109 @@ CoeffFilterState initLowPass( double inCutoffFreq, int inSampleRate,
     resetCoeffFilter( &s );
     return s;
     }
+
+
+
+void coeffFilterBlock( float *inSamples, float *outSamples,
+                       unsigned long inNumSamples,
+                       CoeffFilterState *s, double inGain ) {
+    double a1 = s->a1;
+    double a2 = s->a2;
+    double a3 = s->a3;
+    double b1 = s->b1;
+    double b2 = s->b2;
+    
+    double in0 = s->lastIn[0];
+    double in1 = s->lastIn[1];
+    double out0 = s->lastOut[0];
+    double out1 = s->lastOut[1];
+    
+    for( unsigned long i=0; i<inNumSamples; i++ ) {
+        double x = inSamples[i];
+        
+        // same operation order as coeffFilter
+        double nextOut = a1 * x + a2 * in0 + a3 * in1 - b1 * out0 - b2 * out1;
+        
+        in1 = in0;
+        in0 = x;
+        out1 = out0;
+        out0 = nextOut;
+
+        outSamples[i] = (float)( inGain * nextOut );
+        }
+
+    s->lastIn[0] = in0;
+    s->lastIn[1] = in1;
+    s->lastOut[0] = out0;
+    s->lastOut[1] = out1;
+    }
+
+
+
+void coeffFilterBlockStereo( float *inLeft, float *inRight,
+                             float *outLeft, float *outRight,
+                             unsigned long inNumSamples,
+                             CoeffFilterState *inLeftState,
+                             CoeffFilterState *inRightState,
+                             double inGain ) {
+#ifdef __SSE2__
+    CoeffFilterState *l = inLeftState;
+    CoeffFilterState *r = inRightState;
+    
+    // lane 0 is left, lane 1 is right
+    __m128d a1 = _mm_set_pd( r->a1, l->a1 );
+    __m128d a2 = _mm_set_pd( r->a2, l->a2 );
+    __m128d a3 = _mm_set_pd( r->a3, l->a3 );
+    __m128d b1 = _mm_set_pd( r->b1, l->b1 );
+    __m128d b2 = _mm_set_pd( r->b2, l->b2 );
+    __m128d gain = _mm_set1_pd( inGain );
+
+    __m128d in0 = _mm_set_pd( r->lastIn[0], l->lastIn[0] );
+    __m128d in1 = _mm_set_pd( r->lastIn[1], l->lastIn[1] );
+    __m128d out0 = _mm_set_pd( r->lastOut[0], l->lastOut[0] );
+    __m128d out1 = _mm_set_pd( r->lastOut[1], l->lastOut[1] );
+    
+    for( unsigned long i=0; i<inNumSamples; i++ ) {
+        __m128d x = _mm_set_pd( inRight[i], inLeft[i] );
+
+        // same operation order as coeffFilter, so results are identical
+        __m128d nextOut = _mm_add_pd( _mm_mul_pd( a1, x ),
+                                      _mm_mul_pd( a2, in0 ) );
+        nextOut = _mm_add_pd( nextOut, _mm_mul_pd( a3, in1 ) );
+        nextOut = _mm_sub_pd( nextOut, _mm_mul_pd( b1, out0 ) );
+        nextOut = _mm_sub_pd( nextOut, _mm_mul_pd( b2, out1 ) );
+        
+        in1 = in0;
+        in0 = x;
+        out1 = out0;
+        out0 = nextOut;
+
+        double result[2];
+        _mm_storeu_pd( result, _mm_mul_pd( gain, nextOut ) );
+        
+        outLeft[i] = (float)( result[0] );
+        outRight[i] = (float)( result[1] );
+        }
+
+    double lanes[2];
+
+    _mm_storeu_pd( lanes, in0 );
+    l->lastIn[0] = lanes[0];
+    r->lastIn[0] = lanes[1];
+
+    _mm_storeu_pd( lanes, in1 );
+    l->lastIn[1] = lanes[0];
+    r->lastIn[1] = lanes[1];
+
+    _mm_storeu_pd( lanes, out0 );
+    l->lastOut[0] = lanes[0];
+    r->lastOut[0] = lanes[1];
+
+    _mm_storeu_pd( lanes, out1 );
+    l->lastOut[1] = lanes[0];
+    r->lastOut[1] = lanes[1];
+#else
+    coeffFilterBlock( inLeft, outLeft, inNumSamples, inLeftState, inGain );
+    coeffFilterBlock( inRight, outRight, inNumSamples, inRightState, inGain );
+#endif
+    }
@@ -1,3 +1,7 @@
+#ifndef COEFFICIENT_FILTERS_INCLUDED
+#define COEFFICIENT_FILTERS_INCLUDED
+
+
 // filter algorithms found here:
 // http://www.musicdsp.org/archive.php?classid=3#243
 // Posted by Patrice Tarrabia
@@ -27,3 +31,27 @@ CoeffFilterState initHighPass( double inCutoffFreq, int inSampleRate,
 
 CoeffFilterState initLowPass( double inCutoffFreq, int inSampleRate,
                               double inRez );
+
+
+
+// Block versions of coeffFilter.
+// Output matches calling coeffFilter on each sample in turn, scaled by
+// inGain, but state is kept in registers across the whole block.
+// inSamples and outSamples can point to the same buffer.
+void coeffFilterBlock( float *inSamples, float *outSamples,
+                       unsigned long inNumSamples,
+                       CoeffFilterState *s, double inGain = 1.0 );
+
+
+// filters two channels at once, which runs both channels in the two lanes
+// of an SSE2 register where available
+void coeffFilterBlockStereo( float *inLeft, float *inRight,
+                             float *outLeft, float *outRight,
+                             unsigned long inNumSamples,
+                             CoeffFilterState *inLeftState,
+                             CoeffFilterState *inRightState,
+                             double inGain = 1.0 );
+
+
+
+#endif
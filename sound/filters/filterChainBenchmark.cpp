@@ -0,0 +1,286 @@
+// Measures how many seconds of stereo audio filter chains can process per
+// second of CPU time, comparing the allocating filterSamples path with the
+// in-place block path.
+//
+// Also checks that the block path matches the old per-sample results.
+//
+// Usage:  filterChainBenchmark [secondsOfAudio]
+
+
+#include "SoundFilterChain.h"
+#include "ReverbSoundFilter.h"
+#include "ConvolutionReverbSoundFilter.h"
+#include "coefficientFilters.h"
+
+#include "minorGems/system/Time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+
+static int sampleRate = 44100;
+
+// typical audio callback size
+static unsigned long callbackSize = 512;
+
+
+
+static void fillTestSound( SoundSamples *inSamples ) {
+    unsigned int seed = 1234;
+    
+    for( unsigned long i=0; i<inSamples->mSampleCount; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        float noise = ( ( seed >> 16 ) & 0x7FFF ) / 32768.0f - 0.5f;
+
+        inSamples->mLeftChannel[i] = 
+            0.3f * sin( i * 0.05 ) + 0.1f * noise;
+        inSamples->mRightChannel[i] = 
+            0.3f * sin( i * 0.031 ) - 0.1f * noise;
+        }
+    }
+
+
+
+// exponentially decaying noise, a typical synthesized room response
+static SoundSamples *makeImpulseResponse( double inSeconds ) {
+    unsigned long length = (unsigned long)( inSeconds * sampleRate );
+    
+    SoundSamples *impulse = new SoundSamples( length );
+
+    unsigned int seed = 99;
+    
+    for( unsigned long i=0; i<length; i++ ) {
+        double decay = exp( -6.0 * i / length );
+        
+        seed = seed * 1103515245 + 12345;
+        impulse->mLeftChannel[i] = 
+            decay * ( ( ( seed >> 16 ) & 0x7FFF ) / 32768.0f - 0.5f ) * 0.05;
+        
+        seed = seed * 1103515245 + 12345;
+        impulse->mRightChannel[i] = 
+            decay * ( ( ( seed >> 16 ) & 0x7FFF ) / 32768.0f - 0.5f ) * 0.05;
+        }
+    return impulse;
+    }
+
+
+
+// old path:  each filter allocates a new copy of each callback's worth
+// of samples
+static double runAllocating( SoundFilter **inFilters, int inNumFilters,
+                             SoundSamples *inSound, SoundSamples *outSound ) {
+    double startTime = Time::getCurrentTime();
+
+    for( unsigned long b=0; b<inSound->mSampleCount; b += callbackSize ) {
+        SoundSamples *block = 
+            new SoundSamples( callbackSize,
+                              &( inSound->mLeftChannel[b] ),
+                              &( inSound->mRightChannel[b] ) );
+        
+        SoundSamples *current = block;
+        
+        for( int f=0; f<inNumFilters; f++ ) {
+            SoundSamples *next = inFilters[f]->filterSamples( current );
+            if( current != block ) {
+                delete current;
+                }
+            current = next;
+            }
+
+        memcpy( &( outSound->mLeftChannel[b] ), current->mLeftChannel,
+                callbackSize * sizeof( float ) );
+        memcpy( &( outSound->mRightChannel[b] ), current->mRightChannel,
+                callbackSize * sizeof( float ) );
+        
+        delete current;
+        
+        // block doesn't own its channels
+        block->mLeftChannel = NULL;
+        block->mRightChannel = NULL;
+        delete block;
+        }
+    
+    return Time::getCurrentTime() - startTime;
+    }
+
+
+
+static double runInPlace( SoundFilterChain *inChain,
+                          SoundSamples *inSound, SoundSamples *outSound ) {
+    memcpy( outSound->mLeftChannel, inSound->mLeftChannel,
+            inSound->mSampleCount * sizeof( float ) );
+    memcpy( outSound->mRightChannel, inSound->mRightChannel,
+            inSound->mSampleCount * sizeof( float ) );
+    
+    double startTime = Time::getCurrentTime();
+
+    for( unsigned long b=0; b<outSound->mSampleCount; b += callbackSize ) {
+        inChain->filterSamplesInPlace( &( outSound->mLeftChannel[b] ),
+                                       &( outSound->mRightChannel[b] ),
+                                       callbackSize );
+        }
+    
+    return Time::getCurrentTime() - startTime;
+    }
+
+
+
+static char samplesMatch( SoundSamples *inA, SoundSamples *inB ) {
+    return 
+        memcmp( inA->mLeftChannel, inB->mLeftChannel,
+                inA->mSampleCount * sizeof( float ) ) == 0
+        &&
+        memcmp( inA->mRightChannel, inB->mRightChannel,
+                inA->mSampleCount * sizeof( float ) ) == 0;
+    }
+
+
+
+static void addReverbs( SoundFilter **outFilters, SoundFilterChain *inChain ) {
+    unsigned long delays[3] = { 1553, 2311, 3907 };
+    
+    for( int i=0; i<3; i++ ) {
+        outFilters[i] = new ReverbSoundFilter( delays[i], 0.4, sampleRate );
+        inChain->addFilter( 
+            new ReverbSoundFilter( delays[i], 0.4, sampleRate ) );
+        }
+    }
+
+
+
+// direct-form convolution of a few samples, to check FFT result
+static double checkConvolution( SoundSamples *inSound, SoundSamples *inImpulse,
+                                SoundSamples *inFiltered, double inWet,
+                                unsigned long inLatency ) {
+    double maxError = 0;
+    
+    for( unsigned long t = inLatency + 1000; 
+         t < inSound->mSampleCount; t += 7919 ) {
+        
+        double sum = 0;
+        unsigned long n = t - inLatency;
+        
+        for( unsigned long k=0; k<inImpulse->mSampleCount && k<=n; k++ ) {
+            sum += inSound->mLeftChannel[ n - k ] * inImpulse->mLeftChannel[k];
+            }
+        double expected = inSound->mLeftChannel[t] + inWet * sum;
+        
+        double error = fabs( expected - inFiltered->mLeftChannel[t] );
+        if( error > maxError ) {
+            maxError = error;
+            }
+        }
+    return maxError;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    double seconds = 60;
+    
+    if( inNumArgs == 2 ) {
+        seconds = atof( inArgs[1] );
+        }
+
+    unsigned long numSamples = 
+        (unsigned long)( seconds * sampleRate / callbackSize ) * callbackSize;
+    seconds = numSamples / (double)sampleRate;
+    
+    SoundSamples sound( numSamples );
+    fillTestSound( &sound );
+
+    SoundSamples allocatingResult( numSamples );
+    SoundSamples inPlaceResult( numSamples );
+
+    printf( "%.1f seconds of stereo audio at %d Hz, %lu-sample callbacks\n"
+            "(speed in seconds of audio per second)\n\n",
+            seconds, sampleRate, callbackSize );
+
+    
+    // single low-pass, per-sample vs block
+    CoeffFilterState stateL = initLowPass( 500, sampleRate, 0.7 );
+    CoeffFilterState stateR = initLowPass( 500, sampleRate, 0.7 );
+    
+    double startTime = Time::getCurrentTime();
+    for( unsigned long i=0; i<numSamples; i++ ) {
+        allocatingResult.mLeftChannel[i] = 
+            coeffFilter( sound.mLeftChannel[i], &stateL );
+        allocatingResult.mRightChannel[i] = 
+            coeffFilter( sound.mRightChannel[i], &stateR );
+        }
+    double time = Time::getCurrentTime() - startTime;
+    printf( "low-pass, per sample:        %9.1fx\n", seconds / time );
+
+    resetCoeffFilter( &stateL );
+    resetCoeffFilter( &stateR );
+    
+    startTime = Time::getCurrentTime();
+    coeffFilterBlockStereo( sound.mLeftChannel, sound.mRightChannel,
+                            inPlaceResult.mLeftChannel, 
+                            inPlaceResult.mRightChannel,
+                            numSamples, &stateL, &stateR );
+    time = Time::getCurrentTime() - startTime;
+    printf( "low-pass, stereo block:      %9.1fx  (%s)\n\n", seconds / time,
+            samplesMatch( &allocatingResult, &inPlaceResult ) ?
+            "identical" : "MISMATCH" );
+    
+    
+    // chain of three comb reverbs
+    SoundFilter *filters[3];
+    SoundFilterChain reverbChain;
+    addReverbs( filters, &reverbChain );
+    
+    time = runAllocating( filters, 3, &sound, &allocatingResult );
+    printf( "3 reverbs, allocating:       %9.1fx\n", seconds / time );
+
+    time = runInPlace( &reverbChain, &sound, &inPlaceResult );
+    printf( "3 reverbs, in-place chain:   %9.1fx  (%s)\n\n", seconds / time,
+            samplesMatch( &allocatingResult, &inPlaceResult ) ?
+            "identical" : "MISMATCH" );
+
+    for( int i=0; i<3; i++ ) {
+        delete filters[i];
+        }
+
+    
+    // convolution reverb at various impulse lengths
+    double impulseLengths[3] = { 0.25, 1.0, 3.0 };
+    
+    for( int i=0; i<3; i++ ) {
+        SoundSamples *impulse = makeImpulseResponse( impulseLengths[i] );
+        
+        SoundFilterChain convolutionChain;
+        ConvolutionReverbSoundFilter *convolution =
+            new ConvolutionReverbSoundFilter( impulse, 0.5, 512 );
+        convolutionChain.addFilter( convolution );
+        
+        time = runInPlace( &convolutionChain, &sound, &inPlaceResult );
+
+        printf( "%.2fs convolution reverb:   %9.1fx  "
+                "(max error vs direct %.2g)\n",
+                impulseLengths[i], seconds / time,
+                checkConvolution( &sound, impulse, &inPlaceResult, 0.5,
+                                  convolution->getLatency() ) );
+        
+        delete impulse;
+        }
+
+    
+    // full chain:  reverbs, then convolution
+    SoundFilterChain fullChain;
+    addReverbs( filters, &fullChain );
+    for( int i=0; i<3; i++ ) {
+        delete filters[i];
+        }
+    SoundSamples *impulse = makeImpulseResponse( 1.0 );
+    fullChain.addFilter( new ConvolutionReverbSoundFilter( impulse, 0.3 ) );
+    delete impulse;
+
+    time = runInPlace( &fullChain, &sound, &inPlaceResult );
+    printf( "\n3 reverbs + 1s convolution:  %9.1fx\n", seconds / time );
+    
+    return 0;
+    }
@@ -0,0 +1,98 @@
+#include "sampleBlocks.h"
+
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+
+
+void addSampleBlock( float *ioDest, float *inSource,
+                     unsigned long inNumSamples ) {
+    unsigned long i = 0;
+
+#ifdef __SSE__
+    for( ; i + 4 <= inNumSamples; i += 4 ) {
+        _mm_storeu_ps( &ioDest[i],
+                       _mm_add_ps( _mm_loadu_ps( &ioDest[i] ),
+                                   _mm_loadu_ps( &inSource[i] ) ) );
+        }
+#endif
+
+    for( ; i<inNumSamples; i++ ) {
+        ioDest[i] += inSource[i];
+        }
+    }
+
+
+
+void addScaledSampleBlock( float *ioDest, float *inSource,
+                           unsigned long inNumSamples, float inGain ) {
+    unsigned long i = 0;
+
+#ifdef __SSE__
+    __m128 gain = _mm_set1_ps( inGain );
+    
+    for( ; i + 4 <= inNumSamples; i += 4 ) {
+        __m128 scaled = _mm_mul_ps( gain, _mm_loadu_ps( &inSource[i] ) );
+        
+        _mm_storeu_ps( &ioDest[i],
+                       _mm_add_ps( _mm_loadu_ps( &ioDest[i] ), scaled ) );
+        }
+#endif
+
+    for( ; i<inNumSamples; i++ ) {
+        ioDest[i] += inGain * inSource[i];
+        }
+    }
+
+
+
+void scaleSampleBlock( float *ioSamples, unsigned long inNumSamples,
+                       float inGain ) {
+    unsigned long i = 0;
+
+#ifdef __SSE__
+    __m128 gain = _mm_set1_ps( inGain );
+    
+    for( ; i + 4 <= inNumSamples; i += 4 ) {
+        _mm_storeu_ps( &ioSamples[i],
+                       _mm_mul_ps( gain, _mm_loadu_ps( &ioSamples[i] ) ) );
+        }
+#endif
+
+    for( ; i<inNumSamples; i++ ) {
+        ioSamples[i] *= inGain;
+        }
+    }
+
+
+
+void complexMultiplyAccumulate( float *ioAccReal, float *ioAccImag,
+                                float *inAReal, float *inAImag,
+                                float *inBReal, float *inBImag,
+                                unsigned long inNumValues ) {
+    unsigned long i = 0;
+
+#ifdef __SSE__
+    for( ; i + 4 <= inNumValues; i += 4 ) {
+        __m128 aR = _mm_loadu_ps( &inAReal[i] );
+        __m128 aI = _mm_loadu_ps( &inAImag[i] );
+        __m128 bR = _mm_loadu_ps( &inBReal[i] );
+        __m128 bI = _mm_loadu_ps( &inBImag[i] );
+
+        __m128 real = _mm_sub_ps( _mm_mul_ps( aR, bR ), _mm_mul_ps( aI, bI ) );
+        __m128 imag = _mm_add_ps( _mm_mul_ps( aR, bI ), _mm_mul_ps( aI, bR ) );
+        
+        _mm_storeu_ps( &ioAccReal[i],
+                       _mm_add_ps( _mm_loadu_ps( &ioAccReal[i] ), real ) );
+        _mm_storeu_ps( &ioAccImag[i],
+                       _mm_add_ps( _mm_loadu_ps( &ioAccImag[i] ), imag ) );
+        }
+#endif
+
+    for( ; i<inNumValues; i++ ) {
+        ioAccReal[i] += inAReal[i] * inBReal[i] - inAImag[i] * inBImag[i];
+        ioAccImag[i] += inAReal[i] * inBImag[i] + inAImag[i] * inBReal[i];
+        }
+    }
@@ -0,0 +1,35 @@
+#ifndef SAMPLE_BLOCKS_INCLUDED
+#define SAMPLE_BLOCKS_INCLUDED
+
+
+// Kernels for in-place processing of blocks of float samples.
+// Use SSE where available, with a plain loop otherwise.
+// Buffers need not be aligned.
+
+
+
+// ioDest[i] += inSource[i]
+void addSampleBlock( float *ioDest, float *inSource,
+                     unsigned long inNumSamples );
+
+
+// ioDest[i] += inGain * inSource[i]
+void addScaledSampleBlock( float *ioDest, float *inSource,
+                           unsigned long inNumSamples, float inGain );
+
+
+// ioSamples[i] *= inGain
+void scaleSampleBlock( float *ioSamples, unsigned long inNumSamples,
+                       float inGain );
+
+
+// complex multiply-accumulate on split real/imaginary arrays:
+// ioAcc[i] += inA[i] * inB[i]
+void complexMultiplyAccumulate( float *ioAccReal, float *ioAccImag,
+                                float *inAReal, float *inAImag,
+                                float *inBReal, float *inBImag,
+                                unsigned long inNumValues );
+
+
+
+#endif
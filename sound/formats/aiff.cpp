@@ -91,7 +91,7 @@ unsigned char *getAIFFHeader( int inNumChannels, int inSampleSizeInBits,
 
     
     
-    unsigned char *returnBuffer = headerStream->getBytes( outHeaderLength );
+    unsigned char *returnBuffer = headerStream->detachBytes( outHeaderLength );
     
     delete headerStream;
 
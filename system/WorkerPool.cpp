@@ -0,0 +1,164 @@
+#include "WorkerPool.h"
+
+
+#ifdef WIN_32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+
+
+int WorkerPool::getNumProcessors() {
+#ifdef WIN_32
+    SYSTEM_INFO info;
+    GetSystemInfo( &info );
+    return (int)info.dwNumberOfProcessors;
+#else
+    long numProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+
+    if( numProcessors < 1 ) {
+        return 1;
+        }
+    return (int)numProcessors;
+#endif
+    }
+
+
+
+WorkerPool::WorkerPool( int inNumThreads )
+        : mTask( NULL ), mNumJobs( 0 ),
+          mNextJobIndex( 0 ), mNumJobsUnfinished( 0 ),
+          mStopping( false ) {
+
+    if( inNumThreads < 0 ) {
+        inNumThreads = getNumProcessors() - 1;
+        }
+
+    // worker 0 is the calling thread
+    for( int i=0; i<inNumThreads; i++ ) {
+        mThreads.push_back( new WorkerPoolThread( this, i + 1 ) );
+        }
+    }
+
+
+
+WorkerPool::~WorkerPool() {
+    mLock.lock();
+    mStopping = true;
+    mLock.unlock();
+
+    // each thread passes this along to the next one as it exits
+    mWorkSignal.signal();
+
+    for( int i=0; i<mThreads.size(); i++ ) {
+        delete mThreads.getElementDirect( i );
+        }
+    }
+
+
+
+int WorkerPool::getNumThreads() {
+    return mThreads.size();
+    }
+
+
+
+void WorkerPool::runJobs( WorkerPoolTask *inTask, int inNumJobs ) {
+
+    if( mThreads.size() == 0 || inNumJobs < 2 ) {
+        for( int i=0; i<inNumJobs; i++ ) {
+            inTask->runJob( i, 0 );
+            }
+        return;
+        }
+
+    mLock.lock();
+    mTask = inTask;
+    mNumJobs = inNumJobs;
+    mNextJobIndex = 0;
+    mNumJobsUnfinished = inNumJobs;
+    mLock.unlock();
+
+    mWorkSignal.signal();
+
+    // help out
+    while( runNextJob( 0 ) ) {
+        }
+
+    mLock.lock();
+    while( mNumJobsUnfinished > 0 ) {
+        mLock.unlock();
+
+        // timeout guards against missed signals
+        mDoneSignal.wait( 100 );
+
+        mLock.lock();
+        }
+
+    mTask = NULL;
+    mNumJobs = 0;
+    mNextJobIndex = 0;
+    mLock.unlock();
+    }
+
+
+
+char WorkerPool::runNextJob( int inWorkerIndex ) {
+    mLock.lock();
+
+    if( mNextJobIndex >= mNumJobs ) {
+        mLock.unlock();
+        return false;
+        }
+
+    int index = mNextJobIndex;
+    mNextJobIndex++;
+
+    WorkerPoolTask *task = mTask;
+
+    char moreLeft = ( mNextJobIndex < mNumJobs );
+    mLock.unlock();
+
+    if( moreLeft ) {
+        // wake another thread to help
+        mWorkSignal.signal();
+        }
+
+    task->runJob( index, inWorkerIndex );
+
+    mLock.lock();
+    mNumJobsUnfinished--;
+    char allDone = ( mNumJobsUnfinished == 0 );
+    mLock.unlock();
+
+    if( allDone ) {
+        mDoneSignal.signal();
+        }
+
+    return true;
+    }
+
+
+
+char WorkerPool::waitForWork() {
+    mLock.lock();
+
+    if( mStopping ) {
+        mLock.unlock();
+
+        // wake next thread so it can exit too
+        mWorkSignal.signal();
+        return false;
+        }
+
+    char workWaiting = ( mNextJobIndex < mNumJobs );
+    mLock.unlock();
+
+    if( ! workWaiting ) {
+        // timeout guards against missed signals
+        mWorkSignal.wait( 100 );
+        }
+
+    return true;
+    }
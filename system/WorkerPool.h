@@ -0,0 +1,172 @@
+#ifndef WORKER_POOL_INCLUDED
+#define WORKER_POOL_INCLUDED
+
+
+#include "minorGems/system/Thread.h"
+#include "minorGems/system/MutexLock.h"
+#include "minorGems/system/BinarySemaphore.h"
+#include "minorGems/util/SimpleVector.h"
+
+
+
+/**
+ * Work that can be split into independent jobs, numbered from 0, for a
+ * WorkerPool to run.
+ *
+ * @author Jason Rohrer
+ */
+class WorkerPoolTask {
+
+    public:
+
+        virtual ~WorkerPoolTask() {
+            }
+
+
+        /**
+         * Runs one job.  Called on several threads at once, each with a
+         * different job.
+         *
+         * @param inJobIndex the job to run.
+         * @param inWorkerIndex the thread running it:  0 for the thread
+         *   that called WorkerPool::runJobs, 1 to
+         *   WorkerPool::getNumThreads() for worker threads.  Never used
+         *   by two threads at once, so it can pick per-thread scratch
+         *   space.
+         */
+        virtual void runJob( int inJobIndex, int inWorkerIndex ) = 0;
+
+    };
+
+
+
+class WorkerPoolThread;
+
+
+
+/**
+ * A fixed set of worker threads that split the jobs of a task between
+ * them, along with the calling thread.
+ *
+ * @author Jason Rohrer
+ */
+class WorkerPool {
+
+    public:
+
+        /**
+         * Constructs a pool.
+         *
+         * @param inNumThreads the number of worker threads to start.  The
+         *   calling thread works too, so 0 runs every job on the calling
+         *   thread.  -1 picks one fewer than the number of processors.
+         *   Defaults to -1.
+         */
+        WorkerPool( int inNumThreads = -1 );
+
+        ~WorkerPool();
+
+
+
+        /**
+         * Gets the number of worker threads, not counting the calling
+         * thread.
+         */
+        int getNumThreads();
+
+
+
+        /**
+         * Runs every job of a task, returning once all are done.
+         *
+         * Not safe to call from several threads at once.
+         *
+         * @param inTask the task.
+         *   Destroyed by caller.
+         * @param inNumJobs the number of jobs.
+         */
+        void runJobs( WorkerPoolTask *inTask, int inNumJobs );
+
+
+
+        /**
+         * Gets the number of processors on this machine.
+         */
+        static int getNumProcessors();
+
+
+
+    protected:
+
+        friend class WorkerPoolThread;
+
+
+        // protects everything below
+        MutexLock mLock;
+
+        // Semaphore is not safe with several waiting threads, so the job
+        // is checked under mLock, and these are only used to wake
+        // sleeping threads
+
+        // signaled when a task is ready, or when stopping
+        BinarySemaphore mWorkSignal;
+
+        // signaled when the last job of a task is done
+        BinarySemaphore mDoneSignal;
+
+        WorkerPoolTask *mTask;
+        int mNumJobs;
+
+        int mNextJobIndex;
+        int mNumJobsUnfinished;
+
+        char mStopping;
+
+        SimpleVector<WorkerPoolThread*> mThreads;
+
+
+
+        // called by worker threads and by runJobs
+        // returns false if there was no job left to take
+        char runNextJob( int inWorkerIndex );
+
+
+        // called by worker threads
+        // returns false once the pool is shutting down
+        char waitForWork();
+
+    };
+
+
+
+class WorkerPoolThread : public Thread {
+
+    public:
+
+        WorkerPoolThread( WorkerPool *inPool, int inWorkerIndex )
+                : mPool( inPool ), mWorkerIndex( inWorkerIndex ) {
+            start();
+            }
+
+        ~WorkerPoolThread() {
+            join();
+            }
+
+        void run() {
+            while( true ) {
+                while( mPool->runNextJob( mWorkerIndex ) ) {
+                    }
+                if( ! mPool->waitForWork() ) {
+                    return;
+                    }
+                }
+            }
+
+    protected:
+        WorkerPool *mPool;
+        int mWorkerIndex;
+    };
+
+
+
+#endif
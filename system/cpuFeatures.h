@@ -0,0 +1,105 @@
+#ifndef CPU_FEATURES_INCLUDED
+#define CPU_FEATURES_INCLUDED
+
+
+
+/**
+ * Vector instruction sets supported by this processor, for code that
+ * picks its kernels at runtime, so the same binary runs on any x86
+ * processor.
+ *
+ * Such code numbers its implementations from 0, for portable code,
+ * upward, and offers a pair of functions:
+ *
+ *   get...Implementation returns the highest implementation this
+ *   processor supports, capped by the limit (see limitImplementation).
+ *
+ *   set...ImplementationLimit caps the implementation used, mostly for
+ *   testing and benchmarking.  Defaults to the highest implementation.
+ *
+ * Kernels are compiled with target attributes, inside
+ * #ifdef CPU_FEATURES_X86, which is defined for GCC-compatible compilers
+ * on x86.
+ */
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define CPU_FEATURES_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+
+
+typedef struct CPUFeatures {
+        char sse2;
+        char ssse3;
+        char sse41;
+        char avx;
+        char avx2;
+        char pclmul;
+        char sha;
+    } CPUFeatures;
+
+
+
+inline CPUFeatures detectCPUFeatures() {
+    CPUFeatures features = { false, false, false, false, false, false,
+                             false };
+
+#ifdef CPU_FEATURES_X86
+    __builtin_cpu_init();
+
+#ifdef __x86_64__
+    // part of every x86-64 processor
+    features.sse2 = true;
+#else
+    features.sse2 = ( __builtin_cpu_supports( "sse2" ) != 0 );
+#endif
+
+    features.ssse3 = ( __builtin_cpu_supports( "ssse3" ) != 0 );
+    features.sse41 = ( __builtin_cpu_supports( "sse4.1" ) != 0 );
+    features.avx = ( __builtin_cpu_supports( "avx" ) != 0 );
+    features.avx2 = ( __builtin_cpu_supports( "avx2" ) != 0 );
+    features.pclmul = ( __builtin_cpu_supports( "pclmul" ) != 0 );
+
+    // no __builtin_cpu_supports name for SHA in older compilers
+    if( __get_cpuid_max( 0, NULL ) >= 7 ) {
+        unsigned int eax, ebx, ecx, edx;
+        __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+
+        features.sha = ( ebx >> 29 ) & 1;
+        }
+#endif
+
+    return features;
+    }
+
+
+
+/**
+ * Gets the features of this processor, detected on the first call.
+ */
+inline const CPUFeatures *getCPUFeatures() {
+    static CPUFeatures features = detectCPUFeatures();
+    return &features;
+    }
+
+
+
+/**
+ * Caps a supported implementation number.
+ *
+ * @param inSupported the highest implementation this processor supports.
+ * @param inLimit the limit set by set...ImplementationLimit.
+ *
+ * @return the implementation to use.
+ */
+inline int limitImplementation( int inSupported, int inLimit ) {
+    if( inSupported < inLimit ) {
+        return inSupported;
+        }
+    return inLimit;
+    }
+
+
+
+#endif
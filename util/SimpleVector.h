@@ -77,6 +77,7 @@
 *                                   makes push_back_other 2x faster.
 */
 
+
 #include "minorGems/common.h"
 
 
@@ -86,6 +87,35 @@
 
 #include <string.h>		// for memory moving functions
 #include <stdio.h>
+#include <stdlib.h>     // for malloc and realloc
+#include <new>          // for placement new
+
+
+// storage is malloced, which the counting new operators don't see
+#ifdef COUNT_ALLOCATIONS
+#include "minorGems/util/development/memory/allocationCounter.h"
+#define SIMPLE_VECTOR_MALLOC countedMalloc
+#define SIMPLE_VECTOR_REALLOC countedRealloc
+#else
+#define SIMPLE_VECTOR_MALLOC malloc
+#define SIMPLE_VECTOR_REALLOC realloc
+#endif
+
+
+// move support and an exact test for trivially copyable types need C++11
+#if __cplusplus >= 201103L
+    #include <utility>
+    #include <type_traits>
+
+    #define SIMPLE_VECTOR_MOVE_SUPPORT
+    #define SIMPLE_VECTOR_MOVE( x ) std::move( x )
+    #define SIMPLE_VECTOR_IS_TRIVIAL( T ) std::is_trivially_copyable< T >::value
+#else
+    #define SIMPLE_VECTOR_MOVE( x ) ( x )
+    // compiler built-in, supported by gcc, clang, and msvc
+    #define SIMPLE_VECTOR_IS_TRIVIAL( T ) __is_pod( T )
+#endif
+
 
 
 const int defaultStartSize = 2;
@@ -101,15 +131,16 @@ class SimpleVector {
         
         // fast methods default to OFF
         // when off, all operations that involve bulk copying are done
-        // with element-by-element assignment, which allows for
+        // with element-by-element copy construction, which allows for
         // copy-constructors to be invoked.
         //
         // if inUseFastMethods is set to true
         // bulk copy operations use memcpy instead, which is much faster
         // but doesn't invoke copy constructors for each element
         //
-        // Note that certain operations automatically use fast methods
-        // for vectors of atomic types (ints, chars, floats)
+        // Note that operations automatically use fast methods
+        // for vectors of trivially copyable types (ints, chars, floats,
+        // pointers, and plain structs)
         void toggleFastMethods( char inUseFastMethods );
         
 
@@ -121,9 +152,24 @@ class SimpleVector {
         SimpleVector & operator = (const SimpleVector &inOther );
         
 
+#ifdef SIMPLE_VECTOR_MOVE_SUPPORT
+        // move constructor, takes inOther's storage and leaves it empty
+        SimpleVector( SimpleVector &&inOther );
+
+        // move assignment operator, leaves inOther empty
+        SimpleVector & operator = ( SimpleVector &&inOther );
+#endif
 
 		
-		void push_back(Type x);		// add x to the end of the vector
+		void push_back(const Type &x);		// add x to the end of the vector
+
+#ifdef SIMPLE_VECTOR_MOVE_SUPPORT
+		void push_back(Type &&x);		// move x to the end of the vector
+
+        // construct a new element in place at the end of the vector
+        template <class... Args>
+        void emplace_back( Args&&... inArgs );
+#endif
 
         // add array of elements to the end of the vector
         // an alias for appendArray
@@ -313,6 +359,8 @@ class SimpleVector {
 
 
 	protected:
+        // raw storage for maxSize elements, only the first
+        // numFilledElements are constructed
 		Type *elements;
 		int numFilledElements;
 		int maxSize;
@@ -325,6 +373,45 @@ class SimpleVector {
         const char *vectorName;
 
 
+        // storage owned by a subclass that holds the first minSize 
+        // elements without a heap allocation, or NULL
+        // (see InlineSimpleVector)
+        Type *inlineElements;
+        
+        
+        // for subclasses that supply inline storage for inInlineSize 
+        // elements
+        SimpleVector( Type *inInlineElements, int inInlineSize );
+        
+
+        // true for types that can be copied with memcpy and need no 
+        // destructor calls
+        static char isTrivial() {
+            return SIMPLE_VECTOR_IS_TRIVIAL( Type );
+            }
+        
+
+        // allocates and frees raw storage, without constructing or
+        // destroying elements
+        Type *allocateStorage( int inNumElements );
+        void freeStorage( Type *inStorage );
+
+        // calls destructors on constructed elements in [inStart, inEnd)
+        void destroyElements( int inStart, int inEnd );
+        
+        // moves inNumElements into uninitialized storage, leaving source
+        // storage uninitialized
+        void relocateElements( Type *inDest, Type *inSource, 
+                               int inNumElements );
+        
+        // copy-constructs inNumElements into uninitialized storage
+        void copyElements( Type *inDest, const Type *inSource, 
+                           int inNumElements );
+
+        // room for one more element, expanding if needed
+        void makeRoomForOne();
+        
+
         // used when implementing appendArray specialzations for simple
         // types that don't need deep, element-by-element copying
         void appendArrayFast( Type *inArray, int inSize );
@@ -335,12 +422,63 @@ class SimpleVector {
 
         void expandToNewMaxSize( int inNewMaxSize );
 		};
+
+
+
+/**
+ * SimpleVector that holds up to inlineSize elements inside the object 
+ * itself, only allocating from the heap if it grows beyond that.
+ *
+ * Useful for short-lived or numerous vectors that usually stay small.
+ */
+template <class Type, int inlineSize>
+class InlineSimpleVector : public SimpleVector<Type> {
+    public:
+        
+        InlineSimpleVector()
+                : SimpleVector<Type>( (Type*)mInlineStorage.bytes, 
+                                      inlineSize ) {
+            }
+
+        
+        InlineSimpleVector( const SimpleVector<Type> &inCopy )
+                : SimpleVector<Type>( (Type*)mInlineStorage.bytes, 
+                                      inlineSize ) {
+            SimpleVector<Type>::operator=( inCopy );
+            }
+
+        
+        InlineSimpleVector( const InlineSimpleVector &inCopy )
+                : SimpleVector<Type>( (Type*)mInlineStorage.bytes, 
+                                      inlineSize ) {
+            SimpleVector<Type>::operator=( inCopy );
+            }
+        
+
+        InlineSimpleVector & operator = ( const InlineSimpleVector &inOther ) {
+            SimpleVector<Type>::operator=( inOther );
+            return *this;
+            }
+
+        
+    protected:
+        
+        // raw bytes, aligned for any element type
+        union {
+                char bytes[ inlineSize * sizeof( Type ) ];
+                double alignDouble;
+                long long alignLong;
+                void *alignPointer;
+            } mInlineStorage;
+    };
+
+
 		
 		
 template <class Type>		
 inline SimpleVector<Type>::SimpleVector()
-		: vectorName( "" ) {
-	elements = new Type[defaultStartSize];
+		: vectorName( "" ), inlineElements( NULL ) {
+	elements = allocateStorage( defaultStartSize );
 	numFilledElements = 0;
 	maxSize = defaultStartSize;
 	minSize = defaultStartSize;
@@ -351,14 +489,14 @@ inline SimpleVector<Type>::SimpleVector()
 
 template <class Type>
 inline SimpleVector<Type>::SimpleVector(int sizeEstimate)
-		: vectorName( "" ) {
+		: vectorName( "" ), inlineElements( NULL ) {
     if( sizeEstimate <= 0 ) {
         // can't double 0 when vector needs to grow, so min size has to
         // be 1
         sizeEstimate = 1;
         }
     
-	elements = new Type[sizeEstimate];
+	elements = allocateStorage( sizeEstimate );
 	numFilledElements = 0;
 	maxSize = sizeEstimate;
 	minSize = sizeEstimate;
@@ -366,39 +504,123 @@ inline SimpleVector<Type>::SimpleVector(int sizeEstimate)
 
     printExpansionMessage = false;
     }
+
+
+
+template <class Type>
+inline SimpleVector<Type>::SimpleVector( Type *inInlineElements, 
+                                        int inInlineSize )
+		: elements( inInlineElements ), numFilledElements( 0 ),
+          maxSize( inInlineSize ), minSize( inInlineSize ),
+          useFastMethods( false ), printExpansionMessage( false ),
+          vectorName( "" ), inlineElements( inInlineElements ) {
+    }
+
 	
 template <class Type>	
 inline SimpleVector<Type>::~SimpleVector() {
-	delete [] elements;
+    destroyElements( 0, numFilledElements );
+	freeStorage( elements );
 	}	
 
 
 
-// copy constructor
 template <class Type>
-inline SimpleVector<Type>::SimpleVector( const SimpleVector<Type> &inCopy )
-        : elements( new Type[ inCopy.maxSize ] ),
-          numFilledElements( inCopy.numFilledElements ),
-          maxSize( inCopy.maxSize ), minSize( inCopy.minSize ),
-          useFastMethods( inCopy.useFastMethods ),
-          printExpansionMessage( inCopy.printExpansionMessage ),
-          vectorName( inCopy.vectorName ) {
+inline Type *SimpleVector<Type>::allocateStorage( int inNumElements ) {
+    Type *storage = 
+        (Type*)SIMPLE_VECTOR_MALLOC( inNumElements * sizeof( Type ) );
+    
+    if( storage == NULL ) {
+        throw std::bad_alloc();
+        }
+    return storage;
+    }
+
+
+
+template <class Type>
+inline void SimpleVector<Type>::freeStorage( Type *inStorage ) {
+    if( inStorage != inlineElements ) {
+        free( inStorage );
+        }
+    }
+
+
+
+template <class Type>
+inline void SimpleVector<Type>::destroyElements( int inStart, int inEnd ) {
+    if( ! isTrivial() ) {
+        for( int i=inStart; i<inEnd; i++ ) {
+            elements[i].~Type();
+            }
+        }
+    }
+
+
+
+template <class Type>
+inline void SimpleVector<Type>::relocateElements( Type *inDest, 
+                                                  Type *inSource,
+                                                  int inNumElements ) {
+    if( inNumElements <= 0 ) {
+        return;
+        }
     
+    if( isTrivial() || useFastMethods ) {
+        // a bitwise move is fine for fast-method vectors too, since
+        // the source elements are never destroyed
+        memcpy( (void*)inDest, (void*)inSource, 
+                inNumElements * sizeof( Type ) );
+        }
+    else {
+        for( int i=0; i<inNumElements; i++ ) {
+            new( &( inDest[i] ) ) Type( SIMPLE_VECTOR_MOVE( inSource[i] ) );
+            inSource[i].~Type();
+            }
+        }
+    }
+
 
 
-    if( useFastMethods ) {
+template <class Type>
+inline void SimpleVector<Type>::copyElements( Type *inDest, 
+                                              const Type *inSource,
+                                              int inNumElements ) {
+    if( inNumElements <= 0 ) {
+        return;
+        }
+    
+    if( isTrivial() || useFastMethods ) {
+        // for non-trivial types with useFastMethods on,
         // if these objects contain pointers to stack, etc, this is not 
         // going to work (not a deep copy)
         // because it won't invoke the copy constructors of the objects!
-        memcpy( elements, inCopy.elements, sizeof( Type ) * numFilledElements );
+        memcpy( (void*)inDest, (const void*)inSource, 
+                inNumElements * sizeof( Type ) );
         }
-    else {    
-        for( int i=0; i<inCopy.numFilledElements; i++ ) {
-            elements[i] = inCopy.elements[i];
+    else {
+        for( int i=0; i<inNumElements; i++ ) {
+            new( &( inDest[i] ) ) Type( inSource[i] );
             }
         }
-    
+    }
 
+
+
+// copy constructor
+template <class Type>
+inline SimpleVector<Type>::SimpleVector( const SimpleVector<Type> &inCopy )
+        : elements( NULL ),
+          numFilledElements( inCopy.numFilledElements ),
+          maxSize( inCopy.maxSize ), minSize( inCopy.minSize ),
+          useFastMethods( inCopy.useFastMethods ),
+          printExpansionMessage( inCopy.printExpansionMessage ),
+          vectorName( inCopy.vectorName ),
+          inlineElements( NULL ) {
+    
+    elements = allocateStorage( maxSize );
+    
+    copyElements( elements, inCopy.elements, numFilledElements );
     }
 
 
@@ -408,42 +630,132 @@ template <class Type>
 inline SimpleVector<Type> & SimpleVector<Type>::operator = (
     const SimpleVector<Type> &inOther ) {
     
-    // pattern found on wikipedia:
-
     // avoid self-assignment
     if( this != &inOther )  {
         
-        // 1: allocate new memory and copy the elements
-        Type *newElements = new Type[ inOther.maxSize ];
-
-        if( useFastMethods ) {
-            // again, memcpy  doesn't invoke
-            // copy constructor on contained object
-            memcpy( newElements, inOther.elements, 
-                    sizeof( Type ) * inOther.numFilledElements );
+        destroyElements( 0, numFilledElements );
+        numFilledElements = 0;
+
+        if( inOther.numFilledElements > maxSize ||
+            ( inlineElements == NULL && maxSize != inOther.maxSize ) ) {
+            // match other's capacity, as long as it fits other's elements
+            // vectors with inline storage keep it when other fits there
+            int newMaxSize = inOther.maxSize;
+            
+            freeStorage( elements );
+            elements = allocateStorage( newMaxSize );
+            maxSize = newMaxSize;
             }
-        else {    
-            for( int i=0; i<inOther.numFilledElements; i++ ) {
-                newElements[i] = inOther.elements[i];
-                }
+        
+        if( inlineElements == NULL ) {
+            minSize = inOther.minSize;
             }
         
+        copyElements( elements, inOther.elements, 
+                      inOther.numFilledElements );
+        
+        numFilledElements = inOther.numFilledElements;
+        }
+
+    // by convention, always return *this
+    return *this;
+    }
 
 
-        // 2: deallocate old memory
-        delete [] elements;
- 
-        // 3: assign the new memory to the object
-        elements = newElements;
+
+#ifdef SIMPLE_VECTOR_MOVE_SUPPORT
+
+template <class Type>
+inline SimpleVector<Type>::SimpleVector( SimpleVector<Type> &&inOther )
+        : elements( NULL ),
+          numFilledElements( 0 ),
+          maxSize( defaultStartSize ), minSize( defaultStartSize ),
+          useFastMethods( inOther.useFastMethods ),
+          printExpansionMessage( inOther.printExpansionMessage ),
+          vectorName( inOther.vectorName ),
+          inlineElements( NULL ) {
+    
+    if( inOther.elements != inOther.inlineElements ) {
+        // steal heap storage, give other a fresh minimal one
+        elements = inOther.elements;
         numFilledElements = inOther.numFilledElements;
         maxSize = inOther.maxSize;
         minSize = inOther.minSize;
+        
+        if( inOther.inlineElements != NULL ) {
+            inOther.elements = inOther.inlineElements;
+            }
+        else {
+            inOther.elements = inOther.allocateStorage( inOther.minSize );
+            }
+        inOther.maxSize = inOther.minSize;
+        inOther.numFilledElements = 0;
+        }
+    else {
+        // other's elements live inside it, move them one by one
+        minSize = inOther.minSize;
+        maxSize = inOther.maxSize;
+        
+        elements = allocateStorage( maxSize );
+        
+        relocateElements( elements, inOther.elements, 
+                          inOther.numFilledElements );
+        numFilledElements = inOther.numFilledElements;
+        inOther.numFilledElements = 0;
         }
+    }
 
-    // by convention, always return *this
+
+
+template <class Type>
+inline SimpleVector<Type> & SimpleVector<Type>::operator = (
+    SimpleVector<Type> &&inOther ) {
+    
+    if( this == &inOther )  {
+        return *this;
+        }
+
+    destroyElements( 0, numFilledElements );
+    numFilledElements = 0;
+    
+    if( inOther.elements != inOther.inlineElements ) {
+        // steal heap storage
+        freeStorage( elements );
+        
+        elements = inOther.elements;
+        numFilledElements = inOther.numFilledElements;
+        maxSize = inOther.maxSize;
+        
+        if( inlineElements == NULL ) {
+            minSize = inOther.minSize;
+            }
+        
+        if( inOther.inlineElements != NULL ) {
+            inOther.elements = inOther.inlineElements;
+            }
+        else {
+            inOther.elements = inOther.allocateStorage( inOther.minSize );
+            }
+        inOther.maxSize = inOther.minSize;
+        inOther.numFilledElements = 0;
+        }
+    else {
+        if( inOther.numFilledElements > maxSize ) {
+            freeStorage( elements );
+            elements = allocateStorage( inOther.maxSize );
+            maxSize = inOther.maxSize;
+            }
+        
+        relocateElements( elements, inOther.elements, 
+                          inOther.numFilledElements );
+        numFilledElements = inOther.numFilledElements;
+        inOther.numFilledElements = 0;
+        }
+    
     return *this;
     }
 
+#endif
 
 
 
@@ -492,34 +804,23 @@ inline Type SimpleVector<Type>::getElementDirectFast(int index) {
 
 template <class Type>
 inline bool SimpleVector<Type>::deleteElement(int index) {
-	if( index < numFilledElements) {	// if index valid for this vector
-		
-		if( index != numFilledElements - 1)  {	
-            // this spot somewhere in middle
+	if( index < numFilledElements && index >= 0 ) {
+        // if index valid for this vector
 		
-            
-
+		if( isTrivial() ) {
+            // move memory towards front by one spot
+            // nothing needs destroying
+            memmove( (void *)&( elements[index] ), 
+                     (void *)&( elements[index+1] ), 
+                     sizeof( Type ) * ( numFilledElements - ( index + 1 ) ) );
+            }
+        else {
             // memmove NOT okay here, because it leaves shallow copies
-            // behind that cause errors when the whole element array is 
-            // destroyed.
-
-            /*
-			// move memory towards front by one spot
-			int sizeOfElement = sizeof(Type);
-		
-			int numBytesToMove = sizeOfElement*(numFilledElements - (index+1));
-		
-			Type *destPtr = &(elements[index]);
-			Type *srcPtr = &(elements[index+1]);
-		
-			memmove( (void *)destPtr, (void *)srcPtr, 
-                    (unsigned int)numBytesToMove);
-            */
-
-
+            // behind that cause errors when the last one is destroyed
             for( int i=index+1; i<numFilledElements; i++ ) {
-                elements[i - 1] = elements[i];
+                elements[i - 1] = SIMPLE_VECTOR_MOVE( elements[i] );
                 }
+            elements[ numFilledElements - 1 ].~Type();
 			}
 			
 		numFilledElements--;	// one less element in vector
@@ -536,16 +837,17 @@ template <class Type>
 inline bool SimpleVector<Type>::deleteStartElements( int inNumToDelete ) {
 	if( inNumToDelete <= numFilledElements) {
 		
-		if( inNumToDelete != numFilledElements)  {	
-            
-
-            // memmove NOT okay here, because it leaves shallow copies
-            // behind that cause errors when the whole element array is 
-            // destroyed.
-
+		if( isTrivial() ) {
+            memmove( (void *)elements, (void *)&( elements[inNumToDelete] ),
+                     sizeof( Type ) * ( numFilledElements - inNumToDelete ) );
+            }
+        else {
             for( int i=inNumToDelete; i<numFilledElements; i++ ) {
-                elements[i - inNumToDelete] = elements[i];
+                elements[i - inNumToDelete] = 
+                    SIMPLE_VECTOR_MOVE( elements[i] );
                 }
+            destroyElements( numFilledElements - inNumToDelete, 
+                             numFilledElements );
 			}
 			
 		numFilledElements -= inNumToDelete;
@@ -558,53 +860,6 @@ inline bool SimpleVector<Type>::deleteStartElements( int inNumToDelete ) {
 
 
 
-// special case implementation
-// we do this A LOT for unsigned char vectors
-// and we can use the more efficient memmove for unsigned chars
-template <>
-inline bool SimpleVector<unsigned char>::deleteStartElements( 
-    int inNumToDelete ) {
-	
-    if( inNumToDelete <= numFilledElements) {
-		
-		if( inNumToDelete != numFilledElements)  {
-
-            memmove( elements, &( elements[inNumToDelete] ),
-                     numFilledElements - inNumToDelete );
-            }
-			
-		numFilledElements -= inNumToDelete;
-		return true;
-		}
-	else {				// not enough elements in vector
-		return false;
-		}
-	}
-
-
-// same for signed char vectors
-template <>
-inline bool SimpleVector<char>::deleteStartElements( 
-    int inNumToDelete ) {
-	
-    if( inNumToDelete <= numFilledElements) {
-		
-		if( inNumToDelete != numFilledElements)  {
-
-            memmove( elements, &( elements[inNumToDelete] ),
-                     numFilledElements - inNumToDelete );
-            }
-			
-		numFilledElements -= inNumToDelete;
-		return true;
-		}
-	else {				// not enough elements in vector
-		return false;
-		}
-	}
-
-
-
 
 template <class Type>
 inline bool SimpleVector<Type>::deleteElementEqualTo( Type inElement ) {
@@ -621,7 +876,10 @@ inline bool SimpleVector<Type>::deleteElementEqualTo( Type inElement ) {
 
 template <class Type>
 inline void SimpleVector<Type>::shrink( int inNewSize ) {
-    numFilledElements = inNewSize;
+    if( inNewSize < numFilledElements ) {
+        destroyElements( inNewSize, numFilledElements );
+        numFilledElements = inNewSize;
+        }
     }
 
 
@@ -633,9 +891,9 @@ inline void SimpleVector<Type>::swap( int inA, int inB ) {
     
     if( inA < numFilledElements && inA >= 0 &&
         inB < numFilledElements && inB >= 0 ) {
-        Type temp = elements[ inA ];
-        elements[ inA ] = elements[ inB ];
-        elements[ inB ] = temp;
+        Type temp = SIMPLE_VECTOR_MOVE( elements[ inA ] );
+        elements[ inA ] = SIMPLE_VECTOR_MOVE( elements[ inB ] );
+        elements[ inB ] = SIMPLE_VECTOR_MOVE( temp );
         }
     }
 
@@ -659,32 +917,99 @@ inline int SimpleVector<Type>::getElementIndex( Type inElement ) {
 
 template <class Type>
 inline void SimpleVector<Type>::deleteAll() {
+    destroyElements( 0, numFilledElements );
 	numFilledElements = 0;
 	if( maxSize > minSize ) {		// free memory if vector has grown
-		delete [] elements;
-		elements = new Type[minSize];	// reallocate an empty vector
+		freeStorage( elements );
+        
+        if( inlineElements != NULL ) {
+            elements = inlineElements;
+            }
+        else {
+            elements = allocateStorage( minSize ); // reallocate an empty one
+            }
 		maxSize = minSize;
 		}
 	}
 
 
+
+template <class Type>
+inline void SimpleVector<Type>::makeRoomForOne() {
+	if( numFilledElements == maxSize ) {
+        // need to allocate more space for vector
+		int newMaxSize = maxSize << 1;		// double size
+        
+        expandToNewMaxSize( newMaxSize );
+		}
+    }
+
+
+
 template <class Type>
-inline void SimpleVector<Type>::push_back(Type x)	{
+inline void SimpleVector<Type>::push_back(const Type &x)	{
 	if( numFilledElements < maxSize) {	// still room in vector
-		elements[numFilledElements] = x;
+		new( &( elements[numFilledElements] ) ) Type( x );
 		numFilledElements++;
 		}
-	else {					// need to allocate more space for vector
+	else {
+        // x might be one of our elements, which expansion moves, so
+        // copy it first
+        Type copy( x );
+        
+        makeRoomForOne();
+        
+		new( &( elements[numFilledElements] ) ) 
+            Type( SIMPLE_VECTOR_MOVE( copy ) );
+		numFilledElements++;	
+		}
+	}
 
-		int newMaxSize = maxSize << 1;		// double size
+
+
+#ifdef SIMPLE_VECTOR_MOVE_SUPPORT
+
+template <class Type>
+inline void SimpleVector<Type>::push_back(Type &&x)	{
+	if( numFilledElements < maxSize) {	// still room in vector
+		new( &( elements[numFilledElements] ) ) Type( std::move( x ) );
+		numFilledElements++;
+		}
+	else {
+        Type temp( std::move( x ) );
         
-        expandToNewMaxSize( newMaxSize );
+        makeRoomForOne();
+        
+		new( &( elements[numFilledElements] ) ) Type( std::move( temp ) );
+		numFilledElements++;	
+		}
+	}
+
+
+
+template <class Type>
+template <class... Args>
+inline void SimpleVector<Type>::emplace_back( Args&&... inArgs ) {
+	if( numFilledElements < maxSize) {	// still room in vector
+		new( &( elements[numFilledElements] ) ) 
+            Type( std::forward<Args>( inArgs )... );
+		numFilledElements++;
+		}
+	else {
+        // arguments might refer to our elements, construct before 
+        // expansion moves them
+        Type temp( std::forward<Args>( inArgs )... );
         
-		elements[numFilledElements] = x;
+        makeRoomForOne();
+        
+		new( &( elements[numFilledElements] ) ) Type( std::move( temp ) );
 		numFilledElements++;	
 		}
 	}
 
+#endif
+
+
 
 template <class Type>
 inline void SimpleVector<Type>::push_front(Type x)	{
@@ -696,16 +1021,29 @@ inline void SimpleVector<Type>::push_front(Type x)	{
 template <class Type>
 inline void SimpleVector<Type>::push_middle( Type x, int inNumBefore )	{
 
+    if( isTrivial() ) {
+        makeRoomForOne();
+        
+        memmove( (void *)&( elements[inNumBefore + 1] ),
+                 (void *)&( elements[inNumBefore] ),
+                 sizeof( Type ) * ( numFilledElements - inNumBefore ) );
+        
+        new( &( elements[inNumBefore] ) ) Type( x );
+        numFilledElements++;
+        return;
+        }
+    
+
     // first push_back to reuse expansion code
     push_back( x );
     
     // now shift all of the "after" elements forward
     for( int i=numFilledElements-2; i>=inNumBefore; i-- ) {
-        elements[i+1] = elements[i];
+        elements[i+1] = SIMPLE_VECTOR_MOVE( elements[i] );
         }
     
     // finally, re-insert in middle spot
-    elements[inNumBefore] = x;
+    elements[inNumBefore] = SIMPLE_VECTOR_MOVE( x );
     }
 
 
@@ -725,32 +1063,29 @@ inline void SimpleVector<Type>::expandToNewMaxSize( int inNewMaxSize ) {
                 " max elements\n", vectorName, maxSize, newMaxSize );
         }
     
-
-    // NOTE:  memcpy does not work here, because it does not invoke
-    // copy constructors on elements.
-    // And then "delete []" below causes destructors to be invoked
-    //  on old elements, which are shallow copies of new objects.
-    
-    Type *newAlloc = new Type[newMaxSize];
-    /*
-      unsigned int sizeOfElement = sizeof(Type);
-      unsigned int numBytesToMove = sizeOfElement*(numFilledElements);
-      
-      
-      // move into new space
-      memcpy((void *)newAlloc, (void *) elements, numBytesToMove);
-    */
-
-    // must use element-by-element assignment to invoke constructors
-    for( int i=0; i<numFilledElements; i++ ) {
-        newAlloc[i] = elements[i];
+    if( isTrivial() && elements != inlineElements ) {
+        // realloc can often grow in place, and copies bits otherwise
+        Type *newAlloc = 
+            (Type*)SIMPLE_VECTOR_REALLOC( (void*)elements, 
+                                          newMaxSize * sizeof( Type ) );
+        
+        if( newAlloc == NULL ) {
+            throw std::bad_alloc();
+            }
+        elements = newAlloc;
+        }
+    else {
+        Type *newAlloc = allocateStorage( newMaxSize );
+        
+        // elements are moved, not copied, and old space is never
+        // destroyed, only freed
+        relocateElements( newAlloc, elements, numFilledElements );
+        
+        freeStorage( elements );
+        
+        elements = newAlloc;
         }
     
-
-    // delete old space
-    delete [] elements;
-	
-    elements = newAlloc;
     maxSize = newMaxSize;    
     }
 
@@ -779,38 +1114,25 @@ inline void SimpleVector<Type>::push_back_other(
     
     // we have room in vector
     
-    if( useFastMethods ) {
-        
-        memcpy( &( elements[numFilledElements] ),
-                inOtherVector->elements, 
-                inOtherVector->numFilledElements * sizeof( Type ) );
-        
-        numFilledElements += inOtherVector->numFilledElements;
-        }
-    else {
-        // slow method, with element-by-element assignment
-        // so that copy constructors can be deployed
-        for( int i=0; i<inOtherVector->size(); i++ ) {
-            push_back( inOtherVector->getElementDirect( i ) );
-            }
-        }
+    // copyElements uses memcpy for trivial types or if useFastMethods set
+    copyElements( &( elements[numFilledElements] ),
+                  inOtherVector->elements, 
+                  inOtherVector->numFilledElements );
+    
+    numFilledElements += inOtherVector->numFilledElements;
     }
 
 
 
 template <class Type>
 inline Type *SimpleVector<Type>::getElementArray() {
+    if( isTrivial() ) {
+        return getElementArrayFast();
+        }
+    
     Type *newAlloc = new Type[ numFilledElements ];
 
     // shallow copy not good enough!
-    /*
-    unsigned int sizeOfElement = sizeof( Type );
-    unsigned int numBytesToCopy = sizeOfElement * numFilledElements;
-    
-    // copy into new space
-    //memcpy( (void *)newAlloc, (void *)elements, numBytesToCopy );
-    */
-
     // use assignment to ensure that constructors are invoked on element copies
     for( int i=0; i<numFilledElements; i++ ) {
         newAlloc[i] = elements[i];
@@ -826,7 +1148,8 @@ template <class Type>
 inline Type *SimpleVector<Type>::getElementArrayFast() {
     Type *newAlloc = new Type[ numFilledElements ];
 
-    memcpy( newAlloc, elements, numFilledElements * sizeof( Type ) );
+    memcpy( (void*)newAlloc, (void*)elements, 
+            numFilledElements * sizeof( Type ) );
     
     return newAlloc;
     }
@@ -895,7 +1218,7 @@ inline char *SimpleVector<char>::getElementString() {
 
 template <class Type>
 inline void SimpleVector<Type>::appendArray( Type *inArray, int inSize ) {
-    if( useFastMethods ) {
+    if( useFastMethods || isTrivial() ) {
         appendArrayFast( inArray, inSize );
         }
     else {
@@ -915,7 +1238,8 @@ inline void SimpleVector<Type>::appendArray( Type *inArray, int inSize ) {
 template <class Type>
 inline void SimpleVector<Type>::appendArrayFast( Type *inArray, int inSize ) {
     // this implementation expands storage in one step and uses
-    // memcpy to insert.  Also uses memcpy to expand vector when needed.
+    // memcpy to insert.  Also uses memcpy (or realloc) to expand vector when
+    // needed.
     
     // this only works on simple types that don't need to have copy constructors
     // invoked.
@@ -929,32 +1253,14 @@ inline void SimpleVector<Type>::appendArrayFast( Type *inArray, int inSize ) {
             newMaxSize *= 2;
             }
         
-        if( printExpansionMessage ) {
-            printf( "SimpleVector \"%s\" is expanding itself from %d to %d"
-                    " max elements\n", vectorName, maxSize, newMaxSize );
-            }
-
-
-        // use memcpy for fast copy into new space
-        Type *newAlloc = new Type[newMaxSize];
-
-        memcpy( newAlloc, 
-                elements, 
-                numFilledElements * sizeof( Type ) );
-        
-        
-        // delete old space
-        delete [] elements;
-        
-        elements = newAlloc;
-        maxSize = newMaxSize;
+        expandToNewMaxSize( newMaxSize );
         }
 
 
     // we have room in vector
     
-    memcpy( &( elements[numFilledElements] ),
-            inArray, 
+    memcpy( (void*)&( elements[numFilledElements] ),
+            (void*)inArray, 
             inSize * sizeof( Type ) );
     
     numFilledElements += inSize;
@@ -1035,6 +1341,8 @@ inline void SimpleVector<Type>::toggleFastMethods( char inUseFastMethods ) {
 
 
 
+
+
 template <>
 inline char SimpleVector<char*>::deallocateStringElement( int inIndex ) {
     if( inIndex < numFilledElements ) {
@@ -12,31 +12,91 @@
 
 #include "minorGems/util/StringBufferOutputStream.h"
 
+#include <string.h>
+
+
+
+// size of first chunk, chunks double after this, up to the max size
+#define FIRST_CHUNK_SIZE 256
+#define MAX_CHUNK_SIZE 1048576
+
 
 
 StringBufferOutputStream::StringBufferOutputStream()
-    : mCharacterVector( new SimpleVector<unsigned char>() ) {
+        : mLastChunk( NULL ), mLastChunkLength( 0 ),
+          mLastChunkCapacity( 0 ), mNumBytes( 0 ) {
 
     }
 
 
 
 StringBufferOutputStream::~StringBufferOutputStream() {
+    clear();
+    }
 
-    delete mCharacterVector;
+
+
+void StringBufferOutputStream::clear() {
+    for( int i=0; i<mChunks.size(); i++ ) {
+        delete [] mChunks.getElementDirect( i );
+        }
+    mChunks.deleteAll();
+    mChunkLengths.deleteAll();
+    
+    mLastChunk = NULL;
+    mLastChunkLength = 0;
+    mLastChunkCapacity = 0;
+    mNumBytes = 0;
     }
 
 
 
-char *StringBufferOutputStream::getString() {
+int StringBufferOutputStream::getChunkLength( int inIndex ) {
+    if( inIndex == mChunks.size() - 1 ) {
+        return mLastChunkLength;
+        }
+    return mChunkLengths.getElementDirect( inIndex );
+    }
+
 
-    int numChars = mCharacterVector->size();
 
-    char *returnArray = new char[ numChars + 1 ];
+unsigned char *StringBufferOutputStream::gatherBytes( char inDetach ) {
+    
+    if( inDetach && mChunks.size() == 1 ) {
+        unsigned char *onlyChunk = mLastChunk;
+        
+        // don't free it
+        mChunks.deleteAll();
+        clear();
+
+        return onlyChunk;
+        }
+    
+
+    unsigned char *returnArray = new unsigned char[ mNumBytes + 1 ];
 
-    for( int i=0; i<numChars; i++ ) {
-        returnArray[i] = (char)( *( mCharacterVector->getElement( i ) ) );
+    int position = 0;
+    for( int i=0; i<mChunks.size(); i++ ) {
+        int length = getChunkLength( i );
+        
+        memcpy( &( returnArray[ position ] ), 
+                mChunks.getElementDirect( i ), length );
+        position += length;
         }
+
+    if( inDetach ) {
+        clear();
+        }
+    
+    return returnArray;
+    }
+
+
+
+char *StringBufferOutputStream::getString() {
+    int numChars = mNumBytes;
+    
+    char *returnArray = (char *)gatherBytes( false );
     returnArray[ numChars ] = '\0';
 
     return returnArray;
@@ -45,9 +105,58 @@ char *StringBufferOutputStream::getString() {
 
 
 unsigned char *StringBufferOutputStream::getBytes( int *outNumBytes ) {
-    *outNumBytes = mCharacterVector->size();
+    *outNumBytes = mNumBytes;
 
-    return mCharacterVector->getElementArray();
+    return gatherBytes( false );
+    }
+
+
+
+char *StringBufferOutputStream::detachString() {
+    int numChars = mNumBytes;
+
+    char *returnArray = (char *)gatherBytes( true );
+    returnArray[ numChars ] = '\0';
+
+    return returnArray;
+    }
+
+
+
+unsigned char *StringBufferOutputStream::detachBytes( int *outNumBytes ) {
+    *outNumBytes = mNumBytes;
+
+    return gatherBytes( true );
+    }
+
+
+
+int StringBufferOutputStream::getNumBytes() {
+    return mNumBytes;
+    }
+
+
+
+int StringBufferOutputStream::getNumChunks() {
+    return mChunks.size();
+    }
+
+
+
+int StringBufferOutputStream::getChunks( unsigned char **outChunks, 
+                                         int *outNumBytes,
+                                         int inMaxChunks ) {
+    int numChunks = mChunks.size();
+    
+    if( numChunks > inMaxChunks ) {
+        numChunks = inMaxChunks;
+        }
+    
+    for( int i=0; i<numChunks; i++ ) {
+        outChunks[i] = mChunks.getElementDirect( i );
+        outNumBytes[i] = getChunkLength( i );
+        }
+    return numChunks;
     }
 
 
@@ -55,10 +164,51 @@ unsigned char *StringBufferOutputStream::getBytes( int *outNumBytes ) {
 long StringBufferOutputStream::write( unsigned char *inBuffer,
                                       long inNumBytes ) {
 
-    for( int i=0; i<inNumBytes; i++ ) {
-        mCharacterVector->push_back( inBuffer[ i ] );
+    long numLeft = inNumBytes;
+    
+    // fill whatever room is left in last chunk
+    long numToCopy = mLastChunkCapacity - mLastChunkLength;
+    
+    if( numToCopy > numLeft ) {
+        numToCopy = numLeft;
+        }
+    
+    if( numToCopy > 0 ) {
+        memcpy( &( mLastChunk[ mLastChunkLength ] ), inBuffer, numToCopy );
+        
+        mLastChunkLength += numToCopy;
+        inBuffer += numToCopy;
+        numLeft -= numToCopy;
+        }
+    
+
+    if( numLeft > 0 ) {
+        // start a new chunk, big enough for the rest of this write
+        int capacity = FIRST_CHUNK_SIZE;
+        
+        if( mLastChunk != NULL ) {
+            mChunkLengths.push_back( mLastChunkLength );
+
+            capacity = mLastChunkCapacity * 2;
+            
+            if( capacity > MAX_CHUNK_SIZE ) {
+                capacity = MAX_CHUNK_SIZE;
+                }
+            }
+        if( capacity < numLeft ) {
+            capacity = numLeft;
+            }
+        
+        mLastChunk = new unsigned char[ capacity + 1 ];
+        
+        memcpy( mLastChunk, inBuffer, numLeft );
+        
+        mChunks.push_back( mLastChunk );
+        mLastChunkLength = numLeft;
+        mLastChunkCapacity = capacity;
         }
+
+    mNumBytes += inNumBytes;
     
     return inNumBytes;
     }
-
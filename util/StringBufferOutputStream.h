@@ -25,6 +25,9 @@
 /**
  * An output stream that fills a string buffer.
  *
+ * Data is kept in a list of chunks that grow geometrically, so writes
+ * never move data already written.  Each write is a bulk copy.
+ *
  * @author Jason Rohrer
  */ 
 class StringBufferOutputStream : public OutputStream {
@@ -65,6 +68,66 @@ class StringBufferOutputStream : public OutputStream {
         unsigned char *getBytes( int *outNumBytes );
 
 
+
+        /**
+         * Same as getString, but hands over this stream's buffer instead
+         * of copying it when all data is in one chunk, and leaves this
+         * stream empty.
+         *
+         * @return a string containing all data written to this stream.
+         *   Must be destroyed by caller.
+         */
+        char *detachString();
+        
+        
+        
+        /**
+         * Same as getBytes, but hands over this stream's buffer instead
+         * of copying it when all data is in one chunk, and leaves this
+         * stream empty.
+         *
+         * @param outNumBytes pointer to where the array length should be
+         *   returned.
+         *
+         * @return an array containing data written to this stream.
+         *   Must be destroyed by caller.
+         */
+        unsigned char *detachBytes( int *outNumBytes );
+
+
+        
+        /**
+         * Gets the number of bytes written to this stream so far.
+         */
+        int getNumBytes();
+        
+
+        
+        /**
+         * Gets the number of chunks that hold this stream's data.
+         */
+        int getNumChunks();
+        
+
+        
+        /**
+         * Gets pointers to the chunks that hold this stream's data, in
+         * order, without copying them.
+         *
+         * The results can be passed directly to Socket::sendGather.
+         *
+         * @param outChunks array where chunk pointers should be returned.
+         *   Pointers remain owned by this stream and are valid until
+         *   the next write or detach.
+         * @param outNumBytes array where chunk lengths should be returned.
+         * @param inMaxChunks the size of the two arrays.
+         *
+         * @return the number of chunks returned, at most inMaxChunks.
+         */
+        int getChunks( unsigned char **outChunks, int *outNumBytes,
+                       int inMaxChunks );
+        
+
         
 		// implements the OutputStream interface
 		long write( unsigned char *inBuffer, long inNumBytes );
@@ -75,9 +138,31 @@ class StringBufferOutputStream : public OutputStream {
 
 
         
-        SimpleVector<unsigned char> *mCharacterVector;
+        // each chunk is allocated with one spare byte at the end, so
+        // that a single chunk can be handed out as a string without copying
+        SimpleVector<unsigned char *> mChunks;
+        
+        // lengths of all chunks except the last one
+        SimpleVector<int> mChunkLengths;
 
+        // chunk being filled, or NULL if none yet
+        unsigned char *mLastChunk;
+        int mLastChunkLength;
+        
+        // bytes allocated for last chunk, not counting spare byte
+        int mLastChunkCapacity;
 
+        int mNumBytes;
+        
+        
+        // copies all chunks into one new array with room for a 
+        // trailing \0, or hands over the only chunk if inDetach is true
+        unsigned char *gatherBytes( char inDetach );
+        
+        // frees chunks, leaving stream empty
+        void clear();
+        
+        int getChunkLength( int inIndex );
         
 	};		
 	
@@ -41,6 +41,11 @@
  */
 
 
+#include "crc32.h"
+
+#include "minorGems/system/cpuFeatures.h"
+
+
 
 static unsigned int crc32Table[] = {
 	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -90,19 +95,339 @@ static unsigned int crc32Table[] = {
 
 
 
-unsigned int crc32( const unsigned char *inData, 
+// slicing-by-16 and carry-less multiply folding added on top of the
+// table above:
+//
+// Slicing-by-16 (Intel, Kounavis and Berry) looks up each of 16 bytes in
+// its own table, giving the effect of that byte followed by 0 to 15 zero
+// bytes, so 16 bytes are handled per step with no dependency between
+// lookups.
+//
+// Folding follows "Fast CRC Computation for Generic Polynomials Using
+// PCLMULQDQ Instruction" (Intel, Gopal et al.), with the bit-reflected
+// constants given at the end of that paper.
+
+
+// crc32Table is crc32Tables[0], the others are built from it
+static unsigned int crc32Tables[16][256];
+
+// x^(2^k) modulo the polynomial, for crc32Combine
+static unsigned int crc32PowerTable[32];
+
+static char crc32TablesReady = false;
+
+
+// 0 one byte at a time, 1 slicing-by-16, 2 PCLMULQDQ
+static int implementationLimit = 2;
+
+
+
+#define CRC32_POLYNOMIAL 0xedb88320
+
+
+// multiplies two polynomials modulo the CRC polynomial, both bit-reflected
+// (so x^0 is the high bit)
+static unsigned int multiplyModPolynomial( unsigned int inA,
+                                           unsigned int inB ) {
+    unsigned int product = 0;
+
+    for( unsigned int mask = 1U << 31; mask != 0; mask >>= 1 ) {
+        if( inA & mask ) {
+            product ^= inB;
+            }
+        // multiply inB by x
+        if( inB & 1 ) {
+            inB = ( inB >> 1 ) ^ CRC32_POLYNOMIAL;
+            }
+        else {
+            inB >>= 1;
+            }
+        }
+
+    return product;
+    }
+
+
+
+static void makeTables() {
+    if( crc32TablesReady ) {
+        return;
+        }
+
+    // threads that race to get here all write the same values
+
+    for( int n=0; n<256; n++ ) {
+        crc32Tables[0][n] = crc32Table[n];
+        }
+
+    for( int k=1; k<16; k++ ) {
+        for( int n=0; n<256; n++ ) {
+            unsigned int previous = crc32Tables[ k - 1 ][n];
+
+            crc32Tables[k][n] =
+                ( previous >> 8 ) ^ crc32Table[ previous & 0xFF ];
+            }
+        }
+
+    // x^1
+    unsigned int power = 1U << 30;
+    crc32PowerTable[0] = power;
+
+    for( int k=1; k<32; k++ ) {
+        power = multiplyModPolynomial( power, power );
+        crc32PowerTable[k] = power;
+        }
+
+    // make sure tables are visible before the flag
+    __sync_synchronize();
+
+    crc32TablesReady = true;
+    }
+
+
+
+int getCRC32Implementation() {
+    const CPUFeatures *features = getCPUFeatures();
+
+    int level = 1;
+    if( features->pclmul && features->sse41 ) {
+        level = 2;
+        }
+
+    return limitImplementation( level, implementationLimit );
+    }
+
+
+
+void setCRC32ImplementationLimit( int inLevel ) {
+    implementationLimit = inLevel;
+    }
+
+
+
+static unsigned int updateBytes( unsigned int inState,
+                                 const unsigned char *inData,
+                                 int inDataLength ) {
+    unsigned int crc = inState;
+
+    for( int i=0; i<inDataLength; i++ ) {
+        crc = crc32Table[ ( crc ^ inData[i] ) & 0xFF ] ^ ( crc >> 8 );
+        }
+    return crc;
+    }
+
+
+
+// little-endian regardless of platform, compiles to a single load on
+// little-endian machines
+static inline unsigned int readWord( const unsigned char *inBytes ) {
+    return
+        (unsigned int)inBytes[0] |
+        (unsigned int)inBytes[1] << 8 |
+        (unsigned int)inBytes[2] << 16 |
+        (unsigned int)inBytes[3] << 24;
+    }
+
+
+
+static unsigned int updateSliced( unsigned int inState,
+                                  const unsigned char *inData,
+                                  int inDataLength ) {
+    unsigned int crc = inState;
+
+    unsigned int ( *t )[256] = crc32Tables;
+
+    while( inDataLength >= 16 ) {
+        unsigned int a = crc ^ readWord( inData );
+        unsigned int b = readWord( inData + 4 );
+        unsigned int c = readWord( inData + 8 );
+        unsigned int d = readWord( inData + 12 );
+
+        crc =
+            t[15][ a & 0xFF ] ^ t[14][ ( a >> 8 ) & 0xFF ] ^
+            t[13][ ( a >> 16 ) & 0xFF ] ^ t[12][ a >> 24 ] ^
+            t[11][ b & 0xFF ] ^ t[10][ ( b >> 8 ) & 0xFF ] ^
+            t[9][ ( b >> 16 ) & 0xFF ] ^ t[8][ b >> 24 ] ^
+            t[7][ c & 0xFF ] ^ t[6][ ( c >> 8 ) & 0xFF ] ^
+            t[5][ ( c >> 16 ) & 0xFF ] ^ t[4][ c >> 24 ] ^
+            t[3][ d & 0xFF ] ^ t[2][ ( d >> 8 ) & 0xFF ] ^
+            t[1][ ( d >> 16 ) & 0xFF ] ^ t[0][ d >> 24 ];
+
+        inData += 16;
+        inDataLength -= 16;
+        }
+
+    return updateBytes( crc, inData, inDataLength );
+    }
+
+
+
+#ifdef CPU_FEATURES_X86
+
+// inDataLength must be at least 64 and a multiple of 16
+__attribute__(( target( "pclmul,sse4.1" ) ))
+static unsigned int updateFolded( unsigned int inState,
+                                  const unsigned char *inData,
+                                  int inDataLength ) {
+
+    // x^(4*128+32) and x^(4*128-32) mod P, for folding across 4 vectors
+    const __m128i k1k2 = _mm_set_epi64x( 0x01c6e41596LL, 0x0154442bd4LL );
+    // x^(128+32) and x^(128-32) mod P, for folding across 1 vector
+    const __m128i k3k4 = _mm_set_epi64x( 0x00ccaa009eLL, 0x01751997d0LL );
+    // x^64 mod P
+    const __m128i k5 = _mm_set_epi64x( 0, 0x0163cd6124LL );
+    // P' and mu for the Barrett reduction
+    const __m128i poly = _mm_set_epi64x( 0x01f7011641LL, 0x01db710641LL );
+
+    const __m128i low32 = _mm_setr_epi32( ~0, 0, ~0, 0 );
+
+    const __m128i *in = (const __m128i *)inData;
+
+    __m128i x1 = _mm_loadu_si128( in );
+    __m128i x2 = _mm_loadu_si128( in + 1 );
+    __m128i x3 = _mm_loadu_si128( in + 2 );
+    __m128i x4 = _mm_loadu_si128( in + 3 );
+
+    x1 = _mm_xor_si128( x1, _mm_cvtsi32_si128( (int)inState ) );
+
+    in += 4;
+    inDataLength -= 64;
+
+    // fold 4 vectors at a time
+    while( inDataLength >= 64 ) {
+        __m128i x5 = _mm_clmulepi64_si128( x1, k1k2, 0x00 );
+        __m128i x6 = _mm_clmulepi64_si128( x2, k1k2, 0x00 );
+        __m128i x7 = _mm_clmulepi64_si128( x3, k1k2, 0x00 );
+        __m128i x8 = _mm_clmulepi64_si128( x4, k1k2, 0x00 );
+
+        x1 = _mm_clmulepi64_si128( x1, k1k2, 0x11 );
+        x2 = _mm_clmulepi64_si128( x2, k1k2, 0x11 );
+        x3 = _mm_clmulepi64_si128( x3, k1k2, 0x11 );
+        x4 = _mm_clmulepi64_si128( x4, k1k2, 0x11 );
+
+        x1 = _mm_xor_si128( _mm_xor_si128( x1, x5 ),
+                            _mm_loadu_si128( in ) );
+        x2 = _mm_xor_si128( _mm_xor_si128( x2, x6 ),
+                            _mm_loadu_si128( in + 1 ) );
+        x3 = _mm_xor_si128( _mm_xor_si128( x3, x7 ),
+                            _mm_loadu_si128( in + 2 ) );
+        x4 = _mm_xor_si128( _mm_xor_si128( x4, x8 ),
+                            _mm_loadu_si128( in + 3 ) );
+
+        in += 4;
+        inDataLength -= 64;
+        }
+
+    // fold the 4 vectors into 1
+    __m128i x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+    x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+    x1 = _mm_xor_si128( _mm_xor_si128( x1, x2 ), x5 );
+
+    x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+    x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+    x1 = _mm_xor_si128( _mm_xor_si128( x1, x3 ), x5 );
+
+    x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+    x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+    x1 = _mm_xor_si128( _mm_xor_si128( x1, x4 ), x5 );
+
+    // fold remaining whole vectors one at a time
+    while( inDataLength >= 16 ) {
+        x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+        x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+        x1 = _mm_xor_si128( _mm_xor_si128( x1, _mm_loadu_si128( in ) ),
+                            x5 );
+        in++;
+        inDataLength -= 16;
+        }
+
+    // 128 bits down to 64
+    x2 = _mm_clmulepi64_si128( x1, k3k4, 0x10 );
+    x1 = _mm_xor_si128( _mm_srli_si128( x1, 8 ), x2 );
+
+    x2 = _mm_srli_si128( x1, 4 );
+    x1 = _mm_and_si128( x1, low32 );
+    x1 = _mm_clmulepi64_si128( x1, k5, 0x00 );
+    x1 = _mm_xor_si128( x1, x2 );
+
+    // Barrett reduction down to 32
+    x2 = _mm_and_si128( x1, low32 );
+    x2 = _mm_clmulepi64_si128( x2, poly, 0x10 );
+    x2 = _mm_and_si128( x2, low32 );
+    x2 = _mm_clmulepi64_si128( x2, poly, 0x00 );
+    x1 = _mm_xor_si128( x1, x2 );
+
+    return (unsigned int)_mm_extract_epi32( x1, 1 );
+    }
+
+#endif
+
+
+
+unsigned int crc32Start() {
+    return ~0U;
+    }
+
+
+
+unsigned int crc32Finish( unsigned int inState ) {
+    return inState ^ ~0U;
+    }
+
+
+
+unsigned int crc32Update( unsigned int inState,
+                          const unsigned char *inData, int inDataLength ) {
+
+    int level = getCRC32Implementation();
+
+    if( level == 0 ) {
+        return updateBytes( inState, inData, inDataLength );
+        }
+
+    makeTables();
+
+#ifdef CPU_FEATURES_X86
+    if( level == 2 && inDataLength >= 64 ) {
+        int numFolded = inDataLength & ~15;
+
+        inState = updateFolded( inState, inData, numFolded );
+
+        inData += numFolded;
+        inDataLength -= numFolded;
+        }
+#endif
+
+    return updateSliced( inState, inData, inDataLength );
+    }
+
+
+
+unsigned int crc32( const unsigned char *inData,
                     int inDataLength ) {
-	
-    const unsigned char *p;
-    unsigned int crc = 0;
-    
 
-	p = inData;
-	crc = crc ^ ~0U;
+    return crc32Finish( crc32Update( crc32Start(), inData, inDataLength ) );
+    }
+
+
 
-	while( inDataLength-- ) {
-		crc = crc32Table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+unsigned int crc32Combine( unsigned int inCRCA, unsigned int inCRCB,
+                           long long inLengthB ) {
+    makeTables();
+
+    // appending inLengthB bytes multiplies the CRC of A by
+    // x^(8 * inLengthB), built up from the powers x^(2^k)
+    unsigned int shift = 1U << 31;
+
+    int k = 3;
+    while( inLengthB > 0 ) {
+        if( inLengthB & 1 ) {
+            shift = multiplyModPolynomial( crc32PowerTable[ k & 31 ],
+                                           shift );
+            }
+        inLengthB >>= 1;
+        k++;
         }
-    
-    return crc ^ ~0U;
+
+    return multiplyModPolynomial( shift, inCRCA ) ^ inCRCB;
     }
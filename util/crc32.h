@@ -1,4 +1,86 @@
+#ifndef CRC32_INCLUDED
+#define CRC32_INCLUDED
 
 
-unsigned int crc32( const unsigned char *inData, 
+
+/**
+ * Computes the standard CRC-32 (as used by zip, gzip, and PNG) of a
+ * block of data.
+ */
+unsigned int crc32( const unsigned char *inData,
                     int inDataLength );
+
+
+
+// Incremental interface, for data that arrives in pieces:
+//
+//   unsigned int state = crc32Start();
+//   state = crc32Update( state, pieceA, lengthA );
+//   state = crc32Update( state, pieceB, lengthB );
+//   unsigned int crc = crc32Finish( state );
+//
+// gives the same result as crc32 on the concatenated pieces.
+
+
+/**
+ * Gets the initial state for a new CRC.
+ */
+unsigned int crc32Start();
+
+
+
+/**
+ * Adds data to a CRC in progress.
+ *
+ * @return the new state.
+ */
+unsigned int crc32Update( unsigned int inState,
+                          const unsigned char *inData, int inDataLength );
+
+
+
+/**
+ * Gets the finished CRC from a state.
+ */
+unsigned int crc32Finish( unsigned int inState );
+
+
+
+/**
+ * Combines the finished CRCs of two consecutive chunks of data into the
+ * CRC of both chunks together, without touching the data.
+ *
+ * Lets chunks of a large file be checksummed separately (on different
+ * threads, for example) and joined afterward.  Takes O(log(inLengthB))
+ * time.
+ *
+ * @param inCRCA the CRC of the first chunk.
+ * @param inCRCB the CRC of the second chunk.
+ * @param inLengthB the length of the second chunk in bytes.
+ *
+ * @return the CRC of the first chunk followed by the second.
+ */
+unsigned int crc32Combine( unsigned int inCRCA, unsigned int inCRCB,
+                           long long inLengthB );
+
+
+
+/**
+ * Gets the implementation used by the functions above:  0 for one byte
+ * at a time, 1 for 16 bytes at a time through tables (slicing-by-16),
+ * 2 for carry-less multiply folding (x86 PCLMULQDQ).
+ *
+ * See minorGems/system/cpuFeatures.h.
+ */
+int getCRC32Implementation();
+
+
+
+/**
+ * Caps the implementation returned by getCRC32Implementation.
+ */
+void setCRC32ImplementationLimit( int inLevel );
+
+
+
+#endif
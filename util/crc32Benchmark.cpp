@@ -0,0 +1,155 @@
+// Throughput of each CRC32 implementation, on one large buffer and on
+// many small network-sized messages, plus the cost of checksumming a
+// buffer in chunks joined with crc32Combine.
+//
+// Usage:  crc32Benchmark [megabytesPerRun]
+
+
+#include "minorGems/util/crc32.h"
+
+#include "minorGems/system/Time.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+
+static const char *implementationNames[3] =
+    { "byte table", "slicing-by-16", "PCLMULQDQ" };
+
+
+static unsigned char *data;
+static int dataLength;
+
+// sink so results aren't optimized away
+static unsigned int crcSum = 0;
+
+
+
+static void runWhole() {
+    crcSum += crc32( data, dataLength );
+    }
+
+
+
+static int messageLength = 64;
+
+static void runMessages() {
+    for( int i=0; i + messageLength <= dataLength; i += messageLength ) {
+        crcSum += crc32( &( data[i] ), messageLength );
+        }
+    }
+
+
+
+static int numChunks = 16;
+
+static void runChunksCombined() {
+    int chunkLength = dataLength / numChunks;
+
+    unsigned int crc = crc32( data, chunkLength );
+
+    for( int c=1; c<numChunks; c++ ) {
+        int length = chunkLength;
+        if( c == numChunks - 1 ) {
+            length = dataLength - c * chunkLength;
+            }
+
+        // chunks could be checksummed on separate threads
+        unsigned int chunkCRC = crc32( &( data[ c * chunkLength ] ), length );
+
+        crc = crc32Combine( crc, chunkCRC, length );
+        }
+
+    crcSum += crc;
+    }
+
+
+
+static double timeOperation( const char *inName, void (*inOperation)(),
+                             double inNumBytes ) {
+    // warm up
+    inOperation();
+
+    int numRuns = 10;
+
+    double startTime = Time::getCurrentTime();
+    for( int i=0; i<numRuns; i++ ) {
+        inOperation();
+        }
+    double time = ( Time::getCurrentTime() - startTime ) / numRuns;
+
+    printf( "  %-30s %6.2f GB/s\n", inName, inNumBytes / time / 1e9 );
+
+    return time;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    int megabytesPerRun = 64;
+
+    if( inNumArgs == 2 ) {
+        megabytesPerRun = atoi( inArgs[1] );
+        }
+
+    dataLength = megabytesPerRun * 1000000;
+    data = new unsigned char[ dataLength ];
+
+    unsigned int seed = 12345;
+    for( int i=0; i<dataLength; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (unsigned char)( seed >> 16 );
+        }
+
+    printf( "%d MB of random bytes, average of 10 runs\n", megabytesPerRun );
+
+    int maxImplementation = 2;
+    for( ; maxImplementation > 0; maxImplementation-- ) {
+        setCRC32ImplementationLimit( maxImplementation );
+        if( getCRC32Implementation() == maxImplementation ) {
+            break;
+            }
+        }
+
+    for( int i=0; i<=maxImplementation; i++ ) {
+        setCRC32ImplementationLimit( i );
+
+        printf( "\n%s:\n", implementationNames[i] );
+
+        timeOperation( "whole buffer", runWhole, dataLength );
+
+        messageLength = 64;
+        timeOperation( "64-byte messages", runMessages, dataLength );
+
+        messageLength = 1400;
+        timeOperation( "1400-byte messages", runMessages, dataLength );
+
+        timeOperation( "16 chunks + crc32Combine", runChunksCombined,
+                       dataLength );
+        }
+
+
+    // combining is independent of data size
+    int numCombines = 1000000;
+
+    double startTime = Time::getCurrentTime();
+    unsigned int crc = 0;
+    for( int i=0; i<numCombines; i++ ) {
+        crc = crc32Combine( crc, (unsigned int)i, 1 << 30 );
+        }
+    double time = Time::getCurrentTime() - startTime;
+    crcSum += crc;
+
+    printf( "\ncrc32Combine of a 1 GiB chunk:  %.0f ns\n",
+            time / numCombines * 1e9 );
+
+    // keep sum live
+    printf( "(checksum sum %08X)\n", crcSum );
+
+    delete [] data;
+
+    return 0;
+    }
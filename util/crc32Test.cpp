@@ -0,0 +1,234 @@
+// Checks every CRC32 implementation against a copy of the original
+// byte-at-a-time function, over random lengths and alignments, and
+// checks that incremental updates and crc32Combine agree with one-shot
+// results.
+//
+// Usage:  crc32Test [numRounds]
+//
+// Exits with non-zero status on failure.
+
+
+#include "minorGems/util/crc32.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+
+static const char *implementationNames[3] =
+    { "byte table", "slicing-by-16", "PCLMULQDQ" };
+
+
+
+static unsigned int randSeed = 12345;
+
+static unsigned int nextRand() {
+    randSeed = randSeed * 1103515245 + 12345;
+    return randSeed >> 8;
+    }
+
+
+
+// reference copy of the original implementation, with its table built
+// the long way
+static unsigned int refTable[256];
+
+static void makeRefTable() {
+    for( unsigned int n=0; n<256; n++ ) {
+        unsigned int c = n;
+        for( int k=0; k<8; k++ ) {
+            if( c & 1 ) {
+                c = 0xedb88320 ^ ( c >> 1 );
+                }
+            else {
+                c = c >> 1;
+                }
+            }
+        refTable[n] = c;
+        }
+    }
+
+
+static unsigned int refCRC32( const unsigned char *inData,
+                              int inDataLength ) {
+    unsigned int crc = ~0U;
+
+    while( inDataLength-- ) {
+        crc = refTable[ ( crc ^ *inData++ ) & 0xFF ] ^ ( crc >> 8 );
+        }
+    return crc ^ ~0U;
+    }
+
+
+
+static char check( const char *inWhat, unsigned int inResult,
+                   unsigned int inExpected, int inLength ) {
+    if( inResult != inExpected ) {
+        printf( "%s mismatch for length %d:  %08X, expected %08X\n",
+                inWhat, inLength, inResult, inExpected );
+        return false;
+        }
+    return true;
+    }
+
+
+
+static char runTests( int inImplementation, int inNumRounds ) {
+    setCRC32ImplementationLimit( inImplementation );
+
+    const unsigned char *checkString = (const unsigned char *)"123456789";
+
+    if( ! check( "check value", crc32( checkString, 9 ), 0xCBF43926, 9 ) ) {
+        return false;
+        }
+
+    if( ! check( "empty", crc32( checkString, 0 ), 0, 0 ) ) {
+        return false;
+        }
+
+
+    int bufferSize = 70000;
+    unsigned char *buffer = new unsigned char[ bufferSize ];
+
+    for( int i=0; i<bufferSize; i++ ) {
+        buffer[i] = (unsigned char)nextRand();
+        }
+
+    char passed = true;
+
+    for( int r=0; r<inNumRounds && passed; r++ ) {
+
+        // mostly short lengths, where the paths hand off to each other
+        int length;
+        if( r % 4 == 0 ) {
+            length = nextRand() % ( bufferSize - 16 );
+            }
+        else {
+            length = nextRand() % 300;
+            }
+
+        // random alignment
+        unsigned char *data = &( buffer[ nextRand() % 16 ] );
+
+        unsigned int expected = refCRC32( data, length );
+
+        passed = check( "crc32", crc32( data, length ), expected, length );
+
+
+        // same data in random pieces
+        unsigned int state = crc32Start();
+        int done = 0;
+        while( done < length ) {
+            int piece = nextRand() % ( length - done + 1 );
+            state = crc32Update( state, &( data[ done ] ), piece );
+            done += piece;
+            }
+
+        passed = passed &&
+            check( "crc32Update", crc32Finish( state ), expected, length );
+
+
+        // split in two and combined
+        int split = 0;
+        if( length > 0 ) {
+            split = nextRand() % ( length + 1 );
+            }
+
+        unsigned int crcA = crc32( data, split );
+        unsigned int crcB = crc32( &( data[ split ] ), length - split );
+
+        passed = passed &&
+            check( "crc32Combine", crc32Combine( crcA, crcB, length - split ),
+                   expected, length );
+        }
+
+    delete [] buffer;
+
+    return passed;
+    }
+
+
+
+// the second chunk can be longer than fits in memory, so check combining
+// across lengths beyond 32 bits against chunks of zeros combined in
+// halves
+static char testLongCombine() {
+    // CRC of 2^k zero bytes, built by combining halves
+    unsigned char zeros[1] = { 0 };
+    unsigned int zeroCRC = crc32( zeros, 1 );
+
+    long long length = 1;
+
+    for( int k=0; k<40; k++ ) {
+        zeroCRC = crc32Combine( zeroCRC, zeroCRC, length );
+        length *= 2;
+
+        if( k == 19 ) {
+            // check against real data at 1 MiB
+            unsigned char *block = new unsigned char[ length ];
+            for( long long i=0; i<length; i++ ) {
+                block[i] = 0;
+                }
+            unsigned int expected = refCRC32( block, (int)length );
+            delete [] block;
+
+            if( ! check( "zero combine", zeroCRC, expected, (int)length ) ) {
+                return false;
+                }
+            }
+        }
+
+    // now 2^40 zeros, combining A with them then with B should match
+    // combining A with the zeros-plus-B
+    unsigned char *data = (unsigned char *)"crc32Combine test";
+    unsigned int crcA = crc32( data, 5 );
+    unsigned int crcB = crc32( &( data[5] ), 12 );
+
+    unsigned int first = crc32Combine( crc32Combine( crcA, zeroCRC, length ),
+                                       crcB, 12 );
+    unsigned int second = crc32Combine( crcA,
+                                        crc32Combine( zeroCRC, crcB, 12 ),
+                                        length + 12 );
+
+    return check( "long combine", first, second, 0 );
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+
+    int numRounds = 20000;
+
+    if( inNumArgs == 2 ) {
+        numRounds = atoi( inArgs[1] );
+        }
+
+    makeRefTable();
+
+    // find what this processor supports
+    int maxImplementation = 2;
+    for( ; maxImplementation > 0; maxImplementation-- ) {
+        setCRC32ImplementationLimit( maxImplementation );
+        if( getCRC32Implementation() == maxImplementation ) {
+            break;
+            }
+        }
+
+    for( int i=0; i<=maxImplementation; i++ ) {
+        if( ! runTests( i, numRounds ) ) {
+            printf( "%s FAILED\n", implementationNames[i] );
+            return 1;
+            }
+        printf( "%-15s %d rounds passed\n", implementationNames[i],
+                numRounds );
+        }
+
+    if( ! testLongCombine() ) {
+        printf( "crc32Combine FAILED\n" );
+        return 1;
+        }
+    printf( "crc32Combine over 2^40 bytes passed\n" );
+
+    return 0;
+    }
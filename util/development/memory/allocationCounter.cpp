@@ -0,0 +1,113 @@
+#include "allocationCounter.h"
+
+#include <stdlib.h>
+#include <new>
+
+
+
+static volatile unsigned long allocationCount = 0;
+static volatile unsigned long allocatedByteCount = 0;
+
+
+
+unsigned long getAllocationCount() {
+    return __sync_fetch_and_add( &allocationCount, 0 );
+    }
+
+
+
+unsigned long getAllocatedByteCount() {
+    return __sync_fetch_and_add( &allocatedByteCount, 0 );
+    }
+
+
+
+static void countAllocation( size_t inSize ) {
+    __sync_fetch_and_add( &allocationCount, 1 );
+    __sync_fetch_and_add( &allocatedByteCount, inSize );
+    }
+
+
+
+void *countedMalloc( size_t inSize ) {
+    countAllocation( inSize );
+    return malloc( inSize );
+    }
+
+
+
+void *countedRealloc( void *inPointer, size_t inSize ) {
+    countAllocation( inSize );
+    return realloc( inPointer, inSize );
+    }
+
+
+
+static void *countedAlloc( size_t inSize ) {
+    countAllocation( inSize );
+
+    if( inSize == 0 ) {
+        // new of size 0 must still return a unique pointer
+        inSize = 1;
+        }
+    
+    return malloc( inSize );
+    }
+
+
+
+void *operator new( size_t inSize ) {
+    void *p = countedAlloc( inSize );
+    
+    if( p == NULL ) {
+        throw std::bad_alloc();
+        }
+    return p;
+    }
+
+
+
+void *operator new[]( size_t inSize ) {
+    void *p = countedAlloc( inSize );
+    
+    if( p == NULL ) {
+        throw std::bad_alloc();
+        }
+    return p;
+    }
+
+
+
+void *operator new( size_t inSize, const std::nothrow_t & ) throw() {
+    return countedAlloc( inSize );
+    }
+
+
+
+void *operator new[]( size_t inSize, const std::nothrow_t & ) throw() {
+    return countedAlloc( inSize );
+    }
+
+
+
+void operator delete( void *inPointer ) throw() {
+    free( inPointer );
+    }
+
+
+
+void operator delete[]( void *inPointer ) throw() {
+    free( inPointer );
+    }
+
+
+
+void operator delete( void *inPointer, size_t ) throw() {
+    free( inPointer );
+    }
+
+
+
+void operator delete[]( void *inPointer, size_t ) throw() {
+    free( inPointer );
+    }
@@ -0,0 +1,43 @@
+#ifndef ALLOCATION_COUNTER_INCLUDED
+#define ALLOCATION_COUNTER_INCLUDED
+
+
+#include <stddef.h>
+
+
+
+// Counts every call to the global new and new[] operators.
+//
+// Linking allocationCounter.o into a build replaces the global operators
+// with counting versions that pass through to malloc/free.
+//
+// Direct malloc and realloc calls are not seen by these operators, so
+// SimpleVector, which grows its storage with realloc, calls countedMalloc
+// and countedRealloc instead when built with -DCOUNT_ALLOCATIONS.
+//
+// Code that wants to report the counts should be compiled with
+// -DCOUNT_ALLOCATIONS so that it only references these functions when
+// allocationCounter.o is actually linked in.
+//
+// Counters are updated atomically, so they are safe to read from any thread,
+// but they count allocations from ALL threads.
+
+
+// total number of allocations since program start
+unsigned long getAllocationCount();
+
+
+// total number of bytes requested since program start
+unsigned long getAllocatedByteCount();
+
+
+
+// malloc and realloc, counted like new
+// each realloc counts as one allocation of its new size
+void *countedMalloc( size_t inSize );
+
+void *countedRealloc( void *inPointer, size_t inSize );
+
+
+
+#endif
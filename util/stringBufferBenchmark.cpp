@@ -0,0 +1,209 @@
+// Measures StringBufferOutputStream write throughput for outputs from 1 KB
+// to 100 MB, written in small pieces (as writeString and writeLong do) and
+// in large blocks, followed by getBytes or detachBytes.
+//
+// Compares against the previous implementation, which pushed bytes into
+// a SimpleVector one at a time and copied them out with getElementArray.
+//
+// Each size is repeated until about 100 MB have been written in total.
+//
+// Usage:  stringBufferBenchmark [maxMegabytes]
+//
+// Exits with non-zero status if any output does not match what was
+// written.
+
+
+#include "minorGems/util/StringBufferOutputStream.h"
+#include "minorGems/util/SimpleVector.h"
+
+#include "minorGems/system/Time.h"
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+#define SMALL_WRITE 16
+#define LARGE_WRITE 65536
+
+#define TOTAL_BYTES_PER_SIZE ( 100 * 1048576 )
+
+
+static unsigned char *source;
+
+static int numFailures = 0;
+
+
+
+static void checkOutput( unsigned char *inBytes, int inNumBytes,
+                         int inExpectedBytes ) {
+    if( inNumBytes != inExpectedBytes ||
+        memcmp( inBytes, source, inNumBytes ) != 0 ) {
+        numFailures++;
+        }
+    }
+
+
+
+// returns MB/s
+static double runOld( int inSize, int inWriteSize, int inNumRepeats ) {
+    double startTime = Time::getCurrentTime();
+
+    for( int r=0; r<inNumRepeats; r++ ) {
+        SimpleVector<unsigned char> vector;
+        
+        for( int p=0; p<inSize; p += inWriteSize ) {
+            int numBytes = inWriteSize;
+            if( p + numBytes > inSize ) {
+                numBytes = inSize - p;
+                }
+            for( int i=0; i<numBytes; i++ ) {
+                vector.push_back( source[ p + i ] );
+                }
+            }
+
+        int numBytes = vector.size();
+        unsigned char *bytes = vector.getElementArray();
+        
+        if( r == 0 ) {
+            checkOutput( bytes, numBytes, inSize );
+            }
+        delete [] bytes;
+        }
+
+    double time = Time::getCurrentTime() - startTime;
+    
+    return ( (double)inSize * inNumRepeats / 1048576 ) / time;
+    }
+
+
+
+// returns MB/s
+static double runNew( int inSize, int inWriteSize, int inNumRepeats,
+                      char inDetach ) {
+    double startTime = Time::getCurrentTime();
+
+    for( int r=0; r<inNumRepeats; r++ ) {
+        StringBufferOutputStream stream;
+        
+        for( int p=0; p<inSize; p += inWriteSize ) {
+            int numBytes = inWriteSize;
+            if( p + numBytes > inSize ) {
+                numBytes = inSize - p;
+                }
+            stream.write( &( source[ p ] ), numBytes );
+            }
+
+        int numBytes;
+        unsigned char *bytes;
+        
+        if( inDetach ) {
+            bytes = stream.detachBytes( &numBytes );
+            }
+        else {
+            bytes = stream.getBytes( &numBytes );
+            }
+
+        if( r == 0 ) {
+            checkOutput( bytes, numBytes, inSize );
+            }
+        delete [] bytes;
+        }
+
+    double time = Time::getCurrentTime() - startTime;
+    
+    return ( (double)inSize * inNumRepeats / 1048576 ) / time;
+    }
+
+
+
+int main( int inNumArgs, char **inArgs ) {
+    
+    int maxMegabytes = 100;
+    
+    if( inNumArgs == 2 ) {
+        maxMegabytes = atoi( inArgs[1] );
+        }
+
+    int maxSize = maxMegabytes * 1048576;
+    
+    source = new unsigned char[ maxSize ];
+    for( int i=0; i<maxSize; i++ ) {
+        source[i] = (unsigned char)( i * 7 + ( i >> 8 ) );
+        }
+    
+    int sizes[] = { 1024, 16384, 262144, 1048576, 16777216, 104857600 };
+    int numSizes = sizeof( sizes ) / sizeof( int );
+    
+    int writeSizes[] = { SMALL_WRITE, LARGE_WRITE };
+    
+
+    for( int w=0; w<2; w++ ) {
+        printf( "\n%d-byte writes, MB/s\n", writeSizes[w] );
+        printf( "%12s %12s %12s %12s\n", 
+                "output", "old", "getBytes", "detachBytes" );
+        
+        for( int s=0; s<numSizes; s++ ) {
+            int size = sizes[s];
+            
+            if( size > maxSize ) {
+                break;
+                }
+            
+            int numRepeats = TOTAL_BYTES_PER_SIZE / size;
+            if( numRepeats < 1 ) {
+                numRepeats = 1;
+                }
+            
+            double oldRate = runOld( size, writeSizes[w], numRepeats );
+            double getRate = runNew( size, writeSizes[w], numRepeats, false );
+            double detachRate = 
+                runNew( size, writeSizes[w], numRepeats, true );
+            
+            printf( "%10d K %12.0f %12.0f %12.0f\n", size / 1024,
+                    oldRate, getRate, detachRate );
+            }
+        }
+
+
+    // data can go out through a gathered send with no copying
+    StringBufferOutputStream stream;
+    stream.write( source, maxSize );
+    stream.write( source, 100 );
+    
+    unsigned char *chunks[ 64 ];
+    int lengths[ 64 ];
+    
+    int numChunks = stream.getChunks( chunks, lengths, 64 );
+    
+    int totalLength = 0;
+    for( int i=0; i<numChunks; i++ ) {
+        for( int b=0; b<lengths[i]; b++ ) {
+            // second write started over at beginning of source
+            int sourceIndex = ( totalLength + b ) % maxSize;
+            
+            if( chunks[i][b] != source[ sourceIndex ] ) {
+                numFailures++;
+                break;
+                }
+            }
+        totalLength += lengths[i];
+        }
+    if( totalLength != maxSize + 100 ) {
+        numFailures++;
+        }
+
+    printf( "\n%d MB output in %d chunks for gathered send\n", 
+            maxMegabytes, numChunks );
+
+    delete [] source;
+
+    if( numFailures > 0 ) {
+        printf( "\n%d outputs FAILED to match\n", numFailures );
+        return 1;
+        }
+    
+    return 0;
+    }
@@ -1,9 +1,20 @@
+// Checks SimpleVector copying, moving, and inline storage, then benchmarks
+// push_back, erase, and copy for POD and non-POD elements against the
+// previous implementation.
+//
+// Exits with non-zero status if a check fails.
+
+
 
 
 #include "SimpleVector.h"
 
+#include "minorGems/system/Time.h"
+
 
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
 
 
 class A {
@@ -35,6 +46,397 @@ class A {
 
 
 
+// Previous SimpleVector growth, erase, and copy implementation, kept here
+// to benchmark against.  Storage is allocated with new [], which
+// default-constructs every slot, and elements are copied with assignment.
+template <class Type>
+class OldSimpleVector {
+    public:
+        OldSimpleVector()
+                : elements( new Type[ defaultStartSize ] ), 
+                  numFilledElements( 0 ), maxSize( defaultStartSize ) {
+            }
+
+        OldSimpleVector( const OldSimpleVector &inCopy )
+                : elements( new Type[ inCopy.maxSize ] ),
+                  numFilledElements( inCopy.numFilledElements ),
+                  maxSize( inCopy.maxSize ) {
+            for( int i=0; i<numFilledElements; i++ ) {
+                elements[i] = inCopy.elements[i];
+                }
+            }
+        
+        ~OldSimpleVector() {
+            delete [] elements;
+            }
+        
+        int size() {
+            return numFilledElements;
+            }
+        
+        Type *getElementFast( int index ) {
+            return &( elements[index] );
+            }
+        
+        void push_back( Type x ) {
+            if( numFilledElements == maxSize ) {
+                int newMaxSize = maxSize << 1;
+                Type *newAlloc = new Type[ newMaxSize ];
+                for( int i=0; i<numFilledElements; i++ ) {
+                    newAlloc[i] = elements[i];
+                    }
+                delete [] elements;
+                elements = newAlloc;
+                maxSize = newMaxSize;
+                }
+            elements[ numFilledElements ] = x;
+            numFilledElements++;
+            }
+        
+        bool deleteElement( int index ) {
+            if( index < numFilledElements ) {
+                for( int i=index+1; i<numFilledElements; i++ ) {
+                    elements[i - 1] = elements[i];
+                    }
+                numFilledElements--;
+                return true;
+                }
+            return false;
+            }
+        
+    protected:
+        Type *elements;
+        int numFilledElements;
+        int maxSize;
+    };
+
+
+
+// plain data
+typedef struct Particle {
+        float x, y, z;
+        int id;
+    } Particle;
+
+
+static Particle makeParticle( int inI ) {
+    Particle p = { (float)inI, 0, 0, inI };
+    return p;
+    }
+
+
+static int getID( Particle *inP ) {
+    return inP->id;
+    }
+
+
+
+// owns a heap string, deep copied, counts live instances to catch leaks
+// and double destruction
+class Name {
+    public:
+        Name() : mString( NULL ) {
+            sLiveCount++;
+            }
+
+        Name( int inI ) : mString( new char[ 16 ] ) {
+            snprintf( mString, 16, "name%d", inI );
+            sLiveCount++;
+            }
+        
+        Name( const Name &inOther ) : mString( NULL ) {
+            copyFrom( inOther );
+            sLiveCount++;
+            }
+
+#ifdef SIMPLE_VECTOR_MOVE_SUPPORT
+        Name( Name &&inOther ) : mString( inOther.mString ) {
+            inOther.mString = NULL;
+            sLiveCount++;
+            }
+
+        Name & operator = ( Name &&inOther ) {
+            if( this != &inOther ) {
+                if( mString != NULL ) {
+                    delete [] mString;
+                    }
+                mString = inOther.mString;
+                inOther.mString = NULL;
+                }
+            return *this;
+            }
+#endif
+
+        Name & operator = ( const Name &inOther ) {
+            if( this != &inOther ) {
+                if( mString != NULL ) {
+                    delete [] mString;
+                    }
+                copyFrom( inOther );
+                }
+            return *this;
+            }
+        
+        ~Name() {
+            if( mString != NULL ) {
+                delete [] mString;
+                }
+            sLiveCount--;
+            }
+        
+        char *mString;
+        
+        static int sLiveCount;
+
+    protected:
+        void copyFrom( const Name &inOther ) {
+            mString = NULL;
+            if( inOther.mString != NULL ) {
+                mString = new char[ 16 ];
+                memcpy( mString, inOther.mString, 16 );
+                }
+            }
+    };
+
+
+int Name::sLiveCount = 0;
+
+
+static Name makeName( int inI ) {
+    return Name( inI );
+    }
+
+
+static int getID( Name *inN ) {
+    return atoi( &( inN->mString[4] ) );
+    }
+
+
+
+
+static int numFailures = 0;
+
+static void check( char inOK, const char *inName ) {
+    if( !inOK ) {
+        printf( "FAILED:  %s\n", inName );
+        numFailures++;
+        }
+    }
+
+
+
+static void runChecks() {
+    {
+        SimpleVector<Name> v;
+        
+        for( int i=0; i<1000; i++ ) {
+            v.push_back( makeName( i ) );
+            }
+        
+        // pushing own element while vector expands
+        int oldSize = v.size();
+        while( v.size() < 1024 ) {
+            v.push_back( *( v.getElement( 0 ) ) );
+            }
+        check( v.size() == 1024 && 
+               strcmp( v.getElementFast( oldSize )->mString, "name0" ) == 0,
+               "push_back of own element" );
+
+        v.shrink( 1000 );
+
+        v.deleteElement( 0 );
+        v.deleteStartElements( 9 );
+        check( v.size() == 990 && getID( v.getElementFast( 0 ) ) == 10 &&
+               getID( v.getElementFast( 989 ) ) == 999,
+               "non-POD delete" );
+
+        Name n( 5 );
+        v.push_middle( n, 2 );
+        check( getID( v.getElementFast( 2 ) ) == 5 &&
+               getID( v.getElementFast( 3 ) ) == 12, "non-POD push_middle" );
+        
+        SimpleVector<Name> copy = v;
+        check( copy.size() == v.size() &&
+               copy.getElementFast( 7 )->mString != 
+               v.getElementFast( 7 )->mString, "non-POD deep copy" );
+        
+        copy.deleteAll();
+        copy = v;
+        check( copy.size() == v.size(), "non-POD assignment" );
+        
+#ifdef SIMPLE_VECTOR_MOVE_SUPPORT
+        SimpleVector<Name> moved( std::move( copy ) );
+        check( moved.size() == v.size() && copy.size() == 0,
+               "move construction" );
+        
+        copy = std::move( moved );
+        check( copy.size() == v.size() && moved.size() == 0,
+               "move assignment" );
+        
+        moved.emplace_back( 77 );
+        check( moved.size() == 1 && getID( moved.getElementFast( 0 ) ) == 77,
+               "emplace_back" );
+#endif
+        }
+    check( Name::sLiveCount == 0, "no leaked or double-freed elements" );
+    
+
+    {
+        InlineSimpleVector<int, 8> v;
+        unsigned char *start = (unsigned char *)&v;
+        
+        for( int i=0; i<8; i++ ) {
+            v.push_back( i );
+            }
+        unsigned char *first = (unsigned char *)v.getElementFast( 0 );
+        
+        check( first >= start && first < start + sizeof( v ),
+               "inline storage used while small" );
+        
+        for( int i=8; i<100; i++ ) {
+            v.push_back( i );
+            }
+        
+        InlineSimpleVector<int, 8> copy = v;
+        
+        char allMatch = ( copy.size() == 100 );
+        for( int i=0; i<copy.size() && allMatch; i++ ) {
+            allMatch = ( copy.getElementDirect( i ) == i );
+            }
+        check( allMatch, "inline storage growth and copy" );
+        
+        v.deleteAll();
+        v.push_back( 3 );
+        first = (unsigned char *)v.getElementFast( 0 );
+        check( first >= start && first < start + sizeof( v ) &&
+               v.getElementDirect( 0 ) == 3, "inline storage after deleteAll" );
+        }
+    
+
+    {
+        InlineSimpleVector<Name, 4> v;
+        for( int i=0; i<50; i++ ) {
+            v.push_back( makeName( i ) );
+            }
+        v.deleteElement( 10 );
+        check( getID( v.getElementFast( 10 ) ) == 11, "inline non-POD" );
+        }
+    check( Name::sLiveCount == 0, "no leaked inline non-POD elements" );
+    }
+
+
+
+
+template <class Vector, class Element>
+static void benchmark( const char *inName, int inNumElements,
+                       int inNumErased, int inNumCopies,
+                       Element (*inMake)( int ), 
+                       int (*inGetID)( Element * ) ) {
+    
+    // checksum keeps work from being optimized away
+    unsigned int checksum = 0;
+    
+    double startTime = Time::getCurrentTime();
+    
+    Vector v;
+    for( int i=0; i<inNumElements; i++ ) {
+        v.push_back( inMake( i ) );
+        }
+    checksum += inGetID( v.getElementFast( v.size() - 1 ) );
+    
+    double pushTime = Time::getCurrentTime() - startTime;
+
+    
+    // erasing from the front of a huge vector takes too long, so use
+    // a shorter one
+    Vector e;
+    for( int i=0; i<inNumErased * 10; i++ ) {
+        e.push_back( inMake( i ) );
+        }
+
+    startTime = Time::getCurrentTime();
+    
+    for( int i=0; i<inNumErased; i++ ) {
+        e.deleteElement( 0 );
+        }
+    checksum += inGetID( e.getElementFast( 0 ) );
+    
+    double eraseTime = Time::getCurrentTime() - startTime;
+
+    
+    startTime = Time::getCurrentTime();
+    
+    for( int i=0; i<inNumCopies; i++ ) {
+        Vector copy( v );
+        checksum += inGetID( copy.getElementFast( i ) );
+        }
+    
+    double copyTime = Time::getCurrentTime() - startTime;
+    
+    printf( "%-28s push_back %7.2f ms   erase front %7.2f ms   "
+            "copy %7.2f ms   (%u)\n",
+            inName, pushTime * 1000, eraseTime * 1000, copyTime * 1000,
+            checksum );
+    }
+
+
+
+static void runBenchmarks() {
+    printf( "\n1000000 push_back, 2000 erased from front of 20000, 20 copies of 1000000\n" );
+    
+    benchmark< OldSimpleVector<Particle>, Particle >( 
+        "POD, old", 1000000, 2000, 20, makeParticle, getID );
+    benchmark< SimpleVector<Particle>, Particle >( 
+        "POD, new", 1000000, 2000, 20, makeParticle, getID );
+
+    benchmark< OldSimpleVector<Name>, Name >( 
+        "non-POD, old", 1000000, 2000, 20, makeName, getID );
+    benchmark< SimpleVector<Name>, Name >( 
+        "non-POD, new", 1000000, 2000, 20, makeName, getID );
+
+    
+    // many short vectors, as in per-frame scratch lists
+    int numVectors = 200000;
+    unsigned int checksum = 0;
+    
+    double startTime = Time::getCurrentTime();
+    for( int j=0; j<numVectors; j++ ) {
+        OldSimpleVector<int> v;
+        for( int i=0; i<8; i++ ) {
+            v.push_back( i + j );
+            }
+        checksum += *( v.getElementFast( 7 ) );
+        }
+    double oldTime = Time::getCurrentTime() - startTime;
+
+    startTime = Time::getCurrentTime();
+    for( int j=0; j<numVectors; j++ ) {
+        SimpleVector<int> v;
+        for( int i=0; i<8; i++ ) {
+            v.push_back( i + j );
+            }
+        checksum += *( v.getElementFast( 7 ) );
+        }
+    double newTime = Time::getCurrentTime() - startTime;
+
+    startTime = Time::getCurrentTime();
+    for( int j=0; j<numVectors; j++ ) {
+        InlineSimpleVector<int, 8> v;
+        for( int i=0; i<8; i++ ) {
+            v.push_back( i + j );
+            }
+        checksum += *( v.getElementFast( 7 ) );
+        }
+    double inlineTime = Time::getCurrentTime() - startTime;
+    
+    printf( "\n%d vectors of 8 ints:  old %.2f ms   new %.2f ms   "
+            "inline %.2f ms   (%u)\n",
+            numVectors, oldTime * 1000, newTime * 1000, inlineTime * 1000,
+            checksum );
+    }
+
+
+
 int main() {
     
     SimpleVector<A> v;
@@ -129,7 +531,17 @@ int main() {
         ( w.getElement( i ) )->print();
         }
     printf( "\n" );
-    
-    }
 
     
+    runChecks();
+    
+    if( numFailures > 0 ) {
+        printf( "\n%d checks FAILED\n", numFailures );
+        return 1;
+        }
+    printf( "\nAll checks passed\n" );
+    
+    runBenchmarks();
+
+    return 0;
+    }